@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""
+OpenFIDO P-256 Comb Table Generator
+
+Prints the fixed-base comb table used by src/crypto/p256.c. Entry i holds
+the affine point sum(bit_j(i) * 2^(j * SPACING) * G) for j < TEETH, as
+little-endian 32-bit limbs. Entry 0 (the point at infinity) is all zeros;
+the comb never adds it.
+
+Usage: gen_p256_comb.py > table.inc, then paste into p256.c.
+"""
+
+P = 2**256 - 2**224 + 2**192 + 2**96 - 1
+GX = 0x6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296
+GY = 0x4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5
+
+# Must match P256_COMB_TEETH / P256_COMB_SPACING in p256.c
+TEETH = 5
+SPACING = 52
+
+
+def add(a, b):
+    if a is None:
+        return b
+    if b is None:
+        return a
+    (x1, y1), (x2, y2) = a, b
+    if x1 == x2:
+        if (y1 + y2) % P == 0:
+            return None
+        lam = (3 * x1 * x1 - 3) * pow(2 * y1, -1, P) % P
+    else:
+        lam = (y2 - y1) * pow(x2 - x1, -1, P) % P
+    x3 = (lam * lam - x1 - x2) % P
+    return (x3, (lam * (x1 - x3) - y1) % P)
+
+
+def mul(k, point):
+    result = None
+    while k:
+        if k & 1:
+            result = add(result, point)
+        point = add(point, point)
+        k >>= 1
+    return result
+
+
+def limbs(value):
+    words = [f'0x{(value >> (32 * i)) & 0xFFFFFFFF:08x}' for i in range(8)]
+    return ', '.join(words[:4]) + ',\n      ' + ', '.join(words[4:])
+
+
+def main():
+    teeth = [mul(1 << (j * SPACING), (GX, GY)) for j in range(TEETH)]
+
+    print(f'static const p256_affine_t p256_comb[{1 << TEETH}] = {{')
+    print('    {{0}, {0}},')
+    for i in range(1, 1 << TEETH):
+        point = None
+        for j in range(TEETH):
+            if i >> j & 1:
+                point = add(point, teeth[j])
+        x, y = point
+        print(f'    {{{{{limbs(x)}}},\n     {{{limbs(y)}}}}},')
+    print('};')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+OpenFIDO Profile Report
+
+Reads the function cycle profile of an ENABLE_PROFILE build from a connected
+authenticator (vendor diagnostics command 0x43, needs python-fido2) and
+prints the functions ranked by exclusive time. Addresses are resolved with
+addr2line when the firmware ELF is given.
+"""
+
+import argparse
+import subprocess
+import sys
+
+CMD_VENDOR_TRACE = 0x43
+PROFILE_READ = 0x03
+PROFILE_CLEAR = 0x04
+
+
+def log(msg):
+    print(f"[OpenFIDO Profile] {msg}", file=sys.stderr)
+
+
+def error(msg):
+    print(f"[ERROR] {msg}", file=sys.stderr)
+    sys.exit(1)
+
+
+def open_device():
+    try:
+        from fido2.ctap2 import Ctap2
+        from fido2.hid import CtapHidDevice
+    except ImportError:
+        error("python-fido2 is required (pip install fido2)")
+
+    device = next(CtapHidDevice.list_devices(), None)
+    if device is None:
+        error("No FIDO device found")
+    return Ctap2(device)
+
+
+def read_profile(ctap):
+    """Page all used profile slots out of the authenticator."""
+    entries = []
+    cursor = 0
+
+    while True:
+        page = ctap.send_cbor(CMD_VENDOR_TRACE, {1: PROFILE_READ, 2: cursor})
+        for function, core, calls, inclusive, exclusive in page[2]:
+            entries.append({
+                'function': function,
+                'core': core,
+                'calls': calls,
+                'inclusive': inclusive,
+                'exclusive': exclusive,
+            })
+        cursor = page[3]
+        if cursor >= page[4]:
+            return page[1], page[5], entries
+
+
+def symbolize(entries, elf):
+    """Map function addresses to names with addr2line."""
+    # Clear the Thumb bit of Cortex-M function pointers
+    addresses = sorted({e['function'] & ~1 for e in entries})
+    names = {}
+
+    try:
+        result = subprocess.run(['addr2line', '-f', '-e', elf] + [hex(a) for a in addresses],
+                                check=True, capture_output=True, text=True)
+    except (OSError, subprocess.CalledProcessError):
+        log("addr2line failed; printing addresses")
+        return names
+
+    lines = result.stdout.splitlines()
+    for address, name in zip(addresses, lines[0::2]):
+        if name != '??':
+            names[address] = name
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description='OpenFIDO Function Profile Report')
+    parser.add_argument('--elf', help='Firmware ELF to resolve function names from')
+    parser.add_argument('--top', type=int, default=30, help='Number of functions to list')
+    parser.add_argument('--clear', action='store_true', help='Clear the profile after reading')
+
+    args = parser.parse_args()
+
+    ctap = open_device()
+    cycle_hz, dropped, entries = read_profile(ctap)
+    if args.clear:
+        ctap.send_cbor(CMD_VENDOR_TRACE, {1: PROFILE_CLEAR})
+
+    if not entries:
+        log("Profile is empty")
+        return
+
+    names = symbolize(entries, args.elf) if args.elf else {}
+    entries.sort(key=lambda e: e['exclusive'], reverse=True)
+    total = sum(e['exclusive'] for e in entries) or 1
+    per_us = cycle_hz / 1e6
+
+    print(f"{'function':<40} {'core':>4} {'calls':>9} {'incl us':>12} {'excl us':>12} {'excl %':>7}")
+    for e in entries[:args.top]:
+        address = e['function'] & ~1
+        name = names.get(address, f'0x{address:08x}')
+        print(f"{name:<40} {e['core']:>4} {e['calls']:>9} {e['inclusive'] / per_us:>12.1f} "
+              f"{e['exclusive'] / per_us:>12.1f} {100.0 * e['exclusive'] / total:>6.1f}%")
+
+    if dropped:
+        log(f"{dropped} calls were not recorded (table full or nesting too deep)")
+
+
+if __name__ == '__main__':
+    main()
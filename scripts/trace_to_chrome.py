@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+"""
+OpenFIDO Trace Converter
+
+Turns the span trace ring of a CONFIG_ENABLE_TRACE build into a Chrome trace
+(JSON trace event format), viewable in chrome://tracing or Perfetto.
+
+The events are either read from a connected authenticator with the vendor
+trace command (0x43, needs python-fido2) or from a raw dump file of 8-byte
+events as laid out in trace_event_t.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+# Must match trace_span_t in src/utils/trace.h
+SPAN_NAMES = [
+    'request',
+    'u2f',
+    'usb_receive',
+    'cbor_parse',
+    'storage_find',
+    'decrypt',
+    'keygen',
+    'sign',
+    'flash_write',
+    'flash_erase',
+    'encode',
+    'send',
+    'up_wait',
+]
+
+CTAP2_COMMANDS = {
+    0x01: 'makeCredential',
+    0x02: 'getAssertion',
+    0x04: 'getInfo',
+    0x06: 'clientPin',
+    0x07: 'reset',
+    0x08: 'getNextAssertion',
+    0x09: 'bioEnrollment',
+    0x0A: 'credentialManagement',
+    0x0B: 'selection',
+    0x0C: 'largeBlobs',
+    0x0D: 'config',
+    0x41: 'vendorProvision',
+    0x42: 'vendorBackup',
+    0x43: 'vendorTrace',
+}
+
+CTAPHID_COMMANDS = {
+    0x01: 'PING',
+    0x03: 'MSG',
+    0x06: 'INIT',
+    0x10: 'CBOR',
+    0x11: 'CANCEL',
+    0x3B: 'KEEPALIVE',
+    0x3F: 'ERROR',
+}
+
+U2F_INS = {
+    0x01: 'register',
+    0x02: 'authenticate',
+    0x03: 'version',
+}
+
+EVENT_FORMAT = '<IBBBB'
+EVENT_SIZE = struct.calcsize(EVENT_FORMAT)
+
+PHASE_BEGIN = 0
+PHASE_END = 1
+
+CMD_VENDOR_TRACE = 0x43
+TRACE_READ = 0x01
+TRACE_CLEAR = 0x02
+
+
+def log(msg):
+    print(f"[OpenFIDO Trace] {msg}", file=sys.stderr)
+
+
+def error(msg):
+    print(f"[ERROR] {msg}", file=sys.stderr)
+    sys.exit(1)
+
+
+def parse_events(raw):
+    """Split a raw dump into (timestamp_us, span, phase, core, arg) tuples."""
+    if len(raw) % EVENT_SIZE != 0:
+        error(f"Dump length {len(raw)} is not a multiple of {EVENT_SIZE}")
+    return [struct.unpack_from(EVENT_FORMAT, raw, i) for i in range(0, len(raw), EVENT_SIZE)]
+
+
+def open_device():
+    try:
+        from fido2.ctap2 import Ctap2
+        from fido2.hid import CtapHidDevice
+    except ImportError:
+        error("python-fido2 is required to read from a device (pip install fido2)")
+
+    device = next(CtapHidDevice.list_devices(), None)
+    if device is None:
+        error("No FIDO device found")
+    return Ctap2(device)
+
+
+def read_device(clear):
+    """Page the whole trace ring out of the authenticator."""
+    ctap = open_device()
+    raw = b''
+    cursor = 0
+    dropped = 0
+    target = None
+
+    while True:
+        page = ctap.send_cbor(CMD_VENDOR_TRACE, {1: TRACE_READ, 2: cursor})
+        if page[1] != cursor:
+            dropped += (page[1] - cursor) & 0xFFFFFFFF
+        raw += page[2]
+        cursor = page[3]
+        # Stop at the head seen by the first read; each read adds spans of its own
+        if target is None:
+            target = page[4]
+        if not page[2] or (target - cursor) & 0xFFFFFFFF >= 0x80000000 or cursor == target:
+            break
+
+    if dropped:
+        log(f"{dropped} events were overwritten before they could be read")
+    if clear:
+        ctap.send_cbor(CMD_VENDOR_TRACE, {1: TRACE_CLEAR})
+    return raw
+
+
+def span_args(span, arg):
+    name = SPAN_NAMES[span] if span < len(SPAN_NAMES) else f'span_{span}'
+    if name == 'request':
+        return {'cmd': CTAP2_COMMANDS.get(arg, f'0x{arg:02X}')}
+    if name in ('usb_receive', 'send'):
+        return {'cmd': CTAPHID_COMMANDS.get(arg, f'0x{arg:02X}')}
+    if name == 'u2f':
+        return {'ins': U2F_INS.get(arg, f'0x{arg:02X}')}
+    if name == 'keygen':
+        return {'pooled': bool(arg)}
+    if name == 'storage_find' and arg:
+        return {'ids': arg}
+    return {}
+
+
+def to_chrome(events):
+    """
+    Pair begin/end events per core into complete ("X") events.
+
+    A span whose end was skipped on an error path is closed at the last
+    event seen on its core before the enclosing span ended.
+    """
+    trace = []
+    stacks = {}
+    last_ts = {}
+    wrap = 0
+    prev = None
+
+    def close(core, entry, end_ts):
+        span, begin_ts, arg = entry
+        name = SPAN_NAMES[span] if span < len(SPAN_NAMES) else f'span_{span}'
+        trace.append({
+            'name': name,
+            'cat': 'openfido',
+            'ph': 'X',
+            'ts': begin_ts,
+            'dur': max(end_ts - begin_ts, 0),
+            'pid': 0,
+            'tid': core,
+            'args': span_args(span, arg),
+        })
+
+    for timestamp, span, phase, core, arg in events:
+        # Unwrap the 32-bit microsecond clock (wraps every ~71 minutes)
+        if prev is not None and timestamp < prev and prev - timestamp > 0x80000000:
+            wrap += 1 << 32
+        prev = timestamp
+        ts = timestamp + wrap
+
+        stack = stacks.setdefault(core, [])
+        if phase == PHASE_BEGIN:
+            # A second begin of an open span means its end was lost
+            if any(entry[0] == span for entry in stack):
+                while stack:
+                    entry = stack.pop()
+                    close(core, entry, last_ts.get(core, ts))
+                    if entry[0] == span:
+                        break
+            stack.append((span, ts, arg))
+        elif any(entry[0] == span for entry in stack):
+            while stack:
+                entry = stack.pop()
+                if entry[0] == span:
+                    close(core, entry, ts)
+                    break
+                close(core, entry, last_ts.get(core, ts))
+        last_ts[core] = ts
+
+    for core, stack in stacks.items():
+        while stack:
+            close(core, stack.pop(), last_ts[core])
+
+    for core in sorted(stacks):
+        trace.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': core,
+                      'args': {'name': f'core {core}'}})
+
+    return {'traceEvents': trace, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='OpenFIDO Trace to Chrome Trace Converter')
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--device', action='store_true', help='Read the trace from the first FIDO device')
+    source.add_argument('--input', help='Raw dump of 8-byte trace events')
+    parser.add_argument('--output', required=True, help='Chrome trace JSON file to write')
+    parser.add_argument('--save-raw', help='Also save the raw events read from the device')
+    parser.add_argument('--clear', action='store_true', help='Clear the device trace ring after reading')
+
+    args = parser.parse_args()
+
+    if args.device:
+        raw = read_device(args.clear)
+        if args.save_raw:
+            with open(args.save_raw, 'wb') as f:
+                f.write(raw)
+    else:
+        with open(args.input, 'rb') as f:
+            raw = f.read()
+
+    events = parse_events(raw)
+    chrome = to_chrome(events)
+
+    with open(args.output, 'w') as f:
+        json.dump(chrome, f)
+
+    log(f"{len(events)} events -> {args.output}")
+
+
+if __name__ == '__main__':
+    main()
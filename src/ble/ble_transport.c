@@ -13,9 +13,11 @@
 
 #include "../hal/hal.h"
 #include "../hal/hal_ble.h"
+#include "../transport/dispatch.h"
 #include "../transport/transport.h"
 #include "../utils/led_patterns.h"
 #include "../utils/logger.h"
+#include "../utils/resume_state.h"
 #include "ble_fido_service.h"
 #include "ble_fragment.h"
 
@@ -655,6 +657,37 @@ void ble_transport_update_power_state(void)
     update_connection_state();
 }
 
+uint32_t ble_transport_get_next_deadline_ms(void)
+{
+    if (!transport_state.initialized) {
+        return UINT32_MAX;
+    }
+
+    /* A request is in flight: service the link as soon as possible */
+    if (transport_state.state == BLE_TRANSPORT_STATE_PROCESSING) {
+        return 0;
+    }
+
+    uint64_t current_time = get_time_ms();
+
+    if (transport_state.connection.is_connected) {
+        uint64_t idle_time = current_time - transport_state.connection.last_activity_ms;
+        if (idle_time < BLE_IDLE_TIMEOUT_MS) {
+            return (uint32_t) (BLE_IDLE_TIMEOUT_MS - idle_time);
+        }
+        /* Stay well inside the supervision timeout */
+        return BLE_CONN_TIMEOUT_MS / 4;
+    }
+
+    if (transport_state.state == BLE_TRANSPORT_STATE_ADVERTISING &&
+        !transport_state.low_power_mode) {
+        uint64_t idle_time = current_time - transport_state.last_global_activity_ms;
+        return (idle_time < BLE_IDLE_TIMEOUT_MS) ? (uint32_t) (BLE_IDLE_TIMEOUT_MS - idle_time) : 0;
+    }
+
+    return UINT32_MAX;
+}
+
 int ble_transport_enter_deep_sleep(void)
 {
     if (!transport_state.initialized) {
@@ -673,11 +706,22 @@ int ble_transport_enter_deep_sleep(void)
     LOG_INFO("Entering deep sleep mode (idle_time=%llu ms)",
              get_time_ms() - transport_state.last_global_activity_ms);
 
+    /*
+     * Keep warm session state so the first request after wake is fast. The
+     * crypto core owns that state, so it is parked while the snapshot is taken.
+     */
+    dispatch_park();
+    int ret = resume_state_save();
+    dispatch_unpark();
+    if (ret != RESUME_STATE_OK) {
+        LOG_WARN("Deep sleep snapshot not saved - next wake will be a cold resume");
+    }
+
     /* Stop advertising before deep sleep */
     hal_ble_stop_advertising();
 
     /* Enter deep sleep via HAL */
-    int ret = hal_ble_enter_deep_sleep();
+    ret = hal_ble_enter_deep_sleep();
     if (ret != HAL_BLE_OK) {
         LOG_ERROR("Failed to enter deep sleep: %s (code=%d) - restarting advertising",
                   hal_ble_error_to_string(ret), ret);
@@ -718,6 +762,14 @@ int ble_transport_wake_from_deep_sleep(void)
         return BLE_TRANSPORT_ERROR;
     }
 
+    /* Reinstall warm state; a stale or missing snapshot just means a cold resume */
+    dispatch_park();
+    ret = resume_state_restore();
+    dispatch_unpark();
+    if (ret != RESUME_STATE_OK) {
+        LOG_DEBUG("No valid deep sleep snapshot, resuming cold");
+    }
+
     /* Update activity timestamp */
     update_global_activity_timestamp();
 
@@ -734,6 +786,32 @@ int ble_transport_wake_from_deep_sleep(void)
     return BLE_TRANSPORT_OK;
 }
 
+void ble_transport_save_resume_state(ble_transport_resume_state_t *state)
+{
+    if (state == NULL) {
+        return;
+    }
+
+    uint64_t now = get_time_ms();
+    uint64_t block_until = transport_state.connection.pairing_block_until_ms;
+
+    state->pairing_attempts = transport_state.connection.pairing_attempts;
+    state->pairing_block_remaining_ms = (block_until > now) ? (uint32_t) (block_until - now) : 0;
+}
+
+void ble_transport_restore_resume_state(const ble_transport_resume_state_t *state)
+{
+    if (state == NULL) {
+        return;
+    }
+
+    /* A pairing lockout must survive the sleep, otherwise sleeping resets it */
+    transport_state.connection.pairing_attempts = state->pairing_attempts;
+    transport_state.connection.pairing_block_until_ms =
+        (state->pairing_block_remaining_ms > 0) ? get_time_ms() + state->pairing_block_remaining_ms
+                                                : 0;
+}
+
 /* ========== Helper Functions ========== */
 
 /**
@@ -33,6 +33,14 @@ typedef enum {
     BLE_TRANSPORT_STATE_PROCESSING   /**< Processing CTAP request */
 } ble_transport_state_t;
 
+/**
+ * @brief Link security state kept across deep sleep
+ */
+typedef struct {
+    uint8_t pairing_attempts;            /**< Failed pairing attempts so far */
+    uint32_t pairing_block_remaining_ms; /**< Time left on a pairing lockout */
+} ble_transport_resume_state_t;
+
 /* ========== CTAP Callbacks ========== */
 
 /**
@@ -200,10 +208,21 @@ bool ble_transport_should_enter_deep_sleep(void);
  */
 void ble_transport_update_power_state(void);
 
+/**
+ * @brief Get time until the transport next needs main-loop service
+ *
+ * Used to size idle-time background work so it never delays connection
+ * parameter updates or low-power transitions.
+ *
+ * @return Milliseconds until the next deadline, or UINT32_MAX if none
+ */
+uint32_t ble_transport_get_next_deadline_ms(void);
+
 /**
  * @brief Enter deep sleep mode
  *
- * Puts the BLE transport into deep sleep mode to conserve power.
+ * Saves a warm-state snapshot to retention memory, then puts the BLE
+ * transport into deep sleep mode to conserve power.
  * The device can be woken by button press or BLE connection request.
  *
  * @return 0 on success, negative error code otherwise
@@ -213,12 +232,27 @@ int ble_transport_enter_deep_sleep(void);
 /**
  * @brief Wake from deep sleep mode
  *
- * Wakes the BLE transport from deep sleep mode and resumes advertising.
+ * Wakes the BLE transport from deep sleep mode, restores the warm-state
+ * snapshot taken on entry (if still valid) and resumes advertising.
  *
  * @return 0 on success, negative error code otherwise
  */
 int ble_transport_wake_from_deep_sleep(void);
 
+/**
+ * @brief Capture link security state for the deep-sleep snapshot
+ *
+ * @param state Output state
+ */
+void ble_transport_save_resume_state(ble_transport_resume_state_t *state);
+
+/**
+ * @brief Reinstall link security state after deep sleep
+ *
+ * @param state State captured by ble_transport_save_resume_state()
+ */
+void ble_transport_restore_resume_state(const ble_transport_resume_state_t *state);
+
 /* ========== Transport Abstraction Integration ========== */
 
 /**
@@ -0,0 +1,55 @@
+/**
+ * @file module_state.h
+ * @brief Module State Storage Class
+ *
+ * Firmware modules keep their state in file-scope statics. On the device
+ * there is one authenticator, so the macros below expand to nothing. In the
+ * host library (OPENFIDO_HOST) every such variable is thread-local and is
+ * registered in the "openfido_state" section, so that libopenfido can swap
+ * the complete state of one authenticator context in and out of a thread.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef MODULE_STATE_H
+#define MODULE_STATE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef OPENFIDO_HOST
+
+/**
+ * @brief Registered module state variable
+ */
+typedef struct {
+    void *(*address)(void); /**< Address of the calling thread's instance */
+    size_t size;            /**< Size of the variable */
+} module_state_desc_t;
+
+#define OPENFIDO_STATE _Thread_local
+
+#define OPENFIDO_STATE_REGISTER(var)                                                       \
+    static void *var##_state_address(void)                                                 \
+    {                                                                                      \
+        return (void *) &var;                                                              \
+    }                                                                                      \
+    static const module_state_desc_t var##_state_desc                                      \
+        __attribute__((used, section("openfido_state"))) = {var##_state_address, sizeof(var)}
+
+#else
+
+#define OPENFIDO_STATE
+#define OPENFIDO_STATE_REGISTER(var) _Static_assert(1, #var)
+
+#endif /* OPENFIDO_HOST */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODULE_STATE_H */
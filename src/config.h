@@ -43,6 +43,59 @@
 /** Activity indicator duration in milliseconds */
 #define CONFIG_LED_ACTIVITY_MS 50
 
+/* ==========================================================================
+ *  Scheduling Configuration
+ * ========================================================================== */
+
+/**
+ * Main loop idle window in milliseconds. Background maintenance runs in this
+ * window between transport polls; it must stay well below the watchdog period.
+ */
+#define CONFIG_IDLE_WINDOW_MS 10
+
+/** Time allowed for a user-presence touch in milliseconds */
+#define CONFIG_UP_TIMEOUT_MS 30000
+
+/** CTAPHID keepalive interval while a request is pending (spec: <= 100 ms) */
+#define CONFIG_KEEPALIVE_INTERVAL_MS 100
+
+/**
+ * Run CTAP2 and U2F requests, crypto and storage on the second core where
+ * the part has one, leaving the first core to the transports.
+ * 1 = Use the second core if present, 0 = Single core
+ */
+#define CONFIG_DUAL_CORE 1
+
+/* ==========================================================================
+ *  Diagnostics Configuration
+ * ========================================================================== */
+
+/**
+ * Record request spans (receive, parse, lookup, crypto, flash, send) in a RAM
+ * ring readable with the vendor trace command. Adds a timer read per span.
+ * 1 = Enabled, 0 = Disabled
+ */
+#ifndef CONFIG_ENABLE_TRACE
+#define CONFIG_ENABLE_TRACE 0
+#endif
+
+/** Trace ring size in events (power of two, 8 bytes each) */
+#define CONFIG_TRACE_EVENTS 512
+
+/**
+ * Charge the cycles of every function in the crypto, storage, CBOR, CTAP2
+ * command and BLE fragmentation modules to a per-function table. Set by the
+ * ENABLE_PROFILE build option, which also adds -finstrument-functions to
+ * those modules.
+ * 1 = Enabled, 0 = Disabled
+ */
+#ifndef CONFIG_ENABLE_PROFILE
+#define CONFIG_ENABLE_PROFILE 0
+#endif
+
+/** Profiled functions per core (power of two, 24 bytes each) */
+#define CONFIG_PROFILE_FUNCTIONS 128
+
 /* ==========================================================================
  *  Security Configuration
  * ========================================================================== */
@@ -64,6 +117,16 @@
  */
 #define CONFIG_SEC_MIN_PIN_LENGTH 4
 
+/**
+ * Maximum lifetime of a pinUvAuthToken after it is issued (ms).
+ */
+#define CONFIG_SEC_PIN_TOKEN_TIMEOUT_MS 600000
+
+/**
+ * pinUvAuthToken usage timer: the token expires when unused for this long (ms).
+ */
+#define CONFIG_SEC_PIN_TOKEN_IDLE_MS 30000
+
 /* ==========================================================================
  *  Protocol Feature Flags
  * ========================================================================== */
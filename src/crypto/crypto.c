@@ -2,7 +2,9 @@
  * @file crypto.c
  * @brief Cryptographic Operations Implementation
  *
- * Uses mbedTLS for cryptographic primitives
+ * Uses mbedTLS for cryptographic primitives; SHA-256 and HMAC run on the
+ * dedicated kernel in sha256.c and P-256 on the constant-time backend in
+ * p256.c
  *
  * @copyright Copyright (c) 2025 OpenFIDO Contributors
  * @license MIT License
@@ -12,31 +14,138 @@
 
 #include "buffer.h"
 #include "hal.h"
+#include "idle_scheduler.h"
 #include "logger.h"
+#include "module_state.h"
+#include "p256.h"
+#include "sha256.h"
+#include "trace.h"
 
 #ifdef USE_MBEDTLS
+#include "mbedtls/aes.h"
 #include "mbedtls/ctr_drbg.h"
-#include "mbedtls/ecdh.h"
-#include "mbedtls/ecdsa.h"
 #include "mbedtls/ecp.h"
 #include "mbedtls/entropy.h"
 #include "mbedtls/gcm.h"
-#include "mbedtls/hkdf.h"
 #include "mbedtls/md.h"
 #include "mbedtls/pk.h"
-#include "mbedtls/sha256.h"
 #endif
 
 #include <string.h>
 
+/* DRBG reseed interval for the idle-time reseed task */
+#define CRYPTO_RESEED_PERIOD_MS (10 * 60 * 1000)
+
+/* Pre-generated P-256 key pair */
+typedef struct {
+    uint8_t private_key[CRYPTO_P256_PRIVATE_KEY_SIZE];
+    uint8_t public_key[CRYPTO_P256_PUBLIC_KEY_SIZE];
+} crypto_pooled_keypair_t;
+
 /* Global crypto context */
-static struct {
+static OPENFIDO_STATE struct {
     bool initialized;
 #ifdef USE_MBEDTLS
     mbedtls_entropy_context entropy;
     mbedtls_ctr_drbg_context ctr_drbg;
 #endif
-} crypto_ctx = {0};
+    crypto_pooled_keypair_t key_pool[CRYPTO_KEY_POOL_SIZE];
+    size_t key_pool_count;
+    p256_keygen_t keygen; /* Next pool key, generated in bounded steps */
+    bool keygen_active;
+    int key_pool_task;
+    int reseed_task;
+    bool idle_tasks_registered;
+} crypto_ctx = {.key_pool_task = -1, .reseed_task = -1};
+OPENFIDO_STATE_REGISTER(crypto_ctx);
+
+static int ecdsa_generate_keypair_now(uint8_t *private_key, uint8_t *public_key);
+static int p256_random_source(uint8_t *buffer, size_t len);
+
+/**
+ * @brief Idle task: top up the P-256 key pool a slice of a key at a time
+ *
+ * A whole key generation does not fit in a short idle window, so each step
+ * runs one bounded p256_keygen_step().
+ */
+static idle_task_status_t key_pool_refill_step(void *context)
+{
+    (void) context;
+
+    if (crypto_ctx.key_pool_count >= CRYPTO_KEY_POOL_SIZE) {
+        return IDLE_TASK_DONE;
+    }
+
+    if (!crypto_ctx.keygen_active) {
+        if (p256_keygen_start(&crypto_ctx.keygen, p256_random_source) != P256_OK) {
+            return IDLE_TASK_DONE;
+        }
+        crypto_ctx.keygen_active = true;
+    }
+
+    crypto_pooled_keypair_t *slot = &crypto_ctx.key_pool[crypto_ctx.key_pool_count];
+    int ret = p256_keygen_step(&crypto_ctx.keygen, slot->private_key, slot->public_key);
+    if (ret == P256_CONTINUE) {
+        return IDLE_TASK_MORE;
+    }
+
+    crypto_ctx.keygen_active = false;
+    if (ret != P256_OK) {
+        crypto_secure_zero(slot, sizeof(*slot));
+        return IDLE_TASK_DONE;
+    }
+    crypto_ctx.key_pool_count++;
+
+    return (crypto_ctx.key_pool_count < CRYPTO_KEY_POOL_SIZE) ? IDLE_TASK_MORE : IDLE_TASK_DONE;
+}
+
+#ifdef USE_MBEDTLS
+/**
+ * @brief Idle task: reseed the DRBG from the entropy source
+ */
+static idle_task_status_t drbg_reseed_step(void *context)
+{
+    (void) context;
+
+    int ret = mbedtls_ctr_drbg_reseed(&crypto_ctx.ctr_drbg, NULL, 0);
+    if (ret != 0) {
+        LOG_WARN("DRBG reseed failed: %d", ret);
+    }
+
+    return IDLE_TASK_DONE;
+}
+#endif
+
+/**
+ * @brief Register crypto background tasks with the idle scheduler
+ */
+static void crypto_register_idle_tasks(void)
+{
+    if (crypto_ctx.idle_tasks_registered) {
+        return;
+    }
+    crypto_ctx.idle_tasks_registered = true;
+
+    idle_task_config_t key_pool_task = {.name = "p256-keypool",
+                                        .step = key_pool_refill_step,
+                                        .context = NULL,
+                                        .priority = IDLE_PRIORITY_NORMAL,
+                                        .budget_ms = 5,
+                                        .period_ms = 0};
+
+    crypto_ctx.key_pool_task = idle_sched_register(&key_pool_task);
+
+#ifdef USE_MBEDTLS
+    idle_task_config_t reseed_task = {.name = "drbg-reseed",
+                                      .step = drbg_reseed_step,
+                                      .context = NULL,
+                                      .priority = IDLE_PRIORITY_LOW,
+                                      .budget_ms = 5,
+                                      .period_ms = CRYPTO_RESEED_PERIOD_MS};
+
+    crypto_ctx.reseed_task = idle_sched_register(&reseed_task);
+#endif
+}
 
 int crypto_init(void)
 {
@@ -55,7 +164,15 @@ int crypto_init(void)
     }
 #endif
 
+    sha256_backend_t backend = sha256_select_backend();
+    LOG_INFO("SHA-256 backend: %s", sha256_backend_name(backend));
+
     crypto_ctx.initialized = true;
+    crypto_ctx.key_pool_count = 0;
+    crypto_ctx.keygen_active = false;
+    crypto_register_idle_tasks();
+    idle_sched_trigger(crypto_ctx.key_pool_task);
+
     LOG_INFO("Cryptographic library initialized");
     return CRYPTO_OK;
 }
@@ -66,6 +183,10 @@ int crypto_deinit(void)
     mbedtls_ctr_drbg_free(&crypto_ctx.ctr_drbg);
     mbedtls_entropy_free(&crypto_ctx.entropy);
 #endif
+    crypto_secure_zero(crypto_ctx.key_pool, sizeof(crypto_ctx.key_pool));
+    crypto_secure_zero(&crypto_ctx.keygen, sizeof(crypto_ctx.keygen));
+    crypto_ctx.key_pool_count = 0;
+    crypto_ctx.keygen_active = false;
     crypto_ctx.initialized = false;
     return CRYPTO_OK;
 }
@@ -76,169 +197,197 @@ int crypto_sha256(const uint8_t *data, size_t data_len, uint8_t *hash)
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-#ifdef USE_MBEDTLS
-    int ret = mbedtls_sha256(data, data_len, hash, 0);
-    if (ret != 0) {
-        LOG_ERROR("SHA-256 failed: %d", ret);
-        return CRYPTO_ERROR;
-    }
-#else
-    /* Fallback: use HAL if available */
-    if (hal_crypto_is_available()) {
-        return (hal_crypto_sha256(data, data_len, hash) == HAL_OK) ? CRYPTO_OK : CRYPTO_ERROR;
+    sha256(data, data_len, hash);
+    return CRYPTO_OK;
+}
+
+int crypto_sha256_start(crypto_sha256_ctx_t *ctx)
+{
+    if (!crypto_ctx.initialized || ctx == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
     }
-    return CRYPTO_ERROR;
-#endif
 
+    sha256_init(&ctx->sha);
+    ctx->active = true;
     return CRYPTO_OK;
 }
 
-int crypto_hmac_sha256(const uint8_t *key, size_t key_len, const uint8_t *data, size_t data_len,
-                       uint8_t *hmac)
+int crypto_sha256_update(crypto_sha256_ctx_t *ctx, const uint8_t *data, size_t data_len)
 {
-    if (!crypto_ctx.initialized || key == NULL || data == NULL || hmac == NULL) {
+    if (ctx == NULL || !ctx->active || (data == NULL && data_len > 0)) {
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-#ifdef USE_MBEDTLS
-    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-    int ret = mbedtls_md_hmac(md_info, key, key_len, data, data_len, hmac);
-    if (ret != 0) {
-        LOG_ERROR("HMAC-SHA256 failed: %d", ret);
-        return CRYPTO_ERROR;
+    sha256_update(&ctx->sha, data, data_len);
+    return CRYPTO_OK;
+}
+
+int crypto_sha256_finish(crypto_sha256_ctx_t *ctx, uint8_t *hash)
+{
+    if (ctx == NULL || !ctx->active || hash == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
     }
-#else
-    return CRYPTO_ERROR;
-#endif
 
+    sha256_final(&ctx->sha, hash);
+    crypto_sha256_free(ctx);
     return CRYPTO_OK;
 }
 
-int crypto_ecdsa_generate_keypair(uint8_t *private_key, uint8_t *public_key)
+void crypto_sha256_free(crypto_sha256_ctx_t *ctx)
 {
-    if (!crypto_ctx.initialized || private_key == NULL || public_key == NULL) {
-        return CRYPTO_ERROR_INVALID_PARAM;
+    if (ctx == NULL) {
+        return;
     }
 
-#ifdef USE_MBEDTLS
-    mbedtls_ecp_group grp;
-    mbedtls_mpi d;
-    mbedtls_ecp_point Q;
+    crypto_secure_zero(ctx, sizeof(*ctx));
+}
 
-    mbedtls_ecp_group_init(&grp);
-    mbedtls_mpi_init(&d);
-    mbedtls_ecp_point_init(&Q);
+int crypto_hmac_sha256(const uint8_t *key, size_t key_len, const uint8_t *data, size_t data_len,
+                       uint8_t *hmac)
+{
+    if (!crypto_ctx.initialized || key == NULL || data == NULL || hmac == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
 
-    /* Load P-256 curve */
-    int ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
-    if (ret != 0) {
-        LOG_ERROR("Failed to load P-256 curve: %d", ret);
-        goto cleanup;
+    crypto_hmac_ctx_t ctx;
+    int ret = crypto_hmac_ctx_init(&ctx, key, key_len);
+    if (ret == CRYPTO_OK) {
+        ret = crypto_hmac_ctx_compute(&ctx, data, data_len, hmac);
     }
 
-    /* Generate keypair */
-    ret = mbedtls_ecdsa_genkey(&grp, &d, &Q, mbedtls_ctr_drbg_random, &crypto_ctx.ctr_drbg);
-    if (ret != 0) {
-        LOG_ERROR("ECDSA key generation failed: %d", ret);
-        goto cleanup;
+    crypto_hmac_ctx_free(&ctx);
+    return ret;
+}
+
+int crypto_hmac_ctx_init(crypto_hmac_ctx_t *ctx, const uint8_t *key, size_t key_len)
+{
+    if (!crypto_ctx.initialized || ctx == NULL || key == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-    /* Export private key */
-    ret = mbedtls_mpi_write_binary(&d, private_key, 32);
-    if (ret != 0) {
-        LOG_ERROR("Failed to export private key: %d", ret);
-        goto cleanup;
+    uint8_t block[CRYPTO_SHA256_BLOCK_SIZE] = {0};
+    uint8_t pad[CRYPTO_SHA256_BLOCK_SIZE];
+
+    /* Keys longer than a block are hashed first */
+    if (key_len > sizeof(block)) {
+        sha256(key, key_len, block);
+    } else {
+        memcpy(block, key, key_len);
     }
 
-    /* Export public key (uncompressed format: X || Y) */
-    ret = mbedtls_mpi_write_binary(&Q.X, &public_key[0], 32);
-    if (ret != 0) {
-        LOG_ERROR("Failed to export public key X: %d", ret);
-        goto cleanup;
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] = block[i] ^ 0x36;
     }
+    sha256_init(&ctx->inner);
+    sha256_update(&ctx->inner, pad, sizeof(pad));
 
-    ret = mbedtls_mpi_write_binary(&Q.Y, &public_key[32], 32);
-    if (ret != 0) {
-        LOG_ERROR("Failed to export public key Y: %d", ret);
-        goto cleanup;
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] = block[i] ^ 0x5c;
     }
+    sha256_init(&ctx->outer);
+    sha256_update(&ctx->outer, pad, sizeof(pad));
 
-cleanup:
-    mbedtls_ecp_group_free(&grp);
-    mbedtls_mpi_free(&d);
-    mbedtls_ecp_point_free(&Q);
+    crypto_secure_zero(block, sizeof(block));
+    crypto_secure_zero(pad, sizeof(pad));
 
-    return (ret == 0) ? CRYPTO_OK : CRYPTO_ERROR;
-#else
-    return CRYPTO_ERROR;
-#endif
+    ctx->ready = true;
+    return CRYPTO_OK;
 }
 
-int crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8_t *signature)
+int crypto_hmac_ctx_compute(const crypto_hmac_ctx_t *ctx, const uint8_t *data, size_t data_len,
+                            uint8_t *hmac)
 {
-    if (!crypto_ctx.initialized || private_key == NULL || hash == NULL || signature == NULL) {
+    if (ctx == NULL || !ctx->ready || (data == NULL && data_len > 0) || hmac == NULL) {
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-#ifdef USE_MBEDTLS
-    mbedtls_ecp_group grp;
-    mbedtls_mpi d, r, s;
+    /* Fork the cached key states; sha256_final() wipes the copy */
+    sha256_ctx_t sha = ctx->inner;
+    uint8_t inner_hash[CRYPTO_SHA256_DIGEST_SIZE];
 
-    mbedtls_ecp_group_init(&grp);
-    mbedtls_mpi_init(&d);
-    mbedtls_mpi_init(&r);
-    mbedtls_mpi_init(&s);
+    sha256_update(&sha, data, data_len);
+    sha256_final(&sha, inner_hash);
 
-    /* Load P-256 curve */
-    int ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
-    if (ret != 0) {
-        LOG_ERROR("Failed to load P-256 curve: %d", ret);
-        goto cleanup;
+    sha = ctx->outer;
+    sha256_update(&sha, inner_hash, sizeof(inner_hash));
+    sha256_final(&sha, hmac);
+
+    crypto_secure_zero(inner_hash, sizeof(inner_hash));
+    return CRYPTO_OK;
+}
+
+void crypto_hmac_ctx_free(crypto_hmac_ctx_t *ctx)
+{
+    if (ctx == NULL) {
+        return;
     }
 
-    /* Load private key */
-    ret = mbedtls_mpi_read_binary(&d, private_key, 32);
-    if (ret != 0) {
-        LOG_ERROR("Failed to load private key: %d", ret);
-        goto cleanup;
+    crypto_secure_zero(ctx, sizeof(*ctx));
+}
+
+int crypto_ecdsa_generate_keypair(uint8_t *private_key, uint8_t *public_key)
+{
+    if (!crypto_ctx.initialized || private_key == NULL || public_key == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-    /* Sign */
-    ret = mbedtls_ecdsa_sign(&grp, &r, &s, &d, hash, 32, mbedtls_ctr_drbg_random,
-                             &crypto_ctx.ctr_drbg);
-    if (ret != 0) {
-        LOG_ERROR("ECDSA signing failed: %d", ret);
-        goto cleanup;
+    /* Serve from the idle-time pool when possible */
+    if (crypto_ctx.key_pool_count > 0) {
+        TRACE_BEGIN(TRACE_SPAN_KEYGEN, 1);
+        crypto_pooled_keypair_t *slot = &crypto_ctx.key_pool[--crypto_ctx.key_pool_count];
+        memcpy(private_key, slot->private_key, CRYPTO_P256_PRIVATE_KEY_SIZE);
+        memcpy(public_key, slot->public_key, CRYPTO_P256_PUBLIC_KEY_SIZE);
+        crypto_secure_zero(slot, sizeof(*slot));
+        TRACE_END(TRACE_SPAN_KEYGEN);
+        idle_sched_trigger(crypto_ctx.key_pool_task);
+        return CRYPTO_OK;
     }
 
-    /* Export signature (r || s) */
-    ret = mbedtls_mpi_write_binary(&r, &signature[0], 32);
-    if (ret != 0) {
-        LOG_ERROR("Failed to export r: %d", ret);
-        goto cleanup;
+    TRACE_BEGIN(TRACE_SPAN_KEYGEN, 0);
+    int ret = ecdsa_generate_keypair_now(private_key, public_key);
+    TRACE_END(TRACE_SPAN_KEYGEN);
+    idle_sched_trigger(crypto_ctx.key_pool_task);
+    return ret;
+}
+
+/**
+ * @brief Random source for the P-256 backend
+ */
+static int p256_random_source(uint8_t *buffer, size_t len)
+{
+    return (crypto_random_generate(buffer, len) == CRYPTO_OK) ? 0 : -1;
+}
+
+/**
+ * @brief Generate a P-256 key pair synchronously
+ */
+static int ecdsa_generate_keypair_now(uint8_t *private_key, uint8_t *public_key)
+{
+    int ret = p256_generate_keypair(p256_random_source, private_key, public_key);
+    if (ret != P256_OK) {
+        LOG_ERROR("ECDSA key generation failed: %d", ret);
+        return CRYPTO_ERROR;
     }
 
-    ret = mbedtls_mpi_write_binary(&s, &signature[32], 32);
-    if (ret != 0) {
-        LOG_ERROR("Failed to export s: %d", ret);
-        goto cleanup;
+    return CRYPTO_OK;
+}
+
+int crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8_t *signature)
+{
+    if (!crypto_ctx.initialized || private_key == NULL || hash == NULL || signature == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-cleanup:
-    mbedtls_ecp_group_free(&grp);
-    mbedtls_mpi_free(&d);
-    mbedtls_mpi_free(&r);
-    mbedtls_mpi_free(&s);
+    TRACE_BEGIN(TRACE_SPAN_SIGN, 0);
+    int ret = p256_ecdsa_sign(private_key, hash, p256_random_source, signature);
+    TRACE_END(TRACE_SPAN_SIGN);
 
-    return (ret == 0) ? CRYPTO_OK : CRYPTO_ERROR;
-#else
-    /* Try hardware acceleration */
-    if (hal_crypto_is_available()) {
-        return (hal_crypto_ecdsa_sign(private_key, hash, signature) == HAL_OK) ? CRYPTO_OK
-                                                                               : CRYPTO_ERROR;
+    if (ret != P256_OK) {
+        LOG_ERROR("ECDSA signing failed: %d", ret);
+        return CRYPTO_ERROR;
     }
-    return CRYPTO_ERROR;
-#endif
+
+    return CRYPTO_OK;
 }
 
 int crypto_ecdsa_verify(const uint8_t *public_key, const uint8_t *hash, const uint8_t *signature)
@@ -247,168 +396,232 @@ int crypto_ecdsa_verify(const uint8_t *public_key, const uint8_t *hash, const ui
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-#ifdef USE_MBEDTLS
-    mbedtls_ecp_group grp;
-    mbedtls_ecp_point Q;
-    mbedtls_mpi r, s;
+    return (p256_ecdsa_verify(public_key, hash, signature) == P256_OK) ? CRYPTO_OK : CRYPTO_ERROR;
+}
 
-    mbedtls_ecp_group_init(&grp);
-    mbedtls_ecp_point_init(&Q);
-    mbedtls_mpi_init(&r);
-    mbedtls_mpi_init(&s);
+int crypto_ecdsa_get_public_key(const uint8_t *private_key, uint8_t *public_key)
+{
+    if (!crypto_ctx.initialized || private_key == NULL || public_key == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
 
-    /* Load P-256 curve */
-    int ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
-    if (ret != 0)
-        goto cleanup;
+    return (p256_public_key(private_key, public_key) == P256_OK) ? CRYPTO_OK : CRYPTO_ERROR;
+}
 
-    /* Load public key */
-    ret = mbedtls_mpi_read_binary(&Q.X, &public_key[0], 32);
-    if (ret != 0)
-        goto cleanup;
+int crypto_ecdsa_key_init(crypto_ecdsa_key_t *key, const uint8_t *private_key)
+{
+    if (!crypto_ctx.initialized || key == NULL || private_key == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
 
-    ret = mbedtls_mpi_read_binary(&Q.Y, &public_key[32], 32);
-    if (ret != 0)
-        goto cleanup;
+    memset(key, 0, sizeof(*key));
 
-    ret = mbedtls_mpi_lset(&Q.Z, 1);
-    if (ret != 0)
-        goto cleanup;
+    if (p256_check_private_key(private_key) != P256_OK) {
+        LOG_ERROR("Failed to load signing key: out of range");
+        return CRYPTO_ERROR;
+    }
 
-    /* Load signature */
-    ret = mbedtls_mpi_read_binary(&r, &signature[0], 32);
-    if (ret != 0)
-        goto cleanup;
+    memcpy(key->private_key, private_key, sizeof(key->private_key));
+    key->ready = true;
+    return CRYPTO_OK;
+}
 
-    ret = mbedtls_mpi_read_binary(&s, &signature[32], 32);
-    if (ret != 0)
-        goto cleanup;
+int crypto_ecdsa_key_sign(crypto_ecdsa_key_t *key, const uint8_t *hash, uint8_t *signature)
+{
+    if (!crypto_ctx.initialized || key == NULL || !key->ready || hash == NULL ||
+        signature == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
 
-    /* Verify */
-    ret = mbedtls_ecdsa_verify(&grp, hash, 32, &Q, &r, &s);
+    return crypto_ecdsa_sign(key->private_key, hash, signature);
+}
 
-cleanup:
-    mbedtls_ecp_group_free(&grp);
-    mbedtls_ecp_point_free(&Q);
-    mbedtls_mpi_free(&r);
-    mbedtls_mpi_free(&s);
+void crypto_ecdsa_key_free(crypto_ecdsa_key_t *key)
+{
+    if (key == NULL) {
+        return;
+    }
 
-    return (ret == 0) ? CRYPTO_OK : CRYPTO_ERROR;
-#else
-    return CRYPTO_ERROR;
-#endif
+    crypto_secure_zero(key, sizeof(*key));
 }
 
-int crypto_ecdsa_get_public_key(const uint8_t *private_key, uint8_t *public_key)
+int crypto_aes_gcm_encrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *aad,
+                           size_t aad_len, const uint8_t *plaintext, size_t plaintext_len,
+                           uint8_t *ciphertext, uint8_t *tag)
 {
-    if (!crypto_ctx.initialized || private_key == NULL || public_key == NULL) {
+    if (!crypto_ctx.initialized || key == NULL) {
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-#ifdef USE_MBEDTLS
-    mbedtls_ecp_group grp;
-    mbedtls_mpi d;
-    mbedtls_ecp_point Q;
+    crypto_aes_gcm_ctx_t ctx;
+    int ret = crypto_aes_gcm_ctx_init(&ctx, key);
+    if (ret == CRYPTO_OK) {
+        ret = crypto_aes_gcm_ctx_encrypt(&ctx, iv, aad, aad_len, plaintext, plaintext_len,
+                                         ciphertext, tag);
+    }
 
-    mbedtls_ecp_group_init(&grp);
-    mbedtls_mpi_init(&d);
-    mbedtls_ecp_point_init(&Q);
+    crypto_aes_gcm_ctx_free(&ctx);
+    return ret;
+}
 
-    int ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
-    if (ret != 0)
-        goto cleanup;
+int crypto_aes_gcm_decrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *aad,
+                           size_t aad_len, const uint8_t *ciphertext, size_t ciphertext_len,
+                           const uint8_t *tag, uint8_t *plaintext)
+{
+    if (!crypto_ctx.initialized || key == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
 
-    ret = mbedtls_mpi_read_binary(&d, private_key, 32);
-    if (ret != 0)
-        goto cleanup;
+    crypto_aes_gcm_ctx_t ctx;
+    int ret = crypto_aes_gcm_ctx_init(&ctx, key);
+    if (ret == CRYPTO_OK) {
+        ret = crypto_aes_gcm_ctx_decrypt(&ctx, iv, aad, aad_len, ciphertext, ciphertext_len, tag,
+                                         plaintext);
+    }
 
-    ret = mbedtls_ecp_mul(&grp, &Q, &d, &grp.G, mbedtls_ctr_drbg_random, &crypto_ctx.ctr_drbg);
-    if (ret != 0)
-        goto cleanup;
+    crypto_aes_gcm_ctx_free(&ctx);
+    return ret;
+}
 
-    ret = mbedtls_mpi_write_binary(&Q.X, &public_key[0], 32);
-    if (ret != 0)
-        goto cleanup;
+int crypto_aes_gcm_ctx_init(crypto_aes_gcm_ctx_t *ctx, const uint8_t *key)
+{
+    if (ctx == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
 
-    ret = mbedtls_mpi_write_binary(&Q.Y, &public_key[32], 32);
+    memset(ctx, 0, sizeof(*ctx));
 
-cleanup:
-    mbedtls_ecp_group_free(&grp);
-    mbedtls_mpi_free(&d);
-    mbedtls_ecp_point_free(&Q);
+    if (!crypto_ctx.initialized || key == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
 
-    return (ret == 0) ? CRYPTO_OK : CRYPTO_ERROR;
+#ifdef USE_MBEDTLS
+    mbedtls_gcm_init(&ctx->gcm);
+
+    int ret = mbedtls_gcm_setkey(&ctx->gcm, MBEDTLS_CIPHER_ID_AES, key, 256);
+    if (ret != 0) {
+        LOG_ERROR("GCM setkey failed: %d", ret);
+        mbedtls_gcm_free(&ctx->gcm);
+        return CRYPTO_ERROR;
+    }
 #else
-    return CRYPTO_ERROR;
+    memcpy(ctx->key, key, sizeof(ctx->key));
 #endif
+
+    ctx->ready = true;
+    return CRYPTO_OK;
 }
 
-int crypto_aes_gcm_encrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *aad,
-                           size_t aad_len, const uint8_t *plaintext, size_t plaintext_len,
-                           uint8_t *ciphertext, uint8_t *tag)
+int crypto_aes_gcm_ctx_encrypt(crypto_aes_gcm_ctx_t *ctx, const uint8_t *iv, const uint8_t *aad,
+                               size_t aad_len, const uint8_t *plaintext, size_t plaintext_len,
+                               uint8_t *ciphertext, uint8_t *tag)
 {
-    if (!crypto_ctx.initialized || key == NULL || iv == NULL || plaintext == NULL ||
-        ciphertext == NULL || tag == NULL) {
+    if (ctx == NULL || !ctx->ready || iv == NULL || plaintext == NULL || ciphertext == NULL ||
+        tag == NULL) {
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
 #ifdef USE_MBEDTLS
-    mbedtls_gcm_context gcm;
-    mbedtls_gcm_init(&gcm);
-
-    int ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 256);
-    if (ret != 0) {
-        LOG_ERROR("GCM setkey failed: %d", ret);
-        goto cleanup;
-    }
-
-    ret = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, plaintext_len, iv, 12, aad, aad_len,
-                                    plaintext, ciphertext, 16, tag);
+    int ret = mbedtls_gcm_crypt_and_tag(&ctx->gcm, MBEDTLS_GCM_ENCRYPT, plaintext_len, iv,
+                                        CRYPTO_AES_GCM_IV_SIZE, aad, aad_len, plaintext,
+                                        ciphertext, CRYPTO_AES_GCM_TAG_SIZE, tag);
     if (ret != 0) {
         LOG_ERROR("GCM encrypt failed: %d", ret);
+        return CRYPTO_ERROR;
     }
 
-cleanup:
-    mbedtls_gcm_free(&gcm);
-    return (ret == 0) ? CRYPTO_OK : CRYPTO_ERROR;
+    return CRYPTO_OK;
 #else
     return CRYPTO_ERROR;
 #endif
 }
 
-int crypto_aes_gcm_decrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *aad,
-                           size_t aad_len, const uint8_t *ciphertext, size_t ciphertext_len,
-                           const uint8_t *tag, uint8_t *plaintext)
+int crypto_aes_gcm_ctx_decrypt(crypto_aes_gcm_ctx_t *ctx, const uint8_t *iv, const uint8_t *aad,
+                               size_t aad_len, const uint8_t *ciphertext, size_t ciphertext_len,
+                               const uint8_t *tag, uint8_t *plaintext)
 {
-    if (!crypto_ctx.initialized || key == NULL || iv == NULL || ciphertext == NULL || tag == NULL ||
+    if (ctx == NULL || !ctx->ready || iv == NULL || ciphertext == NULL || tag == NULL ||
         plaintext == NULL) {
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
 #ifdef USE_MBEDTLS
-    mbedtls_gcm_context gcm;
-    mbedtls_gcm_init(&gcm);
-
-    int ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 256);
+    int ret = mbedtls_gcm_auth_decrypt(&ctx->gcm, ciphertext_len, iv, CRYPTO_AES_GCM_IV_SIZE, aad,
+                                       aad_len, tag, CRYPTO_AES_GCM_TAG_SIZE, ciphertext,
+                                       plaintext);
     if (ret != 0) {
-        LOG_ERROR("GCM setkey failed: %d", ret);
-        goto cleanup;
+        LOG_ERROR("GCM decrypt failed: %d", ret);
+        return CRYPTO_ERROR;
     }
 
-    ret = mbedtls_gcm_auth_decrypt(&gcm, ciphertext_len, iv, 12, aad, aad_len, tag, 16, ciphertext,
-                                   plaintext);
+    return CRYPTO_OK;
+#else
+    return CRYPTO_ERROR;
+#endif
+}
+
+void crypto_aes_gcm_ctx_free(crypto_aes_gcm_ctx_t *ctx)
+{
+    if (ctx == NULL) {
+        return;
+    }
+
+#ifdef USE_MBEDTLS
+    if (ctx->ready) {
+        mbedtls_gcm_free(&ctx->gcm);
+    }
+#endif
+    crypto_secure_zero(ctx, sizeof(*ctx));
+}
+
+/**
+ * @brief Run AES-256-CBC in either direction
+ */
+static int aes_cbc_crypt(bool encrypt, const uint8_t *key, const uint8_t *iv,
+                         const uint8_t *input, size_t len, uint8_t *output)
+{
+    if (!crypto_ctx.initialized || key == NULL || iv == NULL || input == NULL || output == NULL ||
+        len % CRYPTO_AES_BLOCK_SIZE != 0) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
+
+#ifdef USE_MBEDTLS
+    mbedtls_aes_context aes;
+    uint8_t iv_copy[CRYPTO_AES_BLOCK_SIZE];
+
+    /* mbedtls advances the IV in place */
+    memcpy(iv_copy, iv, sizeof(iv_copy));
+    mbedtls_aes_init(&aes);
+
+    int ret = encrypt ? mbedtls_aes_setkey_enc(&aes, key, 256)
+                      : mbedtls_aes_setkey_dec(&aes, key, 256);
+    if (ret == 0) {
+        ret = mbedtls_aes_crypt_cbc(&aes, encrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT,
+                                    len, iv_copy, input, output);
+    }
     if (ret != 0) {
-        LOG_ERROR("GCM decrypt failed: %d", ret);
+        LOG_ERROR("AES-CBC failed: %d", ret);
     }
 
-cleanup:
-    mbedtls_gcm_free(&gcm);
+    mbedtls_aes_free(&aes);
     return (ret == 0) ? CRYPTO_OK : CRYPTO_ERROR;
 #else
     return CRYPTO_ERROR;
 #endif
 }
 
+int crypto_aes_cbc_encrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *plaintext,
+                           size_t len, uint8_t *ciphertext)
+{
+    return aes_cbc_crypt(true, key, iv, plaintext, len, ciphertext);
+}
+
+int crypto_aes_cbc_decrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *ciphertext,
+                           size_t len, uint8_t *plaintext)
+{
+    return aes_cbc_crypt(false, key, iv, ciphertext, len, plaintext);
+}
+
 int crypto_random_generate(uint8_t *buffer, size_t len)
 {
     if (!crypto_ctx.initialized || buffer == NULL || len == 0) {
@@ -455,75 +668,63 @@ int crypto_ecdh_shared_secret(const uint8_t *private_key, const uint8_t *peer_pu
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-#ifdef USE_MBEDTLS
-    mbedtls_ecp_group grp;
-    mbedtls_mpi d, z;
-    mbedtls_ecp_point Q;
-
-    mbedtls_ecp_group_init(&grp);
-    mbedtls_mpi_init(&d);
-    mbedtls_mpi_init(&z);
-    mbedtls_ecp_point_init(&Q);
-
-    int ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
-    if (ret != 0)
-        goto cleanup;
-
-    ret = mbedtls_mpi_read_binary(&d, private_key, 32);
-    if (ret != 0)
-        goto cleanup;
-
-    ret = mbedtls_mpi_read_binary(&Q.X, &peer_public_key[0], 32);
-    if (ret != 0)
-        goto cleanup;
-
-    ret = mbedtls_mpi_read_binary(&Q.Y, &peer_public_key[32], 32);
-    if (ret != 0)
-        goto cleanup;
-
-    ret = mbedtls_mpi_lset(&Q.Z, 1);
-    if (ret != 0)
-        goto cleanup;
-
-    ret = mbedtls_ecdh_compute_shared(&grp, &z, &Q, &d, mbedtls_ctr_drbg_random,
-                                      &crypto_ctx.ctr_drbg);
-    if (ret != 0)
-        goto cleanup;
-
-    ret = mbedtls_mpi_write_binary(&z, shared_secret, 32);
-
-cleanup:
-    mbedtls_ecp_group_free(&grp);
-    mbedtls_mpi_free(&d);
-    mbedtls_mpi_free(&z);
-    mbedtls_ecp_point_free(&Q);
+    int ret = p256_ecdh(private_key, peer_public_key, shared_secret);
+    if (ret != P256_OK) {
+        LOG_ERROR("ECDH failed: %d", ret);
+        return CRYPTO_ERROR;
+    }
 
-    return (ret == 0) ? CRYPTO_OK : CRYPTO_ERROR;
-#else
-    return CRYPTO_ERROR;
-#endif
+    return CRYPTO_OK;
 }
 
 int crypto_hkdf_sha256(const uint8_t *salt, size_t salt_len, const uint8_t *ikm, size_t ikm_len,
                        const uint8_t *info, size_t info_len, uint8_t *okm, size_t okm_len)
 {
-    if (!crypto_ctx.initialized || ikm == NULL || okm == NULL) {
+    if (!crypto_ctx.initialized || ikm == NULL || okm == NULL || (info == NULL && info_len > 0) ||
+        okm_len > 255 * CRYPTO_SHA256_DIGEST_SIZE) {
         return CRYPTO_ERROR_INVALID_PARAM;
     }
 
-#ifdef USE_MBEDTLS
-    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    /* An absent salt is a string of zeros (RFC 5869, section 2.2) */
+    static const uint8_t zero_salt[CRYPTO_SHA256_DIGEST_SIZE] = {0};
+    if (salt == NULL || salt_len == 0) {
+        salt = zero_salt;
+        salt_len = sizeof(zero_salt);
+    }
 
-    int ret = mbedtls_hkdf(md, salt, salt_len, ikm, ikm_len, info, info_len, okm, okm_len);
-    if (ret != 0) {
-        LOG_ERROR("HKDF failed: %d", ret);
-        return CRYPTO_ERROR;
+    uint8_t block[CRYPTO_SHA256_DIGEST_SIZE];
+    crypto_hmac_ctx_t prk;
+
+    /* Extract, then key the expansion with the PRK once for every block */
+    int ret = crypto_hmac_sha256(salt, salt_len, ikm, ikm_len, block);
+    if (ret == CRYPTO_OK) {
+        ret = crypto_hmac_ctx_init(&prk, block, sizeof(block));
     }
-#else
-    return CRYPTO_ERROR;
-#endif
 
-    return CRYPTO_OK;
+    /* Expand: T(i) = HMAC(PRK, T(i - 1) | info | i) */
+    for (size_t offset = 0, i = 1; ret == CRYPTO_OK && offset < okm_len; i++) {
+        uint8_t counter = (uint8_t) i;
+        sha256_ctx_t sha = prk.inner;
+
+        if (i > 1) {
+            sha256_update(&sha, block, sizeof(block));
+        }
+        sha256_update(&sha, info, info_len);
+        sha256_update(&sha, &counter, 1);
+        sha256_final(&sha, block);
+
+        sha = prk.outer;
+        sha256_update(&sha, block, sizeof(block));
+        sha256_final(&sha, block);
+
+        size_t take = (okm_len - offset < sizeof(block)) ? okm_len - offset : sizeof(block);
+        memcpy(&okm[offset], block, take);
+        offset += take;
+    }
+
+    crypto_hmac_ctx_free(&prk);
+    crypto_secure_zero(block, sizeof(block));
+    return ret;
 }
 
 int crypto_ed25519_generate_keypair(uint8_t *private_key, uint8_t *public_key)
@@ -703,3 +904,58 @@ cleanup:
     return CRYPTO_ERROR;
 #endif
 }
+
+int crypto_save_resume_state(crypto_resume_state_t *state)
+{
+    if (!crypto_ctx.initialized || state == NULL) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
+
+    if (crypto_random_generate(state->drbg_seed, sizeof(state->drbg_seed)) != CRYPTO_OK) {
+        return CRYPTO_ERROR;
+    }
+
+    for (size_t i = 0; i < CRYPTO_KEY_POOL_SIZE; i++) {
+        memcpy(state->pool_private[i], crypto_ctx.key_pool[i].private_key,
+               CRYPTO_P256_PRIVATE_KEY_SIZE);
+        memcpy(state->pool_public[i], crypto_ctx.key_pool[i].public_key,
+               CRYPTO_P256_PUBLIC_KEY_SIZE);
+    }
+    state->pool_count = (uint8_t) crypto_ctx.key_pool_count;
+
+    return CRYPTO_OK;
+}
+
+int crypto_restore_resume_state(const crypto_resume_state_t *state)
+{
+    if (!crypto_ctx.initialized || state == NULL || state->pool_count > CRYPTO_KEY_POOL_SIZE) {
+        return CRYPTO_ERROR_INVALID_PARAM;
+    }
+
+#ifdef USE_MBEDTLS
+    int ret = mbedtls_ctr_drbg_update(&crypto_ctx.ctr_drbg, state->drbg_seed,
+                                      sizeof(state->drbg_seed));
+    if (ret != 0) {
+        LOG_ERROR("DRBG update from snapshot failed: %d", ret);
+        return CRYPTO_ERROR;
+    }
+
+    /* Fold in fresh hardware entropy once the device is idle again */
+    idle_sched_trigger(crypto_ctx.reseed_task);
+#endif
+
+    for (size_t i = 0; i < CRYPTO_KEY_POOL_SIZE; i++) {
+        memcpy(crypto_ctx.key_pool[i].private_key, state->pool_private[i],
+               CRYPTO_P256_PRIVATE_KEY_SIZE);
+        memcpy(crypto_ctx.key_pool[i].public_key, state->pool_public[i],
+               CRYPTO_P256_PUBLIC_KEY_SIZE);
+    }
+    crypto_ctx.key_pool_count = state->pool_count;
+
+    if (crypto_ctx.key_pool_count < CRYPTO_KEY_POOL_SIZE) {
+        idle_sched_trigger(crypto_ctx.key_pool_task);
+    }
+
+    LOG_DEBUG("Crypto state restored from snapshot (%u pooled keys)", state->pool_count);
+    return CRYPTO_OK;
+}
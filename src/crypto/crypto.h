@@ -16,6 +16,12 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "sha256.h"
+
+#ifdef USE_MBEDTLS
+#include "mbedtls/gcm.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +34,7 @@ extern "C" {
 
 /* Key and Hash Sizes */
 #define CRYPTO_SHA256_DIGEST_SIZE 32
+#define CRYPTO_SHA256_BLOCK_SIZE 64
 #define CRYPTO_P256_PRIVATE_KEY_SIZE 32
 #define CRYPTO_P256_PUBLIC_KEY_SIZE 64 /* Uncompressed: 0x04 || X || Y */
 #define CRYPTO_P256_SIGNATURE_SIZE 64  /* r || s */
@@ -36,6 +43,69 @@ extern "C" {
 #define CRYPTO_AES_GCM_IV_SIZE 12
 #define CRYPTO_AES_GCM_TAG_SIZE 16
 
+/* Number of P-256 key pairs generated ahead of time during idle periods */
+#define CRYPTO_KEY_POOL_SIZE 2
+
+/* DRBG seed material carried across deep sleep */
+#define CRYPTO_RESUME_SEED_SIZE 48
+
+/**
+ * @brief Warm crypto state kept across deep sleep
+ */
+typedef struct {
+    uint8_t drbg_seed[CRYPTO_RESUME_SEED_SIZE]; /**< Seed material drawn from the DRBG */
+    uint8_t pool_private[CRYPTO_KEY_POOL_SIZE][CRYPTO_P256_PRIVATE_KEY_SIZE];
+    uint8_t pool_public[CRYPTO_KEY_POOL_SIZE][CRYPTO_P256_PUBLIC_KEY_SIZE];
+    uint8_t pool_count; /**< Number of valid pool entries */
+} crypto_resume_state_t;
+
+/**
+ * @brief Incremental SHA-256 context
+ */
+typedef struct {
+    sha256_ctx_t sha; /**< Running hash state */
+    bool active;      /**< Started and not yet finished */
+} crypto_sha256_ctx_t;
+
+/**
+ * @brief HMAC-SHA256 context with a cached key schedule
+ *
+ * Holds the hash state after absorbing the padded key, so each MAC under the
+ * same key costs two compressions fewer than crypto_hmac_sha256().
+ */
+typedef struct {
+    sha256_ctx_t inner; /**< State after absorbing key ^ ipad */
+    sha256_ctx_t outer; /**< State after absorbing key ^ opad */
+    bool ready;         /**< Key loaded */
+} crypto_hmac_ctx_t;
+
+/**
+ * @brief AES-256-GCM key with its key schedule expanded once
+ *
+ * For keys that seal many messages (such as the storage key), so the AES key
+ * expansion and GHASH table are not rebuilt on every call.
+ */
+typedef struct {
+#ifdef USE_MBEDTLS
+    mbedtls_gcm_context gcm; /**< Expanded key schedule */
+#else
+    uint8_t key[CRYPTO_AES256_KEY_SIZE]; /**< Raw key */
+#endif
+    bool ready; /**< Key loaded */
+} crypto_aes_gcm_ctx_t;
+
+/**
+ * @brief ECDSA P-256 signing key loaded for repeated use
+ *
+ * Holds a private key that has already been range-checked, so a long-lived
+ * key (such as the attestation key) is validated once rather than on every
+ * signature.
+ */
+typedef struct {
+    uint8_t private_key[CRYPTO_P256_PRIVATE_KEY_SIZE]; /**< Raw private key */
+    bool ready;                                        /**< Key loaded */
+} crypto_ecdsa_key_t;
+
 /**
  * @brief Initialize cryptographic library
  *
@@ -62,6 +132,40 @@ int crypto_deinit(void);
  */
 int crypto_sha256(const uint8_t *data, size_t data_len, uint8_t *hash);
 
+/**
+ * @brief Start an incremental SHA-256 computation
+ *
+ * @param ctx Context to initialize
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_sha256_start(crypto_sha256_ctx_t *ctx);
+
+/**
+ * @brief Absorb more data into an incremental SHA-256
+ *
+ * @param ctx Context started with crypto_sha256_start()
+ * @param data Input data
+ * @param data_len Length of input data
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_sha256_update(crypto_sha256_ctx_t *ctx, const uint8_t *data, size_t data_len);
+
+/**
+ * @brief Finish an incremental SHA-256 and release the context
+ *
+ * @param ctx Context started with crypto_sha256_start()
+ * @param hash Output hash (32 bytes)
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_sha256_finish(crypto_sha256_ctx_t *ctx, uint8_t *hash);
+
+/**
+ * @brief Abandon an incremental SHA-256 and release the context
+ *
+ * @param ctx Context
+ */
+void crypto_sha256_free(crypto_sha256_ctx_t *ctx);
+
 /* ========== HMAC-SHA256 Functions ========== */
 
 /**
@@ -77,6 +181,35 @@ int crypto_sha256(const uint8_t *data, size_t data_len, uint8_t *hash);
 int crypto_hmac_sha256(const uint8_t *key, size_t key_len, const uint8_t *data, size_t data_len,
                        uint8_t *hmac);
 
+/**
+ * @brief Load a key into a cached HMAC-SHA256 context
+ *
+ * @param ctx Context to initialize
+ * @param key HMAC key
+ * @param key_len Length of key
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_hmac_ctx_init(crypto_hmac_ctx_t *ctx, const uint8_t *key, size_t key_len);
+
+/**
+ * @brief Compute HMAC-SHA256 with a cached key
+ *
+ * @param ctx Context loaded by crypto_hmac_ctx_init()
+ * @param data Input data
+ * @param data_len Length of input data
+ * @param hmac Output HMAC (32 bytes)
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_hmac_ctx_compute(const crypto_hmac_ctx_t *ctx, const uint8_t *data, size_t data_len,
+                            uint8_t *hmac);
+
+/**
+ * @brief Wipe a cached HMAC-SHA256 context
+ *
+ * @param ctx Context to wipe
+ */
+void crypto_hmac_ctx_free(crypto_hmac_ctx_t *ctx);
+
 /* ========== ECDSA P-256 Functions ========== */
 
 /**
@@ -117,6 +250,32 @@ int crypto_ecdsa_verify(const uint8_t *public_key, const uint8_t *hash, const ui
  */
 int crypto_ecdsa_get_public_key(const uint8_t *private_key, uint8_t *public_key);
 
+/**
+ * @brief Load an ECDSA P-256 private key for repeated signing
+ *
+ * @param key Key context to initialize
+ * @param private_key Private key (32 bytes)
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_ecdsa_key_init(crypto_ecdsa_key_t *key, const uint8_t *private_key);
+
+/**
+ * @brief Sign with a loaded ECDSA P-256 key
+ *
+ * @param key Key loaded with crypto_ecdsa_key_init()
+ * @param hash Message hash (32 bytes)
+ * @param signature Output signature (64 bytes: r || s)
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_ecdsa_key_sign(crypto_ecdsa_key_t *key, const uint8_t *hash, uint8_t *signature);
+
+/**
+ * @brief Release a loaded ECDSA key and wipe it
+ *
+ * @param key Key context
+ */
+void crypto_ecdsa_key_free(crypto_ecdsa_key_t *key);
+
 /* ========== Ed25519 Functions ========== */
 
 /**
@@ -197,6 +356,70 @@ int crypto_aes_gcm_decrypt(const uint8_t *key, const uint8_t *iv, const uint8_t
                            size_t aad_len, const uint8_t *ciphertext, size_t ciphertext_len,
                            const uint8_t *tag, uint8_t *plaintext);
 
+/**
+ * @brief Load an AES-256-GCM key for repeated use
+ *
+ * @param ctx Context to initialize
+ * @param key Key (32 bytes)
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_aes_gcm_ctx_init(crypto_aes_gcm_ctx_t *ctx, const uint8_t *key);
+
+/**
+ * @brief Encrypt with a loaded AES-256-GCM key
+ *
+ * Same as crypto_aes_gcm_encrypt() without the key setup.
+ *
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_aes_gcm_ctx_encrypt(crypto_aes_gcm_ctx_t *ctx, const uint8_t *iv, const uint8_t *aad,
+                               size_t aad_len, const uint8_t *plaintext, size_t plaintext_len,
+                               uint8_t *ciphertext, uint8_t *tag);
+
+/**
+ * @brief Decrypt with a loaded AES-256-GCM key
+ *
+ * Same as crypto_aes_gcm_decrypt() without the key setup.
+ *
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_aes_gcm_ctx_decrypt(crypto_aes_gcm_ctx_t *ctx, const uint8_t *iv, const uint8_t *aad,
+                               size_t aad_len, const uint8_t *ciphertext, size_t ciphertext_len,
+                               const uint8_t *tag, uint8_t *plaintext);
+
+/**
+ * @brief Release a loaded AES-256-GCM key and wipe it
+ */
+void crypto_aes_gcm_ctx_free(crypto_aes_gcm_ctx_t *ctx);
+
+/* ========== AES-256-CBC Functions ========== */
+
+/**
+ * @brief Encrypt data with AES-256-CBC (no padding)
+ *
+ * @param key Encryption key (32 bytes)
+ * @param iv Initialization vector (16 bytes)
+ * @param plaintext Input plaintext
+ * @param len Length of plaintext (multiple of 16)
+ * @param ciphertext Output ciphertext (same length as plaintext)
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_aes_cbc_encrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *plaintext,
+                           size_t len, uint8_t *ciphertext);
+
+/**
+ * @brief Decrypt data with AES-256-CBC (no padding)
+ *
+ * @param key Decryption key (32 bytes)
+ * @param iv Initialization vector (16 bytes)
+ * @param ciphertext Input ciphertext
+ * @param len Length of ciphertext (multiple of 16)
+ * @param plaintext Output plaintext (same length as ciphertext)
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_aes_cbc_decrypt(const uint8_t *key, const uint8_t *iv, const uint8_t *ciphertext,
+                           size_t len, uint8_t *plaintext);
+
 /* ========== Random Number Generation ========== */
 
 /**
@@ -254,6 +477,30 @@ int crypto_ecdh_shared_secret(const uint8_t *private_key, const uint8_t *peer_pu
 int crypto_hkdf_sha256(const uint8_t *salt, size_t salt_len, const uint8_t *ikm, size_t ikm_len,
                        const uint8_t *info, size_t info_len, uint8_t *okm, size_t okm_len);
 
+/* ========== Deep-Sleep Resume ========== */
+
+/**
+ * @brief Capture warm crypto state for the deep-sleep snapshot
+ *
+ * Draws fresh seed material from the DRBG and copies the pre-generated key
+ * pool.
+ *
+ * @param state Output state
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_save_resume_state(crypto_resume_state_t *state);
+
+/**
+ * @brief Reinstall warm crypto state after deep sleep
+ *
+ * Mixes the saved seed into the DRBG instead of waiting on the entropy
+ * source, and schedules a full reseed for the next idle window.
+ *
+ * @param state State captured by crypto_save_resume_state()
+ * @return CRYPTO_OK on success, error code otherwise
+ */
+int crypto_restore_resume_state(const crypto_resume_state_t *state);
+
 #ifdef __cplusplus
 }
 #endif
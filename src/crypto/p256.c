@@ -0,0 +1,1004 @@
+/**
+ * @file p256.c
+ * @brief Constant-Time NIST P-256 Implementation
+ *
+ * Field elements and scalars are eight little-endian 32-bit limbs. Field
+ * products are reduced with the FIPS 186 fast reduction for the Solinas
+ * prime p = 2^256 - 2^224 + 2^192 + 2^96 - 1; every field operation returns
+ * a fully reduced value without data-dependent branches. The multiply loops
+ * are shaped as a * b + c + carry, which Cortex-M4 does in one UMAAL.
+ *
+ * Points are in homogeneous projective coordinates and combined with the
+ * complete formulas for a = -3 of Renes, Costello and Batina (2016), which
+ * have no exceptional cases: doubling, adding a point to itself or to the
+ * point at infinity all go through the same straight-line code.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "p256.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/* Fixed-base comb: 5 teeth spaced 52 bits apart cover the 256-bit scalar */
+#define P256_COMB_TEETH 5
+#define P256_COMB_SPACING 52
+
+/* Fresh nonces / keys to draw before giving up on the random source */
+#define P256_RANDOM_ATTEMPTS 8
+
+/* -n^-1 mod 2^32, for Montgomery multiplication modulo n */
+#define P256_N0INV 0xee00bc4f
+
+typedef struct {
+    uint32_t x[8];
+    uint32_t y[8];
+} p256_affine_t;
+
+typedef struct {
+    uint32_t x[8];
+    uint32_t y[8];
+    uint32_t z[8];
+} p256_point_t;
+
+static const uint32_t P256_P[8] = {0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+                                   0x00000000, 0x00000000, 0x00000001, 0xffffffff};
+
+static const uint32_t P256_B[8] = {0x27d2604b, 0x3bce3c3e, 0xcc53b0f6, 0x651d06b0,
+                                   0x769886bc, 0xb3ebbd55, 0xaa3a93e7, 0x5ac635d8};
+
+static const uint32_t P256_N[8] = {0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+                                   0xffffffff, 0xffffffff, 0x00000000, 0xffffffff};
+
+/* R^2 mod n with R = 2^256 */
+static const uint32_t P256_N_RR[8] = {0xbe79eea2, 0x83244c95, 0x49bd6fa6, 0x4699799c,
+                                      0x2b6bec59, 0x2845b239, 0xf3d95620, 0x66e12d94};
+
+/* Generated by scripts/gen_p256_comb.py; entry i = sum of bit j of i times 2^(52 j) G */
+static const p256_affine_t p256_comb[32] = {
+    {{0}, {0}},
+    {{0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+      0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2},
+     {0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+      0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2}},
+    {{0x071e5c83, 0xeea6bc92, 0x8542a0be, 0x8bd27f19,
+      0x2a58e5b1, 0x20a845b7, 0x5026d73f, 0x54ccc941},
+     {0x140916a1, 0xcfd08ef7, 0x5d8ee496, 0x929e0bcc,
+      0xdad2bf22, 0x3a8f8715, 0xb4514532, 0x1c433f45}},
+    {{0x04bac870, 0xf7d24bb7, 0x3a23c6ab, 0x593a09a0,
+      0xf94c9d1d, 0xdfcc2358, 0x297bed02, 0x3cfa0f87},
+     {0x40f26940, 0xce98a30b, 0x0248a8af, 0x62121c0d,
+      0x8309af9b, 0xa758aa80, 0x70be12c6, 0xe4e37694}},
+    {{0x3ecca7e0, 0xc739a5ea, 0x6743333e, 0xa7d2c98f,
+      0x224d9428, 0x0fef6335, 0x5c792a0c, 0x7ef2ee3c},
+     {0x552ac094, 0x302b22dd, 0xdfbd3d20, 0x81b21450,
+      0xd5e609db, 0xa4f67f51, 0x30acc011, 0xafb68627}},
+    {{0x86ef7d7d, 0xdd37e3ff, 0x088b86db, 0xf6d77c27,
+      0x254c5491, 0x28fe9a4f, 0x6df0fd5e, 0xd6690337},
+     {0xaddad596, 0x9ff04992, 0x9e4373f9, 0xf3d1a7af,
+      0xdf074167, 0xa13e9578, 0xe6d13d22, 0x20e2a53c}},
+    {{0xb0879605, 0xd7b86aee, 0xbe3c7265, 0xa424ec2d,
+      0x12f01e9e, 0x276203c2, 0xb77e46e9, 0xb666fac5},
+     {0x3bf0c52d, 0xf431bb1a, 0x726cd8b6, 0xef46a44a,
+      0xee3de5a9, 0xeb5abc19, 0x90246904, 0x38aaa380}},
+    {{0x525d6abf, 0xaebfd735, 0x96bea25a, 0xc302f8f4,
+      0x544920a4, 0xdb82b3ea, 0x02eadb2e, 0x621c75d1},
+     {0x9ef485f0, 0x8939dc4c, 0x57c46d63, 0x225d03d8,
+      0x522d7f70, 0x4fdac96f, 0xb4fa649d, 0xd7c4a4fe}},
+    {{0x943e832a, 0x9c762ef1, 0x1786df70, 0x07e50ab0,
+      0x2589f18e, 0x90f573a8, 0xa7c2a51a, 0x0d2bf28b},
+     {0x5b20d37c, 0x48263af1, 0x60551446, 0x27ec9db9,
+      0x94b4e7ed, 0x7087a10a, 0x13bd00ac, 0x0cac3f43}},
+    {{0xc0b9372a, 0x8bc659aa, 0xedd9583f, 0xf7659958,
+      0x8c267d88, 0x9f05f94a, 0xc99a739d, 0x00dc46e7},
+     {0xdf55d0f2, 0x4af50a00, 0x8156bf6a, 0xb5eb202d,
+      0x5228c111, 0x40d1e3ab, 0x45793424, 0x0312a557}},
+    {{0x9e6486e0, 0x9d90cda8, 0x1c7522c0, 0xc8a820bd,
+      0x08dcd7ab, 0x867c5580, 0x882a7892, 0x3c510ce2},
+     {0x646d54c6, 0x0e283334, 0xeda4e046, 0x33392776,
+      0x5ba997b0, 0xc3a7fc08, 0x5acf053f, 0xd35e620f}},
+    {{0x7eb8cfee, 0x8d9692f7, 0x0d8c013d, 0x05e3f223,
+      0x84e32e59, 0x76347a52, 0x15b0a1e5, 0x3c53e290},
+     {0xfae798d4, 0x538b7da5, 0x00d23591, 0x1b9f1bd1,
+      0x9a08693f, 0x11a9f072, 0x140efeb3, 0xd30e7cda}},
+    {{0x4dd6c004, 0x81dec926, 0xdad210d5, 0xbfed14fe,
+      0xb96b9911, 0x39f9ff69, 0x29c2024d, 0x02fd7b73},
+     {0x715d29fc, 0x50cfceb8, 0x0c236311, 0xb682b999,
+      0xc7797831, 0x00f34add, 0x59927df3, 0x42ebd3cb}},
+    {{0xf8e8f683, 0x6dfcf787, 0x3f7fbe90, 0x13d72b7a,
+      0x2df232cf, 0xfd426d94, 0x5fe39aad, 0xed84bb42},
+     {0x732995fc, 0x023e67a1, 0x355430e3, 0x67dd0a8e,
+      0x97a1d703, 0x0cf83b61, 0x583c33f2, 0xa3233455}},
+    {{0x68142904, 0x27014ab4, 0x00cfa617, 0xfb500882,
+      0x7009b958, 0x6745ff87, 0xd449242d, 0x9e9889bc},
+     {0x575616c8, 0x035b613b, 0x138e99e2, 0x00855156,
+      0x292e6aa0, 0x94c0d24b, 0x7e79b3a2, 0xd9ba5b68}},
+    {{0x5f165d99, 0xcebbbc7b, 0x8a4eee61, 0x50cc51c1,
+      0x1b4d0d1f, 0xb31d2353, 0x66382ada, 0x95e18452},
+     {0x0a839b5b, 0xacad4f81, 0x4142ff0f, 0xa0a2a96e,
+      0x1f4fa12f, 0x3eaa8289, 0x6b0fb8f3, 0x68d68c8f}},
+    {{0x839bb85f, 0x320f09c3, 0xa050e62c, 0x0101fb06,
+      0x9ad53458, 0x557582c9, 0x1666432b, 0x55d5398d},
+     {0x4fed936f, 0xf7f63118, 0x1833d9e1, 0xd90d6a7f,
+      0x8ebaa72a, 0x059c6a9e, 0x49ff8e2d, 0x576e2290}},
+    {{0x51bbb3f1, 0x9311a269, 0x8d0f4f65, 0xe80f26bd,
+      0x6beccbb9, 0x9d3dc334, 0x101e5de4, 0x54e244d5},
+     {0xf1b19e28, 0xb3ad4c6e, 0x58c2e3b7, 0x4334fbc0,
+      0x35df9c25, 0x19bd4107, 0xec106eb6, 0xd6bbec0e}},
+    {{0xe5046dc5, 0x788251c7, 0xf179327b, 0x12839b95,
+      0x4a8cb46e, 0xf1c05d98, 0x3c00736b, 0x443737cd},
+     {0x12cd8fe5, 0xa760a456, 0x0817bdd9, 0x797489de,
+      0xf42c23e8, 0xc56eb80a, 0xe6fe7af5, 0x83719dd7}},
+    {{0x3fefcfc8, 0xe8881a83, 0xb9b5290b, 0xaea3c9e0,
+      0x771e4688, 0x10b37ecd, 0xd4d021b6, 0xee0816a3},
+     {0xb3a8caa1, 0x8e9929bf, 0xc105f2d1, 0x48915dcf,
+      0xdb49019f, 0x3a5fdf82, 0xad9006e1, 0xc4a438e3}},
+    {{0x87de4b29, 0x5db9620f, 0xd91ecb2e, 0xd7420c18,
+      0x32acf105, 0x301ba1b2, 0x7853a937, 0xdb96bb0c},
+     {0xc359ac34, 0xd84bfef6, 0x64852a1d, 0xab80cef0,
+      0xb9da1717, 0x3fbee4d3, 0x7a13222c, 0xb325074e}},
+    {{0xe83ad2c9, 0x5d6dc503, 0xaed035be, 0xca9f7a1d,
+      0xcbd21e33, 0x552788ac, 0xe09cb9f0, 0x8699dd31},
+     {0x329bf961, 0x38584196, 0xb82a5af9, 0x4cb20e96,
+      0xc72c78c1, 0x24199908, 0xe92859b7, 0x16e65484}},
+    {{0x052fde29, 0x6a201c4b, 0x0031dbb4, 0x6c897123,
+      0x16c1da96, 0x4a759982, 0x2cc67214, 0xeec0b975},
+     {0x812c864e, 0xb908b9f1, 0x8439f6ba, 0x367fb66a,
+      0xf966f329, 0x789d664b, 0xf7f1d283, 0xe02af770}},
+    {{0xdb3038dd, 0xa20a2c70, 0xe99d5c7c, 0x5f0b46d5,
+      0x4b600b83, 0xc9b97d37, 0x3df3245e, 0x186c7f79},
+     {0x4f1ce57f, 0x2af72460, 0x91e2d8ed, 0x9249897f,
+      0x8d2ea797, 0x8139b36a, 0x9ab58913, 0x9c428db8}},
+    {{0x6471aaa0, 0xb4a196fb, 0x1b6b9730, 0xdcbab650,
+      0x295b57d2, 0x7afccc8a, 0x4e33a65d, 0xee2280f4},
+     {0x890fcd12, 0xc47a0803, 0x82604f6b, 0x4e98a98d,
+      0xed5fbbd2, 0x0d598f06, 0xa6a1eb84, 0xce46ec91}},
+    {{0x4be6458d, 0x1f1e4f3f, 0x595e6547, 0x5f72cc22,
+      0x271a93f1, 0x5bc5341e, 0x58a5f263, 0xc62e155c},
+     {0x58ba7ff4, 0x5f6f845a, 0x7e36a6ad, 0x67e1f7dc,
+      0xeeaa4d04, 0xd33a7657, 0x18267e4e, 0xff9f2322}},
+    {{0x4a53789f, 0xd369f11f, 0x3696b437, 0xc7876fb6,
+      0x0baba29a, 0xa0e8f0a7, 0x32f6e514, 0xa0318a5f},
+     {0x11775a08, 0x5c4a43d1, 0x362eebb1, 0x418c507c,
+      0x09a325aa, 0xfd08903f, 0xf0eebb3a, 0xf320b8fc}},
+    {{0xc7644c1d, 0xe33f0255, 0xbb9002d8, 0x4030ecc3,
+      0xf4646f9f, 0xa4486916, 0x959c44fa, 0x5e677d0c},
+     {0xd88b9144, 0xe2e7d7d0, 0x6248f91f, 0x5d93a86f,
+      0x02993aea, 0xe33d0bd5, 0x3100d31e, 0x449f0ce6}},
+    {{0x73cf2678, 0x3fcd925a, 0xa6d0afc7, 0x34ca923b,
+      0x3067791f, 0x9011091d, 0x5a7941e4, 0x8c568874},
+     {0xfc339800, 0x34d37180, 0x595c51f4, 0x7744316b,
+      0xe88c6420, 0xf2ddb693, 0x5bad14d2, 0xfb3a48b1}},
+    {{0xfdaab256, 0x52df1588, 0x3127354c, 0x68c0cd44,
+      0xa591f853, 0x2a849471, 0x93d0cb92, 0xe4da88e9},
+     {0x1639c624, 0x6d1ea35d, 0x263707ba, 0x60fe2a36,
+      0xd0f3bc51, 0x97fc50de, 0x10062e80, 0xf7fa4d15}},
+    {{0x024c168d, 0xc429a113, 0x3feaa272, 0xb6c935fb,
+      0xe639ec09, 0xb58a6071, 0xf9c13de7, 0x4b59253a},
+     {0xfbfb8955, 0x6d2d68f2, 0x50723fe2, 0xf0064c12,
+      0x01f185f5, 0xe85d7820, 0x7fa79c93, 0xaa0307bf}},
+    {{0x5b696527, 0x2e75a266, 0x5a00169c, 0x1a2530b0,
+      0x4286fb42, 0x76c4c180, 0x8e831d5b, 0x825f0194},
+     {0xef703739, 0xdbf0a11f, 0xce5b106a, 0x106f9bc4,
+      0x24111150, 0x61794c4f, 0xbc723a17, 0x435872fe}},
+};
+
+/* ========== Limb Helpers ========== */
+
+static void p256_wipe(void *ptr, size_t len)
+{
+    volatile uint8_t *p = (volatile uint8_t *) ptr;
+    while (len--) {
+        *p++ = 0;
+    }
+}
+
+static void load_be256(uint32_t r[8], const uint8_t *in)
+{
+    for (int i = 0; i < 8; i++) {
+        const uint8_t *w = &in[4 * (7 - i)];
+        r[i] = ((uint32_t) w[0] << 24) | ((uint32_t) w[1] << 16) | ((uint32_t) w[2] << 8) |
+               (uint32_t) w[3];
+    }
+}
+
+static void store_be256(uint8_t *out, const uint32_t a[8])
+{
+    for (int i = 0; i < 8; i++) {
+        uint8_t *w = &out[4 * (7 - i)];
+        w[0] = (uint8_t) (a[i] >> 24);
+        w[1] = (uint8_t) (a[i] >> 16);
+        w[2] = (uint8_t) (a[i] >> 8);
+        w[3] = (uint8_t) a[i];
+    }
+}
+
+/* r = a + b, returns the carry out */
+static uint32_t add256(uint32_t r[8], const uint32_t a[8], const uint32_t b[8])
+{
+    uint64_t carry = 0;
+    for (int i = 0; i < 8; i++) {
+        carry += (uint64_t) a[i] + b[i];
+        r[i] = (uint32_t) carry;
+        carry >>= 32;
+    }
+    return (uint32_t) carry;
+}
+
+/* r = a - b, returns 1 on borrow */
+static uint32_t sub256(uint32_t r[8], const uint32_t a[8], const uint32_t b[8])
+{
+    uint64_t borrow = 0;
+    for (int i = 0; i < 8; i++) {
+        uint64_t diff = (uint64_t) a[i] - b[i] - borrow;
+        r[i] = (uint32_t) diff;
+        borrow = diff >> 63;
+    }
+    return (uint32_t) borrow;
+}
+
+/* r = mask ? a : r, with mask all ones or all zeros */
+static void cmov256(uint32_t r[8], const uint32_t a[8], uint32_t mask)
+{
+    for (int i = 0; i < 8; i++) {
+        r[i] ^= mask & (r[i] ^ a[i]);
+    }
+}
+
+static uint32_t is_zero256(const uint32_t a[8])
+{
+    uint32_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+        bits |= a[i];
+    }
+    return 1 ^ ((bits | (0 - bits)) >> 31);
+}
+
+/* 1 if a < m */
+static uint32_t lt256(const uint32_t a[8], const uint32_t m[8])
+{
+    uint32_t scratch[8];
+    return sub256(scratch, a, m);
+}
+
+/* r = a mod m for a < 2^256 and 2^256 < 2m */
+static void reduce_once(uint32_t r[8], const uint32_t a[8], const uint32_t m[8])
+{
+    uint32_t t[8];
+    uint32_t borrow = sub256(t, a, m);
+    memcpy(r, a, sizeof(t));
+    cmov256(r, t, borrow - 1);
+}
+
+/* ========== Field Arithmetic mod p ========== */
+
+static void fe_add(uint32_t r[8], const uint32_t a[8], const uint32_t b[8])
+{
+    uint32_t t[8];
+    uint32_t u[8];
+
+    uint32_t carry = add256(t, a, b);
+    uint32_t borrow = sub256(u, t, P256_P);
+
+    /* Keep t - p unless a + b < p */
+    memcpy(r, t, sizeof(t));
+    cmov256(r, u, 0 - (carry | (borrow ^ 1)));
+}
+
+static void fe_sub(uint32_t r[8], const uint32_t a[8], const uint32_t b[8])
+{
+    uint32_t t[8];
+    uint32_t mask = 0 - sub256(t, a, b);
+
+    uint64_t carry = 0;
+    for (int i = 0; i < 8; i++) {
+        carry += (uint64_t) t[i] + (P256_P[i] & mask);
+        r[i] = (uint32_t) carry;
+        carry >>= 32;
+    }
+}
+
+/*
+ * Reduce a 512-bit product with the FIPS 186 fast reduction: the high words
+ * are folded in through the identity 2^256 = 2^224 - 2^192 - 2^96 + 1 (mod p).
+ */
+static void fe_reduce(uint32_t r[8], const uint32_t c[16])
+{
+    int64_t t[8];
+
+    t[0] = (int64_t) c[0] + c[8] + c[9] - c[11] - c[12] - c[13] - c[14];
+    t[1] = (int64_t) c[1] + c[9] + c[10] - c[12] - c[13] - c[14] - c[15];
+    t[2] = (int64_t) c[2] + c[10] + c[11] - c[13] - c[14] - c[15];
+    t[3] = (int64_t) c[3] + 2 * (int64_t) c[11] + 2 * (int64_t) c[12] + c[13] - c[15] - c[8] -
+           c[9];
+    t[4] = (int64_t) c[4] + 2 * (int64_t) c[12] + 2 * (int64_t) c[13] + c[14] - c[9] - c[10];
+    t[5] = (int64_t) c[5] + 2 * (int64_t) c[13] + 2 * (int64_t) c[14] + c[15] - c[10] - c[11];
+    t[6] = (int64_t) c[6] + 3 * (int64_t) c[14] + 2 * (int64_t) c[15] + c[13] - c[8] - c[9];
+    t[7] = (int64_t) c[7] + 3 * (int64_t) c[15] + c[8] - c[10] - c[11] - c[12] - c[13];
+
+    /* Sum lies in (-4 * 2^256, 7 * 2^256); two folds of the top carry make it fit */
+    int64_t carry = 0;
+    for (int i = 0; i < 8; i++) {
+        carry += t[i];
+        t[i] = (uint32_t) carry;
+        carry >>= 32;
+    }
+    for (int pass = 0; pass < 2; pass++) {
+        t[0] += carry;
+        t[3] -= carry;
+        t[6] -= carry;
+        t[7] += carry;
+
+        carry = 0;
+        for (int i = 0; i < 8; i++) {
+            carry += t[i];
+            t[i] = (uint32_t) carry;
+            carry >>= 32;
+        }
+    }
+
+    uint32_t v[8];
+    for (int i = 0; i < 8; i++) {
+        v[i] = (uint32_t) t[i];
+    }
+    reduce_once(r, v, P256_P);
+}
+
+static void fe_mul(uint32_t r[8], const uint32_t a[8], const uint32_t b[8])
+{
+    uint32_t c[16] = {0};
+
+    for (int i = 0; i < 8; i++) {
+        uint64_t acc = 0;
+        for (int j = 0; j < 8; j++) {
+            acc = (uint64_t) a[i] * b[j] + c[i + j] + (acc >> 32);
+            c[i + j] = (uint32_t) acc;
+        }
+        c[i + 8] = (uint32_t) (acc >> 32);
+    }
+
+    fe_reduce(r, c);
+}
+
+static void fe_sqr(uint32_t r[8], const uint32_t a[8])
+{
+    fe_mul(r, a, a);
+}
+
+static void fe_sqr_n(uint32_t r[8], const uint32_t a[8], int n)
+{
+    fe_sqr(r, a);
+    while (--n > 0) {
+        fe_sqr(r, r);
+    }
+}
+
+/* r = a^(p - 2) by a fixed addition chain */
+static void fe_inv(uint32_t r[8], const uint32_t a[8])
+{
+    uint32_t x2[8], x3[8], x6[8], x12[8], x15[8], x30[8], x32[8], t[8];
+
+    fe_sqr(x2, a);
+    fe_mul(x2, x2, a);
+    fe_sqr(x3, x2);
+    fe_mul(x3, x3, a);
+    fe_sqr_n(x6, x3, 3);
+    fe_mul(x6, x6, x3);
+    fe_sqr_n(x12, x6, 6);
+    fe_mul(x12, x12, x6);
+    fe_sqr_n(x15, x12, 3);
+    fe_mul(x15, x15, x3);
+    fe_sqr_n(x30, x15, 15);
+    fe_mul(x30, x30, x15);
+    fe_sqr_n(x32, x30, 2);
+    fe_mul(x32, x32, x2);
+
+    /* p - 2 = ffffffff 00000001 00000000 00000000 00000000 ffffffff ffffffff fffffffd */
+    fe_sqr_n(t, x32, 32);
+    fe_mul(t, t, a);
+    fe_sqr_n(t, t, 128);
+    fe_mul(t, t, x32);
+    fe_sqr_n(t, t, 32);
+    fe_mul(t, t, x32);
+    fe_sqr_n(t, t, 30);
+    fe_mul(t, t, x30);
+    fe_sqr_n(t, t, 2);
+    fe_mul(r, t, a);
+}
+
+/* ========== Scalar Arithmetic mod n ========== */
+
+/* Montgomery product r = a * b / 2^256 mod n (CIOS) */
+static void sc_mont_mul(uint32_t r[8], const uint32_t a[8], const uint32_t b[8])
+{
+    uint32_t t[10] = {0};
+
+    for (int i = 0; i < 8; i++) {
+        uint64_t acc = 0;
+        for (int j = 0; j < 8; j++) {
+            acc = (uint64_t) a[j] * b[i] + t[j] + (acc >> 32);
+            t[j] = (uint32_t) acc;
+        }
+        acc = (uint64_t) t[8] + (acc >> 32);
+        t[8] = (uint32_t) acc;
+        t[9] = (uint32_t) (acc >> 32);
+
+        uint32_t m = t[0] * P256_N0INV;
+        acc = (uint64_t) m * P256_N[0] + t[0];
+        for (int j = 1; j < 8; j++) {
+            acc = (uint64_t) m * P256_N[j] + t[j] + (acc >> 32);
+            t[j - 1] = (uint32_t) acc;
+        }
+        acc = (uint64_t) t[8] + (acc >> 32);
+        t[7] = (uint32_t) acc;
+        t[8] = t[9] + (uint32_t) (acc >> 32);
+    }
+
+    /* t < 2n */
+    uint32_t u[8];
+    uint32_t borrow = sub256(u, t, P256_N);
+    memcpy(r, t, sizeof(u));
+    cmov256(r, u, 0 - (t[8] | (borrow ^ 1)));
+}
+
+static void sc_to_mont(uint32_t r[8], const uint32_t a[8])
+{
+    sc_mont_mul(r, a, P256_N_RR);
+}
+
+static void sc_add(uint32_t r[8], const uint32_t a[8], const uint32_t b[8])
+{
+    uint32_t t[8];
+    uint32_t u[8];
+
+    uint32_t carry = add256(t, a, b);
+    uint32_t borrow = sub256(u, t, P256_N);
+    memcpy(r, t, sizeof(t));
+    cmov256(r, u, 0 - (carry | (borrow ^ 1)));
+}
+
+/* r = a^(n - 2) in the Montgomery domain; the exponent is public */
+static void sc_inv_mont(uint32_t r[8], const uint32_t a[8])
+{
+    uint32_t e[8];
+    uint32_t t[8];
+    static const uint32_t two[8] = {2};
+
+    sub256(e, P256_N, two);
+    memcpy(t, a, sizeof(t));
+    for (int bit = 254; bit >= 0; bit--) {
+        sc_mont_mul(t, t, t);
+        if ((e[bit >> 5] >> (bit & 31)) & 1) {
+            sc_mont_mul(t, t, a);
+        }
+    }
+    memcpy(r, t, sizeof(t));
+    p256_wipe(t, sizeof(t));
+}
+
+/* Load a scalar and check 1 <= k < n */
+static bool sc_load(uint32_t r[8], const uint8_t *in)
+{
+    load_be256(r, in);
+    return (lt256(r, P256_N) & (is_zero256(r) ^ 1)) != 0;
+}
+
+/* ========== Point Arithmetic ========== */
+
+static void point_set_infinity(p256_point_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->y[0] = 1;
+}
+
+static void point_from_affine(p256_point_t *r, const p256_affine_t *a)
+{
+    memcpy(r->x, a->x, sizeof(r->x));
+    memcpy(r->y, a->y, sizeof(r->y));
+    memset(r->z, 0, sizeof(r->z));
+    r->z[0] = 1;
+}
+
+static void point_cmov(p256_point_t *r, const p256_point_t *a, uint32_t mask)
+{
+    cmov256(r->x, a->x, mask);
+    cmov256(r->y, a->y, mask);
+    cmov256(r->z, a->z, mask);
+}
+
+static void point_cswap(p256_point_t *a, p256_point_t *b, uint32_t swap)
+{
+    uint32_t *pa = (uint32_t *) a;
+    uint32_t *pb = (uint32_t *) b;
+    uint32_t mask = 0 - swap;
+
+    for (size_t i = 0; i < sizeof(*a) / sizeof(uint32_t); i++) {
+        uint32_t diff = mask & (pa[i] ^ pb[i]);
+        pa[i] ^= diff;
+        pb[i] ^= diff;
+    }
+}
+
+/* Complete addition (RCB16 algorithm 4) */
+static void point_add(p256_point_t *r, const p256_point_t *p, const p256_point_t *q)
+{
+    uint32_t t0[8], t1[8], t2[8], t3[8], t4[8], x3[8], y3[8], z3[8];
+
+    fe_mul(t0, p->x, q->x);
+    fe_mul(t1, p->y, q->y);
+    fe_mul(t2, p->z, q->z);
+    fe_add(t3, p->x, p->y);
+    fe_add(t4, q->x, q->y);
+    fe_mul(t3, t3, t4);
+    fe_add(t4, t0, t1);
+    fe_sub(t3, t3, t4);
+    fe_add(t4, p->y, p->z);
+    fe_add(x3, q->y, q->z);
+    fe_mul(t4, t4, x3);
+    fe_add(x3, t1, t2);
+    fe_sub(t4, t4, x3);
+    fe_add(x3, p->x, p->z);
+    fe_add(y3, q->x, q->z);
+    fe_mul(x3, x3, y3);
+    fe_add(y3, t0, t2);
+    fe_sub(y3, x3, y3);
+    fe_mul(z3, P256_B, t2);
+    fe_sub(x3, y3, z3);
+    fe_add(z3, x3, x3);
+    fe_add(x3, x3, z3);
+    fe_sub(z3, t1, x3);
+    fe_add(x3, t1, x3);
+    fe_mul(y3, P256_B, y3);
+    fe_add(t1, t2, t2);
+    fe_add(t2, t1, t2);
+    fe_sub(y3, y3, t2);
+    fe_sub(y3, y3, t0);
+    fe_add(t1, y3, y3);
+    fe_add(y3, t1, y3);
+    fe_add(t1, t0, t0);
+    fe_add(t0, t1, t0);
+    fe_sub(t0, t0, t2);
+    fe_mul(t1, t4, y3);
+    fe_mul(t2, t0, y3);
+    fe_mul(y3, x3, z3);
+    fe_add(y3, y3, t2);
+    fe_mul(x3, t3, x3);
+    fe_sub(x3, x3, t1);
+    fe_mul(z3, t4, z3);
+    fe_mul(t1, t3, t0);
+    fe_add(z3, z3, t1);
+
+    memcpy(r->x, x3, sizeof(x3));
+    memcpy(r->y, y3, sizeof(y3));
+    memcpy(r->z, z3, sizeof(z3));
+}
+
+/* Complete mixed addition with an affine q (RCB16 algorithm 5); q must not be infinity */
+static void point_add_mixed(p256_point_t *r, const p256_point_t *p, const p256_affine_t *q)
+{
+    uint32_t t0[8], t1[8], t2[8], t3[8], t4[8], x3[8], y3[8], z3[8];
+
+    fe_mul(t0, p->x, q->x);
+    fe_mul(t1, p->y, q->y);
+    fe_add(t3, q->x, q->y);
+    fe_add(t4, p->x, p->y);
+    fe_mul(t3, t3, t4);
+    fe_add(t4, t0, t1);
+    fe_sub(t3, t3, t4);
+    fe_mul(t4, q->y, p->z);
+    fe_add(t4, t4, p->y);
+    fe_mul(y3, q->x, p->z);
+    fe_add(y3, y3, p->x);
+    fe_mul(z3, P256_B, p->z);
+    fe_sub(x3, y3, z3);
+    fe_add(z3, x3, x3);
+    fe_add(x3, x3, z3);
+    fe_sub(z3, t1, x3);
+    fe_add(x3, t1, x3);
+    fe_mul(y3, P256_B, y3);
+    fe_add(t1, p->z, p->z);
+    fe_add(t2, t1, p->z);
+    fe_sub(y3, y3, t2);
+    fe_sub(y3, y3, t0);
+    fe_add(t1, y3, y3);
+    fe_add(y3, t1, y3);
+    fe_add(t1, t0, t0);
+    fe_add(t0, t1, t0);
+    fe_sub(t0, t0, t2);
+    fe_mul(t1, t4, y3);
+    fe_mul(t2, t0, y3);
+    fe_mul(y3, x3, z3);
+    fe_add(y3, y3, t2);
+    fe_mul(x3, t3, x3);
+    fe_sub(x3, x3, t1);
+    fe_mul(z3, t4, z3);
+    fe_mul(t1, t3, t0);
+    fe_add(z3, z3, t1);
+
+    memcpy(r->x, x3, sizeof(x3));
+    memcpy(r->y, y3, sizeof(y3));
+    memcpy(r->z, z3, sizeof(z3));
+}
+
+/* Complete doubling (RCB16 algorithm 6) */
+static void point_double(p256_point_t *r, const p256_point_t *p)
+{
+    uint32_t t0[8], t1[8], t2[8], t3[8], x3[8], y3[8], z3[8];
+
+    fe_sqr(t0, p->x);
+    fe_sqr(t1, p->y);
+    fe_sqr(t2, p->z);
+    fe_mul(t3, p->x, p->y);
+    fe_add(t3, t3, t3);
+    fe_mul(z3, p->x, p->z);
+    fe_add(z3, z3, z3);
+    fe_mul(y3, P256_B, t2);
+    fe_sub(y3, y3, z3);
+    fe_add(x3, y3, y3);
+    fe_add(y3, x3, y3);
+    fe_sub(x3, t1, y3);
+    fe_add(y3, t1, y3);
+    fe_mul(y3, x3, y3);
+    fe_mul(x3, x3, t3);
+    fe_add(t3, t2, t2);
+    fe_add(t2, t2, t3);
+    fe_mul(z3, P256_B, z3);
+    fe_sub(z3, z3, t2);
+    fe_sub(z3, z3, t0);
+    fe_add(t3, z3, z3);
+    fe_add(z3, z3, t3);
+    fe_add(t3, t0, t0);
+    fe_add(t0, t3, t0);
+    fe_sub(t0, t0, t2);
+    fe_mul(t0, t0, z3);
+    fe_add(y3, y3, t0);
+    fe_mul(t0, p->y, p->z);
+    fe_add(t0, t0, t0);
+    fe_mul(z3, t0, z3);
+    fe_sub(x3, x3, z3);
+    fe_mul(z3, t0, t1);
+    fe_add(z3, z3, z3);
+    fe_add(z3, z3, z3);
+
+    memcpy(r->x, x3, sizeof(x3));
+    memcpy(r->y, y3, sizeof(y3));
+    memcpy(r->z, z3, sizeof(z3));
+}
+
+/* Convert to affine; false for the point at infinity */
+static bool point_to_affine(uint32_t x[8], uint32_t y[8], const p256_point_t *p)
+{
+    uint32_t zinv[8];
+
+    fe_inv(zinv, p->z);
+    fe_mul(x, p->x, zinv);
+    if (y != NULL) {
+        fe_mul(y, p->y, zinv);
+    }
+
+    return is_zero256(p->z) == 0;
+}
+
+/* Decode and validate an X || Y public key */
+static bool point_load(p256_point_t *r, const uint8_t *in)
+{
+    p256_affine_t a;
+    uint32_t lhs[8], rhs[8], t[8];
+
+    load_be256(a.x, &in[0]);
+    load_be256(a.y, &in[32]);
+    if (!lt256(a.x, P256_P) || !lt256(a.y, P256_P)) {
+        return false;
+    }
+
+    /* y^2 = x^3 - 3x + b */
+    fe_sqr(lhs, a.y);
+    fe_sqr(rhs, a.x);
+    fe_mul(rhs, rhs, a.x);
+    fe_add(t, a.x, a.x);
+    fe_add(t, t, a.x);
+    fe_sub(rhs, rhs, t);
+    fe_add(rhs, rhs, P256_B);
+    if (memcmp(lhs, rhs, sizeof(lhs)) != 0) {
+        return false;
+    }
+
+    point_from_affine(r, &a);
+    return true;
+}
+
+/* Constant-time read of comb entry index (non-zero) */
+static void comb_lookup(p256_affine_t *r, uint32_t index)
+{
+    memset(r, 0, sizeof(*r));
+    for (uint32_t i = 1; i < (1u << P256_COMB_TEETH); i++) {
+        uint32_t diff = i ^ index;
+        uint32_t mask = ((diff | (0 - diff)) >> 31) - 1;
+        cmov256(r->x, p256_comb[i].x, mask);
+        cmov256(r->y, p256_comb[i].y, mask);
+    }
+}
+
+/* acc = 2 * acc + comb entry for bit column i of k */
+static void comb_column(p256_point_t *acc, const uint32_t k[8], int i)
+{
+    p256_point_t sum;
+    p256_affine_t entry;
+
+    point_double(acc, acc);
+
+    uint32_t index = 0;
+    for (int j = 0; j < P256_COMB_TEETH; j++) {
+        int bit = j * P256_COMB_SPACING + i;
+        if (bit < 256) {
+            index |= ((k[bit >> 5] >> (bit & 31)) & 1) << j;
+        }
+    }
+
+    /* Entry 0 stands for infinity, which mixed addition cannot take: drop that sum */
+    comb_lookup(&entry, index);
+    point_add_mixed(&sum, acc, &entry);
+    point_cmov(acc, &sum, 0 - ((index | (0 - index)) >> 31));
+
+    p256_wipe(&sum, sizeof(sum));
+    p256_wipe(&entry, sizeof(entry));
+}
+
+/* r = k * G with the fixed-base comb */
+static void point_mul_base(p256_point_t *r, const uint32_t k[8])
+{
+    p256_point_t acc;
+
+    point_set_infinity(&acc);
+    for (int i = P256_COMB_SPACING - 1; i >= 0; i--) {
+        comb_column(&acc, k, i);
+    }
+
+    *r = acc;
+    p256_wipe(&acc, sizeof(acc));
+}
+
+/* r = k * p with a Montgomery ladder */
+static void point_mul_ladder(p256_point_t *r, const uint32_t k[8], const p256_point_t *p)
+{
+    p256_point_t r0;
+    p256_point_t r1 = *p;
+    uint32_t swap = 0;
+
+    point_set_infinity(&r0);
+    for (int i = 255; i >= 0; i--) {
+        uint32_t bit = (k[i >> 5] >> (i & 31)) & 1;
+        point_cswap(&r0, &r1, swap ^ bit);
+        swap = bit;
+        point_add(&r1, &r0, &r1);
+        point_double(&r0, &r0);
+    }
+    point_cswap(&r0, &r1, swap);
+
+    *r = r0;
+    p256_wipe(&r0, sizeof(r0));
+    p256_wipe(&r1, sizeof(r1));
+}
+
+/* Draw a scalar in [1, n - 1] by rejection */
+static int random_scalar(p256_random_t random, uint32_t k[8])
+{
+    uint8_t buffer[P256_SCALAR_SIZE];
+    int ret = P256_ERROR_RANDOM;
+
+    for (int attempt = 0; attempt < P256_RANDOM_ATTEMPTS; attempt++) {
+        if (random(buffer, sizeof(buffer)) != 0) {
+            break;
+        }
+        if (sc_load(k, buffer)) {
+            ret = P256_OK;
+            break;
+        }
+    }
+
+    p256_wipe(buffer, sizeof(buffer));
+    return ret;
+}
+
+/* ========== Public Interface ========== */
+
+int p256_check_private_key(const uint8_t *private_key)
+{
+    uint32_t d[8];
+    bool valid = sc_load(d, private_key);
+    p256_wipe(d, sizeof(d));
+    return valid ? P256_OK : P256_ERROR_INVALID_KEY;
+}
+
+int p256_check_public_key(const uint8_t *public_key)
+{
+    p256_point_t q;
+    return point_load(&q, public_key) ? P256_OK : P256_ERROR_INVALID_POINT;
+}
+
+int p256_public_key(const uint8_t *private_key, uint8_t *public_key)
+{
+    uint32_t d[8], x[8], y[8];
+    p256_point_t q;
+
+    if (!sc_load(d, private_key)) {
+        p256_wipe(d, sizeof(d));
+        return P256_ERROR_INVALID_KEY;
+    }
+
+    point_mul_base(&q, d);
+    point_to_affine(x, y, &q);
+    store_be256(&public_key[0], x);
+    store_be256(&public_key[32], y);
+
+    p256_wipe(d, sizeof(d));
+    return P256_OK;
+}
+
+int p256_generate_keypair(p256_random_t random, uint8_t *private_key, uint8_t *public_key)
+{
+    uint32_t d[8];
+
+    int ret = random_scalar(random, d);
+    if (ret == P256_OK) {
+        store_be256(private_key, d);
+        ret = p256_public_key(private_key, public_key);
+    }
+
+    p256_wipe(d, sizeof(d));
+    return ret;
+}
+
+int p256_keygen_start(p256_keygen_t *ctx, p256_random_t random)
+{
+    _Static_assert(sizeof(ctx->acc) == sizeof(p256_point_t), "keygen accumulator size");
+
+    p256_point_t acc;
+    point_set_infinity(&acc);
+    memcpy(ctx->acc, &acc, sizeof(acc));
+    ctx->column = P256_COMB_SPACING - 1;
+
+    int ret = random_scalar(random, ctx->k);
+    if (ret != P256_OK) {
+        p256_wipe(ctx, sizeof(*ctx));
+    }
+    return ret;
+}
+
+int p256_keygen_step(p256_keygen_t *ctx, uint8_t *private_key, uint8_t *public_key)
+{
+    p256_point_t acc;
+    memcpy(&acc, ctx->acc, sizeof(acc));
+
+    /* The comb columns, a few at a time; the inversion gets a step of its own */
+    if (ctx->column >= 0) {
+        for (int n = 0; n < P256_KEYGEN_COLUMNS_PER_STEP && ctx->column >= 0; n++) {
+            comb_column(&acc, ctx->k, ctx->column--);
+        }
+        memcpy(ctx->acc, &acc, sizeof(acc));
+        p256_wipe(&acc, sizeof(acc));
+        return P256_CONTINUE;
+    }
+
+    uint32_t x[8], y[8];
+    point_to_affine(x, y, &acc);
+    store_be256(private_key, ctx->k);
+    store_be256(&public_key[0], x);
+    store_be256(&public_key[32], y);
+
+    p256_wipe(&acc, sizeof(acc));
+    p256_wipe(ctx, sizeof(*ctx));
+    return P256_OK;
+}
+
+int p256_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, p256_random_t random,
+                    uint8_t *signature)
+{
+    uint32_t d[8], e[8], k[8], r[8], s[8], t[8];
+    p256_point_t kg;
+    int ret = P256_ERROR_INVALID_KEY;
+
+    if (!sc_load(d, private_key)) {
+        goto cleanup;
+    }
+
+    load_be256(e, hash);
+    reduce_once(e, e, P256_N);
+
+    for (int attempt = 0; attempt < P256_RANDOM_ATTEMPTS; attempt++) {
+        ret = random_scalar(random, k);
+        if (ret != P256_OK) {
+            break;
+        }
+
+        /* r = x(kG) mod n */
+        point_mul_base(&kg, k);
+        point_to_affine(r, NULL, &kg);
+        reduce_once(r, r, P256_N);
+        if (is_zero256(r)) {
+            ret = P256_ERROR_RANDOM;
+            continue;
+        }
+
+        /* s = k^-1 (e + r d) mod n, with k^-1 and r in the Montgomery domain */
+        sc_to_mont(k, k);
+        sc_inv_mont(k, k);
+        sc_to_mont(t, r);
+        sc_mont_mul(t, t, d);
+        sc_add(t, t, e);
+        sc_mont_mul(s, k, t);
+        if (is_zero256(s)) {
+            ret = P256_ERROR_RANDOM;
+            continue;
+        }
+
+        store_be256(&signature[0], r);
+        store_be256(&signature[32], s);
+        ret = P256_OK;
+        break;
+    }
+
+cleanup:
+    p256_wipe(d, sizeof(d));
+    p256_wipe(k, sizeof(k));
+    p256_wipe(t, sizeof(t));
+    p256_wipe(&kg, sizeof(kg));
+    return ret;
+}
+
+int p256_ecdsa_verify(const uint8_t *public_key, const uint8_t *hash, const uint8_t *signature)
+{
+    uint32_t e[8], r[8], s[8], w[8], u1[8], u2[8], x[8];
+    p256_point_t q, a, b;
+
+    if (!point_load(&q, public_key)) {
+        return P256_ERROR_INVALID_POINT;
+    }
+    if (!sc_load(r, &signature[0]) || !sc_load(s, &signature[32])) {
+        return P256_ERROR_INVALID_SIGNATURE;
+    }
+
+    load_be256(e, hash);
+    reduce_once(e, e, P256_N);
+
+    /* u1 = e / s, u2 = r / s */
+    sc_to_mont(w, s);
+    sc_inv_mont(w, w);
+    sc_mont_mul(u1, w, e);
+    sc_mont_mul(u2, w, r);
+
+    point_mul_base(&a, u1);
+    point_mul_ladder(&b, u2, &q);
+    point_add(&a, &a, &b);
+    if (!point_to_affine(x, NULL, &a)) {
+        return P256_ERROR_INVALID_SIGNATURE;
+    }
+
+    reduce_once(x, x, P256_N);
+    return (memcmp(x, r, sizeof(x)) == 0) ? P256_OK : P256_ERROR_INVALID_SIGNATURE;
+}
+
+int p256_ecdh(const uint8_t *private_key, const uint8_t *peer_public_key, uint8_t *shared_secret)
+{
+    uint32_t d[8], x[8];
+    p256_point_t q;
+    int ret = P256_OK;
+
+    if (!sc_load(d, private_key)) {
+        ret = P256_ERROR_INVALID_KEY;
+    } else if (!point_load(&q, peer_public_key)) {
+        ret = P256_ERROR_INVALID_POINT;
+    } else {
+        /* The group has prime order, so d * Q is never infinity here */
+        point_mul_ladder(&q, d, &q);
+        point_to_affine(x, NULL, &q);
+        store_be256(shared_secret, x);
+    }
+
+    p256_wipe(d, sizeof(d));
+    p256_wipe(x, sizeof(x));
+    p256_wipe(&q, sizeof(q));
+    return ret;
+}
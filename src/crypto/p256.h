@@ -0,0 +1,156 @@
+/**
+ * @file p256.h
+ * @brief Constant-Time NIST P-256
+ *
+ * Self-contained P-256 used by crypto.c for key generation, ECDSA and ECDH.
+ * Field elements are eight 32-bit limbs reduced with the NIST fast
+ * reduction; scalars modulo the group order use 32-bit Montgomery
+ * multiplication. Base-point multiplication walks a precomputed comb
+ * table, and ECDH uses a Montgomery ladder. Both use complete addition
+ * formulas and constant-time table lookups and swaps, so their timing does
+ * not depend on secret scalars.
+ *
+ * Keys and signatures use the same big-endian encodings as crypto.h:
+ * private keys are 32 bytes, public keys are X || Y (64 bytes), and
+ * signatures are r || s (64 bytes).
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef P256_H
+#define P256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* P-256 Return Codes */
+#define P256_OK 0
+#define P256_ERROR_INVALID_KEY -1       /* Private key is 0 or not below the group order */
+#define P256_ERROR_INVALID_POINT -2     /* Public key is not a point on the curve */
+#define P256_ERROR_INVALID_SIGNATURE -3 /* Signature does not verify */
+#define P256_ERROR_RANDOM -4            /* Random source failed */
+#define P256_CONTINUE 1                 /* Stepped operation not finished yet */
+
+#define P256_SCALAR_SIZE 32
+#define P256_POINT_SIZE 64
+#define P256_SIGNATURE_SIZE 64
+
+/* Comb columns (one doubling and one addition each) per p256_keygen_step() */
+#define P256_KEYGEN_COLUMNS_PER_STEP 8
+
+/**
+ * @brief Random byte source
+ *
+ * @return 0 on success, non-zero on failure
+ */
+typedef int (*p256_random_t)(uint8_t *buffer, size_t len);
+
+/**
+ * @brief Check that a private key lies in [1, n - 1]
+ *
+ * @return P256_OK or P256_ERROR_INVALID_KEY
+ */
+int p256_check_private_key(const uint8_t *private_key);
+
+/**
+ * @brief Check that a public key is a point on the curve
+ *
+ * @return P256_OK or P256_ERROR_INVALID_POINT
+ */
+int p256_check_public_key(const uint8_t *public_key);
+
+/**
+ * @brief Derive the public key of a private key
+ *
+ * @param private_key Private key (32 bytes)
+ * @param public_key Output public key (64 bytes)
+ * @return P256_OK or P256_ERROR_INVALID_KEY
+ */
+int p256_public_key(const uint8_t *private_key, uint8_t *public_key);
+
+/**
+ * @brief Generate a key pair
+ *
+ * @param random Random byte source
+ * @param private_key Output private key (32 bytes)
+ * @param public_key Output public key (64 bytes)
+ * @return P256_OK or P256_ERROR_RANDOM
+ */
+int p256_generate_keypair(p256_random_t random, uint8_t *private_key, uint8_t *public_key);
+
+/**
+ * @brief Key pair generation in progress
+ *
+ * Holds the secret scalar; treat as opaque and let p256_keygen_step() wipe it.
+ */
+typedef struct {
+    uint32_t k[8];
+    uint32_t acc[24]; /* Projective accumulator */
+    int column;       /* Next comb column, negative once only the inversion is left */
+} p256_keygen_t;
+
+/**
+ * @brief Start generating a key pair in bounded steps
+ *
+ * For callers with a latency bound, such as idle-time work: the same
+ * result as p256_generate_keypair(), spread over several
+ * p256_keygen_step() calls that each cost at most one field inversion.
+ *
+ * @param ctx Generation state
+ * @param random Random byte source
+ * @return P256_OK or P256_ERROR_RANDOM
+ */
+int p256_keygen_start(p256_keygen_t *ctx, p256_random_t random);
+
+/**
+ * @brief Run the next step of a key pair generation
+ *
+ * @param ctx Generation state from p256_keygen_start()
+ * @param private_key Output private key (32 bytes), written on the last step
+ * @param public_key Output public key (64 bytes), written on the last step
+ * @return P256_CONTINUE while steps remain, P256_OK once the keys are out
+ */
+int p256_keygen_step(p256_keygen_t *ctx, uint8_t *private_key, uint8_t *public_key);
+
+/**
+ * @brief Sign a message hash with ECDSA
+ *
+ * @param private_key Private key (32 bytes)
+ * @param hash Message hash (32 bytes)
+ * @param random Random byte source for the per-signature nonce
+ * @param signature Output signature (64 bytes)
+ * @return P256_OK, P256_ERROR_INVALID_KEY or P256_ERROR_RANDOM
+ */
+int p256_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, p256_random_t random,
+                    uint8_t *signature);
+
+/**
+ * @brief Verify an ECDSA signature
+ *
+ * @param public_key Public key (64 bytes)
+ * @param hash Message hash (32 bytes)
+ * @param signature Signature (64 bytes)
+ * @return P256_OK, P256_ERROR_INVALID_POINT or P256_ERROR_INVALID_SIGNATURE
+ */
+int p256_ecdsa_verify(const uint8_t *public_key, const uint8_t *hash, const uint8_t *signature);
+
+/**
+ * @brief Compute an ECDH shared secret
+ *
+ * @param private_key Private key (32 bytes)
+ * @param peer_public_key Peer public key (64 bytes), checked to be on the curve
+ * @param shared_secret Output X coordinate of the shared point (32 bytes)
+ * @return P256_OK, P256_ERROR_INVALID_KEY or P256_ERROR_INVALID_POINT
+ */
+int p256_ecdh(const uint8_t *private_key, const uint8_t *peer_public_key, uint8_t *shared_secret);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* P256_H */
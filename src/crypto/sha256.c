@@ -0,0 +1,456 @@
+/**
+ * @file sha256.c
+ * @brief SHA-256 Kernel Implementation
+ *
+ * The portable kernel is written for Cortex-M4: all 64 rounds are unrolled
+ * and the eight working variables are renamed from round to round instead of
+ * shifted, so they stay in registers and each round is a handful of
+ * rotate-folded EORs and ADDs. The message schedule is a 16-word ring
+ * expanded in place.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "sha256.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(OPENFIDO_HOST) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_HAVE_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(OPENFIDO_HOST) && defined(__aarch64__) && defined(__linux__)
+#define SHA256_HAVE_ARMV8 1
+#include <arm_neon.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+/**
+ * @brief Block function: absorb @p blocks consecutive 64-byte blocks
+ */
+typedef void (*sha256_compress_t)(uint32_t state[8], const uint8_t *data, size_t blocks);
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+    0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+    0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+    0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+    0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+    0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+    0xc67178f2};
+
+static const uint32_t sha256_iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+/* ========== Portable Kernel ========== */
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define BSIG0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define BSIG1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SSIG0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SSIG1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+#define CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) |
+           (uint32_t) p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+/* Wipe that the compiler cannot drop as a dead store */
+static void sha256_wipe(void *ptr, size_t len)
+{
+    volatile uint8_t *p = (volatile uint8_t *) ptr;
+    while (len--) {
+        *p++ = 0;
+    }
+}
+
+/* Message word i: rounds 0-15 load it, later rounds expand it in the ring */
+#define W_LOAD(i) (w[(i)] = load_be32(data + 4 * (i)))
+#define W_EXPAND(i) \
+    (w[(i) & 15] += SSIG1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + SSIG0(w[((i) - 15) & 15]))
+
+/* One round; the caller rotates the variable names instead of the values */
+#define ROUND(a, b, c, d, e, f, g, h, i, W)                       \
+    do {                                                          \
+        uint32_t t1 = (h) + BSIG1(e) + CH(e, f, g) + K[i] + W(i); \
+        (d) += t1;                                                \
+        (h) = t1 + BSIG0(a) + MAJ(a, b, c);                       \
+    } while (0)
+
+#define ROUNDS_8(i, W)                             \
+    do {                                           \
+        ROUND(a, b, c, d, e, f, g, h, (i) + 0, W); \
+        ROUND(h, a, b, c, d, e, f, g, (i) + 1, W); \
+        ROUND(g, h, a, b, c, d, e, f, (i) + 2, W); \
+        ROUND(f, g, h, a, b, c, d, e, (i) + 3, W); \
+        ROUND(e, f, g, h, a, b, c, d, (i) + 4, W); \
+        ROUND(d, e, f, g, h, a, b, c, (i) + 5, W); \
+        ROUND(c, d, e, f, g, h, a, b, (i) + 6, W); \
+        ROUND(b, c, d, e, f, g, h, a, (i) + 7, W); \
+    } while (0)
+
+static void sha256_compress_generic(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    uint32_t w[16];
+
+    while (blocks--) {
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        uint32_t f = state[5];
+        uint32_t g = state[6];
+        uint32_t h = state[7];
+
+        ROUNDS_8(0, W_LOAD);
+        ROUNDS_8(8, W_LOAD);
+        ROUNDS_8(16, W_EXPAND);
+        ROUNDS_8(24, W_EXPAND);
+        ROUNDS_8(32, W_EXPAND);
+        ROUNDS_8(40, W_EXPAND);
+        ROUNDS_8(48, W_EXPAND);
+        ROUNDS_8(56, W_EXPAND);
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    /* The schedule is derived from the message, which may be secret */
+    sha256_wipe(w, sizeof(w));
+}
+
+/* ========== x86 SHA Extensions ========== */
+
+#ifdef SHA256_HAVE_SHA_NI
+
+/* Four rounds: message words m plus constants K[k..k+3] */
+#define SHANI_ROUNDS_4(m, k)                                                       \
+    do {                                                                           \
+        __m128i wk = _mm_add_epi32((m), _mm_loadu_si128((const __m128i *) &K[k])); \
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);                              \
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));     \
+    } while (0)
+
+/* m0 = W[t-16..t-13] becomes W[t..t+3] */
+#define SHANI_SCHEDULE(m0, m1, m2, m3)                                                    \
+    ((m0) = _mm_sha256msg2_epu32(                                                         \
+         _mm_add_epi32(_mm_sha256msg1_epu32((m0), (m1)), _mm_alignr_epi8((m3), (m2), 4)), \
+         (m3)))
+
+__attribute__((target("sha,sse4.1,ssse3"))) static void
+sha256_compress_sha_ni(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    /* The instructions want the state as ABEF / CDGH */
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &state[0]), 0xB1);
+    __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &state[4]), 0x1B);
+    __m128i abef = _mm_alignr_epi8(tmp, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);
+
+    while (blocks--) {
+        __m128i abef_saved = abef;
+        __m128i cdgh_saved = cdgh;
+
+        __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), bswap);
+        __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), bswap);
+        __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), bswap);
+        __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), bswap);
+
+        SHANI_ROUNDS_4(m0, 0);
+        SHANI_ROUNDS_4(m1, 4);
+        SHANI_ROUNDS_4(m2, 8);
+        SHANI_ROUNDS_4(m3, 12);
+
+        for (int k = 16; k < 64; k += 16) {
+            SHANI_SCHEDULE(m0, m1, m2, m3);
+            SHANI_ROUNDS_4(m0, k);
+            SHANI_SCHEDULE(m1, m2, m3, m0);
+            SHANI_ROUNDS_4(m1, k + 4);
+            SHANI_SCHEDULE(m2, m3, m0, m1);
+            SHANI_ROUNDS_4(m2, k + 8);
+            SHANI_SCHEDULE(m3, m0, m1, m2);
+            SHANI_ROUNDS_4(m3, k + 12);
+        }
+
+        abef = _mm_add_epi32(abef, abef_saved);
+        cdgh = _mm_add_epi32(cdgh, cdgh_saved);
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    /* Back to ABCD / EFGH */
+    tmp = _mm_shuffle_epi32(abef, 0x1B);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i *) &state[0], _mm_blend_epi16(tmp, cdgh, 0xF0));
+    _mm_storeu_si128((__m128i *) &state[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+static bool sha_ni_supported(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    /* SSSE3 and SSE4.1 */
+    if (!(ecx & (1u << 9)) || !(ecx & (1u << 19))) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & (1u << 29)) != 0;
+}
+
+#endif /* SHA256_HAVE_SHA_NI */
+
+/* ========== ARMv8 Crypto Extensions ========== */
+
+#ifdef SHA256_HAVE_ARMV8
+
+#define ARMV8_ROUNDS_4(m, k)                              \
+    do {                                                  \
+        uint32x4_t wk = vaddq_u32((m), vld1q_u32(&K[k])); \
+        uint32x4_t abcd_in = abcd;                        \
+        abcd = vsha256hq_u32(abcd, efgh, wk);             \
+        efgh = vsha256h2q_u32(efgh, abcd_in, wk);         \
+    } while (0)
+
+#define ARMV8_SCHEDULE(m0, m1, m2, m3) \
+    ((m0) = vsha256su1q_u32(vsha256su0q_u32((m0), (m1)), (m2), (m3)))
+
+__attribute__((target("+crypto"))) static void
+sha256_compress_armv8(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    uint32x4_t abcd = vld1q_u32(&state[0]);
+    uint32x4_t efgh = vld1q_u32(&state[4]);
+
+    while (blocks--) {
+        uint32x4_t abcd_saved = abcd;
+        uint32x4_t efgh_saved = efgh;
+
+        uint32x4_t m0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 0)));
+        uint32x4_t m1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+        uint32x4_t m2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+        uint32x4_t m3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+        ARMV8_ROUNDS_4(m0, 0);
+        ARMV8_ROUNDS_4(m1, 4);
+        ARMV8_ROUNDS_4(m2, 8);
+        ARMV8_ROUNDS_4(m3, 12);
+
+        for (int k = 16; k < 64; k += 16) {
+            ARMV8_SCHEDULE(m0, m1, m2, m3);
+            ARMV8_ROUNDS_4(m0, k);
+            ARMV8_SCHEDULE(m1, m2, m3, m0);
+            ARMV8_ROUNDS_4(m1, k + 4);
+            ARMV8_SCHEDULE(m2, m3, m0, m1);
+            ARMV8_ROUNDS_4(m2, k + 8);
+            ARMV8_SCHEDULE(m3, m0, m1, m2);
+            ARMV8_ROUNDS_4(m3, k + 12);
+        }
+
+        abcd = vaddq_u32(abcd, abcd_saved);
+        efgh = vaddq_u32(efgh, efgh_saved);
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    vst1q_u32(&state[0], abcd);
+    vst1q_u32(&state[4], efgh);
+}
+
+static bool armv8_supported(void)
+{
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+
+#endif /* SHA256_HAVE_ARMV8 */
+
+/* ========== Backend Selection ========== */
+
+static const struct {
+    const char *name;
+    sha256_compress_t compress;
+} sha256_backends[SHA256_BACKEND_COUNT] = {
+    [SHA256_BACKEND_GENERIC] = {"generic", sha256_compress_generic},
+#ifdef SHA256_HAVE_SHA_NI
+    [SHA256_BACKEND_SHA_NI] = {"sha-ni", sha256_compress_sha_ni},
+#else
+    [SHA256_BACKEND_SHA_NI] = {"sha-ni", NULL},
+#endif
+#ifdef SHA256_HAVE_ARMV8
+    [SHA256_BACKEND_ARMV8] = {"armv8-ce", sha256_compress_armv8},
+#else
+    [SHA256_BACKEND_ARMV8] = {"armv8-ce", NULL},
+#endif
+};
+
+/* Process-wide: the CPU is the same for every host context */
+static atomic_int sha256_active = SHA256_BACKEND_GENERIC;
+
+static inline sha256_compress_t sha256_compress(void)
+{
+    return sha256_backends[atomic_load_explicit(&sha256_active, memory_order_relaxed)].compress;
+}
+
+bool sha256_backend_available(sha256_backend_t backend)
+{
+    switch (backend) {
+        case SHA256_BACKEND_GENERIC:
+            return true;
+#ifdef SHA256_HAVE_SHA_NI
+        case SHA256_BACKEND_SHA_NI:
+            return sha_ni_supported();
+#endif
+#ifdef SHA256_HAVE_ARMV8
+        case SHA256_BACKEND_ARMV8:
+            return armv8_supported();
+#endif
+        default:
+            return false;
+    }
+}
+
+int sha256_set_backend(sha256_backend_t backend)
+{
+    if (!sha256_backend_available(backend)) {
+        return SHA256_ERROR_NOT_SUPPORTED;
+    }
+
+    atomic_store_explicit(&sha256_active, (int) backend, memory_order_relaxed);
+    return SHA256_OK;
+}
+
+sha256_backend_t sha256_get_backend(void)
+{
+    return (sha256_backend_t) atomic_load_explicit(&sha256_active, memory_order_relaxed);
+}
+
+const char *sha256_backend_name(sha256_backend_t backend)
+{
+    return (backend < SHA256_BACKEND_COUNT) ? sha256_backends[backend].name : "unknown";
+}
+
+sha256_backend_t sha256_select_backend(void)
+{
+    sha256_backend_t best = SHA256_BACKEND_GENERIC;
+
+    if (sha256_backend_available(SHA256_BACKEND_SHA_NI)) {
+        best = SHA256_BACKEND_SHA_NI;
+    } else if (sha256_backend_available(SHA256_BACKEND_ARMV8)) {
+        best = SHA256_BACKEND_ARMV8;
+    }
+
+    sha256_set_backend(best);
+    return best;
+}
+
+/* ========== Hash Interface ========== */
+
+void sha256_init(sha256_ctx_t *ctx)
+{
+    memcpy(ctx->state, sha256_iv, sizeof(ctx->state));
+    ctx->length = 0;
+    ctx->buffer_len = 0;
+}
+
+void sha256_update(sha256_ctx_t *ctx, const uint8_t *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+
+    sha256_compress_t compress = sha256_compress();
+    ctx->length += len;
+
+    if (ctx->buffer_len > 0) {
+        size_t take = SHA256_BLOCK_SIZE - ctx->buffer_len;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(&ctx->buffer[ctx->buffer_len], data, take);
+        ctx->buffer_len += take;
+        data += take;
+        len -= take;
+
+        if (ctx->buffer_len < SHA256_BLOCK_SIZE) {
+            return;
+        }
+        compress(ctx->state, ctx->buffer, 1);
+        ctx->buffer_len = 0;
+    }
+
+    /* Whole blocks straight from the caller's buffer */
+    size_t blocks = len / SHA256_BLOCK_SIZE;
+    if (blocks > 0) {
+        compress(ctx->state, data, blocks);
+        data += blocks * SHA256_BLOCK_SIZE;
+        len -= blocks * SHA256_BLOCK_SIZE;
+    }
+
+    if (len > 0) {
+        memcpy(ctx->buffer, data, len);
+        ctx->buffer_len = len;
+    }
+}
+
+void sha256_final(sha256_ctx_t *ctx, uint8_t *digest)
+{
+    sha256_compress_t compress = sha256_compress();
+    uint64_t bits = ctx->length * 8;
+    size_t used = ctx->buffer_len;
+
+    ctx->buffer[used++] = 0x80;
+    if (used > SHA256_BLOCK_SIZE - 8) {
+        memset(&ctx->buffer[used], 0, SHA256_BLOCK_SIZE - used);
+        compress(ctx->state, ctx->buffer, 1);
+        used = 0;
+    }
+    memset(&ctx->buffer[used], 0, SHA256_BLOCK_SIZE - 8 - used);
+    store_be32(&ctx->buffer[SHA256_BLOCK_SIZE - 8], (uint32_t) (bits >> 32));
+    store_be32(&ctx->buffer[SHA256_BLOCK_SIZE - 4], (uint32_t) bits);
+    compress(ctx->state, ctx->buffer, 1);
+
+    for (int i = 0; i < 8; i++) {
+        store_be32(&digest[4 * i], ctx->state[i]);
+    }
+
+    sha256_wipe(ctx, sizeof(*ctx));
+}
+
+void sha256(const uint8_t *data, size_t len, uint8_t *digest)
+{
+    sha256_ctx_t ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, digest);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file sha256.h
+ * @brief SHA-256 Kernel
+ *
+ * Standalone SHA-256 used by crypto.c for hashing and HMAC. The block
+ * function comes in several backends: a fully unrolled portable kernel that
+ * keeps the working variables in registers (the one Cortex-M4 parts run),
+ * and on host builds the x86 SHA extensions and the ARMv8 crypto
+ * extensions. The fastest backend the CPU supports is picked once by
+ * sha256_select_backend(), which crypto_init() calls.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SHA-256 Return Codes */
+#define SHA256_OK 0
+#define SHA256_ERROR_NOT_SUPPORTED -1
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+/**
+ * @brief Block function implementations
+ */
+typedef enum {
+    SHA256_BACKEND_GENERIC = 0, /**< Portable unrolled C */
+    SHA256_BACKEND_SHA_NI,      /**< x86 SHA extensions (host builds) */
+    SHA256_BACKEND_ARMV8,       /**< ARMv8 crypto extensions (host builds) */
+    SHA256_BACKEND_COUNT
+} sha256_backend_t;
+
+/**
+ * @brief Incremental SHA-256 state
+ *
+ * Plain data: a context may be copied to fork a computation, which is how
+ * cached HMAC keys are reused.
+ */
+typedef struct {
+    uint32_t state[8];                 /**< Chaining value */
+    uint64_t length;                   /**< Bytes absorbed so far */
+    uint8_t buffer[SHA256_BLOCK_SIZE]; /**< Partial block */
+    size_t buffer_len;                 /**< Bytes in buffer */
+} sha256_ctx_t;
+
+/**
+ * @brief Start a SHA-256 computation
+ *
+ * @param ctx Context to initialize
+ */
+void sha256_init(sha256_ctx_t *ctx);
+
+/**
+ * @brief Absorb data
+ *
+ * @param ctx Context started with sha256_init()
+ * @param data Input data (may be NULL if len is 0)
+ * @param len Length of input data
+ */
+void sha256_update(sha256_ctx_t *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Pad, output the digest and wipe the context
+ *
+ * @param ctx Context
+ * @param digest Output digest (32 bytes)
+ */
+void sha256_final(sha256_ctx_t *ctx, uint8_t *digest);
+
+/**
+ * @brief One-shot SHA-256
+ *
+ * @param data Input data (may be NULL if len is 0)
+ * @param len Length of input data
+ * @param digest Output digest (32 bytes)
+ */
+void sha256(const uint8_t *data, size_t len, uint8_t *digest);
+
+/**
+ * @brief Switch to the fastest backend this CPU supports
+ *
+ * @return Backend now in use
+ */
+sha256_backend_t sha256_select_backend(void);
+
+/**
+ * @brief Check whether a backend is built in and supported by this CPU
+ */
+bool sha256_backend_available(sha256_backend_t backend);
+
+/**
+ * @brief Force a backend (tests and benchmarks)
+ *
+ * @param backend Backend to use
+ * @return SHA256_OK, or SHA256_ERROR_NOT_SUPPORTED if it is not available
+ */
+int sha256_set_backend(sha256_backend_t backend);
+
+/**
+ * @brief Get the backend in use
+ */
+sha256_backend_t sha256_get_backend(void);
+
+/**
+ * @brief Get a printable backend name
+ */
+const char *sha256_backend_name(sha256_backend_t backend);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHA256_H */
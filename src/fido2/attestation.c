@@ -0,0 +1,189 @@
+/**
+ * @file attestation.c
+ * @brief Attestation Key and Certificate Chain Cache Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "attestation.h"
+
+#include <string.h>
+
+#include "cbor.h"
+#include "crypto.h"
+#include "logger.h"
+#include "module_state.h"
+#include "storage.h"
+
+/* "x5c" key, array header and one byte-string header per certificate */
+#define ATTESTATION_X5C_OVERHEAD (4 + 1 + 3 * ATTESTATION_MAX_CHAIN)
+
+static OPENFIDO_STATE struct {
+    bool loaded;
+    crypto_ecdsa_key_t key;
+    uint8_t chain[STORAGE_ATT_CERT_MAX_SIZE];
+    size_t cert_offset[ATTESTATION_MAX_CHAIN];
+    size_t cert_len[ATTESTATION_MAX_CHAIN];
+    size_t cert_count;
+    uint8_t x5c[STORAGE_ATT_CERT_MAX_SIZE + ATTESTATION_X5C_OVERHEAD];
+    size_t x5c_len;
+} att_state = {0};
+OPENFIDO_STATE_REGISTER(att_state);
+
+/**
+ * @brief Get the total length of the DER element at the start of @p der
+ *
+ * @return Element length including its header, or 0 if malformed
+ */
+static size_t der_element_length(const uint8_t *der, size_t len)
+{
+    size_t header;
+    size_t body;
+
+    if (len < 2 || der[0] != 0x30) {
+        return 0;
+    }
+
+    if (der[1] < 0x80) {
+        header = 2;
+        body = der[1];
+    } else if (der[1] == 0x81 && len >= 3) {
+        header = 3;
+        body = der[2];
+    } else if (der[1] == 0x82 && len >= 4) {
+        header = 4;
+        body = ((size_t) der[2] << 8) | der[3];
+    } else {
+        return 0;
+    }
+
+    return (header + body <= len) ? header + body : 0;
+}
+
+/**
+ * @brief Split the stored chain into certificates and pre-encode x5c
+ */
+static int load_chain(void)
+{
+    size_t chain_len = 0;
+    size_t offset = 0;
+
+    if (storage_get_attestation_cert(att_state.chain, sizeof(att_state.chain), &chain_len) !=
+        STORAGE_OK) {
+        return ATTESTATION_ERROR;
+    }
+
+    while (offset < chain_len) {
+        size_t cert_len = der_element_length(&att_state.chain[offset], chain_len - offset);
+        if (cert_len == 0 || att_state.cert_count == ATTESTATION_MAX_CHAIN) {
+            LOG_WARN("Attestation certificate chain malformed, ignoring it");
+            att_state.cert_count = 0;
+            return ATTESTATION_ERROR;
+        }
+
+        att_state.cert_offset[att_state.cert_count] = offset;
+        att_state.cert_len[att_state.cert_count] = cert_len;
+        att_state.cert_count++;
+        offset += cert_len;
+    }
+
+    if (att_state.cert_count == 0) {
+        return ATTESTATION_OK;
+    }
+
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, att_state.x5c, sizeof(att_state.x5c));
+    cbor_encode_text(&encoder, "x5c", 3);
+    cbor_encode_array_start(&encoder, att_state.cert_count);
+    for (size_t i = 0; i < att_state.cert_count; i++) {
+        cbor_encode_bytes(&encoder, &att_state.chain[att_state.cert_offset[i]],
+                          att_state.cert_len[i]);
+    }
+    att_state.x5c_len = cbor_encoder_get_size(&encoder);
+
+    return ATTESTATION_OK;
+}
+
+int attestation_load(void)
+{
+    uint8_t private_key[32];
+
+    attestation_clear();
+
+    if (storage_get_attestation_key(private_key) != STORAGE_OK) {
+        return ATTESTATION_ERROR;
+    }
+
+    int ret = crypto_ecdsa_key_init(&att_state.key, private_key);
+    crypto_secure_zero(private_key, sizeof(private_key));
+    if (ret != CRYPTO_OK) {
+        LOG_ERROR("Failed to load attestation key");
+        return ATTESTATION_ERROR;
+    }
+
+    /* A bad chain is not fatal: attestation falls back to no x5c */
+    load_chain();
+
+    att_state.loaded = true;
+    LOG_INFO("Attestation loaded (%u certificates)", (unsigned) att_state.cert_count);
+    return ATTESTATION_OK;
+}
+
+int attestation_sign(const uint8_t *hash, uint8_t *signature)
+{
+    if (hash == NULL || signature == NULL) {
+        return ATTESTATION_ERROR_INVALID_PARAM;
+    }
+
+    if (!att_state.loaded && attestation_load() != ATTESTATION_OK) {
+        return ATTESTATION_ERROR;
+    }
+
+    if (crypto_ecdsa_key_sign(&att_state.key, hash, signature) != CRYPTO_OK) {
+        return ATTESTATION_ERROR;
+    }
+
+    return ATTESTATION_OK;
+}
+
+size_t attestation_chain_count(void)
+{
+    return att_state.cert_count;
+}
+
+int attestation_get_x5c(const uint8_t **x5c, size_t *x5c_len)
+{
+    if (x5c == NULL || x5c_len == NULL) {
+        return ATTESTATION_ERROR_INVALID_PARAM;
+    }
+
+    if (att_state.cert_count == 0) {
+        return ATTESTATION_ERROR_NO_CHAIN;
+    }
+
+    *x5c = att_state.x5c;
+    *x5c_len = att_state.x5c_len;
+    return ATTESTATION_OK;
+}
+
+int attestation_get_cert(size_t index, const uint8_t **cert, size_t *cert_len)
+{
+    if (cert == NULL || cert_len == NULL) {
+        return ATTESTATION_ERROR_INVALID_PARAM;
+    }
+
+    if (index >= att_state.cert_count) {
+        return ATTESTATION_ERROR_NO_CHAIN;
+    }
+
+    *cert = &att_state.chain[att_state.cert_offset[index]];
+    *cert_len = att_state.cert_len[index];
+    return ATTESTATION_OK;
+}
+
+void attestation_clear(void)
+{
+    crypto_ecdsa_key_free(&att_state.key);
+    memset(&att_state, 0, sizeof(att_state));
+}
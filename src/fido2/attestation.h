@@ -0,0 +1,90 @@
+/**
+ * @file attestation.h
+ * @brief Attestation Key and Certificate Chain Cache
+ *
+ * Loads the attestation key into a ready-to-sign context and pre-encodes the
+ * certificate chain as the CBOR "x5c" entry of a packed attestation
+ * statement, once at boot. MakeCredential then emits the statement tail with
+ * a single copy, and neither it nor U2F registration touches flash.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef ATTESTATION_H
+#define ATTESTATION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Attestation Return Codes */
+#define ATTESTATION_OK 0
+#define ATTESTATION_ERROR -1
+#define ATTESTATION_ERROR_INVALID_PARAM -2
+#define ATTESTATION_ERROR_NO_CHAIN -3
+
+/* Maximum number of certificates in the chain */
+#define ATTESTATION_MAX_CHAIN 4
+
+/**
+ * @brief Load the attestation key and certificate chain from storage
+ *
+ * Call again after the key or chain is changed (reset or provisioning).
+ *
+ * @return ATTESTATION_OK on success, error code otherwise
+ */
+int attestation_load(void);
+
+/**
+ * @brief Sign a hash with the attestation key
+ *
+ * @param hash Message hash (32 bytes)
+ * @param signature Output signature (64 bytes: r || s)
+ * @return ATTESTATION_OK on success, error code otherwise
+ */
+int attestation_sign(const uint8_t *hash, uint8_t *signature);
+
+/**
+ * @brief Get the number of certificates in the chain
+ *
+ * @return Certificate count, 0 if no chain is provisioned
+ */
+size_t attestation_chain_count(void);
+
+/**
+ * @brief Get the pre-encoded x5c map entry
+ *
+ * The bytes are the CBOR text key "x5c" followed by the array of
+ * certificates, ready to be appended to an attStmt map.
+ *
+ * @param x5c Output pointer to the encoded entry
+ * @param x5c_len Output length
+ * @return ATTESTATION_OK, or ATTESTATION_ERROR_NO_CHAIN
+ */
+int attestation_get_x5c(const uint8_t **x5c, size_t *x5c_len);
+
+/**
+ * @brief Get one DER certificate of the chain
+ *
+ * @param index Position in the chain (0 is the leaf)
+ * @param cert Output pointer to the certificate
+ * @param cert_len Output length
+ * @return ATTESTATION_OK, or ATTESTATION_ERROR_NO_CHAIN
+ */
+int attestation_get_cert(size_t index, const uint8_t **cert, size_t *cert_len);
+
+/**
+ * @brief Drop the cached key and chain
+ */
+void attestation_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATTESTATION_H */
@@ -8,12 +8,19 @@
 
 #include <string.h>
 
+#include "attestation.h"
 #include "cbor.h"
+#include "config.h"
 #include "crypto.h"
 #include "ctap2.h"
+#include "ctap2_hmac_secret.h"
 #include "hal.h"
 #include "logger.h"
+#include "permissions.h"
+#include "pin_protocol.h"
 #include "storage.h"
+#include "trace.h"
+#include "user_presence.h"
 
 /* MakeCredential Request Keys */
 #define MC_CLIENT_DATA_HASH 0x01
@@ -25,6 +32,8 @@
 #define MC_OPTIONS 0x07
 #define MC_PIN_AUTH 0x08
 #define MC_PIN_PROTOCOL 0x09
+#define MC_ENTERPRISE_ATTESTATION 0x0A
+#define MC_ATTESTATION_FORMATS_PREFERENCE 0x0B
 
 /* MakeCredential Response Keys */
 #define MC_RESP_FMT 0x01
@@ -51,6 +60,107 @@
 static const uint8_t AAGUID[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
+/**
+ * @brief Wait for a touch while the transports keep being serviced
+ *
+ * @return CTAP2_OK on touch, KEEPALIVE_CANCEL or USER_ACTION_TIMEOUT otherwise
+ */
+static uint8_t request_user_presence(void)
+{
+    switch (up_wait(CONFIG_UP_TIMEOUT_MS)) {
+        case UP_RESULT_CONFIRMED:
+            return CTAP2_OK;
+        case UP_RESULT_CANCELLED:
+            return CTAP2_ERR_KEEPALIVE_CANCEL;
+        default:
+            return CTAP2_ERR_USER_ACTION_TIMEOUT;
+    }
+}
+
+/**
+ * @brief Decode an allowList or excludeList
+ *
+ * Descriptors whose ID cannot be one of ours (wrong length) are passed over,
+ * and at most CTAP2_MAX_CREDS_IN_LIST IDs are kept.
+ *
+ * @param decoder CBOR decoder positioned at the descriptor array
+ * @param ids Output, concatenated IDs (CTAP2_MAX_CREDS_IN_LIST entries)
+ * @param count Output number of IDs
+ * @return CTAP2 status code
+ */
+static uint8_t decode_credential_list(cbor_decoder_t *decoder, uint8_t *ids, size_t *count)
+{
+    size_t array_size;
+
+    *count = 0;
+    if (cbor_decode_array_start(decoder, &array_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    for (size_t i = 0; i < array_size; i++) {
+        size_t map_size;
+        if (cbor_decode_map_start(decoder, &map_size) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        for (size_t j = 0; j < map_size; j++) {
+            char key[16];
+            size_t key_len = sizeof(key);
+            if (cbor_decode_text(decoder, key, &key_len) != CBOR_OK) {
+                return CTAP2_ERR_INVALID_CBOR;
+            }
+
+            size_t value_start = decoder->offset;
+            if (strcmp(key, "id") == 0 && *count < CTAP2_MAX_CREDS_IN_LIST) {
+                size_t id_len = STORAGE_CREDENTIAL_ID_LENGTH;
+                if (cbor_decode_bytes(decoder, &ids[*count * STORAGE_CREDENTIAL_ID_LENGTH],
+                                      &id_len) == CBOR_OK &&
+                    id_len == STORAGE_CREDENTIAL_ID_LENGTH) {
+                    (*count)++;
+                    continue;
+                }
+                decoder->offset = value_start;
+            }
+
+            if (cbor_decoder_skip(decoder) != CBOR_OK) {
+                return CTAP2_ERR_INVALID_CBOR;
+            }
+        }
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Verify pinUvAuthParam over clientDataHash with the session token
+ *
+ * @param permission Permission the operation needs (mc or ga)
+ * @param rp_id_hash RP ID hash of the request
+ * @param client_data_hash Client data hash (32 bytes)
+ * @param pin_auth pinUvAuthParam from the request
+ * @param pin_auth_len Length of pin_auth
+ * @param pin_protocol PIN protocol from the request
+ * @return CTAP2_OK if the token authorizes the operation
+ */
+static uint8_t verify_pin_auth(uint8_t permission, const uint8_t *rp_id_hash,
+                               const uint8_t *client_data_hash, const uint8_t *pin_auth,
+                               size_t pin_auth_len, uint8_t pin_protocol)
+{
+    if (!pin_protocol_is_supported(pin_protocol)) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    switch (permissions_authorize(permission, rp_id_hash, pin_protocol, client_data_hash, 32,
+                                  pin_auth, pin_auth_len)) {
+        case PERM_OK:
+            return CTAP2_OK;
+        case PERM_ERROR_DENIED:
+            return CTAP2_ERR_UNAUTHORIZED_PERMISSION;
+        default:
+            return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+}
+
 uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
                               uint8_t *response_data, size_t *response_len)
 {
@@ -58,6 +168,7 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
 
     cbor_decoder_t decoder;
     cbor_decoder_init(&decoder, request_data, request_len);
+    TRACE_BEGIN(TRACE_SPAN_CBOR_PARSE, 0);
 
     /* Parse request map */
     uint64_t map_size;
@@ -70,8 +181,8 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
     uint8_t rp_id_hash[32];
     uint8_t user_id[64];
     size_t user_id_len = 0;
-    char user_name[64] = {0};
-    char display_name[64] = {0};
+    char user_name[STORAGE_MAX_USER_NAME_LENGTH] = {0};
+    char display_name[STORAGE_MAX_DISPLAY_NAME_LENGTH] = {0};
     int algorithm = COSE_ALG_ES256;
     bool rk = false;
     bool uv = false;
@@ -79,10 +190,20 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
     bool has_rp = false;
     bool has_user = false;
     bool has_pub_key_params = false;
-    uint8_t pin_auth[16];
+    uint8_t pin_auth[32];
     size_t pin_auth_len = 0;
     uint8_t pin_protocol = 0;
     bool has_pin_auth = false;
+    bool hmac_secret = false;
+    uint8_t exclude_ids[CTAP2_MAX_CREDS_IN_LIST * STORAGE_CREDENTIAL_ID_LENGTH];
+    size_t exclude_count = 0;
+    uint8_t cred_protect = 0;
+    uint8_t cred_blob[STORAGE_MAX_CRED_BLOB_LENGTH];
+    size_t cred_blob_len = 0;
+    bool has_cred_blob = false;
+    bool cred_blob_stored = false;
+    bool attest = true; /* packed unless the platform prefers none */
+    bool has_enterprise_attestation = false;
 
     /* Parse all parameters */
     for (uint64_t i = 0; i < map_size; i++) {
@@ -92,12 +213,15 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
         }
 
         switch (key) {
-            case MC_CLIENT_DATA_HASH:
-                if (cbor_decode_bytes(&decoder, client_data_hash, 32) != CBOR_OK) {
+            case MC_CLIENT_DATA_HASH: {
+                size_t hash_len = sizeof(client_data_hash);
+                if (cbor_decode_bytes(&decoder, client_data_hash, &hash_len) != CBOR_OK ||
+                    hash_len != sizeof(client_data_hash)) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 has_client_data_hash = true;
                 break;
+            }
 
             case MC_RP: {
                 uint64_t rp_map_size;
@@ -106,17 +230,19 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
                 }
                 for (uint64_t j = 0; j < rp_map_size; j++) {
                     char rp_key[16];
-                    if (cbor_decode_text(&decoder, rp_key, sizeof(rp_key)) != CBOR_OK) {
-                        cbor_skip_value(&decoder);
-                        cbor_skip_value(&decoder);
+                    size_t rp_key_len = sizeof(rp_key);
+                    if (cbor_decode_text(&decoder, rp_key, &rp_key_len) != CBOR_OK) {
+                        cbor_decoder_skip(&decoder);
+                        cbor_decoder_skip(&decoder);
                         continue;
                     }
                     if (strcmp(rp_key, "id") == 0) {
-                        if (cbor_decode_text(&decoder, rp_id, sizeof(rp_id)) != CBOR_OK) {
+                        size_t rp_id_len = sizeof(rp_id);
+                        if (cbor_decode_text(&decoder, rp_id, &rp_id_len) != CBOR_OK) {
                             return CTAP2_ERR_INVALID_CBOR;
                         }
                     } else {
-                        cbor_skip_value(&decoder);
+                        cbor_decoder_skip(&decoder);
                     }
                 }
                 has_rp = true;
@@ -130,27 +256,32 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
                 }
                 for (uint64_t j = 0; j < user_map_size; j++) {
                     char user_key[16];
-                    if (cbor_decode_text(&decoder, user_key, sizeof(user_key)) != CBOR_OK) {
-                        cbor_skip_value(&decoder);
-                        cbor_skip_value(&decoder);
+                    size_t user_key_len = sizeof(user_key);
+                    if (cbor_decode_text(&decoder, user_key, &user_key_len) != CBOR_OK) {
+                        cbor_decoder_skip(&decoder);
+                        cbor_decoder_skip(&decoder);
                         continue;
                     }
                     if (strcmp(user_key, "id") == 0) {
                         user_id_len = sizeof(user_id);
-                        if (cbor_decode_bytes(&decoder, user_id, user_id_len) != CBOR_OK) {
+                        if (cbor_decode_bytes(&decoder, user_id, &user_id_len) != CBOR_OK) {
                             return CTAP2_ERR_INVALID_CBOR;
                         }
                     } else if (strcmp(user_key, "name") == 0) {
-                        if (cbor_decode_text(&decoder, user_name, sizeof(user_name)) != CBOR_OK) {
+                        /* Longer names are truncated to 64 bytes, as CTAP2 allows */
+                        size_t user_name_len = sizeof(user_name);
+                        if (cbor_decode_text_truncated(&decoder, user_name, &user_name_len) !=
+                            CBOR_OK) {
                             return CTAP2_ERR_INVALID_CBOR;
                         }
                     } else if (strcmp(user_key, "displayName") == 0) {
-                        if (cbor_decode_text(&decoder, display_name, sizeof(display_name)) !=
-                            CBOR_OK) {
+                        size_t display_name_len = sizeof(display_name);
+                        if (cbor_decode_text_truncated(&decoder, display_name,
+                                                       &display_name_len) != CBOR_OK) {
                             return CTAP2_ERR_INVALID_CBOR;
                         }
                     } else {
-                        cbor_skip_value(&decoder);
+                        cbor_decoder_skip(&decoder);
                     }
                 }
                 has_user = true;
@@ -170,9 +301,10 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
                     }
                     for (uint64_t k = 0; k < param_map_size; k++) {
                         char param_key[8];
-                        if (cbor_decode_text(&decoder, param_key, sizeof(param_key)) != CBOR_OK) {
-                            cbor_skip_value(&decoder);
-                            cbor_skip_value(&decoder);
+                        size_t param_key_len = sizeof(param_key);
+                        if (cbor_decode_text(&decoder, param_key, &param_key_len) != CBOR_OK) {
+                            cbor_decoder_skip(&decoder);
+                            cbor_decoder_skip(&decoder);
                             continue;
                         }
                         if (strcmp(param_key, "alg") == 0) {
@@ -183,7 +315,7 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
                             if (j == 0)
                                 algorithm = (int) alg;
                         } else {
-                            cbor_skip_value(&decoder);
+                            cbor_decoder_skip(&decoder);
                         }
                     }
                 }
@@ -191,6 +323,60 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
                 break;
             }
 
+            case MC_EXCLUDE_LIST: {
+                uint8_t list_status = decode_credential_list(&decoder, exclude_ids, &exclude_count);
+                if (list_status != CTAP2_OK) {
+                    return list_status;
+                }
+                break;
+            }
+
+            case MC_EXTENSIONS: {
+                size_t ext_map_size;
+                if (cbor_decode_map_start(&decoder, &ext_map_size) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                for (size_t j = 0; j < ext_map_size; j++) {
+                    char ext_key[32];
+                    size_t ext_key_len = sizeof(ext_key);
+                    if (cbor_decode_text(&decoder, ext_key, &ext_key_len) != CBOR_OK) {
+                        return CTAP2_ERR_INVALID_CBOR;
+                    }
+                    if (strcmp(ext_key, CTAP2_EXT_HMAC_SECRET) == 0) {
+                        if (cbor_decode_bool(&decoder, &hmac_secret) != CBOR_OK) {
+                            return CTAP2_ERR_INVALID_CBOR;
+                        }
+                    } else if (strcmp(ext_key, CTAP2_EXT_CRED_PROTECT) == 0) {
+                        uint64_t level;
+                        if (cbor_decode_uint(&decoder, &level) != CBOR_OK) {
+                            return CTAP2_ERR_INVALID_CBOR;
+                        }
+                        if (level < STORAGE_CRED_PROTECT_UV_OPTIONAL ||
+                            level > STORAGE_CRED_PROTECT_UV_REQUIRED) {
+                            return CTAP2_ERR_INVALID_PARAMETER;
+                        }
+                        cred_protect = (uint8_t) level;
+                    } else if (strcmp(ext_key, CTAP2_EXT_CRED_BLOB) == 0) {
+                        size_t blob_start = decoder.offset;
+                        cred_blob_len = sizeof(cred_blob);
+                        cred_blob_stored = true;
+                        if (cbor_decode_bytes(&decoder, cred_blob, &cred_blob_len) != CBOR_OK) {
+                            /* Longer than maxCredBlobLength: not stored, reported as false */
+                            decoder.offset = blob_start;
+                            if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                                return CTAP2_ERR_INVALID_CBOR;
+                            }
+                            cred_blob_len = 0;
+                            cred_blob_stored = false;
+                        }
+                        has_cred_blob = true;
+                    } else {
+                        cbor_decoder_skip(&decoder);
+                    }
+                }
+                break;
+            }
+
             case MC_OPTIONS: {
                 uint64_t options_map_size;
                 if (cbor_decode_map_start(&decoder, &options_map_size) != CBOR_OK) {
@@ -198,9 +384,10 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
                 }
                 for (uint64_t j = 0; j < options_map_size; j++) {
                     char option_key[16];
-                    if (cbor_decode_text(&decoder, option_key, sizeof(option_key)) != CBOR_OK) {
-                        cbor_skip_value(&decoder);
-                        cbor_skip_value(&decoder);
+                    size_t option_key_len = sizeof(option_key);
+                    if (cbor_decode_text(&decoder, option_key, &option_key_len) != CBOR_OK) {
+                        cbor_decoder_skip(&decoder);
+                        cbor_decoder_skip(&decoder);
                         continue;
                     }
                     bool option_value;
@@ -218,30 +405,84 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
 
             case MC_PIN_AUTH:
                 pin_auth_len = sizeof(pin_auth);
-                if (cbor_decode_bytes(&decoder, pin_auth, pin_auth_len) != CBOR_OK) {
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 has_pin_auth = true;
                 break;
 
-            case MC_PIN_PROTOCOL:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &pin_protocol) != CBOR_OK) {
+            case MC_PIN_PROTOCOL: {
+                uint64_t protocol;
+                if (cbor_decode_uint(&decoder, &protocol) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                if (!pin_protocol_is_supported(protocol)) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                pin_protocol = (uint8_t) protocol;
+                break;
+            }
+
+            case MC_ENTERPRISE_ATTESTATION: {
+                uint64_t ep;
+                if (cbor_decode_uint(&decoder, &ep) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                if (ep != 1 && ep != 2) {
+                    return CTAP2_ERR_INVALID_OPTION;
+                }
+                has_enterprise_attestation = true;
                 break;
+            }
+
+            case MC_ATTESTATION_FORMATS_PREFERENCE: {
+                size_t fmt_count;
+                bool fmt_chosen = false;
+                if (cbor_decode_array_start(&decoder, &fmt_count) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                /* The first format we support wins; unknown ones are passed over */
+                for (size_t j = 0; j < fmt_count; j++) {
+                    char fmt[32];
+                    size_t fmt_len = sizeof(fmt);
+                    if (cbor_decode_text(&decoder, fmt, &fmt_len) != CBOR_OK) {
+                        return CTAP2_ERR_INVALID_CBOR;
+                    }
+                    if (fmt_chosen) {
+                        continue;
+                    }
+                    if (strcmp(fmt, CTAP2_ATT_FMT_NONE) == 0) {
+                        attest = false;
+                        fmt_chosen = true;
+                    } else if (strcmp(fmt, CTAP2_ATT_FMT_PACKED) == 0) {
+                        attest = true;
+                        fmt_chosen = true;
+                    }
+                }
+                break;
+            }
 
             default:
                 /* Skip unknown parameters */
-                cbor_skip_value(&decoder);
+                cbor_decoder_skip(&decoder);
                 break;
         }
     }
+    TRACE_END(TRACE_SPAN_CBOR_PARSE);
 
     /* Validate required parameters */
     if (!has_client_data_hash || !has_rp || !has_user || !has_pub_key_params) {
         return CTAP2_ERR_MISSING_PARAMETER;
     }
 
+    /* No "ep" option in GetInfo: enterprise attestation is not available */
+    if (has_enterprise_attestation) {
+        return CTAP2_ERR_INVALID_PARAMETER;
+    }
+
+    /* Hash RP ID */
+    crypto_sha256((const uint8_t *) rp_id, strlen(rp_id), rp_id_hash);
+
     /* Check PIN requirements */
     bool pin_required = rk || uv; /* PIN required for resident keys or when UV requested */
     bool pin_verified = false;
@@ -256,45 +497,41 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
         if (!has_pin_auth) {
             return CTAP2_ERR_PIN_REQUIRED;
         }
+    }
 
-        /* Verify PIN protocol version */
-        if (pin_protocol != 1) {
-            return CTAP2_ERR_PIN_AUTH_INVALID;
+    /* PIN auth provided (required or not): verify it against the session token */
+    if (has_pin_auth) {
+        uint8_t pin_status = verify_pin_auth(PERM_MAKE_CREDENTIAL, rp_id_hash, client_data_hash,
+                                             pin_auth, pin_auth_len, pin_protocol);
+        if (pin_status != CTAP2_OK) {
+            return pin_status;
         }
+        pin_verified = true;
+    }
 
-        /* In production: verify pinAuth using PIN token and HMAC */
-        /* For now, simplified verification - just check if PIN auth is present */
-        /* Real implementation would:
-         * 1. Verify pinAuth = HMAC-SHA256(pinToken, clientDataHash)
-         * 2. Validate PIN token hasn't expired
-         */
-        if (has_pin_auth && pin_auth_len == 16) {
-            pin_verified = true;
-            LOG_INFO("PIN verification successful (simplified)");
-        } else {
-            return CTAP2_ERR_PIN_AUTH_INVALID;
-        }
-    } else if (has_pin_auth) {
-        /* PIN auth provided but not required - still verify it */
-        if (pin_protocol != 1) {
-            return CTAP2_ERR_PIN_AUTH_INVALID;
-        }
-        if (pin_auth_len == 16) {
-            pin_verified = true;
+    /*
+     * Exclude list: every ID is resolved in one indexed pass, and only a hit
+     * is decrypted. The user is asked for presence only when one matches.
+     * Without UV, UV-required credentials do not count.
+     */
+    if (exclude_count > 0) {
+        storage_credential_t excluded;
+        uint8_t max_cred_protect = pin_verified ? STORAGE_CRED_PROTECT_UV_REQUIRED
+                                                : STORAGE_CRED_PROTECT_UV_OPTIONAL_WITH_ID;
+        if (storage_find_listed_credential(rp_id_hash, max_cred_protect, exclude_ids,
+                                           exclude_count, &excluded) == STORAGE_OK) {
+            crypto_secure_zero(&excluded, sizeof(excluded));
+            LOG_INFO("Credential excluded");
+            uint8_t up_status = request_user_presence();
+            return (up_status != CTAP2_OK) ? up_status : CTAP2_ERR_CREDENTIAL_EXCLUDED;
         }
     }
 
-    /* Hash RP ID */
-    crypto_sha256((const uint8_t *) rp_id, strlen(rp_id), rp_id_hash);
-
     /* Request user presence */
-    LOG_INFO("Waiting for user presence...");
-    hal_led_set_state(HAL_LED_BLINK_FAST);
-    if (!hal_button_wait_press(30000)) {
-        hal_led_set_state(HAL_LED_OFF);
-        return CTAP2_ERR_USER_ACTION_TIMEOUT;
+    uint8_t up_status = request_user_presence();
+    if (up_status != CTAP2_OK) {
+        return up_status;
     }
-    hal_led_set_state(HAL_LED_ON);
 
     /* Generate key pair */
     uint8_t private_key[32];
@@ -321,6 +558,10 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
     memcpy(credential.private_key, private_key, 32);
     credential.algorithm = algorithm;
     credential.resident = rk;
+    credential.hmac_secret = hmac_secret;
+    credential.protection_policy = cred_protect;
+    memcpy(credential.cred_blob, cred_blob, cred_blob_len);
+    credential.cred_blob_len = cred_blob_len;
     storage_get_and_increment_counter(&credential.sign_count);
 
     if (rk) {
@@ -347,6 +588,10 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
     /* Set UV flag if PIN was verified */
     if (pin_verified)
         flags |= CTAP2_AUTH_DATA_FLAG_UV;
+    size_t ext_count =
+        (has_cred_blob ? 1 : 0) + (cred_protect != 0 ? 1 : 0) + (hmac_secret ? 1 : 0);
+    if (ext_count > 0)
+        flags |= CTAP2_AUTH_DATA_FLAG_ED;
     auth_data[auth_data_len++] = flags;
 
     /* Sign counter (4 bytes, big-endian) */
@@ -386,28 +631,46 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
         cbor_encode_bytes(&key_encoder, &public_key[32], 32);
     }
 
+    /* Extensions, in canonical key order */
+    if (ext_count > 0) {
+        cbor_encode_map_start(&key_encoder, ext_count);
+        if (has_cred_blob) {
+            cbor_encode_text(&key_encoder, CTAP2_EXT_CRED_BLOB, strlen(CTAP2_EXT_CRED_BLOB));
+            cbor_encode_bool(&key_encoder, cred_blob_stored);
+        }
+        if (cred_protect != 0) {
+            cbor_encode_text(&key_encoder, CTAP2_EXT_CRED_PROTECT, strlen(CTAP2_EXT_CRED_PROTECT));
+            cbor_encode_uint(&key_encoder, cred_protect);
+        }
+        if (hmac_secret) {
+            cbor_encode_text(&key_encoder, CTAP2_EXT_HMAC_SECRET, strlen(CTAP2_EXT_HMAC_SECRET));
+            cbor_encode_bool(&key_encoder, true);
+        }
+    }
+
     auth_data_len += cbor_encoder_get_size(&key_encoder);
 
-    /* Build attestation statement */
-    uint8_t att_key[32];
-    storage_get_attestation_key(att_key);
+    /* Build attestation statement ("none" needs neither hash nor signature) */
+    uint8_t signature[64];
 
-    uint8_t sig_data[1024];
-    size_t sig_data_len = 0;
-    memcpy(&sig_data[sig_data_len], auth_data, auth_data_len);
-    sig_data_len += auth_data_len;
-    memcpy(&sig_data[sig_data_len], client_data_hash, 32);
-    sig_data_len += 32;
+    if (attest) {
+        uint8_t sig_data[1024];
+        size_t sig_data_len = 0;
+        memcpy(&sig_data[sig_data_len], auth_data, auth_data_len);
+        sig_data_len += auth_data_len;
+        memcpy(&sig_data[sig_data_len], client_data_hash, 32);
+        sig_data_len += 32;
 
-    uint8_t hash[32];
-    crypto_sha256(sig_data, sig_data_len, hash);
+        uint8_t hash[32];
+        crypto_sha256(sig_data, sig_data_len, hash);
 
-    uint8_t signature[64];
-    if (crypto_ecdsa_sign(att_key, hash, signature) != CRYPTO_OK) {
-        return CTAP2_ERR_PROCESSING;
+        if (attestation_sign(hash, signature) != ATTESTATION_OK) {
+            return CTAP2_ERR_PROCESSING;
+        }
     }
 
     /* Build CBOR response */
+    TRACE_BEGIN(TRACE_SPAN_ENCODE, 0);
     cbor_encoder_t encoder;
     cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
 
@@ -415,7 +678,11 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
 
     /* fmt */
     cbor_encode_uint(&encoder, MC_RESP_FMT);
-    cbor_encode_text(&encoder, "packed", 6);
+    if (attest) {
+        cbor_encode_text(&encoder, CTAP2_ATT_FMT_PACKED, strlen(CTAP2_ATT_FMT_PACKED));
+    } else {
+        cbor_encode_text(&encoder, CTAP2_ATT_FMT_NONE, strlen(CTAP2_ATT_FMT_NONE));
+    }
 
     /* authData */
     cbor_encode_uint(&encoder, MC_RESP_AUTH_DATA);
@@ -423,19 +690,30 @@ uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
 
     /* attStmt */
     cbor_encode_uint(&encoder, MC_RESP_ATT_STMT);
-    cbor_encode_map_start(&encoder, 2);
-    cbor_encode_text(&encoder, "alg", 3);
-    cbor_encode_int(&encoder, COSE_ALG_ES256);
-    cbor_encode_text(&encoder, "sig", 3);
-    cbor_encode_bytes(&encoder, signature, 64);
+    if (attest) {
+        const uint8_t *x5c = NULL;
+        size_t x5c_len = 0;
+        bool has_x5c = attestation_get_x5c(&x5c, &x5c_len) == ATTESTATION_OK;
+
+        cbor_encode_map_start(&encoder, has_x5c ? 3 : 2);
+        cbor_encode_text(&encoder, "alg", 3);
+        cbor_encode_int(&encoder, COSE_ALG_ES256);
+        cbor_encode_text(&encoder, "sig", 3);
+        cbor_encode_bytes(&encoder, signature, 64);
+        /* x5c was encoded once at boot */
+        if (has_x5c && cbor_encode_raw(&encoder, x5c, x5c_len) != CBOR_OK) {
+            return CTAP2_ERR_REQUEST_TOO_LARGE;
+        }
+    } else {
+        cbor_encode_map_start(&encoder, 0);
+    }
 
     *response_len = cbor_encoder_get_size(&encoder);
+    TRACE_END(TRACE_SPAN_ENCODE);
 
     /* Clean up */
     memset(private_key, 0, sizeof(private_key));
-    memset(att_key, 0, sizeof(att_key));
 
-    hal_led_set_state(HAL_LED_OFF);
     LOG_INFO("MakeCredential completed successfully");
     return CTAP2_OK;
 }
@@ -447,6 +725,7 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
 
     cbor_decoder_t decoder;
     cbor_decoder_init(&decoder, request_data, request_len);
+    TRACE_BEGIN(TRACE_SPAN_CBOR_PARSE, 0);
 
     /* Parse request map */
     uint64_t map_size;
@@ -460,13 +739,16 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
     bool has_rp_id = false;
     bool has_client_data_hash = false;
     bool has_allow_list = false;
-    uint8_t allow_list_ids[10][STORAGE_CREDENTIAL_ID_LENGTH];
+    uint8_t allow_list_ids[CTAP2_MAX_CREDS_IN_LIST * STORAGE_CREDENTIAL_ID_LENGTH];
     size_t allow_list_count = 0;
-    uint8_t pin_auth[16];
+    uint8_t pin_auth[32];
     size_t pin_auth_len = 0;
     uint8_t pin_protocol = 0;
     bool has_pin_auth = false;
     bool uv = false;
+    hmac_secret_input_t hmac_secret_input;
+    bool has_hmac_secret = false;
+    bool get_cred_blob = false;
 
     /* Parse all parameters */
     for (uint64_t i = 0; i < map_size; i++) {
@@ -476,46 +758,58 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
         }
 
         switch (key) {
-            case GA_RP_ID:
-                if (cbor_decode_text(&decoder, rp_id, sizeof(rp_id)) != CBOR_OK) {
+            case GA_RP_ID: {
+                size_t rp_id_len = sizeof(rp_id);
+                if (cbor_decode_text(&decoder, rp_id, &rp_id_len) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 has_rp_id = true;
                 break;
+            }
 
-            case GA_CLIENT_DATA_HASH:
-                if (cbor_decode_bytes(&decoder, client_data_hash, 32) != CBOR_OK) {
+            case GA_CLIENT_DATA_HASH: {
+                size_t hash_len = sizeof(client_data_hash);
+                if (cbor_decode_bytes(&decoder, client_data_hash, &hash_len) != CBOR_OK ||
+                    hash_len != sizeof(client_data_hash)) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 has_client_data_hash = true;
                 break;
+            }
 
             case GA_ALLOW_LIST: {
-                uint64_t array_size;
-                if (cbor_decode_array_start(&decoder, &array_size) != CBOR_OK) {
-                    return CTAP2_ERR_INVALID_CBOR;
+                uint8_t list_status =
+                    decode_credential_list(&decoder, allow_list_ids, &allow_list_count);
+                if (list_status != CTAP2_OK) {
+                    return list_status;
                 }
                 has_allow_list = true;
-                for (uint64_t j = 0; j < array_size && allow_list_count < 10; j++) {
-                    uint64_t cred_map_size;
-                    if (cbor_decode_map_start(&decoder, &cred_map_size) != CBOR_OK) {
+                break;
+            }
+
+            case GA_EXTENSIONS: {
+                size_t ext_map_size;
+                if (cbor_decode_map_start(&decoder, &ext_map_size) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                for (size_t j = 0; j < ext_map_size; j++) {
+                    char ext_key[32];
+                    size_t ext_key_len = sizeof(ext_key);
+                    if (cbor_decode_text(&decoder, ext_key, &ext_key_len) != CBOR_OK) {
                         return CTAP2_ERR_INVALID_CBOR;
                     }
-                    for (uint64_t k = 0; k < cred_map_size; k++) {
-                        char cred_key[8];
-                        if (cbor_decode_text(&decoder, cred_key, sizeof(cred_key)) != CBOR_OK) {
-                            cbor_skip_value(&decoder);
-                            cbor_skip_value(&decoder);
-                            continue;
+                    if (strcmp(ext_key, CTAP2_EXT_HMAC_SECRET) == 0) {
+                        uint8_t ext_status = hmac_secret_decode_input(&decoder, &hmac_secret_input);
+                        if (ext_status != CTAP2_OK) {
+                            return ext_status;
                         }
-                        if (strcmp(cred_key, "id") == 0) {
-                            if (cbor_decode_bytes(&decoder, allow_list_ids[allow_list_count],
-                                                  STORAGE_CREDENTIAL_ID_LENGTH) == CBOR_OK) {
-                                allow_list_count++;
-                            }
-                        } else {
-                            cbor_skip_value(&decoder);
+                        has_hmac_secret = true;
+                    } else if (strcmp(ext_key, CTAP2_EXT_GET_CRED_BLOB) == 0) {
+                        if (cbor_decode_bool(&decoder, &get_cred_blob) != CBOR_OK) {
+                            return CTAP2_ERR_INVALID_CBOR;
                         }
+                    } else {
+                        cbor_decoder_skip(&decoder);
                     }
                 }
                 break;
@@ -528,9 +822,10 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
                 }
                 for (uint64_t j = 0; j < options_map_size; j++) {
                     char option_key[16];
-                    if (cbor_decode_text(&decoder, option_key, sizeof(option_key)) != CBOR_OK) {
-                        cbor_skip_value(&decoder);
-                        cbor_skip_value(&decoder);
+                    size_t option_key_len = sizeof(option_key);
+                    if (cbor_decode_text(&decoder, option_key, &option_key_len) != CBOR_OK) {
+                        cbor_decoder_skip(&decoder);
+                        cbor_decoder_skip(&decoder);
                         continue;
                     }
                     bool option_value;
@@ -546,23 +841,30 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
 
             case GA_PIN_AUTH:
                 pin_auth_len = sizeof(pin_auth);
-                if (cbor_decode_bytes(&decoder, pin_auth, pin_auth_len) != CBOR_OK) {
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 has_pin_auth = true;
                 break;
 
-            case GA_PIN_PROTOCOL:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &pin_protocol) != CBOR_OK) {
+            case GA_PIN_PROTOCOL: {
+                uint64_t protocol;
+                if (cbor_decode_uint(&decoder, &protocol) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                if (!pin_protocol_is_supported(protocol)) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                pin_protocol = (uint8_t) protocol;
                 break;
+            }
 
             default:
-                cbor_skip_value(&decoder);
+                cbor_decoder_skip(&decoder);
                 break;
         }
     }
+    TRACE_END(TRACE_SPAN_CBOR_PARSE);
 
     /* Validate required parameters */
     if (!has_rp_id || !has_client_data_hash) {
@@ -576,21 +878,25 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
     storage_credential_t credential;
     bool found = false;
 
+    /*
+     * credProtect: without UV, UV-required credentials are invisible, and
+     * discovery only sees those that need no credential ID. A pinUvAuthParam
+     * that later fails verification aborts the request anyway.
+     */
     if (has_allow_list && allow_list_count > 0) {
         /* Search in allow list */
-        for (size_t i = 0; i < allow_list_count; i++) {
-            if (storage_find_credential(allow_list_ids[i], &credential) == STORAGE_OK) {
-                if (memcmp(credential.rp_id_hash, rp_id_hash, 32) == 0) {
-                    found = true;
-                    break;
-                }
-            }
-        }
+        uint8_t max_cred_protect = has_pin_auth ? STORAGE_CRED_PROTECT_UV_REQUIRED
+                                                : STORAGE_CRED_PROTECT_UV_OPTIONAL_WITH_ID;
+        found = storage_find_listed_credential(rp_id_hash, max_cred_protect, allow_list_ids,
+                                               allow_list_count, &credential) == STORAGE_OK;
     } else {
         /* Resident key discovery */
         storage_credential_t credentials[10];
         size_t count = 0;
-        if (storage_find_credentials_by_rp(rp_id_hash, credentials, 10, &count) == STORAGE_OK &&
+        uint8_t max_cred_protect =
+            has_pin_auth ? STORAGE_CRED_PROTECT_UV_REQUIRED : STORAGE_CRED_PROTECT_UV_OPTIONAL;
+        if (storage_find_credentials_by_rp(rp_id_hash, max_cred_protect, credentials, 10,
+                                           &count) == STORAGE_OK &&
             count > 0) {
             memcpy(&credential, &credentials[0], sizeof(storage_credential_t));
             found = true;
@@ -616,42 +922,37 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
         if (!has_pin_auth) {
             return CTAP2_ERR_PIN_REQUIRED;
         }
+    }
 
-        /* Verify PIN protocol version */
-        if (pin_protocol != 1) {
-            return CTAP2_ERR_PIN_AUTH_INVALID;
-        }
-
-        /* In production: verify pinAuth using PIN token and HMAC */
-        /* For now, simplified verification - just check if PIN auth is present */
-        /* Real implementation would:
-         * 1. Verify pinAuth = HMAC-SHA256(pinToken, clientDataHash)
-         * 2. Validate PIN token hasn't expired
-         */
-        if (has_pin_auth && pin_auth_len == 16) {
-            pin_verified = true;
-            LOG_INFO("PIN verification successful (simplified)");
-        } else {
-            return CTAP2_ERR_PIN_AUTH_INVALID;
-        }
-    } else if (has_pin_auth) {
-        /* PIN auth provided but not required - still verify it */
-        if (pin_protocol != 1) {
-            return CTAP2_ERR_PIN_AUTH_INVALID;
-        }
-        if (pin_auth_len == 16) {
-            pin_verified = true;
+    /* PIN auth provided (required or not): verify it against the session token */
+    if (has_pin_auth) {
+        uint8_t pin_status = verify_pin_auth(PERM_GET_ASSERTION, rp_id_hash, client_data_hash,
+                                             pin_auth, pin_auth_len, pin_protocol);
+        if (pin_status != CTAP2_OK) {
+            return pin_status;
         }
+        pin_verified = true;
     }
 
     /* Request user presence */
-    LOG_INFO("Waiting for user presence...");
-    hal_led_set_state(HAL_LED_BLINK_FAST);
-    if (!hal_button_wait_press(30000)) {
-        hal_led_set_state(HAL_LED_OFF);
-        return CTAP2_ERR_USER_ACTION_TIMEOUT;
+    uint8_t up_status = request_user_presence();
+    if (up_status != CTAP2_OK) {
+        return up_status;
+    }
+
+    /* hmac-secret output, only for credentials created with the extension */
+    uint8_t hmac_secret_output[HMAC_SECRET_MAX_ENC_SIZE];
+    size_t hmac_secret_output_len = 0;
+    bool hmac_secret = has_hmac_secret && credential.hmac_secret;
+    size_t ext_count = (get_cred_blob ? 1 : 0) + (hmac_secret ? 1 : 0);
+
+    if (hmac_secret) {
+        uint8_t ext_status = hmac_secret_compute(&hmac_secret_input, credential.id, pin_verified,
+                                                 hmac_secret_output, &hmac_secret_output_len);
+        if (ext_status != CTAP2_OK) {
+            return ext_status;
+        }
     }
-    hal_led_set_state(HAL_LED_ON);
 
     /* Increment counter */
     uint32_t counter;
@@ -671,6 +972,8 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
     /* Set UV flag if PIN was verified */
     if (pin_verified)
         flags |= CTAP2_AUTH_DATA_FLAG_UV;
+    if (ext_count > 0)
+        flags |= CTAP2_AUTH_DATA_FLAG_ED;
     auth_data[auth_data_len++] = flags;
 
     /* Sign counter */
@@ -679,6 +982,23 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
     auth_data[auth_data_len++] = (counter >> 8) & 0xFF;
     auth_data[auth_data_len++] = counter & 0xFF;
 
+    /* Extensions, in canonical key order; credBlob comes from the record already decrypted */
+    if (ext_count > 0) {
+        cbor_encoder_t ext_encoder;
+        cbor_encoder_init(&ext_encoder, &auth_data[auth_data_len],
+                          sizeof(auth_data) - auth_data_len);
+        cbor_encode_map_start(&ext_encoder, ext_count);
+        if (get_cred_blob) {
+            cbor_encode_text(&ext_encoder, CTAP2_EXT_CRED_BLOB, strlen(CTAP2_EXT_CRED_BLOB));
+            cbor_encode_bytes(&ext_encoder, credential.cred_blob, credential.cred_blob_len);
+        }
+        if (hmac_secret) {
+            cbor_encode_text(&ext_encoder, CTAP2_EXT_HMAC_SECRET, strlen(CTAP2_EXT_HMAC_SECRET));
+            cbor_encode_bytes(&ext_encoder, hmac_secret_output, hmac_secret_output_len);
+        }
+        auth_data_len += cbor_encoder_get_size(&ext_encoder);
+    }
+
     /* Sign auth_data + client_data_hash */
     uint8_t sig_data[512];
     size_t sig_data_len = 0;
@@ -696,6 +1016,7 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
     }
 
     /* Build CBOR response */
+    TRACE_BEGIN(TRACE_SPAN_ENCODE, 0);
     cbor_encoder_t encoder;
     cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
 
@@ -730,8 +1051,8 @@ uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uin
     }
 
     *response_len = cbor_encoder_get_size(&encoder);
+    TRACE_END(TRACE_SPAN_ENCODE);
 
-    hal_led_set_state(HAL_LED_OFF);
     LOG_INFO("GetAssertion completed successfully");
     return CTAP2_OK;
 }
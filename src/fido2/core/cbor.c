@@ -139,6 +139,18 @@ int cbor_encode_array_start(cbor_encoder_t *encoder, size_t count)
     return cbor_encode_type_value(encoder, CBOR_TYPE_ARRAY, count);
 }
 
+int cbor_encode_raw(cbor_encoder_t *encoder, const uint8_t *data, size_t len)
+{
+    if (encoder->offset + len > encoder->buffer_size) {
+        return CBOR_ERROR_OVERFLOW;
+    }
+
+    memcpy(&encoder->buffer[encoder->offset], data, len);
+    encoder->offset += len;
+
+    return CBOR_OK;
+}
+
 size_t cbor_encoder_get_size(const cbor_encoder_t *encoder)
 {
     return encoder->offset;
@@ -282,6 +294,35 @@ int cbor_decode_text(cbor_decoder_t *decoder, char *text, size_t *len)
     return CBOR_OK;
 }
 
+int cbor_decode_text_truncated(cbor_decoder_t *decoder, char *text, size_t *len)
+{
+    uint64_t text_len;
+    int ret = cbor_decode_type_value(decoder, CBOR_TYPE_TEXT, &text_len);
+    if (ret != CBOR_OK)
+        return ret;
+
+    if (text_len > decoder->buffer_size - decoder->offset || *len == 0) {
+        return CBOR_ERROR_OVERFLOW;
+    }
+
+    const uint8_t *src = &decoder->buffer[decoder->offset];
+    size_t copy_len = (size_t) text_len;
+    if (copy_len > *len - 1) {
+        copy_len = *len - 1;
+        /* Back off to the start of the UTF-8 sequence that was cut */
+        while (copy_len > 0 && (src[copy_len] & 0xC0) == 0x80) {
+            copy_len--;
+        }
+    }
+
+    memcpy(text, src, copy_len);
+    decoder->offset += (size_t) text_len;
+    text[copy_len] = '\0';
+    *len = copy_len;
+
+    return CBOR_OK;
+}
+
 int cbor_decode_bool(cbor_decoder_t *decoder, bool *value)
 {
     if (decoder->offset >= decoder->buffer_size) {
@@ -107,6 +107,11 @@ int cbor_encode_map_start(cbor_encoder_t *encoder, size_t count);
  */
 int cbor_encode_array_start(cbor_encoder_t *encoder, size_t count);
 
+/**
+ * @brief Append already-encoded CBOR items verbatim
+ */
+int cbor_encode_raw(cbor_encoder_t *encoder, const uint8_t *data, size_t len);
+
 /**
  * @brief Get encoded data size
  */
@@ -144,6 +149,13 @@ int cbor_decode_bytes(cbor_decoder_t *decoder, uint8_t *data, size_t *len);
  */
 int cbor_decode_text(cbor_decoder_t *decoder, char *text, size_t *len);
 
+/**
+ * @brief Decode text string, keeping the longest prefix that fits
+ *
+ * The prefix ends on a UTF-8 character boundary; the rest is skipped.
+ */
+int cbor_decode_text_truncated(cbor_decoder_t *decoder, char *text, size_t *len);
+
 /**
  * @brief Decode boolean
  */
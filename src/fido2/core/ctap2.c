@@ -10,11 +10,18 @@
 
 #include <string.h>
 
+#include "attestation.h"
 #include "cbor.h"
 #include "crypto.h"
+#include "ctap2_hmac_secret.h"
 #include "hal.h"
 #include "logger.h"
+#include "module_state.h"
+#include "permissions.h"
+#include "pin_protocol.h"
 #include "storage.h"
+#include "trace.h"
+#include "user_presence.h"
 
 /* CTAP2 GetInfo Response Keys */
 #define GETINFO_VERSIONS 0x01
@@ -27,6 +34,9 @@
 #define GETINFO_MAX_CRED_ID_LENGTH 0x08
 #define GETINFO_TRANSPORTS 0x09
 #define GETINFO_ALGORITHMS 0x0A
+#define GETINFO_MAX_SERIALIZED_LARGE_BLOB 0x0B
+#define GETINFO_MAX_CRED_BLOB_LENGTH 0x0F
+#define GETINFO_ATTESTATION_FORMATS 0x16
 
 /* MakeCredential Request Keys */
 #define MC_CLIENT_DATA_HASH 0x01
@@ -67,6 +77,8 @@
 #define CP_KEY_PIN_AUTH 0x04
 #define CP_KEY_NEW_PIN_ENC 0x05
 #define CP_KEY_PIN_HASH_ENC 0x06
+#define CP_KEY_PERMISSIONS 0x09
+#define CP_KEY_RP_ID 0x0A
 
 /* Client PIN Subcommands */
 #define CP_SUBCMD_GET_RETRIES 0x01
@@ -74,6 +86,7 @@
 #define CP_SUBCMD_SET_PIN 0x03
 #define CP_SUBCMD_CHANGE_PIN 0x04
 #define CP_SUBCMD_GET_PIN_TOKEN 0x05
+#define CP_SUBCMD_GET_PIN_TOKEN_WITH_PERMISSIONS 0x09
 
 /* Client PIN Response Keys */
 #define CP_RESP_KEY_AGREEMENT 0x01
@@ -95,11 +108,15 @@ static const uint8_t AAGUID[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0
                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
 /* Global state */
-static struct {
+static OPENFIDO_STATE struct {
     bool initialized;
     uint8_t pending_assertions;
     storage_credential_t assertion_credentials[10];
+    uint8_t key_agreement_private[32];
+    uint8_t key_agreement_public[64];
+    bool key_agreement_valid;
 } ctap2_state = {0};
+OPENFIDO_STATE_REGISTER(ctap2_state);
 
 /**
  * @brief Initialize the CTAP2 protocol handler.
@@ -112,10 +129,42 @@ uint8_t ctap2_init(void)
 
     ctap2_state.initialized = true;
     ctap2_state.pending_assertions = 0;
+    ctap2_state.key_agreement_valid = false;
+    permissions_init();
+
+    /* Not fatal here: attestation_sign() retries the load on first use */
+    if (attestation_load() != ATTESTATION_OK) {
+        LOG_WARN("Attestation key not available");
+    }
 
     return CTAP2_OK;
 }
 
+/**
+ * @brief Get the authenticator key-agreement key pair, generating it on first use
+ *
+ * The key pair lives for the whole power cycle (and across deep sleep), so
+ * repeated GetKeyAgreement calls do not pay for a fresh key generation.
+ *
+ * @return true if a valid key pair is available
+ */
+static bool ensure_key_agreement_key(void)
+{
+    if (ctap2_state.key_agreement_valid) {
+        return true;
+    }
+
+    if (crypto_ecdsa_generate_keypair(ctap2_state.key_agreement_private,
+                                      ctap2_state.key_agreement_public) != CRYPTO_OK) {
+        crypto_secure_zero(ctap2_state.key_agreement_private,
+                           sizeof(ctap2_state.key_agreement_private));
+        return false;
+    }
+
+    ctap2_state.key_agreement_valid = true;
+    return true;
+}
+
 /* Forward declaration for the renamed function */
 uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
                                 uint8_t *response_data, size_t *response_len);
@@ -164,6 +213,71 @@ static bool is_weak_pin(const uint8_t *pin, size_t pin_len)
     return false;
 }
 
+/**
+ * @brief Run a validated CTAP2 request.
+ *
+ * @param request Pointer to the request structure.
+ * @param response Pointer to the response structure.
+ * @return CTAP2 status code.
+ */
+static uint8_t ctap2_execute(const ctap2_request_t *request, ctap2_response_t *response)
+{
+    switch (request->cmd) {
+        case CTAP2_CMD_MAKE_CREDENTIAL:
+            return ctap2_make_credential(request->data, request->data_len, response->data,
+                                         &response->data_len);
+
+        case CTAP2_CMD_GET_ASSERTION:
+            return ctap2_get_assertion(request->data, request->data_len, response->data,
+                                       &response->data_len);
+
+        case CTAP2_CMD_GET_INFO:
+            return ctap2_get_info(response->data, &response->data_len);
+
+        case CTAP2_CMD_CLIENT_PIN:
+            return ctap2_handle_client_pin(request->data, request->data_len, response->data,
+                                           &response->data_len);
+
+        case CTAP2_CMD_RESET:
+            return ctap2_reset();
+
+        case CTAP2_CMD_GET_NEXT_ASSERTION:
+            return ctap2_get_next_assertion(response->data, &response->data_len);
+
+        case CTAP2_CMD_CREDENTIAL_MANAGEMENT:
+            return ctap2_credential_management(request->data, request->data_len, response->data,
+                                               &response->data_len);
+
+        case CTAP2_CMD_LARGE_BLOBS:
+            return ctap2_large_blobs(request->data, request->data_len, response->data,
+                                     &response->data_len);
+
+        case CTAP2_CMD_CONFIG:
+            return ctap2_authenticator_config(request->data, request->data_len, response->data,
+                                              &response->data_len);
+
+        case CTAP2_CMD_VENDOR_PROVISION:
+            return ctap2_vendor_provision(request->data, request->data_len, response->data,
+                                          &response->data_len);
+
+        case CTAP2_CMD_VENDOR_BACKUP:
+            return ctap2_vendor_backup(request->data, request->data_len, response->data,
+                                       &response->data_len);
+
+        case CTAP2_CMD_VENDOR_TRACE:
+            return ctap2_vendor_trace(request->data, request->data_len, response->data,
+                                      &response->data_len);
+
+        case CTAP2_CMD_VENDOR_FIRMWARE:
+            return ctap2_vendor_firmware(request->data, request->data_len, response->data,
+                                         &response->data_len);
+
+        default:
+            LOG_WARN("Unknown CTAP2 command: 0x%02X", request->cmd);
+            return CTAP2_ERR_INVALID_COMMAND;
+    }
+}
+
 /**
  * @brief Process a CTAP2 request.
  *
@@ -198,32 +312,10 @@ uint8_t ctap2_process_request(const ctap2_request_t *request, ctap2_response_t *
 
     LOG_DEBUG("Processing CTAP2 command: 0x%02X", request->cmd);
 
-    switch (request->cmd) {
-        case CTAP2_CMD_MAKE_CREDENTIAL:
-            return ctap2_make_credential(request->data, request->data_len, response->data,
-                                         &response->data_len);
-
-        case CTAP2_CMD_GET_ASSERTION:
-            return ctap2_get_assertion(request->data, request->data_len, response->data,
-                                       &response->data_len);
-
-        case CTAP2_CMD_GET_INFO:
-            return ctap2_get_info(response->data, &response->data_len);
-
-        case CTAP2_CMD_CLIENT_PIN:
-            return ctap2_handle_client_pin(request->data, request->data_len, response->data,
-                                           &response->data_len);
-
-        case CTAP2_CMD_RESET:
-            return ctap2_reset();
-
-        case CTAP2_CMD_GET_NEXT_ASSERTION:
-            return ctap2_get_next_assertion(response->data, &response->data_len);
-
-        default:
-            LOG_WARN("Unknown CTAP2 command: 0x%02X", request->cmd);
-            return CTAP2_ERR_INVALID_COMMAND;
-    }
+    TRACE_BEGIN(TRACE_SPAN_REQUEST, request->cmd);
+    uint8_t status = ctap2_execute(request, response);
+    TRACE_END(TRACE_SPAN_REQUEST);
+    return status;
 }
 
 /**
@@ -239,7 +331,7 @@ uint8_t ctap2_get_info(uint8_t *response_data, size_t *response_len)
     cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
 
     /* Start response map */
-    cbor_encode_map_start(&encoder, 8);
+    cbor_encode_map_start(&encoder, 11);
 
     /* 0x01: versions */
     cbor_encode_uint(&encoder, GETINFO_VERSIONS);
@@ -250,9 +342,10 @@ uint8_t ctap2_get_info(uint8_t *response_data, size_t *response_len)
 
     /* 0x02: extensions */
     cbor_encode_uint(&encoder, GETINFO_EXTENSIONS);
-    cbor_encode_array_start(&encoder, 2);
+    cbor_encode_array_start(&encoder, 3);
     cbor_encode_text(&encoder, "hmac-secret", 11);
     cbor_encode_text(&encoder, "credProtect", 11);
+    cbor_encode_text(&encoder, "credBlob", 8);
 
     /* 0x03: AAGUID */
     cbor_encode_uint(&encoder, GETINFO_AAGUID);
@@ -261,7 +354,7 @@ uint8_t ctap2_get_info(uint8_t *response_data, size_t *response_len)
 
     /* 0x04: options */
     cbor_encode_uint(&encoder, GETINFO_OPTIONS);
-    cbor_encode_map_start(&encoder, 5);
+    cbor_encode_map_start(&encoder, 10);
     cbor_encode_text(&encoder, "rk", 2);
     cbor_encode_bool(&encoder, true);
     cbor_encode_text(&encoder, "up", 2);
@@ -272,6 +365,17 @@ uint8_t ctap2_get_info(uint8_t *response_data, size_t *response_len)
     cbor_encode_bool(&encoder, false);
     cbor_encode_text(&encoder, "clientPin", 9);
     cbor_encode_bool(&encoder, storage_is_pin_set());
+    cbor_encode_text(&encoder, "largeBlobs", 10);
+    cbor_encode_bool(&encoder, true);
+    cbor_encode_text(&encoder, "credMgmt", 8);
+    cbor_encode_bool(&encoder, true);
+    cbor_encode_text(&encoder, "authnrCfg", 9);
+    cbor_encode_bool(&encoder, true);
+    cbor_encode_text(&encoder, "setMinPINLength", 15);
+    cbor_encode_bool(&encoder, true);
+    /* Tokens carry permissions (getPinUvAuthTokenUsingPinWithPermissions) */
+    cbor_encode_text(&encoder, "pinUvAuthToken", 14);
+    cbor_encode_bool(&encoder, true);
 
     /* 0x05: maxMsgSize */
     cbor_encode_uint(&encoder, GETINFO_MAX_MSG_SIZE);
@@ -279,22 +383,142 @@ uint8_t ctap2_get_info(uint8_t *response_data, size_t *response_len)
 
     /* 0x06: pinProtocols */
     cbor_encode_uint(&encoder, GETINFO_PIN_PROTOCOLS);
-    cbor_encode_array_start(&encoder, 1);
-    cbor_encode_uint(&encoder, 1); /* PIN protocol v1 */
+    cbor_encode_array_start(&encoder, 2);
+    cbor_encode_uint(&encoder, PIN_PROTOCOL_V2); /* Preferred */
+    cbor_encode_uint(&encoder, PIN_PROTOCOL_V1);
 
     /* 0x07: maxCredentialCountInList */
     cbor_encode_uint(&encoder, GETINFO_MAX_CREDS_IN_LIST);
-    cbor_encode_uint(&encoder, 10);
+    cbor_encode_uint(&encoder, CTAP2_MAX_CREDS_IN_LIST);
 
     /* 0x08: maxCredentialIdLength */
     cbor_encode_uint(&encoder, GETINFO_MAX_CRED_ID_LENGTH);
     cbor_encode_uint(&encoder, STORAGE_CREDENTIAL_ID_LENGTH);
 
+    /* 0x0B: maxSerializedLargeBlobArray */
+    cbor_encode_uint(&encoder, GETINFO_MAX_SERIALIZED_LARGE_BLOB);
+    cbor_encode_uint(&encoder, STORAGE_LARGE_BLOB_MAX_SIZE);
+
+    /* 0x0F: maxCredBlobLength */
+    cbor_encode_uint(&encoder, GETINFO_MAX_CRED_BLOB_LENGTH);
+    cbor_encode_uint(&encoder, STORAGE_MAX_CRED_BLOB_LENGTH);
+
+    /* 0x16: attestationFormats */
+    cbor_encode_uint(&encoder, GETINFO_ATTESTATION_FORMATS);
+    cbor_encode_array_start(&encoder, 2);
+    cbor_encode_text(&encoder, CTAP2_ATT_FMT_PACKED, strlen(CTAP2_ATT_FMT_PACKED));
+    cbor_encode_text(&encoder, CTAP2_ATT_FMT_NONE, strlen(CTAP2_ATT_FMT_NONE));
+
     *response_len = cbor_encoder_get_size(&encoder);
     LOG_INFO("GetInfo completed");
     return CTAP2_OK;
 }
 
+/**
+ * @brief Drop the key-agreement key pair and everything derived from it
+ *
+ * Called after a PIN mismatch, so a new GetKeyAgreement is needed before the
+ * next attempt.
+ */
+static void invalidate_key_agreement(void)
+{
+    crypto_secure_zero(ctap2_state.key_agreement_private,
+                       sizeof(ctap2_state.key_agreement_private));
+    ctap2_state.key_agreement_valid = false;
+    pin_protocol_clear();
+}
+
+uint8_t ctap2_get_shared_secret(uint8_t pin_protocol, const uint8_t *platform_key,
+                                const pin_protocol_secret_t **secret)
+{
+    if (!ctap2_state.key_agreement_valid) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    if (pin_protocol_decapsulate(pin_protocol, ctap2_state.key_agreement_private, platform_key,
+                                 secret) != PIN_PROTOCOL_OK) {
+        return CTAP2_ERR_INVALID_PARAMETER;
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Decrypt pinHashEnc and check it against the stored PIN
+ *
+ * @param secret Shared secret for the request.
+ * @param pin_hash_enc Encrypted LEFT(SHA-256(PIN), 16).
+ * @param pin_hash_enc_len Length of pin_hash_enc.
+ * @return CTAP2 status code.
+ */
+static uint8_t check_pin_hash(const pin_protocol_secret_t *secret, const uint8_t *pin_hash_enc,
+                              size_t pin_hash_enc_len)
+{
+    uint8_t pin_hash[32];
+    size_t pin_hash_len = 0;
+
+    if (pin_protocol_decrypt(secret, pin_hash_enc, pin_hash_enc_len, pin_hash, &pin_hash_len) !=
+            PIN_PROTOCOL_OK ||
+        pin_hash_len != 16) {
+        crypto_secure_zero(pin_hash, sizeof(pin_hash));
+        return CTAP2_ERR_INVALID_PARAMETER;
+    }
+
+    int result = storage_verify_pin_hash(pin_hash, pin_hash_len);
+    crypto_secure_zero(pin_hash, sizeof(pin_hash));
+
+    if (result != STORAGE_OK) {
+        invalidate_key_agreement();
+        return storage_is_pin_blocked() ? CTAP2_ERR_PIN_BLOCKED : CTAP2_ERR_PIN_INVALID;
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Decrypt newPinEnc, check the PIN policy and store the new PIN
+ *
+ * @param secret Shared secret for the request.
+ * @param new_pin_enc Encrypted, zero-padded 64-byte PIN.
+ * @param new_pin_enc_len Length of new_pin_enc.
+ * @return CTAP2 status code.
+ */
+static uint8_t store_new_pin(const pin_protocol_secret_t *secret, const uint8_t *new_pin_enc,
+                             size_t new_pin_enc_len)
+{
+    uint8_t padded_pin[64];
+    size_t padded_pin_len = 0;
+    uint8_t result = CTAP2_OK;
+
+    if (pin_protocol_decrypt(secret, new_pin_enc, new_pin_enc_len, padded_pin,
+                             &padded_pin_len) != PIN_PROTOCOL_OK ||
+        padded_pin_len != sizeof(padded_pin)) {
+        crypto_secure_zero(padded_pin, sizeof(padded_pin));
+        return CTAP2_ERR_INVALID_PARAMETER;
+    }
+
+    /* The PIN runs up to the first padding byte */
+    size_t pin_len = 0;
+    while (pin_len < sizeof(padded_pin) && padded_pin[pin_len] != 0) {
+        pin_len++;
+    }
+
+    if (pin_len < STORAGE_PIN_MIN_LENGTH || pin_len > STORAGE_PIN_MAX_LENGTH) {
+        result = CTAP2_ERR_PIN_POLICY_VIOLATION;
+    } else if (is_weak_pin(padded_pin, pin_len)) {
+        /* Check for weak PINs */
+        LOG_WARN("Weak PIN rejected");
+        result = CTAP2_ERR_PIN_POLICY_VIOLATION;
+    } else if (storage_set_pin(padded_pin, pin_len) != STORAGE_OK) {
+        /* storage_set_pin hashes with SHA-256 before storing */
+        result = CTAP2_ERR_PROCESSING;
+    }
+
+    /* CRITICAL: Securely wipe sensitive data */
+    crypto_secure_zero(padded_pin, sizeof(padded_pin));
+    return result;
+}
+
 /**
  * @brief Handle the clientPIN command.
  *
@@ -318,10 +542,21 @@ uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
         return CTAP2_ERR_INVALID_CBOR;
     }
 
+    uint64_t pin_protocol = 0;
     uint64_t sub_command = 0;
-    uint8_t new_pin_enc[64];
+    uint8_t key_agreement[64];
+    uint8_t pin_auth[32];
+    size_t pin_auth_len = 0;
+    uint8_t new_pin_enc[64 + PIN_PROTOCOL_V2_IV_SIZE];
     size_t new_pin_enc_len = 0;
+    uint8_t pin_hash_enc[16 + PIN_PROTOCOL_V2_IV_SIZE];
+    size_t pin_hash_enc_len = 0;
+    uint64_t permissions = 0;
+    uint8_t rp_id_hash[32];
+    bool has_pin_protocol = false;
     bool has_sub_command = false;
+    bool has_key_agreement = false;
+    bool has_rp_id = false;
 
     /* Parse parameters */
     for (uint64_t i = 0; i < map_size; i++) {
@@ -332,7 +567,10 @@ uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
 
         switch (key) {
             case CP_KEY_PIN_PROTOCOL:
-                cbor_skip_value(&decoder);
+                if (cbor_decode_uint(&decoder, &pin_protocol) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                has_pin_protocol = true;
                 break;
             case CP_KEY_SUBCOMMAND:
                 if (cbor_decode_uint(&decoder, &sub_command) != CBOR_OK) {
@@ -340,36 +578,53 @@ uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
                 }
                 has_sub_command = true;
                 break;
-            case CP_KEY_NEW_PIN_ENC: {
-                size_t actual_len = sizeof(new_pin_enc);
-
-                /* Decode and capture actual length */
-                int decode_result = cbor_decode_bytes(&decoder, new_pin_enc, &actual_len);
-
-                if (decode_result != CBOR_OK) {
-                    crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
+            case CP_KEY_KEY_AGREEMENT: {
+                if (pin_protocol_decode_key(&decoder, key_agreement) != PIN_PROTOCOL_OK) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                has_key_agreement = true;
+                break;
+            }
+            case CP_KEY_PIN_AUTH:
+                pin_auth_len = sizeof(pin_auth);
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
-
-                /* Validate actual decoded length */
-                if (actual_len == 0) {
-                    crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-                    LOG_WARN("Empty PIN encrypted data received");
-                    return CTAP2_ERR_PIN_POLICY_VIOLATION;
+                break;
+            case CP_KEY_NEW_PIN_ENC:
+                new_pin_enc_len = sizeof(new_pin_enc);
+                if (cbor_decode_bytes(&decoder, new_pin_enc, &new_pin_enc_len) != CBOR_OK) {
+                    LOG_WARN("PIN encrypted data malformed or too large");
+                    return CTAP2_ERR_INVALID_CBOR;
                 }
-
-                if (actual_len > sizeof(new_pin_enc)) {
-                    crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-                    LOG_WARN("PIN encrypted data exceeds maximum size: %zu > %zu", actual_len,
-                             sizeof(new_pin_enc));
-                    return CTAP2_ERR_INVALID_LENGTH;
+                break;
+            case CP_KEY_PIN_HASH_ENC:
+                pin_hash_enc_len = sizeof(pin_hash_enc);
+                if (cbor_decode_bytes(&decoder, pin_hash_enc, &pin_hash_enc_len) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
                 }
+                break;
+            case CP_KEY_PERMISSIONS:
+                if (cbor_decode_uint(&decoder, &permissions) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+            case CP_KEY_RP_ID: {
+                char rp_id[CTAP2_MAX_RP_ID_LENGTH];
+                size_t rp_id_len = sizeof(rp_id);
 
-                new_pin_enc_len = actual_len;
+                if (cbor_decode_text(&decoder, rp_id, &rp_id_len) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                if (crypto_sha256((const uint8_t *) rp_id, rp_id_len, rp_id_hash) !=
+                    CRYPTO_OK) {
+                    return CTAP2_ERR_PROCESSING;
+                }
+                has_rp_id = true;
                 break;
             }
             default:
-                cbor_skip_value(&decoder);
+                cbor_decoder_skip(&decoder);
                 break;
         }
     }
@@ -378,9 +633,34 @@ uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
         return CTAP2_ERR_MISSING_PARAMETER;
     }
 
+    if (sub_command != CP_SUBCMD_GET_RETRIES) {
+        if (!has_pin_protocol) {
+            return CTAP2_ERR_MISSING_PARAMETER;
+        }
+        if (!pin_protocol_is_supported(pin_protocol)) {
+            return CTAP2_ERR_INVALID_PARAMETER;
+        }
+    }
+
+    /* Subcommands carrying encrypted data share one secret per platform key */
+    const pin_protocol_secret_t *secret = NULL;
+    if (sub_command == CP_SUBCMD_SET_PIN || sub_command == CP_SUBCMD_CHANGE_PIN ||
+        sub_command == CP_SUBCMD_GET_PIN_TOKEN ||
+        sub_command == CP_SUBCMD_GET_PIN_TOKEN_WITH_PERMISSIONS) {
+        if (!has_key_agreement) {
+            return CTAP2_ERR_MISSING_PARAMETER;
+        }
+        uint8_t status = ctap2_get_shared_secret((uint8_t) pin_protocol, key_agreement, &secret);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+    }
+
     cbor_encoder_t encoder;
     cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
 
+    uint8_t status;
+
     switch (sub_command) {
         case CP_SUBCMD_GET_RETRIES:
             cbor_encode_map_start(&encoder, 1);
@@ -391,14 +671,10 @@ uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
             return CTAP2_OK;
 
         case CP_SUBCMD_GET_KEY_AGREEMENT: {
-            /* Generate ephemeral ECDH key pair */
-            uint8_t private_key[32];
-            uint8_t public_key[64];
-
-            if (crypto_ecdsa_generate_keypair(private_key, public_key) != CRYPTO_OK) {
-                crypto_secure_zero(private_key, sizeof(private_key));
+            if (!ensure_key_agreement_key()) {
                 return CTAP2_ERR_PROCESSING;
             }
+            const uint8_t *public_key = ctap2_state.key_agreement_public;
 
             cbor_encode_map_start(&encoder, 1);
             cbor_encode_uint(&encoder, CP_RESP_KEY_AGREEMENT);
@@ -418,120 +694,79 @@ uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
 
             *response_len = cbor_encoder_get_size(&encoder);
 
-            /* CRITICAL: Securely wipe private key before returning */
-            crypto_secure_zero(private_key, sizeof(private_key));
-
             LOG_INFO("ClientPIN: GetKeyAgreement");
             return CTAP2_OK;
         }
 
-        case CP_SUBCMD_SET_PIN: {
+        case CP_SUBCMD_SET_PIN:
             /* Verify PIN is not already set */
             if (storage_is_pin_set()) {
-                crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
                 return CTAP2_ERR_PIN_INVALID;
             }
 
-            /* Validate encrypted PIN was provided */
-            if (new_pin_enc_len == 0 || new_pin_enc_len > 64) {
-                crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
+            if (new_pin_enc_len == 0 || pin_auth_len == 0) {
                 return CTAP2_ERR_MISSING_PARAMETER;
             }
 
-            /* TODO: In production implementation:
-             * 1. Retrieve platform's public key from CP_KEY_KEY_AGREEMENT
-             * 2. Compute ECDH shared secret with our private key
-             * 3. Derive encryption key using HKDF-SHA256
-             * 4. Decrypt newPinEnc using AES-256-CBC
-             * For this implementation, we will simulate decryption
-             */
-
-            /* Simulate decryption (in production, use crypto_aes_gcm_decrypt) */
-            uint8_t decrypted_pin[STORAGE_PIN_MAX_LENGTH];
-            size_t decrypted_pin_len = new_pin_enc_len;
-            memcpy(decrypted_pin, new_pin_enc, new_pin_enc_len);
-
-            /* Validate PIN length AFTER decryption */
-            if (decrypted_pin_len < STORAGE_PIN_MIN_LENGTH ||
-                decrypted_pin_len > STORAGE_PIN_MAX_LENGTH) {
-                crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-                crypto_secure_zero(decrypted_pin, sizeof(decrypted_pin));
-                return CTAP2_ERR_PIN_POLICY_VIOLATION;
-            }
-
-            /* Check for weak PINs */
-            if (is_weak_pin(decrypted_pin, decrypted_pin_len)) {
-                crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-                crypto_secure_zero(decrypted_pin, sizeof(decrypted_pin));
-                LOG_WARN("Weak PIN rejected");
-                return CTAP2_ERR_PIN_POLICY_VIOLATION;
+            /* pinUvAuthParam = authenticate(sharedSecret, newPinEnc) */
+            if (pin_protocol_verify(secret, new_pin_enc, new_pin_enc_len, pin_auth,
+                                    pin_auth_len) != PIN_PROTOCOL_OK) {
+                return CTAP2_ERR_PIN_AUTH_INVALID;
             }
 
-            /* Set PIN (storage_set_pin should hash with SHA-256 before storing) */
-            int result = storage_set_pin(decrypted_pin, decrypted_pin_len);
-
-            /* CRITICAL: Securely wipe sensitive data */
+            status = store_new_pin(secret, new_pin_enc, new_pin_enc_len);
             crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-            crypto_secure_zero(decrypted_pin, sizeof(decrypted_pin));
-
-            if (result != STORAGE_OK) {
-                return CTAP2_ERR_PROCESSING;
+            if (status != CTAP2_OK) {
+                return status;
             }
 
             *response_len = 0;
             LOG_INFO("ClientPIN: SetPIN");
             return CTAP2_OK;
-        }
 
         case CP_SUBCMD_CHANGE_PIN: {
             /* Change existing PIN */
             if (!storage_is_pin_set()) {
-                crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
                 return CTAP2_ERR_PIN_NOT_SET;
             }
 
-            /* Validate encrypted PIN was provided */
-            if (new_pin_enc_len == 0 || new_pin_enc_len > 64) {
-                crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-                return CTAP2_ERR_MISSING_PARAMETER;
+            if (storage_is_pin_blocked()) {
+                return CTAP2_ERR_PIN_BLOCKED;
             }
 
-            /* In production: */
-            /* 1. Decrypt pinHashEnc using shared secret */
-            /* 2. Verify current PIN */
-            /* 3. Decrypt newPinEnc */
-            /* 4. Set new PIN */
-
-            /* Simulate decryption */
-            uint8_t decrypted_pin[STORAGE_PIN_MAX_LENGTH];
-            size_t decrypted_pin_len = new_pin_enc_len;
-            memcpy(decrypted_pin, new_pin_enc, new_pin_enc_len);
-
-            /* Validate and check for weak PINs */
-            if (decrypted_pin_len < STORAGE_PIN_MIN_LENGTH ||
-                decrypted_pin_len > STORAGE_PIN_MAX_LENGTH ||
-                is_weak_pin(decrypted_pin, decrypted_pin_len)) {
-                crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-                crypto_secure_zero(decrypted_pin, sizeof(decrypted_pin));
-                return CTAP2_ERR_PIN_POLICY_VIOLATION;
+            if (new_pin_enc_len == 0 || pin_hash_enc_len == 0 || pin_auth_len == 0) {
+                return CTAP2_ERR_MISSING_PARAMETER;
             }
 
-            int result = storage_set_pin(decrypted_pin, decrypted_pin_len);
+            /* pinUvAuthParam = authenticate(sharedSecret, newPinEnc || pinHashEnc) */
+            uint8_t message[sizeof(new_pin_enc) + sizeof(pin_hash_enc)];
+            memcpy(message, new_pin_enc, new_pin_enc_len);
+            memcpy(&message[new_pin_enc_len], pin_hash_enc, pin_hash_enc_len);
 
-            /* Cleanup sensitive data */
-            crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
-            crypto_secure_zero(decrypted_pin, sizeof(decrypted_pin));
+            if (pin_protocol_verify(secret, message, new_pin_enc_len + pin_hash_enc_len,
+                                    pin_auth, pin_auth_len) != PIN_PROTOCOL_OK) {
+                return CTAP2_ERR_PIN_AUTH_INVALID;
+            }
 
-            if (result != STORAGE_OK) {
-                return CTAP2_ERR_PROCESSING;
+            status = check_pin_hash(secret, pin_hash_enc, pin_hash_enc_len);
+            if (status == CTAP2_OK) {
+                status = store_new_pin(secret, new_pin_enc, new_pin_enc_len);
             }
+            crypto_secure_zero(new_pin_enc, sizeof(new_pin_enc));
+            if (status != CTAP2_OK) {
+                return status;
+            }
+
+            /* Tokens issued under the old PIN are no longer valid */
+            permissions_clear();
 
             *response_len = 0;
             LOG_INFO("ClientPIN: ChangePIN");
             return CTAP2_OK;
         }
 
-        case CP_SUBCMD_GET_PIN_TOKEN: {
+        case CP_SUBCMD_GET_PIN_TOKEN:
+        case CP_SUBCMD_GET_PIN_TOKEN_WITH_PERMISSIONS: {
             /* Get PIN token */
             if (!storage_is_pin_set()) {
                 return CTAP2_ERR_PIN_NOT_SET;
@@ -541,26 +776,48 @@ uint8_t ctap2_handle_client_pin(const uint8_t *request_data, size_t request_len,
                 return CTAP2_ERR_PIN_BLOCKED;
             }
 
-            /* In production: */
-            /* 1. Decrypt pinHashEnc using shared secret */
-            /* 2. Verify PIN */
-            /* 3. Generate PIN token */
-            /* 4. Encrypt PIN token with shared secret */
+            /* The legacy subcommand grants MC/GA; the 2.1 one names its permissions */
+            if (sub_command == CP_SUBCMD_GET_PIN_TOKEN) {
+                if (permissions != 0 || has_rp_id) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                permissions = PERM_DEFAULT;
+            } else if (permissions == 0 || permissions > 0xFF) {
+                return CTAP2_ERR_MISSING_PARAMETER;
+            }
 
-            /* Simplified: return dummy encrypted token */
-            uint8_t pin_token[16];
-            crypto_random_generate(pin_token, sizeof(pin_token));
+            if (pin_hash_enc_len == 0) {
+                return CTAP2_ERR_MISSING_PARAMETER;
+            }
+
+            status = check_pin_hash(secret, pin_hash_enc, pin_hash_enc_len);
+            if (status != CTAP2_OK) {
+                return status;
+            }
+
+            /* A new token replaces the previous session */
+            uint8_t pin_token[PERM_TOKEN_SIZE];
+            uint8_t pin_token_enc[PERM_TOKEN_SIZE + PIN_PROTOCOL_V2_IV_SIZE];
+            size_t pin_token_enc_len = 0;
+
+            if (crypto_random_generate(pin_token, sizeof(pin_token)) != CRYPTO_OK ||
+                pin_protocol_encrypt(secret, pin_token, sizeof(pin_token), pin_token_enc,
+                                     &pin_token_enc_len) != PIN_PROTOCOL_OK ||
+                !permissions_begin_session(pin_token, (uint8_t) permissions,
+                                           has_rp_id ? rp_id_hash : NULL)) {
+                crypto_secure_zero(pin_token, sizeof(pin_token));
+                return CTAP2_ERR_PROCESSING;
+            }
+            crypto_secure_zero(pin_token, sizeof(pin_token));
 
             cbor_encode_map_start(&encoder, 1);
             cbor_encode_uint(&encoder, CP_RESP_PIN_TOKEN);
-            cbor_encode_bytes(&encoder, pin_token, sizeof(pin_token));
+            cbor_encode_bytes(&encoder, pin_token_enc, pin_token_enc_len);
 
             *response_len = cbor_encoder_get_size(&encoder);
 
-            /* CRITICAL: Securely wipe PIN token after encoding */
-            crypto_secure_zero(pin_token, sizeof(pin_token));
-
-            LOG_INFO("ClientPIN: GetPINToken");
+            LOG_INFO("ClientPIN: GetPINToken (protocol %u, permissions 0x%02X)",
+                     (unsigned) pin_protocol, (unsigned) permissions);
             return CTAP2_OK;
         }
 
@@ -581,8 +838,13 @@ uint8_t ctap2_reset(void)
     LOG_INFO("Performing authenticator reset");
 
     /* Wait for user presence within 10 seconds of power-up */
-    if (!hal_button_wait_press(10000)) {
-        return CTAP2_ERR_USER_ACTION_TIMEOUT;
+    switch (up_wait(10000)) {
+        case UP_RESULT_CONFIRMED:
+            break;
+        case UP_RESULT_CANCELLED:
+            return CTAP2_ERR_KEEPALIVE_CANCEL;
+        default:
+            return CTAP2_ERR_USER_ACTION_TIMEOUT;
     }
 
     /* Format storage */
@@ -592,6 +854,14 @@ uint8_t ctap2_reset(void)
 
     ctap2_state.pending_assertions = 0;
 
+    /* Invalidate the PIN session */
+    invalidate_key_agreement();
+    permissions_clear();
+    hmac_secret_clear();
+
+    /* Formatting generated a new attestation key */
+    attestation_load();
+
     LOG_INFO("Reset completed successfully");
     return CTAP2_OK;
 }
@@ -615,3 +885,52 @@ uint8_t ctap2_get_next_assertion(uint8_t *response_data, size_t *response_len)
     LOG_INFO("GetNextAssertion: %d remaining", ctap2_state.pending_assertions);
     return CTAP2_OK;
 }
+
+/**
+ * @brief Capture ClientPIN session state for the deep-sleep snapshot.
+ *
+ * @param state Output state.
+ */
+void ctap2_save_resume_state(ctap2_resume_state_t *state)
+{
+    if (state == NULL) {
+        return;
+    }
+
+    memcpy(state->key_agreement_private, ctap2_state.key_agreement_private,
+           sizeof(state->key_agreement_private));
+    memcpy(state->key_agreement_public, ctap2_state.key_agreement_public,
+           sizeof(state->key_agreement_public));
+    state->key_agreement_valid = ctap2_state.key_agreement_valid;
+
+    const permission_state_t *perm = permissions_get_state();
+    state->pin_token_valid = permissions_get_token(state->pin_token);
+    state->pin_token_permissions = perm->permissions;
+    memcpy(state->pin_token_rp_id_hash, perm->rp_id_hash, sizeof(state->pin_token_rp_id_hash));
+    state->pin_token_has_rp_id = perm->has_rp_id;
+}
+
+/**
+ * @brief Reinstall ClientPIN session state after deep sleep.
+ *
+ * @param state State captured by ctap2_save_resume_state().
+ */
+void ctap2_restore_resume_state(const ctap2_resume_state_t *state)
+{
+    if (state == NULL) {
+        return;
+    }
+
+    memcpy(ctap2_state.key_agreement_private, state->key_agreement_private,
+           sizeof(ctap2_state.key_agreement_private));
+    memcpy(ctap2_state.key_agreement_public, state->key_agreement_public,
+           sizeof(ctap2_state.key_agreement_public));
+    ctap2_state.key_agreement_valid = state->key_agreement_valid;
+
+    /* The token's timers restart, as the clock does not run across deep sleep */
+    if (state->pin_token_valid) {
+        permissions_begin_session(state->pin_token, state->pin_token_permissions,
+                                  state->pin_token_has_rp_id ? state->pin_token_rp_id_hash
+                                                             : NULL);
+    }
+}
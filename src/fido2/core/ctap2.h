@@ -16,6 +16,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "pin_protocol.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,6 +34,10 @@ extern "C" {
 #define CTAP2_CMD_SELECTION 0x0B
 #define CTAP2_CMD_LARGE_BLOBS 0x0C
 #define CTAP2_CMD_CONFIG 0x0D
+#define CTAP2_CMD_VENDOR_PROVISION 0x41
+#define CTAP2_CMD_VENDOR_BACKUP 0x42
+#define CTAP2_CMD_VENDOR_TRACE 0x43
+#define CTAP2_CMD_VENDOR_FIRMWARE 0x44
 
 /* CTAP2 Status Codes */
 #define CTAP2_OK 0x00
@@ -48,6 +54,7 @@ extern "C" {
 #define CTAP2_ERR_MISSING_PARAMETER 0x14
 #define CTAP2_ERR_LIMIT_EXCEEDED 0x15
 #define CTAP2_ERR_UNSUPPORTED_EXTENSION 0x16
+#define CTAP2_ERR_LARGE_BLOB_STORAGE_FULL 0x18
 #define CTAP2_ERR_CREDENTIAL_EXCLUDED 0x19
 #define CTAP2_ERR_PROCESSING 0x21
 #define CTAP2_ERR_INVALID_CREDENTIAL 0x22
@@ -83,11 +90,13 @@ extern "C" {
 
 /* CTAP2 Constants */
 #define CTAP2_MAX_MESSAGE_SIZE 1024
+#define CTAP2_MAX_CREDS_IN_LIST 10
 #define CTAP2_MAX_CREDENTIAL_ID_LENGTH 1024
 #define CTAP2_MAX_RP_ID_LENGTH 256
 #define CTAP2_MAX_USER_ID_LENGTH 64
 #define CTAP2_MAX_USER_NAME_LENGTH 64
 #define CTAP2_MAX_DISPLAY_NAME_LENGTH 64
+#define CTAP2_PIN_TOKEN_SIZE 32
 
 /* Public Key Algorithm Identifiers (COSE) */
 #define COSE_ALG_ES256 -7  /* ECDSA w/ SHA-256 */
@@ -109,6 +118,11 @@ extern "C" {
 #define CTAP2_EXT_LARGE_BLOBS "largeBlobKey"
 #define CTAP2_EXT_MIN_PIN_LENGTH "minPinLength"
 #define CTAP2_EXT_CRED_BLOB "credBlob"
+#define CTAP2_EXT_GET_CRED_BLOB "getCredBlob"
+
+/* Attestation Statement Formats */
+#define CTAP2_ATT_FMT_PACKED "packed"
+#define CTAP2_ATT_FMT_NONE "none"
 
 /**
  * @brief CTAP2 Request Structure
@@ -128,6 +142,20 @@ typedef struct {
     size_t data_len; /**< Length of response data */
 } ctap2_response_t;
 
+/**
+ * @brief ClientPIN session state kept across deep sleep
+ */
+typedef struct {
+    uint8_t key_agreement_private[32];       /**< Authenticator key-agreement private key */
+    uint8_t key_agreement_public[64];        /**< Authenticator key-agreement public key */
+    uint8_t pin_token[CTAP2_PIN_TOKEN_SIZE]; /**< Current PIN token */
+    uint8_t pin_token_rp_id_hash[32];        /**< RP the token is bound to */
+    uint8_t pin_token_permissions;           /**< Permissions granted to the token */
+    bool pin_token_has_rp_id;                /**< Token is bound to an RP */
+    bool key_agreement_valid;                /**< Key-agreement key pair generated */
+    bool pin_token_valid;                    /**< PIN token issued */
+} ctap2_resume_state_t;
+
 /**
  * @brief Initialize CTAP2 protocol handler
  *
@@ -222,186 +250,47 @@ uint8_t ctap2_credential_management(const uint8_t *request_data, size_t request_
  *
  * @param request_data Request data buffer
  * @param request_len Request data length
-#define CTAP2_CMD_BIO_ENROLLMENT 0x09
-#define CTAP2_CMD_CREDENTIAL_MANAGEMENT 0x0A
-#define CTAP2_CMD_SELECTION 0x0B
-#define CTAP2_CMD_LARGE_BLOBS 0x0C
-#define CTAP2_CMD_CONFIG 0x0D
-
-/* CTAP2 Status Codes */
-#define CTAP2_OK 0x00
-#define CTAP2_ERR_INVALID_COMMAND 0x01
-#define CTAP2_ERR_INVALID_PARAMETER 0x02
-#define CTAP2_ERR_INVALID_LENGTH 0x03
-#define CTAP2_ERR_INVALID_SEQ 0x04
-#define CTAP2_ERR_TIMEOUT 0x05
-#define CTAP2_ERR_CHANNEL_BUSY 0x06
-#define CTAP2_ERR_LOCK_REQUIRED 0x0A
-#define CTAP2_ERR_INVALID_CHANNEL 0x0B
-#define CTAP2_ERR_CBOR_UNEXPECTED_TYPE 0x11
-#define CTAP2_ERR_INVALID_CBOR 0x12
-#define CTAP2_ERR_MISSING_PARAMETER 0x14
-#define CTAP2_ERR_LIMIT_EXCEEDED 0x15
-#define CTAP2_ERR_UNSUPPORTED_EXTENSION 0x16
-#define CTAP2_ERR_CREDENTIAL_EXCLUDED 0x19
-#define CTAP2_ERR_PROCESSING 0x21
-#define CTAP2_ERR_INVALID_CREDENTIAL 0x22
-#define CTAP2_ERR_USER_ACTION_PENDING 0x23
-#define CTAP2_ERR_OPERATION_PENDING 0x24
-#define CTAP2_ERR_NO_OPERATIONS 0x25
-#define CTAP2_ERR_UNSUPPORTED_ALGORITHM 0x26
-#define CTAP2_ERR_OPERATION_DENIED 0x27
-#define CTAP2_ERR_KEY_STORE_FULL 0x28
-#define CTAP2_ERR_NO_OPERATION_PENDING 0x2A
-#define CTAP2_ERR_UNSUPPORTED_OPTION 0x2B
-#define CTAP2_ERR_INVALID_OPTION 0x2C
-#define CTAP2_ERR_KEEPALIVE_CANCEL 0x2D
-#define CTAP2_ERR_NO_CREDENTIALS 0x2E
-#define CTAP2_ERR_USER_ACTION_TIMEOUT 0x2F
-#define CTAP2_ERR_NOT_ALLOWED 0x30
-#define CTAP2_ERR_PIN_INVALID 0x31
-#define CTAP2_ERR_PIN_BLOCKED 0x32
-#define CTAP2_ERR_PIN_AUTH_INVALID 0x33
-#define CTAP2_ERR_PIN_AUTH_BLOCKED 0x34
-#define CTAP2_ERR_PIN_NOT_SET 0x35
-#define CTAP2_ERR_PIN_REQUIRED 0x36
-#define CTAP2_ERR_PIN_POLICY_VIOLATION 0x37
-#define CTAP2_ERR_PIN_TOKEN_EXPIRED 0x38
-#define CTAP2_ERR_REQUEST_TOO_LARGE 0x39
-#define CTAP2_ERR_ACTION_TIMEOUT 0x3A
-#define CTAP2_ERR_UP_REQUIRED 0x3B
-#define CTAP2_ERR_UV_BLOCKED 0x3C
-#define CTAP2_ERR_INTEGRITY_FAILURE 0x3D
-#define CTAP2_ERR_INVALID_SUBCOMMAND 0x3E
-#define CTAP2_ERR_UV_INVALID 0x3F
-#define CTAP2_ERR_UNAUTHORIZED_PERMISSION 0x40
-
-/* CTAP2 Constants */
-#define CTAP2_MAX_MESSAGE_SIZE 1024
-#define CTAP2_MAX_CREDENTIAL_ID_LENGTH 1024
-#define CTAP2_MAX_RP_ID_LENGTH 256
-#define CTAP2_MAX_USER_ID_LENGTH 64
-#define CTAP2_MAX_USER_NAME_LENGTH 64
-#define CTAP2_MAX_DISPLAY_NAME_LENGTH 64
-
-/* Public Key Algorithm Identifiers (COSE) */
-#define COSE_ALG_ES256 -7  /* ECDSA w/ SHA-256 */
-#define COSE_ALG_EDDSA -8  /* EdDSA */
-#define COSE_ALG_ES384 -35 /* ECDSA w/ SHA-384 */
-#define COSE_ALG_ES512 -36 /* ECDSA w/ SHA-512 */
-
-/* Authenticator Data Flags */
-#define CTAP2_AUTH_DATA_FLAG_UP 0x01 /* User Present */
-#define CTAP2_AUTH_DATA_FLAG_UV 0x04 /* User Verified */
-#define CTAP2_AUTH_DATA_FLAG_BE 0x08 /* Backup Eligible */
-#define CTAP2_AUTH_DATA_FLAG_BS 0x10 /* Backup State */
-#define CTAP2_AUTH_DATA_FLAG_AT 0x40 /* Attested Credential Data */
-#define CTAP2_AUTH_DATA_FLAG_ED 0x80 /* Extension Data */
-
-/* Extension IDs */
-#define CTAP2_EXT_HMAC_SECRET "hmac-secret"
-#define CTAP2_EXT_CRED_PROTECT "credProtect"
-#define CTAP2_EXT_LARGE_BLOBS "largeBlobKey"
-#define CTAP2_EXT_MIN_PIN_LENGTH "minPinLength"
-#define CTAP2_EXT_CRED_BLOB "credBlob"
-
-/**
- * @brief CTAP2 Request Structure
- */
-typedef struct {
-    uint8_t cmd;     /**< Command code */
-    uint8_t *data;   /**< Request data (CBOR encoded) */
-    size_t data_len; /**< Length of request data */
-} ctap2_request_t;
-
-/**
- * @brief CTAP2 Response Structure
- */
-typedef struct {
-    uint8_t status;  /**< Status code */
-    uint8_t *data;   /**< Response data (CBOR encoded) */
-    size_t data_len; /**< Length of response data */
-} ctap2_response_t;
-
-/**
- * @brief Initialize CTAP2 protocol handler
- *
- * @return CTAP2_OK on success, error code otherwise
- */
-uint8_t ctap2_init(void);
-
-/**
- * @brief Process a CTAP2 request
- *
- * @param request Pointer to request structure
- * @param response Pointer to response structure
- * @return CTAP2_OK on success, error code otherwise
- */
-uint8_t ctap2_process_request(const ctap2_request_t *request, ctap2_response_t *response);
-
-/**
- * @brief Handle MakeCredential command (0x01)
- *
- * @param request_data CBOR-encoded request data
- * @param request_len Length of request data
- * @param response_data Buffer for CBOR-encoded response
- * @param response_len Pointer to response length
- * @return CTAP2_OK on success, error code otherwise
- */
-uint8_t ctap2_make_credential(const uint8_t *request_data, size_t request_len,
-                              uint8_t *response_data, size_t *response_len);
-
-/**
- * @brief Handle GetAssertion command (0x02)
- *
- * @param request_data CBOR-encoded request data
- * @param request_len Length of request data
- * @param response_data Buffer for CBOR-encoded response
- * @param response_len Pointer to response length
- * @return CTAP2_OK on success, error code otherwise
+ * @param response_data Response data buffer
+ * @param response_len Pointer to response data length
+ * @return CTAP2 status code
  */
-uint8_t ctap2_get_assertion(const uint8_t *request_data, size_t request_len, uint8_t *response_data,
-                            size_t *response_len);
+uint8_t ctap2_authenticator_config(const uint8_t *request_data, size_t request_len,
+                                   uint8_t *response_data, size_t *response_len);
 
 /**
- * @brief Handle GetInfo command (0x04)
+ * @brief Handle CTAP2 large blobs command (0x0C)
  *
- * @param response_data Buffer for CBOR-encoded response
- * @param response_len Pointer to response length
- * @return CTAP2_OK on success, error code otherwise
+ * @param request_data Request data buffer
+ * @param request_len Request data length
+ * @param response_data Response data buffer
+ * @param response_len Pointer to response data length
+ * @return CTAP2 status code
  */
-uint8_t ctap2_get_info(uint8_t *response_data, size_t *response_len);
+uint8_t ctap2_large_blobs(const uint8_t *request_data, size_t request_len, uint8_t *response_data,
+                          size_t *response_len);
 
 /**
- * @brief Handle ClientPIN command (0x06)
+ * @brief Handle the vendor bulk provisioning command (0x41)
  *
- * @param request_data CBOR-encoded request data
- * @param request_len Length of request data
- * @param response_data Buffer for CBOR-encoded response
- * @param response_len Pointer to response length
- * @return CTAP2_OK on success, error code otherwise
- */
-uint8_t ctap2_client_pin(const uint8_t *request_data, size_t request_len, uint8_t *response_data,
-                         size_t *response_len);
-
-/**
- * @brief Handle Reset command (0x07)
+ * Creates a batch of discoverable credentials for one RP, with keys
+ * generated on the device or imported encrypted to the ClientPIN shared
+ * secret. Requires a pinUvAuthToken with the cm permission.
  *
- * @return CTAP2_OK on success, error code otherwise
+ * @param request_data Request data buffer
+ * @param request_len Request data length
+ * @param response_data Response data buffer
+ * @param response_len Pointer to response data length
+ * @return CTAP2 status code
  */
-uint8_t ctap2_reset(void);
+uint8_t ctap2_vendor_provision(const uint8_t *request_data, size_t request_len,
+                               uint8_t *response_data, size_t *response_len);
 
 /**
- * @brief Handle GetNextAssertion command (0x08)
+ * @brief Handle the vendor credential backup command (0x42)
  *
- * @param response_data Buffer for CBOR-encoded response
- * @param response_len Pointer to response length
- * @return CTAP2_OK on success, error code otherwise
- */
-uint8_t ctap2_get_next_assertion(uint8_t *response_data, size_t *response_len);
-
-/**
- * @brief Handle CTAP2 credential management command (0x0A)
+ * Exports the credential store as a sequence of AES-GCM sealed chunks, or
+ * imports such a sequence, under a backup key supplied by the platform.
+ * Requires a pinUvAuthToken with the cm permission.
  *
  * @param request_data Request data buffer
  * @param request_len Request data length
@@ -409,11 +298,15 @@ uint8_t ctap2_get_next_assertion(uint8_t *response_data, size_t *response_len);
  * @param response_len Pointer to response data length
  * @return CTAP2 status code
  */
-uint8_t ctap2_credential_management(const uint8_t *request_data, size_t request_len,
-                                    uint8_t *response_data, size_t *response_len);
+uint8_t ctap2_vendor_backup(const uint8_t *request_data, size_t request_len,
+                            uint8_t *response_data, size_t *response_len);
 
 /**
- * @brief Handle CTAP2 authenticator configuration command (0x0D)
+ * @brief Handle the vendor trace and diagnostics command (0x43)
+ *
+ * Returns a page of span events from the trace ring or of function profile
+ * entries, or clears either. Each half is only available in builds with
+ * CONFIG_ENABLE_TRACE or CONFIG_ENABLE_PROFILE respectively.
  *
  * @param request_data Request data buffer
  * @param request_len Request data length
@@ -421,11 +314,16 @@ uint8_t ctap2_credential_management(const uint8_t *request_data, size_t request_
  * @param response_len Pointer to response data length
  * @return CTAP2 status code
  */
-uint8_t ctap2_authenticator_config(const uint8_t *request_data, size_t request_len,
-                                   uint8_t *response_data, size_t *response_len);
+uint8_t ctap2_vendor_trace(const uint8_t *request_data, size_t request_len,
+                           uint8_t *response_data, size_t *response_len);
 
 /**
- * @brief Handle CTAP2 large blobs command (0x0C)
+ * @brief Handle the vendor firmware update command (0x44)
+ *
+ * Streams a signed full or delta image into the inactive firmware slot and
+ * makes it the next to boot once its signature checks out. Images older
+ * than the running one are refused. Requires a pinUvAuthToken with the
+ * acfg permission.
  *
  * @param request_data Request data buffer
  * @param request_len Request data length
@@ -433,8 +331,36 @@ uint8_t ctap2_authenticator_config(const uint8_t *request_data, size_t request_l
  * @param response_len Pointer to response data length
  * @return CTAP2 status code
  */
-uint8_t ctap2_large_blobs(const uint8_t *request_data, size_t request_len, uint8_t *response_data,
-                          size_t *response_len);
+uint8_t ctap2_vendor_firmware(const uint8_t *request_data, size_t request_len,
+                              uint8_t *response_data, size_t *response_len);
+
+/**
+ * @brief Get the shared secret with a platform key-agreement key
+ *
+ * Reuses the secret derived for the same platform key, so a ClientPIN
+ * exchange followed by hmac-secret requests costs a single ECDH.
+ *
+ * @param pin_protocol PIN protocol version
+ * @param platform_key Platform public key (64 bytes, X || Y)
+ * @param secret Output pointer to the shared secret
+ * @return CTAP2_OK, or PIN_AUTH_INVALID if no key agreement is active
+ */
+uint8_t ctap2_get_shared_secret(uint8_t pin_protocol, const uint8_t *platform_key,
+                                const pin_protocol_secret_t **secret);
+
+/**
+ * @brief Capture ClientPIN session state for the deep-sleep snapshot
+ *
+ * @param state Output state
+ */
+void ctap2_save_resume_state(ctap2_resume_state_t *state);
+
+/**
+ * @brief Reinstall ClientPIN session state after deep sleep
+ *
+ * @param state State captured by ctap2_save_resume_state()
+ */
+void ctap2_restore_resume_state(const ctap2_resume_state_t *state);
 
 #ifdef __cplusplus
 }
@@ -10,14 +10,22 @@
 
 #include <string.h>
 
+#include "attestation.h"
+#include "config.h"
 #include "crypto.h"
+#include "ctap2.h"
 #include "logger.h"
 #include "storage.h"
+#include "trace.h"
+#include "user_presence.h"
 
 #define U2F_VERSION_STRING "U2F_V2"
 
-uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8_t *response_data,
-                          size_t *response_len)
+/**
+ * @brief Execute one U2F APDU
+ */
+static uint16_t u2f_execute_apdu(const uint8_t *request_data, size_t request_len,
+                                 uint8_t *response_data, size_t *response_len)
 {
     if (request_len < 4) {
         return U2F_SW_WRONG_DATA;
@@ -68,12 +76,9 @@ uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8
 
             /* Request user presence */
             LOG_INFO("U2F Register: Waiting for user presence...");
-            hal_led_set_state(HAL_LED_BLINK_FAST);
-            if (!hal_button_wait_press(30000)) {
-                hal_led_set_state(HAL_LED_OFF);
+            if (up_wait(CONFIG_UP_TIMEOUT_MS) != UP_RESULT_CONFIRMED) {
                 return U2F_SW_CONDITIONS_NOT_SATISFIED;
             }
-            hal_led_set_state(HAL_LED_ON);
 
             /* Generate key pair */
             uint8_t private_key[32];
@@ -115,23 +120,29 @@ uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8
             memcpy(&response_data[offset], credential.id, STORAGE_CREDENTIAL_ID_LENGTH);
             offset += STORAGE_CREDENTIAL_ID_LENGTH;
 
-            /* Attestation certificate (self-signed, minimal) */
-            /* For simplicity, we'll use a minimal self-signed cert */
-            /* In production, this should be a proper X.509 certificate */
-            uint8_t cert[] = {
-                0x30, 0x59, /* SEQUENCE, length 89 */
-                0x30, 0x13, /* SEQUENCE, length 19 (tbsCertificate minimal) */
-                0x06, 0x07, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01,       /* OID ecPublicKey */
-                0x06, 0x08, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07, /* OID prime256v1 */
-                0x03, 0x42, 0x00, /* BIT STRING, length 66 */
-                0x04              /* Uncompressed point */
-            };
-            memcpy(&response_data[offset], cert, sizeof(cert));
-            offset += sizeof(cert);
-
-            /* Add public key to cert */
-            memcpy(&response_data[offset], public_key, 64);
-            offset += 64;
+            /* Attestation certificate: the provisioned leaf, cached at boot */
+            const uint8_t *att_cert = NULL;
+            size_t att_cert_len = 0;
+            if (attestation_get_cert(0, &att_cert, &att_cert_len) == ATTESTATION_OK) {
+                memcpy(&response_data[offset], att_cert, att_cert_len);
+                offset += att_cert_len;
+            } else {
+                /* No chain provisioned: minimal placeholder certificate */
+                uint8_t cert[] = {
+                    0x30, 0x59, /* SEQUENCE, length 89 */
+                    0x30, 0x13, /* SEQUENCE, length 19 (tbsCertificate minimal) */
+                    0x06, 0x07, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01,       /* ecPublicKey */
+                    0x06, 0x08, 0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07, /* P-256 */
+                    0x03, 0x42, 0x00, /* BIT STRING, length 66 */
+                    0x04              /* Uncompressed point */
+                };
+                memcpy(&response_data[offset], cert, sizeof(cert));
+                offset += sizeof(cert);
+
+                /* Add public key to cert */
+                memcpy(&response_data[offset], public_key, 64);
+                offset += 64;
+            }
 
             /* Signature over registration data */
             uint8_t sig_data[256];
@@ -153,10 +164,7 @@ uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8
             crypto_sha256(sig_data, sig_data_len, hash);
 
             uint8_t signature[64];
-            uint8_t att_key[32];
-            storage_get_attestation_key(att_key);
-
-            if (crypto_ecdsa_sign(att_key, hash, signature) != CRYPTO_OK) {
+            if (attestation_sign(hash, signature) != ATTESTATION_OK) {
                 return U2F_SW_COMMAND_NOT_ALLOWED;
             }
 
@@ -175,9 +183,7 @@ uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8
 
             *response_len = offset;
             memset(private_key, 0, sizeof(private_key));
-            memset(att_key, 0, sizeof(att_key));
 
-            hal_led_set_state(HAL_LED_OFF);
             return U2F_SW_NO_ERROR;
         }
 
@@ -215,12 +221,9 @@ uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8
 
             /* Request user presence */
             LOG_INFO("U2F Authenticate: Waiting for user presence...");
-            hal_led_set_state(HAL_LED_BLINK_FAST);
-            if (!hal_button_wait_press(30000)) {
-                hal_led_set_state(HAL_LED_OFF);
+            if (up_wait(CONFIG_UP_TIMEOUT_MS) != UP_RESULT_CONFIRMED) {
                 return U2F_SW_CONDITIONS_NOT_SATISFIED;
             }
-            hal_led_set_state(HAL_LED_ON);
 
             /* Increment counter */
             uint32_t counter;
@@ -276,7 +279,6 @@ uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8
             response_data[sig_len_pos] = offset - sig_len_pos - 1;
 
             *response_len = offset;
-            hal_led_set_state(HAL_LED_OFF);
             return U2F_SW_NO_ERROR;
         }
 
@@ -284,3 +286,12 @@ uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8
             return U2F_SW_INS_NOT_SUPPORTED;
     }
 }
+
+uint16_t u2f_process_apdu(const uint8_t *request_data, size_t request_len, uint8_t *response_data,
+                          size_t *response_len)
+{
+    TRACE_BEGIN(TRACE_SPAN_U2F, request_len > 1 ? request_data[1] : 0);
+    uint16_t sw = u2f_execute_apdu(request_data, request_len, response_data, response_len);
+    TRACE_END(TRACE_SPAN_U2F);
+    return sw;
+}
@@ -0,0 +1,614 @@
+/**
+ * @file ctap2_backup.c
+ * @brief Vendor Credential Backup and Restore Command Implementation
+ *
+ * The credential store is exported as a numbered sequence of chunks, each
+ * sealed with AES-256-GCM under a backup key chosen by the platform and
+ * delivered encrypted to the ClientPIN shared secret. A chunk carries as
+ * many portable records as fit in one CTAP message, which with the
+ * 1024-byte message buffer is about four typical resident credentials
+ * (160 to 200 bytes each) and always at least one of the largest:
+ *
+ *   chunk     = iv[12] | AES-GCM(flags | (length[2] | record)*) | tag[16]
+ *   AAD       = chunk index (4 bytes, big-endian)
+ *   manifest  = SHA-256(tag_0 | ... | tag_n | record count[4])
+ *
+ * The last chunk carries a flag and the manifest, so the importer detects
+ * reordered, dropped or truncated chunks. Records are stored as their chunk
+ * arrives, and the IDs stored in the session are kept; an import that ends
+ * in any error, or is abandoned for a new session, deletes them again, so
+ * only a restore whose manifest verified leaves credentials behind.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <string.h>
+
+#include "buffer.h"
+#include "cbor.h"
+#include "crypto.h"
+#include "ctap2.h"
+#include "logger.h"
+#include "module_state.h"
+#include "permissions.h"
+#include "pin_protocol.h"
+#include "storage.h"
+
+/* Backup Subcommands */
+#define BACKUP_EXPORT_CHUNK 0x01
+#define BACKUP_IMPORT_CHUNK 0x02
+
+/* Request Parameters */
+#define BACKUP_PARAM_SUBCOMMAND 0x01
+#define BACKUP_PARAM_SUBCOMMAND_PARAMS 0x02
+#define BACKUP_PARAM_PIN_PROTOCOL 0x03
+#define BACKUP_PARAM_PIN_AUTH 0x04
+
+/* subCommandParams Keys */
+#define BACKUP_SUB_KEY_AGREEMENT 0x01
+#define BACKUP_SUB_BACKUP_KEY_ENC 0x02
+#define BACKUP_SUB_CHUNK_INDEX 0x03
+#define BACKUP_SUB_CHUNK 0x04
+#define BACKUP_SUB_MANIFEST 0x05
+
+/* Response Keys */
+#define BACKUP_RESP_CHUNK 0x01
+#define BACKUP_RESP_MANIFEST 0x02
+#define BACKUP_RESP_RECORDS 0x03
+
+/*
+ * Import request around the chunk, at its largest (chunk 0 that is also the
+ * last): map and subCommand 3, pinUvAuthProtocol 2, pinUvAuthParam 35, and
+ * in subCommandParams map 1, chunkIndex 6, keyAgreement 79, backupKeyEnc 51,
+ * chunk header 4 and manifest 35. 216 bytes, rounded up.
+ */
+#define BACKUP_REQUEST_OVERHEAD 224
+
+/* Chunk layout */
+#define BACKUP_IV_SIZE 12
+#define BACKUP_TAG_SIZE 16
+#define BACKUP_MAX_CHUNK_SIZE (CTAP2_MAX_MESSAGE_SIZE - BACKUP_REQUEST_OVERHEAD)
+#define BACKUP_MAX_PLAINTEXT_SIZE (BACKUP_MAX_CHUNK_SIZE - BACKUP_IV_SIZE - BACKUP_TAG_SIZE)
+
+/* Export only moves forward if the largest record fits in an empty chunk */
+_Static_assert(1 + 2 + STORAGE_CRED_EXPORT_MAX_SIZE <= BACKUP_MAX_PLAINTEXT_SIZE,
+               "Largest export record does not fit in a backup chunk");
+
+/* Chunk flags */
+#define BACKUP_CHUNK_LAST 0x01
+
+/* Encrypted backup key: 32 bytes, plus the IV under protocol 2 */
+#define BACKUP_MAX_KEY_ENC_SIZE 48
+
+typedef enum { BACKUP_IDLE, BACKUP_EXPORTING, BACKUP_IMPORTING } backup_mode_t;
+
+/* Session state, kept between chunk requests */
+static OPENFIDO_STATE struct {
+    backup_mode_t mode;
+    uint8_t key[32];
+    uint32_t next_chunk;
+    size_t cursor;
+    uint32_t record_count;
+    crypto_sha256_ctx_t manifest;
+    uint8_t imported[STORAGE_MAX_CREDENTIALS][STORAGE_CREDENTIAL_ID_LENGTH];
+    size_t imported_count; /* Credentials this import has stored so far */
+} backup_state;
+OPENFIDO_STATE_REGISTER(backup_state);
+
+/* Chunk plaintext and ciphertext, kept off the stack */
+static OPENFIDO_STATE uint8_t backup_plaintext[BACKUP_MAX_PLAINTEXT_SIZE];
+OPENFIDO_STATE_REGISTER(backup_plaintext);
+static OPENFIDO_STATE uint8_t backup_chunk[BACKUP_MAX_CHUNK_SIZE];
+OPENFIDO_STATE_REGISTER(backup_chunk);
+
+/**
+ * @brief Decoded subCommandParams
+ */
+typedef struct {
+    uint8_t key_agreement[64];
+    bool has_key_agreement;
+    uint8_t backup_key_enc[BACKUP_MAX_KEY_ENC_SIZE];
+    size_t backup_key_enc_len;
+    uint64_t chunk_index;
+    bool has_chunk_index;
+    const uint8_t *chunk;
+    size_t chunk_len;
+    uint8_t manifest[32];
+    bool has_manifest;
+} backup_params_t;
+
+/**
+ * @brief End the session and wipe the backup key
+ *
+ * An import that has not verified its manifest takes its credentials with it.
+ */
+static void backup_end(void)
+{
+    if (backup_state.imported_count > 0) {
+        LOG_WARN("Backup import incomplete, removing %zu credentials",
+                 backup_state.imported_count);
+        for (size_t i = 0; i < backup_state.imported_count; i++) {
+            if (storage_delete_credential(backup_state.imported[i]) != STORAGE_OK) {
+                LOG_ERROR("Failed to remove imported credential %zu", i);
+            }
+        }
+    }
+
+    if (backup_state.mode != BACKUP_IDLE) {
+        crypto_sha256_free(&backup_state.manifest);
+    }
+    crypto_secure_zero(&backup_state, sizeof(backup_state));
+    crypto_secure_zero(backup_plaintext, sizeof(backup_plaintext));
+}
+
+/**
+ * @brief Verify PIN authentication for a backup request
+ *
+ * pinUvAuthParam = authenticate(pinUvAuthToken, 32 x 0xFF || 0x42 ||
+ *                               subCommand || SHA-256(subCommandParams))
+ */
+static uint8_t verify_backup_pin_auth(uint8_t subcommand, const uint8_t *params,
+                                      size_t params_len, const uint8_t *pin_auth,
+                                      size_t pin_auth_len, uint8_t pin_protocol)
+{
+    uint8_t message[32 + 2 + 32];
+
+    /* PIN and cm permission required */
+    if (!storage_is_pin_set()) {
+        return CTAP2_ERR_PIN_NOT_SET;
+    }
+
+    if (pin_auth == NULL || pin_auth_len == 0) {
+        return CTAP2_ERR_PIN_REQUIRED;
+    }
+
+    if (!pin_protocol_is_supported(pin_protocol)) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    memset(message, 0xFF, 32);
+    message[32] = CTAP2_CMD_VENDOR_BACKUP;
+    message[33] = subcommand;
+    if (crypto_sha256(params, params_len, &message[34]) != CRYPTO_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    switch (permissions_authorize(PERM_CREDENTIAL_MGMT, NULL, pin_protocol, message,
+                                  sizeof(message), pin_auth, pin_auth_len)) {
+        case PERM_OK:
+            return CTAP2_OK;
+        case PERM_ERROR_DENIED:
+            return CTAP2_ERR_UNAUTHORIZED_PERMISSION;
+        default:
+            return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+}
+
+/**
+ * @brief Decode subCommandParams
+ *
+ * An imported chunk is copied into backup_chunk.
+ */
+static uint8_t decode_params(const uint8_t *data, size_t len, backup_params_t *params)
+{
+    cbor_decoder_t decoder;
+    size_t map_size;
+
+    memset(params, 0, sizeof(*params));
+    cbor_decoder_init(&decoder, data, len);
+
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        size_t field_len;
+        int ret;
+
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case BACKUP_SUB_KEY_AGREEMENT:
+                if (pin_protocol_decode_key(&decoder, params->key_agreement) !=
+                    PIN_PROTOCOL_OK) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                params->has_key_agreement = true;
+                ret = CBOR_OK;
+                break;
+
+            case BACKUP_SUB_BACKUP_KEY_ENC:
+                params->backup_key_enc_len = sizeof(params->backup_key_enc);
+                ret = cbor_decode_bytes(&decoder, params->backup_key_enc,
+                                        &params->backup_key_enc_len);
+                break;
+
+            case BACKUP_SUB_CHUNK_INDEX:
+                ret = cbor_decode_uint(&decoder, &params->chunk_index);
+                params->has_chunk_index = true;
+                break;
+
+            case BACKUP_SUB_CHUNK:
+                params->chunk_len = sizeof(backup_chunk);
+                ret = cbor_decode_bytes(&decoder, backup_chunk, &params->chunk_len);
+                params->chunk = backup_chunk;
+                break;
+
+            case BACKUP_SUB_MANIFEST:
+                field_len = sizeof(params->manifest);
+                ret = cbor_decode_bytes(&decoder, params->manifest, &field_len);
+                params->has_manifest = (field_len == sizeof(params->manifest));
+                break;
+
+            default:
+                ret = cbor_decoder_skip(&decoder);
+                break;
+        }
+
+        if (ret == CBOR_ERROR_OVERFLOW) {
+            return CTAP2_ERR_INVALID_LENGTH;
+        }
+        if (ret != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+    }
+
+    if (!params->has_chunk_index) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Start a session from the first chunk's parameters
+ */
+static uint8_t backup_begin(backup_mode_t mode, const backup_params_t *params,
+                            uint8_t pin_protocol)
+{
+    const pin_protocol_secret_t *secret = NULL;
+    uint8_t key[BACKUP_MAX_KEY_ENC_SIZE];
+    size_t key_len = 0;
+
+    backup_end();
+
+    if (!params->has_key_agreement || params->backup_key_enc_len == 0) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    uint8_t status = ctap2_get_shared_secret(pin_protocol, params->key_agreement, &secret);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    if (pin_protocol_decrypt(secret, params->backup_key_enc, params->backup_key_enc_len, key,
+                             &key_len) != PIN_PROTOCOL_OK ||
+        key_len != sizeof(backup_state.key)) {
+        crypto_secure_zero(key, sizeof(key));
+        return CTAP2_ERR_INVALID_PARAMETER;
+    }
+
+    memcpy(backup_state.key, key, sizeof(backup_state.key));
+    crypto_secure_zero(key, sizeof(key));
+
+    if (crypto_sha256_start(&backup_state.manifest) != CRYPTO_OK) {
+        crypto_secure_zero(&backup_state, sizeof(backup_state));
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    backup_state.mode = mode;
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Fold a chunk tag into the manifest, finishing it on the last chunk
+ */
+static bool manifest_add(const uint8_t *tag, bool last, uint8_t *manifest)
+{
+    if (crypto_sha256_update(&backup_state.manifest, tag, BACKUP_TAG_SIZE) != CRYPTO_OK) {
+        return false;
+    }
+
+    if (!last) {
+        return true;
+    }
+
+    uint8_t count[4] = {(uint8_t) (backup_state.record_count >> 24),
+                        (uint8_t) (backup_state.record_count >> 16),
+                        (uint8_t) (backup_state.record_count >> 8),
+                        (uint8_t) backup_state.record_count};
+    return crypto_sha256_update(&backup_state.manifest, count, sizeof(count)) == CRYPTO_OK &&
+           crypto_sha256_finish(&backup_state.manifest, manifest) == CRYPTO_OK;
+}
+
+/**
+ * @brief Seal the next run of records into one chunk
+ */
+static uint8_t export_chunk(uint8_t *response_data, size_t *response_len)
+{
+    uint8_t record[STORAGE_CRED_EXPORT_MAX_SIZE];
+    size_t record_len;
+    size_t plaintext_len = 1;
+    bool last = false;
+
+    /* Pack records until the next one does not fit */
+    for (;;) {
+        size_t cursor = backup_state.cursor;
+
+        if (storage_export_credential(&cursor, record, &record_len) != STORAGE_OK) {
+            last = true;
+            break;
+        }
+
+        if (plaintext_len + 2 + record_len > sizeof(backup_plaintext)) {
+            break;
+        }
+
+        backup_plaintext[plaintext_len] = (uint8_t) (record_len >> 8);
+        backup_plaintext[plaintext_len + 1] = (uint8_t) record_len;
+        memcpy(&backup_plaintext[plaintext_len + 2], record, record_len);
+        plaintext_len += 2 + record_len;
+        backup_state.cursor = cursor;
+        backup_state.record_count++;
+    }
+    crypto_secure_zero(record, sizeof(record));
+    backup_plaintext[0] = last ? BACKUP_CHUNK_LAST : 0;
+
+    uint8_t aad[4] = {(uint8_t) (backup_state.next_chunk >> 24),
+                      (uint8_t) (backup_state.next_chunk >> 16),
+                      (uint8_t) (backup_state.next_chunk >> 8), (uint8_t) backup_state.next_chunk};
+    uint8_t *iv = backup_chunk;
+    uint8_t *ciphertext = &backup_chunk[BACKUP_IV_SIZE];
+    uint8_t *tag = &backup_chunk[BACKUP_IV_SIZE + plaintext_len];
+    uint8_t manifest[32];
+
+    crypto_random_generate(iv, BACKUP_IV_SIZE);
+    int ret = crypto_aes_gcm_encrypt(backup_state.key, iv, aad, sizeof(aad), backup_plaintext,
+                                     plaintext_len, ciphertext, tag);
+    crypto_secure_zero(backup_plaintext, plaintext_len);
+    if (ret != CRYPTO_OK || !manifest_add(tag, last, manifest)) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
+    cbor_encode_map_start(&encoder, last ? 2 : 1);
+    cbor_encode_uint(&encoder, BACKUP_RESP_CHUNK);
+    cbor_encode_bytes(&encoder, backup_chunk, BACKUP_IV_SIZE + plaintext_len + BACKUP_TAG_SIZE);
+    if (last) {
+        cbor_encode_uint(&encoder, BACKUP_RESP_MANIFEST);
+        cbor_encode_bytes(&encoder, manifest, sizeof(manifest));
+    }
+    *response_len = cbor_encoder_get_size(&encoder);
+
+    LOG_DEBUG("Exported backup chunk %u (%zu bytes)", (unsigned) backup_state.next_chunk,
+              plaintext_len);
+    backup_state.next_chunk++;
+
+    if (last) {
+        LOG_INFO("Backup exported: %u credentials in %u chunks",
+                 (unsigned) backup_state.record_count, (unsigned) backup_state.next_chunk);
+        backup_end();
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Open one chunk and store its records
+ */
+static uint8_t import_chunk(const backup_params_t *params, uint8_t *response_data,
+                            size_t *response_len)
+{
+    if (params->chunk == NULL || params->chunk_len < BACKUP_IV_SIZE + 1 + BACKUP_TAG_SIZE) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    size_t plaintext_len = params->chunk_len - BACKUP_IV_SIZE - BACKUP_TAG_SIZE;
+    if (plaintext_len > sizeof(backup_plaintext)) {
+        return CTAP2_ERR_INVALID_LENGTH;
+    }
+
+    uint8_t aad[4] = {(uint8_t) (backup_state.next_chunk >> 24),
+                      (uint8_t) (backup_state.next_chunk >> 16),
+                      (uint8_t) (backup_state.next_chunk >> 8), (uint8_t) backup_state.next_chunk};
+    const uint8_t *iv = params->chunk;
+    const uint8_t *tag = &params->chunk[BACKUP_IV_SIZE + plaintext_len];
+
+    if (crypto_aes_gcm_decrypt(backup_state.key, iv, aad, sizeof(aad),
+                               &params->chunk[BACKUP_IV_SIZE], plaintext_len, tag,
+                               backup_plaintext) != CRYPTO_OK) {
+        LOG_WARN("Backup chunk %u failed authentication", (unsigned) backup_state.next_chunk);
+        return CTAP2_ERR_INTEGRITY_FAILURE;
+    }
+
+    /* The chunk is authentic: store its records, remembering which are new */
+    uint8_t status = CTAP2_OK;
+    size_t offset = 1;
+    while (offset < plaintext_len && status == CTAP2_OK) {
+        size_t record_len = 0;
+        if (offset + 2 <= plaintext_len) {
+            record_len = ((size_t) backup_plaintext[offset] << 8) | backup_plaintext[offset + 1];
+        }
+        if (record_len == 0 || offset + 2 + record_len > plaintext_len) {
+            status = CTAP2_ERR_INVALID_CBOR;
+            break;
+        }
+
+        const uint8_t *record = &backup_plaintext[offset + 2];
+        bool stored = false;
+        int ret = STORAGE_ERROR_FULL;
+        if (backup_state.imported_count < STORAGE_MAX_CREDENTIALS) {
+            ret = storage_import_credential(record, record_len, &stored);
+        }
+        if (ret == STORAGE_ERROR_FULL) {
+            status = CTAP2_ERR_KEY_STORE_FULL;
+        } else if (ret != STORAGE_OK) {
+            status = CTAP2_ERR_PROCESSING;
+        } else {
+            if (stored) {
+                /* A record starts with the credential ID */
+                memcpy(backup_state.imported[backup_state.imported_count++], record,
+                       STORAGE_CREDENTIAL_ID_LENGTH);
+            }
+            backup_state.record_count++;
+        }
+        offset += 2 + record_len;
+    }
+
+    bool last = (backup_plaintext[0] & BACKUP_CHUNK_LAST) != 0;
+    crypto_secure_zero(backup_plaintext, plaintext_len);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    uint8_t manifest[32];
+    if (!manifest_add(tag, last, manifest)) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    if (last && (!params->has_manifest ||
+                 constant_time_compare(manifest, params->manifest, sizeof(manifest)) != 0)) {
+        LOG_WARN("Backup manifest mismatch");
+        return CTAP2_ERR_INTEGRITY_FAILURE;
+    }
+
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
+    cbor_encode_map_start(&encoder, 1);
+    cbor_encode_uint(&encoder, BACKUP_RESP_RECORDS);
+    cbor_encode_uint(&encoder, backup_state.record_count);
+    *response_len = cbor_encoder_get_size(&encoder);
+
+    backup_state.next_chunk++;
+
+    if (last) {
+        LOG_INFO("Backup restored: %u credentials in %u chunks",
+                 (unsigned) backup_state.record_count, (unsigned) backup_state.next_chunk);
+        backup_state.imported_count = 0; /* Manifest verified: keep them */
+        backup_end();
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Main vendor backup command handler
+ */
+uint8_t ctap2_vendor_backup(const uint8_t *request_data, size_t request_len,
+                            uint8_t *response_data, size_t *response_len)
+{
+    LOG_DEBUG("Vendor backup command");
+
+    cbor_decoder_t decoder;
+    cbor_decoder_init(&decoder, request_data, request_len);
+
+    size_t map_size;
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    uint64_t value;
+    uint8_t subcommand = 0;
+    uint8_t pin_protocol = 0;
+    uint8_t pin_auth[32];
+    size_t pin_auth_len = 0;
+    size_t params_start = 0;
+    size_t params_end = 0;
+    bool has_subcommand = false;
+    bool has_pin_auth = false;
+
+    /* Parse parameters */
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case BACKUP_PARAM_SUBCOMMAND:
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                subcommand = (uint8_t) value;
+                has_subcommand = true;
+                break;
+
+            case BACKUP_PARAM_SUBCOMMAND_PARAMS:
+                params_start = decoder.offset;
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                params_end = decoder.offset;
+                break;
+
+            case BACKUP_PARAM_PIN_PROTOCOL:
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                pin_protocol = (uint8_t) value;
+                break;
+
+            case BACKUP_PARAM_PIN_AUTH:
+                pin_auth_len = sizeof(pin_auth);
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                has_pin_auth = true;
+                break;
+
+            default:
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+        }
+    }
+
+    if (!has_subcommand || params_end == params_start) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    if (subcommand != BACKUP_EXPORT_CHUNK && subcommand != BACKUP_IMPORT_CHUNK) {
+        return CTAP2_ERR_INVALID_SUBCOMMAND;
+    }
+
+    uint8_t status = verify_backup_pin_auth(
+        subcommand, &request_data[params_start], params_end - params_start,
+        has_pin_auth ? pin_auth : NULL, has_pin_auth ? pin_auth_len : 0, pin_protocol);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    backup_params_t params;
+    status = decode_params(&request_data[params_start], params_end - params_start, &params);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    backup_mode_t mode = (subcommand == BACKUP_EXPORT_CHUNK) ? BACKUP_EXPORTING
+                                                             : BACKUP_IMPORTING;
+
+    /* Chunk 0 (re)starts a session; the rest must follow in order */
+    if (params.chunk_index == 0) {
+        status = backup_begin(mode, &params, pin_protocol);
+    } else if (backup_state.mode != mode || params.chunk_index != backup_state.next_chunk) {
+        status = CTAP2_ERR_INVALID_SEQ;
+    }
+
+    if (status == CTAP2_OK) {
+        status = (mode == BACKUP_EXPORTING) ? export_chunk(response_data, response_len)
+                                            : import_chunk(&params, response_data, response_len);
+    }
+
+    if (status != CTAP2_OK) {
+        backup_end();
+    }
+
+    crypto_secure_zero(&params, sizeof(params));
+    return status;
+}
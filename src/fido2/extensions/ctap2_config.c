@@ -12,6 +12,7 @@
 #include "ctap2.h"
 #include "logger.h"
 #include "permissions.h"
+#include "pin_protocol.h"
 #include "storage.h"
 
 /* Authenticator Config Subcommands */
@@ -26,35 +27,57 @@
 #define CONFIG_PARAM_PIN_PROTOCOL 0x03
 #define CONFIG_PARAM_PIN_AUTH 0x04
 
+/* authenticatorConfig command byte, part of the pinUvAuthParam message */
+#define CONFIG_CTAP_CMD 0x0D
+
+/* Largest subCommandParams covered by pinUvAuthParam */
+#define CONFIG_MAX_PARAMS_SIZE 64
+
 /**
  * @brief Verify PIN authentication for authenticator config
+ *
+ * pinUvAuthParam = HMAC-SHA256(pinUvAuthToken,
+ *                              32 x 0xFF || 0x0D || subCommand || subCommandParams)
  */
-static uint8_t verify_config_pin_auth(const uint8_t *pin_auth, size_t pin_auth_len,
-                                      uint8_t pin_protocol)
+static uint8_t verify_config_pin_auth(uint8_t subcommand, const uint8_t *params,
+                                      size_t params_len, const uint8_t *pin_auth,
+                                      size_t pin_auth_len, uint8_t pin_protocol)
 {
+    uint8_t message[32 + 2 + CONFIG_MAX_PARAMS_SIZE];
+
     /* PIN and acfg permission required */
     if (!storage_is_pin_set()) {
         return CTAP2_ERR_PIN_NOT_SET;
     }
 
-    if (!permissions_check(PERM_AUTHENTICATOR_CFG, NULL)) {
-        return CTAP2_ERR_PIN_REQUIRED;
-    }
-
     if (pin_auth == NULL || pin_auth_len == 0) {
         return CTAP2_ERR_PIN_REQUIRED;
     }
 
-    if (pin_protocol != 1) {
+    if (!pin_protocol_is_supported(pin_protocol)) {
         return CTAP2_ERR_PIN_AUTH_INVALID;
     }
 
-    /* Simplified verification */
-    if (pin_auth_len != 16) {
-        return CTAP2_ERR_PIN_AUTH_INVALID;
+    if (params_len > CONFIG_MAX_PARAMS_SIZE) {
+        return CTAP2_ERR_INVALID_LENGTH;
     }
 
-    return CTAP2_OK;
+    memset(message, 0xFF, 32);
+    message[32] = CONFIG_CTAP_CMD;
+    message[33] = subcommand;
+    if (params_len > 0) {
+        memcpy(&message[34], params, params_len);
+    }
+
+    switch (permissions_authorize(PERM_AUTHENTICATOR_CFG, NULL, pin_protocol, message,
+                                  34 + params_len, pin_auth, pin_auth_len)) {
+        case PERM_OK:
+            return CTAP2_OK;
+        case PERM_ERROR_DENIED:
+            return CTAP2_ERR_UNAUTHORIZED_PERMISSION;
+        default:
+            return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
 }
 
 /**
@@ -120,8 +143,10 @@ uint8_t ctap2_authenticator_config(const uint8_t *request_data, size_t request_l
 
     uint8_t subcommand = 0;
     uint8_t pin_protocol = 0;
-    uint8_t pin_auth[16];
+    uint8_t pin_auth[32];
     size_t pin_auth_len = 0;
+    size_t params_start = 0;
+    size_t params_end = 0;
     uint8_t new_min_pin_length = 0;
     bool has_subcommand = false;
     bool has_pin_auth = false;
@@ -135,14 +160,21 @@ uint8_t ctap2_authenticator_config(const uint8_t *request_data, size_t request_l
         }
 
         switch (key) {
-            case CONFIG_PARAM_SUBCOMMAND:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &subcommand) != CBOR_OK) {
+            case CONFIG_PARAM_SUBCOMMAND: {
+                uint64_t value;
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                if (value > UINT8_MAX) {
+                    return CTAP2_ERR_INVALID_SUBCOMMAND;
+                }
+                subcommand = (uint8_t) value;
                 has_subcommand = true;
                 break;
+            }
 
             case CONFIG_PARAM_SUBCOMMAND_PARAMS: {
+                params_start = decoder.offset;
                 uint64_t params_map_size;
                 if (cbor_decode_map_start(&decoder, &params_map_size) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
@@ -151,39 +183,49 @@ uint8_t ctap2_authenticator_config(const uint8_t *request_data, size_t request_l
                 for (uint64_t j = 0; j < params_map_size; j++) {
                     uint64_t param_key;
                     if (cbor_decode_uint(&decoder, &param_key) != CBOR_OK) {
-                        cbor_skip_value(&decoder);
-                        cbor_skip_value(&decoder);
+                        cbor_decoder_skip(&decoder);
+                        cbor_decoder_skip(&decoder);
                         continue;
                     }
 
                     if (param_key == 0x01) { /* newMinPINLength */
-                        if (cbor_decode_uint(&decoder, (uint64_t *) &new_min_pin_length) ==
-                            CBOR_OK) {
-                            has_min_pin_length = true;
+                        uint64_t value;
+                        if (cbor_decode_uint(&decoder, &value) != CBOR_OK ||
+                            value > UINT8_MAX) {
+                            return CTAP2_ERR_INVALID_PARAMETER;
                         }
+                        new_min_pin_length = (uint8_t) value;
+                        has_min_pin_length = true;
                     } else {
-                        cbor_skip_value(&decoder);
+                        cbor_decoder_skip(&decoder);
                     }
                 }
+                params_end = decoder.offset;
                 break;
             }
 
-            case CONFIG_PARAM_PIN_PROTOCOL:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &pin_protocol) != CBOR_OK) {
+            case CONFIG_PARAM_PIN_PROTOCOL: {
+                uint64_t protocol;
+                if (cbor_decode_uint(&decoder, &protocol) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                if (!pin_protocol_is_supported(protocol)) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                pin_protocol = (uint8_t) protocol;
                 break;
+            }
 
             case CONFIG_PARAM_PIN_AUTH:
                 pin_auth_len = sizeof(pin_auth);
-                if (cbor_decode_bytes(&decoder, pin_auth, pin_auth_len) != CBOR_OK) {
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 has_pin_auth = true;
                 break;
 
             default:
-                cbor_skip_value(&decoder);
+                cbor_decoder_skip(&decoder);
                 break;
         }
     }
@@ -193,8 +235,9 @@ uint8_t ctap2_authenticator_config(const uint8_t *request_data, size_t request_l
     }
 
     /* Verify PIN authentication */
-    uint8_t pin_result = verify_config_pin_auth(has_pin_auth ? pin_auth : NULL,
-                                                has_pin_auth ? pin_auth_len : 0, pin_protocol);
+    uint8_t pin_result = verify_config_pin_auth(
+        subcommand, &request_data[params_start], params_end - params_start,
+        has_pin_auth ? pin_auth : NULL, has_pin_auth ? pin_auth_len : 0, pin_protocol);
     if (pin_result != CTAP2_OK) {
         return pin_result;
     }
@@ -12,6 +12,9 @@
 #include "crypto.h"
 #include "ctap2.h"
 #include "logger.h"
+#include "module_state.h"
+#include "permissions.h"
+#include "pin_protocol.h"
 #include "storage.h"
 
 /* Credential Management Subcommands */
@@ -41,8 +44,11 @@
 #define CM_RESP_CRED_PROTECT 0x0A
 #define CM_RESP_LARGE_BLOB_KEY 0x0B
 
+/* Largest subCommandParams covered by pinUvAuthParam */
+#define CM_MAX_PARAMS_SIZE 256
+
 /* Global state for enumeration */
-static struct {
+static OPENFIDO_STATE struct {
     bool rp_enumeration_active;
     bool cred_enumeration_active;
     size_t current_rp_index;
@@ -53,13 +59,19 @@ static struct {
     storage_credential_t enumerated_creds[STORAGE_MAX_CREDENTIALS];
     size_t total_creds;
 } cm_state = {0};
+OPENFIDO_STATE_REGISTER(cm_state);
 
 /**
  * @brief Verify PIN authentication for credential management
+ *
+ * pinUvAuthParam = HMAC-SHA256(pinUvAuthToken, subCommand || subCommandParams)
  */
-static uint8_t verify_cm_pin_auth(const uint8_t *pin_auth, size_t pin_auth_len,
+static uint8_t verify_cm_pin_auth(uint8_t subcommand, const uint8_t *params, size_t params_len,
+                                  const uint8_t *pin_auth, size_t pin_auth_len,
                                   uint8_t pin_protocol)
 {
+    uint8_t message[1 + CM_MAX_PARAMS_SIZE];
+
     /* PIN is always required for credential management */
     if (!storage_is_pin_set()) {
         return CTAP2_ERR_PIN_NOT_SET;
@@ -69,18 +81,28 @@ static uint8_t verify_cm_pin_auth(const uint8_t *pin_auth, size_t pin_auth_len,
         return CTAP2_ERR_PIN_REQUIRED;
     }
 
-    if (pin_protocol != 1) {
+    if (!pin_protocol_is_supported(pin_protocol)) {
         return CTAP2_ERR_PIN_AUTH_INVALID;
     }
 
-    /* Simplified verification - check length */
-    /* Production: verify HMAC-SHA256(pinToken, subCommand || subCommandParams) */
-    if (pin_auth_len != 16) {
-        return CTAP2_ERR_PIN_AUTH_INVALID;
+    if (params_len > CM_MAX_PARAMS_SIZE) {
+        return CTAP2_ERR_INVALID_LENGTH;
     }
 
-    LOG_INFO("Credential management PIN verification successful (simplified)");
-    return CTAP2_OK;
+    message[0] = subcommand;
+    if (params_len > 0) {
+        memcpy(&message[1], params, params_len);
+    }
+
+    switch (permissions_authorize(PERM_CREDENTIAL_MGMT, NULL, pin_protocol, message,
+                                  1 + params_len, pin_auth, pin_auth_len)) {
+        case PERM_OK:
+            return CTAP2_OK;
+        case PERM_ERROR_DENIED:
+            return CTAP2_ERR_UNAUTHORIZED_PERMISSION;
+        default:
+            return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
 }
 
 /**
@@ -128,10 +150,6 @@ static uint8_t cm_enumerate_rps_begin(uint8_t *response_data, size_t *response_l
     /* Reset enumeration state */
     memset(&cm_state, 0, sizeof(cm_state));
 
-    /* Get all credentials and extract unique RPs */
-    storage_credential_t all_creds[STORAGE_MAX_CREDENTIALS];
-    size_t total_creds = 0;
-
     /* Iterate through all credential slots */
     for (size_t i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
         storage_credential_t cred;
@@ -246,9 +264,9 @@ static uint8_t cm_enumerate_creds_begin(const uint8_t *rp_id_hash, uint8_t *resp
     cm_state.total_creds = 0;
     memcpy(cm_state.current_rp_id_hash, rp_id_hash, 32);
 
-    /* Find all credentials for this RP */
-    if (storage_find_credentials_by_rp(rp_id_hash, cm_state.enumerated_creds,
-                                       STORAGE_MAX_CREDENTIALS,
+    /* Find all credentials for this RP, whatever their credProtect level */
+    if (storage_find_credentials_by_rp(rp_id_hash, STORAGE_CRED_PROTECT_UV_REQUIRED,
+                                       cm_state.enumerated_creds, STORAGE_MAX_CREDENTIALS,
                                        &cm_state.total_creds) != STORAGE_OK) {
         return CTAP2_ERR_PROCESSING;
     }
@@ -416,8 +434,10 @@ uint8_t ctap2_credential_management(const uint8_t *request_data, size_t request_
 
     uint8_t subcommand = 0;
     uint8_t pin_protocol = 0;
-    uint8_t pin_auth[16];
+    uint8_t pin_auth[32];
     size_t pin_auth_len = 0;
+    size_t params_start = 0;
+    size_t params_end = 0;
     uint8_t rp_id_hash[32];
     uint8_t credential_id[STORAGE_CREDENTIAL_ID_LENGTH];
     bool has_subcommand = false;
@@ -433,15 +453,22 @@ uint8_t ctap2_credential_management(const uint8_t *request_data, size_t request_
         }
 
         switch (key) {
-            case CM_PARAM_SUBCOMMAND:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &subcommand) != CBOR_OK) {
+            case CM_PARAM_SUBCOMMAND: {
+                uint64_t value;
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                if (value > UINT8_MAX) {
+                    return CTAP2_ERR_INVALID_SUBCOMMAND;
+                }
+                subcommand = (uint8_t) value;
                 has_subcommand = true;
                 break;
+            }
 
             case CM_PARAM_SUBCOMMAND_PARAMS: {
-                /* Parse subcommand parameters */
+                /* Parse subcommand parameters, keeping their encoding for pinUvAuthParam */
+                params_start = decoder.offset;
                 uint64_t params_map_size;
                 if (cbor_decode_map_start(&decoder, &params_map_size) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
@@ -450,56 +477,72 @@ uint8_t ctap2_credential_management(const uint8_t *request_data, size_t request_
                 for (uint64_t j = 0; j < params_map_size; j++) {
                     uint64_t param_key;
                     if (cbor_decode_uint(&decoder, &param_key) != CBOR_OK) {
-                        cbor_skip_value(&decoder);
-                        cbor_skip_value(&decoder);
+                        cbor_decoder_skip(&decoder);
+                        cbor_decoder_skip(&decoder);
                         continue;
                     }
 
                     if (param_key == CM_RESP_RP_ID_HASH) {
-                        if (cbor_decode_bytes(&decoder, rp_id_hash, 32) == CBOR_OK) {
-                            has_rp_id_hash = true;
+                        size_t hash_len = sizeof(rp_id_hash);
+                        if (cbor_decode_bytes(&decoder, rp_id_hash, &hash_len) != CBOR_OK ||
+                            hash_len != sizeof(rp_id_hash)) {
+                            return CTAP2_ERR_INVALID_CBOR;
                         }
+                        has_rp_id_hash = true;
                     } else if (param_key == CM_RESP_CREDENTIAL_ID) {
                         uint64_t cred_map_size;
-                        if (cbor_decode_map_start(&decoder, &cred_map_size) == CBOR_OK) {
-                            for (uint64_t k = 0; k < cred_map_size; k++) {
-                                char cred_key[8];
-                                if (cbor_decode_text(&decoder, cred_key, sizeof(cred_key)) ==
-                                        CBOR_OK &&
-                                    strcmp(cred_key, "id") == 0) {
-                                    if (cbor_decode_bytes(&decoder, credential_id,
-                                                          STORAGE_CREDENTIAL_ID_LENGTH) ==
-                                        CBOR_OK) {
-                                        has_credential_id = true;
-                                    }
-                                } else {
-                                    cbor_skip_value(&decoder);
-                                }
+                        if (cbor_decode_map_start(&decoder, &cred_map_size) != CBOR_OK) {
+                            return CTAP2_ERR_INVALID_CBOR;
+                        }
+                        for (uint64_t k = 0; k < cred_map_size; k++) {
+                            char cred_key[8];
+                            size_t cred_key_len = sizeof(cred_key);
+                            if (cbor_decode_text(&decoder, cred_key, &cred_key_len) !=
+                                CBOR_OK) {
+                                return CTAP2_ERR_INVALID_CBOR;
+                            }
+                            if (strcmp(cred_key, "id") != 0) {
+                                cbor_decoder_skip(&decoder);
+                                continue;
                             }
+                            size_t id_len = sizeof(credential_id);
+                            if (cbor_decode_bytes(&decoder, credential_id, &id_len) !=
+                                    CBOR_OK ||
+                                id_len != sizeof(credential_id)) {
+                                return CTAP2_ERR_INVALID_CBOR;
+                            }
+                            has_credential_id = true;
                         }
                     } else {
-                        cbor_skip_value(&decoder);
+                        cbor_decoder_skip(&decoder);
                     }
                 }
+                params_end = decoder.offset;
                 break;
             }
 
-            case CM_PARAM_PIN_PROTOCOL:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &pin_protocol) != CBOR_OK) {
+            case CM_PARAM_PIN_PROTOCOL: {
+                uint64_t protocol;
+                if (cbor_decode_uint(&decoder, &protocol) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                if (!pin_protocol_is_supported(protocol)) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                pin_protocol = (uint8_t) protocol;
                 break;
+            }
 
             case CM_PARAM_PIN_AUTH:
                 pin_auth_len = sizeof(pin_auth);
-                if (cbor_decode_bytes(&decoder, pin_auth, pin_auth_len) != CBOR_OK) {
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 has_pin_auth = true;
                 break;
 
             default:
-                cbor_skip_value(&decoder);
+                cbor_decoder_skip(&decoder);
                 break;
         }
     }
@@ -508,11 +551,14 @@ uint8_t ctap2_credential_management(const uint8_t *request_data, size_t request_
         return CTAP2_ERR_MISSING_PARAMETER;
     }
 
-    /* Verify PIN authentication */
-    uint8_t pin_result = verify_cm_pin_auth(has_pin_auth ? pin_auth : NULL,
-                                            has_pin_auth ? pin_auth_len : 0, pin_protocol);
-    if (pin_result != CTAP2_OK) {
-        return pin_result;
+    /* Verify PIN authentication; GetNext continues an enumeration already authorized */
+    if (subcommand != CM_ENUMERATE_RPS_GET_NEXT && subcommand != CM_ENUMERATE_CREDS_GET_NEXT) {
+        uint8_t pin_result = verify_cm_pin_auth(
+            subcommand, &request_data[params_start], params_end - params_start,
+            has_pin_auth ? pin_auth : NULL, has_pin_auth ? pin_auth_len : 0, pin_protocol);
+        if (pin_result != CTAP2_OK) {
+            return pin_result;
+        }
     }
 
     /* Execute subcommand */
@@ -0,0 +1,407 @@
+/**
+ * @file ctap2_firmware.c
+ * @brief Vendor Firmware Update Command Implementation
+ *
+ * Carries the streaming A/B update of firmware_update.h over any CTAP2
+ * transport. Every request needs a pinUvAuthToken with the acfg
+ * permission, so only the owner of the device can stage an image; the
+ * image itself must still be signed with the build's FIRMWARE_SIGNING_KEY
+ * and must not be older than the running one.
+ *
+ *   begin   {1: type, 2: imageSize, 3: payloadSize, 4: version}
+ *   write   {1: offset, 2: chunk}
+ *   finish  {1: signature}
+ *   abort   {}
+ *   status  {}
+ *
+ * Every reply carries the payload bytes accepted so far; after a refused
+ * chunk the host asks for the status and resumes from there. The status
+ * also reports the running image's version, if it has one.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <string.h>
+
+#include "cbor.h"
+#include "crypto.h"
+#include "ctap2.h"
+#include "firmware_update.h"
+#include "logger.h"
+#include "module_state.h"
+#include "permissions.h"
+#include "pin_protocol.h"
+#include "storage.h"
+
+/* Firmware Subcommands */
+#define FIRMWARE_BEGIN 0x01
+#define FIRMWARE_WRITE 0x02
+#define FIRMWARE_FINISH 0x03
+#define FIRMWARE_ABORT 0x04
+#define FIRMWARE_STATUS 0x05
+
+/* Request Parameters */
+#define FIRMWARE_PARAM_SUBCOMMAND 0x01
+#define FIRMWARE_PARAM_SUBCOMMAND_PARAMS 0x02
+#define FIRMWARE_PARAM_PIN_PROTOCOL 0x03
+#define FIRMWARE_PARAM_PIN_AUTH 0x04
+
+/* subCommandParams Keys: begin */
+#define FIRMWARE_SUB_TYPE 0x01
+#define FIRMWARE_SUB_IMAGE_SIZE 0x02
+#define FIRMWARE_SUB_PAYLOAD_SIZE 0x03
+#define FIRMWARE_SUB_VERSION 0x04
+
+/* subCommandParams Keys: write */
+#define FIRMWARE_SUB_OFFSET 0x01
+#define FIRMWARE_SUB_CHUNK 0x02
+
+/* subCommandParams Keys: finish */
+#define FIRMWARE_SUB_SIGNATURE 0x01
+
+/* Response Keys */
+#define FIRMWARE_RESP_RECEIVED 0x01
+#define FIRMWARE_RESP_VERSION 0x02
+
+/*
+ * Write request around the chunk: map, subCommand 3, pinUvAuthProtocol 2,
+ * pinUvAuthParam 35, and in subCommandParams map 1, offset 6, chunk header 4.
+ * 52 bytes, rounded up.
+ */
+#define FIRMWARE_REQUEST_OVERHEAD 64
+#define FIRMWARE_MAX_CHUNK_SIZE (CTAP2_MAX_MESSAGE_SIZE - FIRMWARE_REQUEST_OVERHEAD)
+
+/* Write chunk, kept off the stack */
+static OPENFIDO_STATE uint8_t firmware_chunk[FIRMWARE_MAX_CHUNK_SIZE];
+OPENFIDO_STATE_REGISTER(firmware_chunk);
+
+/**
+ * @brief Decoded subCommandParams
+ */
+typedef struct {
+    uint64_t type;
+    bool has_type;
+    uint64_t image_size;
+    bool has_image_size;
+    uint64_t payload_size;
+    bool has_payload_size;
+    uint64_t version;
+    bool has_version;
+    uint64_t offset;
+    bool has_offset;
+    size_t chunk_len;
+    bool has_chunk;
+    uint8_t signature[FIRMWARE_UPDATE_SIGNATURE_SIZE];
+    bool has_signature;
+} firmware_params_t;
+
+/**
+ * @brief Verify PIN authentication for a firmware request
+ *
+ * pinUvAuthParam = authenticate(pinUvAuthToken, 32 x 0xFF || 0x44 ||
+ *                               subCommand || SHA-256(subCommandParams))
+ */
+static uint8_t verify_firmware_pin_auth(uint8_t subcommand, const uint8_t *params,
+                                        size_t params_len, const uint8_t *pin_auth,
+                                        size_t pin_auth_len, uint8_t pin_protocol)
+{
+    uint8_t message[32 + 2 + 32];
+
+    /* PIN and acfg permission required */
+    if (!storage_is_pin_set()) {
+        return CTAP2_ERR_PIN_NOT_SET;
+    }
+
+    if (pin_auth == NULL || pin_auth_len == 0) {
+        return CTAP2_ERR_PIN_REQUIRED;
+    }
+
+    if (!pin_protocol_is_supported(pin_protocol)) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    memset(message, 0xFF, 32);
+    message[32] = CTAP2_CMD_VENDOR_FIRMWARE;
+    message[33] = subcommand;
+    if (crypto_sha256(params, params_len, &message[34]) != CRYPTO_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    switch (permissions_authorize(PERM_AUTHENTICATOR_CFG, NULL, pin_protocol, message,
+                                  sizeof(message), pin_auth, pin_auth_len)) {
+        case PERM_OK:
+            return CTAP2_OK;
+        case PERM_ERROR_DENIED:
+            return CTAP2_ERR_UNAUTHORIZED_PERMISSION;
+        default:
+            return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+}
+
+/**
+ * @brief Decode subCommandParams
+ *
+ * Keys are numbered per subcommand; a written chunk is copied into
+ * firmware_chunk.
+ */
+static uint8_t decode_params(uint8_t subcommand, const uint8_t *data, size_t len,
+                             firmware_params_t *params)
+{
+    cbor_decoder_t decoder;
+    size_t map_size;
+
+    memset(params, 0, sizeof(*params));
+    if (len == 0) {
+        return CTAP2_OK;
+    }
+
+    cbor_decoder_init(&decoder, data, len);
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        size_t field_len;
+        int ret;
+
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        if (subcommand == FIRMWARE_BEGIN && key == FIRMWARE_SUB_TYPE) {
+            ret = cbor_decode_uint(&decoder, &params->type);
+            params->has_type = true;
+        } else if (subcommand == FIRMWARE_BEGIN && key == FIRMWARE_SUB_IMAGE_SIZE) {
+            ret = cbor_decode_uint(&decoder, &params->image_size);
+            params->has_image_size = true;
+        } else if (subcommand == FIRMWARE_BEGIN && key == FIRMWARE_SUB_PAYLOAD_SIZE) {
+            ret = cbor_decode_uint(&decoder, &params->payload_size);
+            params->has_payload_size = true;
+        } else if (subcommand == FIRMWARE_BEGIN && key == FIRMWARE_SUB_VERSION) {
+            ret = cbor_decode_uint(&decoder, &params->version);
+            params->has_version = true;
+        } else if (subcommand == FIRMWARE_WRITE && key == FIRMWARE_SUB_OFFSET) {
+            ret = cbor_decode_uint(&decoder, &params->offset);
+            params->has_offset = true;
+        } else if (subcommand == FIRMWARE_WRITE && key == FIRMWARE_SUB_CHUNK) {
+            params->chunk_len = sizeof(firmware_chunk);
+            ret = cbor_decode_bytes(&decoder, firmware_chunk, &params->chunk_len);
+            params->has_chunk = true;
+        } else if (subcommand == FIRMWARE_FINISH && key == FIRMWARE_SUB_SIGNATURE) {
+            field_len = sizeof(params->signature);
+            ret = cbor_decode_bytes(&decoder, params->signature, &field_len);
+            params->has_signature = (field_len == sizeof(params->signature));
+        } else {
+            ret = cbor_decoder_skip(&decoder);
+        }
+
+        if (ret == CBOR_ERROR_OVERFLOW) {
+            return CTAP2_ERR_INVALID_LENGTH;
+        }
+        if (ret != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Map a firmware update error onto a CTAP2 status code
+ */
+static uint8_t firmware_status(int ret)
+{
+    switch (ret) {
+        case FIRMWARE_UPDATE_OK:
+            return CTAP2_OK;
+        case FIRMWARE_UPDATE_ERROR_INVALID_PARAM:
+        case FIRMWARE_UPDATE_ERROR_PATCH:
+            return CTAP2_ERR_INVALID_PARAMETER;
+        case FIRMWARE_UPDATE_ERROR_NOT_SUPPORTED:
+            return CTAP2_ERR_UNSUPPORTED_OPTION;
+        case FIRMWARE_UPDATE_ERROR_STATE:
+        case FIRMWARE_UPDATE_ERROR_SEQUENCE:
+            return CTAP2_ERR_INVALID_SEQ;
+        case FIRMWARE_UPDATE_ERROR_SIZE:
+            return CTAP2_ERR_INVALID_LENGTH;
+        case FIRMWARE_UPDATE_ERROR_SIGNATURE:
+            return CTAP2_ERR_INTEGRITY_FAILURE;
+        case FIRMWARE_UPDATE_ERROR_VERSION:
+            return CTAP2_ERR_NOT_ALLOWED;
+        default:
+            return CTAP2_ERR_PROCESSING;
+    }
+}
+
+/**
+ * @brief Run one subcommand against the update in progress
+ */
+static int firmware_run(uint8_t subcommand, const firmware_params_t *params)
+{
+    switch (subcommand) {
+        case FIRMWARE_BEGIN: {
+            if (firmware_update_signing_key() == NULL) {
+                LOG_WARN("Firmware update refused: no signing key configured");
+                return FIRMWARE_UPDATE_ERROR_NOT_SUPPORTED;
+            }
+
+            if (!params->has_type || !params->has_image_size || !params->has_payload_size ||
+                !params->has_version || params->type > UINT8_MAX ||
+                params->image_size > UINT32_MAX || params->payload_size > UINT32_MAX ||
+                params->version > UINT32_MAX) {
+                return FIRMWARE_UPDATE_ERROR_INVALID_PARAM;
+            }
+
+            firmware_update_header_t header = {
+                .type = (firmware_update_type_t) params->type,
+                .image_size = (uint32_t) params->image_size,
+                .payload_size = (uint32_t) params->payload_size,
+                .version = (uint32_t) params->version,
+            };
+            return firmware_update_begin(&header);
+        }
+
+        case FIRMWARE_WRITE:
+            if (!params->has_offset || !params->has_chunk || params->offset > UINT32_MAX) {
+                return FIRMWARE_UPDATE_ERROR_INVALID_PARAM;
+            }
+            return firmware_update_write((uint32_t) params->offset, firmware_chunk,
+                                         params->chunk_len);
+
+        case FIRMWARE_FINISH:
+            if (!params->has_signature) {
+                return FIRMWARE_UPDATE_ERROR_INVALID_PARAM;
+            }
+            if (firmware_update_signing_key() == NULL) {
+                return FIRMWARE_UPDATE_ERROR_STATE;
+            }
+            return firmware_update_finish(firmware_update_signing_key(), params->signature);
+
+        case FIRMWARE_ABORT:
+            firmware_update_abort();
+            return FIRMWARE_UPDATE_OK;
+
+        case FIRMWARE_STATUS:
+            return FIRMWARE_UPDATE_OK;
+
+        default:
+            return FIRMWARE_UPDATE_ERROR_INVALID_PARAM;
+    }
+}
+
+uint8_t ctap2_vendor_firmware(const uint8_t *request_data, size_t request_len,
+                              uint8_t *response_data, size_t *response_len)
+{
+    LOG_DEBUG("Vendor firmware command");
+
+    cbor_decoder_t decoder;
+    cbor_decoder_init(&decoder, request_data, request_len);
+
+    size_t map_size;
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    uint64_t subcommand = 0;
+    uint64_t pin_protocol = 0;
+    uint8_t pin_auth[32];
+    size_t pin_auth_len = 0;
+    size_t params_start = 0;
+    size_t params_end = 0;
+    bool has_subcommand = false;
+    bool has_pin_auth = false;
+
+    /* Parse parameters */
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case FIRMWARE_PARAM_SUBCOMMAND:
+                if (cbor_decode_uint(&decoder, &subcommand) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                has_subcommand = true;
+                break;
+
+            case FIRMWARE_PARAM_SUBCOMMAND_PARAMS:
+                params_start = decoder.offset;
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                params_end = decoder.offset;
+                break;
+
+            case FIRMWARE_PARAM_PIN_PROTOCOL:
+                if (cbor_decode_uint(&decoder, &pin_protocol) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+
+            case FIRMWARE_PARAM_PIN_AUTH:
+                pin_auth_len = sizeof(pin_auth);
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                has_pin_auth = true;
+                break;
+
+            default:
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+        }
+    }
+
+    if (!has_subcommand) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    if (subcommand < FIRMWARE_BEGIN || subcommand > FIRMWARE_STATUS) {
+        return CTAP2_ERR_INVALID_SUBCOMMAND;
+    }
+
+    /* An unsupported protocol is refused by the authentication check */
+    uint8_t protocol = pin_protocol_is_supported(pin_protocol) ? (uint8_t) pin_protocol : 0;
+
+    uint8_t status = verify_firmware_pin_auth(
+        (uint8_t) subcommand, &request_data[params_start], params_end - params_start,
+        has_pin_auth ? pin_auth : NULL, has_pin_auth ? pin_auth_len : 0, protocol);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    firmware_params_t params;
+    status = decode_params((uint8_t) subcommand, &request_data[params_start],
+                           params_end - params_start, &params);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    status = firmware_status(firmware_run((uint8_t) subcommand, &params));
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
+
+    uint32_t running_version = 0;
+    bool has_version = subcommand == FIRMWARE_STATUS &&
+                       firmware_update_running_version(&running_version);
+
+    cbor_encode_map_start(&encoder, has_version ? 2 : 1);
+    cbor_encode_uint(&encoder, FIRMWARE_RESP_RECEIVED);
+    cbor_encode_uint(&encoder, firmware_update_received());
+    if (has_version) {
+        cbor_encode_uint(&encoder, FIRMWARE_RESP_VERSION);
+        cbor_encode_uint(&encoder, running_version);
+    }
+    *response_len = cbor_encoder_get_size(&encoder);
+    return CTAP2_OK;
+}
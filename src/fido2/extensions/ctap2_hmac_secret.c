@@ -0,0 +1,202 @@
+/**
+ * @file ctap2_hmac_secret.c
+ * @brief CTAP2 hmac-secret Extension Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "ctap2_hmac_secret.h"
+
+#include <string.h>
+
+#include "crypto.h"
+#include "ctap2.h"
+#include "logger.h"
+#include "module_state.h"
+#include "pin_protocol.h"
+#include "storage.h"
+
+/* hmac-secret Input Keys */
+#define HS_KEY_AGREEMENT 0x01
+#define HS_SALT_ENC 0x02
+#define HS_SALT_AUTH 0x03
+#define HS_PIN_PROTOCOL 0x04
+
+/* Device key label for CredRandom derivation */
+#define HS_DEVICE_KEY_LABEL "hmac-secret"
+
+/* Device key schedule, loaded on first use */
+static OPENFIDO_STATE struct {
+    bool ready;
+    crypto_hmac_ctx_t key;
+} hmac_secret_state = {0};
+OPENFIDO_STATE_REGISTER(hmac_secret_state);
+
+/**
+ * @brief Load the device hmac-secret key schedule if not done yet
+ */
+static bool load_device_key(void)
+{
+    uint8_t key[32];
+
+    if (hmac_secret_state.ready) {
+        return true;
+    }
+
+    if (storage_derive_device_key(HS_DEVICE_KEY_LABEL, key) != STORAGE_OK) {
+        return false;
+    }
+
+    if (crypto_hmac_ctx_init(&hmac_secret_state.key, key, sizeof(key)) == CRYPTO_OK) {
+        hmac_secret_state.ready = true;
+    }
+    crypto_secure_zero(key, sizeof(key));
+
+    return hmac_secret_state.ready;
+}
+
+uint8_t hmac_secret_decode_input(cbor_decoder_t *decoder, hmac_secret_input_t *input)
+{
+    size_t map_size;
+    bool has_key_agreement = false;
+
+    memset(input, 0, sizeof(*input));
+    input->pin_protocol = PIN_PROTOCOL_V1;
+
+    if (cbor_decode_map_start(decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        if (cbor_decode_uint(decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case HS_KEY_AGREEMENT:
+                if (pin_protocol_decode_key(decoder, input->key_agreement) != PIN_PROTOCOL_OK) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                has_key_agreement = true;
+                break;
+
+            case HS_SALT_ENC:
+                input->salt_enc_len = sizeof(input->salt_enc);
+                if (cbor_decode_bytes(decoder, input->salt_enc, &input->salt_enc_len) !=
+                    CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+
+            case HS_SALT_AUTH:
+                input->salt_auth_len = sizeof(input->salt_auth);
+                if (cbor_decode_bytes(decoder, input->salt_auth, &input->salt_auth_len) !=
+                    CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+
+            case HS_PIN_PROTOCOL: {
+                uint64_t protocol;
+                if (cbor_decode_uint(decoder, &protocol) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                if (!pin_protocol_is_supported(protocol)) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                input->pin_protocol = (uint8_t) protocol;
+                break;
+            }
+
+            default:
+                cbor_decoder_skip(decoder);
+                break;
+        }
+    }
+
+    if (!has_key_agreement || input->salt_enc_len == 0 || input->salt_auth_len == 0) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    return CTAP2_OK;
+}
+
+uint8_t hmac_secret_compute(const hmac_secret_input_t *input, const uint8_t *credential_id,
+                            bool uv, uint8_t *output, size_t *output_len)
+{
+    const pin_protocol_secret_t *secret = NULL;
+    uint8_t salts[2 * HMAC_SECRET_SALT_SIZE];
+    size_t salts_len = 0;
+    uint8_t status;
+
+    if (input == NULL || credential_id == NULL || output == NULL || output_len == NULL) {
+        return CTAP2_ERR_INVALID_PARAMETER;
+    }
+
+    /* Same platform key as the ClientPIN exchange: no new ECDH */
+    status = ctap2_get_shared_secret(input->pin_protocol, input->key_agreement, &secret);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    if (pin_protocol_verify(secret, input->salt_enc, input->salt_enc_len, input->salt_auth,
+                            input->salt_auth_len) != PIN_PROTOCOL_OK) {
+        LOG_WARN("hmac-secret saltAuth verification failed");
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    if (pin_protocol_decrypt(secret, input->salt_enc, input->salt_enc_len, salts, &salts_len) !=
+            PIN_PROTOCOL_OK ||
+        (salts_len != HMAC_SECRET_SALT_SIZE && salts_len != 2 * HMAC_SECRET_SALT_SIZE)) {
+        crypto_secure_zero(salts, sizeof(salts));
+        return CTAP2_ERR_INVALID_LENGTH;
+    }
+
+    if (!load_device_key()) {
+        crypto_secure_zero(salts, sizeof(salts));
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    /* CredRandom = HMAC(device key, uv || credential ID) */
+    uint8_t cred_input[1 + STORAGE_CREDENTIAL_ID_LENGTH];
+    uint8_t cred_random[32];
+    cred_input[0] = uv ? 1 : 0;
+    memcpy(&cred_input[1], credential_id, STORAGE_CREDENTIAL_ID_LENGTH);
+
+    status = CTAP2_ERR_PROCESSING;
+    crypto_hmac_ctx_t cred_key;
+    memset(&cred_key, 0, sizeof(cred_key));
+
+    if (crypto_hmac_ctx_compute(&hmac_secret_state.key, cred_input, sizeof(cred_input),
+                                cred_random) == CRYPTO_OK &&
+        crypto_hmac_ctx_init(&cred_key, cred_random, sizeof(cred_random)) == CRYPTO_OK) {
+        /* Outputs overwrite their salts in place */
+        status = CTAP2_OK;
+        for (size_t off = 0; off < salts_len && status == CTAP2_OK;
+             off += HMAC_SECRET_SALT_SIZE) {
+            if (crypto_hmac_ctx_compute(&cred_key, &salts[off], HMAC_SECRET_SALT_SIZE,
+                                        &salts[off]) != CRYPTO_OK) {
+                status = CTAP2_ERR_PROCESSING;
+            }
+        }
+    }
+
+    if (status == CTAP2_OK &&
+        pin_protocol_encrypt(secret, salts, salts_len, output, output_len) != PIN_PROTOCOL_OK) {
+        status = CTAP2_ERR_PROCESSING;
+    }
+
+    crypto_hmac_ctx_free(&cred_key);
+    crypto_secure_zero(cred_random, sizeof(cred_random));
+    crypto_secure_zero(salts, sizeof(salts));
+
+    return status;
+}
+
+void hmac_secret_clear(void)
+{
+    crypto_hmac_ctx_free(&hmac_secret_state.key);
+    crypto_secure_zero(&hmac_secret_state, sizeof(hmac_secret_state));
+}
@@ -0,0 +1,75 @@
+/**
+ * @file ctap2_hmac_secret.h
+ * @brief CTAP2 hmac-secret Extension
+ *
+ * CredRandom is not stored with the credential: it is derived on demand as
+ * HMAC(device hmac-secret key, uv || credential ID), so every credential
+ * gets a stable, independent secret without growing the credential record.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef CTAP2_HMAC_SECRET_H
+#define CTAP2_HMAC_SECRET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One or two 32-byte salts, plus the protocol 2 IV */
+#define HMAC_SECRET_SALT_SIZE 32
+#define HMAC_SECRET_MAX_ENC_SIZE (2 * HMAC_SECRET_SALT_SIZE + 16)
+
+/**
+ * @brief hmac-secret GetAssertion input
+ */
+typedef struct {
+    uint8_t key_agreement[64];                  /**< Platform public key (X || Y) */
+    uint8_t salt_enc[HMAC_SECRET_MAX_ENC_SIZE]; /**< Encrypted salt1 (|| salt2) */
+    size_t salt_enc_len;                        /**< Length of salt_enc */
+    uint8_t salt_auth[32];                      /**< Authentication of salt_enc */
+    size_t salt_auth_len;                       /**< Length of salt_auth */
+    uint8_t pin_protocol;                       /**< PIN protocol (defaults to 1) */
+} hmac_secret_input_t;
+
+/**
+ * @brief Decode the hmac-secret GetAssertion input map
+ *
+ * @param decoder CBOR decoder positioned at the input map
+ * @param input Output input structure
+ * @return CTAP2 status code
+ */
+uint8_t hmac_secret_decode_input(cbor_decoder_t *decoder, hmac_secret_input_t *input);
+
+/**
+ * @brief Compute the encrypted hmac-secret output for a credential
+ *
+ * Both salts are MACed with one CredRandom key schedule.
+ *
+ * @param input Decoded input
+ * @param credential_id Credential ID (STORAGE_CREDENTIAL_ID_LENGTH bytes)
+ * @param uv Whether user verification was performed
+ * @param output Output buffer (HMAC_SECRET_MAX_ENC_SIZE bytes)
+ * @param output_len Output length
+ * @return CTAP2 status code
+ */
+uint8_t hmac_secret_compute(const hmac_secret_input_t *input, const uint8_t *credential_id,
+                            bool uv, uint8_t *output, size_t *output_len);
+
+/**
+ * @brief Drop the cached device key (after reset)
+ */
+void hmac_secret_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTAP2_HMAC_SECRET_H */
@@ -8,10 +8,14 @@
 
 #include <string.h>
 
+#include "buffer.h"
 #include "cbor.h"
 #include "crypto.h"
 #include "ctap2.h"
 #include "logger.h"
+#include "module_state.h"
+#include "permissions.h"
+#include "pin_protocol.h"
 #include "storage.h"
 
 /* Large Blobs Subcommands */
@@ -29,57 +33,123 @@
 /* Response Parameters */
 #define LB_RESP_CONFIG 0x01
 
-/* Maximum large blob size */
-#define MAX_LARGE_BLOB_SIZE 2048
+/* Largest get/set fragment: maxFragmentLength = maxMsgSize - 64 */
+#define LB_MAX_FRAGMENT_SIZE (CTAP2_MAX_MESSAGE_SIZE - 64)
 
-/* Large blob storage */
-static struct {
-    uint8_t data[MAX_LARGE_BLOB_SIZE];
-    size_t size;
-    bool initialized;
-} large_blob_storage = {0};
+/* Truncated SHA-256 trailing the serialized array */
+#define LB_HASH_SIZE 16
+
+/* authenticatorLargeBlobs command byte, part of the pinUvAuthParam message */
+#define LB_CTAP_CMD 0x0C
+
+/* Initial array: empty CBOR array || LEFT(SHA-256(h'80'), 16) */
+static const uint8_t LB_EMPTY_ARRAY[1 + LB_HASH_SIZE] = {0x80, 0x76, 0xBE, 0x8B, 0x52, 0x8D,
+                                                         0x00, 0x75, 0xF7, 0xAA, 0xE9, 0x8D,
+                                                         0x6F, 0xA5, 0x7A, 0x6D, 0x3C};
+
+/*
+ * Set sequence in progress. Fragments go straight to the spare flash slot;
+ * only the running hash and the trailing 16 bytes are kept in RAM.
+ */
+static OPENFIDO_STATE struct {
+    bool active;
+    size_t expected_length;
+    size_t next_offset;
+    crypto_sha256_ctx_t hash;      /* Over bytes [0, expected_length - 16) */
+    uint8_t trailer[LB_HASH_SIZE]; /* Received truncated hash */
+} lb_write = {0};
+OPENFIDO_STATE_REGISTER(lb_write);
 
 /**
- * @brief Initialize large blob storage
+ * @brief Abandon the set sequence in progress
  */
-static void init_large_blob_storage(void)
+static void lb_write_reset(void)
 {
-    if (!large_blob_storage.initialized) {
-        /* Initialize with empty array: 0x80 (CBOR array of 0 items) + 16-byte hash */
-        large_blob_storage.data[0] = 0x80; /* Empty CBOR array */
+    crypto_sha256_free(&lb_write.hash);
+    memset(&lb_write, 0, sizeof(lb_write));
+}
 
-        /* Compute SHA-256 of empty array */
-        uint8_t hash[32];
-        crypto_sha256(large_blob_storage.data, 1, hash);
-        memcpy(&large_blob_storage.data[1], hash, 16); /* First 16 bytes of hash */
+/**
+ * @brief Verify PIN authentication for a set fragment
+ *
+ * pinUvAuthParam = authenticate(pinUvAuthToken, 32 x 0xFF || 0x0C 0x00 ||
+ *                               uint32LE(offset) || SHA-256(fragment))
+ */
+static uint8_t verify_lb_pin_auth(size_t offset, const uint8_t *fragment, size_t fragment_len,
+                                  const uint8_t *pin_auth, size_t pin_auth_len,
+                                  uint8_t pin_protocol)
+{
+    uint8_t message[32 + 2 + 4 + 32];
 
-        large_blob_storage.size = 17; /* 1 byte array + 16 bytes hash */
-        large_blob_storage.initialized = true;
+    /* Without a PIN the array is writable by anyone (CTAP 2.1, 6.10.2) */
+    if (!storage_is_pin_set()) {
+        return CTAP2_OK;
+    }
+
+    if (pin_auth == NULL || pin_auth_len == 0) {
+        return CTAP2_ERR_PIN_REQUIRED;
+    }
+
+    if (!pin_protocol_is_supported(pin_protocol)) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    memset(message, 0xFF, 32);
+    message[32] = LB_CTAP_CMD;
+    message[33] = 0x00;
+    message[34] = offset & 0xFF;
+    message[35] = (offset >> 8) & 0xFF;
+    message[36] = (offset >> 16) & 0xFF;
+    message[37] = (offset >> 24) & 0xFF;
+    if (crypto_sha256(fragment, fragment_len, &message[38]) != CRYPTO_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
 
-        LOG_INFO("Large blob storage initialized");
+    switch (permissions_authorize(PERM_LARGE_BLOB_WRITE, NULL, pin_protocol, message,
+                                  sizeof(message), pin_auth, pin_auth_len)) {
+        case PERM_OK:
+            return CTAP2_OK;
+        case PERM_ERROR_DENIED:
+            return CTAP2_ERR_UNAUTHORIZED_PERMISSION;
+        default:
+            return CTAP2_ERR_PIN_AUTH_INVALID;
     }
 }
 
 /**
  * @brief Get large blob data
+ *
+ * @param buffer Scratch space for the fragment (LB_MAX_FRAGMENT_SIZE bytes)
  */
-static uint8_t lb_get(size_t offset, size_t length, uint8_t *response_data, size_t *response_len)
+static uint8_t lb_get(size_t offset, size_t length, uint8_t *buffer, uint8_t *response_data,
+                      size_t *response_len)
 {
-    init_large_blob_storage();
+    size_t stored = storage_large_blob_size();
+    size_t total = (stored > 0) ? stored : sizeof(LB_EMPTY_ARRAY);
+
+    if (length > LB_MAX_FRAGMENT_SIZE) {
+        return CTAP2_ERR_INVALID_LENGTH;
+    }
 
-    if (offset > large_blob_storage.size) {
+    if (offset > total) {
         return CTAP2_ERR_INVALID_PARAMETER;
     }
 
-    size_t available = large_blob_storage.size - offset;
-    size_t to_read = (length == 0 || length > available) ? available : length;
+    size_t available = total - offset;
+    size_t to_read = (length > available) ? available : length;
+
+    if (stored == 0) {
+        memcpy(buffer, &LB_EMPTY_ARRAY[offset], to_read);
+    } else if (to_read > 0 && storage_large_blob_read(offset, buffer, to_read) != STORAGE_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
 
     cbor_encoder_t encoder;
     cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
 
     cbor_encode_map_start(&encoder, 1);
     cbor_encode_uint(&encoder, LB_RESP_CONFIG);
-    cbor_encode_bytes(&encoder, &large_blob_storage.data[offset], to_read);
+    cbor_encode_bytes(&encoder, buffer, to_read);
 
     *response_len = cbor_encoder_get_size(&encoder);
 
@@ -88,30 +158,117 @@ static uint8_t lb_get(size_t offset, size_t length, uint8_t *response_data, size
     return CTAP2_OK;
 }
 
+/**
+ * @brief Feed a fragment into the running hash and trailer
+ */
+static bool lb_hash_fragment(size_t offset, const uint8_t *data, size_t data_len)
+{
+    size_t hashed_len = lb_write.expected_length - LB_HASH_SIZE;
+
+    for (size_t end = offset + data_len; offset < end;) {
+        if (offset < hashed_len) {
+            size_t n = ((end < hashed_len) ? end : hashed_len) - offset;
+            if (crypto_sha256_update(&lb_write.hash, data, n) != CRYPTO_OK) {
+                return false;
+            }
+            offset += n;
+            data += n;
+        } else {
+            size_t n = end - offset;
+            memcpy(&lb_write.trailer[offset - hashed_len], data, n);
+            offset += n;
+            data += n;
+        }
+    }
+
+    return true;
+}
+
 /**
  * @brief Set large blob data
+ *
+ * Each fragment is written to the spare flash slot as it arrives. The slot
+ * becomes current once the last fragment is in and the trailing hash matches.
  */
-static uint8_t lb_set(size_t offset, const uint8_t *data, size_t data_len, uint8_t *response_data,
-                      size_t *response_len)
+static uint8_t lb_set(size_t offset, size_t length, bool has_length, const uint8_t *data,
+                      size_t data_len, const uint8_t *pin_auth, size_t pin_auth_len,
+                      uint8_t pin_protocol, size_t *response_len)
 {
-    init_large_blob_storage();
+    if (data_len > LB_MAX_FRAGMENT_SIZE) {
+        return CTAP2_ERR_INVALID_LENGTH;
+    }
 
-    if (offset + data_len > MAX_LARGE_BLOB_SIZE) {
-        return CTAP2_ERR_REQUEST_TOO_LARGE;
+    if (offset == 0) {
+        if (!has_length) {
+            return CTAP2_ERR_INVALID_PARAMETER;
+        }
+        if (length > STORAGE_LARGE_BLOB_MAX_SIZE) {
+            return CTAP2_ERR_LARGE_BLOB_STORAGE_FULL;
+        }
+        if (length < sizeof(LB_EMPTY_ARRAY)) {
+            return CTAP2_ERR_INVALID_PARAMETER;
+        }
+    } else {
+        if (has_length) {
+            return CTAP2_ERR_INVALID_PARAMETER;
+        }
+        if (!lb_write.active || offset != lb_write.next_offset) {
+            return CTAP2_ERR_INVALID_SEQ;
+        }
+    }
+
+    uint8_t status =
+        verify_lb_pin_auth(offset, data, data_len, pin_auth, pin_auth_len, pin_protocol);
+    if (status != CTAP2_OK) {
+        return status;
     }
 
-    /* Copy data to storage */
-    memcpy(&large_blob_storage.data[offset], data, data_len);
+    if (offset == 0) {
+        /* A new sequence replaces any unfinished one */
+        lb_write_reset();
+        if (storage_large_blob_begin(length) != STORAGE_OK ||
+            crypto_sha256_start(&lb_write.hash) != CRYPTO_OK) {
+            lb_write_reset();
+            return CTAP2_ERR_PROCESSING;
+        }
+        lb_write.active = true;
+        lb_write.expected_length = length;
+    }
+
+    if (offset + data_len > lb_write.expected_length) {
+        return CTAP2_ERR_INVALID_PARAMETER;
+    }
 
-    /* Update size if we extended the blob */
-    if (offset + data_len > large_blob_storage.size) {
-        large_blob_storage.size = offset + data_len;
+    if (storage_large_blob_write(offset, data, data_len) != STORAGE_OK ||
+        !lb_hash_fragment(offset, data, data_len)) {
+        lb_write_reset();
+        return CTAP2_ERR_PROCESSING;
     }
+    lb_write.next_offset = offset + data_len;
 
     *response_len = 0;
 
-    LOG_INFO("Large blob SET: offset=%zu, length=%zu, total_size=%zu", offset, data_len,
-             large_blob_storage.size);
+    LOG_INFO("Large blob SET: offset=%zu, length=%zu, expected=%zu", offset, data_len,
+             lb_write.expected_length);
+
+    if (lb_write.next_offset < lb_write.expected_length) {
+        return CTAP2_OK;
+    }
+
+    /* Last fragment: check LEFT(SHA-256(array), 16), then commit */
+    uint8_t hash[32];
+    bool hash_ok = crypto_sha256_finish(&lb_write.hash, hash) == CRYPTO_OK &&
+                   constant_time_compare(hash, lb_write.trailer, LB_HASH_SIZE) == 0;
+    lb_write_reset();
+
+    if (!hash_ok) {
+        LOG_WARN("Large blob integrity check failed");
+        return CTAP2_ERR_INTEGRITY_FAILURE;
+    }
+
+    if (storage_large_blob_commit() != STORAGE_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
 
     return CTAP2_OK;
 }
@@ -128,17 +285,23 @@ uint8_t ctap2_large_blobs(const uint8_t *request_data, size_t request_len, uint8
     cbor_decoder_init(&decoder, request_data, request_len);
 
     /* Parse request map */
-    uint64_t map_size;
+    size_t map_size;
     if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
         return CTAP2_ERR_INVALID_CBOR;
     }
 
+    uint64_t value;
     size_t offset = 0;
     size_t length = 0;
-    uint8_t set_data[MAX_LARGE_BLOB_SIZE];
-    size_t set_data_len = 0;
+    uint8_t fragment[LB_MAX_FRAGMENT_SIZE];
+    size_t fragment_len = 0;
+    uint8_t pin_protocol = 0;
+    uint8_t pin_auth[32];
+    size_t pin_auth_len = 0;
     bool is_get = false;
     bool is_set = false;
+    bool has_length = false;
+    bool has_pin_auth = false;
 
     /* Parse parameters */
     for (uint64_t i = 0; i < map_size; i++) {
@@ -149,50 +312,75 @@ uint8_t ctap2_large_blobs(const uint8_t *request_data, size_t request_len, uint8
 
         switch (key) {
             case LB_PARAM_GET:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &length) != CBOR_OK) {
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                length = (size_t) value;
                 is_get = true;
                 break;
 
-            case LB_PARAM_SET:
-                set_data_len = sizeof(set_data);
-                if (cbor_decode_bytes(&decoder, set_data, set_data_len) != CBOR_OK) {
+            case LB_PARAM_SET: {
+                fragment_len = sizeof(fragment);
+                int ret = cbor_decode_bytes(&decoder, fragment, &fragment_len);
+                if (ret == CBOR_ERROR_OVERFLOW) {
+                    return CTAP2_ERR_INVALID_LENGTH;
+                }
+                if (ret != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
                 is_set = true;
                 break;
+            }
 
             case LB_PARAM_OFFSET:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &offset) != CBOR_OK) {
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                offset = (size_t) value;
                 break;
 
             case LB_PARAM_LENGTH:
-                if (cbor_decode_uint(&decoder, (uint64_t *) &length) != CBOR_OK) {
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
                     return CTAP2_ERR_INVALID_CBOR;
                 }
+                length = (size_t) value;
+                has_length = true;
                 break;
 
             case LB_PARAM_PIN_UV_AUTH_PARAM:
+                pin_auth_len = sizeof(pin_auth);
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                has_pin_auth = true;
+                break;
+
             case LB_PARAM_PIN_UV_AUTH_PROTOCOL:
-                /* Skip PIN auth for now */
-                cbor_skip_value(&decoder);
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                pin_protocol = (uint8_t) value;
                 break;
 
             default:
-                cbor_skip_value(&decoder);
+                cbor_decoder_skip(&decoder);
                 break;
         }
     }
 
-    /* Execute subcommand */
+    /* Exactly one of get and set */
+    if (is_get == is_set) {
+        return (is_get) ? CTAP2_ERR_INVALID_PARAMETER : CTAP2_ERR_MISSING_PARAMETER;
+    }
+
     if (is_get) {
-        return lb_get(offset, length, response_data, response_len);
-    } else if (is_set) {
-        return lb_set(offset, set_data, set_data_len, response_data, response_len);
-    } else {
-        return CTAP2_ERR_MISSING_PARAMETER;
+        if (has_length) {
+            return CTAP2_ERR_INVALID_PARAMETER;
+        }
+        return lb_get(offset, length, fragment, response_data, response_len);
     }
+
+    return lb_set(offset, length, has_length, fragment, fragment_len,
+                  has_pin_auth ? pin_auth : NULL, has_pin_auth ? pin_auth_len : 0, pin_protocol,
+                  response_len);
 }
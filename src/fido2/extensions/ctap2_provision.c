@@ -0,0 +1,481 @@
+/**
+ * @file ctap2_provision.c
+ * @brief Vendor Bulk Credential Provisioning Command Implementation
+ *
+ * Fleet enrolment creates many discoverable credentials for one RP. Instead
+ * of one MakeCredential (keygen, flash write and touch) per credential, a
+ * single token-authenticated request carries a batch of user entries whose
+ * keys are either generated on the device or imported encrypted to the
+ * ClientPIN shared secret. The batch is written to storage as one run.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <string.h>
+
+#include "cbor.h"
+#include "crypto.h"
+#include "ctap2.h"
+#include "hal.h"
+#include "logger.h"
+#include "module_state.h"
+#include "permissions.h"
+#include "pin_protocol.h"
+#include "storage.h"
+
+/* Provisioning Subcommands */
+#define PROVISION_GENERATE 0x01
+#define PROVISION_IMPORT 0x02
+
+/* Request Parameters */
+#define PROVISION_PARAM_SUBCOMMAND 0x01
+#define PROVISION_PARAM_SUBCOMMAND_PARAMS 0x02
+#define PROVISION_PARAM_PIN_PROTOCOL 0x03
+#define PROVISION_PARAM_PIN_AUTH 0x04
+
+/* subCommandParams Keys */
+#define PROVISION_SUB_RP_ID 0x01
+#define PROVISION_SUB_ENTRIES 0x02
+#define PROVISION_SUB_KEY_AGREEMENT 0x03
+
+/* Entry Keys */
+#define PROVISION_ENTRY_USER_ID 0x01
+#define PROVISION_ENTRY_USER_NAME 0x02
+#define PROVISION_ENTRY_DISPLAY_NAME 0x03
+#define PROVISION_ENTRY_ENCRYPTED_KEY 0x04
+
+/* Response Keys */
+#define PROVISION_RESP_CREDENTIALS 0x01
+#define PROVISION_RESP_ELAPSED_MS 0x02
+
+/* Entries per request; each costs about 100 response bytes */
+#define PROVISION_MAX_BATCH 8
+
+/* Encrypted private key: 32 bytes, plus the IV under protocol 2 */
+#define PROVISION_MAX_ENC_KEY_SIZE 48
+
+/* Batch under construction, kept off the stack */
+static OPENFIDO_STATE struct {
+    storage_credential_t credentials[PROVISION_MAX_BATCH];
+    uint8_t public_keys[PROVISION_MAX_BATCH][64];
+} provision_batch;
+OPENFIDO_STATE_REGISTER(provision_batch);
+
+/**
+ * @brief Verify PIN authentication for a provisioning request
+ *
+ * pinUvAuthParam = authenticate(pinUvAuthToken, 32 x 0xFF || 0x41 ||
+ *                               subCommand || SHA-256(subCommandParams))
+ */
+static uint8_t verify_provision_pin_auth(uint8_t subcommand, const uint8_t *params,
+                                         size_t params_len, const uint8_t *pin_auth,
+                                         size_t pin_auth_len, uint8_t pin_protocol)
+{
+    uint8_t message[32 + 2 + 32];
+
+    /* PIN and cm permission required */
+    if (!storage_is_pin_set()) {
+        return CTAP2_ERR_PIN_NOT_SET;
+    }
+
+    if (pin_auth == NULL || pin_auth_len == 0) {
+        return CTAP2_ERR_PIN_REQUIRED;
+    }
+
+    if (!pin_protocol_is_supported(pin_protocol)) {
+        return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+
+    memset(message, 0xFF, 32);
+    message[32] = CTAP2_CMD_VENDOR_PROVISION;
+    message[33] = subcommand;
+    if (crypto_sha256(params, params_len, &message[34]) != CRYPTO_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    switch (permissions_authorize(PERM_CREDENTIAL_MGMT, NULL, pin_protocol, message,
+                                  sizeof(message), pin_auth, pin_auth_len)) {
+        case PERM_OK:
+            return CTAP2_OK;
+        case PERM_ERROR_DENIED:
+            return CTAP2_ERR_UNAUTHORIZED_PERMISSION;
+        default:
+            return CTAP2_ERR_PIN_AUTH_INVALID;
+    }
+}
+
+/**
+ * @brief Decode one user entry into a credential
+ *
+ * @param enc_key Output encrypted private key (import only)
+ * @param enc_key_len Output length of enc_key, 0 if absent
+ */
+static uint8_t decode_entry(cbor_decoder_t *decoder, storage_credential_t *credential,
+                            uint8_t *enc_key, size_t *enc_key_len)
+{
+    size_t map_size;
+    bool has_user_id = false;
+
+    *enc_key_len = 0;
+
+    if (cbor_decode_map_start(decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        size_t len;
+        int ret;
+
+        if (cbor_decode_uint(decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case PROVISION_ENTRY_USER_ID:
+                len = sizeof(credential->user_id);
+                ret = cbor_decode_bytes(decoder, credential->user_id, &len);
+                credential->user_id_len = len;
+                has_user_id = true;
+                break;
+
+            case PROVISION_ENTRY_USER_NAME:
+                len = sizeof(credential->user_name);
+                ret = cbor_decode_text_truncated(decoder, credential->user_name, &len);
+                break;
+
+            case PROVISION_ENTRY_DISPLAY_NAME:
+                len = sizeof(credential->display_name);
+                ret = cbor_decode_text_truncated(decoder, credential->display_name, &len);
+                break;
+
+            case PROVISION_ENTRY_ENCRYPTED_KEY:
+                len = PROVISION_MAX_ENC_KEY_SIZE;
+                ret = cbor_decode_bytes(decoder, enc_key, &len);
+                *enc_key_len = len;
+                break;
+
+            default:
+                ret = cbor_decoder_skip(decoder);
+                break;
+        }
+
+        if (ret == CBOR_ERROR_OVERFLOW) {
+            return CTAP2_ERR_INVALID_LENGTH;
+        }
+        if (ret != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+    }
+
+    if (!has_user_id) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Build the batch from subCommandParams
+ *
+ * @param count Output number of credentials
+ */
+static uint8_t build_batch(uint8_t subcommand, const uint8_t *params, size_t params_len,
+                           uint8_t pin_protocol, size_t *count)
+{
+    cbor_decoder_t decoder;
+    size_t map_size;
+    char rp_id[STORAGE_MAX_RP_ID_LENGTH] = {0};
+    size_t entries_start = 0;
+    size_t entry_count = 0;
+    uint8_t platform_key[64];
+    bool has_rp_id = false;
+    bool has_entries = false;
+    bool has_key_agreement = false;
+
+    *count = 0;
+    cbor_decoder_init(&decoder, params, params_len);
+
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case PROVISION_SUB_RP_ID: {
+                size_t len = sizeof(rp_id);
+                if (cbor_decode_text(&decoder, rp_id, &len) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                has_rp_id = true;
+                break;
+            }
+
+            case PROVISION_SUB_ENTRIES:
+                /* Decoded below, once the key agreement is known */
+                entries_start = decoder.offset;
+                if (cbor_decode_array_start(&decoder, &entry_count) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                for (size_t j = 0; j < entry_count; j++) {
+                    if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                        return CTAP2_ERR_INVALID_CBOR;
+                    }
+                }
+                has_entries = true;
+                break;
+
+            case PROVISION_SUB_KEY_AGREEMENT:
+                if (pin_protocol_decode_key(&decoder, platform_key) != PIN_PROTOCOL_OK) {
+                    return CTAP2_ERR_INVALID_PARAMETER;
+                }
+                has_key_agreement = true;
+                break;
+
+            default:
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+        }
+    }
+
+    if (!has_rp_id || !has_entries || entry_count == 0 ||
+        (subcommand == PROVISION_IMPORT && !has_key_agreement)) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    if (entry_count > PROVISION_MAX_BATCH) {
+        return CTAP2_ERR_LIMIT_EXCEEDED;
+    }
+
+    const pin_protocol_secret_t *secret = NULL;
+    if (subcommand == PROVISION_IMPORT) {
+        uint8_t status = ctap2_get_shared_secret(pin_protocol, platform_key, &secret);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+    }
+
+    uint8_t rp_id_hash[32];
+    uint32_t sign_count;
+    if (crypto_sha256((const uint8_t *) rp_id, strlen(rp_id), rp_id_hash) != CRYPTO_OK ||
+        storage_get_and_increment_counter(&sign_count) != STORAGE_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    size_t array_size;
+    decoder.offset = entries_start;
+    cbor_decode_array_start(&decoder, &array_size);
+
+    for (size_t i = 0; i < entry_count; i++) {
+        storage_credential_t *credential = &provision_batch.credentials[i];
+        uint8_t *public_key = provision_batch.public_keys[i];
+        uint8_t enc_key[PROVISION_MAX_ENC_KEY_SIZE];
+        size_t enc_key_len;
+
+        memset(credential, 0, sizeof(*credential));
+        uint8_t status = decode_entry(&decoder, credential, enc_key, &enc_key_len);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+
+        if (subcommand == PROVISION_GENERATE) {
+            if (crypto_ecdsa_generate_keypair(credential->private_key, public_key) != CRYPTO_OK) {
+                return CTAP2_ERR_PROCESSING;
+            }
+        } else {
+            size_t key_len = 0;
+            if (enc_key_len == 0) {
+                return CTAP2_ERR_MISSING_PARAMETER;
+            }
+            if (pin_protocol_decrypt(secret, enc_key, enc_key_len, credential->private_key,
+                                     &key_len) != PIN_PROTOCOL_OK ||
+                key_len != sizeof(credential->private_key) ||
+                crypto_ecdsa_get_public_key(credential->private_key, public_key) != CRYPTO_OK) {
+                return CTAP2_ERR_INVALID_PARAMETER;
+            }
+        }
+
+        crypto_random_generate(credential->id, STORAGE_CREDENTIAL_ID_LENGTH);
+        memcpy(credential->rp_id_hash, rp_id_hash, 32);
+        strncpy(credential->rp_id, rp_id, STORAGE_MAX_RP_ID_LENGTH - 1);
+        credential->algorithm = COSE_ALG_ES256;
+        credential->resident = true;
+        credential->sign_count = sign_count;
+
+        (*count)++;
+    }
+
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Encode the credential IDs and public keys of the stored batch
+ */
+static void encode_batch(size_t count, uint32_t elapsed_ms, uint8_t *response_data,
+                         size_t *response_len)
+{
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
+
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_uint(&encoder, PROVISION_RESP_CREDENTIALS);
+    cbor_encode_array_start(&encoder, count);
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *public_key = provision_batch.public_keys[i];
+
+        cbor_encode_map_start(&encoder, 2);
+        cbor_encode_uint(&encoder, 1); /* credentialId */
+        cbor_encode_bytes(&encoder, provision_batch.credentials[i].id,
+                          STORAGE_CREDENTIAL_ID_LENGTH);
+        cbor_encode_uint(&encoder, 2); /* publicKey */
+        cbor_encode_map_start(&encoder, 5);
+        cbor_encode_int(&encoder, 1); /* kty */
+        cbor_encode_int(&encoder, 2); /* EC2 */
+        cbor_encode_int(&encoder, 3); /* alg */
+        cbor_encode_int(&encoder, COSE_ALG_ES256);
+        cbor_encode_int(&encoder, -1); /* crv */
+        cbor_encode_int(&encoder, 1);  /* P-256 */
+        cbor_encode_int(&encoder, -2); /* x */
+        cbor_encode_bytes(&encoder, &public_key[0], 32);
+        cbor_encode_int(&encoder, -3); /* y */
+        cbor_encode_bytes(&encoder, &public_key[32], 32);
+    }
+
+    cbor_encode_uint(&encoder, PROVISION_RESP_ELAPSED_MS);
+    cbor_encode_uint(&encoder, elapsed_ms);
+
+    *response_len = cbor_encoder_get_size(&encoder);
+}
+
+/**
+ * @brief Main vendor provisioning command handler
+ */
+uint8_t ctap2_vendor_provision(const uint8_t *request_data, size_t request_len,
+                               uint8_t *response_data, size_t *response_len)
+{
+    LOG_INFO("Vendor provisioning command");
+
+    cbor_decoder_t decoder;
+    cbor_decoder_init(&decoder, request_data, request_len);
+
+    size_t map_size;
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    uint64_t value;
+    uint8_t subcommand = 0;
+    uint8_t pin_protocol = 0;
+    uint8_t pin_auth[32];
+    size_t pin_auth_len = 0;
+    size_t params_start = 0;
+    size_t params_end = 0;
+    bool has_subcommand = false;
+    bool has_pin_auth = false;
+
+    /* Parse parameters */
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case PROVISION_PARAM_SUBCOMMAND:
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                subcommand = (uint8_t) value;
+                has_subcommand = true;
+                break;
+
+            case PROVISION_PARAM_SUBCOMMAND_PARAMS:
+                params_start = decoder.offset;
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                params_end = decoder.offset;
+                break;
+
+            case PROVISION_PARAM_PIN_PROTOCOL:
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                pin_protocol = (uint8_t) value;
+                break;
+
+            case PROVISION_PARAM_PIN_AUTH:
+                pin_auth_len = sizeof(pin_auth);
+                if (cbor_decode_bytes(&decoder, pin_auth, &pin_auth_len) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                has_pin_auth = true;
+                break;
+
+            default:
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+        }
+    }
+
+    if (!has_subcommand || params_end == params_start) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    if (subcommand != PROVISION_GENERATE && subcommand != PROVISION_IMPORT) {
+        return CTAP2_ERR_INVALID_SUBCOMMAND;
+    }
+
+    uint8_t status = verify_provision_pin_auth(
+        subcommand, &request_data[params_start], params_end - params_start,
+        has_pin_auth ? pin_auth : NULL, has_pin_auth ? pin_auth_len : 0, pin_protocol);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    uint64_t start_ms = hal_get_timestamp_ms();
+    size_t count = 0;
+    size_t stored = 0;
+
+    status = build_batch(subcommand, &request_data[params_start], params_end - params_start,
+                         pin_protocol, &count);
+    if (status == CTAP2_OK) {
+        int ret = storage_store_credentials(provision_batch.credentials, count, &stored);
+        if (ret == STORAGE_ERROR_FULL) {
+            status = CTAP2_ERR_KEY_STORE_FULL;
+        } else if (ret != STORAGE_OK) {
+            status = CTAP2_ERR_PROCESSING;
+        }
+    }
+
+    if (status == CTAP2_OK) {
+        uint32_t elapsed_ms = (uint32_t) (hal_get_timestamp_ms() - start_ms);
+        encode_batch(count, elapsed_ms, response_data, response_len);
+        LOG_INFO("Provisioned %zu credentials in %u ms (%u per second)", count,
+                 (unsigned) elapsed_ms,
+                 (unsigned) (elapsed_ms > 0 ? (count * 1000) / elapsed_ms : count * 1000));
+    } else if (stored > 0) {
+        /* The host never learns these IDs, so leave nothing of a failed batch behind */
+        LOG_WARN("Provisioning stopped after %zu of %zu credentials, rolling back", stored,
+                 count);
+        for (size_t i = 0; i < stored; i++) {
+            if (storage_delete_credential(provision_batch.credentials[i].id) != STORAGE_OK) {
+                LOG_ERROR("Failed to roll back provisioned credential %zu", i);
+            }
+        }
+    }
+
+    crypto_secure_zero(&provision_batch, sizeof(provision_batch));
+    return status;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file ctap2_trace.c
+ * @brief Vendor Diagnostics Command Implementation
+ *
+ * Pages the span trace ring and the function profile out over any CTAP2
+ * transport, so a capture can be taken from a device in the field without
+ * a debug probe. The host keeps the cursor: each response carries the
+ * index to ask for next.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <string.h>
+
+#include "cbor.h"
+#include "config.h"
+#include "ctap2.h"
+#include "hal.h"
+#include "logger.h"
+#include "profiler.h"
+#include "trace.h"
+
+/* Diagnostics Subcommands */
+#define TRACE_READ 0x01
+#define TRACE_CLEAR 0x02
+#define TRACE_PROFILE_READ 0x03
+#define TRACE_PROFILE_CLEAR 0x04
+
+/* Request Parameters */
+#define TRACE_PARAM_SUBCOMMAND 0x01
+#define TRACE_PARAM_CURSOR 0x02
+
+/* Response Keys */
+#define TRACE_RESP_FIRST 0x01
+#define TRACE_RESP_EVENTS 0x02
+#define TRACE_RESP_NEXT 0x03
+#define TRACE_RESP_HEAD 0x04
+#define TRACE_RESP_TICK_HZ 0x05
+
+/* Profile Response Keys */
+#define PROFILE_RESP_CYCLE_HZ 0x01
+#define PROFILE_RESP_ENTRIES 0x02
+#define PROFILE_RESP_NEXT 0x03
+#define PROFILE_RESP_SLOTS 0x04
+#define PROFILE_RESP_DROPPED 0x05
+
+/* Events per response page */
+#define TRACE_PAGE_EVENTS 96
+
+/* Profile entries per response page; each encodes to at most 39 bytes */
+#define PROFILE_PAGE_ENTRIES 16
+
+/* Timestamps are in microseconds */
+#define TRACE_TICK_HZ 1000000
+
+/**
+ * @brief Serialize events little-endian, independent of the host's layout
+ */
+static size_t trace_pack(const trace_event_t *events, size_t count, uint8_t *out)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint8_t *p = &out[i * sizeof(trace_event_t)];
+        p[0] = (uint8_t) events[i].timestamp_us;
+        p[1] = (uint8_t) (events[i].timestamp_us >> 8);
+        p[2] = (uint8_t) (events[i].timestamp_us >> 16);
+        p[3] = (uint8_t) (events[i].timestamp_us >> 24);
+        p[4] = events[i].span;
+        p[5] = events[i].phase;
+        p[6] = events[i].core;
+        p[7] = events[i].arg;
+    }
+
+    return count * sizeof(trace_event_t);
+}
+
+/**
+ * @brief Encode one page of trace events starting at @p cursor
+ */
+static uint8_t trace_read_page(uint32_t cursor, uint8_t *response_data, size_t *response_len)
+{
+    trace_event_t events[16];
+    uint8_t packed[TRACE_PAGE_EVENTS * sizeof(trace_event_t)];
+    size_t packed_len = 0;
+    size_t total = 0;
+    uint32_t first = cursor;
+
+    /* trace_read() moves the cursor past events that were overwritten */
+    uint32_t next = cursor;
+    while (total < TRACE_PAGE_EVENTS) {
+        size_t want = TRACE_PAGE_EVENTS - total;
+        if (want > sizeof(events) / sizeof(events[0])) {
+            want = sizeof(events) / sizeof(events[0]);
+        }
+        size_t count = trace_read(&next, events, want);
+        if (count == 0) {
+            break;
+        }
+        if (total == 0) {
+            first = next - (uint32_t) count;
+        }
+        packed_len += trace_pack(events, count, &packed[packed_len]);
+        total += count;
+    }
+
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
+
+    cbor_encode_map_start(&encoder, 5);
+    cbor_encode_uint(&encoder, TRACE_RESP_FIRST);
+    cbor_encode_uint(&encoder, first);
+    cbor_encode_uint(&encoder, TRACE_RESP_EVENTS);
+    cbor_encode_bytes(&encoder, packed, packed_len);
+    cbor_encode_uint(&encoder, TRACE_RESP_NEXT);
+    cbor_encode_uint(&encoder, next);
+    cbor_encode_uint(&encoder, TRACE_RESP_HEAD);
+    cbor_encode_uint(&encoder, trace_head());
+    cbor_encode_uint(&encoder, TRACE_RESP_TICK_HZ);
+    cbor_encode_uint(&encoder, TRACE_TICK_HZ);
+
+    *response_len = cbor_encoder_get_size(&encoder);
+    return CTAP2_OK;
+}
+
+/**
+ * @brief Encode one page of profile entries starting at slot @p cursor
+ */
+static uint8_t profile_read_page(uint32_t cursor, uint8_t *response_data, size_t *response_len)
+{
+    profiler_entry_t entries[PROFILE_PAGE_ENTRIES];
+    size_t next = cursor;
+    size_t count = profiler_read(&next, entries, PROFILE_PAGE_ENTRIES);
+
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, response_data, CTAP2_MAX_MESSAGE_SIZE);
+
+    cbor_encode_map_start(&encoder, 5);
+    cbor_encode_uint(&encoder, PROFILE_RESP_CYCLE_HZ);
+    cbor_encode_uint(&encoder, hal_cycle_frequency());
+
+    /* [function, core, calls, inclusive, exclusive] per entry */
+    cbor_encode_uint(&encoder, PROFILE_RESP_ENTRIES);
+    cbor_encode_array_start(&encoder, count);
+    for (size_t i = 0; i < count; i++) {
+        cbor_encode_array_start(&encoder, 5);
+        cbor_encode_uint(&encoder, entries[i].function);
+        cbor_encode_uint(&encoder, entries[i].core);
+        cbor_encode_uint(&encoder, entries[i].calls);
+        cbor_encode_uint(&encoder, entries[i].inclusive);
+        cbor_encode_uint(&encoder, entries[i].exclusive);
+    }
+
+    cbor_encode_uint(&encoder, PROFILE_RESP_NEXT);
+    cbor_encode_uint(&encoder, next);
+    cbor_encode_uint(&encoder, PROFILE_RESP_SLOTS);
+    cbor_encode_uint(&encoder, profiler_slot_count());
+    cbor_encode_uint(&encoder, PROFILE_RESP_DROPPED);
+    cbor_encode_uint(&encoder, profiler_dropped());
+
+    *response_len = cbor_encoder_get_size(&encoder);
+    return CTAP2_OK;
+}
+
+uint8_t ctap2_vendor_trace(const uint8_t *request_data, size_t request_len,
+                           uint8_t *response_data, size_t *response_len)
+{
+    LOG_DEBUG("Vendor diagnostics command");
+
+    if (!CONFIG_ENABLE_TRACE && !CONFIG_ENABLE_PROFILE) {
+        return CTAP2_ERR_INVALID_COMMAND;
+    }
+
+    cbor_decoder_t decoder;
+    cbor_decoder_init(&decoder, request_data, request_len);
+
+    size_t map_size;
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return CTAP2_ERR_INVALID_CBOR;
+    }
+
+    uint64_t value;
+    uint8_t subcommand = 0;
+    uint32_t cursor = 0;
+    bool has_subcommand = false;
+
+    /* Parse parameters */
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return CTAP2_ERR_INVALID_CBOR;
+        }
+
+        switch (key) {
+            case TRACE_PARAM_SUBCOMMAND:
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                subcommand = (uint8_t) value;
+                has_subcommand = true;
+                break;
+
+            case TRACE_PARAM_CURSOR:
+                if (cbor_decode_uint(&decoder, &value) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                cursor = (uint32_t) value;
+                break;
+
+            default:
+                if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                    return CTAP2_ERR_INVALID_CBOR;
+                }
+                break;
+        }
+    }
+
+    if (!has_subcommand) {
+        return CTAP2_ERR_MISSING_PARAMETER;
+    }
+
+    switch (subcommand) {
+        case TRACE_READ:
+            if (!CONFIG_ENABLE_TRACE) {
+                break;
+            }
+            return trace_read_page(cursor, response_data, response_len);
+
+        case TRACE_CLEAR:
+            if (!CONFIG_ENABLE_TRACE) {
+                break;
+            }
+            trace_clear();
+            *response_len = 0;
+            return CTAP2_OK;
+
+        case TRACE_PROFILE_READ:
+            if (!CONFIG_ENABLE_PROFILE) {
+                break;
+            }
+            return profile_read_page(cursor, response_data, response_len);
+
+        case TRACE_PROFILE_CLEAR:
+            if (!CONFIG_ENABLE_PROFILE) {
+                break;
+            }
+            profiler_clear();
+            *response_len = 0;
+            return CTAP2_OK;
+
+        default:
+            break;
+    }
+
+    return CTAP2_ERR_INVALID_SUBCOMMAND;
+}
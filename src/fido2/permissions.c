@@ -10,16 +10,90 @@
 
 #include <string.h>
 
+#include "config.h"
+#include "crypto.h"
+#include "hal.h"
 #include "logger.h"
+#include "module_state.h"
+#include "pin_protocol.h"
 
-static permission_state_t perm_state = {0};
+static OPENFIDO_STATE permission_state_t perm_state = {0};
+OPENFIDO_STATE_REGISTER(perm_state);
+
+/* Token material, kept apart from the state handed out by permissions_get_state() */
+static OPENFIDO_STATE struct {
+    uint8_t token[PERM_TOKEN_SIZE];
+    crypto_hmac_ctx_t hmac; /* Key schedule for the token */
+} perm_token = {0};
+OPENFIDO_STATE_REGISTER(perm_token);
+
+static uint32_t perm_now(void)
+{
+    return (uint32_t) hal_get_timestamp_ms();
+}
+
+/**
+ * @brief Expire the token if its lifetime or usage timer has run out
+ *
+ * @return true if the token is still live
+ */
+static bool token_is_live(void)
+{
+    if (!perm_state.active) {
+        return false;
+    }
+
+    uint32_t now = perm_now();
+
+    if ((int32_t) (now - perm_state.expiry_time) >= 0 ||
+        (now - perm_state.last_used_time) >= CONFIG_SEC_PIN_TOKEN_IDLE_MS) {
+        LOG_INFO("PIN token expired");
+        permissions_clear();
+        return false;
+    }
+
+    return true;
+}
 
 void permissions_init(void)
 {
-    memset(&perm_state, 0, sizeof(perm_state));
+    permissions_clear();
     LOG_INFO("Permissions system initialized");
 }
 
+bool permissions_begin_session(const uint8_t *token, uint8_t permissions,
+                               const uint8_t *rp_id_hash)
+{
+    if (token == NULL || permissions == 0) {
+        return false;
+    }
+
+    permissions_clear();
+
+    if (crypto_hmac_ctx_init(&perm_token.hmac, token, PERM_TOKEN_SIZE) != CRYPTO_OK) {
+        LOG_ERROR("Failed to load PIN token key");
+        return false;
+    }
+    memcpy(perm_token.token, token, PERM_TOKEN_SIZE);
+
+    uint32_t now = perm_now();
+    perm_state.active = true;
+    perm_state.expiry_time = now + CONFIG_SEC_PIN_TOKEN_TIMEOUT_MS;
+    perm_state.last_used_time = now;
+
+    return permissions_set(permissions, rp_id_hash);
+}
+
+bool permissions_get_token(uint8_t *token)
+{
+    if (token == NULL || !token_is_live()) {
+        return false;
+    }
+
+    memcpy(token, perm_token.token, PERM_TOKEN_SIZE);
+    return true;
+}
+
 bool permissions_set(uint8_t permissions, const uint8_t *rp_id_hash)
 {
     perm_state.permissions = permissions;
@@ -39,6 +113,11 @@ bool permissions_set(uint8_t permissions, const uint8_t *rp_id_hash)
 
 bool permissions_check(uint8_t permission, const uint8_t *rp_id_hash)
 {
+    if (!token_is_live()) {
+        LOG_WARN("Permission denied: no PIN token");
+        return false;
+    }
+
     /* Check if permission bit is set */
     if ((perm_state.permissions & permission) == 0) {
         LOG_WARN("Permission denied: 0x%02X not in 0x%02X", permission, perm_state.permissions);
@@ -46,13 +125,17 @@ bool permissions_check(uint8_t permission, const uint8_t *rp_id_hash)
     }
 
     /* For MC/GA permissions, verify RP ID matches */
-    if ((permission == PERM_MAKE_CREDENTIAL || permission == PERM_GET_ASSERTION) &&
-        perm_state.has_rp_id) {
+    if (permission == PERM_MAKE_CREDENTIAL || permission == PERM_GET_ASSERTION) {
         if (rp_id_hash == NULL) {
             LOG_WARN("Permission denied: RP ID required but not provided");
             return false;
         }
-        if (memcmp(perm_state.rp_id_hash, rp_id_hash, 32) != 0) {
+
+        if (!perm_state.has_rp_id) {
+            /* An unbound token binds to the first RP it is used with */
+            memcpy(perm_state.rp_id_hash, rp_id_hash, 32);
+            perm_state.has_rp_id = true;
+        } else if (memcmp(perm_state.rp_id_hash, rp_id_hash, 32) != 0) {
             LOG_WARN("Permission denied: RP ID mismatch");
             return false;
         }
@@ -61,10 +144,63 @@ bool permissions_check(uint8_t permission, const uint8_t *rp_id_hash)
     return true;
 }
 
+int permissions_verify(uint8_t pin_protocol, const uint8_t *message, size_t message_len,
+                       const uint8_t *pin_auth, size_t pin_auth_len)
+{
+    uint8_t mac[CRYPTO_SHA256_DIGEST_SIZE];
+
+    if (!token_is_live()) {
+        return PERM_ERROR_NO_TOKEN;
+    }
+
+    if (pin_auth == NULL || pin_auth_len == 0 ||
+        pin_auth_len != pin_protocol_auth_size(pin_protocol)) {
+        return PERM_ERROR_AUTH;
+    }
+
+    if (crypto_hmac_ctx_compute(&perm_token.hmac, message, message_len, mac) != CRYPTO_OK) {
+        return PERM_ERROR_AUTH;
+    }
+
+    /* Constant-time compare */
+    uint8_t diff = 0;
+    for (size_t i = 0; i < pin_auth_len; i++) {
+        diff |= mac[i] ^ pin_auth[i];
+    }
+    crypto_secure_zero(mac, sizeof(mac));
+
+    if (diff != 0) {
+        LOG_WARN("pinUvAuthParam verification failed");
+        return PERM_ERROR_AUTH;
+    }
+
+    return PERM_OK;
+}
+
+int permissions_authorize(uint8_t permission, const uint8_t *rp_id_hash, uint8_t pin_protocol,
+                          const uint8_t *message, size_t message_len, const uint8_t *pin_auth,
+                          size_t pin_auth_len)
+{
+    int ret = permissions_verify(pin_protocol, message, message_len, pin_auth, pin_auth_len);
+    if (ret != PERM_OK) {
+        return ret;
+    }
+
+    if (!permissions_check(permission, rp_id_hash)) {
+        return PERM_ERROR_DENIED;
+    }
+
+    /* Restart the usage timer */
+    perm_state.last_used_time = perm_now();
+    return PERM_OK;
+}
+
 void permissions_clear(void)
 {
+    crypto_hmac_ctx_free(&perm_token.hmac);
+    crypto_secure_zero(&perm_token, sizeof(perm_token));
     memset(&perm_state, 0, sizeof(perm_state));
-    LOG_INFO("Permissions cleared");
+    LOG_DEBUG("Permissions cleared");
 }
 
 const permission_state_t *permissions_get_state(void)
@@ -2,6 +2,11 @@
  * @file permissions.h
  * @brief CTAP2 Permissions System
  *
+ * Holds the pinUvAuthToken session: the token itself (with its HMAC key
+ * schedule cached), the permissions it grants, the RP it is bound to, and
+ * its lifetime and usage timers. One PIN entry authorizes every operation
+ * the token permits until the token expires or is replaced.
+ *
  * @copyright Copyright (c) 2025 OpenFIDO Contributors
  * @license MIT License
  */
@@ -10,6 +15,7 @@
 #define PERMISSIONS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -24,12 +30,26 @@ extern "C" {
 #define PERM_LARGE_BLOB_WRITE 0x10  /* LargeBlobWrite (lbw) */
 #define PERM_AUTHENTICATOR_CFG 0x20 /* AuthenticatorConfig (acfg) */
 
+/* Permissions granted by the legacy getPinToken subcommand */
+#define PERM_DEFAULT (PERM_MAKE_CREDENTIAL | PERM_GET_ASSERTION)
+
+/* Permissions Return Codes */
+#define PERM_OK 0
+#define PERM_ERROR_NO_TOKEN -1 /* No token issued, or it has expired */
+#define PERM_ERROR_AUTH -2     /* pinUvAuthParam does not verify */
+#define PERM_ERROR_DENIED -3   /* Token lacks the permission or RP binding */
+
+/* pinUvAuthToken size */
+#define PERM_TOKEN_SIZE 32
+
 /* Permission State */
 typedef struct {
-    uint8_t permissions;    /* Active permissions bitmap */
-    uint8_t rp_id_hash[32]; /* RP ID hash for MC/GA permissions */
-    bool has_rp_id;         /* Whether RP ID is set */
-    uint32_t expiry_time;   /* Permission expiry timestamp */
+    uint8_t permissions;     /* Active permissions bitmap */
+    uint8_t rp_id_hash[32];  /* RP ID hash for MC/GA permissions */
+    bool has_rp_id;          /* Whether RP ID is set */
+    bool active;             /* Token issued and not yet expired */
+    uint32_t expiry_time;    /* Token lifetime end (ms timestamp) */
+    uint32_t last_used_time; /* Last successful use (ms timestamp) */
 } permission_state_t;
 
 /**
@@ -37,6 +57,25 @@ typedef struct {
  */
 void permissions_init(void);
 
+/**
+ * @brief Start a token session, replacing any previous token
+ *
+ * @param token Token value (PERM_TOKEN_SIZE bytes)
+ * @param permissions Permission bitmap
+ * @param rp_id_hash RP ID hash to bind to, or NULL to bind on first MC/GA use
+ * @return true if successful
+ */
+bool permissions_begin_session(const uint8_t *token, uint8_t permissions,
+                               const uint8_t *rp_id_hash);
+
+/**
+ * @brief Copy out the current token
+ *
+ * @param token Output buffer (PERM_TOKEN_SIZE bytes)
+ * @return true if a live token was copied
+ */
+bool permissions_get_token(uint8_t *token);
+
 /**
  * @brief Set permissions from PIN token
  *
@@ -49,6 +88,8 @@ bool permissions_set(uint8_t permissions, const uint8_t *rp_id_hash);
 /**
  * @brief Check if a permission is granted
  *
+ * Binds an unbound token to @p rp_id_hash on its first MC/GA use.
+ *
  * @param permission Permission bit to check
  * @param rp_id_hash RP ID hash to verify (for MC/GA), can be NULL
  * @return true if permission is granted
@@ -56,7 +97,41 @@ bool permissions_set(uint8_t permissions, const uint8_t *rp_id_hash);
 bool permissions_check(uint8_t permission, const uint8_t *rp_id_hash);
 
 /**
- * @brief Clear all permissions
+ * @brief Verify a pinUvAuthParam against the current token
+ *
+ * Expects the 16-byte truncated MAC for PIN protocol 1 and the full 32 bytes
+ * for protocol 2.
+ *
+ * @param pin_protocol pinUvAuthProtocol from the request
+ * @param message Authenticated message
+ * @param message_len Length of message
+ * @param pin_auth pinUvAuthParam from the request
+ * @param pin_auth_len Length of pin_auth
+ * @return PERM_OK, PERM_ERROR_NO_TOKEN or PERM_ERROR_AUTH
+ */
+int permissions_verify(uint8_t pin_protocol, const uint8_t *message, size_t message_len,
+                       const uint8_t *pin_auth, size_t pin_auth_len);
+
+/**
+ * @brief Verify a pinUvAuthParam and check a permission in one step
+ *
+ * Restarts the usage timer on success.
+ *
+ * @param permission Permission bit required
+ * @param rp_id_hash RP ID hash (for MC/GA), can be NULL
+ * @param pin_protocol pinUvAuthProtocol from the request
+ * @param message Authenticated message
+ * @param message_len Length of message
+ * @param pin_auth pinUvAuthParam from the request
+ * @param pin_auth_len Length of pin_auth
+ * @return PERM_OK or a PERM_ERROR_* code
+ */
+int permissions_authorize(uint8_t permission, const uint8_t *rp_id_hash, uint8_t pin_protocol,
+                          const uint8_t *message, size_t message_len, const uint8_t *pin_auth,
+                          size_t pin_auth_len);
+
+/**
+ * @brief Clear all permissions and destroy the token
  */
 void permissions_clear(void);
 
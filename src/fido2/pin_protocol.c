@@ -0,0 +1,263 @@
+/**
+ * @file pin_protocol.c
+ * @brief PIN/UV Auth Protocols 1 and 2 Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "pin_protocol.h"
+
+#include <string.h>
+
+#include "logger.h"
+#include "module_state.h"
+
+/* COSE_Key labels and values (RFC 8152) */
+#define COSE_KEY_KTY 1
+#define COSE_KEY_CRV -1
+#define COSE_KEY_X -2
+#define COSE_KEY_Y -3
+
+#define COSE_KTY_EC2 2
+#define COSE_CRV_P256 1
+
+/* HKDF info strings for protocol 2 (CTAP 2.1, 6.5.7) */
+static const char HKDF_INFO_HMAC[] = "CTAP2 HMAC key";
+static const char HKDF_INFO_AES[] = "CTAP2 AES key";
+
+/* Secret for the current key-agreement session */
+static OPENFIDO_STATE struct {
+    bool valid;
+    uint8_t peer_public_key[64]; /* Platform key the secret was derived with */
+    pin_protocol_secret_t secret;
+} pin_cache = {0};
+OPENFIDO_STATE_REGISTER(pin_cache);
+
+bool pin_protocol_is_supported(uint64_t protocol)
+{
+    return protocol == PIN_PROTOCOL_V1 || protocol == PIN_PROTOCOL_V2;
+}
+
+size_t pin_protocol_auth_size(uint8_t protocol)
+{
+    switch (protocol) {
+        case PIN_PROTOCOL_V1:
+            return 16;
+        case PIN_PROTOCOL_V2:
+            return CRYPTO_SHA256_DIGEST_SIZE;
+        default:
+            return 0;
+    }
+}
+
+int pin_protocol_decode_key(cbor_decoder_t *decoder, uint8_t *public_key)
+{
+    size_t map_size;
+    bool has_x = false;
+    bool has_y = false;
+
+    if (decoder == NULL || public_key == NULL) {
+        return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+    }
+
+    if (cbor_decode_map_start(decoder, &map_size) != CBOR_OK) {
+        return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+    }
+
+    for (size_t i = 0; i < map_size; i++) {
+        int64_t label;
+        if (cbor_decode_int(decoder, &label) != CBOR_OK) {
+            return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+        }
+
+        if (label == COSE_KEY_X || label == COSE_KEY_Y) {
+            uint8_t *coordinate = (label == COSE_KEY_X) ? &public_key[0] : &public_key[32];
+            size_t len = 32;
+
+            if (cbor_decode_bytes(decoder, coordinate, &len) != CBOR_OK || len != 32) {
+                return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+            }
+            if (label == COSE_KEY_X) {
+                has_x = true;
+            } else {
+                has_y = true;
+            }
+        } else if (label == COSE_KEY_KTY || label == COSE_KEY_CRV) {
+            int64_t value;
+            if (cbor_decode_int(decoder, &value) != CBOR_OK) {
+                return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+            }
+            if ((label == COSE_KEY_KTY && value != COSE_KTY_EC2) ||
+                (label == COSE_KEY_CRV && value != COSE_CRV_P256)) {
+                return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+            }
+        } else {
+            cbor_decoder_skip(decoder);
+        }
+    }
+
+    return (has_x && has_y) ? PIN_PROTOCOL_OK : PIN_PROTOCOL_ERROR_INVALID_PARAM;
+}
+
+/**
+ * @brief Derive the protocol keys from the ECDH output
+ */
+static int derive_keys(uint8_t protocol, const uint8_t *z, pin_protocol_secret_t *secret)
+{
+    static const uint8_t zero_salt[32] = {0};
+    uint8_t hmac_key[32];
+    int ret = CRYPTO_ERROR;
+
+    secret->protocol = protocol;
+
+    if (protocol == PIN_PROTOCOL_V1) {
+        ret = crypto_sha256(z, 32, hmac_key);
+        if (ret == CRYPTO_OK) {
+            memcpy(secret->aes_key, hmac_key, sizeof(secret->aes_key));
+        }
+    } else {
+        ret = crypto_hkdf_sha256(zero_salt, sizeof(zero_salt), z, 32,
+                                 (const uint8_t *) HKDF_INFO_HMAC, sizeof(HKDF_INFO_HMAC) - 1,
+                                 hmac_key, sizeof(hmac_key));
+        if (ret == CRYPTO_OK) {
+            ret = crypto_hkdf_sha256(zero_salt, sizeof(zero_salt), z, 32,
+                                     (const uint8_t *) HKDF_INFO_AES, sizeof(HKDF_INFO_AES) - 1,
+                                     secret->aes_key, sizeof(secret->aes_key));
+        }
+    }
+
+    if (ret == CRYPTO_OK) {
+        ret = crypto_hmac_ctx_init(&secret->hmac, hmac_key, sizeof(hmac_key));
+    }
+
+    crypto_secure_zero(hmac_key, sizeof(hmac_key));
+    return ret;
+}
+
+int pin_protocol_decapsulate(uint8_t protocol, const uint8_t *private_key,
+                             const uint8_t *peer_public_key, const pin_protocol_secret_t **secret)
+{
+    if (!pin_protocol_is_supported(protocol) || private_key == NULL || peer_public_key == NULL ||
+        secret == NULL) {
+        return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+    }
+
+    /* Same platform key in the same session: reuse the derived keys */
+    if (pin_cache.valid && pin_cache.secret.protocol == protocol &&
+        memcmp(pin_cache.peer_public_key, peer_public_key, sizeof(pin_cache.peer_public_key)) ==
+            0) {
+        *secret = &pin_cache.secret;
+        return PIN_PROTOCOL_OK;
+    }
+
+    pin_protocol_clear();
+
+    uint8_t z[32];
+    int ret = crypto_ecdh_shared_secret(private_key, peer_public_key, z);
+    if (ret == CRYPTO_OK) {
+        ret = derive_keys(protocol, z, &pin_cache.secret);
+    }
+    crypto_secure_zero(z, sizeof(z));
+
+    if (ret != CRYPTO_OK) {
+        LOG_WARN("PIN protocol %u key agreement failed", protocol);
+        pin_protocol_clear();
+        return PIN_PROTOCOL_ERROR;
+    }
+
+    memcpy(pin_cache.peer_public_key, peer_public_key, sizeof(pin_cache.peer_public_key));
+    pin_cache.valid = true;
+
+    *secret = &pin_cache.secret;
+    return PIN_PROTOCOL_OK;
+}
+
+int pin_protocol_encrypt(const pin_protocol_secret_t *secret, const uint8_t *plaintext,
+                         size_t len, uint8_t *ciphertext, size_t *ciphertext_len)
+{
+    uint8_t iv[CRYPTO_AES_BLOCK_SIZE] = {0};
+    size_t iv_len = 0;
+
+    if (secret == NULL || plaintext == NULL || ciphertext == NULL || ciphertext_len == NULL ||
+        len % CRYPTO_AES_BLOCK_SIZE != 0) {
+        return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+    }
+
+    if (secret->protocol == PIN_PROTOCOL_V2) {
+        if (crypto_random_generate(iv, sizeof(iv)) != CRYPTO_OK) {
+            return PIN_PROTOCOL_ERROR;
+        }
+        memcpy(ciphertext, iv, sizeof(iv));
+        iv_len = sizeof(iv);
+    }
+
+    if (crypto_aes_cbc_encrypt(secret->aes_key, iv, plaintext, len, &ciphertext[iv_len]) !=
+        CRYPTO_OK) {
+        return PIN_PROTOCOL_ERROR;
+    }
+
+    *ciphertext_len = iv_len + len;
+    return PIN_PROTOCOL_OK;
+}
+
+int pin_protocol_decrypt(const pin_protocol_secret_t *secret, const uint8_t *ciphertext,
+                         size_t len, uint8_t *plaintext, size_t *plaintext_len)
+{
+    static const uint8_t zero_iv[CRYPTO_AES_BLOCK_SIZE] = {0};
+    const uint8_t *iv = zero_iv;
+
+    if (secret == NULL || ciphertext == NULL || plaintext == NULL || plaintext_len == NULL) {
+        return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+    }
+
+    if (secret->protocol == PIN_PROTOCOL_V2) {
+        if (len < PIN_PROTOCOL_V2_IV_SIZE) {
+            return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+        }
+        iv = ciphertext;
+        ciphertext += PIN_PROTOCOL_V2_IV_SIZE;
+        len -= PIN_PROTOCOL_V2_IV_SIZE;
+    }
+
+    if (len == 0 || len % CRYPTO_AES_BLOCK_SIZE != 0) {
+        return PIN_PROTOCOL_ERROR_INVALID_PARAM;
+    }
+
+    if (crypto_aes_cbc_decrypt(secret->aes_key, iv, ciphertext, len, plaintext) != CRYPTO_OK) {
+        return PIN_PROTOCOL_ERROR;
+    }
+
+    *plaintext_len = len;
+    return PIN_PROTOCOL_OK;
+}
+
+int pin_protocol_verify(const pin_protocol_secret_t *secret, const uint8_t *message,
+                        size_t message_len, const uint8_t *signature, size_t signature_len)
+{
+    uint8_t mac[CRYPTO_SHA256_DIGEST_SIZE];
+
+    if (secret == NULL || signature == NULL ||
+        signature_len != pin_protocol_auth_size(secret->protocol)) {
+        return PIN_PROTOCOL_ERROR_AUTH;
+    }
+
+    if (crypto_hmac_ctx_compute(&secret->hmac, message, message_len, mac) != CRYPTO_OK) {
+        return PIN_PROTOCOL_ERROR_AUTH;
+    }
+
+    /* Constant-time compare */
+    uint8_t diff = 0;
+    for (size_t i = 0; i < signature_len; i++) {
+        diff |= mac[i] ^ signature[i];
+    }
+    crypto_secure_zero(mac, sizeof(mac));
+
+    return (diff == 0) ? PIN_PROTOCOL_OK : PIN_PROTOCOL_ERROR_AUTH;
+}
+
+void pin_protocol_clear(void)
+{
+    crypto_hmac_ctx_free(&pin_cache.secret.hmac);
+    crypto_secure_zero(&pin_cache, sizeof(pin_cache));
+}
@@ -0,0 +1,142 @@
+/**
+ * @file pin_protocol.h
+ * @brief PIN/UV Auth Protocols 1 and 2
+ *
+ * Derives the shared secret from a platform key-agreement key and provides
+ * the per-protocol encrypt, decrypt and authenticate primitives. The derived
+ * keys are cached for the key-agreement session, so repeated exchanges with
+ * the same platform key skip the ECDH and HKDF steps.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef PIN_PROTOCOL_H
+#define PIN_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cbor.h"
+#include "crypto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* PIN Protocol Return Codes */
+#define PIN_PROTOCOL_OK 0
+#define PIN_PROTOCOL_ERROR -1
+#define PIN_PROTOCOL_ERROR_INVALID_PARAM -2
+#define PIN_PROTOCOL_ERROR_AUTH -3
+
+/* Protocol Versions */
+#define PIN_PROTOCOL_V1 1
+#define PIN_PROTOCOL_V2 2
+
+/* Random IV prepended to protocol 2 ciphertexts */
+#define PIN_PROTOCOL_V2_IV_SIZE 16
+
+/**
+ * @brief Shared secret for one key-agreement session
+ */
+typedef struct {
+    uint8_t protocol;        /**< Protocol the keys were derived for */
+    uint8_t aes_key[32];     /**< Encryption key */
+    crypto_hmac_ctx_t hmac; /**< Authentication key schedule */
+} pin_protocol_secret_t;
+
+/**
+ * @brief Check whether a protocol version is supported
+ *
+ * @param protocol pinUvAuthProtocol from the request
+ * @return true for protocol 1 or 2
+ */
+bool pin_protocol_is_supported(uint64_t protocol);
+
+/**
+ * @brief Get the pinUvAuthParam length for a protocol
+ *
+ * @param protocol Protocol version
+ * @return 16 for protocol 1, 32 for protocol 2, 0 if unsupported
+ */
+size_t pin_protocol_auth_size(uint8_t protocol);
+
+/**
+ * @brief Decode a platform key-agreement COSE_Key into X || Y
+ *
+ * Accepts only EC2 keys on P-256.
+ *
+ * @param decoder CBOR decoder positioned at the COSE_Key map
+ * @param public_key Output public key (64 bytes)
+ * @return PIN_PROTOCOL_OK on success, PIN_PROTOCOL_ERROR_INVALID_PARAM otherwise
+ */
+int pin_protocol_decode_key(cbor_decoder_t *decoder, uint8_t *public_key);
+
+/**
+ * @brief Derive (or reuse) the shared secret with a platform key
+ *
+ * Protocol 1: SHA-256(Z) serves as both keys.
+ * Protocol 2: HKDF-SHA-256 with "CTAP2 HMAC key" / "CTAP2 AES key".
+ *
+ * @param protocol Protocol version
+ * @param private_key Authenticator key-agreement private key (32 bytes)
+ * @param peer_public_key Platform public key (64 bytes, X || Y)
+ * @param secret Output pointer to the cached secret
+ * @return PIN_PROTOCOL_OK on success, error code otherwise
+ */
+int pin_protocol_decapsulate(uint8_t protocol, const uint8_t *private_key,
+                             const uint8_t *peer_public_key, const pin_protocol_secret_t **secret);
+
+/**
+ * @brief Encrypt with the shared secret
+ *
+ * Protocol 1 uses a zero IV; protocol 2 prepends a random IV.
+ *
+ * @param secret Shared secret
+ * @param plaintext Input (multiple of 16 bytes)
+ * @param len Length of input
+ * @param ciphertext Output (len, plus 16 for protocol 2)
+ * @param ciphertext_len Output length
+ * @return PIN_PROTOCOL_OK on success, error code otherwise
+ */
+int pin_protocol_encrypt(const pin_protocol_secret_t *secret, const uint8_t *plaintext,
+                         size_t len, uint8_t *ciphertext, size_t *ciphertext_len);
+
+/**
+ * @brief Decrypt with the shared secret
+ *
+ * @param secret Shared secret
+ * @param ciphertext Input as produced by pin_protocol_encrypt()
+ * @param len Length of input
+ * @param plaintext Output
+ * @param plaintext_len Output length
+ * @return PIN_PROTOCOL_OK on success, error code otherwise
+ */
+int pin_protocol_decrypt(const pin_protocol_secret_t *secret, const uint8_t *ciphertext,
+                         size_t len, uint8_t *plaintext, size_t *plaintext_len);
+
+/**
+ * @brief Verify a MAC made with the shared secret
+ *
+ * @param secret Shared secret
+ * @param message Authenticated message
+ * @param message_len Length of message
+ * @param signature MAC from the platform
+ * @param signature_len Length of MAC
+ * @return PIN_PROTOCOL_OK if it verifies, PIN_PROTOCOL_ERROR_AUTH otherwise
+ */
+int pin_protocol_verify(const pin_protocol_secret_t *secret, const uint8_t *message,
+                        size_t message_len, const uint8_t *signature, size_t signature_len);
+
+/**
+ * @brief Drop the cached secret (key-agreement key regenerated or reset)
+ */
+void pin_protocol_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIN_PROTOCOL_H */
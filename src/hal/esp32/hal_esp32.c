@@ -13,17 +13,29 @@
 
 #ifdef ESP_PLATFORM
 
+#include <string.h>
+
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
 #include "esp_random.h"
+#include "esp_rom_sys.h"
 #include "esp_system.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs.h"
 #include "nvs_flash.h"
+#include "soc/soc_caps.h"
 #include "tinyusb.h"
 #include "tusb_cdc_acm.h"
 
+#if SOC_HMAC_SUPPORTED
+#include "esp_hmac.h"
+#endif
+
 /* GPIO Configuration */
 #define BUTTON_GPIO GPIO_NUM_0 /* Boot button */
 #define LED_GPIO GPIO_NUM_2    /* Built-in LED */
@@ -31,6 +43,9 @@
 /* NVS Configuration */
 #define NVS_NAMESPACE "openfido"
 
+/* USB transmit FIFO depth in reports (must be a power of two) */
+#define USB_TX_QUEUE_DEPTH 32
+
 /* USB HID Report Descriptor for FIDO */
 static const uint8_t hid_report_descriptor[] = {
     0x06, 0xD0, 0xF1, /* Usage Page (FIDO Alliance) */
@@ -57,8 +72,128 @@ static struct {
     nvs_handle_t nvs_handle;
     hal_led_state_t led_state;
     TaskHandle_t led_task_handle;
+    hal_button_cb_t button_cb;
+    esp_timer_handle_t led_tick_timer;
+    hal_led_tick_cb_t led_tick_cb;
 } hal_esp32_state = {0};
 
+/* USB transmit FIFO, drained from the TinyUSB report complete callback */
+static struct {
+    uint8_t reports[USB_TX_QUEUE_DEPTH][HAL_USB_REPORT_SIZE];
+    volatile uint32_t head;        /* Next report to hand to TinyUSB */
+    volatile uint32_t tail;        /* Next free slot */
+    volatile uint32_t completions; /* Reports TinyUSB has finished with */
+    volatile bool in_flight;       /* TinyUSB accepted a report and has not completed it */
+    volatile bool sending;         /* A context is inside tud_hid_report() */
+    volatile bool burst;           /* hal_usb_send_burst() reports not yet drained */
+    hal_usb_tx_complete_cb_t complete_cb;
+    esp_timer_handle_t retry_timer;
+} usb_tx_queue = {0};
+
+static portMUX_TYPE usb_tx_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Delay before offering a refused report to TinyUSB again */
+#define USB_TX_RETRY_US 1000
+
+/**
+ * @brief Hand queued reports to TinyUSB, or signal that a burst drained
+ *
+ * The lock only guards the queue indices; TinyUSB and the completion
+ * callback run outside it. A report TinyUSB refuses stays at the head and
+ * is offered again from the retry timer.
+ */
+static void usb_tx_kick(void)
+{
+    for (;;) {
+        taskENTER_CRITICAL(&usb_tx_lock);
+        if (usb_tx_queue.sending || usb_tx_queue.in_flight) {
+            taskEXIT_CRITICAL(&usb_tx_lock);
+            return;
+        }
+
+        if (usb_tx_queue.head == usb_tx_queue.tail) {
+            bool drained = usb_tx_queue.burst;
+            usb_tx_queue.burst = false;
+            taskEXIT_CRITICAL(&usb_tx_lock);
+
+            if (drained && usb_tx_queue.complete_cb != NULL) {
+                usb_tx_queue.complete_cb();
+            }
+            return;
+        }
+
+        const uint8_t *report = usb_tx_queue.reports[usb_tx_queue.head & (USB_TX_QUEUE_DEPTH - 1)];
+        uint32_t completions = usb_tx_queue.completions;
+        usb_tx_queue.sending = true;
+        taskEXIT_CRITICAL(&usb_tx_lock);
+
+        bool accepted = tud_hid_report(0, report, HAL_USB_REPORT_SIZE);
+
+        taskENTER_CRITICAL(&usb_tx_lock);
+        usb_tx_queue.sending = false;
+        if (accepted) {
+            usb_tx_queue.head++;
+            /* The report may already have completed while we were outside the lock */
+            usb_tx_queue.in_flight = (usb_tx_queue.completions == completions);
+        }
+        bool done = !accepted || usb_tx_queue.in_flight;
+        taskEXIT_CRITICAL(&usb_tx_lock);
+
+        if (!accepted) {
+            /* Endpoint busy or not ready */
+            esp_timer_start_once(usb_tx_queue.retry_timer, USB_TX_RETRY_US);
+        }
+        if (done) {
+            return;
+        }
+    }
+}
+
+static void usb_tx_retry_cb(void *arg)
+{
+    (void) arg;
+    usb_tx_kick();
+}
+
+/**
+ * @brief Copy reports into the FIFO
+ *
+ * @return Number of reports queued
+ */
+static size_t usb_tx_enqueue(const uint8_t *packets, size_t count, bool burst)
+{
+    size_t queued = 0;
+
+    taskENTER_CRITICAL(&usb_tx_lock);
+    while (queued < count && (usb_tx_queue.tail - usb_tx_queue.head) < USB_TX_QUEUE_DEPTH) {
+        memcpy(usb_tx_queue.reports[usb_tx_queue.tail & (USB_TX_QUEUE_DEPTH - 1)],
+               &packets[queued * HAL_USB_REPORT_SIZE], HAL_USB_REPORT_SIZE);
+        usb_tx_queue.tail++;
+        queued++;
+    }
+    if (burst && queued > 0) {
+        usb_tx_queue.burst = true;
+    }
+    taskEXIT_CRITICAL(&usb_tx_lock);
+
+    return queued;
+}
+
+/* TinyUSB: previous IN report has been sent */
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len)
+{
+    (void) instance;
+    (void) report;
+    (void) len;
+
+    taskENTER_CRITICAL(&usb_tx_lock);
+    usb_tx_queue.completions++;
+    usb_tx_queue.in_flight = false;
+    taskEXIT_CRITICAL(&usb_tx_lock);
+
+    usb_tx_kick();
+}
+
 /* LED blink task */
 static void led_blink_task(void *arg)
 {
@@ -149,22 +284,62 @@ int hal_usb_init(void)
         return HAL_ERROR;
     }
 
+    if (usb_tx_queue.retry_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = usb_tx_retry_cb,
+            .name = "usb_tx_retry",
+        };
+        if (esp_timer_create(&timer_args, &usb_tx_queue.retry_timer) != ESP_OK) {
+            return HAL_ERROR;
+        }
+    }
+
     LOG_INFO("USB HID initialized");
     return HAL_OK;
 }
 
 int hal_usb_send(const uint8_t *data, size_t len)
 {
-    if (!hal_esp32_state.initialized || data == NULL) {
+    if (!hal_esp32_state.initialized || data == NULL || len > HAL_USB_REPORT_SIZE) {
+        return HAL_ERROR;
+    }
+
+    /* Queued behind any burst still draining, never interleaved with it */
+    uint8_t report[HAL_USB_REPORT_SIZE] = {0};
+    memcpy(report, data, len);
+    if (usb_tx_enqueue(report, 1, false) == 0) {
+        return HAL_ERROR_BUSY;
+    }
+
+    usb_tx_kick();
+    return (int) len;
+}
+
+int hal_usb_send_burst(const uint8_t *packets, size_t count)
+{
+    if (!hal_esp32_state.initialized || packets == NULL) {
         return HAL_ERROR;
     }
 
-    /* Send via TinyUSB HID */
-    if (tud_hid_report(0, data, len)) {
-        return len;
+    size_t queued = usb_tx_enqueue(packets, count, true);
+
+    /* Start TinyUSB if it is idle; otherwise the complete callback picks up the rest */
+    if (queued > 0) {
+        usb_tx_kick();
     }
 
-    return HAL_ERROR;
+    return (int) queued;
+}
+
+bool hal_usb_tx_pending(void)
+{
+    return usb_tx_queue.in_flight || usb_tx_queue.sending ||
+           (usb_tx_queue.head != usb_tx_queue.tail);
+}
+
+void hal_usb_set_tx_complete_callback(hal_usb_tx_complete_cb_t callback)
+{
+    usb_tx_queue.complete_cb = callback;
 }
 
 int hal_usb_receive(uint8_t *data, size_t max_len, uint32_t timeout_ms)
@@ -267,6 +442,114 @@ size_t hal_flash_get_size(void)
     return 64 * 1024; /* 64KB virtual flash via NVS */
 }
 
+/* ========== Firmware Slots ========== */
+
+/**
+ * @brief Map a slot index onto the ota_0 / ota_1 app partition
+ */
+static const esp_partition_t *fw_slot_partition(uint8_t slot)
+{
+    if (slot >= HAL_FW_SLOT_COUNT) {
+        return NULL;
+    }
+
+    esp_partition_subtype_t subtype =
+        (esp_partition_subtype_t) (ESP_PARTITION_SUBTYPE_APP_OTA_0 + slot);
+    return esp_partition_find_first(ESP_PARTITION_TYPE_APP, subtype, NULL);
+}
+
+/**
+ * @brief Get the slot index of an app partition, or -1 outside the A/B pair
+ */
+static int fw_partition_slot(const esp_partition_t *partition)
+{
+    for (uint8_t slot = 0; slot < HAL_FW_SLOT_COUNT; slot++) {
+        if (partition != NULL && partition == fw_slot_partition(slot)) {
+            return slot;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Look up a slot that may be modified (any but the running one)
+ */
+static const esp_partition_t *fw_writable_partition(uint8_t slot)
+{
+    const esp_partition_t *partition = fw_slot_partition(slot);
+    if (partition == NULL || partition == esp_ota_get_running_partition()) {
+        return NULL;
+    }
+
+    return partition;
+}
+
+int hal_fw_get_slots(hal_fw_slots_t *slots)
+{
+    if (slots == NULL) {
+        return HAL_ERROR;
+    }
+
+    /* A/B updates need the ota_0 / ota_1 partition layout and a running OTA image */
+    const esp_partition_t *slot_a = fw_slot_partition(0);
+    const esp_partition_t *slot_b = fw_slot_partition(1);
+    int active = fw_partition_slot(esp_ota_get_running_partition());
+    if (slot_a == NULL || slot_b == NULL || active < 0) {
+        return HAL_ERROR_NOT_SUPPORTED;
+    }
+
+    int boot = fw_partition_slot(esp_ota_get_boot_partition());
+
+    slots->active = (uint8_t) active;
+    slots->boot = (boot < 0) ? (uint8_t) active : (uint8_t) boot;
+    slots->slot_size = (slot_a->size < slot_b->size) ? slot_a->size : slot_b->size;
+    slots->sector_size = slot_a->erase_size;
+    return HAL_OK;
+}
+
+int hal_fw_read(uint8_t slot, uint32_t offset, uint8_t *data, size_t len)
+{
+    const esp_partition_t *partition = fw_slot_partition(slot);
+    if (partition == NULL || data == NULL) {
+        return HAL_ERROR;
+    }
+
+    return (esp_partition_read(partition, offset, data, len) == ESP_OK) ? HAL_OK : HAL_ERROR;
+}
+
+int hal_fw_write(uint8_t slot, uint32_t offset, const uint8_t *data, size_t len)
+{
+    const esp_partition_t *partition = fw_writable_partition(slot);
+    if (partition == NULL || data == NULL) {
+        return HAL_ERROR;
+    }
+
+    return (esp_partition_write(partition, offset, data, len) == ESP_OK) ? HAL_OK : HAL_ERROR;
+}
+
+int hal_fw_erase(uint8_t slot, uint32_t offset)
+{
+    const esp_partition_t *partition = fw_writable_partition(slot);
+    if (partition == NULL) {
+        return HAL_ERROR;
+    }
+
+    esp_err_t ret = esp_partition_erase_range(partition, offset, partition->erase_size);
+    return (ret == ESP_OK) ? HAL_OK : HAL_ERROR;
+}
+
+int hal_fw_set_boot_slot(uint8_t slot)
+{
+    const esp_partition_t *partition = fw_slot_partition(slot);
+    if (partition == NULL) {
+        return HAL_ERROR;
+    }
+
+    /* Checks the app image header, then flips the otadata sequence number */
+    return (esp_ota_set_boot_partition(partition) == ESP_OK) ? HAL_OK : HAL_ERROR;
+}
+
 /* ========== Random Number Generation ========== */
 
 int hal_random_generate(uint8_t *buffer, size_t len)
@@ -281,6 +564,13 @@ int hal_random_generate(uint8_t *buffer, size_t len)
 
 /* ========== User Presence Detection ========== */
 
+static void IRAM_ATTR button_isr_handler(void *arg)
+{
+    if (hal_esp32_state.button_cb != NULL) {
+        hal_esp32_state.button_cb();
+    }
+}
+
 int hal_button_init(void)
 {
     gpio_config_t io_conf = {
@@ -288,10 +578,26 @@ int hal_button_init(void)
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE, /* Active low: interrupt on press */
     };
 
-    return (gpio_config(&io_conf) == ESP_OK) ? HAL_OK : HAL_ERROR;
+    if (gpio_config(&io_conf) != ESP_OK) {
+        return HAL_ERROR;
+    }
+
+    /* The ISR service may already be installed by another driver */
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return HAL_ERROR;
+    }
+
+    return (gpio_isr_handler_add(BUTTON_GPIO, button_isr_handler, NULL) == ESP_OK) ? HAL_OK
+                                                                                   : HAL_ERROR;
+}
+
+void hal_button_set_callback(hal_button_cb_t callback)
+{
+    hal_esp32_state.button_cb = callback;
 }
 
 hal_button_state_t hal_button_get_state(void)
@@ -349,6 +655,56 @@ int hal_led_init(void)
 int hal_led_set_state(hal_led_state_t state)
 {
     hal_esp32_state.led_state = state;
+
+    /* Steady states apply immediately; blinking follows the LED task */
+    if (state == HAL_LED_ON || state == HAL_LED_OFF) {
+        gpio_set_level(LED_GPIO, (state == HAL_LED_ON) ? 1 : 0);
+    }
+
+    return HAL_OK;
+}
+
+static void led_tick_timer_cb(void *arg)
+{
+    if (hal_esp32_state.led_tick_cb != NULL) {
+        hal_esp32_state.led_tick_cb();
+    }
+}
+
+int hal_led_set_tick_callback(uint32_t period_ms, hal_led_tick_cb_t callback)
+{
+    if (hal_esp32_state.led_tick_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = led_tick_timer_cb,
+            .name = "led_tick",
+        };
+        if (esp_timer_create(&timer_args, &hal_esp32_state.led_tick_timer) != ESP_OK) {
+            return HAL_ERROR;
+        }
+    } else {
+        esp_timer_stop(hal_esp32_state.led_tick_timer);
+    }
+
+    hal_esp32_state.led_tick_cb = callback;
+
+    if (callback == NULL) {
+        /* Hand the LED back to the blink task */
+        if (hal_esp32_state.led_task_handle != NULL) {
+            vTaskResume(hal_esp32_state.led_task_handle);
+        }
+        return HAL_OK;
+    }
+
+    /* The tick callback owns the LED; keep the blink task from fighting it */
+    if (hal_esp32_state.led_task_handle != NULL) {
+        vTaskSuspend(hal_esp32_state.led_task_handle);
+    }
+
+    if (esp_timer_start_periodic(hal_esp32_state.led_tick_timer, (uint64_t) period_ms * 1000) !=
+        ESP_OK) {
+        return HAL_ERROR;
+    }
+
     return HAL_OK;
 }
 
@@ -372,6 +728,27 @@ int hal_crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8
     return HAL_ERROR_NOT_SUPPORTED;
 }
 
+int hal_get_device_secret(uint8_t *secret, size_t *len)
+{
+#if SOC_HMAC_SUPPORTED
+    /* HMAC peripheral keyed from eFuse; the key itself is never readable */
+    static const char label[] = "openfido device secret";
+
+    if (secret == NULL || len == NULL || *len < 32) {
+        return HAL_ERROR;
+    }
+
+    if (esp_hmac_calculate(HMAC_KEY0, label, sizeof(label) - 1, secret) != ESP_OK) {
+        return HAL_ERROR_NOT_SUPPORTED;
+    }
+
+    *len = 32;
+    return HAL_OK;
+#else
+    return HAL_ERROR_NOT_SUPPORTED;
+#endif
+}
+
 /* ========== Time Functions ========== */
 
 uint64_t hal_get_timestamp_ms(void)
@@ -379,6 +756,21 @@ uint64_t hal_get_timestamp_ms(void)
     return esp_timer_get_time() / 1000;
 }
 
+uint64_t hal_get_timestamp_us(void)
+{
+    return esp_timer_get_time();
+}
+
+uint32_t hal_cycle_count(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+
+uint32_t hal_cycle_frequency(void)
+{
+    return esp_rom_get_cpu_ticks_per_us() * 1000000;
+}
+
 void hal_delay_ms(uint32_t ms)
 {
     vTaskDelay(pdMS_TO_TICKS(ms));
@@ -398,4 +790,86 @@ int hal_watchdog_feed(void)
     return HAL_OK;
 }
 
+/* ========== Retention Memory Functions ========== */
+
+/* RTC slow memory stays powered in deep sleep and is not cleared on wake */
+static RTC_NOINIT_ATTR uint8_t retention_ram[HAL_RETENTION_SIZE];
+
+int hal_retention_write(const uint8_t *data, size_t len)
+{
+    if (data == NULL || len > HAL_RETENTION_SIZE) {
+        return HAL_ERROR;
+    }
+
+    memcpy(retention_ram, data, len);
+    return HAL_OK;
+}
+
+int hal_retention_read(uint8_t *data, size_t len)
+{
+    if (data == NULL || len > HAL_RETENTION_SIZE) {
+        return HAL_ERROR;
+    }
+
+    memcpy(data, retention_ram, len);
+    return HAL_OK;
+}
+
+void hal_retention_clear(void)
+{
+    memset(retention_ram, 0, sizeof(retention_ram));
+}
+
+/* ========== Multicore Functions ========== */
+
+#define CORE1_TASK_STACK_SIZE 8192
+#define CORE1_TASK_PRIORITY 5
+
+static TaskHandle_t core1_task_handle = NULL;
+
+static void core1_task(void *arg)
+{
+    hal_core_entry_t entry = (hal_core_entry_t) arg;
+    entry();
+    vTaskDelete(NULL);
+}
+
+int hal_core_launch(hal_core_entry_t entry)
+{
+#if portNUM_PROCESSORS > 1
+    if (entry == NULL || core1_task_handle != NULL) {
+        return HAL_ERROR;
+    }
+
+    if (xTaskCreatePinnedToCore(core1_task, "openfido_core1", CORE1_TASK_STACK_SIZE,
+                                (void *) entry, CORE1_TASK_PRIORITY, &core1_task_handle,
+                                1) != pdPASS) {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+#else
+    (void) entry;
+    return HAL_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+void hal_core_signal(void)
+{
+    if (core1_task_handle != NULL) {
+        xTaskNotifyGive(core1_task_handle);
+    }
+}
+
+void hal_core_wait(uint32_t timeout_ms)
+{
+    /* The notification count keeps a signal sent before the wait */
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms));
+}
+
+uint32_t hal_core_id(void)
+{
+    return xPortGetCoreID();
+}
+
 #endif /* ESP_PLATFORM */
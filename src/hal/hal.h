@@ -38,6 +38,32 @@ typedef enum {
 /* Button States */
 typedef enum { HAL_BUTTON_RELEASED = 0, HAL_BUTTON_PRESSED } hal_button_state_t;
 
+/* USB HID report size (full-speed interrupt endpoint) */
+#define HAL_USB_REPORT_SIZE 64
+
+/**
+ * @brief USB transmit completion callback
+ *
+ * Invoked (possibly from interrupt context) once every report queued with
+ * hal_usb_send_burst() has been accepted by the host.
+ */
+typedef void (*hal_usb_tx_complete_cb_t)(void);
+
+/**
+ * @brief Button press callback
+ *
+ * Invoked from interrupt context on each press edge of the user-presence
+ * button. Must not block.
+ */
+typedef void (*hal_button_cb_t)(void);
+
+/**
+ * @brief LED tick callback
+ *
+ * Invoked from timer context at a fixed period to animate the LED.
+ */
+typedef void (*hal_led_tick_cb_t)(void);
+
 /**
  * @brief Initialize the hardware platform
  *
@@ -70,6 +96,36 @@ int hal_usb_init(void);
  */
 int hal_usb_send(const uint8_t *data, size_t len);
 
+/**
+ * @brief Queue several HID reports for transmission in one call
+ *
+ * Copies up to @p count reports into the endpoint transmit FIFO and returns
+ * without waiting for the host to poll them. Transmission continues from the
+ * endpoint completion interrupt, so back-to-back reports go out at line rate.
+ * If the FIFO fills up, fewer than @p count reports are queued and the caller
+ * should resubmit the remainder.
+ *
+ * @param packets Contiguous array of count * HAL_USB_REPORT_SIZE bytes
+ * @param count Number of reports
+ * @return Number of reports queued, or negative error code
+ *         (HAL_ERROR_NOT_SUPPORTED if the platform has no transmit FIFO)
+ */
+int hal_usb_send_burst(const uint8_t *packets, size_t count);
+
+/**
+ * @brief Check whether queued reports are still waiting to be sent
+ *
+ * @return true if the transmit FIFO is not empty
+ */
+bool hal_usb_tx_pending(void);
+
+/**
+ * @brief Register transmit completion callback
+ *
+ * @param callback Called when the transmit FIFO drains (NULL to disable)
+ */
+void hal_usb_set_tx_complete_callback(hal_usb_tx_complete_cb_t callback);
+
 /**
  * @brief Receive data from USB HID
  *
@@ -131,6 +187,75 @@ int hal_flash_erase(uint32_t offset);
  */
 size_t hal_flash_get_size(void);
 
+/* ========== Firmware Slots ========== */
+
+/* Number of firmware image slots (A/B) */
+#define HAL_FW_SLOT_COUNT 2
+
+/**
+ * @brief Firmware slot layout
+ */
+typedef struct {
+    uint8_t active;     /* Slot the running image was booted from */
+    uint8_t boot;       /* Slot selected for the next boot */
+    size_t slot_size;   /* Bytes per slot */
+    size_t sector_size; /* Erase granule within a slot */
+} hal_fw_slots_t;
+
+/**
+ * @brief Get the firmware slot layout
+ *
+ * @param slots Output layout
+ * @return HAL_OK on success, HAL_ERROR_NOT_SUPPORTED without A/B slots
+ */
+int hal_fw_get_slots(hal_fw_slots_t *slots);
+
+/**
+ * @brief Read from a firmware slot
+ *
+ * @param slot Slot index
+ * @param offset Offset within the slot
+ * @param data Pointer to read buffer
+ * @param len Length to read
+ * @return HAL_OK on success, error code otherwise
+ */
+int hal_fw_read(uint8_t slot, uint32_t offset, uint8_t *data, size_t len);
+
+/**
+ * @brief Program an erased region of a firmware slot
+ *
+ * The active slot is refused.
+ *
+ * @param slot Slot index
+ * @param offset Offset within the slot, aligned to the program granule
+ * @param data Pointer to data to write
+ * @param len Length to write
+ * @return HAL_OK on success, error code otherwise
+ */
+int hal_fw_write(uint8_t slot, uint32_t offset, const uint8_t *data, size_t len);
+
+/**
+ * @brief Erase one sector of a firmware slot
+ *
+ * The active slot is refused.
+ *
+ * @param slot Slot index
+ * @param offset Sector-aligned offset within the slot
+ * @return HAL_OK on success, error code otherwise
+ */
+int hal_fw_erase(uint8_t slot, uint32_t offset);
+
+/**
+ * @brief Select the slot to boot next
+ *
+ * A single atomic update of the boot selector: a power cut leaves either
+ * the old or the new slot selected, never neither.
+ *
+ * @param slot Slot index
+ * @return HAL_OK on success, error code otherwise
+ */
+int hal_fw_set_boot_slot(uint8_t slot);
+
 /* ========== Random Number Generation ========== */
 
 /**
@@ -166,6 +291,16 @@ hal_button_state_t hal_button_get_state(void);
  */
 bool hal_button_wait_press(uint32_t timeout_ms);
 
+/**
+ * @brief Register button press callback
+ *
+ * Lets user-presence checks complete from the button interrupt instead of
+ * blocking in hal_button_wait_press().
+ *
+ * @param callback Called on each press (NULL to disable)
+ */
+void hal_button_set_callback(hal_button_cb_t callback);
+
 /* ========== LED Indicator ========== */
 
 /**
@@ -183,6 +318,19 @@ int hal_led_init(void);
  */
 int hal_led_set_state(hal_led_state_t state);
 
+/**
+ * @brief Run an LED tick callback from a periodic hardware timer
+ *
+ * Lets LED patterns animate without main-loop involvement. Once a callback is
+ * registered it owns the LED and drives it with HAL_LED_ON / HAL_LED_OFF,
+ * which take effect immediately.
+ *
+ * @param period_ms Tick period in milliseconds
+ * @param callback Tick callback (NULL to stop the timer)
+ * @return HAL_OK on success, HAL_ERROR_NOT_SUPPORTED if no timer is available
+ */
+int hal_led_set_tick_callback(uint32_t period_ms, hal_led_tick_cb_t callback);
+
 /* ========== Cryptographic Acceleration (Optional) ========== */
 
 /**
@@ -212,6 +360,24 @@ int hal_crypto_sha256(const uint8_t *data, size_t len, uint8_t *hash);
  */
 int hal_crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8_t *signature);
 
+/**
+ * @brief Read the device-unique hardware secret
+ *
+ * A per-chip value fixed at manufacture (eFuse key, factory information
+ * registers, unique ID). It is mixed into the root of the device key
+ * hierarchy so that a flash image copied to another chip does not decrypt.
+ *
+ * Only some platforms return an actual secret. The ESP32 HMAC key stays in
+ * read-protected eFuse; the nRF52 FICR roots are readable by any code on the
+ * chip; the STM32 unique ID is readable by anyone with code execution or a
+ * debug probe, and so adds chip binding but no secrecy.
+ *
+ * @param secret Output buffer
+ * @param len Input: buffer size; output: bytes written
+ * @return HAL_OK on success, HAL_ERROR_NOT_SUPPORTED if the platform has none
+ */
+int hal_get_device_secret(uint8_t *secret, size_t *len);
+
 /* ========== Time Functions ========== */
 
 /**
@@ -221,6 +387,32 @@ int hal_crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8
  */
 uint64_t hal_get_timestamp_ms(void);
 
+/**
+ * @brief Get current timestamp in microseconds
+ *
+ * Fine-grained clock for tracing; same epoch rules as hal_get_timestamp_ms().
+ *
+ * @return Timestamp in microseconds
+ */
+uint64_t hal_get_timestamp_us(void);
+
+/**
+ * @brief Read the CPU cycle counter of the calling core
+ *
+ * Free-running; wraps at 2^32, so the difference of two reads is valid as
+ * long as they are less than one wrap apart.
+ *
+ * @return Cycle count
+ */
+uint32_t hal_cycle_count(void);
+
+/**
+ * @brief Get the rate of hal_cycle_count()
+ *
+ * @return Counts per second
+ */
+uint32_t hal_cycle_frequency(void);
+
 /**
  * @brief Delay for specified milliseconds
  *
@@ -273,6 +465,77 @@ int hal_wake_from_sleep(void);
  */
 bool hal_is_wake_from_sleep(void);
 
+/* ========== Retention Memory Functions ========== */
+
+/* Size of the retention region kept powered during deep sleep */
+#define HAL_RETENTION_SIZE 1024
+
+/**
+ * @brief Write to retention memory
+ *
+ * Retention memory survives deep sleep but not a power loss. It holds the
+ * warm-state snapshot used to resume without rebuilding session state.
+ *
+ * @param data Data to store
+ * @param len Length of data (at most HAL_RETENTION_SIZE)
+ * @return HAL_OK on success, error code otherwise
+ */
+int hal_retention_write(const uint8_t *data, size_t len);
+
+/**
+ * @brief Read from retention memory
+ *
+ * @param data Output buffer
+ * @param len Number of bytes to read (at most HAL_RETENTION_SIZE)
+ * @return HAL_OK on success, error code otherwise
+ */
+int hal_retention_read(uint8_t *data, size_t len);
+
+/**
+ * @brief Wipe retention memory
+ */
+void hal_retention_clear(void);
+
+/* ========== Multicore Functions ========== */
+
+/**
+ * @brief Entry point of the second core
+ *
+ * Runs forever; it never returns.
+ */
+typedef void (*hal_core_entry_t)(void);
+
+/**
+ * @brief Start the second core
+ *
+ * @param entry Function the second core runs
+ * @return HAL_OK on success, HAL_ERROR_NOT_SUPPORTED on single-core parts,
+ *         error code otherwise
+ */
+int hal_core_launch(hal_core_entry_t entry);
+
+/**
+ * @brief Wake the second core from hal_core_wait()
+ *
+ * A signal sent while the second core is not waiting is kept, so the next
+ * wait returns at once.
+ */
+void hal_core_signal(void);
+
+/**
+ * @brief Sleep on the second core until signalled
+ *
+ * @param timeout_ms Longest time to sleep
+ */
+void hal_core_wait(uint32_t timeout_ms);
+
+/**
+ * @brief Get the core the caller runs on
+ *
+ * @return 0 on the first core, 1 on the second
+ */
+uint32_t hal_core_id(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,449 @@
+/**
+ * @file hal_host.c
+ * @brief Host Hardware Abstraction Layer Implementation
+ *
+ * Backs libopenfido: flash and retention memory are RAM buffers of the
+ * device bound to the calling thread, and there is no USB, LED or sleep.
+ * The second core is emulated with a thread that shares the device of the
+ * thread that launched it.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "hal_host.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HOST_FLASH_SECTOR_SIZE 4096
+
+/* Host "cycles" are 10 ns ticks, so a count wraps after about 43 s */
+#define HOST_CYCLE_HZ 100000000
+
+/* Device of the calling thread */
+static _Thread_local hal_host_device_t *host_device = NULL;
+
+/* Set on the thread emulating the second core */
+static _Thread_local bool host_second_core = false;
+
+void hal_host_bind(hal_host_device_t *device)
+{
+    host_device = device;
+}
+
+int hal_init(void)
+{
+    return (host_device != NULL) ? HAL_OK : HAL_ERROR;
+}
+
+int hal_deinit(void)
+{
+    return HAL_OK;
+}
+
+int hal_usb_init(void)
+{
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_usb_send(const uint8_t *data, size_t len)
+{
+    (void) data;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_usb_send_burst(const uint8_t *packets, size_t count)
+{
+    (void) packets;
+    (void) count;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+bool hal_usb_tx_pending(void)
+{
+    return false;
+}
+
+void hal_usb_set_tx_complete_callback(hal_usb_tx_complete_cb_t callback)
+{
+    (void) callback;
+}
+
+int hal_usb_receive(uint8_t *data, size_t max_len, uint32_t timeout_ms)
+{
+    (void) data;
+    (void) max_len;
+    (void) timeout_ms;
+    return 0;
+}
+
+bool hal_usb_is_connected(void)
+{
+    return false;
+}
+
+int hal_flash_init(void)
+{
+    return (host_device != NULL) ? HAL_OK : HAL_ERROR;
+}
+
+int hal_flash_read(uint32_t offset, uint8_t *data, size_t len)
+{
+    if (host_device == NULL || data == NULL || offset + len > host_device->flash_size) {
+        return HAL_ERROR;
+    }
+
+    memcpy(data, &host_device->flash[offset], len);
+    return HAL_OK;
+}
+
+int hal_flash_write(uint32_t offset, const uint8_t *data, size_t len)
+{
+    if (host_device == NULL || data == NULL || offset + len > host_device->flash_size) {
+        return HAL_ERROR;
+    }
+
+    memcpy(&host_device->flash[offset], data, len);
+    return HAL_OK;
+}
+
+int hal_flash_erase(uint32_t offset)
+{
+    if (host_device == NULL || offset + HOST_FLASH_SECTOR_SIZE > host_device->flash_size) {
+        return HAL_ERROR;
+    }
+
+    offset -= offset % HOST_FLASH_SECTOR_SIZE;
+    memset(&host_device->flash[offset], 0xFF, HOST_FLASH_SECTOR_SIZE);
+    return HAL_OK;
+}
+
+size_t hal_flash_get_size(void)
+{
+    return (host_device != NULL) ? host_device->flash_size : 0;
+}
+
+/* ========== Firmware Slots ========== */
+
+/* Virtual authenticators have no firmware image */
+int hal_fw_get_slots(hal_fw_slots_t *slots)
+{
+    (void) slots;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_read(uint8_t slot, uint32_t offset, uint8_t *data, size_t len)
+{
+    (void) slot;
+    (void) offset;
+    (void) data;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_write(uint8_t slot, uint32_t offset, const uint8_t *data, size_t len)
+{
+    (void) slot;
+    (void) offset;
+    (void) data;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_erase(uint8_t slot, uint32_t offset)
+{
+    (void) slot;
+    (void) offset;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_set_boot_slot(uint8_t slot)
+{
+    (void) slot;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_random_generate(uint8_t *buffer, size_t len)
+{
+    if (buffer == NULL) {
+        return HAL_ERROR;
+    }
+
+    if (host_device != NULL && host_device->ops.random != NULL) {
+        return (host_device->ops.random(host_device->user, buffer, len) == 0) ? HAL_OK
+                                                                             : HAL_ERROR;
+    }
+
+    /* getentropy() serves at most 256 bytes per call */
+    while (len > 0) {
+        size_t n = (len > 256) ? 256 : len;
+        if (getentropy(buffer, n) != 0) {
+            return HAL_ERROR;
+        }
+        buffer += n;
+        len -= n;
+    }
+
+    return HAL_OK;
+}
+
+int hal_button_init(void)
+{
+    return HAL_OK;
+}
+
+hal_button_state_t hal_button_get_state(void)
+{
+    if (host_device != NULL && host_device->ops.user_present != NULL &&
+        !host_device->ops.user_present(host_device->user)) {
+        return HAL_BUTTON_RELEASED;
+    }
+
+    return HAL_BUTTON_PRESSED;
+}
+
+bool hal_button_wait_press(uint32_t timeout_ms)
+{
+    uint64_t deadline = hal_get_timestamp_ms() + timeout_ms;
+
+    while (hal_button_get_state() != HAL_BUTTON_PRESSED) {
+        if (hal_get_timestamp_ms() >= deadline) {
+            return false;
+        }
+        hal_delay_ms(5);
+    }
+
+    return true;
+}
+
+void hal_button_set_callback(hal_button_cb_t callback)
+{
+    /* Presence is level-polled through hal_button_get_state() */
+    (void) callback;
+}
+
+int hal_led_init(void)
+{
+    return HAL_OK;
+}
+
+int hal_led_set_state(hal_led_state_t state)
+{
+    (void) state;
+    return HAL_OK;
+}
+
+int hal_led_set_tick_callback(uint32_t period_ms, hal_led_tick_cb_t callback)
+{
+    (void) period_ms;
+    (void) callback;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+bool hal_crypto_is_available(void)
+{
+    return false;
+}
+
+int hal_crypto_sha256(const uint8_t *data, size_t len, uint8_t *hash)
+{
+    (void) data;
+    (void) len;
+    (void) hash;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8_t *signature)
+{
+    (void) private_key;
+    (void) hash;
+    (void) signature;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_get_device_secret(uint8_t *secret, size_t *len)
+{
+    (void) secret;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+uint64_t hal_get_timestamp_ms(void)
+{
+    if (host_device != NULL && host_device->ops.timestamp_ms != NULL) {
+        return host_device->ops.timestamp_ms(host_device->user);
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
+
+uint64_t hal_get_timestamp_us(void)
+{
+    if (host_device != NULL && host_device->ops.timestamp_ms != NULL) {
+        return host_device->ops.timestamp_ms(host_device->user) * 1000;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+uint32_t hal_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (((uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec) / 10);
+}
+
+uint32_t hal_cycle_frequency(void)
+{
+    return HOST_CYCLE_HZ;
+}
+
+void hal_delay_ms(uint32_t ms)
+{
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (long) (ms % 1000) * 1000000};
+    nanosleep(&ts, NULL);
+}
+
+int hal_watchdog_init(uint32_t timeout_ms)
+{
+    (void) timeout_ms;
+    return HAL_OK;
+}
+
+int hal_watchdog_feed(void)
+{
+    return HAL_OK;
+}
+
+int hal_enter_deep_sleep(void)
+{
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_wake_from_sleep(void)
+{
+    return HAL_OK;
+}
+
+bool hal_is_wake_from_sleep(void)
+{
+    return false;
+}
+
+int hal_retention_write(const uint8_t *data, size_t len)
+{
+    if (host_device == NULL || data == NULL || len > sizeof(host_device->retention)) {
+        return HAL_ERROR;
+    }
+
+    memcpy(host_device->retention, data, len);
+    return HAL_OK;
+}
+
+int hal_retention_read(uint8_t *data, size_t len)
+{
+    if (host_device == NULL || data == NULL || len > sizeof(host_device->retention)) {
+        return HAL_ERROR;
+    }
+
+    memcpy(data, host_device->retention, len);
+    return HAL_OK;
+}
+
+void hal_retention_clear(void)
+{
+    if (host_device != NULL) {
+        memset(host_device->retention, 0, sizeof(host_device->retention));
+    }
+}
+
+/* Second-core emulation: a thread woken through a condition variable */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool signalled;
+} host_core = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, false};
+
+typedef struct {
+    hal_core_entry_t entry;
+    hal_host_device_t *device;
+} host_core_start_t;
+
+static void *host_core_main(void *arg)
+{
+    host_core_start_t start = *(host_core_start_t *) arg;
+    free(arg);
+
+    hal_host_bind(start.device);
+    host_second_core = true;
+    start.entry();
+    return NULL;
+}
+
+int hal_core_launch(hal_core_entry_t entry)
+{
+    if (entry == NULL) {
+        return HAL_ERROR;
+    }
+
+    host_core_start_t *start = malloc(sizeof(*start));
+    if (start == NULL) {
+        return HAL_ERROR;
+    }
+    start->entry = entry;
+    start->device = host_device;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, host_core_main, start) != 0) {
+        free(start);
+        return HAL_ERROR;
+    }
+    pthread_detach(thread);
+
+    return HAL_OK;
+}
+
+void hal_core_signal(void)
+{
+    pthread_mutex_lock(&host_core.lock);
+    host_core.signalled = true;
+    pthread_cond_signal(&host_core.cond);
+    pthread_mutex_unlock(&host_core.lock);
+}
+
+void hal_core_wait(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&host_core.lock);
+    while (!host_core.signalled) {
+        if (pthread_cond_timedwait(&host_core.cond, &host_core.lock, &deadline) != 0) {
+            break;
+        }
+    }
+    host_core.signalled = false;
+    pthread_mutex_unlock(&host_core.lock);
+}
+
+uint32_t hal_core_id(void)
+{
+    return host_second_core ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file hal_host.h
+ * @brief Host HAL Device Binding
+ *
+ * The host HAL serves each thread from the virtual device bound to it, so
+ * every libopenfido context has its own flash, retention memory and
+ * callbacks.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+#include "openfido.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Virtual device backing the HAL
+ */
+typedef struct {
+    uint8_t *flash;                          /**< Flash image (erased to 0xFF) */
+    size_t flash_size;                       /**< Size of the flash image */
+    uint8_t retention[HAL_RETENTION_SIZE];   /**< Retention memory */
+    openfido_hal_ops_t ops;                  /**< Device callbacks */
+    void *user;                              /**< Passed to the callbacks */
+} hal_host_device_t;
+
+/**
+ * @brief Bind a device to the calling thread
+ *
+ * @param device Device, or NULL to unbind
+ */
+void hal_host_bind(hal_host_device_t *device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_HOST_H */
@@ -13,12 +13,15 @@
 
 #ifdef NRF52
 
+#include <string.h>
+
 #include "app_timer.h"
 #include "app_usbd.h"
 #include "app_usbd_hid_generic.h"
 #include "nrf.h"
 #include "nrf_delay.h"
 #include "nrf_drv_clock.h"
+#include "nrf_drv_gpiote.h"
 #include "nrf_drv_rng.h"
 #include "nrf_drv_usbd.h"
 #include "nrf_gpio.h"
@@ -37,6 +40,8 @@ static struct {
     bool initialized;
     hal_led_state_t led_state;
     app_timer_id_t led_timer;
+    hal_button_cb_t button_cb;
+    hal_led_tick_cb_t led_tick_cb;
 } hal_nrf52_state = {0};
 
 /* LED timer callback */
@@ -44,6 +49,12 @@ static void led_timer_handler(void *p_context)
 {
     static bool led_on = false;
 
+    /* A registered tick callback owns the LED */
+    if (hal_nrf52_state.led_tick_cb != NULL) {
+        hal_nrf52_state.led_tick_cb();
+        return;
+    }
+
     switch (hal_nrf52_state.led_state) {
         case HAL_LED_OFF:
             nrf_gpio_pin_clear(LED_PIN);
@@ -78,6 +89,11 @@ int hal_init(void)
 
     nrf_drv_clock_lfclk_request(NULL);
 
+    /* Start the DWT cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     /* Initialize app timer */
     ret = app_timer_init();
     if (ret != NRF_SUCCESS) {
@@ -135,6 +151,24 @@ int hal_usb_send(const uint8_t *data, size_t len)
     return len;
 }
 
+int hal_usb_send_burst(const uint8_t *packets, size_t count)
+{
+    /* No HID class instance reports IN completion yet, so reports go out one by one */
+    (void) packets;
+    (void) count;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+bool hal_usb_tx_pending(void)
+{
+    return false;
+}
+
+void hal_usb_set_tx_complete_callback(hal_usb_tx_complete_cb_t callback)
+{
+    (void) callback;
+}
+
 int hal_usb_receive(uint8_t *data, size_t max_len, uint32_t timeout_ms)
 {
     if (!hal_nrf52_state.initialized || data == NULL) {
@@ -231,6 +265,46 @@ size_t hal_flash_get_size(void)
     return FLASH_USER_SIZE;
 }
 
+/* ========== Firmware Slots ========== */
+
+/* Images are replaced by the Nordic DFU bootloader, which owns the bank layout */
+int hal_fw_get_slots(hal_fw_slots_t *slots)
+{
+    (void) slots;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_read(uint8_t slot, uint32_t offset, uint8_t *data, size_t len)
+{
+    (void) slot;
+    (void) offset;
+    (void) data;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_write(uint8_t slot, uint32_t offset, const uint8_t *data, size_t len)
+{
+    (void) slot;
+    (void) offset;
+    (void) data;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_erase(uint8_t slot, uint32_t offset)
+{
+    (void) slot;
+    (void) offset;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_set_boot_slot(uint8_t slot)
+{
+    (void) slot;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
 /* ========== Random Number Generation ========== */
 
 int hal_random_generate(uint8_t *buffer, size_t len)
@@ -273,12 +347,36 @@ int hal_random_generate(uint8_t *buffer, size_t len)
 
 /* ========== User Presence Detection ========== */
 
+static void button_event_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    if (pin == BUTTON_PIN && hal_nrf52_state.button_cb != NULL) {
+        hal_nrf52_state.button_cb();
+    }
+}
+
 int hal_button_init(void)
 {
-    nrf_gpio_cfg_input(BUTTON_PIN, NRF_GPIO_PIN_PULLUP);
+    if (!nrf_drv_gpiote_is_init() && nrf_drv_gpiote_init() != NRF_SUCCESS) {
+        return HAL_ERROR;
+    }
+
+    /* Active low: sense the high-to-low edge on press */
+    nrf_drv_gpiote_in_config_t config = GPIOTE_CONFIG_IN_SENSE_HITOLO(true);
+    config.pull = NRF_GPIO_PIN_PULLUP;
+
+    if (nrf_drv_gpiote_in_init(BUTTON_PIN, &config, button_event_handler) != NRF_SUCCESS) {
+        return HAL_ERROR;
+    }
+
+    nrf_drv_gpiote_in_event_enable(BUTTON_PIN, true);
     return HAL_OK;
 }
 
+void hal_button_set_callback(hal_button_cb_t callback)
+{
+    hal_nrf52_state.button_cb = callback;
+}
+
 hal_button_state_t hal_button_get_state(void)
 {
     /* Button is active low */
@@ -376,6 +474,32 @@ int hal_led_init(void)
 int hal_led_set_state(hal_led_state_t state)
 {
     hal_nrf52_state.led_state = state;
+
+    /* Steady states apply immediately; blinking follows the LED timer */
+    if (state == HAL_LED_ON) {
+        nrf_gpio_pin_set(LED_PIN);
+    } else if (state == HAL_LED_OFF) {
+        nrf_gpio_pin_clear(LED_PIN);
+    }
+
+    return HAL_OK;
+}
+
+int hal_led_set_tick_callback(uint32_t period_ms, hal_led_tick_cb_t callback)
+{
+    /* Reuse the LED app timer at the requested period */
+    if (app_timer_stop(hal_nrf52_state.led_timer) != NRF_SUCCESS) {
+        return HAL_ERROR;
+    }
+
+    hal_nrf52_state.led_tick_cb = callback;
+
+    uint32_t tick_ms = (callback != NULL) ? period_ms : CONFIG_LED_BLINK_FAST_MS;
+    if (app_timer_start(hal_nrf52_state.led_timer, APP_TIMER_TICKS(tick_ms), NULL) !=
+        NRF_SUCCESS) {
+        return HAL_ERROR;
+    }
+
     return HAL_OK;
 }
 
@@ -400,6 +524,24 @@ int hal_crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8
     return HAL_ERROR_NOT_SUPPORTED;
 }
 
+int hal_get_device_secret(uint8_t *secret, size_t *len)
+{
+    /* Random encryption and identity roots programmed into FICR at the factory */
+    if (secret == NULL || len == NULL || *len < 32) {
+        return HAL_ERROR;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t er = NRF_FICR->ER[i];
+        uint32_t ir = NRF_FICR->IR[i];
+        memcpy(&secret[i * 4], &er, 4);
+        memcpy(&secret[16 + i * 4], &ir, 4);
+    }
+
+    *len = 32;
+    return HAL_OK;
+}
+
 /* ========== Time Functions ========== */
 
 uint64_t hal_get_timestamp_ms(void)
@@ -407,6 +549,22 @@ uint64_t hal_get_timestamp_ms(void)
     return app_timer_cnt_get() / 32.768; /* Assuming 32.768 kHz clock */
 }
 
+uint64_t hal_get_timestamp_us(void)
+{
+    /* RTC ticks are 30.5 us apart */
+    return ((uint64_t) app_timer_cnt_get() * 1000000) >> 15;
+}
+
+uint32_t hal_cycle_count(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t hal_cycle_frequency(void)
+{
+    return SystemCoreClock;
+}
+
 void hal_delay_ms(uint32_t ms)
 {
     nrf_delay_ms(ms);
@@ -432,4 +590,57 @@ int hal_watchdog_feed(void)
     return HAL_OK;
 }
 
+/* ========== Retention Memory Functions ========== */
+
+/* Placed in .noinit so the startup code does not clear it; System ON sleep retains it */
+static uint8_t retention_ram[HAL_RETENTION_SIZE] __attribute__((section(".noinit")));
+
+int hal_retention_write(const uint8_t *data, size_t len)
+{
+    if (data == NULL || len > HAL_RETENTION_SIZE) {
+        return HAL_ERROR;
+    }
+
+    memcpy(retention_ram, data, len);
+    return HAL_OK;
+}
+
+int hal_retention_read(uint8_t *data, size_t len)
+{
+    if (data == NULL || len > HAL_RETENTION_SIZE) {
+        return HAL_ERROR;
+    }
+
+    memcpy(data, retention_ram, len);
+    return HAL_OK;
+}
+
+void hal_retention_clear(void)
+{
+    memset(retention_ram, 0, sizeof(retention_ram));
+}
+
+/* ========== Multicore Functions ========== */
+
+int hal_core_launch(hal_core_entry_t entry)
+{
+    /* Single core: requests run inline on the main loop */
+    (void) entry;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+void hal_core_signal(void)
+{
+}
+
+void hal_core_wait(uint32_t timeout_ms)
+{
+    hal_delay_ms(timeout_ms);
+}
+
+uint32_t hal_core_id(void)
+{
+    return 0;
+}
+
 #endif /* NRF52 */
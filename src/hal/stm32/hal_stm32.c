@@ -29,6 +29,9 @@
 #define FLASH_USER_START_ADDR 0x08010000 /* Sector 4 */
 #define FLASH_USER_END_ADDR 0x0801FFFF
 
+/* USB transmit FIFO depth in reports (must be a power of two) */
+#define USB_TX_QUEUE_DEPTH 32
+
 /* Global state */
 static struct {
     bool initialized;
@@ -36,8 +39,59 @@ static struct {
     RNG_HandleTypeDef hrng;
     hal_led_state_t led_state;
     uint32_t led_last_toggle;
+    hal_button_cb_t button_cb;
+    TIM_HandleTypeDef led_timer;
+    hal_led_tick_cb_t led_tick_cb;
 } hal_stm32_state = {0};
 
+/* USB transmit FIFO, drained from the HID IN endpoint completion interrupt */
+static struct {
+    uint8_t reports[USB_TX_QUEUE_DEPTH][HAL_USB_REPORT_SIZE];
+    volatile uint32_t head; /* Next report to hand to the endpoint */
+    volatile uint32_t tail; /* Next free slot */
+    volatile bool in_flight;
+    hal_usb_tx_complete_cb_t complete_cb;
+} usb_tx_queue = {0};
+
+/* Hand the next queued report to the endpoint, or signal completion */
+static void usb_tx_kick(void)
+{
+    if (usb_tx_queue.head == usb_tx_queue.tail) {
+        /* DataIn also follows plain hal_usb_send() reports */
+        bool drained = usb_tx_queue.in_flight;
+        usb_tx_queue.in_flight = false;
+        if (drained && usb_tx_queue.complete_cb != NULL) {
+            usb_tx_queue.complete_cb();
+        }
+        return;
+    }
+
+    /* Only a report the endpoint accepted produces a DataIn interrupt */
+    uint8_t *report = usb_tx_queue.reports[usb_tx_queue.head & (USB_TX_QUEUE_DEPTH - 1)];
+    if (USBD_HID_SendReport(&hal_stm32_state.usb_device, report, HAL_USB_REPORT_SIZE) == USBD_OK) {
+        usb_tx_queue.in_flight = true;
+        usb_tx_queue.head++;
+    } else {
+        usb_tx_queue.in_flight = false;
+    }
+}
+
+/* HID class with its DataIn stage chained to the transmit FIFO */
+static USBD_ClassTypeDef usb_hid_class;
+
+/**
+ * @brief HID IN endpoint transfer complete
+ *
+ * Lets the stock class driver return the endpoint to idle, then hands it
+ * the next queued report.
+ */
+static uint8_t usb_hid_data_in(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+    uint8_t ret = USBD_HID.DataIn(pdev, epnum);
+    usb_tx_kick();
+    return ret;
+}
+
 int hal_init(void)
 {
     LOG_INFO("Initializing STM32 HAL");
@@ -47,6 +101,11 @@ int hal_init(void)
 
     /* Configure system clock (should be done in SystemClock_Config) */
 
+    /* Start the DWT cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     hal_stm32_state.initialized = true;
     LOG_INFO("STM32 HAL initialized");
 
@@ -69,7 +128,9 @@ int hal_usb_init(void)
     USBD_Init(&hal_stm32_state.usb_device, &HID_Desc, 0);
 
     /* Add HID Class */
-    USBD_RegisterClass(&hal_stm32_state.usb_device, &USBD_HID);
+    usb_hid_class = USBD_HID;
+    usb_hid_class.DataIn = usb_hid_data_in;
+    USBD_RegisterClass(&hal_stm32_state.usb_device, &usb_hid_class);
 
     /* Start Device */
     USBD_Start(&hal_stm32_state.usb_device);
@@ -91,6 +152,41 @@ int hal_usb_send(const uint8_t *data, size_t len)
     return HAL_ERROR;
 }
 
+int hal_usb_send_burst(const uint8_t *packets, size_t count)
+{
+    if (!hal_stm32_state.initialized || packets == NULL) {
+        return HAL_ERROR;
+    }
+
+    size_t queued = 0;
+    while (queued < count &&
+           (usb_tx_queue.tail - usb_tx_queue.head) < USB_TX_QUEUE_DEPTH) {
+        memcpy(usb_tx_queue.reports[usb_tx_queue.tail & (USB_TX_QUEUE_DEPTH - 1)],
+               &packets[queued * HAL_USB_REPORT_SIZE], HAL_USB_REPORT_SIZE);
+        usb_tx_queue.tail++;
+        queued++;
+    }
+
+    /* Start the endpoint if it is idle; otherwise the DataIn interrupt picks up the rest */
+    __disable_irq();
+    if (!usb_tx_queue.in_flight && queued > 0) {
+        usb_tx_kick();
+    }
+    __enable_irq();
+
+    return (int) queued;
+}
+
+bool hal_usb_tx_pending(void)
+{
+    return usb_tx_queue.in_flight || (usb_tx_queue.head != usb_tx_queue.tail);
+}
+
+void hal_usb_set_tx_complete_callback(hal_usb_tx_complete_cb_t callback)
+{
+    usb_tx_queue.complete_cb = callback;
+}
+
 int hal_usb_receive(uint8_t *data, size_t max_len, uint32_t timeout_ms)
 {
     if (!hal_stm32_state.initialized || data == NULL) {
@@ -244,6 +340,46 @@ size_t hal_flash_get_size(void)
     return FLASH_USER_END_ADDR - FLASH_USER_START_ADDR + 1;
 }
 
+/* ========== Firmware Slots ========== */
+
+/* Single-bank STM32F4: no second bank to boot from */
+int hal_fw_get_slots(hal_fw_slots_t *slots)
+{
+    (void) slots;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_read(uint8_t slot, uint32_t offset, uint8_t *data, size_t len)
+{
+    (void) slot;
+    (void) offset;
+    (void) data;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_write(uint8_t slot, uint32_t offset, const uint8_t *data, size_t len)
+{
+    (void) slot;
+    (void) offset;
+    (void) data;
+    (void) len;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_erase(uint8_t slot, uint32_t offset)
+{
+    (void) slot;
+    (void) offset;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+int hal_fw_set_boot_slot(uint8_t slot)
+{
+    (void) slot;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
 /* ========== Random Number Generation ========== */
 
 int hal_random_generate(uint8_t *buffer, size_t len)
@@ -282,15 +418,35 @@ int hal_button_init(void)
 
     GPIO_InitTypeDef gpio_init;
     gpio_init.Pin = BUTTON_PIN;
-    gpio_init.Mode = GPIO_MODE_INPUT;
+    gpio_init.Mode = GPIO_MODE_IT_FALLING; /* Active low: interrupt on press */
     gpio_init.Pull = GPIO_PULLUP;
     gpio_init.Speed = GPIO_SPEED_FREQ_LOW;
 
     HAL_GPIO_Init(BUTTON_PORT, &gpio_init);
 
+    HAL_NVIC_SetPriority(EXTI0_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+
     return HAL_OK;
 }
 
+void hal_button_set_callback(hal_button_cb_t callback)
+{
+    hal_stm32_state.button_cb = callback;
+}
+
+void EXTI0_IRQHandler(void)
+{
+    HAL_GPIO_EXTI_IRQHandler(BUTTON_PIN);
+}
+
+void HAL_GPIO_EXTI_Callback(uint16_t gpio_pin)
+{
+    if (gpio_pin == BUTTON_PIN && hal_stm32_state.button_cb != NULL) {
+        hal_stm32_state.button_cb();
+    }
+}
+
 hal_button_state_t hal_button_get_state(void)
 {
     /* Button is active low */
@@ -362,6 +518,59 @@ int hal_led_set_state(hal_led_state_t state)
     return HAL_OK;
 }
 
+int hal_led_set_tick_callback(uint32_t period_ms, hal_led_tick_cb_t callback)
+{
+    TIM_HandleTypeDef *htim = &hal_stm32_state.led_timer;
+
+    if (callback == NULL) {
+        HAL_TIM_Base_Stop_IT(htim);
+        hal_stm32_state.led_tick_cb = NULL;
+        return HAL_OK;
+    }
+
+    if (period_ms == 0 || period_ms > 6553) {
+        return HAL_ERROR;
+    }
+
+    hal_stm32_state.led_tick_cb = callback;
+
+    /* TIM6 runs on the APB1 timer clock: PCLK1, doubled only when APB1 is divided */
+    uint32_t timer_clock = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+        timer_clock *= 2;
+    }
+
+    /* TIM6 is a basic timer; count at 10 kHz */
+    __HAL_RCC_TIM6_CLK_ENABLE();
+    htim->Instance = TIM6;
+    htim->Init.Prescaler = timer_clock / 10000 - 1;
+    htim->Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim->Init.Period = period_ms * 10 - 1;
+    htim->Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+
+    if (HAL_TIM_Base_Init(htim) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    /* Lowest priority: LED effects must never delay USB or button interrupts */
+    HAL_NVIC_SetPriority(TIM6_DAC_IRQn, 15, 0);
+    HAL_NVIC_EnableIRQ(TIM6_DAC_IRQn);
+
+    return (HAL_TIM_Base_Start_IT(htim) == HAL_OK) ? HAL_OK : HAL_ERROR;
+}
+
+void TIM6_DAC_IRQHandler(void)
+{
+    HAL_TIM_IRQHandler(&hal_stm32_state.led_timer);
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance == TIM6 && hal_stm32_state.led_tick_cb != NULL) {
+        hal_stm32_state.led_tick_cb();
+    }
+}
+
 /* ========== Cryptographic Acceleration ========== */
 
 bool hal_crypto_is_available(void)
@@ -382,6 +591,26 @@ int hal_crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8
     return HAL_ERROR_NOT_SUPPORTED;
 }
 
+int hal_get_device_secret(uint8_t *secret, size_t *len)
+{
+    /*
+     * The 96-bit unique device ID is NOT a secret: any code running on the
+     * chip and any debug probe can read it, and it is often printed on the
+     * package label or used as the USB serial number. It only binds the key
+     * hierarchy to this chip, so a flash dump replayed on another part fails
+     * to decrypt. Confidentiality rests on the sealed seed and on the flash
+     * read-out protection (RDP level 2); a part with a readable flash gives
+     * both away.
+     */
+    if (secret == NULL || len == NULL || *len < 12) {
+        return HAL_ERROR;
+    }
+
+    memcpy(secret, (const void *) UID_BASE, 12);
+    *len = 12;
+    return HAL_OK;
+}
+
 /* ========== Time Functions ========== */
 
 uint64_t hal_get_timestamp_ms(void)
@@ -389,6 +618,30 @@ uint64_t hal_get_timestamp_ms(void)
     return HAL_GetTick();
 }
 
+uint64_t hal_get_timestamp_us(void)
+{
+    uint32_t ms;
+    uint32_t ticks;
+
+    /* SysTick counts down from LOAD within each millisecond; retry across a wrap */
+    do {
+        ms = HAL_GetTick();
+        ticks = SysTick->LOAD - SysTick->VAL;
+    } while (ms != HAL_GetTick());
+
+    return (uint64_t) ms * 1000 + (uint64_t) ticks * 1000 / (SysTick->LOAD + 1);
+}
+
+uint32_t hal_cycle_count(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t hal_cycle_frequency(void)
+{
+    return SystemCoreClock;
+}
+
 void hal_delay_ms(uint32_t ms)
 {
     HAL_Delay(ms);
@@ -412,4 +665,73 @@ int hal_watchdog_feed(void)
     return (HAL_IWDG_Refresh(&hiwdg) == HAL_OK) ? HAL_OK : HAL_ERROR;
 }
 
+/* ========== Retention Memory Functions ========== */
+
+/* 4 KB backup SRAM, kept alive by the backup regulator in Stop/Standby */
+#define RETENTION_BASE ((uint8_t *) BKPSRAM_BASE)
+
+static void retention_enable(void)
+{
+    static bool enabled = false;
+
+    if (!enabled) {
+        __HAL_RCC_PWR_CLK_ENABLE();
+        HAL_PWR_EnableBkUpAccess();
+        __HAL_RCC_BKPSRAM_CLK_ENABLE();
+        HAL_PWREx_EnableBkUpReg();
+        enabled = true;
+    }
+}
+
+int hal_retention_write(const uint8_t *data, size_t len)
+{
+    if (data == NULL || len > HAL_RETENTION_SIZE) {
+        return HAL_ERROR;
+    }
+
+    retention_enable();
+    memcpy(RETENTION_BASE, data, len);
+    return HAL_OK;
+}
+
+int hal_retention_read(uint8_t *data, size_t len)
+{
+    if (data == NULL || len > HAL_RETENTION_SIZE) {
+        return HAL_ERROR;
+    }
+
+    retention_enable();
+    memcpy(data, RETENTION_BASE, len);
+    return HAL_OK;
+}
+
+void hal_retention_clear(void)
+{
+    retention_enable();
+    memset(RETENTION_BASE, 0, HAL_RETENTION_SIZE);
+}
+
+/* ========== Multicore Functions ========== */
+
+int hal_core_launch(hal_core_entry_t entry)
+{
+    /* Single core: requests run inline on the main loop */
+    (void) entry;
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
+void hal_core_signal(void)
+{
+}
+
+void hal_core_wait(uint32_t timeout_ms)
+{
+    hal_delay_ms(timeout_ms);
+}
+
+uint32_t hal_core_id(void)
+{
+    return 0;
+}
+
 #endif /* STM32 */
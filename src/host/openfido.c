@@ -0,0 +1,289 @@
+/**
+ * @file openfido.c
+ * @brief libopenfido Context Implementation
+ *
+ * Every module state variable is registered in the "openfido_state" section
+ * (see module_state.h). A context owns an image of all of them; switching
+ * the context resident on a thread saves the thread's live state into the
+ * outgoing image and loads the incoming one, so nothing leaks from one
+ * virtual authenticator to the next.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "openfido.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attestation.h"
+#include "crypto.h"
+#include "ctap2.h"
+#include "ctap2_hmac_secret.h"
+#include "device_keys.h"
+#include "hal_host.h"
+#include "idle_scheduler.h"
+#include "led_patterns.h"
+#include "logger.h"
+#include "module_state.h"
+#include "storage.h"
+#include "u2f.h"
+#include "user_presence.h"
+
+_Static_assert(OPENFIDO_MAX_MESSAGE_SIZE == CTAP2_MAX_MESSAGE_SIZE,
+               "OPENFIDO_MAX_MESSAGE_SIZE must match the CTAP2 message buffer");
+
+/* Section bounds, provided by the linker */
+extern const module_state_desc_t __start_openfido_state[];
+extern const module_state_desc_t __stop_openfido_state[];
+
+struct openfido_ctx {
+    pthread_mutex_t lock;
+    hal_host_device_t device;
+    uint8_t *state; /* Image of all registered module state */
+    bool booted;
+    pthread_t thread; /* Bound on the first request */
+};
+
+/* Registered state layout and its initial values, captured once */
+static struct {
+    pthread_once_t once;
+    size_t size;
+    uint8_t *pristine;
+} registry = {.once = PTHREAD_ONCE_INIT};
+
+/* Context whose state is live in this thread's module variables */
+static _Thread_local openfido_ctx_t *resident = NULL;
+
+/**
+ * @brief Copy the calling thread's module state into an image
+ */
+static void state_save(uint8_t *image)
+{
+    for (const module_state_desc_t *desc = __start_openfido_state;
+         desc < __stop_openfido_state; desc++) {
+        memcpy(image, desc->address(), desc->size);
+        image += desc->size;
+    }
+}
+
+/**
+ * @brief Load an image into the calling thread's module state
+ */
+static void state_load(const uint8_t *image)
+{
+    for (const module_state_desc_t *desc = __start_openfido_state;
+         desc < __stop_openfido_state; desc++) {
+        memcpy(desc->address(), image, desc->size);
+        image += desc->size;
+    }
+}
+
+/**
+ * @brief Size the registry and capture the initial state
+ *
+ * Runs before any context has been made resident, so the calling thread's
+ * module variables still hold their initializers.
+ */
+static void registry_init(void)
+{
+    for (const module_state_desc_t *desc = __start_openfido_state;
+         desc < __stop_openfido_state; desc++) {
+        registry.size += desc->size;
+    }
+
+    registry.pristine = malloc(registry.size);
+    if (registry.pristine != NULL) {
+        state_save(registry.pristine);
+    }
+}
+
+/**
+ * @brief Make a context resident on the calling thread
+ */
+static void ctx_switch(openfido_ctx_t *ctx)
+{
+    if (resident == ctx) {
+        return;
+    }
+
+    if (resident != NULL) {
+        state_save(resident->state);
+    }
+    state_load(ctx->state);
+    resident = ctx;
+    hal_host_bind(&ctx->device);
+}
+
+/**
+ * @brief Bring the firmware modules up for a fresh context
+ */
+static openfido_result_t ctx_boot(void)
+{
+    idle_sched_init();
+    led_patterns_init();
+
+    if (up_init() != UP_OK || crypto_init() != CRYPTO_OK || storage_init() != STORAGE_OK ||
+        ctap2_init() != CTAP2_OK) {
+        return OPENFIDO_ERROR;
+    }
+
+    return OPENFIDO_OK;
+}
+
+openfido_result_t openfido_ctx_create(const openfido_hal_ops_t *ops, void *user,
+                                      openfido_ctx_t **ctx)
+{
+    if (ctx == NULL) {
+        return OPENFIDO_ERROR_INVALID_PARAM;
+    }
+
+    pthread_once(&registry.once, registry_init);
+    if (registry.pristine == NULL) {
+        return OPENFIDO_ERROR_NO_MEMORY;
+    }
+
+    openfido_ctx_t *new_ctx = calloc(1, sizeof(*new_ctx));
+    if (new_ctx == NULL) {
+        return OPENFIDO_ERROR_NO_MEMORY;
+    }
+
+    new_ctx->state = malloc(registry.size);
+    new_ctx->device.flash = malloc(OPENFIDO_FLASH_SIZE);
+    if (new_ctx->state == NULL || new_ctx->device.flash == NULL) {
+        free(new_ctx->state);
+        free(new_ctx->device.flash);
+        free(new_ctx);
+        return OPENFIDO_ERROR_NO_MEMORY;
+    }
+
+    memcpy(new_ctx->state, registry.pristine, registry.size);
+    memset(new_ctx->device.flash, 0xFF, OPENFIDO_FLASH_SIZE);
+    new_ctx->device.flash_size = OPENFIDO_FLASH_SIZE;
+    if (ops != NULL) {
+        new_ctx->device.ops = *ops;
+    }
+    new_ctx->device.user = user;
+    pthread_mutex_init(&new_ctx->lock, NULL);
+
+    *ctx = new_ctx;
+    return OPENFIDO_OK;
+}
+
+openfido_result_t openfido_ctx_destroy(openfido_ctx_t *ctx)
+{
+    if (ctx == NULL) {
+        return OPENFIDO_ERROR_INVALID_PARAM;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->booted && !pthread_equal(ctx->thread, pthread_self())) {
+        pthread_mutex_unlock(&ctx->lock);
+        return OPENFIDO_ERROR_BUSY;
+    }
+
+    /* Release what the modules allocated, then leave the thread pristine */
+    if (ctx->booted) {
+        ctx_switch(ctx);
+        attestation_clear();
+        hmac_secret_clear();
+        device_keys_clear();
+        crypto_deinit();
+        state_load(registry.pristine);
+        resident = NULL;
+        hal_host_bind(NULL);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    pthread_mutex_destroy(&ctx->lock);
+    crypto_secure_zero(ctx->state, registry.size);
+    crypto_secure_zero(ctx->device.flash, ctx->device.flash_size);
+    free(ctx->state);
+    free(ctx->device.flash);
+    free(ctx);
+    return OPENFIDO_OK;
+}
+
+/**
+ * @brief Lock a context and make it resident, starting it if needed
+ */
+static openfido_result_t ctx_enter(openfido_ctx_t *ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+
+    /* Module state may hold pointers into this thread's variables */
+    if (ctx->booted && !pthread_equal(ctx->thread, pthread_self())) {
+        pthread_mutex_unlock(&ctx->lock);
+        return OPENFIDO_ERROR_BUSY;
+    }
+
+    ctx_switch(ctx);
+
+    if (!ctx->booted) {
+        ctx->thread = pthread_self();
+        ctx->booted = true;
+        if (ctx_boot() != OPENFIDO_OK) {
+            LOG_ERROR("Virtual authenticator failed to start");
+            pthread_mutex_unlock(&ctx->lock);
+            return OPENFIDO_ERROR;
+        }
+    }
+
+    return OPENFIDO_OK;
+}
+
+openfido_result_t openfido_ctx_process(openfido_ctx_t *ctx, const uint8_t *request,
+                                       size_t request_len, uint8_t *response,
+                                       size_t *response_len)
+{
+    if (ctx == NULL || request == NULL || request_len == 0 || response == NULL ||
+        response_len == NULL) {
+        return OPENFIDO_ERROR_INVALID_PARAM;
+    }
+
+    openfido_result_t ret = ctx_enter(ctx);
+    if (ret != OPENFIDO_OK) {
+        return ret;
+    }
+
+    ctap2_request_t ctap_request = {
+        .cmd = request[0],
+        .data = (uint8_t *) &request[1],
+        .data_len = request_len - 1,
+    };
+    ctap2_response_t ctap_response = {
+        .data = &response[1],
+        .data_len = 0,
+    };
+
+    response[0] = ctap2_process_request(&ctap_request, &ctap_response);
+    *response_len = 1 + ctap_response.data_len;
+
+    pthread_mutex_unlock(&ctx->lock);
+    return OPENFIDO_OK;
+}
+
+openfido_result_t openfido_ctx_process_u2f(openfido_ctx_t *ctx, const uint8_t *apdu,
+                                           size_t apdu_len, uint8_t *response,
+                                           size_t *response_len)
+{
+    if (ctx == NULL || apdu == NULL || response == NULL || response_len == NULL) {
+        return OPENFIDO_ERROR_INVALID_PARAM;
+    }
+
+    openfido_result_t ret = ctx_enter(ctx);
+    if (ret != OPENFIDO_OK) {
+        return ret;
+    }
+
+    size_t len = 0;
+    uint16_t sw = u2f_process_apdu(apdu, apdu_len, response, &len);
+    response[len++] = (uint8_t) (sw >> 8);
+    response[len++] = (uint8_t) sw;
+    *response_len = len;
+
+    pthread_mutex_unlock(&ctx->lock);
+    return OPENFIDO_OK;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file openfido.h
+ * @brief libopenfido: Authenticator Core as a Host Library
+ *
+ * Runs any number of virtual authenticators in one process, for example to
+ * drive server-side WebAuthn benchmarks. Each context has its own flash
+ * image, retention memory and HAL callbacks, and the complete protocol
+ * state of the firmware modules.
+ *
+ * Module state is thread-local, so contexts on different threads run in
+ * parallel. Contexts that share a thread are swapped in and out around each
+ * request. A context is bound to the thread that first processes a request
+ * on it, and must be used and destroyed from that thread only.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef OPENFIDO_H
+#define OPENFIDO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Response buffer size for openfido_ctx_process() */
+#define OPENFIDO_MAX_MESSAGE_SIZE 1024
+
+/* Flash image size of each context */
+#define OPENFIDO_FLASH_SIZE (64 * 1024)
+
+/**
+ * @brief Virtual authenticator context
+ */
+typedef struct openfido_ctx openfido_ctx_t;
+
+/**
+ * @brief Per-context HAL callbacks
+ *
+ * Any callback may be NULL to use the default.
+ */
+typedef struct {
+    /** Fill @p buffer with random bytes; returns 0 on success (default: getentropy) */
+    int (*random)(void *user, uint8_t *buffer, size_t len);
+    /** Milliseconds since an arbitrary epoch (default: CLOCK_MONOTONIC) */
+    uint64_t (*timestamp_ms)(void *user);
+    /** Whether the user is touching the key (default: always) */
+    bool (*user_present)(void *user);
+} openfido_hal_ops_t;
+
+/**
+ * @brief Create a virtual authenticator with blank flash
+ *
+ * The authenticator is formatted on its first request.
+ *
+ * @param ops HAL callbacks (copied; may be NULL for all defaults)
+ * @param user Opaque pointer passed to the callbacks
+ * @param ctx Output context
+ * @return OPENFIDO_OK, or OPENFIDO_ERROR_NO_MEMORY
+ */
+openfido_result_t openfido_ctx_create(const openfido_hal_ops_t *ops, void *user,
+                                      openfido_ctx_t **ctx);
+
+/**
+ * @brief Destroy a virtual authenticator
+ *
+ * @param ctx Context
+ * @return OPENFIDO_OK, or OPENFIDO_ERROR_BUSY if called from another thread
+ *         than the one the context is bound to
+ */
+openfido_result_t openfido_ctx_destroy(openfido_ctx_t *ctx);
+
+/**
+ * @brief Process one CTAP2 request
+ *
+ * @param ctx Context
+ * @param request Command byte followed by the CBOR parameters (CTAPHID_CBOR payload)
+ * @param request_len Request length
+ * @param response Output status byte followed by the CBOR response
+ *                 (OPENFIDO_MAX_MESSAGE_SIZE bytes)
+ * @param response_len Output response length
+ * @return OPENFIDO_OK if a response was produced, OPENFIDO_ERROR_BUSY if the
+ *         context is bound to another thread, error code otherwise
+ */
+openfido_result_t openfido_ctx_process(openfido_ctx_t *ctx, const uint8_t *request,
+                                       size_t request_len, uint8_t *response,
+                                       size_t *response_len);
+
+/**
+ * @brief Process one U2F APDU
+ *
+ * @param ctx Context
+ * @param apdu Request APDU (CTAPHID_MSG payload)
+ * @param apdu_len APDU length
+ * @param response Output response data followed by the status word
+ *                 (OPENFIDO_MAX_MESSAGE_SIZE bytes)
+ * @param response_len Output response length
+ * @return OPENFIDO_OK if a response was produced, OPENFIDO_ERROR_BUSY if the
+ *         context is bound to another thread, error code otherwise
+ */
+openfido_result_t openfido_ctx_process_u2f(openfido_ctx_t *ctx, const uint8_t *apdu,
+                                           size_t apdu_len, uint8_t *response,
+                                           size_t *response_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OPENFIDO_H */
@@ -0,0 +1,552 @@
+/**
+ * @file openfido_sim.c
+ * @brief Multi-threaded Virtual Authenticator Simulator
+ *
+ * Drives many libopenfido authenticators in parallel to load-test the
+ * CTAP2 and U2F command paths. Each instance is one job: it is created,
+ * registers credentials, asserts them and is destroyed on the worker that
+ * runs it, since a context is bound to the thread of its first request.
+ * Jobs are spread over per-worker deques and idle workers steal from the
+ * others, so a slow instance does not leave the rest of the pool idle.
+ *
+ * In a build with the cycle profiler (ENABLE_PROFILE) the busiest functions
+ * are listed at the end of the run.
+ *
+ * Usage: openfido_sim [-t threads] [-n instances] [-r registrations] [-a assertions] [-u]
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbor.h"
+#include "ctap2.h"
+#include "hal.h"
+#include "openfido.h"
+#include "profiler.h"
+#include "storage.h"
+#include "u2f.h"
+
+#define SIM_RP_ID "sim.openfido.dev"
+
+/* authenticatorData: rpIdHash | flags | signCount | aaguid | credIdLen | credId */
+#define SIM_AUTH_DATA_CRED_ID_LEN_OFFSET 53
+#define SIM_AUTH_DATA_CRED_ID_OFFSET 55
+
+/* U2F register response: 0x05 | public key | key handle length | key handle */
+#define SIM_U2F_KEY_HANDLE_LEN_OFFSET 66
+#define SIM_U2F_KEY_HANDLE_OFFSET 67
+
+/* Functions listed in the profile report */
+#define SIM_PROFILE_TOP 20
+
+/**
+ * @brief Job deque of one worker
+ *
+ * The owner takes from the back, thieves take from the front.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    size_t *jobs;
+    size_t head;
+    size_t tail;
+} sim_deque_t;
+
+typedef struct {
+    size_t registrations;
+    size_t assertions;
+    bool u2f;
+} sim_config_t;
+
+typedef struct {
+    atomic_size_t registrations;
+    atomic_size_t assertions;
+    atomic_size_t u2f_registrations;
+    atomic_size_t u2f_authentications;
+    atomic_size_t failures;
+    atomic_size_t steals;
+} sim_stats_t;
+
+typedef struct {
+    size_t id;
+    size_t worker_count;
+    sim_deque_t *deques;
+    const sim_config_t *config;
+    sim_stats_t *stats;
+} sim_worker_t;
+
+static uint64_t sim_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+static bool sim_deque_pop(sim_deque_t *deque, size_t *job)
+{
+    bool found = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail > deque->head) {
+        *job = deque->jobs[--deque->tail];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+static bool sim_deque_steal(sim_deque_t *deque, size_t *job)
+{
+    bool found = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail > deque->head) {
+        *job = deque->jobs[deque->head++];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return found;
+}
+
+/**
+ * @brief Take the next job: own deque first, then the other workers' in turn
+ */
+static bool sim_next_job(sim_worker_t *worker, size_t *job)
+{
+    if (sim_deque_pop(&worker->deques[worker->id], job)) {
+        return true;
+    }
+
+    for (size_t i = 1; i < worker->worker_count; i++) {
+        size_t victim = (worker->id + i) % worker->worker_count;
+        if (sim_deque_steal(&worker->deques[victim], job)) {
+            atomic_fetch_add(&worker->stats->steals, 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Deterministic per-instance challenge, so runs are reproducible
+ */
+static void sim_challenge(size_t instance, size_t counter, uint8_t *out)
+{
+    for (size_t i = 0; i < 32; i++) {
+        out[i] = (uint8_t) (instance * 131 + counter * 31 + i);
+    }
+}
+
+static bool sim_make_credential(openfido_ctx_t *ctx, size_t instance, size_t index,
+                                uint8_t *cred_id, size_t *cred_id_len)
+{
+    uint8_t request[CTAP2_MAX_MESSAGE_SIZE];
+    uint8_t response[OPENFIDO_MAX_MESSAGE_SIZE];
+    uint8_t client_data_hash[32];
+    uint8_t user_id[16];
+    char user_name[32];
+    size_t response_len;
+    cbor_encoder_t encoder;
+
+    sim_challenge(instance, index, client_data_hash);
+    memset(user_id, 0, sizeof(user_id));
+    memcpy(user_id, &instance, sizeof(instance));
+    memcpy(&user_id[8], &index, sizeof(index));
+    snprintf(user_name, sizeof(user_name), "user%zu.%zu", instance, index);
+
+    request[0] = CTAP2_CMD_MAKE_CREDENTIAL;
+    cbor_encoder_init(&encoder, &request[1], sizeof(request) - 1);
+    cbor_encode_map_start(&encoder, 4);
+
+    cbor_encode_uint(&encoder, 1); /* clientDataHash */
+    cbor_encode_bytes(&encoder, client_data_hash, sizeof(client_data_hash));
+
+    cbor_encode_uint(&encoder, 2); /* rp */
+    cbor_encode_map_start(&encoder, 1);
+    cbor_encode_text(&encoder, "id", 2);
+    cbor_encode_text(&encoder, SIM_RP_ID, strlen(SIM_RP_ID));
+
+    cbor_encode_uint(&encoder, 3); /* user */
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_text(&encoder, "id", 2);
+    cbor_encode_bytes(&encoder, user_id, sizeof(user_id));
+    cbor_encode_text(&encoder, "name", 4);
+    cbor_encode_text(&encoder, user_name, strlen(user_name));
+
+    cbor_encode_uint(&encoder, 4); /* pubKeyCredParams */
+    cbor_encode_array_start(&encoder, 1);
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_text(&encoder, "alg", 3);
+    cbor_encode_int(&encoder, COSE_ALG_ES256);
+    cbor_encode_text(&encoder, "type", 4);
+    cbor_encode_text(&encoder, "public-key", 10);
+
+    if (openfido_ctx_process(ctx, request, 1 + cbor_encoder_get_size(&encoder), response,
+                             &response_len) != OPENFIDO_OK ||
+        response[0] != CTAP2_OK) {
+        return false;
+    }
+
+    /* Pull the credential ID out of the attested credential data */
+    cbor_decoder_t decoder;
+    size_t map_size;
+    cbor_decoder_init(&decoder, &response[1], response_len - 1);
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK) {
+        return false;
+    }
+
+    for (size_t i = 0; i < map_size; i++) {
+        uint64_t key;
+        if (cbor_decode_uint(&decoder, &key) != CBOR_OK) {
+            return false;
+        }
+        if (key != 2) {
+            if (cbor_decoder_skip(&decoder) != CBOR_OK) {
+                return false;
+            }
+            continue;
+        }
+
+        uint8_t auth_data[OPENFIDO_MAX_MESSAGE_SIZE];
+        size_t auth_data_len = sizeof(auth_data);
+        if (cbor_decode_bytes(&decoder, auth_data, &auth_data_len) != CBOR_OK ||
+            auth_data_len < SIM_AUTH_DATA_CRED_ID_OFFSET) {
+            return false;
+        }
+
+        size_t id_len = ((size_t) auth_data[SIM_AUTH_DATA_CRED_ID_LEN_OFFSET] << 8) |
+                        auth_data[SIM_AUTH_DATA_CRED_ID_LEN_OFFSET + 1];
+        if (id_len > *cred_id_len ||
+            SIM_AUTH_DATA_CRED_ID_OFFSET + id_len > auth_data_len) {
+            return false;
+        }
+        memcpy(cred_id, &auth_data[SIM_AUTH_DATA_CRED_ID_OFFSET], id_len);
+        *cred_id_len = id_len;
+        return true;
+    }
+
+    return false;
+}
+
+static bool sim_get_assertion(openfido_ctx_t *ctx, size_t instance, size_t counter,
+                              const uint8_t *cred_id, size_t cred_id_len)
+{
+    uint8_t request[CTAP2_MAX_MESSAGE_SIZE];
+    uint8_t response[OPENFIDO_MAX_MESSAGE_SIZE];
+    uint8_t client_data_hash[32];
+    size_t response_len;
+    cbor_encoder_t encoder;
+
+    sim_challenge(instance, counter, client_data_hash);
+
+    request[0] = CTAP2_CMD_GET_ASSERTION;
+    cbor_encoder_init(&encoder, &request[1], sizeof(request) - 1);
+    cbor_encode_map_start(&encoder, 3);
+
+    cbor_encode_uint(&encoder, 1); /* rpId */
+    cbor_encode_text(&encoder, SIM_RP_ID, strlen(SIM_RP_ID));
+
+    cbor_encode_uint(&encoder, 2); /* clientDataHash */
+    cbor_encode_bytes(&encoder, client_data_hash, sizeof(client_data_hash));
+
+    cbor_encode_uint(&encoder, 3); /* allowList */
+    cbor_encode_array_start(&encoder, 1);
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_text(&encoder, "id", 2);
+    cbor_encode_bytes(&encoder, cred_id, cred_id_len);
+    cbor_encode_text(&encoder, "type", 4);
+    cbor_encode_text(&encoder, "public-key", 10);
+
+    return openfido_ctx_process(ctx, request, 1 + cbor_encoder_get_size(&encoder), response,
+                                &response_len) == OPENFIDO_OK &&
+           response[0] == CTAP2_OK;
+}
+
+/**
+ * @brief U2F register followed by one authenticate with the new key handle
+ */
+static void sim_u2f(openfido_ctx_t *ctx, size_t instance, sim_stats_t *stats)
+{
+    uint8_t apdu[7 + 64 + 1 + 255];
+    uint8_t response[OPENFIDO_MAX_MESSAGE_SIZE];
+    size_t response_len;
+
+    /* CLA INS P1 P2 | extended Lc | challenge | application */
+    apdu[0] = 0x00;
+    apdu[1] = U2F_REGISTER;
+    apdu[2] = 0x00;
+    apdu[3] = 0x00;
+    apdu[4] = 0x00;
+    apdu[5] = 0x00;
+    apdu[6] = 64;
+    sim_challenge(instance, 0, &apdu[7]);
+    sim_challenge(instance, 1, &apdu[7 + 32]);
+
+    if (openfido_ctx_process_u2f(ctx, apdu, 7 + 64, response, &response_len) != OPENFIDO_OK ||
+        response_len < SIM_U2F_KEY_HANDLE_OFFSET + 2 ||
+        ((response[response_len - 2] << 8) | response[response_len - 1]) != U2F_SW_NO_ERROR) {
+        atomic_fetch_add(&stats->failures, 1);
+        return;
+    }
+    atomic_fetch_add(&stats->u2f_registrations, 1);
+
+    size_t handle_len = response[SIM_U2F_KEY_HANDLE_LEN_OFFSET];
+    if (SIM_U2F_KEY_HANDLE_OFFSET + handle_len + 2 > response_len) {
+        atomic_fetch_add(&stats->failures, 1);
+        return;
+    }
+
+    /* Same application parameter, a fresh challenge and the key handle */
+    size_t data_len = 64 + 1 + handle_len;
+    apdu[1] = U2F_AUTHENTICATE;
+    apdu[2] = U2F_AUTH_ENFORCE;
+    apdu[5] = (uint8_t) (data_len >> 8);
+    apdu[6] = (uint8_t) data_len;
+    sim_challenge(instance, 2, &apdu[7]);
+    apdu[7 + 64] = (uint8_t) handle_len;
+    memcpy(&apdu[7 + 64 + 1], &response[SIM_U2F_KEY_HANDLE_OFFSET], handle_len);
+
+    if (openfido_ctx_process_u2f(ctx, apdu, 7 + data_len, response, &response_len) !=
+            OPENFIDO_OK ||
+        response_len < 2 ||
+        ((response[response_len - 2] << 8) | response[response_len - 1]) != U2F_SW_NO_ERROR) {
+        atomic_fetch_add(&stats->failures, 1);
+        return;
+    }
+    atomic_fetch_add(&stats->u2f_authentications, 1);
+}
+
+/**
+ * @brief Run one instance from creation to destruction
+ */
+static void sim_run_instance(size_t instance, const sim_config_t *config, sim_stats_t *stats)
+{
+    openfido_ctx_t *ctx;
+    if (openfido_ctx_create(NULL, NULL, &ctx) != OPENFIDO_OK) {
+        atomic_fetch_add(&stats->failures, 1);
+        return;
+    }
+
+    size_t counter = config->registrations;
+    for (size_t i = 0; i < config->registrations; i++) {
+        uint8_t cred_id[64];
+        size_t cred_id_len = sizeof(cred_id);
+
+        if (!sim_make_credential(ctx, instance, i, cred_id, &cred_id_len)) {
+            atomic_fetch_add(&stats->failures, 1);
+            continue;
+        }
+        atomic_fetch_add(&stats->registrations, 1);
+
+        for (size_t j = 0; j < config->assertions; j++) {
+            if (sim_get_assertion(ctx, instance, counter++, cred_id, cred_id_len)) {
+                atomic_fetch_add(&stats->assertions, 1);
+            } else {
+                atomic_fetch_add(&stats->failures, 1);
+            }
+        }
+    }
+
+    if (config->u2f) {
+        sim_u2f(ctx, instance, stats);
+    }
+
+    openfido_ctx_destroy(ctx);
+}
+
+static void *sim_worker_main(void *arg)
+{
+    sim_worker_t *worker = arg;
+    size_t job;
+
+    /* All jobs are queued before the workers start, so an empty sweep means done */
+    while (sim_next_job(worker, &job)) {
+        sim_run_instance(job, worker->config, worker->stats);
+    }
+
+    profiler_flush();
+    return NULL;
+}
+
+static int sim_profile_compare(const void *a, const void *b)
+{
+    const profiler_entry_t *x = a;
+    const profiler_entry_t *y = b;
+    return (x->exclusive < y->exclusive) - (x->exclusive > y->exclusive);
+}
+
+/**
+ * @brief Print the functions with the most exclusive time
+ *
+ * Names come from the dynamic symbol table when present; otherwise the
+ * offset can be resolved with addr2line -f -e openfido_sim.
+ */
+static void sim_print_profile(void)
+{
+    size_t slots = profiler_slot_count();
+    profiler_entry_t *entries = calloc(slots, sizeof(*entries));
+    if (slots == 0 || entries == NULL) {
+        free(entries);
+        return;
+    }
+
+    size_t cursor = 0;
+    size_t count = profiler_read(&cursor, entries, slots);
+    qsort(entries, count, sizeof(*entries), sim_profile_compare);
+
+    double ticks_per_us = hal_cycle_frequency() / 1e6;
+    printf("  profile (%u calls dropped):\n", profiler_dropped());
+    printf("    %-32s %10s %12s %12s\n", "function", "calls", "incl us", "excl us");
+    for (size_t i = 0; i < count && i < SIM_PROFILE_TOP; i++) {
+        char name[64];
+        Dl_info info = {0};
+        bool found = dladdr((void *) entries[i].function, &info) != 0;
+        if (found && info.dli_sname != NULL) {
+            snprintf(name, sizeof(name), "%s", info.dli_sname);
+        } else if (found && info.dli_fbase != NULL) {
+            snprintf(name, sizeof(name), "+0x%zx",
+                     (size_t) (entries[i].function - (uintptr_t) info.dli_fbase));
+        } else {
+            snprintf(name, sizeof(name), "0x%zx", (size_t) entries[i].function);
+        }
+        printf("    %-32s %10u %12.1f %12.1f\n", name, entries[i].calls,
+               entries[i].inclusive / ticks_per_us, entries[i].exclusive / ticks_per_us);
+    }
+
+    free(entries);
+}
+
+static void sim_usage(const char *argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [-t threads] [-n instances] [-r registrations] [-a assertions] [-u]\n"
+            "  -t  worker threads (default 4)\n"
+            "  -n  virtual authenticators (default 64)\n"
+            "  -r  registrations per authenticator, at most %d (default 4)\n"
+            "  -a  assertions per registration (default 8)\n"
+            "  -u  also run a U2F register and authenticate per authenticator\n",
+            argv0, STORAGE_MAX_CREDENTIALS);
+}
+
+int main(int argc, char **argv)
+{
+    size_t thread_count = 4;
+    size_t instance_count = 64;
+    sim_config_t config = {.registrations = 4, .assertions = 8, .u2f = false};
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:r:a:uh")) != -1) {
+        switch (opt) {
+            case 't':
+                thread_count = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                instance_count = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                config.registrations = strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                config.assertions = strtoul(optarg, NULL, 10);
+                break;
+            case 'u':
+                config.u2f = true;
+                break;
+            default:
+                sim_usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+
+    if (thread_count == 0 || instance_count == 0 ||
+        config.registrations > STORAGE_MAX_CREDENTIALS) {
+        sim_usage(argv[0]);
+        return 2;
+    }
+
+    sim_deque_t *deques = calloc(thread_count, sizeof(*deques));
+    sim_worker_t *workers = calloc(thread_count, sizeof(*workers));
+    pthread_t *threads = calloc(thread_count, sizeof(*threads));
+    size_t *jobs = calloc(instance_count, sizeof(*jobs));
+    if (deques == NULL || workers == NULL || threads == NULL || jobs == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Deal the instances out round-robin; stealing evens out the rest */
+    size_t per_worker = instance_count / thread_count;
+    size_t extra = instance_count % thread_count;
+    size_t next = 0;
+    for (size_t i = 0; i < thread_count; i++) {
+        size_t count = per_worker + ((i < extra) ? 1 : 0);
+        pthread_mutex_init(&deques[i].lock, NULL);
+        deques[i].jobs = &jobs[next];
+        for (size_t j = 0; j < count; j++) {
+            deques[i].jobs[j] = next + j;
+        }
+        deques[i].tail = count;
+        next += count;
+    }
+
+    sim_stats_t stats = {0};
+    uint64_t start = sim_now_us();
+
+    size_t started = 0;
+    for (size_t i = 0; i < thread_count; i++) {
+        workers[i] = (sim_worker_t) {
+            .id = i,
+            .worker_count = thread_count,
+            .deques = deques,
+            .config = &config,
+            .stats = &stats,
+        };
+        if (pthread_create(&threads[i], NULL, sim_worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Failed to start worker %zu\n", i);
+            break;
+        }
+        started++;
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    double seconds = (double) (sim_now_us() - start) / 1e6;
+    size_t registrations = atomic_load(&stats.registrations);
+    size_t assertions = atomic_load(&stats.assertions);
+    size_t failures = atomic_load(&stats.failures);
+
+    printf("%zu authenticators on %zu threads in %.3f s (%zu steals)\n", instance_count,
+           started, seconds, atomic_load(&stats.steals));
+    printf("  registrations: %zu (%.1f/s)\n", registrations, registrations / seconds);
+    printf("  assertions:    %zu (%.1f/s)\n", assertions, assertions / seconds);
+    if (config.u2f) {
+        printf("  u2f:           %zu registered, %zu authenticated\n",
+               atomic_load(&stats.u2f_registrations), atomic_load(&stats.u2f_authentications));
+    }
+    printf("  failures:      %zu\n", failures);
+    sim_print_profile();
+
+    for (size_t i = 0; i < thread_count; i++) {
+        pthread_mutex_destroy(&deques[i].lock);
+    }
+    free(jobs);
+    free(threads);
+    free(workers);
+    free(deques);
+
+    return (failures == 0) ? 0 : 1;
+}
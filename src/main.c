@@ -9,10 +9,15 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "boot_verify.h"
 #include "config.h"
 #include "crypto.h"
 #include "ctap2.h"
+#include "dispatch.h"
+#include "firmware_update.h"
 #include "hal.h"
+#include "idle_scheduler.h"
+#include "led_patterns.h"
 #include "logger.h"
 #include "openpgp.h"
 #include "piv.h"
@@ -21,6 +26,7 @@
 #include "u2f.h"
 #include "usb_ccid.h"
 #include "usb_hid.h"
+#include "user_presence.h"
 #include "ykman.h"
 
 /* Include BLE transport if supported */
@@ -29,6 +35,9 @@
 
 #define APP_VERSION "1.0.0"
 
+/* LED pattern to restore when the pending USB request completes */
+static led_pattern_type_t usb_idle_pattern = LED_PATTERN_IDLE;
+
 /**
  * @brief Initialize all subsystems
  *
@@ -43,6 +52,9 @@ static int init_subsystems(void)
     LOG_INFO("OpenFIDO v%s starting...", APP_VERSION);
     LOG_INFO("Device: %s %s", CONFIG_USB_MANUFACTURER, CONFIG_USB_PRODUCT);
 
+    /* Initialize idle scheduler before subsystems register background tasks */
+    idle_sched_init();
+
     /* Initialize HAL */
     LOG_INFO("Initializing hardware abstraction layer...");
     ret = hal_init();
@@ -51,6 +63,17 @@ static int init_subsystems(void)
         return -1;
     }
 
+    /* Start the LED pattern player */
+    led_patterns_init();
+
+    /* Initialize user presence button */
+    LOG_INFO("Initializing user presence...");
+    ret = up_init();
+    if (ret != UP_OK) {
+        LOG_ERROR("User presence initialization failed: %d", ret);
+        return -1;
+    }
+
     /* Initialize transport abstraction layer */
     LOG_INFO("Initializing transport abstraction layer...");
     ret = transport_init();
@@ -75,6 +98,15 @@ static int init_subsystems(void)
         return -1;
     }
 
+    /* Verify the running image before enumerating */
+    ret = boot_verify_init(firmware_update_signing_key());
+    if (ret == BOOT_VERIFY_ERROR_INTEGRITY) {
+        LOG_ERROR("Firmware image failed verification");
+        return -1;
+    } else if (ret != BOOT_VERIFY_OK) {
+        LOG_WARN("Verified boot unavailable: %d", ret);
+    }
+
     /* Initialize USB HID */
     LOG_INFO("Initializing USB HID interface...");
     ret = usb_hid_init();
@@ -142,21 +174,122 @@ static int init_subsystems(void)
         return -1;
     }
 
+    /* Start the crypto core last: from here on it owns the protocol state */
+    LOG_INFO("Initializing request dispatch...");
+    ret = dispatch_init();
+    if (ret != DISPATCH_OK) {
+        LOG_ERROR("Request dispatch initialization failed: %d", ret);
+        return -1;
+    }
+
     LOG_INFO("All subsystems initialized successfully");
     return 0;
 }
 
+/**
+ * @brief Keep the device responsive while a request is pending
+ *
+ * Runs from up_wait() on a single core, and from the main loop while the
+ * crypto core works on a request. Sends keepalives on the busy USB channel
+ * and honours CANCEL from it; PING and GetInfo are answered on any channel,
+ * anything else gets CHANNEL_BUSY until the pending request completes.
+ */
+static void service_pending_request(void)
+{
+    static uint8_t rx_buffer[CTAP2_MAX_MESSAGE_SIZE];
+    static uint8_t tx_buffer[CTAP2_MAX_MESSAGE_SIZE];
+    static uint64_t last_keepalive_ms = 0;
+
+    hal_watchdog_feed();
+
+    if (hal_ble_is_supported()) {
+        ble_transport_update_power_state();
+    }
+
+    bool usb_busy = (transport_get_locked() == TRANSPORT_TYPE_USB);
+    uint32_t busy_cid = usb_hid_get_cid();
+
+    if (usb_busy) {
+        uint64_t now_ms = hal_get_timestamp_ms();
+        if (now_ms - last_keepalive_ms >= CONFIG_KEEPALIVE_INTERVAL_MS) {
+            usb_hid_send_keepalive(up_is_waiting() ? CTAPHID_KEEPALIVE_UPNEEDED
+                                                   : CTAPHID_KEEPALIVE_PROCESSING);
+            last_keepalive_ms = now_ms;
+        }
+    }
+
+    uint8_t cmd = 0;
+    int len = transport_receive_from(TRANSPORT_TYPE_USB, rx_buffer, sizeof(rx_buffer), &cmd);
+    if (len < 0 || cmd == 0 || cmd == CTAPHID_INIT) {
+        /* Nothing new (INIT is answered inside usb_hid_receive) */
+        usb_hid_set_cid(busy_cid);
+        return;
+    }
+
+    if (cmd == CTAPHID_CANCEL) {
+        if (usb_busy && usb_hid_get_cid() == busy_cid) {
+            LOG_INFO("CTAPHID_CANCEL received, cancelling user presence wait");
+            up_cancel();
+        }
+    } else if (cmd == CTAPHID_PING) {
+        usb_hid_send_command(CTAPHID_PING, rx_buffer, len);
+    } else if (cmd == CTAPHID_CBOR && len > 0 && rx_buffer[0] == CTAP2_CMD_GET_INFO) {
+        size_t info_len = 0;
+        tx_buffer[0] = ctap2_get_info(&tx_buffer[1], &info_len);
+        usb_hid_send(tx_buffer, 1 + info_len);
+    } else {
+        usb_hid_send_error(CTAPHID_ERR_CHANNEL_BUSY);
+    }
+
+    /* Later sends (keepalives, the final response) belong to the busy channel */
+    usb_hid_set_cid(busy_cid);
+}
+
+/**
+ * @brief Send a finished response and end the operation on its transport
+ *
+ * @param transport Transport to complete
+ */
+static void complete_request(transport_type_t transport)
+{
+    const dispatch_msg_t *response = dispatch_poll(transport);
+    if (response == NULL) {
+        return;
+    }
+
+    /* Later requests may have switched the CTAPHID channel */
+    if (transport == TRANSPORT_TYPE_USB) {
+        usb_hid_set_cid(response->channel);
+    }
+
+    int ret = transport_send_on(transport, response->data, response->len);
+    if (ret < 0) {
+        LOG_ERROR("Failed to send %s response: %d", transport_type_name(transport), ret);
+    } else {
+        LOG_DEBUG("Sent %zu bytes %s response", response->len, transport_type_name(transport));
+    }
+    dispatch_release(transport);
+
+    /* Clear operation state; ble_transport restores the connected LED pattern */
+    transport_set_busy(false);
+    transport_unlock();
+
+    if (transport == TRANSPORT_TYPE_USB) {
+        /* Hold the LED on for CONFIG_LED_ACTIVITY_MS, then return to the idle pattern */
+        led_set_pattern(usb_idle_pattern);
+        led_set_pattern(LED_PATTERN_ACTIVITY);
+    }
+}
+
 /**
  * @brief BLE CTAP request callback
  *
- * Called when a complete CTAP request is received over BLE.
- * Processes the request and sends the response back over BLE.
+ * Called when a complete CTAP request is received over BLE. Hands the
+ * request to the dispatcher; the main loop sends the response.
  */
 static void on_ble_ctap_request(const uint8_t *data, size_t len)
 {
     static uint8_t tx_buffer[CTAP2_MAX_MESSAGE_SIZE];
-    ctap2_request_t request;
-    ctap2_response_t response;
 
     LOG_DEBUG("BLE CTAP request received: %zu bytes", len);
 
@@ -165,6 +298,14 @@ static void on_ble_ctap_request(const uint8_t *data, size_t len)
         return;
     }
 
+    /* GetInfo is stateless, so answer it even while another request waits */
+    if (transport_is_busy() && data[0] == CTAP2_CMD_GET_INFO) {
+        size_t info_len = 0;
+        tx_buffer[0] = ctap2_get_info(&tx_buffer[1], &info_len);
+        transport_send_on(TRANSPORT_TYPE_BLE, tx_buffer, 1 + info_len);
+        return;
+    }
+
     /* Check if another operation is in progress */
     if (transport_is_busy()) {
         LOG_WARN("Operation already in progress on another transport, rejecting BLE request");
@@ -179,39 +320,14 @@ static void on_ble_ctap_request(const uint8_t *data, size_t len)
     transport_lock(TRANSPORT_TYPE_BLE);
     transport_set_busy(true);
 
-    /* Indicate activity */
-    hal_led_set_state(HAL_LED_ON);
-
-    /* Parse CTAP2 request */
-    request.cmd = data[0];
-    request.data = (len > 1) ? &data[1] : NULL;
-    request.data_len = (len > 1) ? (len - 1) : 0;
-
-    /* Prepare response buffer */
-    response.data = tx_buffer + 1; /* Reserve first byte for status */
-    response.data_len = 0;
-
-    /* Process CTAP2 request */
-    response.status = ctap2_process_request(&request, &response);
-
-    /* Send response */
-    tx_buffer[0] = response.status;
-    int total_len = 1 + response.data_len;
-
-    /* Response is sent via transport abstraction (already set to BLE) */
-    int ret = transport_send(tx_buffer, total_len);
-    if (ret < 0) {
-        LOG_ERROR("Failed to send BLE response: %d", ret);
-    } else {
-        LOG_DEBUG("Sent %d bytes BLE response (status: 0x%02X)", total_len, response.status);
+    int ret = dispatch_submit(TRANSPORT_TYPE_BLE, 0, DISPATCH_KIND_CBOR, data, len);
+    if (ret != DISPATCH_OK) {
+        LOG_ERROR("Failed to dispatch BLE request: %d", ret);
+        uint8_t error_response[1] = {0x2E}; /* CTAP2_ERR_OPERATION_DENIED */
+        transport_send_on(TRANSPORT_TYPE_BLE, error_response, 1);
+        transport_set_busy(false);
+        transport_unlock();
     }
-
-    /* Clear operation state */
-    transport_set_busy(false);
-    transport_unlock();
-
-    /* Return to idle state */
-    hal_led_set_state(HAL_LED_BLINK_SLOW);
 }
 
 /**
@@ -221,12 +337,11 @@ static void on_ble_ctap_request(const uint8_t *data, size_t len)
  */
 static void on_ble_connection_change(bool connected)
 {
+    /* ble_transport has already switched the LED pattern */
     if (connected) {
         LOG_INFO("BLE client connected");
-        hal_led_set_state(HAL_LED_ON);
     } else {
         LOG_INFO("BLE client disconnected");
-        hal_led_set_state(HAL_LED_BLINK_SLOW);
     }
 }
 
@@ -236,13 +351,16 @@ static void on_ble_connection_change(bool connected)
 static void main_loop(void)
 {
     uint8_t rx_buffer[CTAP2_MAX_MESSAGE_SIZE];
-    uint8_t tx_buffer[CTAP2_MAX_MESSAGE_SIZE];
-    ctap2_request_t request;
-    ctap2_response_t response;
     int bytes_received;
 
     LOG_INFO("Entering main loop...");
-    hal_led_set_state(HAL_LED_BLINK_SLOW);
+
+    /* Keep transports serviced while requests wait for a touch. With a crypto
+       core the main loop does this itself, and the hook would run on the
+       wrong core. */
+    if (!dispatch_is_dual_core()) {
+        up_set_service_hook(service_pending_request);
+    }
 
     /* Initialize and start BLE transport if supported */
     if (hal_ble_is_supported()) {
@@ -298,86 +416,77 @@ static void main_loop(void)
             }
         }
 
-        /* Poll USB transport for data */
-        uint8_t cmd = 0;
-        bytes_received =
-            transport_receive_from(TRANSPORT_TYPE_USB, rx_buffer, sizeof(rx_buffer), &cmd);
-
-        if (bytes_received > 0) {
-            LOG_DEBUG("Received %d bytes from USB (CMD: 0x%02X)", bytes_received, cmd);
-
-            /* Check if another operation is in progress */
-            if (transport_is_busy()) {
-                LOG_WARN(
-                    "Operation already in progress on another transport, rejecting USB request");
-                /* Send CTAPHID_ERROR response */
-                /* For now, just continue to next iteration */
-                continue;
+        if (transport_is_busy()) {
+            /* A request is with the crypto core (or its response not yet sent) */
+            service_pending_request();
+        } else {
+            /* Poll USB transport for data */
+            uint8_t cmd = 0;
+            bytes_received =
+                transport_receive_from(TRANSPORT_TYPE_USB, rx_buffer, sizeof(rx_buffer), &cmd);
+
+            if (bytes_received > 0) {
+                LOG_DEBUG("Received %d bytes from USB (CMD: 0x%02X)", bytes_received, cmd);
+
+                if (cmd == CTAPHID_CBOR || cmd == CTAPHID_MSG) {
+                    /* Set USB as active transport and lock it for this operation */
+                    transport_set_active(TRANSPORT_TYPE_USB);
+                    transport_lock(TRANSPORT_TYPE_USB);
+                    transport_set_busy(true);
+
+                    /* Indicate activity */
+                    usb_idle_pattern = led_get_current_pattern();
+                    led_set_pattern(LED_PATTERN_PROCESSING);
+
+                    dispatch_kind_t kind =
+                        (cmd == CTAPHID_CBOR) ? DISPATCH_KIND_CBOR : DISPATCH_KIND_U2F;
+                    int ret = dispatch_submit(TRANSPORT_TYPE_USB, usb_hid_get_cid(), kind,
+                                              rx_buffer, bytes_received);
+                    if (ret != DISPATCH_OK) {
+                        LOG_ERROR("Failed to dispatch USB request: %d", ret);
+                        usb_hid_send_error(CTAPHID_ERR_CHANNEL_BUSY);
+                        transport_set_busy(false);
+                        transport_unlock();
+                        led_set_pattern(usb_idle_pattern);
+                    }
+                } else if (cmd == CTAPHID_PING) {
+                    usb_hid_send_command(CTAPHID_PING, rx_buffer, bytes_received);
+                } else {
+                    LOG_WARN("Unknown or unsupported CTAPHID command: 0x%02X", cmd);
+                    usb_hid_send_error(CTAPHID_ERR_INVALID_CMD);
+                }
             }
+        }
 
-            /* Set USB as active transport and lock it for this operation */
-            transport_set_active(TRANSPORT_TYPE_USB);
-            transport_lock(TRANSPORT_TYPE_USB);
-            transport_set_busy(true);
-
-            /* Indicate activity */
-            hal_led_set_state(HAL_LED_ON);
-
-            if (cmd == CTAPHID_CBOR) {
-                /* Parse CTAP2 request */
-                request.cmd = rx_buffer[0];
-                request.data = &rx_buffer[1];
-                request.data_len = bytes_received - 1;
-
-                /* Prepare response buffer */
-                response.data = tx_buffer + 1; /* Reserve first byte for status */
-                response.data_len = 0;
-
-                /* Process CTAP2 request */
-                response.status = ctap2_process_request(&request, &response);
-
-                /* Send response on active transport */
-                tx_buffer[0] = response.status;
-                int total_len = 1 + response.data_len;
+        /* Send whatever the crypto core has finished (at once on a single core) */
+        complete_request(TRANSPORT_TYPE_USB);
+        complete_request(TRANSPORT_TYPE_BLE);
 
-                transport_send(tx_buffer, total_len);
-                LOG_DEBUG("Sent %d bytes response (status: 0x%02X)", total_len, response.status);
-            } else if (cmd == CTAPHID_MSG) {
-                /* Process U2F APDU */
-                size_t response_len = 0;
-                uint16_t sw = u2f_process_apdu(rx_buffer, bytes_received, tx_buffer, &response_len);
+        /* BLE transport uses callbacks, so no polling needed */
+        /* BLE requests are handled asynchronously via on_ble_ctap_request callback */
 
-                /* Append SW to response */
-                tx_buffer[response_len++] = (sw >> 8) & 0xFF;
-                tx_buffer[response_len++] = sw & 0xFF;
+        /* No-op when the LED player has a hardware timer */
+        led_patterns_update();
 
-                transport_send(tx_buffer, response_len);
-                LOG_DEBUG("Sent %zu bytes U2F response (SW: 0x%04X)", response_len, sw);
-            } else {
-                LOG_WARN("Unknown or unsupported CTAPHID command: 0x%02X", cmd);
-                /* Send error response? Or just ignore? CTAPHID spec says send ERROR */
-                uint8_t err_payload[1] = {0x01}; /* INVALID_CMD */
-                /* We can't easily send CTAPHID ERROR from here without exposing more usb_hid
-                 * internals */
-                /* For now, just ignore */
+        /* Spend the idle window on background maintenance, ending it before the
+           next BLE service deadline; sleep away whatever is left */
+        uint32_t window_ms = CONFIG_IDLE_WINDOW_MS;
+        if (hal_ble_is_supported()) {
+            uint32_t ble_deadline_ms = ble_transport_get_next_deadline_ms();
+            if (ble_deadline_ms < window_ms) {
+                window_ms = ble_deadline_ms;
             }
-
-            /* Clear operation state */
-            transport_set_busy(false);
-            transport_unlock();
-
-            /* Return to idle state */
-            /* Note: In a real implementation with non-blocking LED, we would use a timer here
-               to keep the LED on for CONFIG_LED_ACTIVITY_MS before returning to slow blink.
-               For now, we just switch back. */
-            hal_led_set_state(HAL_LED_BLINK_SLOW);
         }
 
-        /* BLE transport uses callbacks, so no polling needed */
-        /* BLE requests are handled asynchronously via on_ble_ctap_request callback */
-
-        /* Small delay to prevent busy-waiting */
-        hal_delay_ms(10);
+        if (dispatch_is_dual_core()) {
+            /* Maintenance runs on the crypto core; poll quickly while it works */
+            hal_delay_ms(transport_is_busy() ? 1 : window_ms);
+        } else {
+            uint32_t used_ms = idle_sched_run(window_ms);
+            if (used_ms < window_ms) {
+                hal_delay_ms(window_ms - used_ms);
+            }
+        }
     }
 }
 
@@ -389,17 +498,17 @@ int main(void)
     /* Initialize all subsystems */
     if (init_subsystems() != 0) {
         /* Initialization failed - indicate error */
-        hal_led_set_state(HAL_LED_BLINK_FAST);
         while (1) {
-            hal_delay_ms(1000);
+            led_set_pattern(LED_PATTERN_ERROR);
+            for (int i = 0; i < 100; i++) {
+                led_patterns_update();
+                hal_delay_ms(10);
+            }
         }
     }
 
-    /* Indicate ready */
-    hal_led_set_state(HAL_LED_ON);
-    hal_delay_ms(CONFIG_LED_ACTIVITY_MS * 10);
-    hal_led_set_state(HAL_LED_OFF);
-    hal_delay_ms(CONFIG_LED_ACTIVITY_MS * 10);
+    /* Indicate ready, then fall back to the idle pattern */
+    led_set_pattern(LED_PATTERN_SUCCESS);
 
     /* Start main loop */
     main_loop();
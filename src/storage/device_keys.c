@@ -0,0 +1,167 @@
+/**
+ * @file device_keys.c
+ * @brief Device Key Hierarchy Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "device_keys.h"
+
+#include <string.h>
+
+#include "hal.h"
+#include "logger.h"
+#include "module_state.h"
+
+/* Largest hardware secret accepted from the HAL */
+#define DEVICE_KEYS_HW_SECRET_MAX 64
+
+/* HKDF info of the root and of each purpose key */
+#define DEVICE_KEYS_LABEL_ROOT "openfido root"
+#define DEVICE_KEYS_LABEL_STORAGE "openfido storage"
+#define DEVICE_KEYS_LABEL_CREDENTIAL_ID "openfido credential-id"
+#define DEVICE_KEYS_LABEL_RP_TAG "openfido rp-tag"
+#define DEVICE_KEYS_LABEL_OATH "openfido oath"
+#define DEVICE_KEYS_LABEL_PIN "openfido pin"
+
+static OPENFIDO_STATE struct {
+    bool ready;    /* Purpose keys loaded */
+    bool has_root; /* Root key derived */
+    uint8_t root[DEVICE_KEYS_KEY_SIZE];
+    crypto_aes_gcm_ctx_t storage;
+    crypto_aes_gcm_ctx_t credential_id;
+    crypto_hmac_ctx_t rp_tag;
+    crypto_hmac_ctx_t oath;
+    crypto_hmac_ctx_t pin;
+} device_keys;
+OPENFIDO_STATE_REGISTER(device_keys);
+
+/**
+ * @brief Derive a purpose key into a GCM context
+ */
+static bool load_gcm_key(const char *label, crypto_aes_gcm_ctx_t *ctx)
+{
+    uint8_t key[DEVICE_KEYS_KEY_SIZE];
+
+    bool ok = device_keys_derive(label, key) == DEVICE_KEYS_OK &&
+              crypto_aes_gcm_ctx_init(ctx, key) == CRYPTO_OK;
+
+    crypto_secure_zero(key, sizeof(key));
+    return ok;
+}
+
+/**
+ * @brief Derive a purpose key into an HMAC context
+ */
+static bool load_hmac_key(const char *label, crypto_hmac_ctx_t *ctx)
+{
+    uint8_t key[DEVICE_KEYS_KEY_SIZE];
+
+    bool ok = device_keys_derive(label, key) == DEVICE_KEYS_OK &&
+              crypto_hmac_ctx_init(ctx, key, sizeof(key)) == CRYPTO_OK;
+
+    crypto_secure_zero(key, sizeof(key));
+    return ok;
+}
+
+int device_keys_init(const uint8_t *seed)
+{
+    if (seed == NULL) {
+        return DEVICE_KEYS_ERROR_INVALID_PARAM;
+    }
+
+    device_keys_clear();
+
+    /* Without a hardware secret the salt is empty and the sealed seed is the root */
+    uint8_t hw_secret[DEVICE_KEYS_HW_SECRET_MAX];
+    size_t hw_secret_len = sizeof(hw_secret);
+    if (hal_get_device_secret(hw_secret, &hw_secret_len) != HAL_OK) {
+        hw_secret_len = 0;
+    }
+
+    int ret = crypto_hkdf_sha256(hw_secret, hw_secret_len, seed, DEVICE_KEYS_SEED_SIZE,
+                                 (const uint8_t *) DEVICE_KEYS_LABEL_ROOT,
+                                 strlen(DEVICE_KEYS_LABEL_ROOT), device_keys.root,
+                                 sizeof(device_keys.root));
+    crypto_secure_zero(hw_secret, sizeof(hw_secret));
+    if (ret != CRYPTO_OK) {
+        LOG_ERROR("Failed to derive device root key");
+        device_keys_clear();
+        return DEVICE_KEYS_ERROR;
+    }
+    device_keys.has_root = true;
+
+    if (!load_gcm_key(DEVICE_KEYS_LABEL_STORAGE, &device_keys.storage) ||
+        !load_gcm_key(DEVICE_KEYS_LABEL_CREDENTIAL_ID, &device_keys.credential_id) ||
+        !load_hmac_key(DEVICE_KEYS_LABEL_RP_TAG, &device_keys.rp_tag) ||
+        !load_hmac_key(DEVICE_KEYS_LABEL_OATH, &device_keys.oath) ||
+        !load_hmac_key(DEVICE_KEYS_LABEL_PIN, &device_keys.pin)) {
+        LOG_ERROR("Failed to derive device purpose keys");
+        device_keys_clear();
+        return DEVICE_KEYS_ERROR;
+    }
+
+    device_keys.ready = true;
+    LOG_DEBUG("Device keys loaded (%s root)", hw_secret_len > 0 ? "hardware-bound" : "sealed");
+    return DEVICE_KEYS_OK;
+}
+
+void device_keys_clear(void)
+{
+    crypto_aes_gcm_ctx_free(&device_keys.storage);
+    crypto_aes_gcm_ctx_free(&device_keys.credential_id);
+    crypto_hmac_ctx_free(&device_keys.rp_tag);
+    crypto_hmac_ctx_free(&device_keys.oath);
+    crypto_hmac_ctx_free(&device_keys.pin);
+    crypto_secure_zero(&device_keys, sizeof(device_keys));
+}
+
+bool device_keys_ready(void)
+{
+    return device_keys.ready;
+}
+
+crypto_aes_gcm_ctx_t *device_keys_storage(void)
+{
+    return device_keys.ready ? &device_keys.storage : NULL;
+}
+
+crypto_aes_gcm_ctx_t *device_keys_credential_id(void)
+{
+    return device_keys.ready ? &device_keys.credential_id : NULL;
+}
+
+const crypto_hmac_ctx_t *device_keys_rp_tag(void)
+{
+    return device_keys.ready ? &device_keys.rp_tag : NULL;
+}
+
+const crypto_hmac_ctx_t *device_keys_oath(void)
+{
+    return device_keys.ready ? &device_keys.oath : NULL;
+}
+
+const crypto_hmac_ctx_t *device_keys_pin(void)
+{
+    return device_keys.ready ? &device_keys.pin : NULL;
+}
+
+int device_keys_derive(const char *label, uint8_t *key)
+{
+    if (label == NULL || key == NULL) {
+        return DEVICE_KEYS_ERROR_INVALID_PARAM;
+    }
+
+    if (!device_keys.has_root) {
+        return DEVICE_KEYS_ERROR;
+    }
+
+    if (crypto_hkdf_sha256(NULL, 0, device_keys.root, sizeof(device_keys.root),
+                           (const uint8_t *) label, strlen(label), key,
+                           DEVICE_KEYS_KEY_SIZE) != CRYPTO_OK) {
+        return DEVICE_KEYS_ERROR;
+    }
+
+    return DEVICE_KEYS_OK;
+}
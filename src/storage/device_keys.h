@@ -0,0 +1,120 @@
+/**
+ * @file device_keys.h
+ * @brief Device Key Hierarchy
+ *
+ * One root key per device, from which every purpose key is derived:
+ *
+ *   root    = HKDF(salt = hardware secret, ikm = seed sealed in flash)
+ *   subkey  = HKDF(ikm = root, info = purpose label)
+ *
+ * The seed is drawn once when storage is formatted, so the hierarchy is
+ * stable across reboots. Where the HAL exposes a device-unique secret it is
+ * mixed in as well, which ties the keys to the chip; on platforms without
+ * one (the host build and the mock HAL) the sealed seed alone is the root.
+ * On STM32 the "secret" is the readable chip UID, so there the keys are only
+ * as confidential as the seed, i.e. as the flash read-out protection.
+ *
+ * The purpose keys are derived once, in device_keys_init(), straight into
+ * ready-to-use cipher and MAC contexts, so callers never pay for a key
+ * derivation or key schedule on the request path.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef DEVICE_KEYS_H
+#define DEVICE_KEYS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "crypto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Device Keys Return Codes */
+#define DEVICE_KEYS_OK 0
+#define DEVICE_KEYS_ERROR -1
+#define DEVICE_KEYS_ERROR_INVALID_PARAM -2
+
+/* Size of the root seed sealed in flash */
+#define DEVICE_KEYS_SEED_SIZE 32
+
+/* Size of keys handed out by device_keys_derive() */
+#define DEVICE_KEYS_KEY_SIZE 32
+
+/**
+ * @brief Derive the root key and all purpose keys
+ *
+ * Replaces any keys loaded before.
+ *
+ * @param seed Root seed sealed in flash (DEVICE_KEYS_SEED_SIZE bytes)
+ * @return DEVICE_KEYS_OK on success, error code otherwise
+ */
+int device_keys_init(const uint8_t *seed);
+
+/**
+ * @brief Wipe the root key and all purpose keys
+ */
+void device_keys_clear(void);
+
+/**
+ * @brief Check whether the purpose keys are loaded
+ */
+bool device_keys_ready(void);
+
+/**
+ * @brief AES-256-GCM key sealing credential records in flash
+ *
+ * @return Loaded context, or NULL before device_keys_init()
+ */
+crypto_aes_gcm_ctx_t *device_keys_storage(void);
+
+/**
+ * @brief AES-256-GCM key wrapping credential IDs handed to relying parties
+ *
+ * @return Loaded context, or NULL before device_keys_init()
+ */
+crypto_aes_gcm_ctx_t *device_keys_credential_id(void);
+
+/**
+ * @brief HMAC key tagging stored credentials with their relying party
+ *
+ * @return Loaded context, or NULL before device_keys_init()
+ */
+const crypto_hmac_ctx_t *device_keys_rp_tag(void);
+
+/**
+ * @brief HMAC key for OATH credential secrets
+ *
+ * @return Loaded context, or NULL before device_keys_init()
+ */
+const crypto_hmac_ctx_t *device_keys_oath(void);
+
+/**
+ * @brief HMAC key binding the stored PIN verifier to this device
+ *
+ * @return Loaded context, or NULL before device_keys_init()
+ */
+const crypto_hmac_ctx_t *device_keys_pin(void);
+
+/**
+ * @brief Derive an ad-hoc key from the root
+ *
+ * For keys that are not needed on every boot; the purpose keys above should
+ * be preferred.
+ *
+ * @param label Purpose label (HKDF info)
+ * @param key Output key (DEVICE_KEYS_KEY_SIZE bytes)
+ * @return DEVICE_KEYS_OK on success, error code otherwise
+ */
+int device_keys_derive(const char *label, uint8_t *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEVICE_KEYS_H */
@@ -12,51 +12,422 @@
 
 #include "buffer.h"
 #include "crypto.h"
+#include "device_keys.h"
 #include "hal.h"
+#include "idle_scheduler.h"
 #include "logger.h"
+#include "module_state.h"
+#include "resume_state.h"
+#include "trace.h"
 
 /* Storage layout in flash */
 #define STORAGE_MAGIC 0x46494432 /* "FID2" */
-#define STORAGE_VERSION 1
+#define STORAGE_VERSION 2
 
 #define STORAGE_OFFSET_HEADER 0
 #define STORAGE_OFFSET_PIN 256
 #define STORAGE_OFFSET_COUNTER 512
 #define STORAGE_OFFSET_ATT_KEY 768
+#define STORAGE_OFFSET_ATT_CERT 1024 /* Length word, then the DER chain */
 #define STORAGE_OFFSET_CREDS 2048
 
 #define STORAGE_CRED_SIZE 512
 
+#define STORAGE_SECTOR_SIZE 4096
+
+/* Large-blob slots: header, then the serialized array */
+#define STORAGE_OFFSET_LARGE_BLOB 40960
+#define STORAGE_LARGE_BLOB_SLOT_SIZE 8192
+#define STORAGE_LARGE_BLOB_MAGIC 0x424C4F42 /* "BLOB" */
+
+/* Verified-boot records: kept by storage_format(), which erases everything below */
+#define STORAGE_OFFSET_BOOT 57344
+#define STORAGE_OFFSET_BOOT_STATE STORAGE_OFFSET_BOOT
+#define STORAGE_OFFSET_BOOT_IMAGES (STORAGE_OFFSET_BOOT + STORAGE_BOOT_STATE_MAX_SIZE)
+#define STORAGE_OFFSET_BOOT_MEASUREMENT (STORAGE_OFFSET_BOOT + STORAGE_SECTOR_SIZE)
+
+/*
+ * Credential record, version 2. The cleartext header carries the format
+ * version, the credProtect level, the RP tag and the ciphertext length, and
+ * is bound to the ciphertext as AAD. The plaintext is a fixed part
+ *
+ *   rp_id_hash[32] | private_key[32] | flags | user_id_len | user_id
+ *
+ * followed by optional (type, length, value) fields, written only when
+ * present. Unknown field types are skipped on read.
+ */
+#define STORAGE_CRED_RECORD_VERSION 2
+#define STORAGE_CRED_RP_TAG_SIZE 8
+#define STORAGE_CRED_DATA_SIZE 400
+#define STORAGE_CRED_OFFSET_FLAGS 64
+#define STORAGE_CRED_FIXED_SIZE 66
+#define STORAGE_CRED_RP_ID_MAX 32 /* Stored copy of the RP ID, truncated beyond this */
+
+/* Largest plaintext: every optional field present at its limit */
+#define STORAGE_CRED_PLAINTEXT_MAX                                                         \
+    (STORAGE_CRED_FIXED_SIZE + STORAGE_MAX_USER_ID_LENGTH +                                \
+     2 + (STORAGE_MAX_USER_NAME_LENGTH - 1) + 2 + (STORAGE_MAX_DISPLAY_NAME_LENGTH - 1) + \
+     2 + STORAGE_CRED_RP_ID_MAX + 2 + STORAGE_MAX_CRED_BLOB_LENGTH + 2 + 32 + 2 + 2)
+_Static_assert(STORAGE_CRED_PLAINTEXT_MAX <= STORAGE_CRED_DATA_SIZE,
+               "Largest credential does not fit STORAGE_CRED_DATA_SIZE");
+
+/* Credential flag byte */
+#define STORAGE_CRED_FLAG_RESIDENT 0x01
+#define STORAGE_CRED_FLAG_HMAC_SECRET 0x02
+
+/* Optional credential fields */
+#define STORAGE_CRED_FIELD_USER_NAME 0x01
+#define STORAGE_CRED_FIELD_DISPLAY_NAME 0x02
+#define STORAGE_CRED_FIELD_RP_ID 0x03
+#define STORAGE_CRED_FIELD_CRED_BLOB 0x04
+#define STORAGE_CRED_FIELD_LARGE_BLOB_KEY 0x05
+#define STORAGE_CRED_FIELD_ALGORITHM 0x06
+
+/* The PIN verifier covers LEFT(SHA-256(PIN), 16), the part CTAP2 sends */
+#define STORAGE_PIN_HASH_PREFIX 16
+
+/*
+ * Signature counter reservation. Flash holds an upper bound on every value
+ * handed out, so increments are served from RAM and flash is only written
+ * when the reservation runs low. After a power loss the counter skips ahead
+ * by at most STORAGE_COUNTER_RESERVE, which keeps it strictly monotonic.
+ */
+#define STORAGE_COUNTER_RESERVE 32
+#define STORAGE_COUNTER_LOW_WATER (STORAGE_COUNTER_RESERVE / 2)
+
 /* Storage header */
 typedef struct {
     uint32_t magic;
     uint32_t version;
-    uint8_t master_key[32]; /* Device master key (encrypted by HAL) */
+    uint8_t master_key[32]; /* Root seed of the device key hierarchy */
     uint8_t reserved[216];
 } storage_header_t;
 
 /* Encrypted credential on flash */
 typedef struct {
     uint8_t id[STORAGE_CREDENTIAL_ID_LENGTH];
-    uint8_t encrypted_data[400];
+    uint8_t encrypted_data[STORAGE_CRED_DATA_SIZE];
     uint8_t iv[12];
     uint8_t tag[16];
     uint32_t sign_count;
     bool valid;
-    uint8_t reserved[59];
+    uint8_t version;                          /* STORAGE_CRED_RECORD_VERSION */
+    uint8_t cred_protect;                     /* credProtect level, readable without decrypting */
+    uint16_t data_len;                        /* Bytes of encrypted_data in use */
+    uint8_t rp_tag[STORAGE_CRED_RP_TAG_SIZE]; /* Keyed tag of rp_id_hash */
+    uint8_t reserved[46];
 } storage_flash_credential_t;
 
+/* Large-blob slot header, written last to commit the slot */
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence; /* Higher sequence is the newer slot */
+    uint32_t length;
+    uint32_t reserved;
+} storage_large_blob_header_t;
+
 /* Global storage state */
-static struct {
+static OPENFIDO_STATE struct {
     bool initialized;
     storage_header_t header;
     storage_pin_data_t pin_data;
     uint32_t global_counter;
+    uint32_t counter_reserved; /* Value persisted in flash */
     uint8_t attestation_key[32];
-} storage_state = {0};
+    int counter_task;
+    int large_blob_slot; /* Committed slot, -1 if none */
+    uint32_t large_blob_sequence;
+    size_t large_blob_length;
+    size_t large_blob_pending; /* Length of the array being written, 0 if idle */
+} storage_state = {.counter_task = -1, .large_blob_slot = -1};
+OPENFIDO_STATE_REGISTER(storage_state);
+
+_Static_assert(sizeof(((storage_header_t *) 0)->master_key) == DEVICE_KEYS_SEED_SIZE,
+               "Header seed does not match DEVICE_KEYS_SEED_SIZE");
+
+/*
+ * RAM index of the credential slots. Each ID hashes to a bucket chain, and a
+ * four-byte tag weeds out collisions, so resolving an ID costs one chain walk
+ * and a flash read only for a genuine match.
+ */
+#define STORAGE_CRED_INDEX_BUCKETS 64
+#define STORAGE_CRED_INDEX_NONE 0xFF
 
-/* Device master key for credential encryption */
-static uint8_t device_master_key[32];
+static OPENFIDO_STATE struct {
+    uint8_t bucket[STORAGE_CRED_INDEX_BUCKETS]; /* First slot of each chain */
+    uint8_t next[STORAGE_MAX_CREDENTIALS];      /* Next slot in the same chain */
+    uint32_t tag[STORAGE_MAX_CREDENTIALS];      /* First four bytes of the ID */
+    bool used[STORAGE_MAX_CREDENTIALS];
+} cred_index;
+OPENFIDO_STATE_REGISTER(cred_index);
+
+/**
+ * @brief Write to flash
+ *
+ * Any change to persistent state makes the deep-sleep snapshot stale, so it
+ * is invalidated before the write goes out.
+ */
+static int storage_flash_write(uint32_t offset, const uint8_t *data, size_t len)
+{
+    resume_state_invalidate();
+
+    TRACE_BEGIN(TRACE_SPAN_FLASH_WRITE, 0);
+    int ret = hal_flash_write(offset, data, len);
+    TRACE_END(TRACE_SPAN_FLASH_WRITE);
+    return ret;
+}
+
+/**
+ * @brief Erase a flash sector (invalidates the deep-sleep snapshot)
+ */
+static int storage_flash_erase(uint32_t offset)
+{
+    resume_state_invalidate();
+
+    TRACE_BEGIN(TRACE_SPAN_FLASH_ERASE, 0);
+    int ret = hal_flash_erase(offset);
+    TRACE_END(TRACE_SPAN_FLASH_ERASE);
+    return ret;
+}
+
+/**
+ * @brief Persist a fresh counter reservation
+ *
+ * @return STORAGE_OK on success, error code otherwise
+ */
+static int storage_reserve_counter(void)
+{
+    uint32_t reserved = storage_state.global_counter + STORAGE_COUNTER_RESERVE;
+
+    if (storage_flash_write(STORAGE_OFFSET_COUNTER, (const uint8_t *) &reserved,
+                            sizeof(uint32_t)) != HAL_OK) {
+        LOG_ERROR("Failed to write counter");
+        return STORAGE_ERROR;
+    }
+
+    storage_state.counter_reserved = reserved;
+    return STORAGE_OK;
+}
+
+/**
+ * @brief Idle task: extend the counter reservation before it runs out
+ */
+static idle_task_status_t counter_checkpoint_step(void *context)
+{
+    (void) context;
+
+    if (storage_state.initialized &&
+        storage_state.counter_reserved - storage_state.global_counter <
+            STORAGE_COUNTER_LOW_WATER) {
+        storage_reserve_counter();
+    }
+
+    return IDLE_TASK_DONE;
+}
+
+/**
+ * @brief Register storage background tasks with the idle scheduler
+ */
+static void storage_register_idle_tasks(void)
+{
+    if (storage_state.counter_task >= 0) {
+        return;
+    }
+
+    idle_task_config_t counter_task = {.name = "counter-checkpoint",
+                                       .step = counter_checkpoint_step,
+                                       .context = NULL,
+                                       .priority = IDLE_PRIORITY_HIGH,
+                                       .budget_ms = 5,
+                                       .period_ms = 0};
+    storage_state.counter_task = idle_sched_register(&counter_task);
+}
+
+static uint32_t large_blob_slot_offset(int slot)
+{
+    return STORAGE_OFFSET_LARGE_BLOB + (uint32_t) slot * STORAGE_LARGE_BLOB_SLOT_SIZE;
+}
+
+/**
+ * @brief Find the newest committed large-blob slot (two header reads)
+ */
+static void storage_scan_large_blob(void)
+{
+    storage_state.large_blob_slot = -1;
+    storage_state.large_blob_sequence = 0;
+    storage_state.large_blob_length = 0;
+    storage_state.large_blob_pending = 0;
+
+    for (int slot = 0; slot < 2; slot++) {
+        storage_large_blob_header_t header;
+        if (hal_flash_read(large_blob_slot_offset(slot), (uint8_t *) &header, sizeof(header)) !=
+            HAL_OK) {
+            continue;
+        }
+        if (header.magic != STORAGE_LARGE_BLOB_MAGIC ||
+            header.length > STORAGE_LARGE_BLOB_MAX_SIZE) {
+            continue;
+        }
+        if (storage_state.large_blob_slot < 0 ||
+            (int32_t) (header.sequence - storage_state.large_blob_sequence) > 0) {
+            storage_state.large_blob_slot = slot;
+            storage_state.large_blob_sequence = header.sequence;
+            storage_state.large_blob_length = header.length;
+        }
+    }
+}
+
+/**
+ * @brief Get the index bucket of a credential ID
+ */
+static size_t cred_index_bucket(const uint8_t *id)
+{
+    return id[4] & (STORAGE_CRED_INDEX_BUCKETS - 1);
+}
+
+/**
+ * @brief Get the index tag of a credential ID
+ */
+static uint32_t cred_index_tag(const uint8_t *id)
+{
+    return ((uint32_t) id[0] << 24) | ((uint32_t) id[1] << 16) | ((uint32_t) id[2] << 8) | id[3];
+}
+
+static void cred_index_clear(void)
+{
+    memset(cred_index.bucket, STORAGE_CRED_INDEX_NONE, sizeof(cred_index.bucket));
+    memset(cred_index.next, STORAGE_CRED_INDEX_NONE, sizeof(cred_index.next));
+    memset(cred_index.used, 0, sizeof(cred_index.used));
+}
+
+static void cred_index_add(int slot, const uint8_t *id)
+{
+    size_t bucket = cred_index_bucket(id);
+
+    cred_index.tag[slot] = cred_index_tag(id);
+    cred_index.next[slot] = cred_index.bucket[bucket];
+    cred_index.bucket[bucket] = (uint8_t) slot;
+    cred_index.used[slot] = true;
+}
+
+static void cred_index_remove(int slot, const uint8_t *id)
+{
+    uint8_t *link = &cred_index.bucket[cred_index_bucket(id)];
+
+    while (*link != STORAGE_CRED_INDEX_NONE) {
+        if (*link == slot) {
+            *link = cred_index.next[slot];
+            break;
+        }
+        link = &cred_index.next[*link];
+    }
+
+    cred_index.next[slot] = STORAGE_CRED_INDEX_NONE;
+    cred_index.used[slot] = false;
+}
+
+/**
+ * @brief Read a credential slot
+ *
+ * @return true if the slot holds a live record
+ */
+static bool cred_slot_read(int slot, storage_flash_credential_t *flash_cred)
+{
+    uint32_t offset = STORAGE_OFFSET_CREDS + (slot * STORAGE_CRED_SIZE);
+
+    if (hal_flash_read(offset, (uint8_t *) flash_cred, sizeof(storage_flash_credential_t)) !=
+        HAL_OK) {
+        return false;
+    }
+
+    return flash_cred->valid && flash_cred->version == STORAGE_CRED_RECORD_VERSION;
+}
+
+/**
+ * @brief Rebuild the index from the credential slots (one pass over flash)
+ */
+static void cred_index_build(void)
+{
+    cred_index_clear();
+
+    for (int i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
+        storage_flash_credential_t flash_cred;
+        if (cred_slot_read(i, &flash_cred)) {
+            cred_index_add(i, flash_cred.id);
+        }
+    }
+}
+
+/**
+ * @brief Resolve a credential ID through the index
+ *
+ * @param flash_cred Output record of the matching slot
+ * @return Slot number, or -1 if the ID is not stored
+ */
+static int cred_index_lookup(const uint8_t *id, storage_flash_credential_t *flash_cred)
+{
+    uint32_t tag = cred_index_tag(id);
+
+    for (uint8_t slot = cred_index.bucket[cred_index_bucket(id)];
+         slot != STORAGE_CRED_INDEX_NONE; slot = cred_index.next[slot]) {
+        if (cred_index.tag[slot] == tag && cred_slot_read(slot, flash_cred) &&
+            memcmp(flash_cred->id, id, STORAGE_CREDENTIAL_ID_LENGTH) == 0) {
+            return slot;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Compute the stored PIN verifier
+ *
+ * @param pin_hash LEFT(SHA-256(PIN), 16)
+ * @param verifier Output verifier (32 bytes)
+ */
+static bool pin_verifier(const uint8_t *pin_hash, uint8_t *verifier)
+{
+    const crypto_hmac_ctx_t *key = device_keys_pin();
+
+    return key != NULL && crypto_hmac_ctx_compute(key, pin_hash, STORAGE_PIN_HASH_PREFIX,
+                                                  verifier) == CRYPTO_OK;
+}
+
+/**
+ * @brief Bring a version 1 layout up to the current version in place
+ *
+ * Version 1 drew the credential key at random on every boot, so its records
+ * can never be decrypted again; they fail the record version check and their
+ * slots are reused. The PIN hash is turned into a verifier under the PIN key.
+ */
+static int storage_upgrade(void)
+{
+    LOG_INFO("Upgrading storage from version %u", storage_state.header.version);
+
+    if (storage_state.pin_data.pin_set) {
+        uint8_t verifier[32];
+        if (!pin_verifier(storage_state.pin_data.pin_hash, verifier)) {
+            return STORAGE_ERROR;
+        }
+        memcpy(storage_state.pin_data.pin_hash, verifier, sizeof(verifier));
+        crypto_secure_zero(verifier, sizeof(verifier));
+
+        if (storage_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
+                                sizeof(storage_pin_data_t)) != HAL_OK) {
+            LOG_ERROR("Failed to write PIN data");
+            return STORAGE_ERROR;
+        }
+    }
+
+    storage_state.header.version = STORAGE_VERSION;
+    if (storage_flash_write(STORAGE_OFFSET_HEADER, (const uint8_t *) &storage_state.header,
+                            sizeof(storage_header_t)) != HAL_OK) {
+        LOG_ERROR("Failed to write storage header");
+        return STORAGE_ERROR;
+    }
+
+    return STORAGE_OK;
+}
 
 int storage_init(void)
 {
@@ -75,18 +446,20 @@ int storage_init(void)
         return STORAGE_ERROR;
     }
 
-    /* Check if storage is formatted */
+    /* Check if storage is formatted; formatting loads the device keys */
     if (storage_state.header.magic != STORAGE_MAGIC) {
         LOG_WARN("Storage not formatted, formatting now...");
         if (storage_format() != STORAGE_OK) {
             return STORAGE_ERROR;
         }
+    } else if (storage_state.header.version > STORAGE_VERSION) {
+        LOG_ERROR("Storage version %u is newer than supported", storage_state.header.version);
+        return STORAGE_ERROR;
+    } else if (device_keys_init(storage_state.header.master_key) != DEVICE_KEYS_OK) {
+        LOG_ERROR("Failed to load device keys");
+        return STORAGE_ERROR;
     }
 
-    /* Derive device master key */
-    /* In production, this should use hardware-unique key */
-    crypto_random_generate(device_master_key, sizeof(device_master_key));
-
     /* Read PIN data */
     if (hal_flash_read(STORAGE_OFFSET_PIN, (uint8_t *) &storage_state.pin_data,
                        sizeof(storage_pin_data_t)) != HAL_OK) {
@@ -94,12 +467,18 @@ int storage_init(void)
         return STORAGE_ERROR;
     }
 
+    if (storage_state.header.version < STORAGE_VERSION && storage_upgrade() != STORAGE_OK) {
+        return STORAGE_ERROR;
+    }
+
     /* Read global counter */
     if (hal_flash_read(STORAGE_OFFSET_COUNTER, (uint8_t *) &storage_state.global_counter,
                        sizeof(uint32_t)) != HAL_OK) {
         LOG_ERROR("Failed to read global counter");
         return STORAGE_ERROR;
     }
+    storage_state.counter_reserved = storage_state.global_counter;
+    storage_register_idle_tasks();
 
     /* Read attestation key */
     if (hal_flash_read(STORAGE_OFFSET_ATT_KEY, storage_state.attestation_key,
@@ -108,6 +487,9 @@ int storage_init(void)
         return STORAGE_ERROR;
     }
 
+    storage_scan_large_blob();
+    cred_index_build();
+
     storage_state.initialized = true;
     LOG_INFO("Storage initialized successfully");
 
@@ -118,22 +500,33 @@ int storage_format(void)
 {
     LOG_INFO("Formatting storage");
 
-    /* Erase all storage sectors */
-    for (uint32_t offset = 0; offset < 64 * 1024; offset += 4096) {
-        if (hal_flash_erase(offset) != HAL_OK) {
+    /* Erase all storage sectors up to the verified-boot records */
+    for (uint32_t offset = 0; offset < STORAGE_OFFSET_BOOT; offset += STORAGE_SECTOR_SIZE) {
+        if (storage_flash_erase(offset) != HAL_OK) {
             LOG_ERROR("Failed to erase flash at offset %u", offset);
             return STORAGE_ERROR;
         }
     }
 
+    storage_state.large_blob_slot = -1;
+    storage_state.large_blob_length = 0;
+    storage_state.large_blob_pending = 0;
+    cred_index_clear();
+
     /* Initialize header */
     storage_state.header.magic = STORAGE_MAGIC;
     storage_state.header.version = STORAGE_VERSION;
     crypto_random_generate(storage_state.header.master_key, 32);
 
+    /* A fresh seed rotates every device key, so nothing sealed before survives */
+    if (device_keys_init(storage_state.header.master_key) != DEVICE_KEYS_OK) {
+        LOG_ERROR("Failed to load device keys");
+        return STORAGE_ERROR;
+    }
+
     /* Write header */
-    if (hal_flash_write(STORAGE_OFFSET_HEADER, (const uint8_t *) &storage_state.header,
-                        sizeof(storage_header_t)) != HAL_OK) {
+    if (storage_flash_write(STORAGE_OFFSET_HEADER, (const uint8_t *) &storage_state.header,
+                            sizeof(storage_header_t)) != HAL_OK) {
         LOG_ERROR("Failed to write storage header");
         return STORAGE_ERROR;
     }
@@ -143,16 +536,18 @@ int storage_format(void)
     storage_state.pin_data.pin_retries = STORAGE_PIN_MAX_RETRIES;
     storage_state.pin_data.pin_set = false;
 
-    if (hal_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
-                        sizeof(storage_pin_data_t)) != HAL_OK) {
+    if (storage_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
+                            sizeof(storage_pin_data_t)) != HAL_OK) {
         LOG_ERROR("Failed to write PIN data");
         return STORAGE_ERROR;
     }
 
     /* Initialize counter */
     storage_state.global_counter = 0;
-    if (hal_flash_write(STORAGE_OFFSET_COUNTER, (const uint8_t *) &storage_state.global_counter,
-                        sizeof(uint32_t)) != HAL_OK) {
+    storage_state.counter_reserved = 0;
+    if (storage_flash_write(STORAGE_OFFSET_COUNTER,
+                            (const uint8_t *) &storage_state.global_counter,
+                            sizeof(uint32_t)) != HAL_OK) {
         LOG_ERROR("Failed to write counter");
         return STORAGE_ERROR;
     }
@@ -161,8 +556,8 @@ int storage_format(void)
     uint8_t public_key[64];
     crypto_ecdsa_generate_keypair(storage_state.attestation_key, public_key);
 
-    if (hal_flash_write(STORAGE_OFFSET_ATT_KEY, storage_state.attestation_key,
-                        sizeof(storage_state.attestation_key)) != HAL_OK) {
+    if (storage_flash_write(STORAGE_OFFSET_ATT_KEY, storage_state.attestation_key,
+                            sizeof(storage_state.attestation_key)) != HAL_OK) {
         LOG_ERROR("Failed to write attestation key");
         return STORAGE_ERROR;
     }
@@ -171,206 +566,635 @@ int storage_format(void)
     return STORAGE_OK;
 }
 
-int storage_store_credential(const storage_credential_t *credential)
+/**
+ * @brief Append an optional field to a credential plaintext
+ *
+ * Empty fields take no space.
+ *
+ * @return false if the field does not fit
+ */
+static bool credential_put_field(uint8_t *plaintext, size_t *offset, uint8_t type,
+                                 const void *value, size_t len)
 {
-    if (!storage_state.initialized || credential == NULL) {
-        return STORAGE_ERROR_INVALID_PARAM;
+    if (len == 0) {
+        return true;
     }
 
-    /* Find free slot */
-    int free_slot = -1;
-    for (int i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
-        storage_flash_credential_t flash_cred;
-        uint32_t offset = STORAGE_OFFSET_CREDS + (i * STORAGE_CRED_SIZE);
+    if (len > 0xFF || *offset + 2 + len > STORAGE_CRED_DATA_SIZE) {
+        return false;
+    }
 
-        if (hal_flash_read(offset, (uint8_t *) &flash_cred, sizeof(storage_flash_credential_t)) !=
-            HAL_OK) {
-            continue;
-        }
+    plaintext[(*offset)++] = type;
+    plaintext[(*offset)++] = (uint8_t) len;
+    memcpy(&plaintext[*offset], value, len);
+    *offset += len;
 
-        if (!flash_cred.valid) {
-            free_slot = i;
-            break;
-        }
+    return true;
+}
+
+/**
+ * @brief Append a NUL-terminated text field of at most @p size - 1 characters
+ */
+static bool credential_put_text(uint8_t *plaintext, size_t *offset, uint8_t type, const char *text,
+                                size_t size)
+{
+    size_t len = 0;
+    while (len < size - 1 && text[len] != '\0') {
+        len++;
     }
 
-    if (free_slot == -1) {
-        LOG_ERROR("No free credential slots");
-        return STORAGE_ERROR_FULL;
+    return credential_put_field(plaintext, offset, type, text, len);
+}
+
+/**
+ * @brief Append the RP ID, truncated to STORAGE_CRED_RP_ID_MAX bytes
+ *
+ * Lookups go by rp_id_hash, so the stored copy only names the RP in
+ * credential management. A longer ID keeps its leading characters and ends
+ * in U+2026, the truncation CTAP 2.1 allows for stored RP IDs.
+ */
+static bool credential_put_rp_id(uint8_t *plaintext, size_t *offset, const char *rp_id)
+{
+    static const char ellipsis[] = "\xE2\x80\xA6";
+    char stored[STORAGE_CRED_RP_ID_MAX];
+
+    size_t len = 0;
+    while (len < STORAGE_MAX_RP_ID_LENGTH - 1 && rp_id[len] != '\0') {
+        len++;
     }
 
-    /* Prepare flash credential */
-    storage_flash_credential_t flash_cred = {0};
-    memcpy(flash_cred.id, credential->id, STORAGE_CREDENTIAL_ID_LENGTH);
-    flash_cred.sign_count = credential->sign_count;
-    flash_cred.valid = true;
+    if (len <= STORAGE_CRED_RP_ID_MAX) {
+        return credential_put_field(plaintext, offset, STORAGE_CRED_FIELD_RP_ID, rp_id, len);
+    }
 
-    /* Generate random IV */
-    crypto_random_generate(flash_cred.iv, sizeof(flash_cred.iv));
+    /* Cut on a UTF-8 character boundary */
+    size_t keep = STORAGE_CRED_RP_ID_MAX - (sizeof(ellipsis) - 1);
+    while (keep > 0 && ((uint8_t) rp_id[keep] & 0xC0) == 0x80) {
+        keep--;
+    }
+    memcpy(stored, rp_id, keep);
+    memcpy(&stored[keep], ellipsis, sizeof(ellipsis) - 1);
 
-    /* Serialize credential data */
-    uint8_t plaintext[400];
+    return credential_put_field(plaintext, offset, STORAGE_CRED_FIELD_RP_ID, stored,
+                                keep + sizeof(ellipsis) - 1);
+}
+
+/**
+ * @brief Serialize a credential into the record plaintext
+ *
+ * @return STORAGE_OK, or STORAGE_ERROR_INVALID_PARAM if it does not fit
+ */
+static int credential_serialize(const storage_credential_t *credential, uint8_t *plaintext,
+                                size_t *len)
+{
     size_t offset = 0;
 
+    if (credential->user_id_len > STORAGE_MAX_USER_ID_LENGTH ||
+        credential->cred_blob_len > STORAGE_MAX_CRED_BLOB_LENGTH) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
     memcpy(&plaintext[offset], credential->rp_id_hash, 32);
     offset += 32;
 
+    memcpy(&plaintext[offset], credential->private_key, 32);
+    offset += 32;
+
+    plaintext[offset++] = (credential->resident ? STORAGE_CRED_FLAG_RESIDENT : 0) |
+                          (credential->hmac_secret ? STORAGE_CRED_FLAG_HMAC_SECRET : 0);
+
+    plaintext[offset++] = (uint8_t) credential->user_id_len;
     memcpy(&plaintext[offset], credential->user_id, credential->user_id_len);
     offset += credential->user_id_len;
 
-    plaintext[offset++] = credential->user_id_len;
+    bool ok = true;
 
-    memcpy(&plaintext[offset], credential->private_key, 32);
-    offset += 32;
+    if (credential->resident) {
+        ok = credential_put_text(plaintext, &offset, STORAGE_CRED_FIELD_USER_NAME,
+                                 credential->user_name, sizeof(credential->user_name)) &&
+             credential_put_text(plaintext, &offset, STORAGE_CRED_FIELD_DISPLAY_NAME,
+                                 credential->display_name, sizeof(credential->display_name)) &&
+             credential_put_rp_id(plaintext, &offset, credential->rp_id);
+    }
 
-    plaintext[offset++] = credential->resident ? 1 : 0;
+    ok = ok && credential_put_field(plaintext, &offset, STORAGE_CRED_FIELD_CRED_BLOB,
+                                    credential->cred_blob, credential->cred_blob_len);
 
-    if (credential->resident) {
-        strncpy((char *) &plaintext[offset], credential->user_name, STORAGE_MAX_USER_NAME_LENGTH);
-        offset += STORAGE_MAX_USER_NAME_LENGTH;
+    if (ok && credential->has_large_blob_key) {
+        ok = credential_put_field(plaintext, &offset, STORAGE_CRED_FIELD_LARGE_BLOB_KEY,
+                                  credential->large_blob_key, 32);
+    }
+
+    if (ok && credential->algorithm != 0) {
+        uint8_t alg[2] = {((uint16_t) credential->algorithm >> 8) & 0xFF,
+                          (uint16_t) credential->algorithm & 0xFF};
+        ok = credential_put_field(plaintext, &offset, STORAGE_CRED_FIELD_ALGORITHM, alg,
+                                  sizeof(alg));
+    }
+
+    if (!ok) {
+        LOG_ERROR("Credential record too large");
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    *len = offset;
+    return STORAGE_OK;
+}
+
+/**
+ * @brief Copy a stored text field, truncating to the destination
+ */
+static void credential_copy_text(char *dst, size_t dst_size, const uint8_t *src, size_t len)
+{
+    if (len > dst_size - 1) {
+        len = dst_size - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+/**
+ * @brief Rebuild a credential from its record
+ *
+ * @return STORAGE_OK, or STORAGE_ERROR_CORRUPTED if the plaintext is malformed
+ */
+static int credential_deserialize(const storage_flash_credential_t *flash_cred,
+                                  const uint8_t *plaintext, size_t len,
+                                  storage_credential_t *credential)
+{
+    memset(credential, 0, sizeof(*credential));
+
+    if (len < STORAGE_CRED_FIXED_SIZE) {
+        return STORAGE_ERROR_CORRUPTED;
+    }
+
+    memcpy(credential->rp_id_hash, &plaintext[0], 32);
+    memcpy(credential->private_key, &plaintext[32], 32);
+    credential->resident = (plaintext[STORAGE_CRED_OFFSET_FLAGS] & STORAGE_CRED_FLAG_RESIDENT) != 0;
+    credential->hmac_secret =
+        (plaintext[STORAGE_CRED_OFFSET_FLAGS] & STORAGE_CRED_FLAG_HMAC_SECRET) != 0;
+
+    credential->user_id_len = plaintext[STORAGE_CRED_FIXED_SIZE - 1];
+    if (credential->user_id_len > STORAGE_MAX_USER_ID_LENGTH ||
+        STORAGE_CRED_FIXED_SIZE + credential->user_id_len > len) {
+        return STORAGE_ERROR_CORRUPTED;
+    }
+    memcpy(credential->user_id, &plaintext[STORAGE_CRED_FIXED_SIZE], credential->user_id_len);
+
+    size_t offset = STORAGE_CRED_FIXED_SIZE + credential->user_id_len;
+    while (offset < len) {
+        if (offset + 2 > len || offset + 2 + plaintext[offset + 1] > len) {
+            return STORAGE_ERROR_CORRUPTED;
+        }
+
+        uint8_t type = plaintext[offset];
+        size_t field_len = plaintext[offset + 1];
+        const uint8_t *value = &plaintext[offset + 2];
+
+        switch (type) {
+            case STORAGE_CRED_FIELD_USER_NAME:
+                credential_copy_text(credential->user_name, sizeof(credential->user_name), value,
+                                     field_len);
+                break;
+
+            case STORAGE_CRED_FIELD_DISPLAY_NAME:
+                credential_copy_text(credential->display_name, sizeof(credential->display_name),
+                                     value, field_len);
+                break;
+
+            case STORAGE_CRED_FIELD_RP_ID:
+                credential_copy_text(credential->rp_id, sizeof(credential->rp_id), value,
+                                     field_len);
+                break;
+
+            case STORAGE_CRED_FIELD_CRED_BLOB:
+                if (field_len > sizeof(credential->cred_blob)) {
+                    return STORAGE_ERROR_CORRUPTED;
+                }
+                memcpy(credential->cred_blob, value, field_len);
+                credential->cred_blob_len = field_len;
+                break;
+
+            case STORAGE_CRED_FIELD_LARGE_BLOB_KEY:
+                if (field_len != sizeof(credential->large_blob_key)) {
+                    return STORAGE_ERROR_CORRUPTED;
+                }
+                memcpy(credential->large_blob_key, value, field_len);
+                credential->has_large_blob_key = true;
+                break;
+
+            case STORAGE_CRED_FIELD_ALGORITHM:
+                if (field_len != 2) {
+                    return STORAGE_ERROR_CORRUPTED;
+                }
+                credential->algorithm = (int16_t) (((uint16_t) value[0] << 8) | value[1]);
+                break;
+
+            default:
+                /* Written by newer firmware */
+                break;
+        }
+
+        offset += 2 + field_len;
+    }
+
+    memcpy(credential->id, flash_cred->id, STORAGE_CREDENTIAL_ID_LENGTH);
+    credential->sign_count = flash_cred->sign_count;
+    credential->protection_policy = flash_cred->cred_protect;
+
+    return STORAGE_OK;
+}
+
+/* AAD: ID | version | credProtect | RP tag */
+#define STORAGE_CRED_AAD_SIZE (STORAGE_CREDENTIAL_ID_LENGTH + 2 + STORAGE_CRED_RP_TAG_SIZE)
+
+/**
+ * @brief Build the AAD binding a record's cleartext header to its ciphertext
+ */
+static void credential_aad(const storage_flash_credential_t *flash_cred, uint8_t *aad)
+{
+    memcpy(aad, flash_cred->id, STORAGE_CREDENTIAL_ID_LENGTH);
+    aad[STORAGE_CREDENTIAL_ID_LENGTH] = flash_cred->version;
+    aad[STORAGE_CREDENTIAL_ID_LENGTH + 1] = flash_cred->cred_protect;
+    memcpy(&aad[STORAGE_CREDENTIAL_ID_LENGTH + 2], flash_cred->rp_tag, STORAGE_CRED_RP_TAG_SIZE);
+}
+
+/**
+ * @brief Compute the RP tag stored in a record's cleartext header
+ *
+ * Lets lookups by relying party skip other parties' records without
+ * decrypting them, while the header reveals nothing about the RP ID.
+ */
+static bool credential_rp_tag(const uint8_t *rp_id_hash, uint8_t *rp_tag)
+{
+    const crypto_hmac_ctx_t *key = device_keys_rp_tag();
+    uint8_t mac[CRYPTO_SHA256_DIGEST_SIZE];
+
+    if (key == NULL || crypto_hmac_ctx_compute(key, rp_id_hash, 32, mac) != CRYPTO_OK) {
+        return false;
+    }
 
-        strncpy((char *) &plaintext[offset], credential->display_name,
-                STORAGE_MAX_DISPLAY_NAME_LENGTH);
-        offset += STORAGE_MAX_DISPLAY_NAME_LENGTH;
+    memcpy(rp_tag, mac, STORAGE_CRED_RP_TAG_SIZE);
+    return true;
+}
+
+/**
+ * @brief Decrypt a credential record
+ *
+ * @param plaintext Output buffer (STORAGE_CRED_DATA_SIZE bytes)
+ * @return STORAGE_OK, or STORAGE_ERROR_CORRUPTED
+ */
+static int credential_decrypt(const storage_flash_credential_t *flash_cred, uint8_t *plaintext)
+{
+    uint8_t aad[STORAGE_CRED_AAD_SIZE];
+
+    if (flash_cred->version != STORAGE_CRED_RECORD_VERSION ||
+        flash_cred->data_len > STORAGE_CRED_DATA_SIZE) {
+        return STORAGE_ERROR_CORRUPTED;
+    }
+
+    credential_aad(flash_cred, aad);
+
+    TRACE_BEGIN(TRACE_SPAN_DECRYPT, 0);
+    int ret = crypto_aes_gcm_ctx_decrypt(device_keys_storage(), flash_cred->iv, aad, sizeof(aad),
+                                         flash_cred->encrypted_data, flash_cred->data_len,
+                                         flash_cred->tag, plaintext);
+    TRACE_END(TRACE_SPAN_DECRYPT);
+
+    return ret == CRYPTO_OK ? STORAGE_OK : STORAGE_ERROR_CORRUPTED;
+}
+
+/**
+ * @brief Decrypt and deserialize a credential record
+ */
+static int credential_load(const storage_flash_credential_t *flash_cred,
+                           storage_credential_t *credential)
+{
+    uint8_t plaintext[STORAGE_CRED_DATA_SIZE];
+
+    int ret = credential_decrypt(flash_cred, plaintext);
+    if (ret == STORAGE_OK) {
+        ret = credential_deserialize(flash_cred, plaintext, flash_cred->data_len, credential);
+    }
+
+    secure_zero(plaintext, sizeof(plaintext));
+    return ret;
+}
+
+/**
+ * @brief Build the encrypted flash record of a credential
+ */
+static int credential_seal(const storage_credential_t *credential,
+                           storage_flash_credential_t *flash_cred)
+{
+    memset(flash_cred, 0, sizeof(*flash_cred));
+    memcpy(flash_cred->id, credential->id, STORAGE_CREDENTIAL_ID_LENGTH);
+    flash_cred->sign_count = credential->sign_count;
+    flash_cred->valid = true;
+    flash_cred->version = STORAGE_CRED_RECORD_VERSION;
+    flash_cred->cred_protect = (credential->protection_policy != 0)
+                                   ? credential->protection_policy
+                                   : STORAGE_CRED_PROTECT_UV_OPTIONAL;
+
+    if (!credential_rp_tag(credential->rp_id_hash, flash_cred->rp_tag)) {
+        return STORAGE_ERROR;
+    }
 
-        strncpy((char *) &plaintext[offset], credential->rp_id, STORAGE_MAX_RP_ID_LENGTH);
-        offset += STORAGE_MAX_RP_ID_LENGTH;
+    /* Serialize credential data */
+    uint8_t plaintext[STORAGE_CRED_DATA_SIZE];
+    size_t plaintext_len = 0;
+
+    int ret = credential_serialize(credential, plaintext, &plaintext_len);
+    if (ret != STORAGE_OK) {
+        secure_zero(plaintext, sizeof(plaintext));
+        return ret;
     }
+    flash_cred->data_len = (uint16_t) plaintext_len;
 
-    /* Encrypt credential */
-    if (crypto_aes_gcm_encrypt(device_master_key, flash_cred.iv, credential->rp_id_hash, 32,
-                               plaintext, offset, flash_cred.encrypted_data,
-                               flash_cred.tag) != CRYPTO_OK) {
+    /* Generate random IV */
+    crypto_random_generate(flash_cred->iv, sizeof(flash_cred->iv));
+
+    /* Encrypt credential, binding the cleartext header */
+    uint8_t aad[STORAGE_CRED_AAD_SIZE];
+    credential_aad(flash_cred, aad);
+    ret = crypto_aes_gcm_ctx_encrypt(device_keys_storage(), flash_cred->iv, aad, sizeof(aad),
+                                     plaintext, plaintext_len, flash_cred->encrypted_data,
+                                     flash_cred->tag);
+    secure_zero(plaintext, sizeof(plaintext));
+    if (ret != CRYPTO_OK) {
         LOG_ERROR("Failed to encrypt credential");
         return STORAGE_ERROR;
     }
 
+    return STORAGE_OK;
+}
+
+int storage_store_credential(const storage_credential_t *credential)
+{
+    if (!storage_state.initialized || credential == NULL) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    /* Find free slot */
+    int free_slot = -1;
+    for (int i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
+        if (!cred_index.used[i]) {
+            free_slot = i;
+            break;
+        }
+    }
+
+    if (free_slot == -1) {
+        LOG_ERROR("No free credential slots");
+        return STORAGE_ERROR_FULL;
+    }
+
+    storage_flash_credential_t flash_cred;
+    int ret = credential_seal(credential, &flash_cred);
+    if (ret != STORAGE_OK) {
+        return ret;
+    }
+
     /* Write to flash */
     uint32_t flash_offset = STORAGE_OFFSET_CREDS + (free_slot * STORAGE_CRED_SIZE);
-    if (hal_flash_write(flash_offset, (const uint8_t *) &flash_cred,
-                        sizeof(storage_flash_credential_t)) != HAL_OK) {
+    if (storage_flash_write(flash_offset, (const uint8_t *) &flash_cred,
+                            sizeof(storage_flash_credential_t)) != HAL_OK) {
         LOG_ERROR("Failed to write credential to flash");
         return STORAGE_ERROR;
     }
-
-    /* Clean up sensitive data */
-    secure_zero(plaintext, sizeof(plaintext));
+    cred_index_add(free_slot, flash_cred.id);
 
     LOG_INFO("Stored credential in slot %d", free_slot);
     return STORAGE_OK;
 }
 
-int storage_find_credential(const uint8_t *credential_id, storage_credential_t *credential)
+int storage_store_credentials(const storage_credential_t *credentials, size_t count,
+                              size_t *stored)
 {
-    if (!storage_state.initialized || credential_id == NULL || credential == NULL) {
+    uint8_t slots[STORAGE_MAX_CREDENTIALS];
+    size_t free_count = 0;
+    size_t written = 0;
+    int ret = STORAGE_OK;
+
+    if (!storage_state.initialized || credentials == NULL || stored == NULL || count == 0 ||
+        count > STORAGE_MAX_CREDENTIALS) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    *stored = 0;
+
+    /* Claim free slots in ascending order so the batch is one sequential run */
+    for (int i = 0; i < STORAGE_MAX_CREDENTIALS && free_count < count; i++) {
+        if (!cred_index.used[i]) {
+            slots[free_count++] = (uint8_t) i;
+        }
+    }
+
+    if (free_count < count) {
+        LOG_ERROR("Not enough free credential slots (%zu of %zu)", free_count, count);
+        return STORAGE_ERROR_FULL;
+    }
+
+    for (; written < count; written++) {
+        storage_flash_credential_t flash_cred;
+
+        ret = credential_seal(&credentials[written], &flash_cred);
+        if (ret != STORAGE_OK) {
+            break;
+        }
+
+        if (storage_flash_write(STORAGE_OFFSET_CREDS + (slots[written] * STORAGE_CRED_SIZE),
+                                (const uint8_t *) &flash_cred,
+                                sizeof(storage_flash_credential_t)) != HAL_OK) {
+            LOG_ERROR("Failed to write credential to flash");
+            ret = STORAGE_ERROR;
+            break;
+        }
+    }
+
+    /* Index the run once it is on flash */
+    for (size_t n = 0; n < written; n++) {
+        cred_index_add(slots[n], credentials[n].id);
+    }
+    *stored = written;
+
+    LOG_INFO("Stored %zu credentials from slot %u", written, (unsigned) slots[0]);
+    return ret;
+}
+
+/* Export record: ID | sign count (BE) | credProtect | record plaintext */
+#define STORAGE_CRED_EXPORT_HEADER_SIZE (STORAGE_CREDENTIAL_ID_LENGTH + 5)
+
+_Static_assert(STORAGE_CRED_EXPORT_HEADER_SIZE + STORAGE_CRED_DATA_SIZE <=
+                   STORAGE_CRED_EXPORT_MAX_SIZE,
+               "Export record does not fit STORAGE_CRED_EXPORT_MAX_SIZE");
+
+int storage_export_credential(size_t *cursor, uint8_t *record, size_t *record_len)
+{
+    if (!storage_state.initialized || cursor == NULL || record == NULL || record_len == NULL) {
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
-    /* Search all slots */
-    for (int i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
+    for (size_t slot = *cursor; slot < STORAGE_MAX_CREDENTIALS; slot++) {
         storage_flash_credential_t flash_cred;
-        uint32_t offset = STORAGE_OFFSET_CREDS + (i * STORAGE_CRED_SIZE);
 
-        if (hal_flash_read(offset, (uint8_t *) &flash_cred, sizeof(storage_flash_credential_t)) !=
-            HAL_OK) {
+        if (!cred_index.used[slot] || !cred_slot_read((int) slot, &flash_cred)) {
             continue;
         }
 
-        if (!flash_cred.valid) {
+        /* Unreadable records are left behind rather than failing the export */
+        uint8_t *plaintext = &record[STORAGE_CRED_EXPORT_HEADER_SIZE];
+        if (credential_decrypt(&flash_cred, plaintext) != STORAGE_OK) {
+            LOG_WARN("Skipping unreadable credential in slot %u", (unsigned) slot);
             continue;
         }
 
-        /* Check if ID matches */
-        if (memcmp(flash_cred.id, credential_id, STORAGE_CREDENTIAL_ID_LENGTH) == 0) {
-            /* Found it - decrypt */
-            uint8_t plaintext[400];
+        memcpy(record, flash_cred.id, STORAGE_CREDENTIAL_ID_LENGTH);
+        record[STORAGE_CREDENTIAL_ID_LENGTH] = (uint8_t) (flash_cred.sign_count >> 24);
+        record[STORAGE_CREDENTIAL_ID_LENGTH + 1] = (uint8_t) (flash_cred.sign_count >> 16);
+        record[STORAGE_CREDENTIAL_ID_LENGTH + 2] = (uint8_t) (flash_cred.sign_count >> 8);
+        record[STORAGE_CREDENTIAL_ID_LENGTH + 3] = (uint8_t) flash_cred.sign_count;
+        record[STORAGE_CREDENTIAL_ID_LENGTH + 4] = flash_cred.cred_protect;
+
+        *record_len = STORAGE_CRED_EXPORT_HEADER_SIZE + flash_cred.data_len;
+        *cursor = slot + 1;
+        return STORAGE_OK;
+    }
 
-            if (crypto_aes_gcm_decrypt(device_master_key, flash_cred.iv, NULL,
-                                       0, /* AAD will be in credential */
-                                       flash_cred.encrypted_data, sizeof(flash_cred.encrypted_data),
-                                       flash_cred.tag, plaintext) != CRYPTO_OK) {
-                LOG_ERROR("Failed to decrypt credential");
-                return STORAGE_ERROR_CORRUPTED;
-            }
+    *cursor = STORAGE_MAX_CREDENTIALS;
+    return STORAGE_ERROR_NOT_FOUND;
+}
 
-            /* Deserialize */
-            size_t off = 0;
-            memcpy(credential->rp_id_hash, &plaintext[off], 32);
-            off += 32;
+int storage_import_credential(const uint8_t *record, size_t record_len, bool *stored)
+{
+    storage_flash_credential_t header;
+    storage_credential_t credential;
+    const uint8_t *plaintext = &record[STORAGE_CRED_EXPORT_HEADER_SIZE];
 
-            /* Read user_id_len first */
-            credential->user_id_len = plaintext[off + STORAGE_MAX_USER_ID_LENGTH];
+    if (stored != NULL) {
+        *stored = false;
+    }
 
-            memcpy(credential->user_id, &plaintext[off], credential->user_id_len);
-            off += credential->user_id_len + 1;
+    if (!storage_state.initialized || record == NULL) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
 
-            memcpy(credential->private_key, &plaintext[off], 32);
-            off += 32;
+    if (record_len < STORAGE_CRED_EXPORT_HEADER_SIZE ||
+        record_len > STORAGE_CRED_EXPORT_HEADER_SIZE + STORAGE_CRED_DATA_SIZE) {
+        return STORAGE_ERROR_CORRUPTED;
+    }
 
-            credential->resident = (plaintext[off++] == 1);
+    memset(&header, 0, sizeof(header));
+    memcpy(header.id, record, STORAGE_CREDENTIAL_ID_LENGTH);
+    header.sign_count = ((uint32_t) record[STORAGE_CREDENTIAL_ID_LENGTH] << 24) |
+                        ((uint32_t) record[STORAGE_CREDENTIAL_ID_LENGTH + 1] << 16) |
+                        ((uint32_t) record[STORAGE_CREDENTIAL_ID_LENGTH + 2] << 8) |
+                        record[STORAGE_CREDENTIAL_ID_LENGTH + 3];
+    header.cred_protect = record[STORAGE_CRED_EXPORT_HEADER_SIZE - 1];
 
-            if (credential->resident) {
-                strncpy(credential->user_name, (const char *) &plaintext[off],
-                        STORAGE_MAX_USER_NAME_LENGTH);
-                off += STORAGE_MAX_USER_NAME_LENGTH;
+    if (cred_index_lookup(header.id, &header) >= 0) {
+        LOG_DEBUG("Credential already stored, skipping import");
+        return STORAGE_OK;
+    }
 
-                strncpy(credential->display_name, (const char *) &plaintext[off],
-                        STORAGE_MAX_DISPLAY_NAME_LENGTH);
-                off += STORAGE_MAX_DISPLAY_NAME_LENGTH;
+    /* Parse before storing so a bad record never reaches flash */
+    int ret = credential_deserialize(&header, plaintext,
+                                     record_len - STORAGE_CRED_EXPORT_HEADER_SIZE, &credential);
+    if (ret == STORAGE_OK) {
+        ret = storage_store_credential(&credential);
+    }
+    if (ret == STORAGE_OK && stored != NULL) {
+        *stored = true;
+    }
 
-                strncpy(credential->rp_id, (const char *) &plaintext[off],
-                        STORAGE_MAX_RP_ID_LENGTH);
-            }
+    secure_zero(&credential, sizeof(credential));
+    return ret;
+}
 
-            memcpy(credential->id, flash_cred.id, STORAGE_CREDENTIAL_ID_LENGTH);
-            credential->sign_count = flash_cred.sign_count;
+int storage_find_credential(const uint8_t *credential_id, storage_credential_t *credential)
+{
+    if (!storage_state.initialized || credential_id == NULL || credential == NULL) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
 
-            /* Clean up */
-            secure_zero(plaintext, sizeof(plaintext));
+    storage_flash_credential_t flash_cred;
+    TRACE_BEGIN(TRACE_SPAN_STORAGE_FIND, 0);
+    int slot = cred_index_lookup(credential_id, &flash_cred);
+    TRACE_END(TRACE_SPAN_STORAGE_FIND);
+    if (slot < 0) {
+        return STORAGE_ERROR_NOT_FOUND;
+    }
 
-            LOG_INFO("Found credential in slot %d", i);
-            return STORAGE_OK;
-        }
+    if (credential_load(&flash_cred, credential) != STORAGE_OK) {
+        LOG_ERROR("Failed to decrypt credential");
+        return STORAGE_ERROR_CORRUPTED;
     }
 
-    return STORAGE_ERROR_NOT_FOUND;
+    LOG_INFO("Found credential in slot %d", slot);
+    return STORAGE_OK;
 }
 
-int storage_update_sign_count(const uint8_t *credential_id, uint32_t new_count)
+int storage_find_listed_credential(const uint8_t *rp_id_hash, uint8_t max_cred_protect,
+                                   const uint8_t *credential_ids, size_t id_count,
+                                   storage_credential_t *credential)
 {
-    if (!storage_state.initialized || credential_id == NULL) {
+    if (!storage_state.initialized || rp_id_hash == NULL ||
+        (credential_ids == NULL && id_count > 0) || credential == NULL) {
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
-    /* Find credential */
-    for (int i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
+    uint8_t rp_tag[STORAGE_CRED_RP_TAG_SIZE];
+    if (!credential_rp_tag(rp_id_hash, rp_tag)) {
+        return STORAGE_ERROR;
+    }
+
+    TRACE_BEGIN(TRACE_SPAN_STORAGE_FIND, id_count);
+    for (size_t i = 0; i < id_count; i++) {
         storage_flash_credential_t flash_cred;
-        uint32_t offset = STORAGE_OFFSET_CREDS + (i * STORAGE_CRED_SIZE);
+        const uint8_t *id = &credential_ids[i * STORAGE_CREDENTIAL_ID_LENGTH];
 
-        if (hal_flash_read(offset, (uint8_t *) &flash_cred, sizeof(storage_flash_credential_t)) !=
-            HAL_OK) {
+        /* Unknown IDs, filtered levels and other RPs cost no decryption */
+        if (cred_index_lookup(id, &flash_cred) < 0 ||
+            flash_cred.cred_protect > max_cred_protect ||
+            memcmp(flash_cred.rp_tag, rp_tag, sizeof(rp_tag)) != 0) {
             continue;
         }
 
-        if (!flash_cred.valid) {
-            continue;
+        if (credential_load(&flash_cred, credential) == STORAGE_OK &&
+            memcmp(credential->rp_id_hash, rp_id_hash, 32) == 0) {
+            TRACE_END(TRACE_SPAN_STORAGE_FIND);
+            return STORAGE_OK;
         }
+    }
+    TRACE_END(TRACE_SPAN_STORAGE_FIND);
 
-        if (memcmp(flash_cred.id, credential_id, STORAGE_CREDENTIAL_ID_LENGTH) == 0) {
-            /* Update counter */
-            flash_cred.sign_count = new_count;
+    secure_zero(credential, sizeof(*credential));
+    return STORAGE_ERROR_NOT_FOUND;
+}
 
-            if (hal_flash_write(offset, (const uint8_t *) &flash_cred,
-                                sizeof(storage_flash_credential_t)) != HAL_OK) {
-                LOG_ERROR("Failed to update sign count");
-                return STORAGE_ERROR;
-            }
+int storage_update_sign_count(const uint8_t *credential_id, uint32_t new_count)
+{
+    if (!storage_state.initialized || credential_id == NULL) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
 
-            return STORAGE_OK;
-        }
+    storage_flash_credential_t flash_cred;
+    int slot = cred_index_lookup(credential_id, &flash_cred);
+    if (slot < 0) {
+        return STORAGE_ERROR_NOT_FOUND;
     }
 
-    return STORAGE_ERROR_NOT_FOUND;
+    /* Update counter */
+    flash_cred.sign_count = new_count;
+
+    if (storage_flash_write(STORAGE_OFFSET_CREDS + (slot * STORAGE_CRED_SIZE),
+                            (const uint8_t *) &flash_cred,
+                            sizeof(storage_flash_credential_t)) != HAL_OK) {
+        LOG_ERROR("Failed to update sign count");
+        return STORAGE_ERROR;
+    }
+
+    return STORAGE_OK;
 }
 
 int storage_get_and_increment_counter(uint32_t *counter)
@@ -379,13 +1203,19 @@ int storage_get_and_increment_counter(uint32_t *counter)
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
+    /* Reservation exhausted (idle task did not get to run): persist inline */
+    if (storage_state.global_counter >= storage_state.counter_reserved) {
+        if (storage_reserve_counter() != STORAGE_OK) {
+            return STORAGE_ERROR;
+        }
+    }
+
     *counter = storage_state.global_counter++;
 
-    /* Write back to flash */
-    if (hal_flash_write(STORAGE_OFFSET_COUNTER, (const uint8_t *) &storage_state.global_counter,
-                        sizeof(uint32_t)) != HAL_OK) {
-        LOG_ERROR("Failed to write counter");
-        return STORAGE_ERROR;
+    /* Top up the reservation off the request path */
+    if (storage_state.counter_reserved - storage_state.global_counter <
+        STORAGE_COUNTER_LOW_WATER) {
+        idle_sched_trigger(storage_state.counter_task);
     }
 
     return STORAGE_OK;
@@ -401,15 +1231,21 @@ int storage_set_pin(const uint8_t *pin, size_t pin_len)
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
-    /* Hash PIN */
-    crypto_sha256(pin, pin_len, storage_state.pin_data.pin_hash);
+    /* Store a keyed verifier of the PIN hash, useless off this device */
+    uint8_t pin_hash[32];
+    crypto_sha256(pin, pin_len, pin_hash);
+    bool ok = pin_verifier(pin_hash, storage_state.pin_data.pin_hash);
+    crypto_secure_zero(pin_hash, sizeof(pin_hash));
+    if (!ok) {
+        return STORAGE_ERROR;
+    }
 
     storage_state.pin_data.pin_set = true;
     storage_state.pin_data.pin_retries = STORAGE_PIN_MAX_RETRIES;
 
     /* Write to flash */
-    if (hal_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
-                        sizeof(storage_pin_data_t)) != HAL_OK) {
+    if (storage_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
+                            sizeof(storage_pin_data_t)) != HAL_OK) {
         LOG_ERROR("Failed to write PIN data");
         return STORAGE_ERROR;
     }
@@ -424,6 +1260,22 @@ int storage_verify_pin(const uint8_t *pin, size_t pin_len)
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
+    /* Hash provided PIN */
+    uint8_t pin_hash[32];
+    crypto_sha256(pin, pin_len, pin_hash);
+
+    int ret = storage_verify_pin_hash(pin_hash, sizeof(pin_hash));
+    crypto_secure_zero(pin_hash, sizeof(pin_hash));
+    return ret;
+}
+
+int storage_verify_pin_hash(const uint8_t *pin_hash, size_t hash_len)
+{
+    if (!storage_state.initialized || pin_hash == NULL || hash_len < STORAGE_PIN_HASH_PREFIX ||
+        hash_len > 32) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
     if (!storage_state.pin_data.pin_set) {
         return STORAGE_ERROR;
     }
@@ -432,25 +1284,30 @@ int storage_verify_pin(const uint8_t *pin, size_t pin_len)
         return STORAGE_ERROR;
     }
 
-    /* Hash provided PIN */
-    uint8_t pin_hash[32];
-    crypto_sha256(pin, pin_len, pin_hash);
+    uint8_t verifier[32];
+    if (!pin_verifier(pin_hash, verifier)) {
+        return STORAGE_ERROR;
+    }
 
     /* Constant-time comparison */
-    if (constant_time_compare(pin_hash, storage_state.pin_data.pin_hash, 32) == 0) {
+    int mismatch = constant_time_compare(verifier, storage_state.pin_data.pin_hash,
+                                         sizeof(verifier));
+    crypto_secure_zero(verifier, sizeof(verifier));
+
+    if (mismatch == 0) {
         /* PIN correct */
         storage_state.pin_data.pin_retries = STORAGE_PIN_MAX_RETRIES;
 
-        hal_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
-                        sizeof(storage_pin_data_t));
+        storage_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
+                            sizeof(storage_pin_data_t));
 
         return STORAGE_OK;
     } else {
         /* PIN incorrect */
         storage_state.pin_data.pin_retries--;
 
-        hal_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
-                        sizeof(storage_pin_data_t));
+        storage_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
+                            sizeof(storage_pin_data_t));
 
         LOG_WARN("PIN verification failed, %d retries remaining",
                  storage_state.pin_data.pin_retries);
@@ -487,6 +1344,19 @@ int storage_get_attestation_key(uint8_t *private_key)
     return STORAGE_OK;
 }
 
+int storage_derive_device_key(const char *label, uint8_t *key)
+{
+    if (!storage_state.initialized || label == NULL || key == NULL) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    if (device_keys_derive(label, key) != DEVICE_KEYS_OK) {
+        return STORAGE_ERROR;
+    }
+
+    return STORAGE_OK;
+}
+
 int storage_set_attestation_key(const uint8_t *private_key)
 {
     if (!storage_state.initialized || private_key == NULL) {
@@ -495,8 +1365,8 @@ int storage_set_attestation_key(const uint8_t *private_key)
 
     memcpy(storage_state.attestation_key, private_key, 32);
 
-    if (hal_flash_write(STORAGE_OFFSET_ATT_KEY, storage_state.attestation_key,
-                        sizeof(storage_state.attestation_key)) != HAL_OK) {
+    if (storage_flash_write(STORAGE_OFFSET_ATT_KEY, storage_state.attestation_key,
+                            sizeof(storage_state.attestation_key)) != HAL_OK) {
         LOG_ERROR("Failed to write attestation key");
         return STORAGE_ERROR;
     }
@@ -513,15 +1383,7 @@ int storage_get_credential_count(size_t *count)
     *count = 0;
 
     for (int i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
-        storage_flash_credential_t flash_cred;
-        uint32_t offset = STORAGE_OFFSET_CREDS + (i * STORAGE_CRED_SIZE);
-
-        if (hal_flash_read(offset, (uint8_t *) &flash_cred, sizeof(storage_flash_credential_t)) !=
-            HAL_OK) {
-            continue;
-        }
-
-        if (flash_cred.valid) {
+        if (cred_index.used[i]) {
             (*count)++;
         }
     }
@@ -551,20 +1413,13 @@ int storage_get_resident_credential_count(size_t *count)
         }
 
         /* Decrypt to check if resident */
-        uint8_t plaintext[400];
-        if (crypto_aes_gcm_decrypt(device_master_key, flash_cred.iv, NULL, 0,
-                                   flash_cred.encrypted_data, sizeof(flash_cred.encrypted_data),
-                                   flash_cred.tag, plaintext) != CRYPTO_OK) {
+        uint8_t plaintext[STORAGE_CRED_DATA_SIZE];
+        if (credential_decrypt(&flash_cred, plaintext) != STORAGE_OK) {
             continue;
         }
 
-        /* Check resident flag (at offset 32 + user_id_len + 1 + 32) */
-        size_t off = 32; /* rp_id_hash */
-        uint8_t user_id_len = plaintext[off + STORAGE_MAX_USER_ID_LENGTH];
-        off += user_id_len + 1 + 32; /* user_id + len byte + private_key */
-
-        bool is_resident = (plaintext[off] == 1);
-        if (is_resident) {
+        if (flash_cred.data_len >= STORAGE_CRED_FIXED_SIZE &&
+            (plaintext[STORAGE_CRED_OFFSET_FLAGS] & STORAGE_CRED_FLAG_RESIDENT) != 0) {
             (*count)++;
         }
 
@@ -574,8 +1429,9 @@ int storage_get_resident_credential_count(size_t *count)
     return STORAGE_OK;
 }
 
-int storage_find_credentials_by_rp(const uint8_t *rp_id_hash, storage_credential_t *credentials,
-                                   size_t max_credentials, size_t *count)
+int storage_find_credentials_by_rp(const uint8_t *rp_id_hash, uint8_t max_cred_protect,
+                                   storage_credential_t *credentials, size_t max_credentials,
+                                   size_t *count)
 {
     if (!storage_state.initialized || rp_id_hash == NULL || credentials == NULL || count == NULL) {
         return STORAGE_ERROR_INVALID_PARAM;
@@ -583,6 +1439,12 @@ int storage_find_credentials_by_rp(const uint8_t *rp_id_hash, storage_credential
 
     *count = 0;
 
+    uint8_t rp_tag[STORAGE_CRED_RP_TAG_SIZE];
+    if (!credential_rp_tag(rp_id_hash, rp_tag)) {
+        return STORAGE_ERROR;
+    }
+
+    TRACE_BEGIN(TRACE_SPAN_STORAGE_FIND, 0);
     for (int i = 0; i < STORAGE_MAX_CREDENTIALS && *count < max_credentials; i++) {
         storage_flash_credential_t flash_cred;
         uint32_t offset = STORAGE_OFFSET_CREDS + (i * STORAGE_CRED_SIZE);
@@ -592,57 +1454,24 @@ int storage_find_credentials_by_rp(const uint8_t *rp_id_hash, storage_credential
             continue;
         }
 
-        if (!flash_cred.valid) {
+        /* Filter on the cleartext header before paying for a decryption */
+        if (!flash_cred.valid || flash_cred.cred_protect > max_cred_protect ||
+            memcmp(flash_cred.rp_tag, rp_tag, sizeof(rp_tag)) != 0) {
             continue;
         }
 
-        /* Decrypt credential */
-        uint8_t plaintext[400];
-        if (crypto_aes_gcm_decrypt(device_master_key, flash_cred.iv, NULL, 0,
-                                   flash_cred.encrypted_data, sizeof(flash_cred.encrypted_data),
-                                   flash_cred.tag, plaintext) != CRYPTO_OK) {
+        storage_credential_t *cred = &credentials[*count];
+        if (credential_load(&flash_cred, cred) != STORAGE_OK) {
             continue;
         }
 
-        /* Check if RP ID hash matches */
-        if (memcmp(plaintext, rp_id_hash, 32) == 0) {
-            /* Deserialize credential */
-            storage_credential_t *cred = &credentials[*count];
-            size_t off = 0;
-
-            memcpy(cred->rp_id_hash, &plaintext[off], 32);
-            off += 32;
-
-            /* Read user_id_len */
-            cred->user_id_len = plaintext[off + STORAGE_MAX_USER_ID_LENGTH];
-            memcpy(cred->user_id, &plaintext[off], cred->user_id_len);
-            off += cred->user_id_len + 1;
-
-            memcpy(cred->private_key, &plaintext[off], 32);
-            off += 32;
-
-            cred->resident = (plaintext[off++] == 1);
-
-            if (cred->resident) {
-                strncpy(cred->user_name, (const char *) &plaintext[off],
-                        STORAGE_MAX_USER_NAME_LENGTH);
-                off += STORAGE_MAX_USER_NAME_LENGTH;
-
-                strncpy(cred->display_name, (const char *) &plaintext[off],
-                        STORAGE_MAX_DISPLAY_NAME_LENGTH);
-                off += STORAGE_MAX_DISPLAY_NAME_LENGTH;
-
-                strncpy(cred->rp_id, (const char *) &plaintext[off], STORAGE_MAX_RP_ID_LENGTH);
-            }
-
-            memcpy(cred->id, flash_cred.id, STORAGE_CREDENTIAL_ID_LENGTH);
-            cred->sign_count = flash_cred.sign_count;
-
+        if (memcmp(cred->rp_id_hash, rp_id_hash, 32) == 0) {
             (*count)++;
+        } else {
+            secure_zero(cred, sizeof(*cred));
         }
-
-        secure_zero(plaintext, sizeof(plaintext));
     }
+    TRACE_END(TRACE_SPAN_STORAGE_FIND);
 
     LOG_INFO("Found %zu credentials for RP", *count);
     return STORAGE_OK;
@@ -654,36 +1483,25 @@ int storage_delete_credential(const uint8_t *credential_id)
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
-    /* Find credential */
-    for (int i = 0; i < STORAGE_MAX_CREDENTIALS; i++) {
-        storage_flash_credential_t flash_cred;
-        uint32_t offset = STORAGE_OFFSET_CREDS + (i * STORAGE_CRED_SIZE);
-
-        if (hal_flash_read(offset, (uint8_t *) &flash_cred, sizeof(storage_flash_credential_t)) !=
-            HAL_OK) {
-            continue;
-        }
-
-        if (!flash_cred.valid) {
-            continue;
-        }
-
-        if (memcmp(flash_cred.id, credential_id, STORAGE_CREDENTIAL_ID_LENGTH) == 0) {
-            /* Mark as invalid */
-            flash_cred.valid = false;
+    storage_flash_credential_t flash_cred;
+    int slot = cred_index_lookup(credential_id, &flash_cred);
+    if (slot < 0) {
+        return STORAGE_ERROR_NOT_FOUND;
+    }
 
-            if (hal_flash_write(offset, (const uint8_t *) &flash_cred,
-                                sizeof(storage_flash_credential_t)) != HAL_OK) {
-                LOG_ERROR("Failed to delete credential");
-                return STORAGE_ERROR;
-            }
+    /* Mark as invalid */
+    flash_cred.valid = false;
 
-            LOG_INFO("Deleted credential from slot %d", i);
-            return STORAGE_OK;
-        }
+    if (storage_flash_write(STORAGE_OFFSET_CREDS + (slot * STORAGE_CRED_SIZE),
+                            (const uint8_t *) &flash_cred,
+                            sizeof(storage_flash_credential_t)) != HAL_OK) {
+        LOG_ERROR("Failed to delete credential");
+        return STORAGE_ERROR;
     }
+    cred_index_remove(slot, credential_id);
 
-    return STORAGE_ERROR_NOT_FOUND;
+    LOG_INFO("Deleted credential from slot %d", slot);
+    return STORAGE_OK;
 }
 
 int storage_reset_pin_retries(void)
@@ -694,8 +1512,8 @@ int storage_reset_pin_retries(void)
 
     storage_state.pin_data.pin_retries = STORAGE_PIN_MAX_RETRIES;
 
-    if (hal_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
-                        sizeof(storage_pin_data_t)) != HAL_OK) {
+    if (storage_flash_write(STORAGE_OFFSET_PIN, (const uint8_t *) &storage_state.pin_data,
+                            sizeof(storage_pin_data_t)) != HAL_OK) {
         LOG_ERROR("Failed to reset PIN retries");
         return STORAGE_ERROR;
     }
@@ -716,27 +1534,248 @@ int storage_get_counter(uint32_t *counter)
 
 int storage_get_attestation_cert(uint8_t *cert, size_t max_len, size_t *cert_len)
 {
+    uint32_t len;
+
     if (!storage_state.initialized || cert == NULL || cert_len == NULL) {
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
-    /* For now, return empty certificate (not implemented) */
-    /* In production, this would read a stored X.509 certificate */
-    *cert_len = 0;
+    if (hal_flash_read(STORAGE_OFFSET_ATT_CERT, (uint8_t *) &len, sizeof(len)) != HAL_OK) {
+        return STORAGE_ERROR;
+    }
+
+    /* Erased flash or no chain provisioned */
+    if (len == 0 || len > STORAGE_ATT_CERT_MAX_SIZE) {
+        *cert_len = 0;
+        return STORAGE_OK;
+    }
+
+    if (len > max_len) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    if (hal_flash_read(STORAGE_OFFSET_ATT_CERT + sizeof(len), cert, len) != HAL_OK) {
+        return STORAGE_ERROR;
+    }
 
-    LOG_WARN("Attestation certificate not implemented");
+    *cert_len = len;
     return STORAGE_OK;
 }
 
 int storage_set_attestation_cert(const uint8_t *cert, size_t cert_len)
 {
-    if (!storage_state.initialized || cert == NULL) {
+    uint32_t len = (uint32_t) cert_len;
+
+    if (!storage_state.initialized || (cert == NULL && cert_len > 0) ||
+        cert_len > STORAGE_ATT_CERT_MAX_SIZE) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    if (cert_len > 0 &&
+        storage_flash_write(STORAGE_OFFSET_ATT_CERT + sizeof(len), cert, cert_len) != HAL_OK) {
+        LOG_ERROR("Failed to write attestation certificate chain");
+        return STORAGE_ERROR;
+    }
+
+    /* Length last, so a torn write leaves no chain rather than a truncated one */
+    if (storage_flash_write(STORAGE_OFFSET_ATT_CERT, (const uint8_t *) &len, sizeof(len)) !=
+        HAL_OK) {
+        LOG_ERROR("Failed to write attestation certificate length");
+        return STORAGE_ERROR;
+    }
+
+    return STORAGE_OK;
+}
+
+size_t storage_large_blob_size(void)
+{
+    return (storage_state.large_blob_slot >= 0) ? storage_state.large_blob_length : 0;
+}
+
+int storage_large_blob_read(size_t offset, uint8_t *data, size_t len)
+{
+    if (!storage_state.initialized || data == NULL ||
+        offset + len > storage_large_blob_size()) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t base = large_blob_slot_offset(storage_state.large_blob_slot);
+    if (hal_flash_read(base + sizeof(storage_large_blob_header_t) + offset, data, len) !=
+        HAL_OK) {
+        return STORAGE_ERROR;
+    }
+
+    return STORAGE_OK;
+}
+
+/**
+ * @brief Slot the next large-blob array is written to
+ */
+static int large_blob_spare_slot(void)
+{
+    return (storage_state.large_blob_slot == 0) ? 1 : 0;
+}
+
+int storage_large_blob_begin(size_t length)
+{
+    if (!storage_state.initialized || length == 0 || length > STORAGE_LARGE_BLOB_MAX_SIZE) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t base = large_blob_slot_offset(large_blob_spare_slot());
+    for (uint32_t offset = 0; offset < STORAGE_LARGE_BLOB_SLOT_SIZE;
+         offset += STORAGE_SECTOR_SIZE) {
+        if (storage_flash_erase(base + offset) != HAL_OK) {
+            storage_state.large_blob_pending = 0;
+            return STORAGE_ERROR;
+        }
+    }
+
+    storage_state.large_blob_pending = length;
+    return STORAGE_OK;
+}
+
+int storage_large_blob_write(size_t offset, const uint8_t *data, size_t len)
+{
+    if (!storage_state.initialized || data == NULL || storage_state.large_blob_pending == 0 ||
+        offset + len > storage_state.large_blob_pending) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    uint32_t base = large_blob_slot_offset(large_blob_spare_slot());
+    if (storage_flash_write(base + sizeof(storage_large_blob_header_t) + offset, data, len) !=
+        HAL_OK) {
+        return STORAGE_ERROR;
+    }
+
+    return STORAGE_OK;
+}
+
+int storage_large_blob_commit(void)
+{
+    if (!storage_state.initialized || storage_state.large_blob_pending == 0) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    int slot = large_blob_spare_slot();
+    storage_large_blob_header_t header = {
+        .magic = STORAGE_LARGE_BLOB_MAGIC,
+        .sequence = storage_state.large_blob_sequence + 1,
+        .length = (uint32_t) storage_state.large_blob_pending,
+        .reserved = 0,
+    };
+
+    storage_state.large_blob_pending = 0;
+
+    if (storage_flash_write(large_blob_slot_offset(slot), (const uint8_t *) &header,
+                            sizeof(header)) != HAL_OK) {
+        LOG_ERROR("Failed to commit large-blob array");
+        return STORAGE_ERROR;
+    }
+
+    storage_state.large_blob_slot = slot;
+    storage_state.large_blob_sequence = header.sequence;
+    storage_state.large_blob_length = header.length;
+
+    LOG_INFO("Large-blob array committed (%u bytes, slot %d)", header.length, slot);
+    return STORAGE_OK;
+}
+
+/**
+ * @brief Locate a verified-boot record, checking that len fits its slot
+ */
+static bool boot_record_offset(storage_boot_record_t record, size_t len, uint32_t *offset)
+{
+    switch (record) {
+        case STORAGE_BOOT_STATE:
+            *offset = STORAGE_OFFSET_BOOT_STATE;
+            return len <= STORAGE_BOOT_STATE_MAX_SIZE;
+        case STORAGE_BOOT_IMAGES:
+            *offset = STORAGE_OFFSET_BOOT_IMAGES;
+            return len <= STORAGE_BOOT_IMAGES_MAX_SIZE;
+        case STORAGE_BOOT_MEASUREMENT:
+            *offset = STORAGE_OFFSET_BOOT_MEASUREMENT;
+            return len <= STORAGE_BOOT_MEASUREMENT_MAX_SIZE;
+        default:
+            return false;
+    }
+}
+
+int storage_boot_record_read(storage_boot_record_t record, void *data, size_t len)
+{
+    uint32_t offset;
+    if (data == NULL || !boot_record_offset(record, len, &offset)) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    return (hal_flash_read(offset, data, len) == HAL_OK) ? STORAGE_OK : STORAGE_ERROR;
+}
+
+int storage_boot_record_write(storage_boot_record_t record, const void *data, size_t len)
+{
+    uint32_t offset;
+    if (data == NULL || !boot_record_offset(record, len, &offset)) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    if (storage_flash_write(offset, data, len) != HAL_OK) {
+        LOG_ERROR("Failed to write boot record %d", (int) record);
+        return STORAGE_ERROR;
+    }
+
+    return STORAGE_OK;
+}
+
+int storage_save_resume_state(storage_resume_state_t *state)
+{
+    if (!storage_state.initialized || state == NULL) {
+        return STORAGE_ERROR_INVALID_PARAM;
+    }
+
+    state->magic = storage_state.header.magic;
+    state->version = storage_state.header.version;
+    memcpy(state->master_key, storage_state.header.master_key, sizeof(state->master_key));
+    memcpy(&state->pin_data, &storage_state.pin_data, sizeof(storage_pin_data_t));
+    state->global_counter = storage_state.global_counter;
+    state->counter_reserved = storage_state.counter_reserved;
+    memcpy(state->attestation_key, storage_state.attestation_key, sizeof(state->attestation_key));
+
+    return STORAGE_OK;
+}
+
+int storage_restore_resume_state(const storage_resume_state_t *state)
+{
+    if (state == NULL) {
         return STORAGE_ERROR_INVALID_PARAM;
     }
 
-    /* For now, do nothing (not implemented) */
-    /* In production, this would store the X.509 certificate */
+    if (state->magic != STORAGE_MAGIC || state->version != STORAGE_VERSION ||
+        state->global_counter > state->counter_reserved) {
+        return STORAGE_ERROR_CORRUPTED;
+    }
+
+    /* Key schedules do not survive deep sleep; derive them again from the seed */
+    if (device_keys_init(state->master_key) != DEVICE_KEYS_OK) {
+        return STORAGE_ERROR;
+    }
+
+    storage_state.header.magic = state->magic;
+    storage_state.header.version = state->version;
+    memcpy(storage_state.header.master_key, state->master_key, sizeof(state->master_key));
+    memcpy(&storage_state.pin_data, &state->pin_data, sizeof(storage_pin_data_t));
+    memcpy(storage_state.attestation_key, state->attestation_key, sizeof(state->attestation_key));
+
+    /* Never move the counter backwards if RAM state survived the sleep */
+    if (state->global_counter > storage_state.global_counter) {
+        storage_state.global_counter = state->global_counter;
+    }
+    storage_state.counter_reserved = state->counter_reserved;
+
+    storage_scan_large_blob();
+    cred_index_build();
+    storage_register_idle_tasks();
+    storage_state.initialized = true;
 
-    LOG_WARN("Attestation certificate storage not implemented");
+    LOG_DEBUG("Storage state restored from snapshot (counter=%u)", storage_state.global_counter);
     return STORAGE_OK;
 }
@@ -32,9 +32,18 @@ extern "C" {
 #define STORAGE_MAX_CREDENTIALS 50
 #define STORAGE_MAX_RP_ID_LENGTH 256
 #define STORAGE_MAX_USER_ID_LENGTH 64
-#define STORAGE_MAX_USER_NAME_LENGTH 64
-#define STORAGE_MAX_DISPLAY_NAME_LENGTH 64
+#define STORAGE_MAX_USER_NAME_LENGTH 65    /* 64 bytes, as CTAP2 allows truncating to, + NUL */
+#define STORAGE_MAX_DISPLAY_NAME_LENGTH 65 /* 64 bytes + NUL */
 #define STORAGE_CREDENTIAL_ID_LENGTH 16
+#define STORAGE_MAX_CRED_BLOB_LENGTH 32
+#define STORAGE_CRED_EXPORT_MAX_SIZE 421 /* Portable credential record */
+#define STORAGE_ATT_CERT_MAX_SIZE 1020    /* Attestation certificate chain */
+#define STORAGE_LARGE_BLOB_MAX_SIZE 8176 /* Serialized large-blob array */
+
+/* credProtect levels */
+#define STORAGE_CRED_PROTECT_UV_OPTIONAL 0x01
+#define STORAGE_CRED_PROTECT_UV_OPTIONAL_WITH_ID 0x02
+#define STORAGE_CRED_PROTECT_UV_REQUIRED 0x03
 
 /* PIN Configuration */
 #define STORAGE_PIN_MIN_LENGTH 4
@@ -57,8 +66,8 @@ typedef struct {
     char rp_id[STORAGE_MAX_RP_ID_LENGTH];               /**< RP ID (for resident keys) */
     int algorithm;                                      /**< COSE algorithm identifier */
     bool hmac_secret;                                   /**< HMAC-Secret extension enabled */
-    uint8_t protection_policy;                          /**< Credential protection policy */
-    uint8_t cred_blob[32];                              /**< credBlob extension data */
+    uint8_t protection_policy;                          /**< credProtect level (0 = default) */
+    uint8_t cred_blob[STORAGE_MAX_CRED_BLOB_LENGTH];    /**< credBlob extension data */
     size_t cred_blob_len;                               /**< Length of credBlob */
     uint8_t large_blob_key[32];                         /**< largeBlobKey for encryption */
     bool has_large_blob_key;                            /**< Whether largeBlobKey is set */
@@ -68,11 +77,26 @@ typedef struct {
  * @brief PIN Data Structure
  */
 typedef struct {
-    uint8_t pin_hash[32]; /**< SHA-256 hash of PIN */
+    uint8_t pin_hash[32]; /**< Keyed verifier of LEFT(SHA-256(PIN), 16) */
     uint8_t pin_retries;  /**< Remaining PIN retries */
     bool pin_set;         /**< Is PIN set? */
 } storage_pin_data_t;
 
+/**
+ * @brief Warm storage state kept across deep sleep
+ *
+ * Everything storage_init() would otherwise re-read from flash.
+ */
+typedef struct {
+    uint32_t magic;              /**< Storage header magic */
+    uint32_t version;            /**< Storage header version */
+    uint8_t master_key[32];      /**< Device key root seed */
+    storage_pin_data_t pin_data; /**< Cached PIN data */
+    uint32_t global_counter;     /**< Signature counter */
+    uint32_t counter_reserved;   /**< Counter value persisted in flash */
+    uint8_t attestation_key[32]; /**< Attestation private key */
+} storage_resume_state_t;
+
 /**
  * @brief Initialize storage subsystem
  *
@@ -97,6 +121,48 @@ int storage_format(void);
  */
 int storage_store_credential(const storage_credential_t *credential);
 
+/**
+ * @brief Store a batch of credentials
+ *
+ * Free slots are claimed up front in ascending order and the records are
+ * programmed as one sequential run, with the index updated once at the end.
+ * On error, the credentials before the failing one remain stored.
+ *
+ * @param credentials Credentials to store
+ * @param count Number of credentials
+ * @param stored Output number of credentials stored
+ * @return STORAGE_OK on success, STORAGE_ERROR_FULL if the batch does not fit
+ */
+int storage_store_credentials(const storage_credential_t *credentials, size_t count,
+                              size_t *stored);
+
+/**
+ * @brief Export the next stored credential as a portable record
+ *
+ * The record holds the credential in cleartext (including its private key)
+ * and must be sealed by the caller before it leaves the device.
+ *
+ * @param cursor Slot to resume from (0 to start), advanced past the record
+ * @param record Output buffer (STORAGE_CRED_EXPORT_MAX_SIZE bytes)
+ * @param record_len Output record length
+ * @return STORAGE_OK, or STORAGE_ERROR_NOT_FOUND once all are exported
+ */
+int storage_export_credential(size_t *cursor, uint8_t *record, size_t *record_len);
+
+/**
+ * @brief Store a credential from a portable record
+ *
+ * The record is re-encrypted under this device's key. A credential whose ID
+ * is already stored is left as is.
+ *
+ * @param record Record from storage_export_credential()
+ * @param record_len Record length
+ * @param stored Output: true if the record was stored, false if its ID
+ *        already was (may be NULL)
+ * @return STORAGE_OK on success, STORAGE_ERROR_CORRUPTED if malformed
+ */
+int storage_import_credential(const uint8_t *record, size_t record_len, bool *stored);
+
 /**
  * @brief Find credential by ID
  *
@@ -106,17 +172,40 @@ int storage_store_credential(const storage_credential_t *credential);
  */
 int storage_find_credential(const uint8_t *credential_id, storage_credential_t *credential);
 
+/**
+ * @brief Find the first credential of a list that belongs to an RP
+ *
+ * Each ID is resolved through the RAM credential index, so IDs that are not
+ * stored cost no flash access. Only hits at or below @p max_cred_protect are
+ * decrypted.
+ *
+ * @param rp_id_hash SHA-256 hash of RP ID
+ * @param max_cred_protect Highest credProtect level to accept
+ * @param credential_ids Concatenated IDs (STORAGE_CREDENTIAL_ID_LENGTH bytes each)
+ * @param id_count Number of IDs
+ * @param credential Output credential structure
+ * @return STORAGE_OK if found, STORAGE_ERROR_NOT_FOUND otherwise
+ */
+int storage_find_listed_credential(const uint8_t *rp_id_hash, uint8_t max_cred_protect,
+                                   const uint8_t *credential_ids, size_t id_count,
+                                   storage_credential_t *credential);
+
 /**
  * @brief Find credentials by RP ID hash
  *
+ * Records above @p max_cred_protect are skipped from their cleartext header,
+ * without being decrypted.
+ *
  * @param rp_id_hash SHA-256 hash of RP ID
+ * @param max_cred_protect Highest credProtect level to return
  * @param credentials Array to store found credentials
  * @param max_credentials Maximum number of credentials to return
  * @param count Output: number of credentials found
  * @return STORAGE_OK on success, error code otherwise
  */
-int storage_find_credentials_by_rp(const uint8_t *rp_id_hash, storage_credential_t *credentials,
-                                   size_t max_credentials, size_t *count);
+int storage_find_credentials_by_rp(const uint8_t *rp_id_hash, uint8_t max_cred_protect,
+                                   storage_credential_t *credentials, size_t max_credentials,
+                                   size_t *count);
 
 /**
  * @brief Update credential signature counter
@@ -171,6 +260,19 @@ int storage_set_pin(const uint8_t *pin, size_t pin_len);
  */
 int storage_verify_pin(const uint8_t *pin, size_t pin_len);
 
+/**
+ * @brief Verify a PIN by its hash
+ *
+ * Compares against the leftmost @p hash_len bytes of the stored SHA-256,
+ * as sent by ClientPIN (pinHashEnc carries LEFT(SHA-256(PIN), 16)).
+ * Updates the retry counter like storage_verify_pin().
+ *
+ * @param pin_hash PIN hash prefix
+ * @param hash_len Length of prefix (16 to 32)
+ * @return STORAGE_OK if correct, error code otherwise
+ */
+int storage_verify_pin_hash(const uint8_t *pin_hash, size_t hash_len);
+
 /**
  * @brief Check if PIN is set
  *
@@ -217,6 +319,19 @@ int storage_get_and_increment_counter(uint32_t *counter);
  */
 int storage_get_counter(uint32_t *counter);
 
+/* ========== Device Keys ========== */
+
+/**
+ * @brief Derive a purpose-specific key from the device root key
+ *
+ * The same label always yields the same key until storage is formatted.
+ *
+ * @param label Purpose label (HKDF info)
+ * @param key Output: derived key (32 bytes)
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_derive_device_key(const char *label, uint8_t *key);
+
 /* ========== Attestation Key ========== */
 
 /**
@@ -236,24 +351,135 @@ int storage_get_attestation_key(uint8_t *private_key);
 int storage_set_attestation_key(const uint8_t *private_key);
 
 /**
- * @brief Get attestation certificate
+ * @brief Get attestation certificate chain
  *
- * @param cert Output buffer for certificate
+ * The chain is a sequence of DER certificates, leaf first. An empty chain
+ * (cert_len of 0) means none has been provisioned.
+ *
+ * @param cert Output buffer for the chain
  * @param max_len Maximum length of buffer
- * @param cert_len Output: actual certificate length
+ * @param cert_len Output: actual chain length
  * @return STORAGE_OK on success, error code otherwise
  */
 int storage_get_attestation_cert(uint8_t *cert, size_t max_len, size_t *cert_len);
 
 /**
- * @brief Set attestation certificate
+ * @brief Set attestation certificate chain
  *
- * @param cert Certificate data
- * @param cert_len Length of certificate
+ * @param cert DER certificates, leaf first (up to STORAGE_ATT_CERT_MAX_SIZE bytes)
+ * @param cert_len Length of the chain, 0 to remove it
  * @return STORAGE_OK on success, error code otherwise
  */
 int storage_set_attestation_cert(const uint8_t *cert, size_t cert_len);
 
+/* ========== Large Blobs ========== */
+
+/*
+ * The large-blob array lives in two flash slots. A write goes to the slot not
+ * in use and becomes current only when storage_large_blob_commit() writes its
+ * header, so an interrupted write leaves the previous array intact.
+ */
+
+/**
+ * @brief Get the length of the committed large-blob array
+ *
+ * @return Length in bytes, 0 if none has been written
+ */
+size_t storage_large_blob_size(void);
+
+/**
+ * @brief Read from the committed large-blob array
+ *
+ * @param offset Offset into the array
+ * @param data Output buffer
+ * @param len Number of bytes to read
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_large_blob_read(size_t offset, uint8_t *data, size_t len);
+
+/**
+ * @brief Start writing a new large-blob array into the spare slot
+ *
+ * @param length Total length of the new array (up to STORAGE_LARGE_BLOB_MAX_SIZE)
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_large_blob_begin(size_t length);
+
+/**
+ * @brief Write a fragment of the new large-blob array
+ *
+ * @param offset Offset into the new array
+ * @param data Fragment data
+ * @param len Fragment length
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_large_blob_write(size_t offset, const uint8_t *data, size_t len);
+
+/**
+ * @brief Make the new large-blob array current
+ *
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_large_blob_commit(void);
+
+/* ========== Verified Boot Records ========== */
+
+/*
+ * Opaque records of the verified-boot flow (see boot_verify.h). They live
+ * outside the area storage_format() erases, so a factory reset keeps the
+ * firmware signatures, and can be used before storage_init().
+ */
+
+/* Boot record capacities */
+#define STORAGE_BOOT_STATE_MAX_SIZE 256
+#define STORAGE_BOOT_IMAGES_MAX_SIZE 3840
+#define STORAGE_BOOT_MEASUREMENT_MAX_SIZE 4096
+
+typedef enum {
+    STORAGE_BOOT_STATE,      /* Flash generation counter and scrub schedule */
+    STORAGE_BOOT_IMAGES,     /* Signed descriptor of each firmware slot */
+    STORAGE_BOOT_MEASUREMENT /* Measurement of the running image */
+} storage_boot_record_t;
+
+/**
+ * @brief Read a verified-boot record
+ *
+ * @param record Record to read
+ * @param data Output buffer
+ * @param len Record length (must match the length written)
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_boot_record_read(storage_boot_record_t record, void *data, size_t len);
+
+/**
+ * @brief Replace a verified-boot record
+ *
+ * @param record Record to write
+ * @param data Record data
+ * @param len Record length
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_boot_record_write(storage_boot_record_t record, const void *data, size_t len);
+
+/**
+ * @brief Capture cached storage state for the deep-sleep snapshot
+ *
+ * @param state Output state
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_save_resume_state(storage_resume_state_t *state);
+
+/**
+ * @brief Reinstall cached storage state without reading flash
+ *
+ * The snapshot is only valid if flash has not been written since it was
+ * taken; storage invalidates it on every write.
+ *
+ * @param state State captured by storage_save_resume_state()
+ * @return STORAGE_OK on success, error code otherwise
+ */
+int storage_restore_resume_state(const storage_resume_state_t *state);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,268 @@
+/**
+ * @file dispatch.c
+ * @brief Request Dispatch Implementation
+ *
+ * Ring ownership: each transport's receive path produces requests and the
+ * main loop consumes responses; the crypto core consumes requests and
+ * produces responses. A request stays queued until its response has been
+ * committed, so a transport is pending exactly while one of its rings is
+ * non-empty and no counter has to be shared between the producers.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "dispatch.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "config.h"
+#include "hal.h"
+#include "idle_scheduler.h"
+#include "logger.h"
+#include "spsc_ring.h"
+#include "u2f.h"
+
+/**
+ * @brief Ring pair of one transport
+ */
+typedef struct {
+    spsc_ring_t requests;
+    spsc_ring_t responses;
+    dispatch_msg_t request_slots[DISPATCH_QUEUE_DEPTH];
+    dispatch_msg_t response_slots[DISPATCH_QUEUE_DEPTH];
+} dispatch_queue_t;
+
+static struct {
+    dispatch_queue_t queues[TRANSPORT_TYPE_MAX];
+    bool dual_core;
+    atomic_bool park_requested; /* Written by the transport core */
+    atomic_bool parked;         /* Written by the crypto core */
+} dispatch_state = {0};
+
+/**
+ * @brief Run one request and build its response
+ */
+static void dispatch_execute(dispatch_kind_t kind, const uint8_t *data, size_t len,
+                             dispatch_msg_t *response)
+{
+    response->kind = kind;
+
+    if (kind == DISPATCH_KIND_CBOR) {
+        ctap2_request_t request = {
+            .cmd = data[0],
+            .data = (len > 1) ? (uint8_t *) &data[1] : NULL,
+            .data_len = (len > 1) ? (len - 1) : 0,
+        };
+        ctap2_response_t ctap_response = {
+            .data = &response->data[1], /* Reserve first byte for status */
+            .data_len = 0,
+        };
+
+        response->data[0] = ctap2_process_request(&request, &ctap_response);
+        response->len = 1 + ctap_response.data_len;
+    } else {
+        size_t response_len = 0;
+        uint16_t sw = u2f_process_apdu(data, len, response->data, &response_len);
+
+        /* Append SW to response */
+        response->data[response_len++] = (sw >> 8) & 0xFF;
+        response->data[response_len++] = sw & 0xFF;
+        response->len = response_len;
+    }
+}
+
+/**
+ * @brief Serve one request from any transport
+ *
+ * @return true if a request was served
+ */
+static bool dispatch_serve_one(void)
+{
+    bool served = false;
+
+    for (size_t t = 0; t < TRANSPORT_TYPE_MAX; t++) {
+        dispatch_queue_t *queue = &dispatch_state.queues[t];
+
+        const dispatch_msg_t *request = spsc_ring_peek(&queue->requests);
+        if (request == NULL) {
+            continue;
+        }
+
+        /* Never full: a transport submits only when both its rings are empty */
+        dispatch_msg_t *response = spsc_ring_reserve(&queue->responses);
+        if (response == NULL) {
+            continue;
+        }
+
+        response->transport = request->transport;
+        response->channel = request->channel;
+        dispatch_execute(request->kind, request->data, request->len, response);
+
+        /* Publish before releasing, so the transport never sees both rings empty */
+        spsc_ring_commit(&queue->responses);
+        spsc_ring_release(&queue->requests);
+        served = true;
+    }
+
+    return served;
+}
+
+/**
+ * @brief Crypto core main loop
+ *
+ * Owns the protocol, crypto and storage state, so background maintenance
+ * runs here too, between requests.
+ */
+static void dispatch_core_main(void)
+{
+    LOG_INFO("Crypto core running");
+
+    while (1) {
+        if (atomic_load(&dispatch_state.park_requested)) {
+            atomic_store(&dispatch_state.parked, true);
+            while (atomic_load(&dispatch_state.park_requested)) {
+                hal_core_wait(CONFIG_IDLE_WINDOW_MS);
+            }
+            atomic_store(&dispatch_state.parked, false);
+            continue;
+        }
+
+        if (dispatch_serve_one()) {
+            continue;
+        }
+
+        /* Sleep away what the idle work leaves of the window; a request wakes us */
+        uint32_t used_ms = idle_sched_run(CONFIG_IDLE_WINDOW_MS);
+        if (used_ms < CONFIG_IDLE_WINDOW_MS) {
+            hal_core_wait(CONFIG_IDLE_WINDOW_MS - used_ms);
+        }
+    }
+}
+
+int dispatch_init(void)
+{
+    memset(&dispatch_state, 0, sizeof(dispatch_state));
+
+    for (size_t t = 0; t < TRANSPORT_TYPE_MAX; t++) {
+        dispatch_queue_t *queue = &dispatch_state.queues[t];
+        if (spsc_ring_init(&queue->requests, queue->request_slots, sizeof(dispatch_msg_t),
+                           DISPATCH_QUEUE_DEPTH) != SPSC_RING_OK ||
+            spsc_ring_init(&queue->responses, queue->response_slots, sizeof(dispatch_msg_t),
+                           DISPATCH_QUEUE_DEPTH) != SPSC_RING_OK) {
+            return DISPATCH_ERROR;
+        }
+    }
+
+#if CONFIG_DUAL_CORE
+    int ret = hal_core_launch(dispatch_core_main);
+    if (ret == HAL_OK) {
+        dispatch_state.dual_core = true;
+        LOG_INFO("Dispatch: transports and crypto on separate cores");
+    } else if (ret != HAL_ERROR_NOT_SUPPORTED) {
+        LOG_WARN("Failed to start the second core (%d), running single core", ret);
+    }
+#endif
+
+    if (!dispatch_state.dual_core) {
+        LOG_INFO("Dispatch: single core");
+    }
+
+    return DISPATCH_OK;
+}
+
+bool dispatch_is_dual_core(void)
+{
+    return dispatch_state.dual_core;
+}
+
+void dispatch_park(void)
+{
+    if (!dispatch_state.dual_core) {
+        return;
+    }
+
+    atomic_store(&dispatch_state.park_requested, true);
+    idle_sched_preempt();
+    hal_core_signal();
+
+    while (!atomic_load(&dispatch_state.parked)) {
+        hal_delay_ms(1);
+    }
+}
+
+void dispatch_unpark(void)
+{
+    if (!dispatch_state.dual_core) {
+        return;
+    }
+
+    atomic_store(&dispatch_state.park_requested, false);
+    hal_core_signal();
+}
+
+int dispatch_submit(transport_type_t transport, uint32_t channel, dispatch_kind_t kind,
+                    const uint8_t *data, size_t len)
+{
+    if (transport >= TRANSPORT_TYPE_MAX || data == NULL || len == 0 ||
+        len > CTAP2_MAX_MESSAGE_SIZE) {
+        return DISPATCH_ERROR_INVALID_PARAM;
+    }
+
+    dispatch_queue_t *queue = &dispatch_state.queues[transport];
+    if (dispatch_is_pending(transport)) {
+        return DISPATCH_ERROR_FULL;
+    }
+
+    /* Background work must not delay the response */
+    idle_sched_preempt();
+
+    if (!dispatch_state.dual_core) {
+        dispatch_msg_t *response = spsc_ring_reserve(&queue->responses);
+        response->transport = transport;
+        response->channel = channel;
+        dispatch_execute(kind, data, len, response);
+        spsc_ring_commit(&queue->responses);
+        return DISPATCH_OK;
+    }
+
+    dispatch_msg_t *request = spsc_ring_reserve(&queue->requests);
+    request->transport = transport;
+    request->channel = channel;
+    request->kind = kind;
+    request->len = len;
+    memcpy(request->data, data, len);
+    spsc_ring_commit(&queue->requests);
+
+    hal_core_signal();
+    return DISPATCH_OK;
+}
+
+bool dispatch_is_pending(transport_type_t transport)
+{
+    if (transport >= TRANSPORT_TYPE_MAX) {
+        return false;
+    }
+
+    dispatch_queue_t *queue = &dispatch_state.queues[transport];
+    return !spsc_ring_is_empty(&queue->requests) || !spsc_ring_is_empty(&queue->responses);
+}
+
+const dispatch_msg_t *dispatch_poll(transport_type_t transport)
+{
+    if (transport >= TRANSPORT_TYPE_MAX) {
+        return NULL;
+    }
+
+    return spsc_ring_peek(&dispatch_state.queues[transport].responses);
+}
+
+void dispatch_release(transport_type_t transport)
+{
+    if (transport >= TRANSPORT_TYPE_MAX) {
+        return;
+    }
+
+    spsc_ring_release(&dispatch_state.queues[transport].responses);
+}
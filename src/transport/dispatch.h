@@ -0,0 +1,142 @@
+/**
+ * @file dispatch.h
+ * @brief Request Dispatch Between Transport and Crypto Cores
+ *
+ * Transports hand complete CTAP2 and U2F requests to the dispatcher and
+ * collect the responses later. On dual-core parts the requests run on the
+ * second core, which owns the protocol, crypto and storage state, while the
+ * first core keeps servicing packet I/O on every transport. Each transport
+ * has its own pair of lock-free SPSC rings, so the cores never share a lock.
+ *
+ * On single-core parts (or with CONFIG_DUAL_CORE off) dispatch_submit()
+ * runs the request inline and queues the response before it returns, so the
+ * main loop is the same either way.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ctap2.h"
+#include "transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Dispatch Return Codes */
+#define DISPATCH_OK 0
+#define DISPATCH_ERROR -1
+#define DISPATCH_ERROR_INVALID_PARAM -2
+#define DISPATCH_ERROR_FULL -3
+
+/* Ring depth per transport (power of two); CTAPHID and BLE allow one request in flight */
+#define DISPATCH_QUEUE_DEPTH 1
+
+/**
+ * @brief Request protocol
+ */
+typedef enum {
+    DISPATCH_KIND_CBOR, /**< CTAP2 command byte and CBOR parameters */
+    DISPATCH_KIND_U2F   /**< U2F APDU */
+} dispatch_kind_t;
+
+/**
+ * @brief Request or response message
+ *
+ * A response carries the CTAP2 status byte and CBOR data, or the U2F data
+ * followed by the status word, ready to send.
+ */
+typedef struct {
+    transport_type_t transport; /**< Transport the request arrived on */
+    uint32_t channel;           /**< Transport channel (CTAPHID CID) */
+    dispatch_kind_t kind;       /**< Request protocol */
+    size_t len;                 /**< Length of data */
+    uint8_t data[CTAP2_MAX_MESSAGE_SIZE];
+} dispatch_msg_t;
+
+/**
+ * @brief Initialize the dispatcher and start the second core if there is one
+ *
+ * Must be called after the protocol modules are initialized.
+ *
+ * @return DISPATCH_OK on success, error code otherwise
+ */
+int dispatch_init(void);
+
+/**
+ * @brief Check whether requests run on the second core
+ *
+ * @return true in dual-core mode, false if requests run inline
+ */
+bool dispatch_is_dual_core(void);
+
+/**
+ * @brief Stop the crypto core between requests
+ *
+ * Returns once the crypto core has finished the request or idle step it
+ * was running and acknowledged, so its protocol, crypto and storage state
+ * can be read or replaced from this core, e.g. for the deep-sleep
+ * snapshot. Requests submitted meanwhile wait until dispatch_unpark().
+ * Does nothing in single-core mode.
+ */
+void dispatch_park(void);
+
+/**
+ * @brief Let the crypto core run again after dispatch_park()
+ */
+void dispatch_unpark(void);
+
+/**
+ * @brief Hand a request to the crypto core
+ *
+ * Each transport must submit from one context only, the one that receives
+ * on it, since that context is the single producer of the transport's ring.
+ *
+ * @param transport Transport the request arrived on
+ * @param channel Transport channel, returned with the response
+ * @param kind Request protocol
+ * @param data Request
+ * @param len Request length
+ * @return DISPATCH_OK on success, DISPATCH_ERROR_FULL if the transport still
+ *         has a request pending, error code otherwise
+ */
+int dispatch_submit(transport_type_t transport, uint32_t channel, dispatch_kind_t kind,
+                    const uint8_t *data, size_t len);
+
+/**
+ * @brief Check whether a transport has a request that has not been answered
+ *
+ * @param transport Transport
+ * @return true from dispatch_submit() until the response is released
+ */
+bool dispatch_is_pending(transport_type_t transport);
+
+/**
+ * @brief Get the next finished response on a transport
+ *
+ * The response stays valid until dispatch_release().
+ *
+ * @param transport Transport
+ * @return Response, or NULL if none is ready
+ */
+const dispatch_msg_t *dispatch_poll(transport_type_t transport);
+
+/**
+ * @brief Release the response returned by dispatch_poll()
+ *
+ * @param transport Transport
+ */
+void dispatch_release(transport_type_t transport);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISPATCH_H */
@@ -13,6 +13,7 @@
 #include "../transport/transport.h"
 #include "hal.h"
 #include "logger.h"
+#include "trace.h"
 
 /* CTAPHID packet structure */
 typedef struct {
@@ -48,21 +49,85 @@ int usb_hid_init(void)
     return USB_HID_OK;
 }
 
+/* Reports staged per hal_usb_send_burst() call */
+#define USB_HID_BURST_PACKETS 16
+
+/* Upper bound on waiting for the transmit FIFO to make room */
+#define USB_HID_TX_TIMEOUT_MS 1000
+
+/* Staging area for one burst of CTAPHID packets */
+static uint8_t burst_buffer[USB_HID_BURST_PACKETS][CTAPHID_PACKET_SIZE];
+
+/**
+ * @brief Submit staged packets, falling back to one report at a time
+ *
+ * @return USB_HID_OK on success, error code otherwise
+ */
+static int usb_hid_flush_burst(size_t count)
+{
+    size_t submitted = 0;
+    uint64_t start = hal_get_timestamp_ms();
+
+    while (submitted < count) {
+        int ret = hal_usb_send_burst(burst_buffer[submitted], count - submitted);
+
+        if (ret == HAL_ERROR_NOT_SUPPORTED) {
+            /* Platform has no transmit FIFO: send synchronously */
+            for (; submitted < count; submitted++) {
+                if (hal_usb_send(burst_buffer[submitted], CTAPHID_PACKET_SIZE) !=
+                    CTAPHID_PACKET_SIZE) {
+                    return USB_HID_ERROR;
+                }
+            }
+            break;
+        }
+
+        if (ret < 0) {
+            return USB_HID_ERROR;
+        }
+
+        submitted += (size_t) ret;
+
+        if (submitted < count) {
+            /* FIFO full: the endpoint is draining at line rate, give it a moment */
+            if (hal_get_timestamp_ms() - start >= USB_HID_TX_TIMEOUT_MS) {
+                LOG_ERROR("USB transmit FIFO stalled");
+                return USB_HID_ERROR_TIMEOUT;
+            }
+            hal_delay_ms(1);
+        }
+    }
+
+    return USB_HID_OK;
+}
+
 int usb_hid_send(const uint8_t *data, size_t len)
 {
     if (len == 0 || data == NULL) {
         return USB_HID_ERROR;
     }
 
+    return usb_hid_send_command(CTAPHID_CBOR, data, len);
+}
+
+int usb_hid_send_command(uint8_t cmd, const uint8_t *data, size_t len)
+{
+    if (len > 0 && data == NULL) {
+        return USB_HID_ERROR;
+    }
+
+    TRACE_BEGIN(TRACE_SPAN_SEND, cmd);
+
     /* Build initial packet */
-    uint8_t packet[CTAPHID_PACKET_SIZE] = {0};
+    uint8_t *packet = burst_buffer[0];
+    memset(packet, 0, CTAPHID_PACKET_SIZE);
     ctaphid_init_packet_t *init_pkt = (ctaphid_init_packet_t *) packet;
 
     /* Set CID (big-endian) */
     init_pkt->cid = __builtin_bswap32(current_cid);
 
-    /* Set command (CBOR) */
-    init_pkt->cmd = CTAPHID_CBOR;
+    /* Set command */
+    init_pkt->cmd = cmd;
 
     /* Set byte count (big-endian) */
     init_pkt->bcnth = (len >> 8) & 0xFF;
@@ -70,19 +135,25 @@ int usb_hid_send(const uint8_t *data, size_t len)
 
     /* Copy initial payload */
     size_t to_copy = (len < CTAPHID_INIT_PAYLOAD) ? len : CTAPHID_INIT_PAYLOAD;
-    memcpy(init_pkt->data, data, to_copy);
-
-    /* Send initial packet */
-    if (hal_usb_send(packet, CTAPHID_PACKET_SIZE) != CTAPHID_PACKET_SIZE) {
-        return USB_HID_ERROR;
+    if (to_copy > 0) {
+        memcpy(init_pkt->data, data, to_copy);
     }
 
     size_t sent = to_copy;
+    size_t staged = 1;
     uint8_t seq = 0;
 
-    /* Send continuation packets if needed */
+    /* Stage continuation packets, submitting a burst whenever the buffer fills */
     while (sent < len) {
-        memset(packet, 0, sizeof(packet));
+        if (staged == USB_HID_BURST_PACKETS) {
+            if (usb_hid_flush_burst(staged) != USB_HID_OK) {
+                return USB_HID_ERROR;
+            }
+            staged = 0;
+        }
+
+        packet = burst_buffer[staged++];
+        memset(packet, 0, CTAPHID_PACKET_SIZE);
         ctaphid_cont_packet_t *cont_pkt = (ctaphid_cont_packet_t *) packet;
 
         cont_pkt->cid = __builtin_bswap32(current_cid);
@@ -91,16 +162,38 @@ int usb_hid_send(const uint8_t *data, size_t len)
         to_copy = ((len - sent) < CTAPHID_CONT_PAYLOAD) ? (len - sent) : CTAPHID_CONT_PAYLOAD;
         memcpy(cont_pkt->data, &data[sent], to_copy);
 
-        if (hal_usb_send(packet, CTAPHID_PACKET_SIZE) != CTAPHID_PACKET_SIZE) {
-            return USB_HID_ERROR;
-        }
-
         sent += to_copy;
     }
 
+    if (usb_hid_flush_burst(staged) != USB_HID_OK) {
+        return USB_HID_ERROR;
+    }
+
+    TRACE_END(TRACE_SPAN_SEND);
     return sent;
 }
 
+int usb_hid_send_keepalive(uint8_t status)
+{
+    return (usb_hid_send_command(CTAPHID_KEEPALIVE, &status, 1) == 1) ? USB_HID_OK
+                                                                       : USB_HID_ERROR;
+}
+
+int usb_hid_send_error(uint8_t error)
+{
+    return (usb_hid_send_command(CTAPHID_ERROR, &error, 1) == 1) ? USB_HID_OK : USB_HID_ERROR;
+}
+
+uint32_t usb_hid_get_cid(void)
+{
+    return current_cid;
+}
+
+void usb_hid_set_cid(uint32_t cid)
+{
+    current_cid = cid;
+}
+
 int usb_hid_receive(uint8_t *data, size_t max_len, uint8_t *cmd)
 {
     uint8_t packet[CTAPHID_PACKET_SIZE];
@@ -161,6 +254,8 @@ int usb_hid_receive(uint8_t *data, size_t max_len, uint8_t *cmd)
         return 0;
     }
 
+    TRACE_BEGIN(TRACE_SPAN_USB_RECEIVE, command);
+
     /* Copy initial payload */
     size_t to_copy = (total_len < CTAPHID_INIT_PAYLOAD) ? total_len : CTAPHID_INIT_PAYLOAD;
     memcpy(data, init_pkt->data, to_copy);
@@ -195,6 +290,7 @@ int usb_hid_receive(uint8_t *data, size_t max_len, uint8_t *cmd)
         expected_seq++;
     }
 
+    TRACE_END(TRACE_SPAN_USB_RECEIVE);
     return received;
 }
 
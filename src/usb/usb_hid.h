@@ -9,6 +9,7 @@
 #ifndef USB_HID_H
 #define USB_HID_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -35,6 +36,14 @@ extern "C" {
 #define CTAPHID_ERROR 0x3F
 #define CTAPHID_KEEPALIVE 0x3B
 
+/* CTAPHID_KEEPALIVE Status */
+#define CTAPHID_KEEPALIVE_PROCESSING 0x01
+#define CTAPHID_KEEPALIVE_UPNEEDED 0x02
+
+/* CTAPHID_ERROR Codes */
+#define CTAPHID_ERR_INVALID_CMD 0x01
+#define CTAPHID_ERR_CHANNEL_BUSY 0x06
+
 /**
  * @brief Initialize USB HID interface
  *
@@ -51,6 +60,49 @@ int usb_hid_init(void);
  */
 int usb_hid_send(const uint8_t *data, size_t len);
 
+/**
+ * @brief Send a CTAPHID message with an explicit command byte
+ *
+ * @param cmd CTAPHID command (e.g. CTAPHID_PING)
+ * @param data Pointer to payload (may be NULL if len is 0)
+ * @param len Length of payload
+ * @return Number of bytes sent, or negative error code
+ */
+int usb_hid_send_command(uint8_t cmd, const uint8_t *data, size_t len);
+
+/**
+ * @brief Send CTAPHID_KEEPALIVE on the current channel
+ *
+ * @param status CTAPHID_KEEPALIVE_PROCESSING or CTAPHID_KEEPALIVE_UPNEEDED
+ * @return USB_HID_OK on success, error code otherwise
+ */
+int usb_hid_send_keepalive(uint8_t status);
+
+/**
+ * @brief Send CTAPHID_ERROR on the current channel
+ *
+ * @param error CTAPHID error code (e.g. CTAPHID_ERR_CHANNEL_BUSY)
+ * @return USB_HID_OK on success, error code otherwise
+ */
+int usb_hid_send_error(uint8_t error);
+
+/**
+ * @brief Get the channel of the last received message
+ *
+ * @return Channel ID
+ */
+uint32_t usb_hid_get_cid(void);
+
+/**
+ * @brief Select the channel used for subsequent sends
+ *
+ * Lets a request that is still being processed keep its channel while
+ * messages from other channels are answered in between.
+ *
+ * @param cid Channel ID
+ */
+void usb_hid_set_cid(uint32_t cid);
+
 /**
  * @brief Receive data from USB HID
  *
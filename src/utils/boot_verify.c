@@ -0,0 +1,486 @@
+/**
+ * @file boot_verify.c
+ * @brief Verified Boot Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "boot_verify.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "crypto.h"
+#include "hal.h"
+#include "idle_scheduler.h"
+#include "logger.h"
+#include "module_state.h"
+#include "p256.h"
+#include "sha256.h"
+#include "storage.h"
+
+#define BOOT_VERIFY_STATE_MAGIC 0x54534F42       /* "BOST" */
+#define BOOT_VERIFY_IMAGE_MAGIC 0x474D4942       /* "BIMG" */
+#define BOOT_VERIFY_MEASUREMENT_MAGIC 0x53414D42 /* "BMAS" */
+#define BOOT_VERIFY_MEASUREMENT_VERSION 1
+
+/* Device key authenticating the measurement */
+#define BOOT_VERIFY_MAC_LABEL "openfido boot measurement"
+#define BOOT_VERIFY_MAC_SIZE 32
+
+/* Bytes read from flash per access while hashing */
+#define BOOT_VERIFY_READ_CHUNK 256
+
+/**
+ * @brief Flash generation counter and scrub schedule
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t generation; /* Bumped whenever a slot is rewritten */
+    uint32_t boots;      /* Boots since the last full re-hash */
+} boot_state_t;
+
+/**
+ * @brief Signed descriptor of one firmware slot
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t image_size;
+    uint32_t version;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t signature[P256_SIGNATURE_SIZE];
+} boot_image_t;
+
+/**
+ * @brief Measurement of the running image, MAC over every field before it
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t generation;
+    uint32_t slot;
+    uint32_t image_size;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint8_t image_digest[SHA256_DIGEST_SIZE];
+    uint8_t block_hash[BOOT_VERIFY_MAX_BLOCKS][BOOT_VERIFY_BLOCK_HASH_SIZE];
+    uint8_t mac[BOOT_VERIFY_MAC_SIZE];
+} boot_measurement_t;
+
+_Static_assert(sizeof(boot_state_t) <= STORAGE_BOOT_STATE_MAX_SIZE, "boot state too large");
+_Static_assert(sizeof(boot_image_t) * HAL_FW_SLOT_COUNT <= STORAGE_BOOT_IMAGES_MAX_SIZE,
+               "boot image descriptors too large");
+_Static_assert(sizeof(boot_measurement_t) <= STORAGE_BOOT_MEASUREMENT_MAX_SIZE,
+               "boot measurement too large");
+
+static OPENFIDO_STATE struct {
+    bool cached;          /* Boot reused the stored measurement */
+    bool failed;          /* A block did not match */
+    bool task_registered;
+    int check_task;
+    uint8_t slot;         /* Running slot */
+    size_t next_block;    /* Idle-time scan cursor */
+    size_t pending;       /* Blocks not checked yet */
+    uint32_t checked[(BOOT_VERIFY_MAX_BLOCKS + 31) / 32];
+    boot_measurement_t measurement;
+} boot_verify;
+OPENFIDO_STATE_REGISTER(boot_verify);
+
+/**
+ * @brief Smallest block size that covers the image in BOOT_VERIFY_MAX_BLOCKS
+ */
+static uint32_t block_size_for(uint32_t image_size)
+{
+    uint32_t block_size = BOOT_VERIFY_MIN_BLOCK_SIZE;
+    while ((uint64_t) block_size * BOOT_VERIFY_MAX_BLOCKS < image_size) {
+        block_size <<= 1;
+    }
+    return block_size;
+}
+
+/**
+ * @brief Hash part of a slot into one or two contexts
+ */
+static int hash_region(uint8_t slot, uint32_t offset, uint32_t len, sha256_ctx_t *ctx,
+                       sha256_ctx_t *ctx2)
+{
+    uint8_t chunk[BOOT_VERIFY_READ_CHUNK];
+
+    while (len > 0) {
+        uint32_t n = (len < sizeof(chunk)) ? len : (uint32_t) sizeof(chunk);
+        if (hal_fw_read(slot, offset, chunk, n) != HAL_OK) {
+            return BOOT_VERIFY_ERROR;
+        }
+
+        sha256_update(ctx, chunk, n);
+        if (ctx2 != NULL) {
+            sha256_update(ctx2, chunk, n);
+        }
+
+        offset += n;
+        len -= n;
+    }
+
+    return BOOT_VERIFY_OK;
+}
+
+static int measurement_mac(const boot_measurement_t *measurement, uint8_t *mac)
+{
+    uint8_t key[32];
+
+    int ret = BOOT_VERIFY_ERROR;
+    if (storage_derive_device_key(BOOT_VERIFY_MAC_LABEL, key) == STORAGE_OK &&
+        crypto_hmac_sha256(key, sizeof(key), (const uint8_t *) measurement,
+                           offsetof(boot_measurement_t, mac), mac) == CRYPTO_OK) {
+        ret = BOOT_VERIFY_OK;
+    }
+
+    secure_zero(key, sizeof(key));
+    return ret;
+}
+
+static void boot_state_read(boot_state_t *state)
+{
+    if (storage_boot_record_read(STORAGE_BOOT_STATE, state, sizeof(*state)) != STORAGE_OK ||
+        state->magic != BOOT_VERIFY_STATE_MAGIC) {
+        memset(state, 0, sizeof(*state));
+        state->magic = BOOT_VERIFY_STATE_MAGIC;
+    }
+}
+
+/**
+ * @brief Make the stored measurement stale, forcing a full re-hash next boot
+ */
+static int bump_generation(void)
+{
+    boot_state_t state;
+    boot_state_read(&state);
+    state.generation++;
+
+    if (storage_boot_record_write(STORAGE_BOOT_STATE, &state, sizeof(state)) != STORAGE_OK) {
+        return BOOT_VERIFY_ERROR;
+    }
+    return BOOT_VERIFY_OK;
+}
+
+static void read_images(boot_image_t *images)
+{
+    if (storage_boot_record_read(STORAGE_BOOT_IMAGES, images,
+                                 sizeof(boot_image_t) * HAL_FW_SLOT_COUNT) != STORAGE_OK) {
+        memset(images, 0, sizeof(boot_image_t) * HAL_FW_SLOT_COUNT);
+    }
+}
+
+/**
+ * @brief Load the stored measurement and check that it covers this image
+ */
+static bool measurement_load(const boot_image_t *image, uint32_t generation)
+{
+    boot_measurement_t *m = &boot_verify.measurement;
+
+    if (storage_boot_record_read(STORAGE_BOOT_MEASUREMENT, m, sizeof(*m)) != STORAGE_OK) {
+        return false;
+    }
+
+    if (m->magic != BOOT_VERIFY_MEASUREMENT_MAGIC ||
+        m->version != BOOT_VERIFY_MEASUREMENT_VERSION || m->generation != generation ||
+        m->slot != boot_verify.slot || m->image_size != image->image_size ||
+        m->block_size != block_size_for(image->image_size) ||
+        m->block_count != (image->image_size + m->block_size - 1) / m->block_size ||
+        memcmp(m->image_digest, image->digest, SHA256_DIGEST_SIZE) != 0) {
+        return false;
+    }
+
+    uint8_t mac[BOOT_VERIFY_MAC_SIZE];
+    return measurement_mac(m, mac) == BOOT_VERIFY_OK &&
+           constant_time_compare(mac, m->mac, sizeof(mac)) == 0;
+}
+
+/**
+ * @brief Hash the whole image, check its signature and store a fresh measurement
+ */
+static int measurement_build(const boot_image_t *image, const uint8_t *public_key,
+                             uint32_t generation)
+{
+    boot_measurement_t *m = &boot_verify.measurement;
+
+    memset(m, 0, sizeof(*m));
+    m->magic = BOOT_VERIFY_MEASUREMENT_MAGIC;
+    m->version = BOOT_VERIFY_MEASUREMENT_VERSION;
+    m->generation = generation;
+    m->slot = boot_verify.slot;
+    m->image_size = image->image_size;
+    m->block_size = block_size_for(image->image_size);
+    m->block_count = (image->image_size + m->block_size - 1) / m->block_size;
+
+    /* The signed hash starts with the version */
+    uint8_t version[4] = {(uint8_t) image->version, (uint8_t) (image->version >> 8),
+                          (uint8_t) (image->version >> 16), (uint8_t) (image->version >> 24)};
+    sha256_ctx_t image_ctx;
+    sha256_init(&image_ctx);
+    sha256_update(&image_ctx, version, sizeof(version));
+
+    for (uint32_t i = 0; i < m->block_count; i++) {
+        uint32_t offset = i * m->block_size;
+        uint32_t len = m->image_size - offset;
+        if (len > m->block_size) {
+            len = m->block_size;
+        }
+
+        sha256_ctx_t block_ctx;
+        uint8_t block_digest[SHA256_DIGEST_SIZE];
+        sha256_init(&block_ctx);
+        if (hash_region(boot_verify.slot, offset, len, &block_ctx, &image_ctx) !=
+            BOOT_VERIFY_OK) {
+            return BOOT_VERIFY_ERROR;
+        }
+        sha256_final(&block_ctx, block_digest);
+        memcpy(m->block_hash[i], block_digest, BOOT_VERIFY_BLOCK_HASH_SIZE);
+    }
+
+    sha256_final(&image_ctx, m->image_digest);
+    if (memcmp(m->image_digest, image->digest, SHA256_DIGEST_SIZE) != 0 ||
+        p256_ecdsa_verify(public_key, image->digest, image->signature) != P256_OK) {
+        return BOOT_VERIFY_ERROR_INTEGRITY;
+    }
+
+    if (measurement_mac(m, m->mac) != BOOT_VERIFY_OK ||
+        storage_boot_record_write(STORAGE_BOOT_MEASUREMENT, m, sizeof(*m)) != STORAGE_OK) {
+        /* The image is good; the next boot just measures it again */
+        LOG_WARN("Failed to store boot measurement");
+    }
+
+    return BOOT_VERIFY_OK;
+}
+
+/**
+ * @brief Hash one block of the running image against the measurement
+ */
+static int check_block(size_t index)
+{
+    const boot_measurement_t *m = &boot_verify.measurement;
+    uint32_t bit = 1u << (index % 32);
+
+    if (boot_verify.checked[index / 32] & bit) {
+        return BOOT_VERIFY_OK;
+    }
+
+    uint32_t offset = (uint32_t) index * m->block_size;
+    uint32_t len = m->image_size - offset;
+    if (len > m->block_size) {
+        len = m->block_size;
+    }
+
+    sha256_ctx_t ctx;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_init(&ctx);
+    if (hash_region(boot_verify.slot, offset, len, &ctx, NULL) != BOOT_VERIFY_OK) {
+        return BOOT_VERIFY_ERROR;
+    }
+    sha256_final(&ctx, digest);
+
+    boot_verify.checked[index / 32] |= bit;
+    boot_verify.pending--;
+
+    if (memcmp(digest, m->block_hash[index], BOOT_VERIFY_BLOCK_HASH_SIZE) != 0) {
+        if (!boot_verify.failed) {
+            LOG_ERROR("Block %u of the running image does not match its measurement",
+                      (unsigned) index);
+            boot_verify.failed = true;
+            bump_generation();
+        }
+        return BOOT_VERIFY_ERROR_INTEGRITY;
+    }
+
+    return BOOT_VERIFY_OK;
+}
+
+/**
+ * @brief Idle task: check the next unchecked block
+ */
+static idle_task_status_t block_check_step(void *context)
+{
+    (void) context;
+
+    const boot_measurement_t *m = &boot_verify.measurement;
+    if (!boot_verify.cached || boot_verify.failed || boot_verify.next_block >= m->block_count) {
+        return IDLE_TASK_DONE;
+    }
+
+    check_block(boot_verify.next_block++);
+    return (boot_verify.next_block < m->block_count) ? IDLE_TASK_MORE : IDLE_TASK_DONE;
+}
+
+static void register_idle_task(void)
+{
+    if (boot_verify.task_registered) {
+        return;
+    }
+
+    idle_task_config_t check_task = {.name = "boot-block-check",
+                                     .step = block_check_step,
+                                     .context = NULL,
+                                     .priority = IDLE_PRIORITY_LOW,
+                                     .budget_ms = 5,
+                                     .period_ms = 0};
+    boot_verify.check_task = idle_sched_register(&check_task);
+    boot_verify.task_registered = boot_verify.check_task >= 0;
+}
+
+int boot_verify_init(const uint8_t *public_key)
+{
+    boot_verify.cached = false;
+    boot_verify.failed = false;
+    boot_verify.next_block = 0;
+    boot_verify.pending = 0;
+    memset(boot_verify.checked, 0, sizeof(boot_verify.checked));
+
+    hal_fw_slots_t slots;
+    int ret = hal_fw_get_slots(&slots);
+    if (ret == HAL_ERROR_NOT_SUPPORTED) {
+        return BOOT_VERIFY_ERROR_NOT_SUPPORTED;
+    }
+    if (ret != HAL_OK || slots.active >= HAL_FW_SLOT_COUNT) {
+        return BOOT_VERIFY_ERROR;
+    }
+    boot_verify.slot = slots.active;
+
+    boot_image_t images[HAL_FW_SLOT_COUNT];
+    read_images(images);
+    const boot_image_t *image = &images[boot_verify.slot];
+    if (public_key == NULL || image->magic != BOOT_VERIFY_IMAGE_MAGIC ||
+        image->image_size == 0 || image->image_size > slots.slot_size) {
+        LOG_WARN("Verified boot: no signed image descriptor for slot %u", boot_verify.slot);
+        return BOOT_VERIFY_ERROR_NOT_PROVISIONED;
+    }
+
+    boot_state_t state;
+    boot_state_read(&state);
+
+    if (state.boots < BOOT_VERIFY_SCRUB_BOOTS && measurement_load(image, state.generation)) {
+        boot_verify.cached = true;
+        boot_verify.pending = boot_verify.measurement.block_count;
+
+        state.boots++;
+        storage_boot_record_write(STORAGE_BOOT_STATE, &state, sizeof(state));
+
+        register_idle_task();
+        if (boot_verify.task_registered) {
+            idle_sched_trigger(boot_verify.check_task);
+        }
+
+        LOG_INFO("Verified boot: cached measurement, %u blocks checked lazily",
+                 (unsigned) boot_verify.pending);
+        return BOOT_VERIFY_OK;
+    }
+
+    ret = measurement_build(image, public_key, state.generation);
+    if (ret != BOOT_VERIFY_OK) {
+        boot_verify.failed = true;
+        LOG_ERROR("Verified boot: slot %u failed verification (%d)", boot_verify.slot, ret);
+        return ret;
+    }
+
+    state.boots = 0;
+    storage_boot_record_write(STORAGE_BOOT_STATE, &state, sizeof(state));
+
+    /* Every block was just hashed */
+    for (uint32_t i = 0; i < boot_verify.measurement.block_count; i++) {
+        boot_verify.checked[i / 32] |= 1u << (i % 32);
+    }
+
+    LOG_INFO("Verified boot: slot %u re-hashed (%u bytes)", boot_verify.slot,
+             (unsigned) image->image_size);
+    return BOOT_VERIFY_OK;
+}
+
+bool boot_verify_cached(void)
+{
+    return boot_verify.cached;
+}
+
+int boot_verify_range(uint32_t offset, size_t len)
+{
+    const boot_measurement_t *m = &boot_verify.measurement;
+
+    if (boot_verify.failed) {
+        return BOOT_VERIFY_ERROR_INTEGRITY;
+    }
+
+    if (m->magic != BOOT_VERIFY_MEASUREMENT_MAGIC || len == 0 ||
+        (uint64_t) offset + len > m->image_size) {
+        return BOOT_VERIFY_ERROR_INVALID_PARAM;
+    }
+
+    size_t last = (size_t) (((uint64_t) offset + len - 1) / m->block_size);
+    for (size_t i = offset / m->block_size; i <= last; i++) {
+        int ret = check_block(i);
+        if (ret != BOOT_VERIFY_OK) {
+            return ret;
+        }
+    }
+
+    return BOOT_VERIFY_OK;
+}
+
+size_t boot_verify_pending_blocks(void)
+{
+    return boot_verify.pending;
+}
+
+int boot_verify_image_begin(uint8_t slot)
+{
+    if (slot >= HAL_FW_SLOT_COUNT) {
+        return BOOT_VERIFY_ERROR_INVALID_PARAM;
+    }
+
+    boot_image_t images[HAL_FW_SLOT_COUNT];
+    read_images(images);
+    memset(&images[slot], 0, sizeof(images[slot]));
+
+    if (storage_boot_record_write(STORAGE_BOOT_IMAGES, images, sizeof(images)) != STORAGE_OK) {
+        return BOOT_VERIFY_ERROR;
+    }
+
+    return bump_generation();
+}
+
+int boot_verify_image_commit(uint8_t slot, uint32_t image_size, uint32_t version,
+                             const uint8_t *digest, const uint8_t *signature)
+{
+    if (slot >= HAL_FW_SLOT_COUNT || image_size == 0 || digest == NULL || signature == NULL) {
+        return BOOT_VERIFY_ERROR_INVALID_PARAM;
+    }
+
+    boot_image_t images[HAL_FW_SLOT_COUNT];
+    read_images(images);
+    images[slot].magic = BOOT_VERIFY_IMAGE_MAGIC;
+    images[slot].image_size = image_size;
+    images[slot].version = version;
+    memcpy(images[slot].digest, digest, SHA256_DIGEST_SIZE);
+    memcpy(images[slot].signature, signature, P256_SIGNATURE_SIZE);
+
+    if (storage_boot_record_write(STORAGE_BOOT_IMAGES, images, sizeof(images)) != STORAGE_OK) {
+        return BOOT_VERIFY_ERROR;
+    }
+
+    return BOOT_VERIFY_OK;
+}
+
+int boot_verify_image_version(uint8_t slot, uint32_t *version)
+{
+    if (slot >= HAL_FW_SLOT_COUNT || version == NULL) {
+        return BOOT_VERIFY_ERROR_INVALID_PARAM;
+    }
+
+    boot_image_t images[HAL_FW_SLOT_COUNT];
+    read_images(images);
+    if (images[slot].magic != BOOT_VERIFY_IMAGE_MAGIC) {
+        return BOOT_VERIFY_ERROR_NOT_PROVISIONED;
+    }
+
+    *version = images[slot].version;
+    return BOOT_VERIFY_OK;
+}
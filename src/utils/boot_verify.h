@@ -0,0 +1,131 @@
+/**
+ * @file boot_verify.h
+ * @brief Verified Boot with a Cached Image Measurement
+ *
+ * Every firmware slot has a signed descriptor: the size and version of its
+ * image, the SHA-256 of the version (4 bytes, little-endian) followed by the
+ * image, and the vendor's ECDSA P-256 signature over that hash, recorded by
+ * the updater. Hashing the version in makes it as trustworthy as the image,
+ * so the updater can refuse a rollback against it. Checking the descriptor
+ * means hashing the whole image, which on a large image is the longest
+ * step before USB enumeration, so it is done only when needed:
+ *
+ *  - after the slot was rewritten (a flash generation counter, bumped by
+ *    every update, no longer matches the stored measurement);
+ *  - when an integrity scrub is due (every BOOT_VERIFY_SCRUB_BOOTS boots);
+ *  - when the measurement is missing or does not authenticate.
+ *
+ * A full check stores a measurement of the image: the generation, the
+ * image hash and a truncated SHA-256 of every block, authenticated with a
+ * device key. Any other boot only authenticates that measurement, a few
+ * kilobytes, and leaves the image itself to be checked block by block
+ * afterwards: on demand through boot_verify_range() (for platforms that
+ * can trap the first execution of a block), and in idle time for the rest.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef BOOT_VERIFY_H
+#define BOOT_VERIFY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Boot Verify Return Codes */
+#define BOOT_VERIFY_OK 0
+#define BOOT_VERIFY_ERROR -1
+#define BOOT_VERIFY_ERROR_INVALID_PARAM -2
+#define BOOT_VERIFY_ERROR_NOT_SUPPORTED -3   /* No A/B firmware slots */
+#define BOOT_VERIFY_ERROR_NOT_PROVISIONED -4 /* No signing key or no signed descriptor */
+#define BOOT_VERIFY_ERROR_INTEGRITY -5       /* Image does not match its signature */
+
+/* Upper bound on the blocks an image is measured in; blocks grow to fit */
+#define BOOT_VERIFY_MAX_BLOCKS 128
+#define BOOT_VERIFY_MIN_BLOCK_SIZE 4096
+
+/* Truncated SHA-256 kept per block */
+#define BOOT_VERIFY_BLOCK_HASH_SIZE 16
+
+/* Boots between full re-hashes of an unchanged image */
+#define BOOT_VERIFY_SCRUB_BOOTS 64
+
+/**
+ * @brief Verify the running image
+ *
+ * Call once at boot, after storage_init(). On the cached path the blocks
+ * are queued for lazy checking with the idle scheduler.
+ *
+ * @param public_key Trusted signing key (64 bytes), or NULL if none is configured
+ * @return BOOT_VERIFY_OK on success, BOOT_VERIFY_ERROR_INTEGRITY if the image
+ *         must not be trusted, another error code if it could not be checked
+ */
+int boot_verify_init(const uint8_t *public_key);
+
+/**
+ * @brief Check whether boot took the cached path
+ *
+ * @return true if the image was not re-hashed at boot
+ */
+bool boot_verify_cached(void);
+
+/**
+ * @brief Check the blocks covering part of the running image now
+ *
+ * Each block is hashed at most once per boot.
+ *
+ * @param offset Offset in the image
+ * @param len Length of the range
+ * @return BOOT_VERIFY_OK if every block matches, error code otherwise
+ */
+int boot_verify_range(uint32_t offset, size_t len);
+
+/**
+ * @brief Get the number of blocks not checked yet during this boot
+ */
+size_t boot_verify_pending_blocks(void);
+
+/**
+ * @brief Record that a firmware slot is about to be rewritten
+ *
+ * Drops the slot's descriptor and bumps the flash generation counter, which
+ * forces the next boot to re-hash.
+ *
+ * @param slot Slot index
+ * @return BOOT_VERIFY_OK on success, error code otherwise
+ */
+int boot_verify_image_begin(uint8_t slot);
+
+/**
+ * @brief Record the signed descriptor of a freshly written slot
+ *
+ * @param slot Slot index
+ * @param image_size Image size in bytes
+ * @param version Image version
+ * @param digest SHA-256 of the version and the image
+ * @param signature ECDSA P-256 signature over the digest (64 bytes)
+ * @return BOOT_VERIFY_OK on success, error code otherwise
+ */
+int boot_verify_image_commit(uint8_t slot, uint32_t image_size, uint32_t version,
+                             const uint8_t *digest, const uint8_t *signature);
+
+/**
+ * @brief Get the version recorded in a slot's signed descriptor
+ *
+ * @param slot Slot index
+ * @param version Output: image version
+ * @return BOOT_VERIFY_OK on success, BOOT_VERIFY_ERROR_NOT_PROVISIONED if the
+ *         slot has no descriptor, error code otherwise
+ */
+int boot_verify_image_version(uint8_t slot, uint32_t *version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_VERIFY_H */
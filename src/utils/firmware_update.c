@@ -0,0 +1,454 @@
+/**
+ * @file firmware_update.c
+ * @brief Streaming A/B Firmware Update Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "firmware_update.h"
+
+#include <string.h>
+
+#include "boot_verify.h"
+#include "hal.h"
+#include "logger.h"
+#include "module_state.h"
+#include "p256.h"
+#include "sha256.h"
+
+/* Program granule: the image is staged and written one page at a time */
+#define FIRMWARE_UPDATE_PAGE_SIZE 256
+
+/* Bytes of the running image read per flash access while applying a delta */
+#define FIRMWARE_UPDATE_BASE_CHUNK 128
+
+#ifdef FIRMWARE_UPDATE_SIGNING_KEY
+/* Set from the FIRMWARE_SIGNING_KEY CMake option */
+static const uint8_t firmware_signing_key[FIRMWARE_UPDATE_PUBLIC_KEY_SIZE] = {
+    FIRMWARE_UPDATE_SIGNING_KEY};
+#endif
+
+typedef enum {
+    PATCH_CONTROL, /* Collecting a control record */
+    PATCH_DIFF,    /* Adding diff bytes to the running image */
+    PATCH_EXTRA    /* Copying extra bytes */
+} patch_state_t;
+
+static OPENFIDO_STATE struct {
+    bool active;
+    firmware_update_type_t type;
+    uint8_t slot;        /* Slot being written */
+    uint8_t base_slot;   /* Running slot, source of a delta */
+    size_t slot_size;
+    size_t sector_size;
+    uint32_t image_size;
+    uint32_t payload_size;
+    uint32_t version;
+    uint32_t received;   /* Payload bytes accepted */
+    uint32_t written;    /* Image bytes produced */
+    uint32_t programmed; /* Image bytes in flash */
+    uint32_t erased;     /* End of the erased part of the slot */
+    sha256_ctx_t hash;
+    uint8_t page[FIRMWARE_UPDATE_PAGE_SIZE];
+    size_t page_len;
+    struct {
+        patch_state_t state;
+        uint8_t control[FIRMWARE_UPDATE_CONTROL_SIZE];
+        size_t control_len;
+        uint32_t diff_left; /* Image bytes still to come from diff data */
+        bool zero_run;      /* Run-length count byte expected next */
+        uint32_t extra_left;
+        int32_t seek;
+        uint32_t base_pos; /* Cursor into the running image */
+    } patch;
+} update;
+OPENFIDO_STATE_REGISTER(update);
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) |
+           ((uint32_t) p[3] << 24);
+}
+
+/**
+ * @brief Write the staged page, erasing the sector underneath first if needed
+ *
+ * A short final page is padded with the erased value.
+ */
+static int program_page(void)
+{
+    while (update.programmed + FIRMWARE_UPDATE_PAGE_SIZE > update.erased) {
+        if (update.erased >= update.slot_size ||
+            hal_fw_erase(update.slot, update.erased) != HAL_OK) {
+            return FIRMWARE_UPDATE_ERROR_FLASH;
+        }
+        update.erased += update.sector_size;
+    }
+
+    memset(&update.page[update.page_len], 0xFF, FIRMWARE_UPDATE_PAGE_SIZE - update.page_len);
+    if (hal_fw_write(update.slot, update.programmed, update.page, FIRMWARE_UPDATE_PAGE_SIZE) !=
+        HAL_OK) {
+        return FIRMWARE_UPDATE_ERROR_FLASH;
+    }
+
+    update.programmed += FIRMWARE_UPDATE_PAGE_SIZE;
+    update.page_len = 0;
+    return FIRMWARE_UPDATE_OK;
+}
+
+/**
+ * @brief Append bytes to the new image
+ */
+static int emit(const uint8_t *data, size_t len)
+{
+    if (len > update.image_size - update.written) {
+        return FIRMWARE_UPDATE_ERROR_SIZE;
+    }
+
+    sha256_update(&update.hash, data, len);
+    update.written += len;
+
+    while (len > 0) {
+        size_t n = FIRMWARE_UPDATE_PAGE_SIZE - update.page_len;
+        if (n > len) {
+            n = len;
+        }
+
+        memcpy(&update.page[update.page_len], data, n);
+        update.page_len += n;
+        data += n;
+        len -= n;
+
+        if (update.page_len == FIRMWARE_UPDATE_PAGE_SIZE) {
+            int ret = program_page();
+            if (ret != FIRMWARE_UPDATE_OK) {
+                return ret;
+            }
+        }
+    }
+
+    return FIRMWARE_UPDATE_OK;
+}
+
+/**
+ * @brief Produce image bytes from the running image plus diff bytes
+ *
+ * @param diff Diff bytes, or NULL for a run of zeros (unchanged bytes)
+ * @param len Number of image bytes, no more than diff_left
+ */
+static int patch_diff(const uint8_t *diff, size_t len)
+{
+    uint8_t base[FIRMWARE_UPDATE_BASE_CHUNK];
+
+    while (len > 0) {
+        size_t n = (len < sizeof(base)) ? len : sizeof(base);
+
+        if (hal_fw_read(update.base_slot, update.patch.base_pos, base, n) != HAL_OK) {
+            return FIRMWARE_UPDATE_ERROR_FLASH;
+        }
+        if (diff != NULL) {
+            for (size_t i = 0; i < n; i++) {
+                base[i] = (uint8_t) (base[i] + diff[i]);
+            }
+            diff += n;
+        }
+
+        int ret = emit(base, n);
+        if (ret != FIRMWARE_UPDATE_OK) {
+            return ret;
+        }
+
+        update.patch.base_pos += n;
+        update.patch.diff_left -= n;
+        len -= n;
+    }
+
+    return FIRMWARE_UPDATE_OK;
+}
+
+/**
+ * @brief Move to the next part of the current record, or to the next record
+ */
+static void patch_advance(void)
+{
+    if (update.patch.diff_left > 0) {
+        update.patch.state = PATCH_DIFF;
+    } else if (update.patch.extra_left > 0) {
+        update.patch.state = PATCH_EXTRA;
+    } else {
+        /* Range checked when the record was parsed */
+        update.patch.base_pos = (uint32_t) ((int64_t) update.patch.base_pos + update.patch.seek);
+        update.patch.control_len = 0;
+        update.patch.state = PATCH_CONTROL;
+    }
+}
+
+/**
+ * @brief Parse a complete control record
+ */
+static int patch_start_record(void)
+{
+    uint32_t diff_len = read_le32(&update.patch.control[0]);
+    uint32_t extra_len = read_le32(&update.patch.control[4]);
+    int32_t seek = (int32_t) read_le32(&update.patch.control[8]);
+
+    /* The record must fit the image, and the cursor must stay within the running slot */
+    uint64_t produced = (uint64_t) diff_len + extra_len;
+    int64_t base_end = (int64_t) update.patch.base_pos + diff_len;
+    int64_t base_next = base_end + seek;
+    if (produced > update.image_size - update.written || base_end > (int64_t) update.slot_size ||
+        base_next < 0 || base_next > (int64_t) update.slot_size) {
+        return FIRMWARE_UPDATE_ERROR_PATCH;
+    }
+
+    update.patch.diff_left = diff_len;
+    update.patch.extra_left = extra_len;
+    update.patch.seek = seek;
+    patch_advance();
+    return FIRMWARE_UPDATE_OK;
+}
+
+/**
+ * @brief Apply a chunk of delta payload
+ */
+static int patch_apply(const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        size_t n;
+        int ret = FIRMWARE_UPDATE_OK;
+
+        switch (update.patch.state) {
+            case PATCH_CONTROL:
+                n = FIRMWARE_UPDATE_CONTROL_SIZE - update.patch.control_len;
+                if (n > len) {
+                    n = len;
+                }
+                memcpy(&update.patch.control[update.patch.control_len], data, n);
+                update.patch.control_len += n;
+                if (update.patch.control_len == FIRMWARE_UPDATE_CONTROL_SIZE) {
+                    ret = patch_start_record();
+                }
+                break;
+
+            case PATCH_DIFF:
+                if (update.patch.zero_run) {
+                    /* Count byte of a zero run */
+                    n = 1;
+                    if ((uint32_t) data[0] + 1 > update.patch.diff_left) {
+                        return FIRMWARE_UPDATE_ERROR_PATCH;
+                    }
+                    update.patch.zero_run = false;
+                    ret = patch_diff(NULL, (size_t) data[0] + 1);
+                } else if (data[0] == 0) {
+                    n = 1;
+                    update.patch.zero_run = true;
+                } else {
+                    /* Literal diff bytes up to the next zero */
+                    n = 0;
+                    while (n < len && n < update.patch.diff_left && data[n] != 0) {
+                        n++;
+                    }
+                    ret = patch_diff(data, n);
+                }
+
+                if (update.patch.diff_left == 0) {
+                    patch_advance();
+                }
+                break;
+
+            case PATCH_EXTRA:
+                n = len;
+                if (n > update.patch.extra_left) {
+                    n = update.patch.extra_left;
+                }
+
+                ret = emit(data, n);
+                update.patch.extra_left -= n;
+                if (update.patch.extra_left == 0) {
+                    patch_advance();
+                }
+                break;
+
+            default:
+                return FIRMWARE_UPDATE_ERROR_STATE;
+        }
+
+        if (ret != FIRMWARE_UPDATE_OK) {
+            return ret;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return FIRMWARE_UPDATE_OK;
+}
+
+int firmware_update_begin(const firmware_update_header_t *header)
+{
+    firmware_update_abort();
+
+    if (header == NULL || header->image_size == 0 ||
+        (header->type != FIRMWARE_UPDATE_FULL && header->type != FIRMWARE_UPDATE_DELTA) ||
+        (header->type == FIRMWARE_UPDATE_FULL && header->payload_size != header->image_size)) {
+        return FIRMWARE_UPDATE_ERROR_INVALID_PARAM;
+    }
+
+    hal_fw_slots_t slots;
+    int ret = hal_fw_get_slots(&slots);
+    if (ret == HAL_ERROR_NOT_SUPPORTED) {
+        return FIRMWARE_UPDATE_ERROR_NOT_SUPPORTED;
+    }
+    if (ret != HAL_OK || slots.sector_size == 0 ||
+        slots.sector_size % FIRMWARE_UPDATE_PAGE_SIZE != 0 ||
+        slots.slot_size % slots.sector_size != 0) {
+        return FIRMWARE_UPDATE_ERROR;
+    }
+
+    if (header->image_size > slots.slot_size) {
+        LOG_ERROR("Firmware image of %u bytes exceeds the %u-byte slot",
+                  (unsigned) header->image_size, (unsigned) slots.slot_size);
+        return FIRMWARE_UPDATE_ERROR_SIZE;
+    }
+
+    /* No rollback to an older image, however well signed */
+    uint32_t running_version;
+    if (boot_verify_image_version(slots.active, &running_version) == BOOT_VERIFY_OK &&
+        header->version < running_version) {
+        LOG_ERROR("Firmware version %u is older than the running %u", (unsigned) header->version,
+                  (unsigned) running_version);
+        return FIRMWARE_UPDATE_ERROR_VERSION;
+    }
+
+    uint8_t slot = (uint8_t) ((slots.active + 1) % HAL_FW_SLOT_COUNT);
+
+    /* The slot stops being bootable as a verified image from here on */
+    if (boot_verify_image_begin(slot) != BOOT_VERIFY_OK) {
+        return FIRMWARE_UPDATE_ERROR_FLASH;
+    }
+
+    update.type = header->type;
+    update.base_slot = slots.active;
+    update.slot = slot;
+    update.slot_size = slots.slot_size;
+    update.sector_size = slots.sector_size;
+    update.image_size = header->image_size;
+    update.payload_size = header->payload_size;
+    update.version = header->version;
+    update.patch.state = PATCH_CONTROL;
+    update.active = true;
+
+    /* The signed hash starts with the version */
+    uint8_t version[4] = {(uint8_t) header->version, (uint8_t) (header->version >> 8),
+                          (uint8_t) (header->version >> 16), (uint8_t) (header->version >> 24)};
+    sha256_init(&update.hash);
+    sha256_update(&update.hash, version, sizeof(version));
+
+    LOG_INFO("Firmware update: %s of version %u, %u bytes into slot %u",
+             header->type == FIRMWARE_UPDATE_DELTA ? "delta" : "full image",
+             (unsigned) header->version, (unsigned) header->payload_size, update.slot);
+    return FIRMWARE_UPDATE_OK;
+}
+
+int firmware_update_write(uint32_t offset, const uint8_t *data, size_t len)
+{
+    if (!update.active) {
+        return FIRMWARE_UPDATE_ERROR_STATE;
+    }
+
+    if (data == NULL && len > 0) {
+        return FIRMWARE_UPDATE_ERROR_INVALID_PARAM;
+    }
+
+    if (offset != update.received) {
+        return FIRMWARE_UPDATE_ERROR_SEQUENCE;
+    }
+
+    int ret = FIRMWARE_UPDATE_ERROR_SIZE;
+    if (len <= update.payload_size - update.received) {
+        ret = (update.type == FIRMWARE_UPDATE_DELTA) ? patch_apply(data, len) : emit(data, len);
+    }
+
+    if (ret != FIRMWARE_UPDATE_OK) {
+        LOG_ERROR("Firmware update failed at offset %u (%d)", (unsigned) offset, ret);
+        firmware_update_abort();
+        return ret;
+    }
+
+    update.received += (uint32_t) len;
+    return FIRMWARE_UPDATE_OK;
+}
+
+int firmware_update_finish(const uint8_t *public_key, const uint8_t *signature)
+{
+    if (!update.active) {
+        return FIRMWARE_UPDATE_ERROR_STATE;
+    }
+
+    if (public_key == NULL || signature == NULL) {
+        firmware_update_abort();
+        return FIRMWARE_UPDATE_ERROR_INVALID_PARAM;
+    }
+
+    int ret = FIRMWARE_UPDATE_OK;
+    if (update.received != update.payload_size || update.written != update.image_size ||
+        update.patch.state != PATCH_CONTROL || update.patch.control_len != 0) {
+        ret = FIRMWARE_UPDATE_ERROR_SIZE;
+    } else if (update.page_len > 0) {
+        ret = program_page();
+    }
+
+    if (ret == FIRMWARE_UPDATE_OK) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        sha256_final(&update.hash, digest);
+        if (p256_ecdsa_verify(public_key, digest, signature) != P256_OK) {
+            ret = FIRMWARE_UPDATE_ERROR_SIGNATURE;
+        } else if (boot_verify_image_commit(update.slot, update.image_size, update.version, digest,
+                                            signature) != BOOT_VERIFY_OK ||
+                   hal_fw_set_boot_slot(update.slot) != HAL_OK) {
+            ret = FIRMWARE_UPDATE_ERROR_FLASH;
+        }
+    }
+
+    if (ret == FIRMWARE_UPDATE_OK) {
+        LOG_INFO("Firmware update verified, slot %u boots next", update.slot);
+    } else {
+        LOG_ERROR("Firmware update rejected (%d)", ret);
+    }
+
+    firmware_update_abort();
+    return ret;
+}
+
+void firmware_update_abort(void)
+{
+    memset(&update, 0, sizeof(update));
+}
+
+const uint8_t *firmware_update_signing_key(void)
+{
+#ifdef FIRMWARE_UPDATE_SIGNING_KEY
+    return firmware_signing_key;
+#else
+    return NULL;
+#endif
+}
+
+bool firmware_update_in_progress(void)
+{
+    return update.active;
+}
+
+uint32_t firmware_update_received(void)
+{
+    return update.received;
+}
+
+bool firmware_update_running_version(uint32_t *version)
+{
+    hal_fw_slots_t slots;
+
+    return version != NULL && hal_fw_get_slots(&slots) == HAL_OK &&
+           boot_verify_image_version(slots.active, version) == BOOT_VERIFY_OK;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file firmware_update.h
+ * @brief Streaming A/B Firmware Update
+ *
+ * The new image is written to the inactive slot chunk by chunk as it
+ * arrives; nothing larger than one flash page is ever buffered. A running
+ * SHA-256 over the produced image is checked against an ECDSA P-256
+ * signature at the end, and only then is the boot selector switched over
+ * to the new slot, in a single atomic HAL call. The signature is kept with
+ * the slot for verified boot (see boot_verify.h).
+ *
+ * An update is delivered either as the full image or as a delta against
+ * the running image. A delta is a sequence of bsdiff control records, each
+ * followed by its data so that it can be applied on the fly:
+ *
+ *   diff_len (u32) | extra_len (u32) | seek (i32)     little-endian
+ *   diff data       diff_len bytes added bytewise to the running image
+ *   extra_len bytes copied as they are
+ *
+ * after which the running-image cursor moves by seek. bsdiff relies on a
+ * general-purpose compressor to squeeze the mostly-zero diff bytes; here
+ * they are run-length coded instead, which needs no window: a non-zero
+ * byte is one diff byte, and 0x00 followed by n stands for n + 1 zero diff
+ * bytes, i.e. bytes copied unchanged from the running image.
+ *
+ * The signature always covers the resulting image, so a delta built
+ * against the wrong base is rejected like any other corrupted image.
+ *
+ * Every image carries a version, signed along with it: the signature is
+ * over SHA-256(version | image), the version as 4 bytes little-endian. An
+ * update whose version is lower than that of the running image (as
+ * recorded in its signed descriptor) is refused up front, so a validly
+ * signed but older image with known flaws cannot be reinstalled. A running
+ * image without a descriptor, e.g. one flashed at the factory, has no
+ * version to compare against.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef FIRMWARE_UPDATE_H
+#define FIRMWARE_UPDATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Firmware Update Return Codes */
+#define FIRMWARE_UPDATE_OK 0
+#define FIRMWARE_UPDATE_ERROR -1
+#define FIRMWARE_UPDATE_ERROR_INVALID_PARAM -2
+#define FIRMWARE_UPDATE_ERROR_NOT_SUPPORTED -3
+#define FIRMWARE_UPDATE_ERROR_STATE -4
+#define FIRMWARE_UPDATE_ERROR_SEQUENCE -5
+#define FIRMWARE_UPDATE_ERROR_SIZE -6
+#define FIRMWARE_UPDATE_ERROR_PATCH -7
+#define FIRMWARE_UPDATE_ERROR_FLASH -8
+#define FIRMWARE_UPDATE_ERROR_SIGNATURE -9
+#define FIRMWARE_UPDATE_ERROR_VERSION -10
+
+/* P-256 public key (X || Y) and signature (r || s) sizes */
+#define FIRMWARE_UPDATE_PUBLIC_KEY_SIZE 64
+#define FIRMWARE_UPDATE_SIGNATURE_SIZE 64
+
+/* Size of a delta control record */
+#define FIRMWARE_UPDATE_CONTROL_SIZE 12
+
+/* Update payload type */
+typedef enum {
+    FIRMWARE_UPDATE_FULL = 0x00, /* Complete image */
+    FIRMWARE_UPDATE_DELTA = 0x01 /* Delta against the running image */
+} firmware_update_type_t;
+
+/**
+ * @brief Update parameters, sent ahead of the payload
+ */
+typedef struct {
+    firmware_update_type_t type;
+    uint32_t image_size;   /* Size of the new image */
+    uint32_t payload_size; /* Bytes to be streamed (image_size for a full image) */
+    uint32_t version;      /* Version of the new image, covered by the signature */
+} firmware_update_header_t;
+
+/**
+ * @brief Start an update into the inactive slot
+ *
+ * Aborts any update in progress.
+ *
+ * @param header Update parameters
+ * @return FIRMWARE_UPDATE_OK on success, FIRMWARE_UPDATE_ERROR_VERSION if the
+ *         image is older than the running one, error code otherwise
+ */
+int firmware_update_begin(const firmware_update_header_t *header);
+
+/**
+ * @brief Feed the next chunk of the payload
+ *
+ * Chunks must arrive in order; a chunk at any other offset is refused
+ * without side effects, so the sender can resynchronise on
+ * firmware_update_received().
+ *
+ * @param offset Payload offset of the chunk
+ * @param data Chunk data
+ * @param len Chunk length
+ * @return FIRMWARE_UPDATE_OK on success, error code otherwise (the update
+ *         is aborted on anything but a sequence error)
+ */
+int firmware_update_write(uint32_t offset, const uint8_t *data, size_t len);
+
+/**
+ * @brief Verify the image and make it the next one to boot
+ *
+ * @param public_key Trusted signing key (FIRMWARE_UPDATE_PUBLIC_KEY_SIZE bytes)
+ * @param signature ECDSA signature over SHA-256 of the version and the image
+ * @return FIRMWARE_UPDATE_OK on success, error code otherwise; the update
+ *         is over either way
+ */
+int firmware_update_finish(const uint8_t *public_key, const uint8_t *signature);
+
+/**
+ * @brief Abandon the update in progress
+ *
+ * The boot selector is untouched, so the running image stays in place.
+ */
+void firmware_update_abort(void);
+
+/**
+ * @brief Get the key firmware images must be signed with
+ *
+ * @return Public key (FIRMWARE_UPDATE_PUBLIC_KEY_SIZE bytes), or NULL if the
+ *         build has no FIRMWARE_SIGNING_KEY
+ */
+const uint8_t *firmware_update_signing_key(void);
+
+/**
+ * @brief Check whether an update is in progress
+ */
+bool firmware_update_in_progress(void);
+
+/**
+ * @brief Get the number of payload bytes accepted so far
+ */
+uint32_t firmware_update_received(void);
+
+/**
+ * @brief Get the version of the running image
+ *
+ * @param version Output: version from the running slot's signed descriptor
+ * @return true if the running image has a descriptor
+ */
+bool firmware_update_running_version(uint32_t *version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIRMWARE_UPDATE_H */
@@ -0,0 +1,194 @@
+/**
+ * @file idle_scheduler.c
+ * @brief Idle-Time Background Work Scheduler Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "idle_scheduler.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "hal.h"
+#include "logger.h"
+#include "module_state.h"
+
+/* Upper bound on steps per idle window (guards against coarse tick sources) */
+#define IDLE_SCHED_MAX_STEPS_PER_RUN 64
+
+/* Registered task state */
+typedef struct {
+    idle_task_config_t config;
+    bool pending;
+    uint64_t next_due_ms;
+    uint64_t last_run_ms;
+    uint32_t used_ms; /* Time consumed in the current window */
+} idle_task_t;
+
+/* Scheduler state */
+static OPENFIDO_STATE struct {
+    idle_task_t tasks[IDLE_SCHED_MAX_TASKS];
+    size_t task_count;
+    uint64_t deadline_ms;
+    volatile bool preempted;
+    bool running;
+} sched_state = {0};
+OPENFIDO_STATE_REGISTER(sched_state);
+
+void idle_sched_init(void)
+{
+    memset(&sched_state, 0, sizeof(sched_state));
+    LOG_DEBUG("Idle scheduler initialized");
+}
+
+int idle_sched_register(const idle_task_config_t *config)
+{
+    if (config == NULL || config->step == NULL || config->budget_ms == 0 ||
+        config->priority > IDLE_PRIORITY_LOW) {
+        return IDLE_SCHED_ERROR_INVALID_PARAM;
+    }
+
+    if (sched_state.task_count >= IDLE_SCHED_MAX_TASKS) {
+        LOG_ERROR("Idle scheduler full, cannot register %s",
+                  config->name ? config->name : "(unnamed)");
+        return IDLE_SCHED_ERROR_FULL;
+    }
+
+    int task_id = (int) sched_state.task_count++;
+    idle_task_t *task = &sched_state.tasks[task_id];
+
+    memset(task, 0, sizeof(*task));
+    memcpy(&task->config, config, sizeof(idle_task_config_t));
+    task->pending = (config->period_ms > 0);
+
+    LOG_DEBUG("Registered idle task %d: %s (prio=%d, budget=%ums, period=%ums)", task_id,
+              config->name ? config->name : "(unnamed)", config->priority, config->budget_ms,
+              config->period_ms);
+
+    return task_id;
+}
+
+int idle_sched_trigger(int task_id)
+{
+    if (task_id < 0 || (size_t) task_id >= sched_state.task_count) {
+        return IDLE_SCHED_ERROR_INVALID_PARAM;
+    }
+
+    sched_state.tasks[task_id].pending = true;
+    return IDLE_SCHED_OK;
+}
+
+void idle_sched_preempt(void)
+{
+    sched_state.preempted = true;
+}
+
+bool idle_sched_should_yield(void)
+{
+    if (sched_state.preempted) {
+        return true;
+    }
+
+    return sched_state.running && hal_get_timestamp_ms() >= sched_state.deadline_ms;
+}
+
+bool idle_sched_has_pending(void)
+{
+    for (size_t i = 0; i < sched_state.task_count; i++) {
+        if (sched_state.tasks[i].pending) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Pick the next task to run
+ *
+ * Highest priority first; among equal priorities the least recently run task
+ * wins, so one busy task cannot starve its peers. Steps cannot be
+ * interrupted, so a task whose budget does not fit in what is left of the
+ * window waits for a longer one.
+ *
+ * @param remaining_ms Time left in the window
+ * @return Task pointer, or NULL if nothing is runnable
+ */
+static idle_task_t *pick_next_task(uint32_t remaining_ms)
+{
+    idle_task_t *best = NULL;
+
+    for (size_t i = 0; i < sched_state.task_count; i++) {
+        idle_task_t *task = &sched_state.tasks[i];
+
+        if (!task->pending || task->used_ms >= task->config.budget_ms ||
+            task->config.budget_ms > remaining_ms) {
+            continue;
+        }
+
+        if (best == NULL || task->config.priority < best->config.priority ||
+            (task->config.priority == best->config.priority &&
+             task->last_run_ms < best->last_run_ms)) {
+            best = task;
+        }
+    }
+
+    return best;
+}
+
+uint32_t idle_sched_run(uint32_t window_ms)
+{
+    uint64_t start_ms = hal_get_timestamp_ms();
+
+    sched_state.deadline_ms = start_ms + window_ms;
+    sched_state.preempted = false;
+    sched_state.running = true;
+
+    /* Re-arm periodic tasks and open a fresh budget for everyone */
+    for (size_t i = 0; i < sched_state.task_count; i++) {
+        idle_task_t *task = &sched_state.tasks[i];
+        if (task->config.period_ms > 0 && start_ms >= task->next_due_ms) {
+            task->pending = true;
+        }
+        task->used_ms = 0;
+    }
+
+    for (int steps = 0; steps < IDLE_SCHED_MAX_STEPS_PER_RUN; steps++) {
+        if (idle_sched_should_yield()) {
+            break;
+        }
+
+        uint64_t step_start_ms = hal_get_timestamp_ms();
+        uint32_t remaining_ms = (step_start_ms < sched_state.deadline_ms)
+                                    ? (uint32_t) (sched_state.deadline_ms - step_start_ms)
+                                    : 0;
+        idle_task_t *task = pick_next_task(remaining_ms);
+        if (task == NULL) {
+            break;
+        }
+
+        idle_task_status_t status = task->config.step(task->config.context);
+        uint64_t step_end_ms = hal_get_timestamp_ms();
+
+        uint32_t elapsed_ms = (uint32_t) (step_end_ms - step_start_ms);
+        task->used_ms += elapsed_ms;
+        task->last_run_ms = step_end_ms;
+
+        if (elapsed_ms > task->config.budget_ms) {
+            LOG_WARN("Idle task %s overran its budget (%ums > %ums)", task->config.name,
+                     elapsed_ms, task->config.budget_ms);
+        }
+
+        if (status == IDLE_TASK_DONE) {
+            task->pending = false;
+            if (task->config.period_ms > 0) {
+                task->next_due_ms = step_end_ms + task->config.period_ms;
+            }
+        }
+    }
+
+    sched_state.running = false;
+
+    return (uint32_t) (hal_get_timestamp_ms() - start_ms);
+}
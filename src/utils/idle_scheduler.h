@@ -0,0 +1,139 @@
+/**
+ * @file idle_scheduler.h
+ * @brief Idle-Time Background Work Scheduler
+ *
+ * Runs deferred maintenance (counter checkpoints, DRBG reseeding, key
+ * pre-generation, ...) in the gaps between user requests. Tasks are written
+ * as short incremental steps; the scheduler keeps calling a task's step
+ * function until the task's budget or the idle window is used up, or until a
+ * request arrives and preempts it. A step is only started while the task's
+ * whole budget still fits in the window, so the budget is also the longest a
+ * single step may take.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef IDLE_SCHEDULER_H
+#define IDLE_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Idle Scheduler Return Codes */
+#define IDLE_SCHED_OK 0
+#define IDLE_SCHED_ERROR -1
+#define IDLE_SCHED_ERROR_FULL -2
+#define IDLE_SCHED_ERROR_INVALID_PARAM -3
+
+/* Maximum number of registered background tasks */
+#define IDLE_SCHED_MAX_TASKS 8
+
+/**
+ * @brief Task priority (lower value runs first)
+ */
+typedef enum {
+    IDLE_PRIORITY_HIGH = 0, /**< Work that protects state (counter checkpoints) */
+    IDLE_PRIORITY_NORMAL,   /**< Work that speeds up the next request (key pool) */
+    IDLE_PRIORITY_LOW       /**< Housekeeping (reseeding, compaction) */
+} idle_priority_t;
+
+/**
+ * @brief Result of one task step
+ */
+typedef enum {
+    IDLE_TASK_DONE = 0, /**< No work left until the task is triggered again */
+    IDLE_TASK_MORE      /**< More work remains; call again when time allows */
+} idle_task_status_t;
+
+/**
+ * @brief Task step function
+ *
+ * Must perform a short, bounded unit of work and return. Long-running steps
+ * may poll idle_sched_should_yield() to stop early.
+ *
+ * @param context Task context pointer
+ * @return IDLE_TASK_MORE if further steps are needed, IDLE_TASK_DONE otherwise
+ */
+typedef idle_task_status_t (*idle_task_fn_t)(void *context);
+
+/**
+ * @brief Background task description
+ */
+typedef struct {
+    const char *name;         /**< Task name (for logging) */
+    idle_task_fn_t step;      /**< Step function */
+    void *context;            /**< Passed to the step function */
+    idle_priority_t priority; /**< Scheduling priority */
+    uint32_t budget_ms;       /**< Maximum time per idle window, and per step */
+    uint32_t period_ms;       /**< Re-trigger period (0 = only on idle_sched_trigger) */
+} idle_task_config_t;
+
+/**
+ * @brief Initialize the idle scheduler
+ *
+ * Clears all registered tasks.
+ */
+void idle_sched_init(void);
+
+/**
+ * @brief Register a background task
+ *
+ * Periodic tasks start pending; on-demand tasks start idle.
+ *
+ * @param config Task description (copied)
+ * @return Task ID (>= 0) on success, negative error code otherwise
+ */
+int idle_sched_register(const idle_task_config_t *config);
+
+/**
+ * @brief Mark a task as having work to do
+ *
+ * @param task_id Task ID returned by idle_sched_register()
+ * @return IDLE_SCHED_OK on success, error code otherwise
+ */
+int idle_sched_trigger(int task_id);
+
+/**
+ * @brief Preempt background work
+ *
+ * Called when a request arrives (safe from interrupt context). The running
+ * step finishes, then the scheduler returns to the main loop.
+ */
+void idle_sched_preempt(void);
+
+/**
+ * @brief Check whether the current step should return early
+ *
+ * @return true if preempted or the idle window has elapsed
+ */
+bool idle_sched_should_yield(void);
+
+/**
+ * @brief Run pending background tasks
+ *
+ * Runs task steps in priority order until no work is pending, the window
+ * elapses, or idle_sched_preempt() is called. The caller sizes the window so
+ * that it ends before the next watchdog feed or BLE service deadline.
+ *
+ * @param window_ms Time available in milliseconds
+ * @return Time spent in milliseconds
+ */
+uint32_t idle_sched_run(uint32_t window_ms);
+
+/**
+ * @brief Check if any task has pending work
+ *
+ * @return true if at least one task is pending
+ */
+bool idle_sched_has_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IDLE_SCHEDULER_H */
@@ -10,65 +10,163 @@
 
 #include <string.h>
 
+#include "config.h"
 #include "hal.h"
 #include "logger.h"
+#include "module_state.h"
 
 /* Default LED patterns */
 static const led_pattern_t default_patterns[] = {
-    [LED_PATTERN_IDLE] = {0, 0, 0, 0},                   /* Off */
-    [LED_PATTERN_PROCESSING] = {100, 100, 0, 128},       /* Blink medium */
-    [LED_PATTERN_USER_PRESENCE] = {50, 50, 0, 255},      /* Blink fast */
-    [LED_PATTERN_SUCCESS] = {500, 0, 1, 255},            /* Solid 500ms */
-    [LED_PATTERN_ERROR] = {100, 100, 3, 255},            /* Blink 3 times */
-    [LED_PATTERN_BOOTLOADER] = {200, 800, 0, 128},       /* Slow blink */
-    [LED_PATTERN_BLE_ADVERTISING] = {500, 1500, 0, 128}, /* Slow blink for advertising */
-    [LED_PATTERN_BLE_CONNECTED] = {0xFFFF, 0, 0, 255},   /* Solid on (very long on time) */
-    [LED_PATTERN_BLE_PROCESSING] = {50, 50, 0, 255},     /* Fast blink for processing */
-    [LED_PATTERN_CUSTOM] = {0, 0, 0, 0}                  /* User-defined */
+    /* Slow blink */
+    [LED_PATTERN_IDLE] = {CONFIG_LED_BLINK_SLOW_MS, CONFIG_LED_BLINK_SLOW_MS, 0, 128},
+    [LED_PATTERN_PROCESSING] = {100, 100, 0, 128},                /* Blink medium */
+    [LED_PATTERN_USER_PRESENCE] = {50, 50, 0, 255},               /* Blink fast */
+    [LED_PATTERN_SUCCESS] = {500, 0, 1, 255},                     /* Solid 500ms */
+    [LED_PATTERN_ERROR] = {100, 100, 3, 255},                     /* Blink 3 times */
+    [LED_PATTERN_BOOTLOADER] = {200, 800, 0, 128},                /* Slow blink */
+    [LED_PATTERN_BLE_ADVERTISING] = {500, 1500, 0, 128},          /* Slow blink for advertising */
+    [LED_PATTERN_BLE_CONNECTED] = {0xFFFF, 0, 0, 255},            /* Solid on (very long on time) */
+    [LED_PATTERN_BLE_PROCESSING] = {50, 50, 0, 255},              /* Fast blink for processing */
+    [LED_PATTERN_ACTIVITY] = {CONFIG_LED_ACTIVITY_MS, 0, 1, 255}, /* Single short flash */
+    [LED_PATTERN_CUSTOM] = {0, 0, 0, 0}                           /* User-defined */
 };
 
+/* Posted request word: sequence << 16 | fallback type << 8 | type */
+#define LED_REQUEST(seq, next, type) \
+    (((uint32_t) (seq) << 16) | ((uint32_t) (next) << 8) | (uint32_t) (type))
+
 /* Current state */
-static struct {
-    led_pattern_type_t current_type;
-    led_pattern_t current_pattern;
+static OPENFIDO_STATE struct {
+    /* Written by led_set_pattern(), read by the player in timer context */
+    volatile uint32_t request;
+    uint16_t request_seq;
+    led_pattern_type_t posted_type; /* Most recently posted pattern */
+    led_pattern_type_t base_type;   /* Most recently posted repeating pattern */
     led_pattern_t custom_pattern;
+    bool timer_driven;
     uint32_t last_update_ms;
+
+    /* Owned by the player */
+    uint16_t applied_seq;
+    led_pattern_type_t current_type;
+    led_pattern_type_t next_type; /* Played once a finite pattern ends */
+    led_pattern_t current_pattern;
+    uint32_t phase_ms;
     uint8_t repeat_counter;
     bool led_state;
 } led_state = {0};
+OPENFIDO_STATE_REGISTER(led_state);
+
+static const led_pattern_t *pattern_for(led_pattern_type_t type)
+{
+    return (type == LED_PATTERN_CUSTOM) ? &led_state.custom_pattern : &default_patterns[type];
+}
+
+/* Drive the LED only on changes */
+static void led_write(bool on)
+{
+    if (on != led_state.led_state) {
+        led_state.led_state = on;
+        hal_led_set_state(on ? HAL_LED_ON : HAL_LED_OFF);
+    }
+}
+
+static void load_pattern(led_pattern_type_t type, led_pattern_type_t next)
+{
+    led_state.current_type = type;
+    led_state.next_type = next;
+    memcpy(&led_state.current_pattern, pattern_for(type), sizeof(led_pattern_t));
+    led_state.phase_ms = 0;
+    led_state.repeat_counter = 0;
+
+    led_write(led_state.current_pattern.on_ms > 0);
+}
+
+/**
+ * @brief Pick up a posted pattern and advance the current one
+ *
+ * @param elapsed_ms Time since the previous call
+ */
+static void led_advance(uint32_t elapsed_ms)
+{
+    uint32_t request = led_state.request;
+    uint16_t seq = (uint16_t) (request >> 16);
+
+    if (seq != led_state.applied_seq) {
+        led_state.applied_seq = seq;
+        load_pattern((led_pattern_type_t) (request & 0xFF),
+                     (led_pattern_type_t) ((request >> 8) & 0xFF));
+        return;
+    }
+
+    const led_pattern_t *pattern = &led_state.current_pattern;
+
+    /* Steady patterns need no timing */
+    if (pattern->on_ms == 0 || (pattern->off_ms == 0 && pattern->repeat_count == 0)) {
+        return;
+    }
+
+    uint32_t period_ms = (uint32_t) pattern->on_ms + pattern->off_ms;
+    led_state.phase_ms += elapsed_ms;
+
+    while (led_state.phase_ms >= period_ms) {
+        led_state.phase_ms -= period_ms;
+
+        if (pattern->repeat_count > 0 && ++led_state.repeat_counter >= pattern->repeat_count) {
+            /* Finite pattern finished: fall back to what was showing before */
+            load_pattern(led_state.next_type, led_state.next_type);
+            return;
+        }
+    }
+
+    led_write(led_state.phase_ms < pattern->on_ms);
+}
+
+/* Post a request for the player */
+static void post_pattern(led_pattern_type_t type)
+{
+    const led_pattern_t *pattern = pattern_for(type);
+
+    if (pattern->repeat_count == 0) {
+        led_state.base_type = type;
+    }
+    led_state.posted_type = type;
+
+    led_state.request_seq++;
+    led_state.request = LED_REQUEST(led_state.request_seq, led_state.base_type, type);
+}
 
 void led_patterns_init(void)
 {
     memset(&led_state, 0, sizeof(led_state));
     led_state.current_type = LED_PATTERN_IDLE;
 
+    if (hal_led_init() != HAL_OK) {
+        LOG_WARN("LED initialization failed");
+    }
+    hal_led_set_state(HAL_LED_OFF);
+
     /* Load custom patterns from storage if available */
     led_patterns_load();
 
-    LOG_INFO("LED patterns initialized");
+    post_pattern(LED_PATTERN_IDLE);
+    led_state.last_update_ms = (uint32_t) hal_get_timestamp_ms();
+
+    /* Without a pattern timer the main loop drives the player */
+    led_state.timer_driven =
+        (hal_led_set_tick_callback(LED_PATTERN_TICK_MS, led_patterns_tick) == HAL_OK);
+
+    LOG_INFO("LED patterns initialized (%s)", led_state.timer_driven ? "timer" : "polled");
 }
 
 void led_set_pattern(led_pattern_type_t type)
 {
-    if (type >= LED_PATTERN_CUSTOM) {
+    if (type > LED_PATTERN_CUSTOM) {
         LOG_WARN("Invalid LED pattern type: %d", type);
         return;
     }
 
-    led_state.current_type = type;
-
-    if (type == LED_PATTERN_CUSTOM) {
-        memcpy(&led_state.current_pattern, &led_state.custom_pattern, sizeof(led_pattern_t));
-    } else {
-        memcpy(&led_state.current_pattern, &default_patterns[type], sizeof(led_pattern_t));
-    }
-
-    led_state.repeat_counter = 0;
-    led_state.led_state = false;
-    led_state.last_update_ms = hal_get_time_ms();
-
-    /* Turn off LED initially */
-    hal_led_set_state(HAL_LED_OFF);
+    post_pattern(type);
 
     LOG_DEBUG("LED pattern set to: %d", type);
 }
@@ -81,11 +179,9 @@ void led_set_custom_pattern(const led_pattern_t *pattern)
 
     memcpy(&led_state.custom_pattern, pattern, sizeof(led_pattern_t));
 
-    /* If custom pattern is active, update current pattern */
-    if (led_state.current_type == LED_PATTERN_CUSTOM) {
-        memcpy(&led_state.current_pattern, pattern, sizeof(led_pattern_t));
-        led_state.repeat_counter = 0;
-        led_state.last_update_ms = hal_get_time_ms();
+    /* If custom pattern is active, restart it with the new timing */
+    if (led_state.posted_type == LED_PATTERN_CUSTOM) {
+        post_pattern(LED_PATTERN_CUSTOM);
     }
 
     LOG_INFO("Custom LED pattern set: on=%dms, off=%dms, repeat=%d", pattern->on_ms,
@@ -94,46 +190,25 @@ void led_set_custom_pattern(const led_pattern_t *pattern)
 
 led_pattern_type_t led_get_current_pattern(void)
 {
-    return led_state.current_type;
+    return led_state.posted_type;
+}
+
+void led_patterns_tick(void)
+{
+    led_advance(LED_PATTERN_TICK_MS);
 }
 
 void led_patterns_update(void)
 {
-    uint32_t now_ms = hal_get_time_ms();
-    led_pattern_t *pattern = &led_state.current_pattern;
-
-    /* Check if pattern is finished */
-    if (pattern->repeat_count > 0 && led_state.repeat_counter >= pattern->repeat_count) {
-        /* Pattern finished, turn off LED */
-        hal_led_set_state(HAL_LED_OFF);
-        led_state.current_type = LED_PATTERN_IDLE;
+    if (led_state.timer_driven) {
         return;
     }
 
-    /* Calculate time since last update */
+    uint32_t now_ms = (uint32_t) hal_get_timestamp_ms();
     uint32_t elapsed_ms = now_ms - led_state.last_update_ms;
 
-    /* Check if it's time to toggle LED */
-    uint16_t threshold_ms = led_state.led_state ? pattern->on_ms : pattern->off_ms;
-
-    if (elapsed_ms >= threshold_ms) {
-        /* Toggle LED state */
-        led_state.led_state = !led_state.led_state;
-        led_state.last_update_ms = now_ms;
-
-        if (led_state.led_state) {
-            /* Turn on LED */
-            hal_led_set_state(HAL_LED_ON);
-
-            /* Increment repeat counter when starting a new cycle */
-            if (pattern->repeat_count > 0) {
-                led_state.repeat_counter++;
-            }
-        } else {
-            /* Turn off LED */
-            hal_led_set_state(HAL_LED_OFF);
-        }
-    }
+    led_state.last_update_ms = now_ms;
+    led_advance(elapsed_ms);
 }
 
 void led_patterns_load(void)
@@ -2,6 +2,12 @@
  * @file led_patterns.h
  * @brief LED Pattern Customization
  *
+ * Patterns are played from a periodic HAL timer: callers only post a pattern
+ * ID and never toggle the LED or sleep themselves. A pattern with a finite
+ * repeat count plays once and then falls back to the pattern posted before
+ * it. Platforms without a spare timer fall back to led_patterns_update()
+ * from the main loop.
+ *
  * @copyright Copyright (c) 2025 OpenFIDO Contributors
  * @license MIT License
  */
@@ -27,6 +33,7 @@ typedef enum {
     LED_PATTERN_BLE_ADVERTISING, /* BLE advertising (slow blink) */
     LED_PATTERN_BLE_CONNECTED,   /* BLE connected (solid on) */
     LED_PATTERN_BLE_PROCESSING,  /* BLE processing (fast blink) */
+    LED_PATTERN_ACTIVITY,        /* Short flash after a request */
     LED_PATTERN_CUSTOM           /* User-defined pattern */
 } led_pattern_type_t;
 
@@ -38,13 +45,19 @@ typedef struct {
     uint8_t brightness;   /* Brightness level (0-255) */
 } led_pattern_t;
 
+/* Pattern player tick period in milliseconds */
+#define LED_PATTERN_TICK_MS 10
+
 /**
- * @brief Initialize LED pattern system
+ * @brief Initialize LED pattern system and start the pattern timer
  */
 void led_patterns_init(void);
 
 /**
- * @brief Set active LED pattern
+ * @brief Post a pattern to the player
+ *
+ * Returns immediately; the pattern timer picks it up on its next tick.
+ * Call from thread context only.
  *
  * @param type Pattern type
  */
@@ -58,17 +71,24 @@ void led_set_pattern(led_pattern_type_t type);
 void led_set_custom_pattern(const led_pattern_t *pattern);
 
 /**
- * @brief Get current pattern
+ * @brief Get the most recently posted pattern
  *
  * @return Current pattern type
  */
 led_pattern_type_t led_get_current_pattern(void);
 
 /**
- * @brief Update LED state (call from main loop)
+ * @brief Advance the player from the main loop
+ *
+ * Only needed on platforms without a pattern timer; a no-op otherwise.
  */
 void led_patterns_update(void);
 
+/**
+ * @brief Advance the player by one tick (called from the pattern timer)
+ */
+void led_patterns_tick(void);
+
 /**
  * @brief Load LED patterns from storage
  */
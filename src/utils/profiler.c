@@ -0,0 +1,269 @@
+/**
+ * @file profiler.c
+ * @brief Function Cycle Profiler Implementation
+ *
+ * Each core only touches its own call stack and table, so the hooks take
+ * no lock. Tables are open-addressed on the function address and only
+ * looked up when a call returns.
+ *
+ * This file must not be built with -finstrument-functions.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "profiler.h"
+
+#include <string.h>
+
+#include "hal.h"
+
+#ifdef OPENFIDO_HOST
+#include <pthread.h>
+#endif
+
+#define PROFILER_HOOK __attribute__((no_instrument_function))
+
+#if CONFIG_ENABLE_PROFILE
+
+_Static_assert((CONFIG_PROFILE_FUNCTIONS & (CONFIG_PROFILE_FUNCTIONS - 1)) == 0,
+               "CONFIG_PROFILE_FUNCTIONS must be a power of two");
+
+typedef struct {
+    uintptr_t function;
+    uint32_t start;
+    uint64_t children; /**< Inclusive cycles of instrumented callees */
+} profiler_frame_t;
+
+typedef struct {
+    profiler_entry_t entries[CONFIG_PROFILE_FUNCTIONS];
+    profiler_frame_t stack[PROFILER_MAX_DEPTH];
+    uint32_t depth;
+    uint32_t dropped;
+} profiler_core_t;
+
+#ifdef OPENFIDO_HOST
+/* Every thread profiles on its own and merges into profiler_shared */
+static _Thread_local profiler_core_t profiler_local;
+static profiler_core_t profiler_shared;
+static pthread_mutex_t profiler_lock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static profiler_core_t profiler_cores[PROFILER_CORES];
+#endif
+
+static PROFILER_HOOK profiler_core_t *profiler_current(void)
+{
+#ifdef OPENFIDO_HOST
+    return &profiler_local;
+#else
+    return &profiler_cores[hal_core_id() % PROFILER_CORES];
+#endif
+}
+
+/**
+ * @brief Find or claim the table slot of a function
+ *
+ * @return Entry, or NULL if the table is full
+ */
+static PROFILER_HOOK profiler_entry_t *profiler_slot(profiler_core_t *core, uintptr_t function)
+{
+    /* Multiplicative hash; low address bits are mostly alignment */
+    size_t index = (size_t) ((function >> 2) * 2654435761u) & (CONFIG_PROFILE_FUNCTIONS - 1);
+
+    for (size_t probe = 0; probe < CONFIG_PROFILE_FUNCTIONS; probe++) {
+        profiler_entry_t *entry = &core->entries[(index + probe) & (CONFIG_PROFILE_FUNCTIONS - 1)];
+        if (entry->function == function) {
+            return entry;
+        }
+        if (entry->function == 0) {
+            entry->function = function;
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+void PROFILER_HOOK __cyg_profile_func_enter(void *function, void *call_site)
+{
+    profiler_core_t *core = profiler_current();
+
+    (void) call_site;
+
+    if (core->depth < PROFILER_MAX_DEPTH) {
+        profiler_frame_t *frame = &core->stack[core->depth];
+        frame->function = (uintptr_t) function;
+        frame->children = 0;
+        frame->start = hal_cycle_count();
+    }
+    core->depth++;
+}
+
+void PROFILER_HOOK __cyg_profile_func_exit(void *function, void *call_site)
+{
+    uint32_t now = hal_cycle_count();
+    profiler_core_t *core = profiler_current();
+
+    (void) function;
+    (void) call_site;
+
+    if (core->depth == 0) {
+        return;
+    }
+
+    core->depth--;
+    if (core->depth >= PROFILER_MAX_DEPTH) {
+        core->dropped++;
+        return;
+    }
+
+    profiler_frame_t *frame = &core->stack[core->depth];
+    uint32_t elapsed = now - frame->start;
+
+    if (core->depth > 0) {
+        core->stack[core->depth - 1].children += elapsed;
+    }
+
+    profiler_entry_t *entry = profiler_slot(core, frame->function);
+    if (entry == NULL) {
+        core->dropped++;
+        return;
+    }
+
+    entry->calls++;
+    entry->inclusive += elapsed;
+    entry->exclusive += (elapsed > frame->children) ? elapsed - frame->children : 0;
+}
+
+static const profiler_core_t *profiler_table(size_t index)
+{
+#ifdef OPENFIDO_HOST
+    (void) index;
+    return &profiler_shared;
+#else
+    return &profiler_cores[index];
+#endif
+}
+
+size_t profiler_slot_count(void)
+{
+#ifdef OPENFIDO_HOST
+    return CONFIG_PROFILE_FUNCTIONS;
+#else
+    return PROFILER_CORES * CONFIG_PROFILE_FUNCTIONS;
+#endif
+}
+
+size_t profiler_read(size_t *cursor, profiler_entry_t *entries, size_t max_entries)
+{
+    if (cursor == NULL || entries == NULL) {
+        return 0;
+    }
+
+    profiler_flush();
+
+    size_t count = 0;
+    size_t slot = *cursor;
+    while (count < max_entries && slot < profiler_slot_count()) {
+        const profiler_core_t *table = profiler_table(slot / CONFIG_PROFILE_FUNCTIONS);
+        const profiler_entry_t *entry = &table->entries[slot % CONFIG_PROFILE_FUNCTIONS];
+        if (entry->function != 0 && entry->calls > 0) {
+            entries[count] = *entry;
+            entries[count].core = (uint32_t) (slot / CONFIG_PROFILE_FUNCTIONS);
+            count++;
+        }
+        slot++;
+    }
+
+    *cursor = slot;
+    return count;
+}
+
+uint32_t profiler_dropped(void)
+{
+    uint32_t dropped = 0;
+
+    for (size_t i = 0; i < profiler_slot_count() / CONFIG_PROFILE_FUNCTIONS; i++) {
+        dropped += profiler_table(i)->dropped;
+    }
+
+    return dropped;
+}
+
+void profiler_clear(void)
+{
+    /* Open calls keep their frames so they still pair with their exits */
+#ifdef OPENFIDO_HOST
+    memset(profiler_local.entries, 0, sizeof(profiler_local.entries));
+    profiler_local.dropped = 0;
+    pthread_mutex_lock(&profiler_lock);
+    memset(profiler_shared.entries, 0, sizeof(profiler_shared.entries));
+    profiler_shared.dropped = 0;
+    pthread_mutex_unlock(&profiler_lock);
+#else
+    for (size_t i = 0; i < PROFILER_CORES; i++) {
+        memset(profiler_cores[i].entries, 0, sizeof(profiler_cores[i].entries));
+        profiler_cores[i].dropped = 0;
+    }
+#endif
+}
+
+void profiler_flush(void)
+{
+#ifdef OPENFIDO_HOST
+    pthread_mutex_lock(&profiler_lock);
+    for (size_t i = 0; i < CONFIG_PROFILE_FUNCTIONS; i++) {
+        const profiler_entry_t *local = &profiler_local.entries[i];
+        if (local->function == 0) {
+            continue;
+        }
+
+        profiler_entry_t *shared = profiler_slot(&profiler_shared, local->function);
+        if (shared == NULL) {
+            profiler_shared.dropped += local->calls;
+            continue;
+        }
+        shared->calls += local->calls;
+        shared->inclusive += local->inclusive;
+        shared->exclusive += local->exclusive;
+    }
+    profiler_shared.dropped += profiler_local.dropped;
+    pthread_mutex_unlock(&profiler_lock);
+
+    memset(profiler_local.entries, 0, sizeof(profiler_local.entries));
+    profiler_local.dropped = 0;
+#endif
+}
+
+#else
+
+size_t profiler_slot_count(void)
+{
+    return 0;
+}
+
+size_t profiler_read(size_t *cursor, profiler_entry_t *entries, size_t max_entries)
+{
+    (void) entries;
+    (void) max_entries;
+
+    if (cursor != NULL) {
+        *cursor = 0;
+    }
+    return 0;
+}
+
+uint32_t profiler_dropped(void)
+{
+    return 0;
+}
+
+void profiler_clear(void)
+{
+}
+
+void profiler_flush(void)
+{
+}
+
+#endif /* CONFIG_ENABLE_PROFILE */
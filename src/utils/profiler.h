@@ -0,0 +1,95 @@
+/**
+ * @file profiler.h
+ * @brief Function Cycle Profiler
+ *
+ * With CONFIG_ENABLE_PROFILE the hot modules (crypto, storage, CBOR, CTAP2
+ * commands, BLE fragmentation) are built with -finstrument-functions, and
+ * the compiler-generated entry/exit hooks charge each call's cycles, from
+ * hal_cycle_count(), to a fixed per-core table. Inclusive time covers the
+ * whole call; exclusive time leaves out instrumented callees, so it is the
+ * function's own cost. The table is read out with the vendor diagnostics
+ * command and symbolized by scripts/profile_report.py.
+ *
+ * Calls longer than one counter wrap (about 25 s at 168 MHz) are
+ * undercounted, and a recursive function's inclusive time counts each
+ * level.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cores with their own table */
+#define PROFILER_CORES 2
+
+/* Deepest instrumented call nesting that is timed */
+#define PROFILER_MAX_DEPTH 32
+
+/**
+ * @brief Per-function totals
+ */
+typedef struct {
+    uintptr_t function; /**< Function address (0 = unused slot) */
+    uint32_t core;      /**< Core the calls ran on */
+    uint32_t calls;     /**< Completed calls */
+    uint64_t inclusive; /**< Cycles including callees */
+    uint64_t exclusive; /**< Cycles excluding instrumented callees */
+} profiler_entry_t;
+
+/**
+ * @brief Number of slots profiler_read() walks over
+ */
+size_t profiler_slot_count(void);
+
+/**
+ * @brief Copy used table entries out
+ *
+ * In the host library this reads the table merged by profiler_flush(),
+ * after flushing the calling thread.
+ *
+ * @param cursor In: slot to start at (0 for the first call); out: slot to
+ *               continue from, profiler_slot_count() once done
+ * @param entries Output buffer
+ * @param max_entries Capacity of @p entries
+ * @return Number of entries copied
+ */
+size_t profiler_read(size_t *cursor, profiler_entry_t *entries, size_t max_entries);
+
+/**
+ * @brief Get the number of calls that were not recorded
+ *
+ * Calls are dropped when the table is full or nesting exceeds
+ * PROFILER_MAX_DEPTH.
+ */
+uint32_t profiler_dropped(void);
+
+/**
+ * @brief Reset all totals
+ */
+void profiler_clear(void);
+
+/**
+ * @brief Merge the calling thread's totals into the shared table
+ *
+ * Only needed in the host library, where each thread profiles into its own
+ * table; does nothing on the device.
+ */
+void profiler_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROFILER_H */
@@ -0,0 +1,153 @@
+/**
+ * @file resume_state.c
+ * @brief Deep-Sleep Warm-State Snapshot Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "resume_state.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "crypto.h"
+#include "ctap2.h"
+#include "hal.h"
+#include "logger.h"
+#include "module_state.h"
+#include "storage.h"
+
+#ifdef ENABLE_BLE
+#include "ble_transport.h"
+#endif
+
+#define RESUME_STATE_MAGIC 0x52534D31 /* "RSM1" */
+#define RESUME_STATE_VERSION 3
+#define RESUME_STATE_TAG_SIZE 16
+
+/* Snapshot layout in retention memory */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;
+    crypto_resume_state_t crypto;
+    storage_resume_state_t storage;
+    ctap2_resume_state_t ctap2;
+#ifdef ENABLE_BLE
+    ble_transport_resume_state_t ble;
+#endif
+    uint8_t tag[RESUME_STATE_TAG_SIZE]; /* Truncated SHA-256 over everything above */
+} resume_snapshot_t;
+
+_Static_assert(sizeof(resume_snapshot_t) <= HAL_RETENTION_SIZE,
+               "Resume snapshot does not fit in retention memory");
+
+/* Working copy; kept off the stack because it holds key material */
+static OPENFIDO_STATE resume_snapshot_t snapshot;
+OPENFIDO_STATE_REGISTER(snapshot);
+
+/**
+ * @brief Compute the snapshot tag
+ *
+ * @param snap Snapshot
+ * @param tag Output tag (RESUME_STATE_TAG_SIZE bytes)
+ * @return true on success
+ */
+static bool compute_tag(const resume_snapshot_t *snap, uint8_t *tag)
+{
+    uint8_t hash[CRYPTO_SHA256_DIGEST_SIZE];
+
+    if (crypto_sha256((const uint8_t *) snap, offsetof(resume_snapshot_t, tag), hash) !=
+        CRYPTO_OK) {
+        return false;
+    }
+
+    memcpy(tag, hash, RESUME_STATE_TAG_SIZE);
+    crypto_secure_zero(hash, sizeof(hash));
+    return true;
+}
+
+int resume_state_save(void)
+{
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.magic = RESUME_STATE_MAGIC;
+    snapshot.version = RESUME_STATE_VERSION;
+    snapshot.length = sizeof(resume_snapshot_t);
+
+    int ret = RESUME_STATE_ERROR;
+
+    if (crypto_save_resume_state(&snapshot.crypto) != CRYPTO_OK ||
+        storage_save_resume_state(&snapshot.storage) != STORAGE_OK) {
+        goto cleanup;
+    }
+
+    ctap2_save_resume_state(&snapshot.ctap2);
+#ifdef ENABLE_BLE
+    ble_transport_save_resume_state(&snapshot.ble);
+#endif
+
+    if (!compute_tag(&snapshot, snapshot.tag)) {
+        goto cleanup;
+    }
+
+    if (hal_retention_write((const uint8_t *) &snapshot, sizeof(snapshot)) != HAL_OK) {
+        goto cleanup;
+    }
+
+    LOG_DEBUG("Deep sleep snapshot saved (%u bytes)", (unsigned) sizeof(snapshot));
+    ret = RESUME_STATE_OK;
+
+cleanup:
+    crypto_secure_zero(&snapshot, sizeof(snapshot));
+    return ret;
+}
+
+int resume_state_restore(void)
+{
+    int ret = RESUME_STATE_ERROR_INVALID;
+    uint8_t tag[RESUME_STATE_TAG_SIZE];
+
+    if (hal_retention_read((uint8_t *) &snapshot, sizeof(snapshot)) != HAL_OK) {
+        goto cleanup;
+    }
+
+    /* One-shot: never restore the same snapshot twice */
+    hal_retention_clear();
+
+    if (snapshot.magic != RESUME_STATE_MAGIC || snapshot.version != RESUME_STATE_VERSION ||
+        snapshot.length != sizeof(resume_snapshot_t)) {
+        goto cleanup;
+    }
+
+    if (!compute_tag(&snapshot, tag) ||
+        constant_time_compare(tag, snapshot.tag, RESUME_STATE_TAG_SIZE) != 0) {
+        LOG_WARN("Deep sleep snapshot failed validation");
+        goto cleanup;
+    }
+
+    if (storage_restore_resume_state(&snapshot.storage) != STORAGE_OK ||
+        crypto_restore_resume_state(&snapshot.crypto) != CRYPTO_OK) {
+        ret = RESUME_STATE_ERROR;
+        goto cleanup;
+    }
+
+    ctap2_restore_resume_state(&snapshot.ctap2);
+#ifdef ENABLE_BLE
+    ble_transport_restore_resume_state(&snapshot.ble);
+#endif
+
+    LOG_INFO("Warm state restored from deep sleep snapshot");
+    ret = RESUME_STATE_OK;
+
+cleanup:
+    crypto_secure_zero(&snapshot, sizeof(snapshot));
+    crypto_secure_zero(tag, sizeof(tag));
+    return ret;
+}
+
+void resume_state_invalidate(void)
+{
+    hal_retention_clear();
+}
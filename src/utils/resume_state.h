@@ -0,0 +1,58 @@
+/**
+ * @file resume_state.h
+ * @brief Deep-Sleep Warm-State Snapshot
+ *
+ * Saves the state that is expensive to rebuild (DRBG seed, pre-generated
+ * keys, ClientPIN key agreement and token, BLE pairing lockout, cached
+ * storage header) to retention memory before deep sleep, and reinstalls it
+ * on wake. The snapshot carries a tag over its contents and is wiped by any
+ * storage write, so a stale snapshot is never restored.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef RESUME_STATE_H
+#define RESUME_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Resume State Return Codes */
+#define RESUME_STATE_OK 0
+#define RESUME_STATE_ERROR -1
+#define RESUME_STATE_ERROR_INVALID -2
+
+/**
+ * @brief Save a warm-state snapshot to retention memory
+ *
+ * @return RESUME_STATE_OK on success, error code otherwise
+ */
+int resume_state_save(void);
+
+/**
+ * @brief Restore the warm-state snapshot
+ *
+ * The snapshot is consumed: it is wiped whether or not it was valid.
+ *
+ * @return RESUME_STATE_OK if state was restored,
+ *         RESUME_STATE_ERROR_INVALID if there was no valid snapshot
+ */
+int resume_state_restore(void);
+
+/**
+ * @brief Invalidate any saved snapshot
+ *
+ * Called by storage before every flash write.
+ */
+void resume_state_invalidate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RESUME_STATE_H */
@@ -0,0 +1,71 @@
+/**
+ * @file spsc_ring.c
+ * @brief Lock-Free Single-Producer Single-Consumer Ring Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "spsc_ring.h"
+
+int spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size, size_t capacity)
+{
+    if (ring == NULL || storage == NULL || slot_size == 0 || capacity == 0 ||
+        (capacity & (capacity - 1)) != 0) {
+        return SPSC_RING_ERROR_INVALID_PARAM;
+    }
+
+    ring->slots = storage;
+    ring->slot_size = slot_size;
+    ring->capacity = capacity;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return SPSC_RING_OK;
+}
+
+void *spsc_ring_reserve(spsc_ring_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (tail - head == ring->capacity) {
+        return NULL;
+    }
+
+    return &ring->slots[(tail & (ring->capacity - 1)) * ring->slot_size];
+}
+
+void spsc_ring_commit(spsc_ring_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    /* Slot contents become visible to the consumer together with the index */
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+void *spsc_ring_peek(spsc_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head == tail) {
+        return NULL;
+    }
+
+    return &ring->slots[(head & (ring->capacity - 1)) * ring->slot_size];
+}
+
+void spsc_ring_release(spsc_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    /* Reads of the slot complete before the producer may reuse it */
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+bool spsc_ring_is_empty(spsc_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire) ==
+           atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file spsc_ring.h
+ * @brief Lock-Free Single-Producer Single-Consumer Ring
+ *
+ * Fixed-size slots in caller-provided storage. The producer reserves a slot,
+ * fills it in place and commits it; the consumer peeks at the oldest slot,
+ * uses it in place and releases it, so messages are never copied. Each
+ * index is written by one side only, with release/acquire ordering, which
+ * makes the ring safe between two cores without a lock.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SPSC Ring Return Codes */
+#define SPSC_RING_OK 0
+#define SPSC_RING_ERROR_INVALID_PARAM -1
+
+/**
+ * @brief Ring state
+ *
+ * head and tail count slots since initialization and wrap naturally; the
+ * difference between them is the fill level.
+ */
+typedef struct {
+    uint8_t *slots;     /**< capacity * slot_size bytes */
+    size_t slot_size;   /**< Size of one slot */
+    size_t capacity;    /**< Number of slots (power of two) */
+    atomic_size_t head; /**< Next slot to consume (written by the consumer) */
+    atomic_size_t tail; /**< Next slot to produce (written by the producer) */
+} spsc_ring_t;
+
+/**
+ * @brief Initialize a ring over caller-provided storage
+ *
+ * @param ring Ring
+ * @param storage capacity * slot_size bytes, suitably aligned for the slot type
+ * @param slot_size Size of one slot
+ * @param capacity Number of slots (power of two)
+ * @return SPSC_RING_OK on success, SPSC_RING_ERROR_INVALID_PARAM otherwise
+ */
+int spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size, size_t capacity);
+
+/**
+ * @brief Producer: get the next free slot
+ *
+ * @return Slot to fill, or NULL if the ring is full
+ */
+void *spsc_ring_reserve(spsc_ring_t *ring);
+
+/**
+ * @brief Producer: publish the slot returned by spsc_ring_reserve()
+ */
+void spsc_ring_commit(spsc_ring_t *ring);
+
+/**
+ * @brief Consumer: get the oldest published slot
+ *
+ * @return Slot, or NULL if the ring is empty
+ */
+void *spsc_ring_peek(spsc_ring_t *ring);
+
+/**
+ * @brief Consumer: hand the slot returned by spsc_ring_peek() back to the producer
+ */
+void spsc_ring_release(spsc_ring_t *ring);
+
+/**
+ * @brief Check whether the ring holds no published slots
+ */
+bool spsc_ring_is_empty(spsc_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,72 @@
+/**
+ * @file trace.c
+ * @brief Request Span Tracing Implementation
+ *
+ * Writers claim a slot with one atomic increment, so the two cores never
+ * contend on a lock. A reader racing a writer can see a slot half updated;
+ * that is accepted for a diagnostic buffer.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "hal.h"
+
+_Static_assert((CONFIG_TRACE_EVENTS & (CONFIG_TRACE_EVENTS - 1)) == 0,
+               "CONFIG_TRACE_EVENTS must be a power of two");
+
+/* Shared by every core and, in the host library, every context */
+static trace_event_t trace_events[CONFIG_TRACE_EVENTS];
+static atomic_uint_least32_t trace_next;
+
+void trace_record(trace_span_t span, uint8_t phase, uint8_t arg)
+{
+    uint32_t index = atomic_fetch_add_explicit(&trace_next, 1, memory_order_relaxed);
+    trace_event_t *event = &trace_events[index & (CONFIG_TRACE_EVENTS - 1)];
+
+    event->timestamp_us = (uint32_t) hal_get_timestamp_us();
+    event->span = (uint8_t) span;
+    event->phase = phase;
+    event->core = (uint8_t) hal_core_id();
+    event->arg = arg;
+}
+
+uint32_t trace_head(void)
+{
+    return atomic_load_explicit(&trace_next, memory_order_acquire);
+}
+
+size_t trace_read(uint32_t *cursor, trace_event_t *events, size_t max_events)
+{
+    if (cursor == NULL || events == NULL) {
+        return 0;
+    }
+
+    uint32_t head = trace_head();
+    uint32_t start = *cursor;
+
+    /* Skip events that were overwritten (or a cursor from before a clear) */
+    if (head - start > CONFIG_TRACE_EVENTS) {
+        start = head > CONFIG_TRACE_EVENTS ? head - CONFIG_TRACE_EVENTS : 0;
+    }
+
+    size_t count = 0;
+    while (count < max_events && start + count != head) {
+        events[count] = trace_events[(start + count) & (CONFIG_TRACE_EVENTS - 1)];
+        count++;
+    }
+
+    *cursor = start + (uint32_t) count;
+    return count;
+}
+
+void trace_clear(void)
+{
+    atomic_store_explicit(&trace_next, 0, memory_order_release);
+    memset(trace_events, 0, sizeof(trace_events));
+}
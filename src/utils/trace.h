@@ -0,0 +1,123 @@
+/**
+ * @file trace.h
+ * @brief Request Span Tracing
+ *
+ * Trace points mark the begin and end of each stage a request goes through
+ * (packet reassembly, CBOR parsing, storage lookup, key unwrap, keygen and
+ * signing, flash writes, response encoding and sending). Each mark is an
+ * 8-byte event appended to a RAM ring with a microsecond timestamp and the
+ * core it ran on. The ring is read out with the vendor trace command and
+ * turned into a Chrome trace by scripts/trace_to_chrome.py.
+ *
+ * With CONFIG_ENABLE_TRACE off the TRACE_BEGIN()/TRACE_END() macros compile
+ * to nothing.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Traced stage
+ *
+ * Keep in sync with SPAN_NAMES in scripts/trace_to_chrome.py.
+ */
+typedef enum {
+    TRACE_SPAN_REQUEST = 0,   /**< CTAP2 request; arg = command byte */
+    TRACE_SPAN_U2F,           /**< U2F request; arg = INS */
+    TRACE_SPAN_USB_RECEIVE,   /**< CTAPHID message reassembly; arg = CTAPHID command */
+    TRACE_SPAN_CBOR_PARSE,    /**< Request parameter decoding */
+    TRACE_SPAN_STORAGE_FIND,  /**< Credential lookup */
+    TRACE_SPAN_DECRYPT,       /**< Credential key unwrap */
+    TRACE_SPAN_KEYGEN,        /**< Key pair generation; arg = 1 if served from the pool */
+    TRACE_SPAN_SIGN,          /**< ECDSA signature */
+    TRACE_SPAN_FLASH_WRITE,   /**< Flash program */
+    TRACE_SPAN_FLASH_ERASE,   /**< Flash sector erase */
+    TRACE_SPAN_ENCODE,        /**< Response encoding */
+    TRACE_SPAN_SEND,          /**< CTAPHID response transmission */
+    TRACE_SPAN_UP_WAIT,       /**< Waiting for the user-presence touch */
+    TRACE_SPAN_COUNT
+} trace_span_t;
+
+/* Event phases */
+#define TRACE_PHASE_BEGIN 0
+#define TRACE_PHASE_END 1
+
+/**
+ * @brief Trace event as stored and as read out (little-endian fields)
+ */
+typedef struct {
+    uint32_t timestamp_us; /**< Low 32 bits of hal_get_timestamp_us() */
+    uint8_t span;          /**< trace_span_t */
+    uint8_t phase;         /**< TRACE_PHASE_BEGIN or TRACE_PHASE_END */
+    uint8_t core;          /**< hal_core_id() */
+    uint8_t arg;           /**< Span-specific argument */
+} trace_event_t;
+
+/**
+ * @brief Append an event to the trace ring
+ *
+ * Safe to call from both cores. When the ring is full the oldest events
+ * are overwritten.
+ *
+ * @param span Stage
+ * @param phase TRACE_PHASE_BEGIN or TRACE_PHASE_END
+ * @param arg Span-specific argument
+ */
+void trace_record(trace_span_t span, uint8_t phase, uint8_t arg);
+
+/**
+ * @brief Get the index the next event will be written at
+ *
+ * Indices count events since the last trace_clear() and wrap at 2^32.
+ */
+uint32_t trace_head(void);
+
+/**
+ * @brief Copy events out of the trace ring
+ *
+ * If events at @p cursor have already been overwritten, reading starts at
+ * the oldest event still held and @p cursor is moved forward accordingly.
+ *
+ * @param cursor In: index of the first event wanted; out: index after the
+ *               last event copied
+ * @param events Output buffer
+ * @param max_events Capacity of @p events
+ * @return Number of events copied
+ */
+size_t trace_read(uint32_t *cursor, trace_event_t *events, size_t max_events);
+
+/**
+ * @brief Discard all events
+ */
+void trace_clear(void);
+
+/*
+ * A span whose stage fails may skip its TRACE_END(); the converter closes it
+ * when the enclosing span ends.
+ */
+#if CONFIG_ENABLE_TRACE
+#define TRACE_BEGIN(span, arg) trace_record((span), TRACE_PHASE_BEGIN, (uint8_t) (arg))
+#define TRACE_END(span) trace_record((span), TRACE_PHASE_END, 0)
+#else
+#define TRACE_BEGIN(span, arg) ((void) (arg))
+#define TRACE_END(span) ((void) 0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
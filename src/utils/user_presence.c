@@ -0,0 +1,155 @@
+/**
+ * @file user_presence.c
+ * @brief Asynchronous User Presence Implementation
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include "user_presence.h"
+
+#include <string.h>
+
+#include "hal.h"
+#include "led_patterns.h"
+#include "logger.h"
+#include "module_state.h"
+#include "trace.h"
+
+/* Edges closer together than this are contact bounce */
+#define UP_DEBOUNCE_MS 50
+
+/* How often up_wait() services other channels */
+#define UP_POLL_INTERVAL_MS 5
+
+/* User presence state */
+static OPENFIDO_STATE struct {
+    volatile bool pressed;   /* Set from the button interrupt */
+    volatile bool cancelled; /* Set by the transport on CANCEL */
+    volatile uint32_t last_edge_ms;
+    bool waiting;
+    uint64_t deadline_ms;
+    led_pattern_type_t saved_pattern;
+    up_service_fn_t service;
+} up_state = {0};
+OPENFIDO_STATE_REGISTER(up_state);
+
+/**
+ * @brief Button interrupt trampoline
+ */
+static void on_button_press(void)
+{
+    up_notify_button_press();
+}
+
+int up_init(void)
+{
+    memset(&up_state, 0, sizeof(up_state));
+
+    if (hal_button_init() != HAL_OK) {
+        LOG_ERROR("Button initialization failed");
+        return UP_ERROR;
+    }
+
+    hal_button_set_callback(on_button_press);
+    LOG_DEBUG("User presence initialized");
+    return UP_OK;
+}
+
+void up_set_service_hook(up_service_fn_t service)
+{
+    up_state.service = service;
+}
+
+void up_notify_button_press(void)
+{
+    uint32_t now_ms = (uint32_t) hal_get_timestamp_ms();
+
+    /* Any edge this close to the last accepted one is bounce, even after the wait consumed it */
+    if ((now_ms - up_state.last_edge_ms) < UP_DEBOUNCE_MS) {
+        return;
+    }
+
+    up_state.last_edge_ms = now_ms;
+    up_state.pressed = true;
+}
+
+int up_request(uint32_t timeout_ms)
+{
+    if (up_state.waiting) {
+        return UP_ERROR_BUSY;
+    }
+
+    up_state.pressed = false;
+    up_state.cancelled = false;
+    up_state.deadline_ms = hal_get_timestamp_ms() + timeout_ms;
+    up_state.waiting = true;
+
+    up_state.saved_pattern = led_get_current_pattern();
+    led_set_pattern(LED_PATTERN_USER_PRESENCE);
+
+    LOG_INFO("Waiting for user presence (%u ms)...", timeout_ms);
+    return UP_OK;
+}
+
+up_result_t up_poll(void)
+{
+    if (!up_state.waiting) {
+        return UP_RESULT_TIMEOUT;
+    }
+
+    up_result_t result = UP_RESULT_PENDING;
+
+    /* Level check as well, for buttons already held when the wait was posted */
+    if (up_state.pressed || hal_button_get_state() == HAL_BUTTON_PRESSED) {
+        result = UP_RESULT_CONFIRMED;
+    } else if (up_state.cancelled) {
+        result = UP_RESULT_CANCELLED;
+    } else if (hal_get_timestamp_ms() >= up_state.deadline_ms) {
+        result = UP_RESULT_TIMEOUT;
+    }
+
+    if (result != UP_RESULT_PENDING) {
+        up_state.waiting = false;
+        up_state.pressed = false;
+        up_state.cancelled = false;
+        led_set_pattern(up_state.saved_pattern);
+        LOG_INFO("User presence wait finished: %d", result);
+    }
+
+    return result;
+}
+
+up_result_t up_wait(uint32_t timeout_ms)
+{
+    if (up_request(timeout_ms) != UP_OK) {
+        LOG_WARN("User presence wait already pending");
+        return UP_RESULT_CANCELLED;
+    }
+
+    TRACE_BEGIN(TRACE_SPAN_UP_WAIT, 0);
+
+    up_result_t result;
+    while ((result = up_poll()) == UP_RESULT_PENDING) {
+        if (up_state.service != NULL) {
+            up_state.service();
+        }
+        led_patterns_update();
+        hal_delay_ms(UP_POLL_INTERVAL_MS);
+    }
+
+    TRACE_END(TRACE_SPAN_UP_WAIT);
+    return result;
+}
+
+void up_cancel(void)
+{
+    if (up_state.waiting) {
+        up_state.cancelled = true;
+    }
+}
+
+bool up_is_waiting(void)
+{
+    return up_state.waiting;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file user_presence.h
+ * @brief Asynchronous User Presence
+ *
+ * A request posts a user-presence (UP) wait and yields; the button interrupt
+ * completes it. While the wait is pending, the registered service hook keeps
+ * the other channels running (keepalives, PING, CANCEL, GetInfo, BLE link
+ * maintenance), so a pending touch never blocks the rest of the device.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#ifndef USER_PRESENCE_H
+#define USER_PRESENCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* User Presence Return Codes */
+#define UP_OK 0
+#define UP_ERROR -1
+#define UP_ERROR_BUSY -2
+
+/**
+ * @brief Outcome of a user-presence wait
+ */
+typedef enum {
+    UP_RESULT_PENDING = 0, /**< Still waiting for a touch */
+    UP_RESULT_CONFIRMED,   /**< User touched the button */
+    UP_RESULT_TIMEOUT,     /**< No touch before the deadline */
+    UP_RESULT_CANCELLED    /**< Cancelled by the host */
+} up_result_t;
+
+/**
+ * @brief Service hook run while a wait is pending
+ *
+ * Must not block; it is called every few milliseconds.
+ */
+typedef void (*up_service_fn_t)(void);
+
+/**
+ * @brief Initialize the button and hook its press interrupt
+ *
+ * @return UP_OK on success, UP_ERROR if the button could not be set up
+ */
+int up_init(void);
+
+/**
+ * @brief Register the hook that services other channels during a wait
+ *
+ * @param service Service function (NULL to disable)
+ */
+void up_set_service_hook(up_service_fn_t service);
+
+/**
+ * @brief Post a user-presence wait
+ *
+ * Only touches after this call count. Switches the LED to the
+ * USER_PRESENCE pattern until the wait completes.
+ *
+ * @param timeout_ms Time allowed for the touch
+ * @return UP_OK on success, UP_ERROR_BUSY if a wait is already pending
+ */
+int up_request(uint32_t timeout_ms);
+
+/**
+ * @brief Check the pending wait without blocking
+ *
+ * Completes the wait (and restores the LED) once it is resolved.
+ *
+ * @return UP_RESULT_PENDING while waiting, otherwise the final result
+ */
+up_result_t up_poll(void);
+
+/**
+ * @brief Post a wait and yield to the service hook until it resolves
+ *
+ * @param timeout_ms Time allowed for the touch
+ * @return Final result (never UP_RESULT_PENDING)
+ */
+up_result_t up_wait(uint32_t timeout_ms);
+
+/**
+ * @brief Cancel the pending wait (CTAPHID_CANCEL, BLE cancel)
+ */
+void up_cancel(void);
+
+/**
+ * @brief Check whether a wait is pending
+ *
+ * @return true while waiting for a touch
+ */
+bool up_is_waiting(void);
+
+/**
+ * @brief Report a button press (called from the button interrupt)
+ */
+void up_notify_button_press(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USER_PRESENCE_H */
@@ -14,12 +14,26 @@
 
 /* Mock flash storage */
 static uint8_t mock_flash[64 * 1024];
-static bool mock_button_pressed = false;
+static uint8_t mock_fw_slots[HAL_FW_SLOT_COUNT][64 * 1024];
+static uint8_t mock_fw_active = 0;
+static uint8_t mock_fw_boot = 0;
+static uint8_t mock_retention[HAL_RETENTION_SIZE];
+static bool mock_button_pressed = true; /* Held by default so presence checks pass */
 static bool mock_initialized = false;
+static hal_usb_tx_complete_cb_t mock_usb_tx_complete_cb = NULL;
+static hal_button_cb_t mock_button_cb = NULL;
+static hal_led_tick_cb_t mock_led_tick_cb = NULL;
+static hal_led_state_t mock_led_state = HAL_LED_OFF;
+static size_t mock_usb_reports_sent = 0;
+static uint32_t mock_cycle_count = 0;
+static size_t mock_flash_fail_countdown = 0;
 
 int hal_init(void)
 {
     memset(mock_flash, 0xFF, sizeof(mock_flash));
+    memset(mock_fw_slots, 0xFF, sizeof(mock_fw_slots));
+    mock_fw_active = 0;
+    mock_fw_boot = 0;
     mock_initialized = true;
     return HAL_OK;
 }
@@ -37,9 +51,39 @@ int hal_usb_init(void)
 
 int hal_usb_send(const uint8_t *data, size_t len)
 {
+    mock_usb_reports_sent++;
     return len;
 }
 
+int hal_usb_send_burst(const uint8_t *packets, size_t count)
+{
+    if (packets == NULL) {
+        return HAL_ERROR;
+    }
+
+    /* Mock endpoint drains instantly */
+    mock_usb_reports_sent += count;
+    if (mock_usb_tx_complete_cb != NULL) {
+        mock_usb_tx_complete_cb();
+    }
+    return (int) count;
+}
+
+bool hal_usb_tx_pending(void)
+{
+    return false;
+}
+
+void hal_usb_set_tx_complete_callback(hal_usb_tx_complete_cb_t callback)
+{
+    mock_usb_tx_complete_cb = callback;
+}
+
+size_t mock_get_usb_reports_sent(void)
+{
+    return mock_usb_reports_sent;
+}
+
 int hal_usb_receive(uint8_t *data, size_t max_len, uint32_t timeout_ms)
 {
     return 0;
@@ -69,10 +113,19 @@ int hal_flash_write(uint32_t offset, const uint8_t *data, size_t len)
     if (offset + len > sizeof(mock_flash)) {
         return HAL_ERROR;
     }
+    if (mock_flash_fail_countdown > 0 && --mock_flash_fail_countdown == 0) {
+        return HAL_ERROR;
+    }
     memcpy(&mock_flash[offset], data, len);
     return HAL_OK;
 }
 
+/* Make the @p n-th flash write from now fail, once */
+void mock_flash_fail_write(size_t n)
+{
+    mock_flash_fail_countdown = n;
+}
+
 int hal_flash_erase(uint32_t offset)
 {
     if (offset >= sizeof(mock_flash)) {
@@ -87,6 +140,66 @@ size_t hal_flash_get_size(void)
     return sizeof(mock_flash);
 }
 
+int hal_fw_get_slots(hal_fw_slots_t *slots)
+{
+    if (slots == NULL) {
+        return HAL_ERROR;
+    }
+    slots->active = mock_fw_active;
+    slots->boot = mock_fw_boot;
+    slots->slot_size = sizeof(mock_fw_slots[0]);
+    slots->sector_size = 4096;
+    return HAL_OK;
+}
+
+int hal_fw_read(uint8_t slot, uint32_t offset, uint8_t *data, size_t len)
+{
+    if (slot >= HAL_FW_SLOT_COUNT || offset + len > sizeof(mock_fw_slots[0])) {
+        return HAL_ERROR;
+    }
+    memcpy(data, &mock_fw_slots[slot][offset], len);
+    return HAL_OK;
+}
+
+int hal_fw_write(uint8_t slot, uint32_t offset, const uint8_t *data, size_t len)
+{
+    if (slot >= HAL_FW_SLOT_COUNT || slot == mock_fw_active ||
+        offset + len > sizeof(mock_fw_slots[0])) {
+        return HAL_ERROR;
+    }
+    /* NOR semantics: programming can only clear bits */
+    for (size_t i = 0; i < len; i++) {
+        mock_fw_slots[slot][offset + i] &= data[i];
+    }
+    return HAL_OK;
+}
+
+int hal_fw_erase(uint8_t slot, uint32_t offset)
+{
+    if (slot >= HAL_FW_SLOT_COUNT || slot == mock_fw_active || offset % 4096 != 0 ||
+        offset >= sizeof(mock_fw_slots[0])) {
+        return HAL_ERROR;
+    }
+    memset(&mock_fw_slots[slot][offset], 0xFF, 4096);
+    return HAL_OK;
+}
+
+int hal_fw_set_boot_slot(uint8_t slot)
+{
+    if (slot >= HAL_FW_SLOT_COUNT) {
+        return HAL_ERROR;
+    }
+    mock_fw_boot = slot;
+    return HAL_OK;
+}
+
+/* Load an image into the active slot, as if it had been flashed at the factory */
+void mock_fw_load_active(const uint8_t *image, size_t len)
+{
+    memset(mock_fw_slots[mock_fw_active], 0xFF, sizeof(mock_fw_slots[0]));
+    memcpy(mock_fw_slots[mock_fw_active], image, len);
+}
+
 int hal_random_generate(uint8_t *buffer, size_t len)
 {
     for (size_t i = 0; i < len; i++) {
@@ -111,9 +224,19 @@ bool hal_button_wait_press(uint32_t timeout_ms)
     return true;
 }
 
+void hal_button_set_callback(hal_button_cb_t callback)
+{
+    mock_button_cb = callback;
+}
+
 void mock_set_button_pressed(bool pressed)
 {
+    bool edge = pressed && !mock_button_pressed;
+
     mock_button_pressed = pressed;
+    if (edge && mock_button_cb != NULL) {
+        mock_button_cb();
+    }
 }
 
 int hal_led_init(void)
@@ -123,9 +246,28 @@ int hal_led_init(void)
 
 int hal_led_set_state(hal_led_state_t state)
 {
+    mock_led_state = state;
+    return HAL_OK;
+}
+
+int hal_led_set_tick_callback(uint32_t period_ms, hal_led_tick_cb_t callback)
+{
+    mock_led_tick_cb = callback;
     return HAL_OK;
 }
 
+hal_led_state_t mock_get_led_state(void)
+{
+    return mock_led_state;
+}
+
+void mock_run_led_ticks(uint32_t count)
+{
+    for (uint32_t i = 0; i < count && mock_led_tick_cb != NULL; i++) {
+        mock_led_tick_cb();
+    }
+}
+
 bool hal_crypto_is_available(void)
 {
     return false;
@@ -141,11 +283,32 @@ int hal_crypto_ecdsa_sign(const uint8_t *private_key, const uint8_t *hash, uint8
     return HAL_ERROR_NOT_SUPPORTED;
 }
 
+int hal_get_device_secret(uint8_t *secret, size_t *len)
+{
+    return HAL_ERROR_NOT_SUPPORTED;
+}
+
 uint64_t hal_get_timestamp_ms(void)
 {
     return (uint64_t) time(NULL) * 1000;
 }
 
+uint64_t hal_get_timestamp_us(void)
+{
+    return (uint64_t) time(NULL) * 1000000;
+}
+
+/* Advances on every read, so each profiled span has a nonzero, ordered length */
+uint32_t hal_cycle_count(void)
+{
+    return ++mock_cycle_count;
+}
+
+uint32_t hal_cycle_frequency(void)
+{
+    return 1;
+}
+
 void hal_delay_ms(uint32_t ms)
 {
     /* No delay in tests */
@@ -160,3 +323,31 @@ int hal_watchdog_feed(void)
 {
     return HAL_OK;
 }
+
+int hal_retention_write(const uint8_t *data, size_t len)
+{
+    if (data == NULL || len > sizeof(mock_retention)) {
+        return HAL_ERROR;
+    }
+    memcpy(mock_retention, data, len);
+    return HAL_OK;
+}
+
+int hal_retention_read(uint8_t *data, size_t len)
+{
+    if (data == NULL || len > sizeof(mock_retention)) {
+        return HAL_ERROR;
+    }
+    memcpy(data, mock_retention, len);
+    return HAL_OK;
+}
+
+void hal_retention_clear(void)
+{
+    memset(mock_retention, 0, sizeof(mock_retention));
+}
+
+uint32_t hal_core_id(void)
+{
+    return 0;
+}
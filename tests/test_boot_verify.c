@@ -0,0 +1,289 @@
+/**
+ * @file test_boot_verify.c
+ * @brief Unit tests for verified boot with a cached measurement
+ *
+ * Boots repeatedly against the mock HAL's RAM slots and flash, which keep
+ * their contents between boot_verify_init() calls, and checks when the
+ * image is re-hashed, that a tampered block is caught on the cached path
+ * and that the measurement is not trusted once the slot was rewritten.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "boot_verify.h"
+#include "crypto.h"
+#include "hal.h"
+#include "idle_scheduler.h"
+#include "p256.h"
+#include "sha256.h"
+#include "storage.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+/* Ten measurement blocks, the last one partial */
+#define IMAGE_SIZE 40000
+#define IMAGE_BLOCKS 10
+
+/* Provided by mock_hal.c */
+void mock_fw_load_active(const uint8_t *image, size_t len);
+
+static uint8_t signing_private[P256_SCALAR_SIZE];
+static uint8_t signing_public[P256_POINT_SIZE];
+
+static uint8_t image[IMAGE_SIZE];
+
+/* Deterministic byte stream for images and keys */
+static uint32_t test_rng_state = 0x87654321;
+
+static int test_random(uint8_t *buffer, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        test_rng_state = test_rng_state * 1103515245 + 12345;
+        buffer[i] = (uint8_t) (test_rng_state >> 16);
+    }
+    return 0;
+}
+
+/* Sign the image the way the updater does: version first, then the image */
+static void sign_image(uint32_t version, uint8_t *digest, uint8_t *signature)
+{
+    uint8_t prefix[4] = {(uint8_t) version, (uint8_t) (version >> 8), (uint8_t) (version >> 16),
+                         (uint8_t) (version >> 24)};
+    sha256_ctx_t ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, prefix, sizeof(prefix));
+    sha256_update(&ctx, image, sizeof(image));
+    sha256_final(&ctx, digest);
+    p256_ecdsa_sign(signing_private, digest, test_random, signature);
+}
+
+static int commit_image(uint32_t version)
+{
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t signature[P256_SIGNATURE_SIZE];
+
+    sign_image(version, digest, signature);
+    return boot_verify_image_commit(0, IMAGE_SIZE, version, digest, signature);
+}
+
+/* Fresh device with a signed image in slot 0 */
+static int provision(void)
+{
+    hal_init();
+    if (storage_init() != STORAGE_OK) {
+        return -1;
+    }
+
+    test_random(image, sizeof(image));
+    mock_fw_load_active(image, sizeof(image));
+
+    return commit_image(1);
+}
+
+static int test_boot_verify_cached(void)
+{
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+
+    /* First boot re-hashes and checks everything */
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    TEST_ASSERT(!boot_verify_cached());
+    TEST_ASSERT(boot_verify_pending_blocks() == 0);
+
+    /* Second boot only authenticates the measurement */
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_cached());
+    TEST_ASSERT(boot_verify_pending_blocks() == IMAGE_BLOCKS);
+
+    /* A range spanning two blocks checks both, once */
+    TEST_ASSERT(boot_verify_range(4000, 200) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_pending_blocks() == IMAGE_BLOCKS - 2);
+    TEST_ASSERT(boot_verify_range(4096, 1) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_pending_blocks() == IMAGE_BLOCKS - 2);
+
+    /* Idle time checks the rest */
+    while (idle_sched_has_pending()) {
+        idle_sched_run(1000);
+    }
+    TEST_ASSERT(boot_verify_pending_blocks() == 0);
+
+    TEST_ASSERT(boot_verify_range(0, IMAGE_SIZE) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_range(IMAGE_SIZE - 1, 2) == BOOT_VERIFY_ERROR_INVALID_PARAM);
+
+    TEST_PASS();
+}
+
+static int test_boot_verify_tampered_block(void)
+{
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+
+    image[5 * 4096 + 17] ^= 0x01;
+    mock_fw_load_active(image, sizeof(image));
+
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_cached());
+    TEST_ASSERT(boot_verify_range(0, 4096) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_range(5 * 4096, 1) == BOOT_VERIFY_ERROR_INTEGRITY);
+
+    /* Once a block failed nothing is trusted */
+    TEST_ASSERT(boot_verify_range(0, 4096) == BOOT_VERIFY_ERROR_INTEGRITY);
+
+    /* And the next boot re-hashes, against the signature */
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_ERROR_INTEGRITY);
+    TEST_ASSERT(!boot_verify_cached());
+
+    TEST_PASS();
+}
+
+static int test_boot_verify_idle_detects_tampering(void)
+{
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+
+    image[IMAGE_SIZE - 1] ^= 0x80;
+    mock_fw_load_active(image, sizeof(image));
+
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    while (idle_sched_has_pending()) {
+        idle_sched_run(1000);
+    }
+    TEST_ASSERT(boot_verify_range(0, 1) == BOOT_VERIFY_ERROR_INTEGRITY);
+
+    TEST_PASS();
+}
+
+static int test_boot_verify_rewritten_slot(void)
+{
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+
+    /* An update touching the slot drops its descriptor */
+    TEST_ASSERT(boot_verify_image_begin(0) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_ERROR_NOT_PROVISIONED);
+
+    /* Re-committing the same image still forces a re-hash */
+    TEST_ASSERT(commit_image(1) == BOOT_VERIFY_OK);
+
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    TEST_ASSERT(!boot_verify_cached());
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_cached());
+
+    TEST_PASS();
+}
+
+static int test_boot_verify_version(void)
+{
+    uint32_t version = 0;
+
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_image_version(0, &version) == BOOT_VERIFY_OK);
+    TEST_ASSERT(version == 1);
+    TEST_ASSERT(boot_verify_image_version(1, &version) == BOOT_VERIFY_ERROR_NOT_PROVISIONED);
+
+    TEST_ASSERT(commit_image(3) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+
+    /* The version is under the signature: claiming a newer one breaks it */
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t signature[P256_SIGNATURE_SIZE];
+    sign_image(3, digest, signature);
+    TEST_ASSERT(boot_verify_image_begin(0) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_image_commit(0, IMAGE_SIZE, 4, digest, signature) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_ERROR_INTEGRITY);
+
+    TEST_PASS();
+}
+
+static int test_boot_verify_scrub(void)
+{
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+
+    for (int i = 0; i < BOOT_VERIFY_SCRUB_BOOTS; i++) {
+        TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+        TEST_ASSERT(boot_verify_cached());
+    }
+
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    TEST_ASSERT(!boot_verify_cached());
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_cached());
+
+    TEST_PASS();
+}
+
+static int test_boot_verify_bad_signature(void)
+{
+    uint8_t other_private[P256_SCALAR_SIZE];
+    uint8_t other_public[P256_POINT_SIZE];
+
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+    TEST_ASSERT(p256_generate_keypair(test_random, other_private, other_public) == P256_OK);
+
+    TEST_ASSERT(boot_verify_init(other_public) == BOOT_VERIFY_ERROR_INTEGRITY);
+    TEST_ASSERT(boot_verify_range(0, 1) == BOOT_VERIFY_ERROR_INTEGRITY);
+
+    /* Nothing was cached for the next boot either */
+    TEST_ASSERT(boot_verify_init(other_public) == BOOT_VERIFY_ERROR_INTEGRITY);
+
+    TEST_PASS();
+}
+
+static int test_boot_verify_not_provisioned(void)
+{
+    TEST_ASSERT(provision() == BOOT_VERIFY_OK);
+    TEST_ASSERT(boot_verify_init(NULL) == BOOT_VERIFY_ERROR_NOT_PROVISIONED);
+
+    hal_init();
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    mock_fw_load_active(image, sizeof(image));
+    TEST_ASSERT(boot_verify_init(signing_public) == BOOT_VERIFY_ERROR_NOT_PROVISIONED);
+
+    TEST_PASS();
+}
+
+int main(void)
+{
+    int result = 0;
+
+    printf("Running verified boot tests...\n");
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(p256_generate_keypair(test_random, signing_private, signing_public) == P256_OK);
+
+    result |= test_boot_verify_cached();
+    result |= test_boot_verify_tampered_block();
+    result |= test_boot_verify_idle_detects_tampering();
+    result |= test_boot_verify_rewritten_slot();
+    result |= test_boot_verify_version();
+    result |= test_boot_verify_scrub();
+    result |= test_boot_verify_bad_signature();
+    result |= test_boot_verify_not_provisioned();
+
+    if (result == 0) {
+        printf("\nAll verified boot tests passed!\n");
+    } else {
+        printf("\nSome verified boot tests failed!\n");
+    }
+
+    return result;
+}
@@ -124,6 +124,32 @@ int test_cbor_decode_bytes(void)
     TEST_PASS();
 }
 
+/* Test decoding text strings longer than the buffer */
+int test_cbor_decode_text_truncated(void)
+{
+    /* "abc\u00e9", then 7 */
+    uint8_t buffer[] = {0x65, 'a', 'b', 'c', 0xC3, 0xA9, 0x07};
+    cbor_decoder_t decoder;
+    char text[8];
+    size_t len = sizeof(text);
+    uint64_t value;
+
+    cbor_decoder_init(&decoder, buffer, sizeof(buffer));
+    TEST_ASSERT(cbor_decode_text_truncated(&decoder, text, &len) == CBOR_OK);
+    TEST_ASSERT(len == 5 && memcmp(text, "abc\xC3\xA9", 6) == 0);
+
+    /* Cutting inside the two-byte character drops all of it */
+    cbor_decoder_init(&decoder, buffer, sizeof(buffer));
+    len = 5;
+    TEST_ASSERT(cbor_decode_text_truncated(&decoder, text, &len) == CBOR_OK);
+    TEST_ASSERT(len == 3 && strcmp(text, "abc") == 0);
+
+    /* The rest of the string is skipped */
+    TEST_ASSERT(cbor_decode_uint(&decoder, &value) == CBOR_OK && value == 7);
+
+    TEST_PASS();
+}
+
 /* Test decoding maps */
 int test_cbor_decode_map(void)
 {
@@ -214,6 +240,7 @@ int run_cbor_tests(void)
     failures += test_cbor_encode_map();
     failures += test_cbor_decode_uint();
     failures += test_cbor_decode_bytes();
+    failures += test_cbor_decode_text_truncated();
     failures += test_cbor_decode_map();
     failures += test_cbor_roundtrip();
 
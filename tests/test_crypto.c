@@ -41,6 +41,15 @@ int test_crypto_sha256(void)
     TEST_ASSERT(crypto_sha256(data, 4, hash) == CRYPTO_OK);
     TEST_ASSERT(memcmp(hash, expected, 32) == 0);
 
+    /* Same digest when fed in pieces */
+    crypto_sha256_ctx_t ctx;
+    memset(hash, 0, sizeof(hash));
+    TEST_ASSERT(crypto_sha256_start(&ctx) == CRYPTO_OK);
+    TEST_ASSERT(crypto_sha256_update(&ctx, data, 1) == CRYPTO_OK);
+    TEST_ASSERT(crypto_sha256_update(&ctx, &data[1], 3) == CRYPTO_OK);
+    TEST_ASSERT(crypto_sha256_finish(&ctx, hash) == CRYPTO_OK);
+    TEST_ASSERT(memcmp(hash, expected, 32) == 0);
+
     TEST_PASS();
 }
 
@@ -86,6 +95,32 @@ int test_crypto_ecdsa_sign_verify(void)
     TEST_PASS();
 }
 
+/* Test signing with a loaded ECDSA key */
+int test_crypto_ecdsa_key(void)
+{
+    uint8_t private_key[32];
+    uint8_t public_key[64];
+    uint8_t hash[32] = {0x04, 0x05, 0x06}; /* Dummy hash */
+    uint8_t signature[64];
+    crypto_ecdsa_key_t key;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(crypto_ecdsa_generate_keypair(private_key, public_key) == CRYPTO_OK);
+    TEST_ASSERT(crypto_ecdsa_key_init(&key, private_key) == CRYPTO_OK);
+
+    /* Repeated signatures reuse the loaded key */
+    for (int i = 0; i < 2; i++) {
+        hash[31] = (uint8_t) i;
+        TEST_ASSERT(crypto_ecdsa_key_sign(&key, hash, signature) == CRYPTO_OK);
+        TEST_ASSERT(crypto_ecdsa_verify(public_key, hash, signature) == CRYPTO_OK);
+    }
+
+    crypto_ecdsa_key_free(&key);
+    TEST_ASSERT(crypto_ecdsa_key_sign(&key, hash, signature) == CRYPTO_ERROR_INVALID_PARAM);
+
+    TEST_PASS();
+}
+
 /* Test AES-GCM encryption/decryption */
 int test_crypto_aes_gcm(void)
 {
@@ -112,6 +147,75 @@ int test_crypto_aes_gcm(void)
     TEST_PASS();
 }
 
+/* Test cached-key AES-256-GCM matches the one-shot version */
+int test_crypto_aes_gcm_ctx(void)
+{
+    uint8_t key[32] = {0x01};
+    uint8_t iv[12] = {0x02};
+    uint8_t aad[] = "header";
+    uint8_t plaintext[] = "Hello, FIDO2!";
+    uint8_t expected[sizeof(plaintext)];
+    uint8_t expected_tag[16];
+    uint8_t ciphertext[sizeof(plaintext)];
+    uint8_t decrypted[sizeof(plaintext)];
+    uint8_t tag[16];
+    crypto_aes_gcm_ctx_t ctx;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(crypto_aes_gcm_encrypt(key, iv, aad, sizeof(aad), plaintext, sizeof(plaintext),
+                                       expected, expected_tag) == CRYPTO_OK);
+    TEST_ASSERT(crypto_aes_gcm_ctx_init(&ctx, key) == CRYPTO_OK);
+
+    /* The expanded key schedule is reusable */
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(crypto_aes_gcm_ctx_encrypt(&ctx, iv, aad, sizeof(aad), plaintext,
+                                               sizeof(plaintext), ciphertext, tag) == CRYPTO_OK);
+        TEST_ASSERT(memcmp(ciphertext, expected, sizeof(expected)) == 0);
+        TEST_ASSERT(memcmp(tag, expected_tag, sizeof(tag)) == 0);
+        TEST_ASSERT(crypto_aes_gcm_ctx_decrypt(&ctx, iv, aad, sizeof(aad), ciphertext,
+                                               sizeof(ciphertext), tag, decrypted) == CRYPTO_OK);
+        TEST_ASSERT(memcmp(decrypted, plaintext, sizeof(plaintext)) == 0);
+    }
+
+    /* A modified AAD fails authentication */
+    aad[0] ^= 1;
+    TEST_ASSERT(crypto_aes_gcm_ctx_decrypt(&ctx, iv, aad, sizeof(aad), ciphertext,
+                                           sizeof(ciphertext), tag, decrypted) != CRYPTO_OK);
+
+    crypto_aes_gcm_ctx_free(&ctx);
+    TEST_ASSERT(crypto_aes_gcm_ctx_encrypt(&ctx, iv, aad, sizeof(aad), plaintext,
+                                           sizeof(plaintext), ciphertext,
+                                           tag) == CRYPTO_ERROR_INVALID_PARAM);
+
+    TEST_PASS();
+}
+
+/* Test AES-256-CBC round trip */
+int test_crypto_aes_cbc(void)
+{
+    uint8_t key[32] = {0};
+    uint8_t iv[16] = {0};
+    uint8_t plaintext[32] = "PIN protocol block test";
+    uint8_t ciphertext[32];
+    uint8_t decrypted[32];
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+
+    TEST_ASSERT(crypto_aes_cbc_encrypt(key, iv, plaintext, sizeof(plaintext), ciphertext) ==
+                CRYPTO_OK);
+    TEST_ASSERT(memcmp(plaintext, ciphertext, sizeof(plaintext)) != 0);
+
+    TEST_ASSERT(crypto_aes_cbc_decrypt(key, iv, ciphertext, sizeof(ciphertext), decrypted) ==
+                CRYPTO_OK);
+    TEST_ASSERT(memcmp(plaintext, decrypted, sizeof(plaintext)) == 0);
+
+    /* No padding: partial blocks are rejected */
+    TEST_ASSERT(crypto_aes_cbc_encrypt(key, iv, plaintext, 20, ciphertext) ==
+                CRYPTO_ERROR_INVALID_PARAM);
+
+    TEST_PASS();
+}
+
 /* Test random generation */
 int test_crypto_random(void)
 {
@@ -149,6 +253,82 @@ int test_crypto_hmac(void)
     }
     TEST_ASSERT(all_zero == 0);
 
+    /* RFC 4231 test case 2 */
+    uint8_t jefe[] = "Jefe";
+    uint8_t what[] = "what do ya want for nothing?";
+    uint8_t expected[32] = {0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24,
+                            0x26, 0x08, 0x95, 0x75, 0xc7, 0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27,
+                            0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43};
+    TEST_ASSERT(crypto_hmac_sha256(jefe, sizeof(jefe) - 1, what, sizeof(what) - 1, hmac) ==
+                CRYPTO_OK);
+    TEST_ASSERT(memcmp(hmac, expected, sizeof(expected)) == 0);
+
+    TEST_PASS();
+}
+
+/* Test cached-key HMAC-SHA256 matches the one-shot version */
+int test_crypto_hmac_ctx(void)
+{
+    uint8_t key[] = "secret";
+    uint8_t data[] = "message";
+    uint8_t expected[32];
+    uint8_t hmac[32];
+    crypto_hmac_ctx_t ctx;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(crypto_hmac_sha256(key, sizeof(key) - 1, data, sizeof(data) - 1, expected) ==
+                CRYPTO_OK);
+    TEST_ASSERT(crypto_hmac_ctx_init(&ctx, key, sizeof(key) - 1) == CRYPTO_OK);
+
+    /* The cached key schedule is reusable */
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(crypto_hmac_ctx_compute(&ctx, data, sizeof(data) - 1, hmac) == CRYPTO_OK);
+        TEST_ASSERT(memcmp(hmac, expected, sizeof(hmac)) == 0);
+    }
+
+    crypto_hmac_ctx_free(&ctx);
+    TEST_ASSERT(crypto_hmac_ctx_compute(&ctx, data, sizeof(data) - 1, hmac) ==
+                CRYPTO_ERROR_INVALID_PARAM);
+
+    TEST_PASS();
+}
+
+/* Test HKDF-SHA256 against RFC 5869 */
+int test_crypto_hkdf(void)
+{
+    uint8_t ikm[22];
+    uint8_t salt[13];
+    uint8_t info[10];
+    uint8_t okm[42];
+
+    /* Test case 1 */
+    uint8_t expected[42] = {0x3c, 0xb2, 0x5f, 0x25, 0xfa, 0xac, 0xd5, 0x7a, 0x90, 0x43, 0x4f,
+                            0x64, 0xd0, 0x36, 0x2f, 0x2a, 0x2d, 0x2d, 0x0a, 0x90, 0xcf, 0x1a,
+                            0x5a, 0x4c, 0x5d, 0xb0, 0x2d, 0x56, 0xec, 0xc4, 0xc5, 0xbf, 0x34,
+                            0x00, 0x72, 0x08, 0xd5, 0xb8, 0x87, 0x18, 0x58, 0x65};
+    /* Test case 3: no salt, no info */
+    uint8_t expected_bare[42] = {0x8d, 0xa4, 0xe7, 0x75, 0xa5, 0x63, 0xc1, 0x8f, 0x71, 0x5f, 0x80,
+                                 0x2a, 0x06, 0x3c, 0x5a, 0x31, 0xb8, 0xa1, 0x1f, 0x5c, 0x5e, 0xe1,
+                                 0x87, 0x9e, 0xc3, 0x45, 0x4e, 0x5f, 0x3c, 0x73, 0x8d, 0x2d, 0x9d,
+                                 0x20, 0x13, 0x95, 0xfa, 0xa4, 0xb6, 0x1a, 0x96, 0xc8};
+
+    memset(ikm, 0x0b, sizeof(ikm));
+    for (size_t i = 0; i < sizeof(salt); i++) {
+        salt[i] = (uint8_t) i;
+    }
+    for (size_t i = 0; i < sizeof(info); i++) {
+        info[i] = (uint8_t) (0xf0 + i);
+    }
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(crypto_hkdf_sha256(salt, sizeof(salt), ikm, sizeof(ikm), info, sizeof(info), okm,
+                                   sizeof(okm)) == CRYPTO_OK);
+    TEST_ASSERT(memcmp(okm, expected, sizeof(expected)) == 0);
+
+    TEST_ASSERT(crypto_hkdf_sha256(NULL, 0, ikm, sizeof(ikm), NULL, 0, okm, sizeof(okm)) ==
+                CRYPTO_OK);
+    TEST_ASSERT(memcmp(okm, expected_bare, sizeof(expected_bare)) == 0);
+
     TEST_PASS();
 }
 
@@ -162,9 +342,14 @@ int run_crypto_tests(void)
     failures += test_crypto_sha256();
     failures += test_crypto_ecdsa_keygen();
     failures += test_crypto_ecdsa_sign_verify();
+    failures += test_crypto_ecdsa_key();
     failures += test_crypto_aes_gcm();
+    failures += test_crypto_aes_gcm_ctx();
+    failures += test_crypto_aes_cbc();
     failures += test_crypto_random();
     failures += test_crypto_hmac();
+    failures += test_crypto_hmac_ctx();
+    failures += test_crypto_hkdf();
 
     printf("=== Crypto Tests: %d failures ===\n\n", failures);
     return failures;
@@ -11,9 +11,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "boot_verify.h"
 #include "cbor.h"
 #include "crypto.h"
 #include "ctap2.h"
+#include "ctap2_hmac_secret.h"
+#include "firmware_update.h"
+#include "hal.h"
+#include "p256.h"
+#include "permissions.h"
+#include "pin_protocol.h"
+#include "sha256.h"
 #include "storage.h"
 
 #define TEST_ASSERT(condition)                                            \
@@ -37,7 +45,7 @@ static int cbor_array_contains(const uint8_t *data, size_t len, const char *str)
     /* In a real test we should parse CBOR, but for now this is a quick check */
     /* Note: CBOR text string is encoded as: 0x60+len(0-23) or 0x78+len(1byte) followed by bytes */
     /* We'll just search for the substring which is good enough for unique extension IDs */
-    for (size_t i = 0; i < len - strlen(str); i++) {
+    for (size_t i = 0; i + strlen(str) <= len; i++) {
         if (memcmp(&data[i], str, strlen(str)) == 0) {
             return 1;
         }
@@ -56,6 +64,11 @@ int test_getinfo_extensions(void)
     /* Check for extension strings */
     TEST_ASSERT(cbor_array_contains(response, response_len, "hmac-secret"));
     TEST_ASSERT(cbor_array_contains(response, response_len, "credProtect"));
+    TEST_ASSERT(cbor_array_contains(response, response_len, "credBlob"));
+
+    /* Attestation formats: "none" lets the platform skip the attestation signature */
+    TEST_ASSERT(cbor_array_contains(response, response_len, "packed"));
+    TEST_ASSERT(cbor_array_contains(response, response_len, "none"));
 
     /* Check for EdDSA algorithm (alg: -8) */
     /* In CBOR, -8 is encoded as 0x27 (negative integer -1 - 7) */
@@ -105,6 +118,1098 @@ int test_make_credential_ed25519(void)
     TEST_PASS();
 }
 
+/* Encode an hmac-secret input map, optionally without saltAuth */
+static size_t encode_hmac_secret_input(uint8_t *buffer, size_t size, bool with_salt_auth)
+{
+    uint8_t coordinate[32];
+    uint8_t salt_enc[32];
+    uint8_t salt_auth[16];
+    cbor_encoder_t encoder;
+
+    memset(coordinate, 0x11, sizeof(coordinate));
+    memset(salt_enc, 0x22, sizeof(salt_enc));
+    memset(salt_auth, 0x33, sizeof(salt_auth));
+
+    cbor_encoder_init(&encoder, buffer, size);
+    cbor_encode_map_start(&encoder, with_salt_auth ? 3 : 2);
+    cbor_encode_uint(&encoder, 1); /* keyAgreement */
+    cbor_encode_map_start(&encoder, 4);
+    cbor_encode_int(&encoder, 1); /* kty: EC2 */
+    cbor_encode_int(&encoder, 2);
+    cbor_encode_int(&encoder, -1); /* crv: P-256 */
+    cbor_encode_int(&encoder, 1);
+    cbor_encode_int(&encoder, -2); /* x */
+    cbor_encode_bytes(&encoder, coordinate, sizeof(coordinate));
+    cbor_encode_int(&encoder, -3); /* y */
+    cbor_encode_bytes(&encoder, coordinate, sizeof(coordinate));
+    cbor_encode_uint(&encoder, 2); /* saltEnc */
+    cbor_encode_bytes(&encoder, salt_enc, sizeof(salt_enc));
+    if (with_salt_auth) {
+        cbor_encode_uint(&encoder, 3); /* saltAuth */
+        cbor_encode_bytes(&encoder, salt_auth, sizeof(salt_auth));
+    }
+
+    return cbor_encoder_get_size(&encoder);
+}
+
+int test_hmac_secret_decode_input(void)
+{
+    uint8_t buffer[256];
+    size_t len;
+    cbor_decoder_t decoder;
+    hmac_secret_input_t input;
+
+    len = encode_hmac_secret_input(buffer, sizeof(buffer), true);
+    cbor_decoder_init(&decoder, buffer, len);
+    TEST_ASSERT(hmac_secret_decode_input(&decoder, &input) == CTAP2_OK);
+    TEST_ASSERT(input.pin_protocol == 1);
+    TEST_ASSERT(input.salt_enc_len == 32);
+    TEST_ASSERT(input.salt_auth_len == 16);
+    TEST_ASSERT(input.key_agreement[0] == 0x11 && input.key_agreement[63] == 0x11);
+
+    len = encode_hmac_secret_input(buffer, sizeof(buffer), false);
+    cbor_decoder_init(&decoder, buffer, len);
+    TEST_ASSERT(hmac_secret_decode_input(&decoder, &input) == CTAP2_ERR_MISSING_PARAMETER);
+
+    TEST_PASS();
+}
+
+/* Encode a largeBlobs get request */
+static size_t encode_large_blob_get(uint8_t *buffer, size_t size, size_t offset, size_t length)
+{
+    cbor_encoder_t encoder;
+
+    cbor_encoder_init(&encoder, buffer, size);
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_uint(&encoder, 1); /* get */
+    cbor_encode_uint(&encoder, length);
+    cbor_encode_uint(&encoder, 3); /* offset */
+    cbor_encode_uint(&encoder, offset);
+
+    return cbor_encoder_get_size(&encoder);
+}
+
+int test_large_blobs_get(void)
+{
+    static const uint8_t empty_array_prefix[] = {0xA1, 0x01, 0x51, 0x80, 0x76, 0xBE};
+    uint8_t blob[STORAGE_LARGE_BLOB_MAX_SIZE];
+    uint8_t request[32];
+    uint8_t response[1024];
+    size_t request_len;
+    size_t response_len = 0;
+    cbor_decoder_t decoder;
+    size_t map_size;
+    uint64_t key;
+    uint8_t fragment[64];
+    size_t fragment_len;
+
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+
+    /* Nothing stored yet: the initial empty array is served */
+    request_len = encode_large_blob_get(request, sizeof(request), 0, 64);
+    TEST_ASSERT(ctap2_large_blobs(request, request_len, response, &response_len) == CTAP2_OK);
+    TEST_ASSERT(response_len == 3 + 17);
+    TEST_ASSERT(memcmp(response, empty_array_prefix, sizeof(empty_array_prefix)) == 0);
+
+    /* A committed array spanning several flash writes reads back from any offset */
+    for (size_t i = 0; i < sizeof(blob); i++) {
+        blob[i] = (uint8_t) (i * 7);
+    }
+    TEST_ASSERT(storage_large_blob_begin(sizeof(blob)) == STORAGE_OK);
+    TEST_ASSERT(storage_large_blob_write(0, blob, 4000) == STORAGE_OK);
+    TEST_ASSERT(storage_large_blob_write(4000, &blob[4000], sizeof(blob) - 4000) == STORAGE_OK);
+    TEST_ASSERT(storage_large_blob_size() == 0);
+    TEST_ASSERT(storage_large_blob_commit() == STORAGE_OK);
+    TEST_ASSERT(storage_large_blob_size() == sizeof(blob));
+
+    request_len = encode_large_blob_get(request, sizeof(request), 5000, sizeof(fragment));
+    TEST_ASSERT(ctap2_large_blobs(request, request_len, response, &response_len) == CTAP2_OK);
+    cbor_decoder_init(&decoder, response, response_len);
+    TEST_ASSERT(cbor_decode_map_start(&decoder, &map_size) == CBOR_OK && map_size == 1);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 1);
+    fragment_len = sizeof(fragment);
+    TEST_ASSERT(cbor_decode_bytes(&decoder, fragment, &fragment_len) == CBOR_OK);
+    TEST_ASSERT(fragment_len == sizeof(fragment));
+    TEST_ASSERT(memcmp(fragment, &blob[5000], sizeof(fragment)) == 0);
+
+    /* Reading past the end is rejected */
+    request_len = encode_large_blob_get(request, sizeof(request), sizeof(blob) + 1, 1);
+    TEST_ASSERT(ctap2_large_blobs(request, request_len, response, &response_len) ==
+                CTAP2_ERR_INVALID_PARAMETER);
+
+    TEST_PASS();
+}
+
+/* Platform side of PIN protocol 2, shared by the token-based tests */
+static pin_protocol_secret_t platform_secret;
+static uint8_t platform_public[64];
+
+static uint8_t send_command(uint8_t cmd, uint8_t *request, size_t request_len,
+                            uint8_t *response, size_t *response_len)
+{
+    ctap2_request_t req = {.cmd = cmd, .data = request, .data_len = request_len};
+    ctap2_response_t resp = {.status = 0, .data = response, .data_len = 0};
+
+    uint8_t status = ctap2_process_request(&req, &resp);
+    *response_len = resp.data_len;
+    return status;
+}
+
+static void encode_platform_key(cbor_encoder_t *encoder)
+{
+    cbor_encode_map_start(encoder, 5);
+    cbor_encode_uint(encoder, 1); /* kty: EC2 */
+    cbor_encode_uint(encoder, 2);
+    cbor_encode_uint(encoder, 3); /* alg: ECDH-ES+HKDF-256 */
+    cbor_encode_int(encoder, -25);
+    cbor_encode_int(encoder, -1); /* crv: P-256 */
+    cbor_encode_uint(encoder, 1);
+    cbor_encode_int(encoder, -2);
+    cbor_encode_bytes(encoder, platform_public, 32);
+    cbor_encode_int(encoder, -3);
+    cbor_encode_bytes(encoder, &platform_public[32], 32);
+}
+
+/* getKeyAgreement, then derive the shared secret the way a platform does */
+static int platform_key_agreement(void)
+{
+    uint8_t request[16];
+    uint8_t response[256];
+    size_t response_len = 0;
+    uint8_t authenticator_public[64];
+    uint8_t platform_private[32];
+    const pin_protocol_secret_t *secret;
+    cbor_encoder_t encoder;
+    cbor_decoder_t decoder;
+    size_t map_size;
+    uint64_t key;
+
+    cbor_encoder_init(&encoder, request, sizeof(request));
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_uint(&encoder, 1); /* pinUvAuthProtocol */
+    cbor_encode_uint(&encoder, PIN_PROTOCOL_V2);
+    cbor_encode_uint(&encoder, 2); /* subCommand: getKeyAgreement */
+    cbor_encode_uint(&encoder, 0x02);
+    if (send_command(CTAP2_CMD_CLIENT_PIN, request, cbor_encoder_get_size(&encoder), response,
+                     &response_len) != CTAP2_OK) {
+        return -1;
+    }
+
+    cbor_decoder_init(&decoder, response, response_len);
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK || map_size != 1 ||
+        cbor_decode_uint(&decoder, &key) != CBOR_OK || key != 1 ||
+        pin_protocol_decode_key(&decoder, authenticator_public) != PIN_PROTOCOL_OK) {
+        return -1;
+    }
+
+    /* ECDH is symmetric: the platform derives the same keys from its own half */
+    if (crypto_ecdsa_generate_keypair(platform_private, platform_public) != CRYPTO_OK ||
+        pin_protocol_decapsulate(PIN_PROTOCOL_V2, platform_private, authenticator_public,
+                                 &secret) != PIN_PROTOCOL_OK) {
+        return -1;
+    }
+    platform_secret = *secret;
+    pin_protocol_clear();
+    return 0;
+}
+
+/* getPinUvAuthTokenUsingPinWithPermissions */
+static uint8_t platform_get_token(const char *pin, uint8_t permissions, uint8_t *token)
+{
+    uint8_t pin_hash[32];
+    uint8_t pin_hash_enc[16 + PIN_PROTOCOL_V2_IV_SIZE];
+    size_t pin_hash_enc_len = 0;
+    uint8_t request[256];
+    uint8_t response[256];
+    size_t response_len = 0;
+    uint8_t token_enc[PERM_TOKEN_SIZE + PIN_PROTOCOL_V2_IV_SIZE];
+    size_t token_enc_len = sizeof(token_enc);
+    size_t token_len = 0;
+    cbor_encoder_t encoder;
+    cbor_decoder_t decoder;
+    size_t map_size;
+    uint64_t key;
+
+    if (platform_key_agreement() != 0 ||
+        crypto_sha256((const uint8_t *) pin, strlen(pin), pin_hash) != CRYPTO_OK ||
+        pin_protocol_encrypt(&platform_secret, pin_hash, 16, pin_hash_enc, &pin_hash_enc_len) !=
+            PIN_PROTOCOL_OK) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    cbor_encoder_init(&encoder, request, sizeof(request));
+    cbor_encode_map_start(&encoder, 5);
+    cbor_encode_uint(&encoder, 1); /* pinUvAuthProtocol */
+    cbor_encode_uint(&encoder, PIN_PROTOCOL_V2);
+    cbor_encode_uint(&encoder, 2); /* subCommand */
+    cbor_encode_uint(&encoder, 0x09);
+    cbor_encode_uint(&encoder, 3); /* keyAgreement */
+    encode_platform_key(&encoder);
+    cbor_encode_uint(&encoder, 6); /* pinHashEnc */
+    cbor_encode_bytes(&encoder, pin_hash_enc, pin_hash_enc_len);
+    cbor_encode_uint(&encoder, 9); /* permissions */
+    cbor_encode_uint(&encoder, permissions);
+
+    uint8_t status = send_command(CTAP2_CMD_CLIENT_PIN, request, cbor_encoder_get_size(&encoder),
+                                  response, &response_len);
+    if (status != CTAP2_OK) {
+        return status;
+    }
+
+    cbor_decoder_init(&decoder, response, response_len);
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK || map_size != 1 ||
+        cbor_decode_uint(&decoder, &key) != CBOR_OK || key != 2 ||
+        cbor_decode_bytes(&decoder, token_enc, &token_enc_len) != CBOR_OK ||
+        pin_protocol_decrypt(&platform_secret, token_enc, token_enc_len, token, &token_len) !=
+            PIN_PROTOCOL_OK ||
+        token_len != PERM_TOKEN_SIZE) {
+        return CTAP2_ERR_PROCESSING;
+    }
+
+    return CTAP2_OK;
+}
+
+/* authenticatorCredentialManagement getCredsMetadata, authorized with a token */
+static uint8_t cm_get_metadata(const uint8_t *token, uint8_t *response, size_t *response_len)
+{
+    static const uint8_t subcommand = 0x01;
+    uint8_t pin_auth[32];
+    uint8_t request[64];
+    cbor_encoder_t encoder;
+
+    crypto_hmac_sha256(token, PERM_TOKEN_SIZE, &subcommand, 1, pin_auth);
+
+    cbor_encoder_init(&encoder, request, sizeof(request));
+    cbor_encode_map_start(&encoder, 3);
+    cbor_encode_uint(&encoder, 1); /* subCommand */
+    cbor_encode_uint(&encoder, subcommand);
+    cbor_encode_uint(&encoder, 3); /* pinUvAuthProtocol */
+    cbor_encode_uint(&encoder, PIN_PROTOCOL_V2);
+    cbor_encode_uint(&encoder, 4); /* pinUvAuthParam */
+    cbor_encode_bytes(&encoder, pin_auth, sizeof(pin_auth));
+
+    return send_command(CTAP2_CMD_CREDENTIAL_MANAGEMENT, request,
+                        cbor_encoder_get_size(&encoder), response, response_len);
+}
+
+/* authenticatorLargeBlobs set, in one fragment, authorized with a token */
+static uint8_t lb_set_array(const uint8_t *token, const uint8_t *array, size_t array_len)
+{
+    uint8_t message[32 + 2 + 4 + 32];
+    uint8_t pin_auth[32];
+    uint8_t request[256];
+    uint8_t response[64];
+    size_t response_len = 0;
+    cbor_encoder_t encoder;
+
+    memset(message, 0xFF, 32);
+    message[32] = 0x0C;
+    message[33] = 0x00;
+    memset(&message[34], 0, 4); /* offset 0 */
+    crypto_sha256(array, array_len, &message[38]);
+    crypto_hmac_sha256(token, PERM_TOKEN_SIZE, message, sizeof(message), pin_auth);
+
+    cbor_encoder_init(&encoder, request, sizeof(request));
+    cbor_encode_map_start(&encoder, 5);
+    cbor_encode_uint(&encoder, 2); /* set */
+    cbor_encode_bytes(&encoder, array, array_len);
+    cbor_encode_uint(&encoder, 3); /* offset */
+    cbor_encode_uint(&encoder, 0);
+    cbor_encode_uint(&encoder, 4); /* length */
+    cbor_encode_uint(&encoder, array_len);
+    cbor_encode_uint(&encoder, 5); /* pinUvAuthParam */
+    cbor_encode_bytes(&encoder, pin_auth, sizeof(pin_auth));
+    cbor_encode_uint(&encoder, 6); /* pinUvAuthProtocol */
+    cbor_encode_uint(&encoder, PIN_PROTOCOL_V2);
+
+    return send_command(CTAP2_CMD_LARGE_BLOBS, request, cbor_encoder_get_size(&encoder),
+                        response, &response_len);
+}
+
+int test_pin_token_permissions(void)
+{
+    static const char pin[] = "271828";
+    uint8_t token[PERM_TOKEN_SIZE];
+    uint8_t response[1024];
+    size_t response_len = 0;
+    uint8_t array[4 + 16] = {0x81, 0x42, 0x01, 0x02};
+    uint8_t digest[32];
+    uint8_t request[32];
+    uint8_t fragment[sizeof(array)];
+    size_t fragment_len = sizeof(fragment);
+    cbor_decoder_t decoder;
+    size_t map_size;
+    uint64_t key;
+    uint64_t value;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+    TEST_ASSERT(ctap2_init() == CTAP2_OK);
+
+    /* Tokens with permissions are advertised, with the commands that need them */
+    TEST_ASSERT(send_command(CTAP2_CMD_GET_INFO, NULL, 0, response, &response_len) == CTAP2_OK);
+    TEST_ASSERT(cbor_array_contains(response, response_len, "pinUvAuthToken"));
+    TEST_ASSERT(cbor_array_contains(response, response_len, "credMgmt"));
+    TEST_ASSERT(cbor_array_contains(response, response_len, "authnrCfg"));
+
+    TEST_ASSERT(storage_set_pin((const uint8_t *) pin, strlen(pin)) == STORAGE_OK);
+
+    /* A wrong PIN gets no token */
+    TEST_ASSERT(platform_get_token("314159", PERM_CREDENTIAL_MGMT, token) ==
+                CTAP2_ERR_PIN_INVALID);
+
+    /* cm: credential management is reachable and accepts the token */
+    TEST_ASSERT(platform_get_token(pin, PERM_CREDENTIAL_MGMT | PERM_LARGE_BLOB_WRITE, token) ==
+                CTAP2_OK);
+    TEST_ASSERT(cm_get_metadata(token, response, &response_len) == CTAP2_OK);
+    cbor_decoder_init(&decoder, response, response_len);
+    TEST_ASSERT(cbor_decode_map_start(&decoder, &map_size) == CBOR_OK && map_size == 2);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 1);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &value) == CBOR_OK && value == 0);
+
+    /* lbw: the same token writes the large-blob array */
+    crypto_sha256(array, 4, digest);
+    memcpy(&array[4], digest, 16);
+    TEST_ASSERT(lb_set_array(token, array, sizeof(array)) == CTAP2_OK);
+    response_len = encode_large_blob_get(request, sizeof(request), 0, sizeof(array));
+    TEST_ASSERT(ctap2_large_blobs(request, response_len, response, &response_len) == CTAP2_OK);
+    cbor_decoder_init(&decoder, response, response_len);
+    TEST_ASSERT(cbor_decode_map_start(&decoder, &map_size) == CBOR_OK && map_size == 1);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 1);
+    TEST_ASSERT(cbor_decode_bytes(&decoder, fragment, &fragment_len) == CBOR_OK);
+    TEST_ASSERT(fragment_len == sizeof(array) && memcmp(fragment, array, sizeof(array)) == 0);
+
+    /* A token without cm is turned away by credential management */
+    TEST_ASSERT(platform_get_token(pin, PERM_LARGE_BLOB_WRITE, token) == CTAP2_OK);
+    TEST_ASSERT(cm_get_metadata(token, response, &response_len) ==
+                CTAP2_ERR_UNAUTHORIZED_PERMISSION);
+
+    /* And a forged pinUvAuthParam by both */
+    memset(token, 0, sizeof(token));
+    TEST_ASSERT(cm_get_metadata(token, response, &response_len) == CTAP2_ERR_PIN_AUTH_INVALID);
+    TEST_ASSERT(lb_set_array(token, array, sizeof(array)) == CTAP2_ERR_PIN_AUTH_INVALID);
+
+    TEST_PASS();
+}
+
+static size_t encode_provision_request(uint8_t *buffer, size_t size, uint64_t subcommand,
+                                       bool with_params)
+{
+    static const uint8_t user_id[] = {0x01, 0x02, 0x03, 0x04};
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, buffer, size);
+
+    cbor_encode_map_start(&encoder, with_params ? 2 : 1);
+    cbor_encode_uint(&encoder, 1); /* subCommand */
+    cbor_encode_uint(&encoder, subcommand);
+    if (with_params) {
+        cbor_encode_uint(&encoder, 2); /* subCommandParams */
+        cbor_encode_map_start(&encoder, 2);
+        cbor_encode_uint(&encoder, 1); /* rpId */
+        cbor_encode_text(&encoder, "example.com", 11);
+        cbor_encode_uint(&encoder, 2); /* entries */
+        cbor_encode_array_start(&encoder, 1);
+        cbor_encode_map_start(&encoder, 1);
+        cbor_encode_uint(&encoder, 1); /* userId */
+        cbor_encode_bytes(&encoder, user_id, sizeof(user_id));
+    }
+
+    return cbor_encoder_get_size(&encoder);
+}
+
+int test_vendor_provision_checks(void)
+{
+    uint8_t request[64];
+    uint8_t response[256];
+    size_t request_len;
+    size_t response_len = 0;
+    size_t count;
+
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+
+    request_len = encode_provision_request(request, sizeof(request), 0x01, false);
+    TEST_ASSERT(ctap2_vendor_provision(request, request_len, response, &response_len) ==
+                CTAP2_ERR_MISSING_PARAMETER);
+
+    request_len = encode_provision_request(request, sizeof(request), 0x07, true);
+    TEST_ASSERT(ctap2_vendor_provision(request, request_len, response, &response_len) ==
+                CTAP2_ERR_INVALID_SUBCOMMAND);
+
+    /* Nothing is written to storage without an authenticated PIN token */
+    request_len = encode_provision_request(request, sizeof(request), 0x01, true);
+    TEST_ASSERT(ctap2_vendor_provision(request, request_len, response, &response_len) ==
+                CTAP2_ERR_PIN_NOT_SET);
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK && count == 0);
+
+    TEST_PASS();
+}
+
+/* Provided by mock_hal.c */
+void mock_flash_fail_write(size_t n);
+
+/* Vendor command (provision or backup), authorized with a token */
+static uint8_t vendor_send(uint8_t cmd, const uint8_t *token, uint8_t subcommand,
+                           const uint8_t *params, size_t params_len, uint8_t *response,
+                           size_t *response_len)
+{
+    uint8_t message[32 + 2 + 32];
+    uint8_t pin_auth[32];
+    uint8_t request[2 * CTAP2_MAX_MESSAGE_SIZE];
+    cbor_encoder_t encoder;
+
+    memset(message, 0xFF, 32);
+    message[32] = cmd;
+    message[33] = subcommand;
+    crypto_sha256(params, params_len, &message[34]);
+    crypto_hmac_sha256(token, PERM_TOKEN_SIZE, message, sizeof(message), pin_auth);
+
+    cbor_encoder_init(&encoder, request, sizeof(request));
+    cbor_encode_map_start(&encoder, 4);
+    cbor_encode_uint(&encoder, 1); /* subCommand */
+    cbor_encode_uint(&encoder, subcommand);
+    cbor_encode_uint(&encoder, 2); /* subCommandParams */
+    cbor_encode_raw(&encoder, params, params_len);
+    cbor_encode_uint(&encoder, 3); /* pinUvAuthProtocol */
+    cbor_encode_uint(&encoder, PIN_PROTOCOL_V2);
+    cbor_encode_uint(&encoder, 4); /* pinUvAuthParam */
+    cbor_encode_bytes(&encoder, pin_auth, sizeof(pin_auth));
+
+    /* Oversized requests are left for ctap2_process_request() to reject */
+    return send_command(cmd, request, cbor_encoder_get_size(&encoder), response, response_len);
+}
+
+/* Read entry @p index of a provisioning response: credential ID and public key */
+static int provision_response_entry(const uint8_t *response, size_t response_len, size_t index,
+                                    size_t *count, uint8_t *credential_id, uint8_t *public_key)
+{
+    cbor_decoder_t decoder;
+    size_t map_size;
+    uint64_t key;
+
+    cbor_decoder_init(&decoder, response, response_len);
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK || map_size != 2 ||
+        cbor_decode_uint(&decoder, &key) != CBOR_OK || key != 1 ||
+        cbor_decode_array_start(&decoder, count) != CBOR_OK || index >= *count) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < index; i++) {
+        cbor_decoder_skip(&decoder);
+    }
+
+    size_t id_len = STORAGE_CREDENTIAL_ID_LENGTH;
+    size_t x_len = 32;
+    size_t y_len = 32;
+    int64_t label;
+    if (cbor_decode_map_start(&decoder, &map_size) != CBOR_OK || map_size != 2 ||
+        cbor_decode_uint(&decoder, &key) != CBOR_OK || key != 1 ||
+        cbor_decode_bytes(&decoder, credential_id, &id_len) != CBOR_OK ||
+        cbor_decode_uint(&decoder, &key) != CBOR_OK || key != 2 ||
+        cbor_decode_map_start(&decoder, &map_size) != CBOR_OK || map_size != 5) {
+        return -1;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        cbor_decoder_skip(&decoder);
+        cbor_decoder_skip(&decoder);
+    }
+    if (cbor_decode_int(&decoder, &label) != CBOR_OK || label != -2 ||
+        cbor_decode_bytes(&decoder, public_key, &x_len) != CBOR_OK ||
+        cbor_decode_int(&decoder, &label) != CBOR_OK || label != -3 ||
+        cbor_decode_bytes(&decoder, &public_key[32], &y_len) != CBOR_OK) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int test_vendor_provision_batch(void)
+{
+    static const char pin[] = "161803";
+    static const uint8_t user_ids[3][2] = {{0x01, 0x01}, {0x01, 0x02}, {0x02, 0x01}};
+    uint8_t token[PERM_TOKEN_SIZE];
+    uint8_t params[256];
+    uint8_t response[1024];
+    size_t response_len = 0;
+    uint8_t credential_id[STORAGE_CREDENTIAL_ID_LENGTH];
+    uint8_t public_key[64];
+    uint8_t expected_public[64];
+    uint8_t private_key[32];
+    uint8_t private_key_enc[32 + PIN_PROTOCOL_V2_IV_SIZE];
+    size_t private_key_enc_len = 0;
+    storage_credential_t found;
+    cbor_encoder_t encoder;
+    size_t count = 0;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+    TEST_ASSERT(ctap2_init() == CTAP2_OK);
+    TEST_ASSERT(storage_set_pin((const uint8_t *) pin, strlen(pin)) == STORAGE_OK);
+    TEST_ASSERT(platform_get_token(pin, PERM_CREDENTIAL_MGMT, token) == CTAP2_OK);
+
+    /* generate: two users, keys made on the device */
+    cbor_encoder_init(&encoder, params, sizeof(params));
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_uint(&encoder, 1); /* rpId */
+    cbor_encode_text(&encoder, "fleet.example", 13);
+    cbor_encode_uint(&encoder, 2); /* entries */
+    cbor_encode_array_start(&encoder, 2);
+    for (size_t i = 0; i < 2; i++) {
+        cbor_encode_map_start(&encoder, 2);
+        cbor_encode_uint(&encoder, 1); /* userId */
+        cbor_encode_bytes(&encoder, user_ids[i], sizeof(user_ids[i]));
+        cbor_encode_uint(&encoder, 2); /* userName */
+        cbor_encode_text(&encoder, "agent", 5);
+    }
+    TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_PROVISION, token, 0x01, params,
+                            cbor_encoder_get_size(&encoder), response,
+                            &response_len) == CTAP2_OK);
+
+    for (size_t i = 0; i < 2; i++) {
+        TEST_ASSERT(provision_response_entry(response, response_len, i, &count, credential_id,
+                                             public_key) == 0);
+        TEST_ASSERT(count == 2);
+        TEST_ASSERT(storage_find_credential(credential_id, &found) == STORAGE_OK);
+        TEST_ASSERT(found.resident && strcmp(found.rp_id, "fleet.example") == 0);
+        TEST_ASSERT(found.user_id_len == 2 && memcmp(found.user_id, user_ids[i], 2) == 0);
+        TEST_ASSERT(crypto_ecdsa_get_public_key(found.private_key, expected_public) == CRYPTO_OK);
+        TEST_ASSERT(memcmp(public_key, expected_public, sizeof(public_key)) == 0);
+    }
+
+    /* import: the key travels encrypted to the ClientPIN shared secret */
+    TEST_ASSERT(crypto_ecdsa_generate_keypair(private_key, expected_public) == CRYPTO_OK);
+    TEST_ASSERT(pin_protocol_encrypt(&platform_secret, private_key, sizeof(private_key),
+                                     private_key_enc, &private_key_enc_len) == PIN_PROTOCOL_OK);
+
+    cbor_encoder_init(&encoder, params, sizeof(params));
+    cbor_encode_map_start(&encoder, 3);
+    cbor_encode_uint(&encoder, 1); /* rpId */
+    cbor_encode_text(&encoder, "fleet.example", 13);
+    cbor_encode_uint(&encoder, 2); /* entries */
+    cbor_encode_array_start(&encoder, 1);
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_uint(&encoder, 1); /* userId */
+    cbor_encode_bytes(&encoder, user_ids[2], sizeof(user_ids[2]));
+    cbor_encode_uint(&encoder, 4); /* encryptedKey */
+    cbor_encode_bytes(&encoder, private_key_enc, private_key_enc_len);
+    cbor_encode_uint(&encoder, 3); /* keyAgreement */
+    encode_platform_key(&encoder);
+    TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_PROVISION, token, 0x02, params,
+                            cbor_encoder_get_size(&encoder), response,
+                            &response_len) == CTAP2_OK);
+
+    TEST_ASSERT(provision_response_entry(response, response_len, 0, &count, credential_id,
+                                         public_key) == 0);
+    TEST_ASSERT(count == 1);
+    TEST_ASSERT(memcmp(public_key, expected_public, sizeof(public_key)) == 0);
+    TEST_ASSERT(storage_find_credential(credential_id, &found) == STORAGE_OK);
+    TEST_ASSERT(memcmp(found.private_key, private_key, sizeof(private_key)) == 0);
+
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK && count == 3);
+
+    /* A flash failure partway through leaves none of the batch behind */
+    cbor_encoder_init(&encoder, params, sizeof(params));
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_uint(&encoder, 1); /* rpId */
+    cbor_encode_text(&encoder, "fleet.example", 13);
+    cbor_encode_uint(&encoder, 2); /* entries */
+    cbor_encode_array_start(&encoder, 3);
+    for (size_t i = 0; i < 3; i++) {
+        cbor_encode_map_start(&encoder, 1);
+        cbor_encode_uint(&encoder, 1); /* userId */
+        cbor_encode_bytes(&encoder, user_ids[i], sizeof(user_ids[i]));
+    }
+    mock_flash_fail_write(3);
+    TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_PROVISION, token, 0x01, params,
+                            cbor_encoder_get_size(&encoder), response,
+                            &response_len) == CTAP2_ERR_PROCESSING);
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK && count == 3);
+
+    /* A token without cm provisions nothing */
+    TEST_ASSERT(platform_get_token(pin, PERM_LARGE_BLOB_WRITE, token) == CTAP2_OK);
+    TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_PROVISION, token, 0x01, params,
+                            cbor_encoder_get_size(&encoder), response,
+                            &response_len) == CTAP2_ERR_UNAUTHORIZED_PERMISSION);
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK && count == 3);
+
+    TEST_PASS();
+}
+
+int test_vendor_backup_checks(void)
+{
+    uint8_t request[32];
+    uint8_t response[256];
+    size_t response_len = 0;
+    cbor_encoder_t encoder;
+
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+
+    /* {1: exportChunk, 2: {3: 0}} */
+    cbor_encoder_init(&encoder, request, sizeof(request));
+    cbor_encode_map_start(&encoder, 2);
+    cbor_encode_uint(&encoder, 1);
+    cbor_encode_uint(&encoder, 0x01);
+    cbor_encode_uint(&encoder, 2);
+    cbor_encode_map_start(&encoder, 1);
+    cbor_encode_uint(&encoder, 3);
+    cbor_encode_uint(&encoder, 0);
+
+    /* The store never leaves the device without an authenticated PIN token */
+    TEST_ASSERT(ctap2_vendor_backup(request, cbor_encoder_get_size(&encoder), response,
+                                    &response_len) == CTAP2_ERR_PIN_NOT_SET);
+    TEST_ASSERT(response_len == 0);
+
+    request[2] = 0x07;
+    TEST_ASSERT(ctap2_vendor_backup(request, cbor_encoder_get_size(&encoder), response,
+                                    &response_len) == CTAP2_ERR_INVALID_SUBCOMMAND);
+
+    TEST_PASS();
+}
+
+/* Build backup subCommandParams; the session keys only go with chunk 0 */
+static size_t encode_backup_params(uint8_t *buffer, size_t size, uint32_t index,
+                                   const uint8_t *backup_key_enc, size_t backup_key_enc_len,
+                                   const uint8_t *chunk, size_t chunk_len,
+                                   const uint8_t *manifest)
+{
+    cbor_encoder_t encoder;
+    cbor_encoder_init(&encoder, buffer, size);
+
+    cbor_encode_map_start(&encoder, 1 + (index == 0 ? 2 : 0) + (chunk != NULL ? 1 : 0) +
+                                        (manifest != NULL ? 1 : 0));
+    if (index == 0) {
+        cbor_encode_uint(&encoder, 1); /* keyAgreement */
+        encode_platform_key(&encoder);
+        cbor_encode_uint(&encoder, 2); /* backupKeyEnc */
+        cbor_encode_bytes(&encoder, backup_key_enc, backup_key_enc_len);
+    }
+    cbor_encode_uint(&encoder, 3); /* chunkIndex */
+    cbor_encode_uint(&encoder, index);
+    if (chunk != NULL) {
+        cbor_encode_uint(&encoder, 4); /* chunk */
+        cbor_encode_bytes(&encoder, chunk, chunk_len);
+    }
+    if (manifest != NULL) {
+        cbor_encode_uint(&encoder, 5); /* manifest */
+        cbor_encode_bytes(&encoder, manifest, 32);
+    }
+
+    return cbor_encoder_get_size(&encoder);
+}
+
+#define BACKUP_TEST_CREDENTIALS 12
+#define BACKUP_TEST_MAX_CHUNKS 12
+
+int test_vendor_backup_round_trip(void)
+{
+    static const char pin[] = "577215";
+    static const char rp_id[] = "login.example.com";
+    static storage_credential_t credentials[BACKUP_TEST_CREDENTIALS];
+    static uint8_t chunks[BACKUP_TEST_MAX_CHUNKS][CTAP2_MAX_MESSAGE_SIZE];
+    size_t chunk_lens[BACKUP_TEST_MAX_CHUNKS];
+    size_t chunk_count = 0;
+    uint8_t manifest[32];
+    bool has_manifest = false;
+    uint8_t backup_key[32];
+    uint8_t backup_key_enc[32 + PIN_PROTOCOL_V2_IV_SIZE];
+    size_t backup_key_enc_len = 0;
+    uint8_t token[PERM_TOKEN_SIZE];
+    uint8_t params[2 * CTAP2_MAX_MESSAGE_SIZE];
+    size_t params_len;
+    uint8_t response[CTAP2_MAX_MESSAGE_SIZE];
+    size_t response_len = 0;
+    storage_credential_t found;
+    cbor_decoder_t decoder;
+    size_t map_size;
+    size_t count = 0;
+    uint64_t key;
+    uint64_t records = 0;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+    TEST_ASSERT(ctap2_init() == CTAP2_OK);
+
+    /* Resident credentials as a typical RP registers them */
+    for (size_t i = 0; i < BACKUP_TEST_CREDENTIALS; i++) {
+        storage_credential_t *credential = &credentials[i];
+
+        memset(credential, 0, sizeof(*credential));
+        TEST_ASSERT(crypto_random_generate(credential->id, sizeof(credential->id)) ==
+                    CRYPTO_OK);
+        TEST_ASSERT(crypto_random_generate(credential->private_key,
+                                           sizeof(credential->private_key)) == CRYPTO_OK);
+        TEST_ASSERT(crypto_random_generate(credential->user_id, 16) == CRYPTO_OK);
+        credential->user_id_len = 16;
+        snprintf(credential->user_name, sizeof(credential->user_name), "user%02u@example.com",
+                 (unsigned) i);
+        snprintf(credential->display_name, sizeof(credential->display_name), "Example User %02u",
+                 (unsigned) i);
+        strcpy(credential->rp_id, rp_id);
+        TEST_ASSERT(crypto_sha256((const uint8_t *) rp_id, strlen(rp_id),
+                                  credential->rp_id_hash) == CRYPTO_OK);
+        credential->algorithm = -7;
+        credential->resident = true;
+        TEST_ASSERT(storage_store_credential(credential) == STORAGE_OK);
+    }
+
+    TEST_ASSERT(storage_set_pin((const uint8_t *) pin, strlen(pin)) == STORAGE_OK);
+    TEST_ASSERT(platform_get_token(pin, PERM_CREDENTIAL_MGMT, token) == CTAP2_OK);
+    TEST_ASSERT(crypto_random_generate(backup_key, sizeof(backup_key)) == CRYPTO_OK);
+    TEST_ASSERT(pin_protocol_encrypt(&platform_secret, backup_key, sizeof(backup_key),
+                                     backup_key_enc, &backup_key_enc_len) == PIN_PROTOCOL_OK);
+
+    /* Export until the chunk carrying the manifest */
+    while (!has_manifest) {
+        TEST_ASSERT(chunk_count < BACKUP_TEST_MAX_CHUNKS);
+        params_len = encode_backup_params(params, sizeof(params), (uint32_t) chunk_count,
+                                          backup_key_enc, backup_key_enc_len, NULL, 0, NULL);
+        TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_BACKUP, token, 0x01, params, params_len,
+                                response, &response_len) == CTAP2_OK);
+
+        cbor_decoder_init(&decoder, response, response_len);
+        TEST_ASSERT(cbor_decode_map_start(&decoder, &map_size) == CBOR_OK);
+        TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 1);
+        chunk_lens[chunk_count] = sizeof(chunks[chunk_count]);
+        TEST_ASSERT(cbor_decode_bytes(&decoder, chunks[chunk_count],
+                                      &chunk_lens[chunk_count]) == CBOR_OK);
+        if (map_size == 2) {
+            size_t manifest_len = sizeof(manifest);
+            TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 2);
+            TEST_ASSERT(cbor_decode_bytes(&decoder, manifest, &manifest_len) == CBOR_OK);
+            has_manifest = true;
+        }
+        chunk_count++;
+    }
+
+    /* About four typical records per chunk */
+    TEST_ASSERT(chunk_count >= 3 && chunk_count <= 4);
+
+    /* Wipe; the PIN and every device key go with it */
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK && count == 0);
+    TEST_ASSERT(storage_set_pin((const uint8_t *) pin, strlen(pin)) == STORAGE_OK);
+    TEST_ASSERT(platform_get_token(pin, PERM_CREDENTIAL_MGMT, token) == CTAP2_OK);
+    TEST_ASSERT(pin_protocol_encrypt(&platform_secret, backup_key, sizeof(backup_key),
+                                     backup_key_enc, &backup_key_enc_len) == PIN_PROTOCOL_OK);
+
+    /* A manifest that does not verify takes the whole import back */
+    uint8_t bad_manifest[32];
+    memcpy(bad_manifest, manifest, sizeof(bad_manifest));
+    bad_manifest[0] ^= 0x01;
+    for (size_t i = 0; i < chunk_count; i++) {
+        bool last = (i + 1 == chunk_count);
+        params_len = encode_backup_params(params, sizeof(params), (uint32_t) i, backup_key_enc,
+                                          backup_key_enc_len, chunks[i], chunk_lens[i],
+                                          last ? bad_manifest : NULL);
+        TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_BACKUP, token, 0x02, params, params_len,
+                                response, &response_len) ==
+                    (last ? CTAP2_ERR_INTEGRITY_FAILURE : CTAP2_OK));
+    }
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK && count == 0);
+
+    /* So does a session abandoned partway for a new one */
+    params_len = encode_backup_params(params, sizeof(params), 0, backup_key_enc,
+                                      backup_key_enc_len, chunks[0], chunk_lens[0], NULL);
+    TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_BACKUP, token, 0x02, params, params_len, response,
+                            &response_len) == CTAP2_OK);
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK && count > 0);
+
+    /* Import in order; every request fits the CTAP message buffer */
+    for (size_t i = 0; i < chunk_count; i++) {
+        bool last = (i + 1 == chunk_count);
+        params_len = encode_backup_params(params, sizeof(params), (uint32_t) i, backup_key_enc,
+                                          backup_key_enc_len, chunks[i], chunk_lens[i],
+                                          last ? manifest : NULL);
+        TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_BACKUP, token, 0x02, params, params_len,
+                                response, &response_len) == CTAP2_OK);
+
+        cbor_decoder_init(&decoder, response, response_len);
+        TEST_ASSERT(cbor_decode_map_start(&decoder, &map_size) == CBOR_OK && map_size == 1);
+        TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 3);
+        TEST_ASSERT(cbor_decode_uint(&decoder, &records) == CBOR_OK);
+    }
+    TEST_ASSERT(records == BACKUP_TEST_CREDENTIALS);
+
+    /* Every credential is back, under the new device keys */
+    TEST_ASSERT(storage_get_credential_count(&count) == STORAGE_OK &&
+                count == BACKUP_TEST_CREDENTIALS);
+    for (size_t i = 0; i < BACKUP_TEST_CREDENTIALS; i++) {
+        TEST_ASSERT(storage_find_credential(credentials[i].id, &found) == STORAGE_OK);
+        TEST_ASSERT(memcmp(found.private_key, credentials[i].private_key, 32) == 0);
+        TEST_ASSERT(memcmp(found.rp_id_hash, credentials[i].rp_id_hash, 32) == 0);
+        TEST_ASSERT(strcmp(found.user_name, credentials[i].user_name) == 0);
+        TEST_ASSERT(found.resident && found.algorithm == -7);
+    }
+
+    TEST_PASS();
+}
+
+/* Firmware test image, streamed in chunks the size ctap2_firmware.c accepts */
+#define FIRMWARE_TEST_IMAGE_SIZE 5000
+#define FIRMWARE_TEST_CHUNK_SIZE 960
+
+/* Provided by mock_hal.c */
+void mock_fw_load_active(const uint8_t *image, size_t len);
+
+static int firmware_random(uint8_t *buffer, size_t len)
+{
+    return crypto_random_generate(buffer, len) == CRYPTO_OK ? 0 : -1;
+}
+
+/* Signature over the version (little-endian) followed by the image */
+static void firmware_sign(const uint8_t *private_key, uint32_t version, const uint8_t *image,
+                          size_t len, uint8_t *digest, uint8_t *signature)
+{
+    uint8_t prefix[4] = {(uint8_t) version, (uint8_t) (version >> 8), (uint8_t) (version >> 16),
+                         (uint8_t) (version >> 24)};
+    sha256_ctx_t ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, prefix, sizeof(prefix));
+    sha256_update(&ctx, image, len);
+    sha256_final(&ctx, digest);
+    p256_ecdsa_sign(private_key, digest, firmware_random, signature);
+}
+
+static uint8_t firmware_begin(const uint8_t *token, uint32_t version, uint8_t *response,
+                              size_t *response_len)
+{
+    uint8_t params[32];
+    cbor_encoder_t encoder;
+
+    cbor_encoder_init(&encoder, params, sizeof(params));
+    cbor_encode_map_start(&encoder, 4);
+    cbor_encode_uint(&encoder, 1); /* type */
+    cbor_encode_uint(&encoder, FIRMWARE_UPDATE_FULL);
+    cbor_encode_uint(&encoder, 2); /* imageSize */
+    cbor_encode_uint(&encoder, FIRMWARE_TEST_IMAGE_SIZE);
+    cbor_encode_uint(&encoder, 3); /* payloadSize */
+    cbor_encode_uint(&encoder, FIRMWARE_TEST_IMAGE_SIZE);
+    cbor_encode_uint(&encoder, 4); /* version */
+    cbor_encode_uint(&encoder, version);
+
+    return vendor_send(CTAP2_CMD_VENDOR_FIRMWARE, token, 0x01, params,
+                       cbor_encoder_get_size(&encoder), response, response_len);
+}
+
+/* Stream the whole image and finish with @p signature */
+static uint8_t firmware_send_image(const uint8_t *token, const uint8_t *image,
+                                   const uint8_t *signature)
+{
+    static uint8_t params[CTAP2_MAX_MESSAGE_SIZE];
+    uint8_t response[CTAP2_MAX_MESSAGE_SIZE];
+    size_t response_len = 0;
+    cbor_encoder_t encoder;
+    uint8_t status;
+
+    for (size_t offset = 0; offset < FIRMWARE_TEST_IMAGE_SIZE;
+         offset += FIRMWARE_TEST_CHUNK_SIZE) {
+        size_t n = FIRMWARE_TEST_IMAGE_SIZE - offset;
+        if (n > FIRMWARE_TEST_CHUNK_SIZE) {
+            n = FIRMWARE_TEST_CHUNK_SIZE;
+        }
+
+        cbor_encoder_init(&encoder, params, sizeof(params));
+        cbor_encode_map_start(&encoder, 2);
+        cbor_encode_uint(&encoder, 1); /* offset */
+        cbor_encode_uint(&encoder, offset);
+        cbor_encode_uint(&encoder, 2); /* chunk */
+        cbor_encode_bytes(&encoder, &image[offset], n);
+        status = vendor_send(CTAP2_CMD_VENDOR_FIRMWARE, token, 0x02, params,
+                             cbor_encoder_get_size(&encoder), response, &response_len);
+        if (status != CTAP2_OK) {
+            return status;
+        }
+    }
+
+    cbor_encoder_init(&encoder, params, sizeof(params));
+    cbor_encode_map_start(&encoder, 1);
+    cbor_encode_uint(&encoder, 1); /* signature */
+    cbor_encode_bytes(&encoder, signature, P256_SIGNATURE_SIZE);
+    return vendor_send(CTAP2_CMD_VENDOR_FIRMWARE, token, 0x03, params,
+                       cbor_encoder_get_size(&encoder), response, &response_len);
+}
+
+int test_vendor_firmware_update(void)
+{
+    static const char pin[] = "141421";
+    static const uint8_t empty_map[] = {0xA0};
+    static uint8_t running[FIRMWARE_TEST_IMAGE_SIZE];
+    static uint8_t image[FIRMWARE_TEST_IMAGE_SIZE];
+    static uint8_t slot[FIRMWARE_TEST_IMAGE_SIZE];
+    uint8_t signing_private[P256_SCALAR_SIZE];
+    uint8_t signing_public[P256_POINT_SIZE];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t signature[P256_SIGNATURE_SIZE];
+    uint8_t token[PERM_TOKEN_SIZE];
+    uint8_t response[CTAP2_MAX_MESSAGE_SIZE];
+    size_t response_len = 0;
+    hal_fw_slots_t slots;
+    cbor_decoder_t decoder;
+    size_t map_size;
+    uint64_t key;
+    uint64_t value;
+    uint32_t version;
+
+    /* The key tests/CMakeLists.txt builds in as FIRMWARE_SIGNING_KEY */
+    for (size_t i = 0; i < sizeof(signing_private); i++) {
+        signing_private[i] = (uint8_t) (0xF0 ^ i);
+    }
+    TEST_ASSERT(p256_public_key(signing_private, signing_public) == P256_OK);
+    TEST_ASSERT(firmware_update_signing_key() != NULL);
+    TEST_ASSERT(memcmp(firmware_update_signing_key(), signing_public, P256_POINT_SIZE) == 0);
+
+    TEST_ASSERT(hal_init() == HAL_OK);
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+    TEST_ASSERT(ctap2_init() == CTAP2_OK);
+
+    /* Running image is a signed version 5 */
+    TEST_ASSERT(crypto_random_generate(running, sizeof(running)) == CRYPTO_OK);
+    mock_fw_load_active(running, sizeof(running));
+    firmware_sign(signing_private, 5, running, sizeof(running), digest, signature);
+    TEST_ASSERT(boot_verify_image_commit(0, sizeof(running), 5, digest, signature) ==
+                BOOT_VERIFY_OK);
+
+    TEST_ASSERT(storage_set_pin((const uint8_t *) pin, strlen(pin)) == STORAGE_OK);
+
+    /* Credential management rights do not cover firmware */
+    TEST_ASSERT(platform_get_token(pin, PERM_CREDENTIAL_MGMT, token) == CTAP2_OK);
+    TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_FIRMWARE, token, 0x05, empty_map, sizeof(empty_map),
+                            response, &response_len) == CTAP2_ERR_UNAUTHORIZED_PERMISSION);
+
+    TEST_ASSERT(platform_get_token(pin, PERM_AUTHENTICATOR_CFG, token) == CTAP2_OK);
+
+    /* Status reports the running version */
+    TEST_ASSERT(vendor_send(CTAP2_CMD_VENDOR_FIRMWARE, token, 0x05, empty_map, sizeof(empty_map),
+                            response, &response_len) == CTAP2_OK);
+    cbor_decoder_init(&decoder, response, response_len);
+    TEST_ASSERT(cbor_decode_map_start(&decoder, &map_size) == CBOR_OK && map_size == 2);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 1);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &value) == CBOR_OK && value == 0);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &key) == CBOR_OK && key == 2);
+    TEST_ASSERT(cbor_decode_uint(&decoder, &value) == CBOR_OK && value == 5);
+
+    /* No going back to version 4, however well signed */
+    TEST_ASSERT(firmware_begin(token, 4, response, &response_len) == CTAP2_ERR_NOT_ALLOWED);
+
+    /* Version 7 signed as version 6 does not verify */
+    TEST_ASSERT(crypto_random_generate(image, sizeof(image)) == CRYPTO_OK);
+    firmware_sign(signing_private, 6, image, sizeof(image), digest, signature);
+    TEST_ASSERT(firmware_begin(token, 7, response, &response_len) == CTAP2_OK);
+    TEST_ASSERT(firmware_send_image(token, image, signature) == CTAP2_ERR_INTEGRITY_FAILURE);
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK && slots.boot == 0);
+
+    /* Version 6 goes through and becomes the next image to boot */
+    TEST_ASSERT(firmware_begin(token, 6, response, &response_len) == CTAP2_OK);
+    TEST_ASSERT(firmware_send_image(token, image, signature) == CTAP2_OK);
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK && slots.active == 0 && slots.boot == 1);
+    TEST_ASSERT(hal_fw_read(1, 0, slot, sizeof(slot)) == HAL_OK);
+    TEST_ASSERT(memcmp(slot, image, sizeof(image)) == 0);
+    TEST_ASSERT(boot_verify_image_version(1, &version) == BOOT_VERIFY_OK && version == 6);
+
+    /* Nothing left to finish */
+    TEST_ASSERT(firmware_send_image(token, image, signature) == CTAP2_ERR_INVALID_SEQ);
+
+    TEST_PASS();
+}
+
+int test_storage_keys_survive_reboot(void)
+{
+    static const uint8_t pin[] = "123456";
+    storage_credential_t credential;
+    storage_credential_t found;
+    uint8_t other_rp[32];
+    size_t count = 0;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+
+    memset(&credential, 0, sizeof(credential));
+    TEST_ASSERT(crypto_random_generate(credential.id, sizeof(credential.id)) == CRYPTO_OK);
+    memset(credential.rp_id_hash, 0xAA, sizeof(credential.rp_id_hash));
+    credential.resident = true;
+    TEST_ASSERT(storage_store_credential(&credential) == STORAGE_OK);
+    TEST_ASSERT(storage_set_pin(pin, sizeof(pin) - 1) == STORAGE_OK);
+
+    /* The device keys come back from flash, so sealed state opens after a reboot */
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_verify_pin(pin, sizeof(pin) - 1) == STORAGE_OK);
+    TEST_ASSERT(storage_find_credential(credential.id, &found) == STORAGE_OK);
+    TEST_ASSERT(memcmp(found.rp_id_hash, credential.rp_id_hash, 32) == 0);
+
+    /* Lookups by RP only open records carrying that RP's tag */
+    memset(other_rp, 0xBB, sizeof(other_rp));
+    TEST_ASSERT(storage_find_credentials_by_rp(other_rp, STORAGE_CRED_PROTECT_UV_REQUIRED, &found,
+                                               1, &count) == STORAGE_OK);
+    TEST_ASSERT(count == 0);
+    TEST_ASSERT(storage_find_credentials_by_rp(credential.rp_id_hash,
+                                               STORAGE_CRED_PROTECT_UV_REQUIRED, &found, 1,
+                                               &count) == STORAGE_OK);
+    TEST_ASSERT(count == 1);
+
+    /* Formatting erases the store and draws a new root */
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+    TEST_ASSERT(storage_find_credential(credential.id, &found) == STORAGE_ERROR_NOT_FOUND);
+
+    TEST_PASS();
+}
+
+int test_storage_max_length_credential(void)
+{
+    static const char ellipsis[] = "\xE2\x80\xA6";
+    storage_credential_t credential;
+    storage_credential_t found;
+
+    TEST_ASSERT(crypto_init() == CRYPTO_OK);
+    TEST_ASSERT(storage_init() == STORAGE_OK);
+    TEST_ASSERT(storage_format() == STORAGE_OK);
+
+    /* Every optional field present, each at the longest MakeCredential accepts */
+    memset(&credential, 0, sizeof(credential));
+    TEST_ASSERT(crypto_random_generate(credential.id, sizeof(credential.id)) == CRYPTO_OK);
+    memset(credential.rp_id_hash, 0xAA, sizeof(credential.rp_id_hash));
+    memset(credential.private_key, 0x11, sizeof(credential.private_key));
+    memset(credential.user_id, 0x22, sizeof(credential.user_id));
+    credential.user_id_len = sizeof(credential.user_id);
+    memset(credential.user_name, 'n', sizeof(credential.user_name) - 1);
+    memset(credential.display_name, 'd', sizeof(credential.display_name) - 1);
+    memset(credential.rp_id, 'r', sizeof(credential.rp_id) - 1);
+    memset(credential.cred_blob, 0x33, sizeof(credential.cred_blob));
+    credential.cred_blob_len = sizeof(credential.cred_blob);
+    memset(credential.large_blob_key, 0x44, sizeof(credential.large_blob_key));
+    credential.has_large_blob_key = true;
+    credential.algorithm = -7;
+    credential.hmac_secret = true;
+    credential.resident = true;
+
+    TEST_ASSERT(storage_store_credential(&credential) == STORAGE_OK);
+    TEST_ASSERT(storage_find_credential(credential.id, &found) == STORAGE_OK);
+
+    /* 64-byte names survive whole */
+    TEST_ASSERT(strlen(found.user_name) == 64);
+    TEST_ASSERT(strcmp(found.user_name, credential.user_name) == 0);
+    TEST_ASSERT(strcmp(found.display_name, credential.display_name) == 0);
+    TEST_ASSERT(found.user_id_len == sizeof(found.user_id));
+    TEST_ASSERT(memcmp(found.user_id, credential.user_id, sizeof(found.user_id)) == 0);
+    TEST_ASSERT(found.cred_blob_len == sizeof(found.cred_blob));
+    TEST_ASSERT(found.has_large_blob_key && found.algorithm == -7 && found.hmac_secret);
+
+    /* The stored RP ID is cut to 32 bytes, ending in an ellipsis */
+    TEST_ASSERT(strlen(found.rp_id) == 32);
+    TEST_ASSERT(strncmp(found.rp_id, credential.rp_id, 29) == 0);
+    TEST_ASSERT(strcmp(&found.rp_id[29], ellipsis) == 0);
+
+    TEST_PASS();
+}
+
 int main(void)
 {
     int failures = 0;
@@ -112,6 +1217,16 @@ int main(void)
 
     failures += test_getinfo_extensions();
     failures += test_make_credential_ed25519();
+    failures += test_hmac_secret_decode_input();
+    failures += test_large_blobs_get();
+    failures += test_pin_token_permissions();
+    failures += test_vendor_provision_checks();
+    failures += test_vendor_provision_batch();
+    failures += test_vendor_backup_checks();
+    failures += test_vendor_backup_round_trip();
+    failures += test_vendor_firmware_update();
+    failures += test_storage_keys_survive_reboot();
+    failures += test_storage_max_length_credential();
 
     printf("=== Extension Tests: %d failures ===\n\n", failures);
     return failures;
@@ -0,0 +1,426 @@
+/**
+ * @file test_firmware_update.c
+ * @brief Unit tests for the streaming A/B firmware update
+ *
+ * Runs full-image and delta updates against the mock HAL's RAM slots,
+ * feeding the payload in uneven chunks so that control records and pages
+ * straddle chunk boundaries, and checks that anything short of a complete,
+ * correctly signed image leaves the boot slot alone.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "boot_verify.h"
+#include "firmware_update.h"
+#include "hal.h"
+#include "p256.h"
+#include "sha256.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+#define IMAGE_SIZE 10001
+#define PATCH_MAX 4096
+
+/* Provided by mock_hal.c */
+void mock_fw_load_active(const uint8_t *image, size_t len);
+
+static uint8_t signing_private[32];
+static uint8_t signing_public[FIRMWARE_UPDATE_PUBLIC_KEY_SIZE];
+
+static uint8_t base_image[IMAGE_SIZE];
+static uint8_t new_image[IMAGE_SIZE + 64];
+static uint8_t slot_image[IMAGE_SIZE + 64];
+static uint8_t patch[PATCH_MAX];
+
+/* Deterministic byte stream for images and keys */
+static uint32_t test_rng_state = 0x12345678;
+
+static int test_random(uint8_t *buffer, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        test_rng_state = test_rng_state * 1103515245 + 12345;
+        buffer[i] = (uint8_t) (test_rng_state >> 16);
+    }
+    return 0;
+}
+
+static void put_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+}
+
+/* Append a control record and its run-length coded diff against base[base_pos] */
+static size_t patch_record(size_t len, const uint8_t *target, size_t diff_len, uint32_t base_pos,
+                           size_t extra_len, int32_t seek)
+{
+    put_le32(&patch[len], (uint32_t) diff_len);
+    put_le32(&patch[len + 4], (uint32_t) extra_len);
+    put_le32(&patch[len + 8], (uint32_t) seek);
+    len += FIRMWARE_UPDATE_CONTROL_SIZE;
+
+    for (size_t i = 0; i < diff_len;) {
+        uint8_t diff = (uint8_t) (target[i] - base_image[base_pos + i]);
+        if (diff != 0) {
+            patch[len++] = diff;
+            i++;
+            continue;
+        }
+
+        /* Zero run: 0x00, length - 1 */
+        size_t run = 1;
+        while (run < 256 && i + run < diff_len &&
+               target[i + run] == base_image[base_pos + i + run]) {
+            run++;
+        }
+        patch[len++] = 0x00;
+        patch[len++] = (uint8_t) (run - 1);
+        i += run;
+    }
+    memcpy(&patch[len], &target[diff_len], extra_len);
+    return len + extra_len;
+}
+
+/* Signature over the version (little-endian) followed by the image */
+static void sign_image(uint32_t version, const uint8_t *image, size_t len, uint8_t *signature)
+{
+    uint8_t prefix[4];
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_ctx_t ctx;
+
+    put_le32(prefix, version);
+    sha256_init(&ctx);
+    sha256_update(&ctx, prefix, sizeof(prefix));
+    sha256_update(&ctx, image, len);
+    sha256_final(&ctx, digest);
+    p256_ecdsa_sign(signing_private, digest, test_random, signature);
+}
+
+/* Stream a payload in chunks of varying size */
+static int stream_payload(const uint8_t *payload, size_t len)
+{
+    static const size_t chunk_sizes[] = {251, 7, 64, 1, 200, 13};
+    size_t offset = 0;
+
+    for (size_t i = 0; offset < len; i++) {
+        size_t n = chunk_sizes[i % (sizeof(chunk_sizes) / sizeof(chunk_sizes[0]))];
+        if (n > len - offset) {
+            n = len - offset;
+        }
+
+        int ret = firmware_update_write((uint32_t) offset, &payload[offset], n);
+        if (ret != FIRMWARE_UPDATE_OK) {
+            return ret;
+        }
+        offset += n;
+    }
+
+    return FIRMWARE_UPDATE_OK;
+}
+
+static void reset_slots(void)
+{
+    hal_init();
+    test_random(base_image, sizeof(base_image));
+    mock_fw_load_active(base_image, sizeof(base_image));
+}
+
+static int test_firmware_update_full(void)
+{
+    reset_slots();
+    test_random(new_image, IMAGE_SIZE);
+
+    firmware_update_header_t header = {FIRMWARE_UPDATE_FULL, IMAGE_SIZE, IMAGE_SIZE, 1};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_in_progress());
+    TEST_ASSERT(stream_payload(new_image, IMAGE_SIZE) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_received() == IMAGE_SIZE);
+
+    uint8_t signature[FIRMWARE_UPDATE_SIGNATURE_SIZE];
+    sign_image(1, new_image, IMAGE_SIZE, signature);
+    TEST_ASSERT(firmware_update_finish(signing_public, signature) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(!firmware_update_in_progress());
+
+    hal_fw_slots_t slots;
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK);
+    TEST_ASSERT(slots.active == 0 && slots.boot == 1);
+
+    /* Image in place, tail of the last page left erased, running slot untouched */
+    TEST_ASSERT(hal_fw_read(1, 0, slot_image, IMAGE_SIZE + 64) == HAL_OK);
+    TEST_ASSERT(memcmp(slot_image, new_image, IMAGE_SIZE) == 0);
+    for (size_t i = IMAGE_SIZE; i < IMAGE_SIZE + 64; i++) {
+        TEST_ASSERT(slot_image[i] == 0xFF);
+    }
+    TEST_ASSERT(hal_fw_read(0, 0, slot_image, IMAGE_SIZE) == HAL_OK);
+    TEST_ASSERT(memcmp(slot_image, base_image, IMAGE_SIZE) == 0);
+
+    TEST_PASS();
+}
+
+static int test_firmware_update_delta(void)
+{
+    reset_slots();
+
+    /*
+     * New image: a patched copy of the first 4000 bytes, 300 inserted bytes,
+     * the rest of the base with 500 bytes skipped, then a tail that is new.
+     */
+    size_t new_len = 0;
+    memcpy(new_image, base_image, 4000);
+    for (size_t i = 0; i < 4000; i += 97) {
+        new_image[i] ^= 0x5A;
+    }
+    new_len = 4000;
+    test_random(&new_image[new_len], 300);
+    new_len += 300;
+    memcpy(&new_image[new_len], &base_image[4500], 5000);
+    new_len += 5000;
+    test_random(&new_image[new_len], 77);
+    new_len += 77;
+
+    size_t patch_len = 0;
+    patch_len = patch_record(patch_len, &new_image[0], 4000, 0, 300, 500);
+    patch_len = patch_record(patch_len, &new_image[4300], 5000, 4500, 77, 0);
+    TEST_ASSERT(patch_len < new_len / 8);
+
+    firmware_update_header_t header = {FIRMWARE_UPDATE_DELTA, (uint32_t) new_len,
+                                       (uint32_t) patch_len, 1};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(stream_payload(patch, patch_len) == FIRMWARE_UPDATE_OK);
+
+    uint8_t signature[FIRMWARE_UPDATE_SIGNATURE_SIZE];
+    sign_image(1, new_image, new_len, signature);
+    TEST_ASSERT(firmware_update_finish(signing_public, signature) == FIRMWARE_UPDATE_OK);
+
+    hal_fw_slots_t slots;
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK);
+    TEST_ASSERT(slots.boot == 1);
+    TEST_ASSERT(hal_fw_read(1, 0, slot_image, new_len) == HAL_OK);
+    TEST_ASSERT(memcmp(slot_image, new_image, new_len) == 0);
+
+    TEST_PASS();
+}
+
+static int test_firmware_update_bad_signature(void)
+{
+    reset_slots();
+    test_random(new_image, IMAGE_SIZE);
+
+    uint8_t signature[FIRMWARE_UPDATE_SIGNATURE_SIZE];
+    sign_image(1, new_image, IMAGE_SIZE, signature);
+
+    /* One flipped bit in transit */
+    new_image[5000] ^= 0x01;
+
+    firmware_update_header_t header = {FIRMWARE_UPDATE_FULL, IMAGE_SIZE, IMAGE_SIZE, 1};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(stream_payload(new_image, IMAGE_SIZE) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_finish(signing_public, signature) ==
+                FIRMWARE_UPDATE_ERROR_SIGNATURE);
+
+    hal_fw_slots_t slots;
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK);
+    TEST_ASSERT(slots.boot == 0);
+
+    TEST_PASS();
+}
+
+static int test_firmware_update_incomplete(void)
+{
+    reset_slots();
+    test_random(new_image, IMAGE_SIZE);
+
+    uint8_t signature[FIRMWARE_UPDATE_SIGNATURE_SIZE];
+    sign_image(1, new_image, IMAGE_SIZE, signature);
+
+    firmware_update_header_t header = {FIRMWARE_UPDATE_FULL, IMAGE_SIZE, IMAGE_SIZE, 1};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(stream_payload(new_image, IMAGE_SIZE - 1) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_finish(signing_public, signature) == FIRMWARE_UPDATE_ERROR_SIZE);
+    TEST_ASSERT(!firmware_update_in_progress());
+
+    hal_fw_slots_t slots;
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK);
+    TEST_ASSERT(slots.boot == 0);
+
+    TEST_PASS();
+}
+
+static int test_firmware_update_sequence(void)
+{
+    reset_slots();
+    test_random(new_image, IMAGE_SIZE);
+
+    firmware_update_header_t header = {FIRMWARE_UPDATE_FULL, IMAGE_SIZE, IMAGE_SIZE, 1};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_write(0, new_image, 100) == FIRMWARE_UPDATE_OK);
+
+    /* Retransmission and gap are both refused without losing the update */
+    TEST_ASSERT(firmware_update_write(0, new_image, 100) == FIRMWARE_UPDATE_ERROR_SEQUENCE);
+    TEST_ASSERT(firmware_update_write(200, &new_image[200], 100) ==
+                FIRMWARE_UPDATE_ERROR_SEQUENCE);
+    TEST_ASSERT(firmware_update_in_progress());
+    TEST_ASSERT(firmware_update_received() == 100);
+
+    /* Too much data aborts */
+    TEST_ASSERT(firmware_update_write(100, &new_image[100], IMAGE_SIZE) ==
+                FIRMWARE_UPDATE_ERROR_SIZE);
+    TEST_ASSERT(!firmware_update_in_progress());
+    TEST_ASSERT(firmware_update_write(100, &new_image[100], 100) == FIRMWARE_UPDATE_ERROR_STATE);
+
+    TEST_PASS();
+}
+
+static int test_firmware_update_bad_patch(void)
+{
+    reset_slots();
+
+    hal_fw_slots_t slots;
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK);
+
+    /* Seek before the start of the running image */
+    size_t patch_len = patch_record(0, base_image, 16, 0, 0, -17);
+    firmware_update_header_t header = {FIRMWARE_UPDATE_DELTA, 1000, (uint32_t) patch_len, 1};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(stream_payload(patch, patch_len) == FIRMWARE_UPDATE_ERROR_PATCH);
+    TEST_ASSERT(!firmware_update_in_progress());
+
+    /* Diff running past the end of the slot */
+    put_le32(&patch[0], 16);
+    put_le32(&patch[4], 0);
+    put_le32(&patch[8], (uint32_t) slots.slot_size - 24);
+    put_le32(&patch[12], 16);
+    put_le32(&patch[16], 0);
+    put_le32(&patch[20], 0);
+    memset(&patch[24], 0, 16);
+    patch_len = 2 * FIRMWARE_UPDATE_CONTROL_SIZE + 16;
+    header.payload_size = (uint32_t) patch_len;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_write(0, patch, FIRMWARE_UPDATE_CONTROL_SIZE + 16) ==
+                FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_write(FIRMWARE_UPDATE_CONTROL_SIZE + 16, &patch[0], 12) ==
+                FIRMWARE_UPDATE_ERROR_PATCH);
+
+    /* Record producing more than the announced image */
+    patch_len = patch_record(0, base_image, 0, 0, 1001, 0);
+    header.payload_size = (uint32_t) patch_len;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(stream_payload(patch, patch_len) == FIRMWARE_UPDATE_ERROR_PATCH);
+
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK);
+    TEST_ASSERT(slots.boot == 0);
+
+    TEST_PASS();
+}
+
+static int test_firmware_update_rollback(void)
+{
+    reset_slots();
+    test_random(new_image, IMAGE_SIZE);
+
+    /* Running image is version 5 */
+    uint8_t digest[SHA256_DIGEST_SIZE] = {0};
+    uint8_t signature[FIRMWARE_UPDATE_SIGNATURE_SIZE] = {0};
+    uint32_t version = 0;
+    TEST_ASSERT(!firmware_update_running_version(&version));
+    TEST_ASSERT(boot_verify_image_commit(0, IMAGE_SIZE, 5, digest, signature) == BOOT_VERIFY_OK);
+    TEST_ASSERT(firmware_update_running_version(&version));
+    TEST_ASSERT(version == 5);
+
+    firmware_update_header_t header = {FIRMWARE_UPDATE_FULL, IMAGE_SIZE, IMAGE_SIZE, 4};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_ERROR_VERSION);
+    TEST_ASSERT(!firmware_update_in_progress());
+
+    /* The same version may be reinstalled */
+    header.version = 5;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    firmware_update_abort();
+
+    /* A newer version signed as an older one does not verify */
+    sign_image(6, new_image, IMAGE_SIZE, signature);
+    header.version = 7;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(stream_payload(new_image, IMAGE_SIZE) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_finish(signing_public, signature) ==
+                FIRMWARE_UPDATE_ERROR_SIGNATURE);
+
+    header.version = 6;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(stream_payload(new_image, IMAGE_SIZE) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(firmware_update_finish(signing_public, signature) == FIRMWARE_UPDATE_OK);
+    TEST_ASSERT(boot_verify_image_version(1, &version) == BOOT_VERIFY_OK);
+    TEST_ASSERT(version == 6);
+
+    TEST_PASS();
+}
+
+static int test_firmware_update_header(void)
+{
+    reset_slots();
+
+    hal_fw_slots_t slots;
+    TEST_ASSERT(hal_fw_get_slots(&slots) == HAL_OK);
+
+    firmware_update_header_t header = {FIRMWARE_UPDATE_FULL, 0, 0, 1};
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_ERROR_INVALID_PARAM);
+
+    header.image_size = 100;
+    header.payload_size = 99;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_ERROR_INVALID_PARAM);
+
+    header.type = (firmware_update_type_t) 0x7F;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_ERROR_INVALID_PARAM);
+
+    header.type = FIRMWARE_UPDATE_FULL;
+    header.image_size = (uint32_t) slots.slot_size + 1;
+    header.payload_size = header.image_size;
+    TEST_ASSERT(firmware_update_begin(&header) == FIRMWARE_UPDATE_ERROR_SIZE);
+    TEST_ASSERT(!firmware_update_in_progress());
+
+    TEST_PASS();
+}
+
+int main(void)
+{
+    int result = 0;
+
+    printf("Running firmware update tests...\n");
+
+    TEST_ASSERT(p256_generate_keypair(test_random, signing_private, signing_public) == P256_OK);
+
+    result |= test_firmware_update_full();
+    result |= test_firmware_update_delta();
+    result |= test_firmware_update_bad_signature();
+    result |= test_firmware_update_incomplete();
+    result |= test_firmware_update_sequence();
+    result |= test_firmware_update_bad_patch();
+    result |= test_firmware_update_rollback();
+    result |= test_firmware_update_header();
+
+    if (result == 0) {
+        printf("\nAll firmware update tests passed!\n");
+    } else {
+        printf("\nSome firmware update tests failed!\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file test_idle_scheduler.c
+ * @brief Unit tests for the idle-time background scheduler
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "idle_scheduler.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+/* Records the order in which tasks ran */
+static char run_log[16];
+static size_t run_log_len;
+
+typedef struct {
+    char tag;
+    int steps_left;
+} test_task_ctx_t;
+
+static idle_task_status_t test_step(void *context)
+{
+    test_task_ctx_t *ctx = (test_task_ctx_t *) context;
+
+    if (run_log_len < sizeof(run_log) - 1) {
+        run_log[run_log_len++] = ctx->tag;
+    }
+
+    return (--ctx->steps_left > 0) ? IDLE_TASK_MORE : IDLE_TASK_DONE;
+}
+
+static idle_task_status_t preempting_step(void *context)
+{
+    test_task_ctx_t *ctx = (test_task_ctx_t *) context;
+
+    if (run_log_len < sizeof(run_log) - 1) {
+        run_log[run_log_len++] = ctx->tag;
+    }
+
+    /* Simulate a request arriving while this task runs */
+    idle_sched_preempt();
+    return IDLE_TASK_MORE;
+}
+
+static void reset_log(void)
+{
+    memset(run_log, 0, sizeof(run_log));
+    run_log_len = 0;
+}
+
+/* Higher-priority tasks run first, on-demand tasks only when triggered */
+int test_idle_priority_order(void)
+{
+    test_task_ctx_t low = {'L', 1};
+    test_task_ctx_t high = {'H', 1};
+
+    idle_sched_init();
+    reset_log();
+
+    idle_task_config_t low_cfg = {"low", test_step, &low, IDLE_PRIORITY_LOW, 10, 0};
+    idle_task_config_t high_cfg = {"high", test_step, &high, IDLE_PRIORITY_HIGH, 10, 0};
+
+    int low_id = idle_sched_register(&low_cfg);
+    int high_id = idle_sched_register(&high_cfg);
+    TEST_ASSERT(low_id >= 0 && high_id >= 0);
+
+    /* Nothing triggered yet */
+    TEST_ASSERT(!idle_sched_has_pending());
+    idle_sched_run(1000);
+    TEST_ASSERT(run_log_len == 0);
+
+    idle_sched_trigger(low_id);
+    idle_sched_trigger(high_id);
+    idle_sched_run(1000);
+
+    TEST_ASSERT(strcmp(run_log, "HL") == 0);
+    TEST_ASSERT(!idle_sched_has_pending());
+
+    TEST_PASS();
+}
+
+/* Multi-step tasks are called until done */
+int test_idle_multi_step(void)
+{
+    test_task_ctx_t ctx = {'A', 3};
+
+    idle_sched_init();
+    reset_log();
+
+    idle_task_config_t cfg = {"multi", test_step, &ctx, IDLE_PRIORITY_NORMAL, 100, 0};
+    int id = idle_sched_register(&cfg);
+    idle_sched_trigger(id);
+    idle_sched_run(1000);
+
+    TEST_ASSERT(strcmp(run_log, "AAA") == 0);
+    TEST_ASSERT(!idle_sched_has_pending());
+
+    TEST_PASS();
+}
+
+/* A request arriving stops background work after the current step */
+int test_idle_preempt(void)
+{
+    test_task_ctx_t busy = {'P', 0};
+    test_task_ctx_t other = {'O', 1};
+
+    idle_sched_init();
+    reset_log();
+
+    idle_task_config_t busy_cfg = {"busy", preempting_step, &busy, IDLE_PRIORITY_HIGH, 100, 0};
+    idle_task_config_t other_cfg = {"other", test_step, &other, IDLE_PRIORITY_LOW, 100, 0};
+
+    idle_sched_trigger(idle_sched_register(&busy_cfg));
+    idle_sched_trigger(idle_sched_register(&other_cfg));
+    idle_sched_run(1000);
+
+    TEST_ASSERT(strcmp(run_log, "P") == 0);
+    TEST_ASSERT(idle_sched_has_pending());
+
+    TEST_PASS();
+}
+
+/* A task whose budget does not fit in the window waits for a longer one */
+int test_idle_budget_exceeds_window(void)
+{
+    test_task_ctx_t slow = {'S', 1};
+    test_task_ctx_t quick = {'Q', 1};
+
+    idle_sched_init();
+    reset_log();
+
+    idle_task_config_t slow_cfg = {"slow", test_step, &slow, IDLE_PRIORITY_HIGH, 100, 0};
+    idle_task_config_t quick_cfg = {"quick", test_step, &quick, IDLE_PRIORITY_LOW, 5, 0};
+
+    idle_sched_trigger(idle_sched_register(&slow_cfg));
+    idle_sched_trigger(idle_sched_register(&quick_cfg));
+    idle_sched_run(10);
+
+    TEST_ASSERT(strcmp(run_log, "Q") == 0);
+    TEST_ASSERT(idle_sched_has_pending());
+
+    idle_sched_run(1000);
+    TEST_ASSERT(strcmp(run_log, "QS") == 0);
+    TEST_ASSERT(!idle_sched_has_pending());
+
+    TEST_PASS();
+}
+
+/* Invalid registrations are rejected */
+int test_idle_register_invalid(void)
+{
+    idle_sched_init();
+
+    idle_task_config_t no_step = {"none", NULL, NULL, IDLE_PRIORITY_LOW, 10, 0};
+    idle_task_config_t no_budget = {"zero", test_step, NULL, IDLE_PRIORITY_LOW, 0, 0};
+
+    TEST_ASSERT(idle_sched_register(NULL) == IDLE_SCHED_ERROR_INVALID_PARAM);
+    TEST_ASSERT(idle_sched_register(&no_step) == IDLE_SCHED_ERROR_INVALID_PARAM);
+    TEST_ASSERT(idle_sched_register(&no_budget) == IDLE_SCHED_ERROR_INVALID_PARAM);
+    TEST_ASSERT(idle_sched_trigger(0) == IDLE_SCHED_ERROR_INVALID_PARAM);
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main(void)
+{
+    int result = 0;
+
+    printf("Running idle scheduler tests...\n");
+
+    result |= test_idle_priority_order();
+    result |= test_idle_multi_step();
+    result |= test_idle_preempt();
+    result |= test_idle_budget_exceeds_window();
+    result |= test_idle_register_invalid();
+
+    if (result == 0) {
+        printf("\nAll idle scheduler tests passed!\n");
+    } else {
+        printf("\nSome idle scheduler tests failed!\n");
+    }
+
+    return result;
+}
@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "hal.h"
 #include "led_patterns.h"
 
 /* Test helper macros */
@@ -82,6 +83,56 @@ int test_ble_pattern_transitions(void)
     TEST_PASS();
 }
 
+/* Provided by mock_hal.c */
+extern hal_led_state_t mock_get_led_state(void);
+extern void mock_run_led_ticks(uint32_t count);
+
+/* Posting a pattern never touches the LED; the timer tick applies it */
+int test_pattern_applied_by_tick(void)
+{
+    led_patterns_init();
+    mock_run_led_ticks(1);
+
+    led_set_pattern(LED_PATTERN_PROCESSING);
+    led_set_pattern(LED_PATTERN_USER_PRESENCE);
+    TEST_ASSERT(led_get_current_pattern() == LED_PATTERN_USER_PRESENCE);
+
+    /* 50 ms on, 50 ms off */
+    mock_run_led_ticks(1);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_ON);
+    mock_run_led_ticks(50 / LED_PATTERN_TICK_MS);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_OFF);
+    mock_run_led_ticks(50 / LED_PATTERN_TICK_MS);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_ON);
+
+    TEST_PASS();
+}
+
+/* A finite pattern falls back to the pattern posted before it */
+int test_finite_pattern_falls_back(void)
+{
+    led_patterns_init();
+
+    led_set_pattern(LED_PATTERN_BLE_ADVERTISING);
+    led_set_pattern(LED_PATTERN_ERROR);
+    mock_run_led_ticks(1);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_ON);
+
+    /* Three 100/100 ms blinks: off in the last gap... */
+    mock_run_led_ticks(550 / LED_PATTERN_TICK_MS);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_OFF);
+
+    /* ...then advertising again, which starts with its 500 ms on phase */
+    mock_run_led_ticks(50 / LED_PATTERN_TICK_MS);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_ON);
+    mock_run_led_ticks(400 / LED_PATTERN_TICK_MS);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_ON);
+    mock_run_led_ticks(100 / LED_PATTERN_TICK_MS);
+    TEST_ASSERT(mock_get_led_state() == HAL_LED_OFF);
+
+    TEST_PASS();
+}
+
 /* Main test runner */
 int main(int argc, char *argv[])
 {
@@ -91,6 +142,8 @@ int main(int argc, char *argv[])
 
     result |= test_ble_led_patterns_defined();
     result |= test_ble_pattern_transitions();
+    result |= test_pattern_applied_by_tick();
+    result |= test_finite_pattern_falls_back();
 
     if (result == 0) {
         printf("\nAll LED pattern tests passed!\n");
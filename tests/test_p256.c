@@ -0,0 +1,530 @@
+/**
+ * @file test_p256.c
+ * @brief Unit tests and benchmark for the P-256 backend
+ *
+ * The ECDSA and ECDH tables follow the Wycheproof vector layout and cover
+ * its edge-case categories: r and s out of range or not reduced, s
+ * replaced by n - s, hashes above n, x(R) >= n, verification sums that
+ * double or reach infinity, off-curve and unreduced public keys, and
+ * boundary private keys. Every expected result was cross-checked against
+ * OpenSSL.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "p256.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+#define ROUNDTRIP_KEYS 16
+#define BENCH_ROUNDS 50
+
+typedef struct {
+    const char *comment;
+    const char *public_key;
+    const char *hash;
+    const char *signature;
+    int result;
+} ecdsa_vector_t;
+
+typedef struct {
+    const char *comment;
+    const char *private_key;
+    const char *public_key;
+    int result;
+    const char *shared_secret;
+} ecdh_vector_t;
+
+/* ECDSA P-256 with SHA-256 */
+static const ecdsa_vector_t ecdsa_vectors[] = {
+    {"valid",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "2353c76a40acc496661515e6dc553fbc956a5634ed6932ec4291640b17a32ab2"
+     "2e4dc3ade9f20e8dd7df6142cef957404017d450f5ce5a854c0a8941ec2975b4",
+     P256_OK},
+    {"s replaced by n - s",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "2353c76a40acc496661515e6dc553fbc956a5634ed6932ec4291640b17a32ab2"
+     "d1b23c51160df17328209ebd3106a8bf7ccf265cb14943ffa7af41811039af9d",
+     P256_OK},
+    {"hash modified",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2848",
+     "2353c76a40acc496661515e6dc553fbc956a5634ed6932ec4291640b17a32ab2"
+     "2e4dc3ade9f20e8dd7df6142cef957404017d450f5ce5a854c0a8941ec2975b4",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"r = 0",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "0000000000000000000000000000000000000000000000000000000000000000"
+     "2e4dc3ade9f20e8dd7df6142cef957404017d450f5ce5a854c0a8941ec2975b4",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"s = 0",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "2353c76a40acc496661515e6dc553fbc956a5634ed6932ec4291640b17a32ab2"
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"r = n",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551"
+     "2e4dc3ade9f20e8dd7df6142cef957404017d450f5ce5a854c0a8941ec2975b4",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"s = n",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "2353c76a40acc496661515e6dc553fbc956a5634ed6932ec4291640b17a32ab2"
+     "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"r = p",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "ffffffff00000001000000000000000000000000ffffffffffffffffffffffff"
+     "2e4dc3ade9f20e8dd7df6142cef957404017d450f5ce5a854c0a8941ec2975b4",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"r = s = 1",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "0000000000000000000000000000000000000000000000000000000000000001"
+     "0000000000000000000000000000000000000000000000000000000000000001",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"hash above n",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+     "9651a0cc3cbd123af9e5f4c370520eb33322b948594c19aca2b44c9d12044948"
+     "5f56663eb546ff8d4d7ed84dbb1c81236869929a03e5f4c84666e914b5cfa0b4",
+     P256_OK},
+    {"hash zero",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "2a7234faeb4f1de85ff31d9d172a1e5e51e30d9def7071aaf352abd6bcdd17e7"
+     "106321036a0303bdb831e8cfe97363b53ca5f5eb86a5175883ddbda01cde6c35",
+     P256_OK},
+    {"public key off the curve",
+     "400a8e3676a656b2753d090ecfd1baccf1bfbe314a2179a5da1d867110a0e72f"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1199",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "2353c76a40acc496661515e6dc553fbc956a5634ed6932ec4291640b17a32ab2"
+     "2e4dc3ade9f20e8dd7df6142cef957404017d450f5ce5a854c0a8941ec2975b4",
+     P256_ERROR_INVALID_POINT},
+    {"public key x not reduced",
+     "ffffffff00000001000000000000000000000000ffffffffffffffffffffffff"
+     "28510df72b9828a3b7c9b1c4fc1854958ff99ce02dbfef9d76e8e27a66bc1198",
+     "557e7aac4a340b3eaef8a0c95f49b2d87a071264d7f4a7ecbce5d6057acc2849",
+     "2353c76a40acc496661515e6dc553fbc956a5634ed6932ec4291640b17a32ab2"
+     "2e4dc3ade9f20e8dd7df6142cef957404017d450f5ce5a854c0a8941ec2975b4",
+     P256_ERROR_INVALID_POINT},
+    {"x(R) >= n",
+     "aee093c2ee6c1e0c1ccaf9d1639a8af5421a7f81068008a555a9b54f1947aacd"
+     "80febe872f61a016c89b00562dde5f6be19ad6f6c1b5c8c7e5ba754ddc2a4a44",
+     "1cf6c99fac348ff078b0b7d2701906fea2fd27c412228a2c06a6182b5e3d22f2",
+     "0000000000000000000000000000000002d17a25930875550d0abfa9cbda00f7"
+     "45b8ab4dd0a7f958be36172fe363586f043d9c170aa5c477c613eb198ed26f48",
+     P256_OK},
+    {"x(R) >= n, r not reduced",
+     "aee093c2ee6c1e0c1ccaf9d1639a8af5421a7f81068008a555a9b54f1947aacd"
+     "80febe872f61a016c89b00562dde5f6be19ad6f6c1b5c8c7e5ba754ddc2a4a44",
+     "1cf6c99fac348ff078b0b7d2701906fea2fd27c412228a2c06a6182b5e3d22f2",
+     "ffffffff00000000ffffffffffffffffbfb874d33a2013da00c48a6cc83d2648"
+     "45b8ab4dd0a7f958be36172fe363586f043d9c170aa5c477c613eb198ed26f48",
+     P256_ERROR_INVALID_SIGNATURE},
+    {"u1 G = u2 Q (doubling)",
+     "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296"
+     "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5",
+     "840482a240aae94210f7de288ebf0e57dabee3b28aa50c4d059c0d3e34910767",
+     "840482a240aae94210f7de288ebf0e57dabee3b28aa50c4d059c0d3e34910767"
+     "3f3645000784068ec32fab9b2c1f51c48c58e40c04ff7c67e4086c25afb14f23",
+     P256_OK},
+    {"u1 G + u2 Q = infinity",
+     "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296"
+     "b01cbd1c01e58065711814b583f061e9d431cca994cea1313449bf97c840ae0a",
+     "840482a240aae94210f7de288ebf0e57dabee3b28aa50c4d059c0d3e34910767",
+     "840482a240aae94210f7de288ebf0e57dabee3b28aa50c4d059c0d3e34910767"
+     "3f3645000784068ec32fab9b2c1f51c48c58e40c04ff7c67e4086c25afb14f23",
+     P256_ERROR_INVALID_SIGNATURE},
+};
+
+/* ECDH P-256 */
+static const ecdh_vector_t ecdh_vectors[] = {
+    {"normal",
+     "9188120f3c0532921b77b59adce31c632d20f0d530111f03893977bd697fd9c3",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818a",
+     P256_OK,
+     "f6ec054ae3f9a1fd427b7e7fc23bd8e51df4625ba42e35d5b67d67cc43d83726"},
+    {"peer is G",
+     "9188120f3c0532921b77b59adce31c632d20f0d530111f03893977bd697fd9c3",
+     "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296"
+     "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5",
+     P256_OK,
+     "5d8be152b8425ceedac87df2eccc61026d6c99a52acc6a86f2b921dea7e31aa7"},
+    {"private key 1",
+     "0000000000000000000000000000000000000000000000000000000000000001",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818a",
+     P256_OK,
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"},
+    {"private key n - 1",
+     "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632550",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818a",
+     P256_OK,
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"},
+    {"private key 2^255",
+     "8000000000000000000000000000000000000000000000000000000000000000",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818a",
+     P256_OK,
+     "59beab6031c7f5128466968a5aa827bcc34e5638e46a1a21a2c9de48a355abd2"},
+    {"private key 0",
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818a",
+     P256_ERROR_INVALID_KEY,
+     NULL},
+    {"private key n",
+     "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818a",
+     P256_ERROR_INVALID_KEY,
+     NULL},
+    {"peer off the curve",
+     "9188120f3c0532921b77b59adce31c632d20f0d530111f03893977bd697fd9c3",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818b",
+     P256_ERROR_INVALID_POINT,
+     NULL},
+    {"peer (0, 0)",
+     "9188120f3c0532921b77b59adce31c632d20f0d530111f03893977bd697fd9c3",
+     "0000000000000000000000000000000000000000000000000000000000000000"
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     P256_ERROR_INVALID_POINT,
+     NULL},
+    {"peer x = p",
+     "9188120f3c0532921b77b59adce31c632d20f0d530111f03893977bd697fd9c3",
+     "ffffffff00000001000000000000000000000000ffffffffffffffffffffffff"
+     "c0294dc7e12d620211fb5633a94857fd5f50c77788dceafcf82f59503399818a",
+     P256_ERROR_INVALID_POINT,
+     NULL},
+    {"peer y = p",
+     "9188120f3c0532921b77b59adce31c632d20f0d530111f03893977bd697fd9c3",
+     "6d4485d16349305f6810ae3037c6bd1822b9908417368bb695e044e8c2bbe6c2"
+     "ffffffff00000001000000000000000000000000ffffffffffffffffffffffff",
+     P256_ERROR_INVALID_POINT,
+     NULL},
+};
+
+static const char generator[] =
+    "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296"
+    "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5";
+
+static const char order[] = "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551";
+
+static void from_hex(const char *hex, uint8_t *out, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte = 0;
+        sscanf(&hex[2 * i], "%2x", &byte);
+        out[i] = (uint8_t) byte;
+    }
+}
+
+/* Random source for the tests: xorshift, or queued fixed values */
+static uint8_t queued[2][P256_SCALAR_SIZE];
+static int queued_count;
+static int queued_next;
+
+static int test_random(uint8_t *buffer, size_t len)
+{
+    static uint32_t x = 0x9e3779b9;
+
+    if (queued_count > 0) {
+        if (queued_next >= queued_count || len != P256_SCALAR_SIZE) {
+            return -1;
+        }
+        memcpy(buffer, queued[queued_next++], len);
+        return 0;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buffer[i] = (uint8_t) x;
+    }
+    return 0;
+}
+
+static int test_p256_public_key(void)
+{
+    uint8_t private_key[P256_SCALAR_SIZE] = {0};
+    uint8_t public_key[P256_POINT_SIZE];
+    uint8_t expected[P256_POINT_SIZE];
+
+    from_hex(generator, expected, sizeof(expected));
+
+    /* 1 * G */
+    private_key[31] = 1;
+    TEST_ASSERT(p256_public_key(private_key, public_key) == P256_OK);
+    TEST_ASSERT(memcmp(public_key, expected, sizeof(expected)) == 0);
+
+    /* (n - 1) * G = -G: same x */
+    from_hex(order, private_key, sizeof(private_key));
+    private_key[31]--;
+    TEST_ASSERT(p256_public_key(private_key, public_key) == P256_OK);
+    TEST_ASSERT(memcmp(public_key, expected, 32) == 0);
+    TEST_ASSERT(memcmp(&public_key[32], &expected[32], 32) != 0);
+    TEST_ASSERT(p256_check_public_key(public_key) == P256_OK);
+
+    /* 0 and n are not private keys */
+    private_key[31]++;
+    TEST_ASSERT(p256_public_key(private_key, public_key) == P256_ERROR_INVALID_KEY);
+    memset(private_key, 0, sizeof(private_key));
+    TEST_ASSERT(p256_check_private_key(private_key) == P256_ERROR_INVALID_KEY);
+
+    TEST_PASS();
+}
+
+static int test_p256_ecdsa_vectors(void)
+{
+    for (size_t i = 0; i < sizeof(ecdsa_vectors) / sizeof(ecdsa_vectors[0]); i++) {
+        const ecdsa_vector_t *v = &ecdsa_vectors[i];
+        uint8_t public_key[P256_POINT_SIZE];
+        uint8_t hash[32];
+        uint8_t signature[P256_SIGNATURE_SIZE];
+
+        from_hex(v->public_key, public_key, sizeof(public_key));
+        from_hex(v->hash, hash, sizeof(hash));
+        from_hex(v->signature, signature, sizeof(signature));
+
+        int result = p256_ecdsa_verify(public_key, hash, signature);
+        if (result != v->result) {
+            printf("  ECDSA vector %zu (%s): got %d\n", i, v->comment, result);
+        }
+        TEST_ASSERT(result == v->result);
+    }
+
+    TEST_PASS();
+}
+
+static int test_p256_ecdh_vectors(void)
+{
+    for (size_t i = 0; i < sizeof(ecdh_vectors) / sizeof(ecdh_vectors[0]); i++) {
+        const ecdh_vector_t *v = &ecdh_vectors[i];
+        uint8_t private_key[P256_SCALAR_SIZE];
+        uint8_t public_key[P256_POINT_SIZE];
+        uint8_t secret[32];
+        uint8_t expected[32];
+
+        from_hex(v->private_key, private_key, sizeof(private_key));
+        from_hex(v->public_key, public_key, sizeof(public_key));
+
+        int result = p256_ecdh(private_key, public_key, secret);
+        if (result != v->result) {
+            printf("  ECDH vector %zu (%s): got %d\n", i, v->comment, result);
+        }
+        TEST_ASSERT(result == v->result);
+
+        if (v->shared_secret != NULL) {
+            from_hex(v->shared_secret, expected, sizeof(expected));
+            TEST_ASSERT(memcmp(secret, expected, sizeof(expected)) == 0);
+        }
+    }
+
+    TEST_PASS();
+}
+
+/* Signature under a known nonce, after one out-of-range draw is rejected */
+static int test_p256_sign_known_nonce(void)
+{
+    static const char private_key[] =
+        "14d7b40c9efd98c6cd014cb5e83360a447285a9888293f2b8a9f89891076c043";
+    static const char hash[] =
+        "2e5f461f3d6e9850cb370aebfa4fc28713a5c61573eb00860fe1b1e6be3c9c9b";
+    static const char nonce[] =
+        "143e0bee5d2cda34329f498def61c97b81b8a99426db6688953b04c5e8f282c9";
+    static const char signature[] =
+        "65679b402a45df8a7e2d97e13209e978f0a915bd6aa713cd6c80dcc290ede94f"
+        "7c3dde145a69d90e68c952c191765a031e4e68e934c661ab903d90fc8dd5a72b";
+    uint8_t d[P256_SCALAR_SIZE];
+    uint8_t h[32];
+    uint8_t expected[P256_SIGNATURE_SIZE];
+    uint8_t sig[P256_SIGNATURE_SIZE];
+
+    from_hex(private_key, d, sizeof(d));
+    from_hex(hash, h, sizeof(h));
+    from_hex(signature, expected, sizeof(expected));
+
+    from_hex(order, queued[0], P256_SCALAR_SIZE);
+    from_hex(nonce, queued[1], P256_SCALAR_SIZE);
+    queued_count = 2;
+    queued_next = 0;
+    TEST_ASSERT(p256_ecdsa_sign(d, h, test_random, sig) == P256_OK);
+    TEST_ASSERT(memcmp(sig, expected, sizeof(expected)) == 0);
+
+    /* A failing random source is reported, not papered over */
+    queued_next = queued_count;
+    TEST_ASSERT(p256_ecdsa_sign(d, h, test_random, sig) == P256_ERROR_RANDOM);
+    queued_count = 0;
+
+    TEST_PASS();
+}
+
+static int test_p256_roundtrip(void)
+{
+    for (int i = 0; i < ROUNDTRIP_KEYS; i++) {
+        uint8_t d1[P256_SCALAR_SIZE], q1[P256_POINT_SIZE];
+        uint8_t d2[P256_SCALAR_SIZE], q2[P256_POINT_SIZE];
+        uint8_t s1[32], s2[32];
+        uint8_t hash[32];
+        uint8_t sig[P256_SIGNATURE_SIZE];
+
+        TEST_ASSERT(p256_generate_keypair(test_random, d1, q1) == P256_OK);
+        TEST_ASSERT(p256_generate_keypair(test_random, d2, q2) == P256_OK);
+        TEST_ASSERT(p256_check_public_key(q1) == P256_OK);
+
+        TEST_ASSERT(p256_ecdh(d1, q2, s1) == P256_OK);
+        TEST_ASSERT(p256_ecdh(d2, q1, s2) == P256_OK);
+        TEST_ASSERT(memcmp(s1, s2, sizeof(s1)) == 0);
+
+        test_random(hash, sizeof(hash));
+        TEST_ASSERT(p256_ecdsa_sign(d1, hash, test_random, sig) == P256_OK);
+        TEST_ASSERT(p256_ecdsa_verify(q1, hash, sig) == P256_OK);
+        TEST_ASSERT(p256_ecdsa_verify(q2, hash, sig) == P256_ERROR_INVALID_SIGNATURE);
+    }
+
+    TEST_PASS();
+}
+
+static int test_p256_keygen_steps(void)
+{
+    uint8_t d[P256_SCALAR_SIZE], q[P256_POINT_SIZE];
+    uint8_t expected[P256_POINT_SIZE];
+    p256_keygen_t keygen;
+
+    TEST_ASSERT(p256_keygen_start(&keygen, test_random) == P256_OK);
+
+    /* 52 comb columns in slices, then the inversion on its own */
+    int steps = 1;
+    int ret;
+    while ((ret = p256_keygen_step(&keygen, d, q)) == P256_CONTINUE) {
+        steps++;
+    }
+    TEST_ASSERT(ret == P256_OK);
+    int column_steps = (52 + P256_KEYGEN_COLUMNS_PER_STEP - 1) / P256_KEYGEN_COLUMNS_PER_STEP;
+    TEST_ASSERT(steps == column_steps + 1);
+
+    TEST_ASSERT(p256_public_key(d, expected) == P256_OK);
+    TEST_ASSERT(memcmp(q, expected, sizeof(q)) == 0);
+
+    /* A failing random source leaves nothing to step */
+    queued_count = 1;
+    queued_next = 1;
+    TEST_ASSERT(p256_keygen_start(&keygen, test_random) == P256_ERROR_RANDOM);
+    queued_count = 0;
+
+    TEST_PASS();
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static int bench_p256(void)
+{
+    uint8_t d[P256_SCALAR_SIZE], q[P256_POINT_SIZE], secret[32];
+    uint8_t hash[32] = {0};
+    uint8_t sig[P256_SIGNATURE_SIZE];
+    double start;
+
+    TEST_ASSERT(p256_generate_keypair(test_random, d, q) == P256_OK);
+    printf("P-256 timings (%d rounds):\n", BENCH_ROUNDS);
+
+    start = now_seconds();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        p256_public_key(d, q);
+    }
+    printf("  public key %8.3f ms\n", (now_seconds() - start) * 1000.0 / BENCH_ROUNDS);
+
+    start = now_seconds();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        p256_ecdsa_sign(d, hash, test_random, sig);
+    }
+    printf("  sign       %8.3f ms\n", (now_seconds() - start) * 1000.0 / BENCH_ROUNDS);
+
+    start = now_seconds();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        TEST_ASSERT(p256_ecdsa_verify(q, hash, sig) == P256_OK);
+    }
+    printf("  verify     %8.3f ms\n", (now_seconds() - start) * 1000.0 / BENCH_ROUNDS);
+
+    start = now_seconds();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        p256_ecdh(d, q, secret);
+    }
+    printf("  ecdh       %8.3f ms\n", (now_seconds() - start) * 1000.0 / BENCH_ROUNDS);
+
+    return 0;
+}
+
+/* Main test runner */
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    printf("Running P-256 tests...\n");
+
+    result |= test_p256_public_key();
+    result |= test_p256_ecdsa_vectors();
+    result |= test_p256_ecdh_vectors();
+    result |= test_p256_sign_known_nonce();
+    result |= test_p256_roundtrip();
+    result |= test_p256_keygen_steps();
+
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        result |= bench_p256();
+    }
+
+    if (result == 0) {
+        printf("\nAll P-256 tests passed!\n");
+    } else {
+        printf("\nSome P-256 tests failed!\n");
+    }
+
+    return result;
+}
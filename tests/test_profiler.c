@@ -0,0 +1,119 @@
+/**
+ * @file test_profiler.c
+ * @brief Unit tests for the function cycle profiler
+ *
+ * Build this file with -finstrument-functions and -DCONFIG_ENABLE_PROFILE=1
+ * so the test functions below are profiled; profiler.c and the HAL must be
+ * built without -finstrument-functions.
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "profiler.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+static volatile uint32_t sink;
+
+static __attribute__((noinline)) void profiled_leaf(void)
+{
+    for (uint32_t i = 0; i < 200000; i++) {
+        sink += i;
+    }
+}
+
+static __attribute__((noinline)) void profiled_parent(void)
+{
+    profiled_leaf();
+    for (uint32_t i = 0; i < 100000; i++) {
+        sink += i;
+    }
+    profiled_leaf();
+}
+
+static __attribute__((no_instrument_function)) const profiler_entry_t *find_entry(
+    const profiler_entry_t *entries, size_t count, void (*function)(void))
+{
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i].function == (uintptr_t) function) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static int test_profiler_inclusive_exclusive(void)
+{
+    profiler_entry_t entries[CONFIG_PROFILE_FUNCTIONS];
+    size_t cursor = 0;
+
+    profiler_clear();
+    profiled_parent();
+
+    size_t count = profiler_read(&cursor, entries, CONFIG_PROFILE_FUNCTIONS);
+    TEST_ASSERT(cursor == profiler_slot_count());
+
+    const profiler_entry_t *parent = find_entry(entries, count, profiled_parent);
+    const profiler_entry_t *leaf = find_entry(entries, count, profiled_leaf);
+    TEST_ASSERT(parent != NULL && leaf != NULL);
+    TEST_ASSERT(parent->calls == 1);
+    TEST_ASSERT(leaf->calls == 2);
+
+    /* A leaf's own time is all of its time; the parent's leaves out the leaf */
+    TEST_ASSERT(leaf->exclusive == leaf->inclusive);
+    TEST_ASSERT(parent->inclusive > leaf->inclusive);
+    TEST_ASSERT(parent->exclusive == parent->inclusive - leaf->inclusive);
+    TEST_ASSERT(profiler_dropped() == 0);
+
+    TEST_PASS();
+}
+
+static int test_profiler_clear(void)
+{
+    profiler_entry_t entries[4];
+    size_t cursor = 0;
+
+    profiled_leaf();
+    profiler_clear();
+
+    /* Only calls that complete after the clear are counted */
+    TEST_ASSERT(profiler_read(&cursor, entries, 4) == 0);
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main(void)
+{
+    int result = 0;
+
+    printf("Running profiler tests...\n");
+
+    result |= test_profiler_inclusive_exclusive();
+    result |= test_profiler_clear();
+
+    if (result == 0) {
+        printf("\nAll profiler tests passed!\n");
+    } else {
+        printf("\nSome profiler tests failed!\n");
+    }
+
+    return result;
+}
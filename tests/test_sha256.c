@@ -0,0 +1,221 @@
+/**
+ * @file test_sha256.c
+ * @brief Unit tests and benchmark for the SHA-256 kernel
+ *
+ * Checks every backend the CPU supports against the FIPS 180-4 examples and
+ * against each other on random lengths and split points. Built with
+ * USE_MBEDTLS (and linked against mbedcrypto), the backends are also
+ * compared bit for bit and benchmarked against mbedtls_sha256().
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sha256.h"
+
+#ifdef USE_MBEDTLS
+#include "mbedtls/sha256.h"
+#endif
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+#define RANDOM_MAX_LEN 1024
+#define RANDOM_ROUNDS 2000
+#define BENCH_BYTES (1024 * 1024)
+#define BENCH_ROUNDS 32
+
+typedef struct {
+    const char *message;
+    size_t repeat;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+} sha256_vector_t;
+
+/* FIPS 180-4 examples */
+static const sha256_vector_t vectors[] = {
+    {"", 1, {0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4,
+             0xc8, 0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b,
+             0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55}},
+    {"abc", 1, {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+                0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+                0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad}},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+     1,
+     {0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26,
+      0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff,
+      0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1}},
+    {"a", 1000000, {0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1, 0xc7,
+                    0xe2, 0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97,
+                    0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0}},
+};
+
+static uint8_t bench_buffer[BENCH_BYTES];
+
+static uint32_t test_rand(void)
+{
+    static uint32_t x = 0x12345678;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static int test_sha256_vectors(void)
+{
+    for (int backend = 0; backend < SHA256_BACKEND_COUNT; backend++) {
+        if (sha256_set_backend((sha256_backend_t) backend) != SHA256_OK) {
+            continue;
+        }
+
+        for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+            const uint8_t *message = (const uint8_t *) vectors[v].message;
+            size_t len = strlen(vectors[v].message);
+            uint8_t digest[SHA256_DIGEST_SIZE];
+            sha256_ctx_t ctx;
+
+            sha256_init(&ctx);
+            for (size_t i = 0; i < vectors[v].repeat; i++) {
+                sha256_update(&ctx, message, len);
+            }
+            sha256_final(&ctx, digest);
+            TEST_ASSERT(memcmp(digest, vectors[v].digest, sizeof(digest)) == 0);
+
+            if (vectors[v].repeat == 1) {
+                sha256(message, len, digest);
+                TEST_ASSERT(memcmp(digest, vectors[v].digest, sizeof(digest)) == 0);
+            }
+        }
+    }
+
+    TEST_ASSERT(sha256_set_backend(SHA256_BACKEND_GENERIC) == SHA256_OK);
+    TEST_ASSERT(sha256_set_backend(SHA256_BACKEND_COUNT) == SHA256_ERROR_NOT_SUPPORTED);
+
+    TEST_PASS();
+}
+
+static int test_sha256_backends_agree(void)
+{
+    static uint8_t message[RANDOM_MAX_LEN];
+
+    for (int round = 0; round < RANDOM_ROUNDS; round++) {
+        size_t len = test_rand() % (RANDOM_MAX_LEN + 1);
+        size_t split = (len > 0) ? test_rand() % (len + 1) : 0;
+        uint8_t expected[SHA256_DIGEST_SIZE];
+
+        for (size_t i = 0; i < len; i++) {
+            message[i] = (uint8_t) test_rand();
+        }
+
+#ifdef USE_MBEDTLS
+        TEST_ASSERT(mbedtls_sha256(message, len, expected, 0) == 0);
+#else
+        sha256_set_backend(SHA256_BACKEND_GENERIC);
+        sha256(message, len, expected);
+#endif
+
+        for (int backend = 0; backend < SHA256_BACKEND_COUNT; backend++) {
+            if (sha256_set_backend((sha256_backend_t) backend) != SHA256_OK) {
+                continue;
+            }
+
+            /* Two pieces, so partial blocks are carried between updates */
+            uint8_t digest[SHA256_DIGEST_SIZE];
+            sha256_ctx_t ctx;
+            sha256_init(&ctx);
+            sha256_update(&ctx, message, split);
+            sha256_update(&ctx, message + split, len - split);
+            sha256_final(&ctx, digest);
+            TEST_ASSERT(memcmp(digest, expected, sizeof(digest)) == 0);
+        }
+    }
+
+    sha256_select_backend();
+    TEST_PASS();
+}
+
+static void bench_report(const char *name, double seconds)
+{
+    double megabytes = (double) BENCH_BYTES * BENCH_ROUNDS / (1024.0 * 1024.0);
+    printf("  %-10s %8.1f MiB/s\n", name, megabytes / seconds);
+}
+
+static int bench_sha256(void)
+{
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    for (size_t i = 0; i < sizeof(bench_buffer); i++) {
+        bench_buffer[i] = (uint8_t) test_rand();
+    }
+
+    printf("SHA-256 throughput (%d x %d KiB):\n", BENCH_ROUNDS, BENCH_BYTES / 1024);
+
+    for (int backend = 0; backend < SHA256_BACKEND_COUNT; backend++) {
+        if (sha256_set_backend((sha256_backend_t) backend) != SHA256_OK) {
+            continue;
+        }
+
+        double start = now_seconds();
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+            sha256(bench_buffer, sizeof(bench_buffer), digest);
+        }
+        bench_report(sha256_backend_name((sha256_backend_t) backend), now_seconds() - start);
+    }
+
+#ifdef USE_MBEDTLS
+    double start = now_seconds();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        TEST_ASSERT(mbedtls_sha256(bench_buffer, sizeof(bench_buffer), digest, 0) == 0);
+    }
+    bench_report("mbedtls", now_seconds() - start);
+#endif
+
+    printf("Selected backend: %s\n", sha256_backend_name(sha256_select_backend()));
+    return 0;
+}
+
+/* Main test runner */
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    printf("Running SHA-256 tests...\n");
+
+    result |= test_sha256_vectors();
+    result |= test_sha256_backends_agree();
+
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        result |= bench_sha256();
+    }
+
+    if (result == 0) {
+        printf("\nAll SHA-256 tests passed!\n");
+    } else {
+        printf("\nSome SHA-256 tests failed!\n");
+    }
+
+    return result;
+}
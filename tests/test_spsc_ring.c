@@ -0,0 +1,163 @@
+/**
+ * @file test_spsc_ring.c
+ * @brief Unit tests for the SPSC ring
+ *
+ * The cross-core test runs the consumer on the host HAL's emulated second
+ * core (a thread started by hal_core_launch()).
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal.h"
+#include "spsc_ring.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+#define CROSS_CORE_MESSAGES 50000
+#define CROSS_CORE_DEPTH 8
+
+typedef struct {
+    uint32_t sequence;
+    uint8_t payload[60];
+} test_msg_t;
+
+static int test_ring_fifo(void)
+{
+    uint32_t storage[4];
+    spsc_ring_t ring;
+
+    TEST_ASSERT(spsc_ring_init(&ring, storage, sizeof(uint32_t), 3) ==
+                SPSC_RING_ERROR_INVALID_PARAM);
+    TEST_ASSERT(spsc_ring_init(&ring, NULL, sizeof(uint32_t), 4) ==
+                SPSC_RING_ERROR_INVALID_PARAM);
+    TEST_ASSERT(spsc_ring_init(&ring, storage, sizeof(uint32_t), 4) == SPSC_RING_OK);
+
+    TEST_ASSERT(spsc_ring_is_empty(&ring));
+    TEST_ASSERT(spsc_ring_peek(&ring) == NULL);
+
+    /* Fill, then wrap around twice */
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+    for (int round = 0; round < 3; round++) {
+        uint32_t *slot;
+        while ((slot = spsc_ring_reserve(&ring)) != NULL) {
+            *slot = next_in++;
+            spsc_ring_commit(&ring);
+        }
+        TEST_ASSERT(next_in - next_out == 4);
+
+        /* Drain all but one, so the indices end up unaligned */
+        for (int i = 0; i < 3; i++) {
+            uint32_t *value = spsc_ring_peek(&ring);
+            TEST_ASSERT(value != NULL && *value == next_out);
+            spsc_ring_release(&ring);
+            next_out++;
+        }
+    }
+
+    uint32_t *value = spsc_ring_peek(&ring);
+    TEST_ASSERT(value != NULL && *value == next_out);
+    spsc_ring_release(&ring);
+    TEST_ASSERT(spsc_ring_is_empty(&ring));
+
+    TEST_PASS();
+}
+
+static test_msg_t cross_core_storage[CROSS_CORE_DEPTH];
+static spsc_ring_t cross_core_ring;
+static atomic_uint cross_core_received;
+static atomic_bool cross_core_ordered;
+
+static void cross_core_consumer(void)
+{
+    uint32_t expected = 0;
+    bool ordered = true;
+
+    while (expected < CROSS_CORE_MESSAGES) {
+        const test_msg_t *msg = spsc_ring_peek(&cross_core_ring);
+        if (msg == NULL) {
+            hal_core_wait(1);
+            continue;
+        }
+
+        /* A torn slot would show up as a payload that does not match */
+        if (msg->sequence != expected || msg->payload[0] != (uint8_t) expected ||
+            msg->payload[sizeof(msg->payload) - 1] != (uint8_t) ~expected) {
+            ordered = false;
+        }
+        spsc_ring_release(&cross_core_ring);
+        expected++;
+    }
+
+    atomic_store(&cross_core_ordered, ordered);
+    atomic_store(&cross_core_received, expected);
+}
+
+static int test_ring_cross_core(void)
+{
+    TEST_ASSERT(spsc_ring_init(&cross_core_ring, cross_core_storage, sizeof(test_msg_t),
+                               CROSS_CORE_DEPTH) == SPSC_RING_OK);
+    atomic_store(&cross_core_received, 0);
+    atomic_store(&cross_core_ordered, false);
+
+    TEST_ASSERT(hal_core_launch(cross_core_consumer) == HAL_OK);
+
+    for (uint32_t i = 0; i < CROSS_CORE_MESSAGES; i++) {
+        test_msg_t *msg;
+        while ((msg = spsc_ring_reserve(&cross_core_ring)) == NULL) {
+            hal_core_signal();
+        }
+        msg->sequence = i;
+        memset(msg->payload, (uint8_t) i, sizeof(msg->payload));
+        msg->payload[sizeof(msg->payload) - 1] = (uint8_t) ~i;
+        spsc_ring_commit(&cross_core_ring);
+        hal_core_signal();
+    }
+
+    for (int i = 0; i < 5000 && atomic_load(&cross_core_received) < CROSS_CORE_MESSAGES; i++) {
+        hal_delay_ms(1);
+    }
+
+    TEST_ASSERT(atomic_load(&cross_core_received) == CROSS_CORE_MESSAGES);
+    TEST_ASSERT(atomic_load(&cross_core_ordered));
+    TEST_ASSERT(spsc_ring_is_empty(&cross_core_ring));
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main(void)
+{
+    int result = 0;
+
+    printf("Running SPSC ring tests...\n");
+
+    result |= test_ring_fifo();
+    result |= test_ring_cross_core();
+
+    if (result == 0) {
+        printf("\nAll SPSC ring tests passed!\n");
+    } else {
+        printf("\nSome SPSC ring tests failed!\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file test_trace.c
+ * @brief Unit tests for the span trace ring
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "trace.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+static int test_trace_record_read(void)
+{
+    trace_event_t events[4];
+    uint32_t cursor = 0;
+
+    trace_clear();
+    TEST_ASSERT(trace_head() == 0);
+    TEST_ASSERT(trace_read(&cursor, events, 4) == 0);
+
+    trace_record(TRACE_SPAN_REQUEST, TRACE_PHASE_BEGIN, 0x01);
+    trace_record(TRACE_SPAN_SIGN, TRACE_PHASE_BEGIN, 0);
+    trace_record(TRACE_SPAN_SIGN, TRACE_PHASE_END, 0);
+    trace_record(TRACE_SPAN_REQUEST, TRACE_PHASE_END, 0);
+    TEST_ASSERT(trace_head() == 4);
+
+    /* Page through in two reads */
+    TEST_ASSERT(trace_read(&cursor, events, 3) == 3);
+    TEST_ASSERT(cursor == 3);
+    TEST_ASSERT(events[0].span == TRACE_SPAN_REQUEST && events[0].arg == 0x01);
+    TEST_ASSERT(events[1].span == TRACE_SPAN_SIGN && events[1].phase == TRACE_PHASE_BEGIN);
+    TEST_ASSERT(events[0].timestamp_us <= events[2].timestamp_us);
+
+    TEST_ASSERT(trace_read(&cursor, events, 4) == 1);
+    TEST_ASSERT(events[0].span == TRACE_SPAN_REQUEST && events[0].phase == TRACE_PHASE_END);
+    TEST_ASSERT(trace_read(&cursor, events, 4) == 0);
+    TEST_ASSERT(cursor == 4);
+
+    TEST_PASS();
+}
+
+static int test_trace_overwrite(void)
+{
+    trace_event_t event;
+    uint32_t cursor = 0;
+
+    trace_clear();
+    for (uint32_t i = 0; i < CONFIG_TRACE_EVENTS + 10; i++) {
+        trace_record(TRACE_SPAN_FLASH_WRITE, TRACE_PHASE_BEGIN, (uint8_t) i);
+    }
+
+    /* The oldest 10 events are gone; reading resumes at the oldest kept */
+    TEST_ASSERT(trace_read(&cursor, &event, 1) == 1);
+    TEST_ASSERT(cursor == 11);
+    TEST_ASSERT(event.arg == 10);
+
+    /* A cursor from before a clear restarts at the beginning */
+    trace_clear();
+    trace_record(TRACE_SPAN_SEND, TRACE_PHASE_BEGIN, 0x10);
+    TEST_ASSERT(trace_read(&cursor, &event, 1) == 1);
+    TEST_ASSERT(cursor == 1);
+    TEST_ASSERT(event.span == TRACE_SPAN_SEND && event.arg == 0x10);
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main(void)
+{
+    int result = 0;
+
+    printf("Running trace tests...\n");
+
+    result |= test_trace_record_read();
+    result |= test_trace_overwrite();
+
+    if (result == 0) {
+        printf("\nAll trace tests passed!\n");
+    } else {
+        printf("\nSome trace tests failed!\n");
+    }
+
+    return result;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file test_user_presence.c
+ * @brief Unit tests for asynchronous user presence
+ *
+ * @copyright Copyright (c) 2025 OpenFIDO Contributors
+ * @license MIT License
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hal.h"
+#include "user_presence.h"
+
+/* Test helper macros */
+#define TEST_ASSERT(condition)                                            \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("FAIL: %s:%d - %s\n", __FILE__, __LINE__, #condition); \
+            return 1;                                                     \
+        }                                                                 \
+    } while (0)
+
+#define TEST_PASS()                     \
+    do {                                \
+        printf("PASS: %s\n", __func__); \
+        return 0;                       \
+    } while (0)
+
+/* Provided by mock_hal.c */
+extern void mock_set_button_pressed(bool pressed);
+
+/* Counts service hook calls; presses or cancels after a few of them */
+static int service_calls;
+static int press_after;
+static int cancel_after;
+
+static void test_service(void)
+{
+    service_calls++;
+
+    if (service_calls == press_after) {
+        mock_set_button_pressed(true);
+    }
+    if (service_calls == cancel_after) {
+        up_cancel();
+    }
+}
+
+static void reset_fixture(void)
+{
+    mock_set_button_pressed(false);
+    up_init();
+    up_set_service_hook(test_service);
+    service_calls = 0;
+    press_after = -1;
+    cancel_after = -1;
+}
+
+/* A press from the interrupt completes a pending wait */
+int test_up_press_confirms(void)
+{
+    reset_fixture();
+
+    TEST_ASSERT(up_request(30000) == UP_OK);
+    TEST_ASSERT(up_is_waiting());
+    TEST_ASSERT(up_poll() == UP_RESULT_PENDING);
+
+    mock_set_button_pressed(true);
+    TEST_ASSERT(up_poll() == UP_RESULT_CONFIRMED);
+    TEST_ASSERT(!up_is_waiting());
+
+    TEST_PASS();
+}
+
+/* The service hook keeps running until the touch arrives */
+int test_up_wait_services(void)
+{
+    reset_fixture();
+    press_after = 5;
+
+    TEST_ASSERT(up_wait(30000) == UP_RESULT_CONFIRMED);
+    TEST_ASSERT(service_calls == 5);
+
+    TEST_PASS();
+}
+
+/* A host cancel ends the wait */
+int test_up_wait_cancel(void)
+{
+    reset_fixture();
+    cancel_after = 3;
+
+    TEST_ASSERT(up_wait(30000) == UP_RESULT_CANCELLED);
+    TEST_ASSERT(service_calls == 3);
+    TEST_ASSERT(!up_is_waiting());
+
+    TEST_PASS();
+}
+
+/* Only one wait may be pending; an expired wait times out */
+int test_up_busy_and_timeout(void)
+{
+    reset_fixture();
+
+    TEST_ASSERT(up_request(0) == UP_OK);
+    TEST_ASSERT(up_request(0) == UP_ERROR_BUSY);
+    TEST_ASSERT(up_poll() == UP_RESULT_TIMEOUT);
+    TEST_ASSERT(up_request(0) == UP_OK);
+    up_cancel();
+    TEST_ASSERT(up_poll() == UP_RESULT_CANCELLED);
+
+    TEST_PASS();
+}
+
+/* Contact bounce after a touch does not confirm the next wait */
+int test_up_bounce_ignored(void)
+{
+    reset_fixture();
+
+    TEST_ASSERT(up_request(30000) == UP_OK);
+    mock_set_button_pressed(true);
+    TEST_ASSERT(up_poll() == UP_RESULT_CONFIRMED);
+
+    /* Released, with the contacts chattering on the way */
+    TEST_ASSERT(up_request(30000) == UP_OK);
+    mock_set_button_pressed(false);
+    mock_set_button_pressed(true);
+    mock_set_button_pressed(false);
+    TEST_ASSERT(up_poll() == UP_RESULT_PENDING);
+    up_cancel();
+    TEST_ASSERT(up_poll() == UP_RESULT_CANCELLED);
+
+    TEST_PASS();
+}
+
+/* Main test runner */
+int main(void)
+{
+    int result = 0;
+
+    printf("Running user presence tests...\n");
+
+    result |= test_up_press_confirms();
+    result |= test_up_wait_services();
+    result |= test_up_wait_cancel();
+    result |= test_up_busy_and_timeout();
+    result |= test_up_bounce_ignored();
+
+    if (result == 0) {
+        printf("\nAll user presence tests passed!\n");
+    } else {
+        printf("\nSome user presence tests failed!\n");
+    }
+
+    return result;
+}